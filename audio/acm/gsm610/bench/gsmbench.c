@@ -0,0 +1,314 @@
+//==========================================================================;
+//
+//  THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY
+//  KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR
+//  PURPOSE.
+//
+//  Copyright (c) 1993-1999 Microsoft Corporation
+//
+//--------------------------------------------------------------------------;
+//
+//  gsmbench.c
+//
+//  Description:
+//      Console benchmark for the GSM 6.10 batch conversion routines.  The
+//      codec algorithm (gsm610.c and gsmbatch.c) is compiled straight into
+//      the program, without the ACM driver around it.
+//
+//      A stretch of synthetic speech-like audio at 8 kHz is encoded and
+//      decoded in 8-bit and 16-bit PCM on one thread, then on two, four
+//      and so on up to the number of threads asked for.  For each the
+//      program reports throughput, how many times faster than real time
+//      the conversion ran, and that figure per thread.
+//
+//      Before timing, it checks that the SSE2 encode routines produce the
+//      same bit stream as the C routines, and that a batch conversion on
+//      one thread matches gsm610EncodeBuffer and gsm610DecodeBuffer.  It
+//      exits with 1 if either differs.
+//
+//      Usage:  gsmbench [-s<seconds>] [-t<threads>] [-n<count>]
+//
+//==========================================================================;
+
+#include <windows.h>
+#include <windowsx.h>
+#include <mmsystem.h>
+#include <mmreg.h>
+#include <msacm.h>
+#include <msacmdrv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "codec.h"
+#include "gsm610.h"
+
+
+#define GSMBENCH_RATE               8000
+#define GSMBENCH_DEFAULT_SECONDS    120
+#define GSMBENCH_DEFAULT_COUNT      2       // timed passes per conversion
+
+
+
+//--------------------------------------------------------------------------;
+//
+//  void gsmbenchSynthesize
+//
+//  Description:
+//      This routine fills a buffer with speech-like test audio:  a few
+//      drifting partials, amplitude modulated at a syllable rate, with a
+//      little noise.
+//
+//  Arguments:
+//      short *psDst:  The buffer, 16-bit PCM.
+//      DWORD cSamples:  The number of samples.
+//
+//  Return (void):
+//
+//--------------------------------------------------------------------------;
+
+static void gsmbenchSynthesize
+(
+    short               *   psDst,
+    DWORD                   cSamples
+)
+{
+    DWORD                   dwSample;
+    double                  dTime;
+    double                  dPitch;
+    double                  dEnvelope;
+    double                  dSample;
+
+    srand(1);
+    for( dwSample=0; dwSample<cSamples; dwSample++ )
+    {
+        dTime     = (double)dwSample / GSMBENCH_RATE;
+        dPitch    = 6.2831853 * (140.0 + 30.0 * sin(dTime * 1.7));
+        dEnvelope = 0.55 + 0.45 * sin(dTime * 6.2831853 * 4.0);
+        dSample   = 0.50 * sin(dPitch * dTime)
+                  + 0.25 * sin(dPitch * dTime * 3.0)
+                  + 0.12 * sin(dPitch * dTime * 7.0);
+        dSample   = dSample * dEnvelope * 26000.0 + (rand() % 1025) - 512;
+
+        if( dSample > 32767.0 )
+            dSample = 32767.0;
+        else if( dSample < -32768.0 )
+            dSample = -32768.0;
+
+        *psDst++ = (short)dSample;
+    }
+}
+
+
+
+//--------------------------------------------------------------------------;
+//
+//  int main
+//
+//  Description:
+//      Parses the command line, checks the conversions, then times them
+//      on an increasing number of threads.
+//
+//  Return (int):  0 if every check passed; 1 otherwise.
+//
+//--------------------------------------------------------------------------;
+
+int __cdecl main
+(
+    int                     argc,
+    char                *   argv[]
+)
+{
+    STREAMINSTANCE          si;
+    SYSTEM_INFO             sysinfo;
+    LARGE_INTEGER           liFrequency;
+    LARGE_INTEGER           liStart;
+    LARGE_INTEGER           liEnd;
+    UINT                    cSeconds        = GSMBENCH_DEFAULT_SECONDS;
+    UINT                    cMaxThreads     = 0;
+    UINT                    cPasses         = GSMBENCH_DEFAULT_COUNT;
+    UINT                    cThreads;
+    UINT                    uBits;
+    UINT                    uPass;
+    BOOL                    f16Bit;
+    BOOL                    fSSE2;
+    DWORD                   cSamples;
+    DWORD                   cBlocks;
+    DWORD                   cbPCM;
+    DWORD                   cbGSM;
+    DWORD                   cbEncoded;
+    DWORD                   cbCheck;
+    DWORD                   cbDecoded;
+    DWORD                   dwSample;
+    short               *   psSource;
+    HPBYTE                  pbPCM;
+    HPBYTE                  pbGSM;
+    HPBYTE                  pbCheck;
+    HPBYTE                  pbDecoded;
+    double                  dEncodeSeconds;
+    double                  dDecodeSeconds;
+    double                  dAudioSeconds;
+    int                     nResult = 0;
+    int                     i;
+
+    for( i=1; i<argc; i++ )
+    {
+        if( ('-' != argv[i][0]) && ('/' != argv[i][0]) )
+            break;
+
+        switch( argv[i][1] )
+        {
+            case 's':   cSeconds    = atoi(&argv[i][2]);    break;
+            case 't':   cMaxThreads = atoi(&argv[i][2]);    break;
+            case 'n':   cPasses     = atoi(&argv[i][2]);    break;
+            default:    i = argc;                           break;
+        }
+    }
+
+    if( (i != argc) || (0 == cSeconds) || (0 == cPasses) )
+    {
+        printf("usage: gsmbench [-s<seconds>] [-t<threads>] [-n<count>]\n");
+        printf("       -t defaults to the number of processors.\n");
+        return 2;
+    }
+
+    if( 0 == cMaxThreads )
+    {
+        GetSystemInfo(&sysinfo);
+        cMaxThreads = sysinfo.dwNumberOfProcessors;
+    }
+    cMaxThreads = min(cMaxThreads, GSM610_BATCH_MAXTHREADS);
+
+    gsm610Init();
+    fSSE2 = gfGsm610SSE2;
+    QueryPerformanceFrequency(&liFrequency);
+
+    //
+    //  Whole blocks only, so every conversion covers the same audio.
+    //
+    cBlocks       = (GSMBENCH_RATE * cSeconds) / GSM610_SAMPLESPERMONOBLOCK;
+    cSamples      = cBlocks * GSM610_SAMPLESPERMONOBLOCK;
+    cbGSM         = cBlocks * GSM610_BYTESPERMONOBLOCK;
+    dAudioSeconds = (double)cSamples / GSMBENCH_RATE;
+
+    psSource  = (short *)malloc(cSamples * sizeof(short));
+    pbPCM     = (HPBYTE)malloc(cSamples * sizeof(short));
+    pbGSM     = (HPBYTE)malloc(cbGSM);
+    pbCheck   = (HPBYTE)malloc(cSamples * sizeof(short));
+    pbDecoded = (HPBYTE)malloc(cSamples * sizeof(short));
+    if( !psSource || !pbPCM || !pbGSM || !pbCheck || !pbDecoded )
+    {
+        printf("out of memory\n");
+        return 2;
+    }
+
+    gsmbenchSynthesize(psSource, cSamples);
+
+    printf("GSM 6.10, %u Hz, %u seconds, %u passes, SSE2 %s\n\n",
+           GSMBENCH_RATE, cSeconds, cPasses, fSSE2 ? "on" : "not available");
+    printf("%-8s %8s %12s %8s %8s %12s %8s %8s\n", "format", "threads",
+           "encode MB/s", "x real", "/thread", "decode MB/s", "x real", "/thread");
+
+    for( uBits=8; uBits<=16; uBits+=8 )
+    {
+        f16Bit = (16 == uBits);
+        cbPCM  = cSamples * uBits / 8;
+
+        if( f16Bit )
+        {
+            CopyMemory(pbPCM, psSource, cbPCM);
+        }
+        else
+        {
+            for( dwSample=0; dwSample<cSamples; dwSample++ )
+                pbPCM[dwSample] = (BYTE)((psSource[dwSample] >> 8) + 128);
+        }
+
+        //
+        //  Check the encode:  SSE2 against C, and one batch thread against
+        //  a single gsm610EncodeBuffer call.
+        //
+        gsm610Reset(&si);
+        cbEncoded = gsm610EncodeBuffer(&si, pbPCM, cbPCM, f16Bit, pbGSM);
+
+        if( fSSE2 )
+        {
+            gfGsm610SSE2 = FALSE;
+            gsm610Reset(&si);
+            cbCheck = gsm610EncodeBuffer(&si, pbPCM, cbPCM, f16Bit, pbCheck);
+            gfGsm610SSE2 = TRUE;
+
+            if( (cbCheck != cbEncoded) || (0 != memcmp(pbCheck, pbGSM, cbEncoded)) )
+            {
+                printf("%u-bit    SSE2 encode differs from the C encode\n", uBits);
+                nResult = 1;
+            }
+        }
+
+        cbCheck = gsm610EncodeBatch(pbPCM, cbPCM, f16Bit, pbCheck, 1);
+        if( (cbEncoded != cbGSM) || (cbCheck != cbEncoded) ||
+            (0 != memcmp(pbCheck, pbGSM, cbEncoded)) )
+        {
+            printf("%u-bit    batch encode differs from gsm610EncodeBuffer\n", uBits);
+            nResult = 1;
+        }
+
+        //
+        //  Check the decode the same way.
+        //
+        gsm610Reset(&si);
+        cbDecoded = gsm610DecodeBuffer(&si, pbGSM, cBlocks, f16Bit, pbDecoded);
+        cbCheck   = gsm610DecodeBatch(pbGSM, cBlocks, f16Bit, pbCheck, 1);
+        if( (cbDecoded != cbPCM) || (cbCheck != cbDecoded) ||
+            (0 != memcmp(pbCheck, pbDecoded, cbDecoded)) )
+        {
+            printf("%u-bit    batch decode differs from gsm610DecodeBuffer\n", uBits);
+            nResult = 1;
+        }
+
+        //
+        //  Time the batch routines on 1, 2, 4 ... threads, and on the
+        //  maximum if that is not a power of two.
+        //
+        cThreads = 1;
+        for( ;; )
+        {
+            dEncodeSeconds = 0.0;
+            dDecodeSeconds = 0.0;
+            for( uPass=0; uPass<cPasses; uPass++ )
+            {
+                QueryPerformanceCounter(&liStart);
+                gsm610EncodeBatch(pbPCM, cbPCM, f16Bit, pbCheck, cThreads);
+                QueryPerformanceCounter(&liEnd);
+                dEncodeSeconds += (double)(liEnd.QuadPart - liStart.QuadPart) / liFrequency.QuadPart;
+
+                QueryPerformanceCounter(&liStart);
+                gsm610DecodeBatch(pbGSM, cBlocks, f16Bit, pbDecoded, cThreads);
+                QueryPerformanceCounter(&liEnd);
+                dDecodeSeconds += (double)(liEnd.QuadPart - liStart.QuadPart) / liFrequency.QuadPart;
+            }
+
+            printf("%2u-bit   %8u %12.2f %8.0f %8.0f %12.2f %8.0f %8.0f\n",
+                   uBits, cThreads,
+                   (double)cbPCM * cPasses / dEncodeSeconds / 1048576.0,
+                   dAudioSeconds * cPasses / dEncodeSeconds,
+                   dAudioSeconds * cPasses / dEncodeSeconds / cThreads,
+                   (double)cbPCM * cPasses / dDecodeSeconds / 1048576.0,
+                   dAudioSeconds * cPasses / dDecodeSeconds,
+                   dAudioSeconds * cPasses / dDecodeSeconds / cThreads);
+
+            if( cThreads >= cMaxThreads )
+                break;
+            cThreads = min(cThreads * 2, cMaxThreads);
+        }
+    }
+
+    free(psSource);
+    free(pbPCM);
+    free(pbGSM);
+    free(pbCheck);
+    free(pbDecoded);
+
+    printf("\n%s\n", (0 == nResult) ? "All checks passed." : "CONVERSION MISMATCH.");
+    return nResult;
+}
@@ -2407,6 +2407,7 @@ EXTERN_C LRESULT FNEXPORT DriverProc
             DbgInitialize(TRUE);
 	    DPF(4, "DRV_LOAD");
 #endif
+            gsm610Init();
             return(1L);
 
         //
@@ -29,14 +29,26 @@
 
 #include "debug.h"
 
-typedef BYTE HUGE *HPBYTE;
-
 #ifdef WIN32
     typedef WORD UNALIGNED *HPWORD;
 #else
     typedef WORD HUGE *HPWORD;
 #endif
 
+//
+//  CompACF and the LTP lag search in encodeLTPAnalysis have SSE2 dot
+//  products for x86 and x64, used when the processor supports them.
+//
+#if defined(_X86_) || defined(_AMD64_)
+#define GSM610_SSE2
+#include <emmintrin.h>
+#ifndef PF_XMMI64_INSTRUCTIONS_AVAILABLE
+#define PF_XMMI64_INSTRUCTIONS_AVAILABLE    10
+#endif
+#endif
+
+BOOL gfGsm610SSE2 = FALSE;
+
 
 //**************************************************************************
 /*
@@ -270,6 +282,33 @@ void UnpackFrame1
 //---------------------------------------------------------------------
 
 
+//---------------------------------------------------------------------
+//
+// gsm610Init(void)
+//
+// Description:
+//	Checks whether the processor supports SSE2, to pick the versions
+//	of the encode routines to use.  Called once, when the driver is
+//	loaded.
+//
+// Arguments:
+//	None
+//
+// Return value:
+//	void
+//	    No return value
+//
+//---------------------------------------------------------------------
+
+void FNGLOBAL gsm610Init(void)
+{
+#ifdef GSM610_SSE2
+    gfGsm610SSE2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+#endif
+    return;
+}
+
+
 //---------------------------------------------------------------------
 //
 // gsm610Reset(PSTREAMINSTANCE psi)
@@ -353,34 +392,10 @@ LRESULT FNGLOBAL gsm610Encode
 #endif
 
     PSTREAMINSTANCE	psi;
-    DWORD		cbSrcLen;
     BOOL		fBlockAlign;
     DWORD		cb;
     DWORD		dwcSamples;	// dw count of samples
     DWORD		cBlocks;
-    UINT		i;
-    HPBYTE		hpbSrc, hpbDst;
-    
-    SHORT   sop[GSM610_SAMPLESPERFRAME];
-    SHORT   s[GSM610_SAMPLESPERFRAME];
-    SHORT   d[GSM610_SAMPLESPERFRAME];
-    SHORT   e[GSM610_SAMPLESPERSUBFRAME];
-    SHORT   dpp[GSM610_SAMPLESPERSUBFRAME];
-    SHORT   ep[GSM610_SAMPLESPERSUBFRAME];
-    
-    // The GSM610 stream data:
-    SHORT   LARc[9];			    // LARc[1..8] (one array per frame)
-    SHORT   Nc[GSM610_NUMSUBFRAMES];	    // Nc (one per sub-frame)
-    SHORT   bc[GSM610_NUMSUBFRAMES];	    // bc (one per sub-frame)
-    SHORT   Mc[GSM610_NUMSUBFRAMES];	    // Mc (one per sub-frame)
-    SHORT   xmaxc[GSM610_NUMSUBFRAMES];	    // Xmaxc (one per sub-frame)
-    XM	    xMc[GSM610_NUMSUBFRAMES];	    // xMc (one sequence per sub-frame)
-    
-    // Temp buffer to hold a block (two frames) of packed stream data
-    BYTE  abBlock[ GSM610_BYTESPERMONOBLOCK ];
-    
-    UINT    nFrame;
-    UINT    cSamples;
     
 #ifdef DEBUG
 //  ProfSetup(1000,0);
@@ -444,91 +459,8 @@ LRESULT FNGLOBAL gsm610Encode
     //
     //
     //
-    cbSrcLen = padsh->cbSrcLengthUsed;
-
-    // Setup huge pointers to our src and dst buffers
-    hpbSrc = (HPBYTE)padsh->pbSrc;
-    hpbDst = (HPBYTE)padsh->pbDst;
-    
-    // Loop thru entire source buffer
-    while (cbSrcLen)
-    {
-    
-	// Process source buffer as two full GSM610 frames
-	
-	for (nFrame=0; nFrame < 2; nFrame++)
-	{
-	    //
-	    // the src contains 8- or 16-bit PCM.  currently we only
-	    // handle mono conversions.
-	    //
-
-	    //
-	    // we will fill sop[] with one frame of 16-bit PCM samples
-	    //
-	    
-	    //
-	    // copy min( cSrcSamplesLeft, GSM610_SAMPLESPERFRAME ) samples
-	    // to array sop[].
-	    //
-	    dwcSamples = PCM_BYTESTOSAMPLES(((LPPCMWAVEFORMAT)(padsi->pwfxSrc)), cbSrcLen);
-	    cSamples = (int) min(dwcSamples, (DWORD) GSM610_SAMPLESPERFRAME);
-
-	    if (padsi->pwfxSrc->wBitsPerSample == 16)
-	    {
-		// copy 16-bit samples from hpbSrc to sop
-		for (i=0; i < cSamples; i++)
-		{
-		    sop[i] = *( ((HPWORD)hpbSrc)++ );
-		}
-	    }
-	    else
-	    {
-		// copy 8-bit samples from hpbSrc to 16-bit samples in sop
-		for (i=0; i < cSamples; i++)
-		{
-		    sop[i] = Convert8To16BitPCM(*hpbSrc++);
-		}
-	    }
-
-	    cbSrcLen -= PCM_SAMPLESTOBYTES(((LPPCMWAVEFORMAT)(padsi->pwfxSrc)), cSamples);
-
-	    // fill out sop[] with silence if necessary.
-	    for ( ; i < GSM610_SAMPLESPERFRAME; i++)
-	    {
-		sop[i] = 0;
-	    }
-	
-	    //
-	    // Encode a frame of data
-	    //
-	
-	    encodePreproc(psi, sop, s);
-	    encodeLPCAnalysis(psi, s, LARc);
-	    encodeLPCFilter(psi, LARc, s, d);
-
-	    // For each of four sub-frames
-	    for (i=0; i<4; i++)
-	    {	    
-		encodeLTPAnalysis(psi, &d[i*40], &Nc[i], &bc[i]);
-		encodeLTPFilter(psi, bc[i], Nc[i], &d[i*40], e, dpp);
-		encodeRPE(psi, e, &Mc[i], &xmaxc[i], xMc[i], ep);
-		encodeUpdate(psi, ep, dpp);
-	    }
-	
-	    //
-	    // Pack the data and store in dst buffer
-	    //
-	    if (nFrame == 0)
-		PackFrame0(abBlock, LARc, Nc, bc, Mc, xmaxc, xMc);
-	    else
-	    {
-		PackFrame1(abBlock, LARc, Nc, bc, Mc, xmaxc, xMc);
-		for (i=0; i<GSM610_BYTESPERMONOBLOCK; i++)
-		    *(hpbDst++) = abBlock[i];
-	    }
-	}   // for (nFrame...
-    }
+    gsm610EncodeBuffer(psi, (HPBYTE)padsh->pbSrc, padsh->cbSrcLengthUsed,
+		       (16 == padsi->pwfxSrc->wBitsPerSample), (HPBYTE)padsh->pbDst);
     
 
 #ifdef DEBUG
@@ -581,31 +513,10 @@ LRESULT FNGLOBAL gsm610Decode
 #endif
 
     PSTREAMINSTANCE	psi;
-    DWORD		cbSrcLen;
     BOOL		fBlockAlign;
     DWORD		cb;
     DWORD		dwcSamples;
     DWORD		cBlocks;
-    HPBYTE		hpbSrc, hpbDst;
-    
-    SHORT   erp[GSM610_SAMPLESPERSUBFRAME];
-    SHORT   wt[GSM610_SAMPLESPERFRAME];
-    SHORT   sr[GSM610_SAMPLESPERFRAME];
-    SHORT   srop[GSM610_SAMPLESPERFRAME];
-    
-    // The GSM610 stream data:
-    SHORT   LARcr[9];			    // LARc[1..8] (one array per frame)
-    SHORT   Ncr[GSM610_NUMSUBFRAMES];	    // Nc (one per sub-frame)
-    SHORT   bcr[GSM610_NUMSUBFRAMES];	    // bc (one per sub-frame)
-    SHORT   Mcr[GSM610_NUMSUBFRAMES];	    // Mc (one per sub-frame)
-    SHORT   xmaxcr[GSM610_NUMSUBFRAMES];    // Xmaxc (one per sub-frame)
-    XM	    xMcr[GSM610_NUMSUBFRAMES];	    // xMc (one sequence per sub-frame)
-    
-    UINT    i,j;
-    UINT    nFrame;
-
-    // Temp buffer to hold a block (two frames) of packed stream data
-    BYTE    abBlock[ GSM610_BYTESPERMONOBLOCK ];
     
     
 #ifdef DEBUG
@@ -667,21 +578,235 @@ LRESULT FNGLOBAL gsm610Decode
     //
     //
     //
-    cbSrcLen = padsh->cbSrcLengthUsed;
+    gsm610DecodeBuffer(psi, (HPBYTE)padsh->pbSrc, cBlocks,
+		       (16 == padsi->pwfxDst->wBitsPerSample), (HPBYTE)padsh->pbDst);
+    
+#ifdef DEBUG
+//  ProfStop();
+#endif
+    
+    return (MMSYSERR_NOERROR);
+}
 
+
+//--------------------------------------------------------------------------;
+//  
+//  DWORD gsm610EncodeBuffer
+//  
+//  Description:
+//	This function encodes a buffer of mono PCM to GSM 6.10, one block
+//	(two frames) at a time, continuing from the state in the stream
+//	instance.  A partial block at the end of the buffer is padded with
+//	silence.  It does the work for gsm610Encode and for the batch
+//	encoder in gsmbatch.c.
+//
+//  Arguments:
+//	PSTREAMINSTANCE psi: Stream instance holding the encoder state.
+//
+//	HPBYTE hpbSrc: The PCM to encode.
+//
+//	DWORD cbSrcLen: The length of the PCM, in bytes.
+//
+//	BOOL f16Bit: TRUE if the PCM is 16-bit; FALSE if it is 8-bit.
+//
+//	HPBYTE hpbDst: Destination for the encoded blocks.  It must have
+//	room for GSM610_BYTESPERMONOBLOCK bytes per block, counting the
+//	partial block.
+//
+//  Return (DWORD):
+//	The number of bytes written to hpbDst.
+//  
+//--------------------------------------------------------------------------;
+
+DWORD FNGLOBAL gsm610EncodeBuffer
+(
+    PSTREAMINSTANCE	    psi,
+    HPBYTE		    hpbSrc,
+    DWORD		    cbSrcLen,
+    BOOL		    f16Bit,
+    HPBYTE		    hpbDst
+)
+{
+    HPBYTE		hpbDstStart;
+    DWORD		dwcSamples;	// dw count of samples
+    UINT		cbSample;
+    UINT		i;
+    
+    SHORT   sop[GSM610_SAMPLESPERFRAME];
+    SHORT   s[GSM610_SAMPLESPERFRAME];
+    SHORT   d[GSM610_SAMPLESPERFRAME];
+    SHORT   e[GSM610_SAMPLESPERSUBFRAME];
+    SHORT   dpp[GSM610_SAMPLESPERSUBFRAME];
+    SHORT   ep[GSM610_SAMPLESPERSUBFRAME];
+    
+    // The GSM610 stream data:
+    SHORT   LARc[9];			    // LARc[1..8] (one array per frame)
+    SHORT   Nc[GSM610_NUMSUBFRAMES];	    // Nc (one per sub-frame)
+    SHORT   bc[GSM610_NUMSUBFRAMES];	    // bc (one per sub-frame)
+    SHORT   Mc[GSM610_NUMSUBFRAMES];	    // Mc (one per sub-frame)
+    SHORT   xmaxc[GSM610_NUMSUBFRAMES];	    // Xmaxc (one per sub-frame)
+    XM	    xMc[GSM610_NUMSUBFRAMES];	    // xMc (one sequence per sub-frame)
+    
+    // Temp buffer to hold a block (two frames) of packed stream data
+    BYTE  abBlock[ GSM610_BYTESPERMONOBLOCK ];
+    
+    UINT    nFrame;
+    UINT    cSamples;
+    
+    cbSample	= f16Bit ? sizeof(SHORT) : 1;
+    hpbDstStart = hpbDst;
+    
+    // Loop thru entire source buffer
+    while (cbSrcLen)
+    {
+    
+	// Process source buffer as two full GSM610 frames
+	
+	for (nFrame=0; nFrame < 2; nFrame++)
+	{
+	    //
+	    // the src contains 8- or 16-bit PCM.  currently we only
+	    // handle mono conversions.
+	    //
+
+	    //
+	    // we will fill sop[] with one frame of 16-bit PCM samples
+	    //
+	    
+	    //
+	    // copy min( cSrcSamplesLeft, GSM610_SAMPLESPERFRAME ) samples
+	    // to array sop[].
+	    //
+	    dwcSamples = cbSrcLen / cbSample;
+	    cSamples = (int) min(dwcSamples, (DWORD) GSM610_SAMPLESPERFRAME);
+
+	    if (f16Bit)
+	    {
+		// copy 16-bit samples from hpbSrc to sop
+		for (i=0; i < cSamples; i++)
+		{
+		    sop[i] = *( ((HPWORD)hpbSrc)++ );
+		}
+	    }
+	    else
+	    {
+		// copy 8-bit samples from hpbSrc to 16-bit samples in sop
+		for (i=0; i < cSamples; i++)
+		{
+		    sop[i] = Convert8To16BitPCM(*hpbSrc++);
+		}
+	    }
+
+	    cbSrcLen -= cSamples * cbSample;
+
+	    // fill out sop[] with silence if necessary.
+	    for ( ; i < GSM610_SAMPLESPERFRAME; i++)
+	    {
+		sop[i] = 0;
+	    }
+	
+	    //
+	    // Encode a frame of data
+	    //
 	
-    // Setup huge pointers to our src and dst buffers
-    hpbSrc = (HPBYTE)padsh->pbSrc;
-    hpbDst = (HPBYTE)padsh->pbDst;
+	    encodePreproc(psi, sop, s);
+	    encodeLPCAnalysis(psi, s, LARc);
+	    encodeLPCFilter(psi, LARc, s, d);
+
+	    // For each of four sub-frames
+	    for (i=0; i<4; i++)
+	    {	    
+		encodeLTPAnalysis(psi, &d[i*40], &Nc[i], &bc[i]);
+		encodeLTPFilter(psi, bc[i], Nc[i], &d[i*40], e, dpp);
+		encodeRPE(psi, e, &Mc[i], &xmaxc[i], xMc[i], ep);
+		encodeUpdate(psi, ep, dpp);
+	    }
+	
+	    //
+	    // Pack the data and store in dst buffer
+	    //
+	    if (nFrame == 0)
+		PackFrame0(abBlock, LARc, Nc, bc, Mc, xmaxc, xMc);
+	    else
+	    {
+		PackFrame1(abBlock, LARc, Nc, bc, Mc, xmaxc, xMc);
+		for (i=0; i<GSM610_BYTESPERMONOBLOCK; i++)
+		    *(hpbDst++) = abBlock[i];
+	    }
+	}   // for (nFrame...
+    }
+    
+
+    return (DWORD)(hpbDst - hpbDstStart);
+}
+
+
+//--------------------------------------------------------------------------;
+//  
+//  DWORD gsm610DecodeBuffer
+//  
+//  Description:
+//	This function decodes whole GSM 6.10 blocks to mono PCM, continuing
+//	from the state in the stream instance.  It does the work for
+//	gsm610Decode and for the batch decoder in gsmbatch.c.
+//
+//  Arguments:
+//	PSTREAMINSTANCE psi: Stream instance holding the decoder state.
+//
+//	HPBYTE hpbSrc: The GSM 6.10 blocks.
+//
+//	DWORD cBlocks: The number of blocks to decode.
+//
+//	BOOL f16Bit: TRUE to write 16-bit PCM; FALSE for 8-bit.
+//
+//	HPBYTE hpbDst: Destination for the PCM; GSM610_SAMPLESPERMONOBLOCK
+//	samples per block.
+//
+//  Return (DWORD):
+//	The number of bytes written to hpbDst.
+//  
+//--------------------------------------------------------------------------;
+
+DWORD FNGLOBAL gsm610DecodeBuffer
+(
+    PSTREAMINSTANCE	    psi,
+    HPBYTE		    hpbSrc,
+    DWORD		    cBlocks,
+    BOOL		    f16Bit,
+    HPBYTE		    hpbDst
+)
+{
+    HPBYTE		hpbDstStart;
+    
+    SHORT   erp[GSM610_SAMPLESPERSUBFRAME];
+    SHORT   wt[GSM610_SAMPLESPERFRAME];
+    SHORT   sr[GSM610_SAMPLESPERFRAME];
+    SHORT   srop[GSM610_SAMPLESPERFRAME];
+    
+    // The GSM610 stream data:
+    SHORT   LARcr[9];			    // LARc[1..8] (one array per frame)
+    SHORT   Ncr[GSM610_NUMSUBFRAMES];	    // Nc (one per sub-frame)
+    SHORT   bcr[GSM610_NUMSUBFRAMES];	    // bc (one per sub-frame)
+    SHORT   Mcr[GSM610_NUMSUBFRAMES];	    // Mc (one per sub-frame)
+    SHORT   xmaxcr[GSM610_NUMSUBFRAMES];    // Xmaxc (one per sub-frame)
+    XM	    xMcr[GSM610_NUMSUBFRAMES];	    // xMc (one sequence per sub-frame)
+    
+    UINT    i,j;
+    UINT    nFrame;
+
+    // Temp buffer to hold a block (two frames) of packed stream data
+    BYTE    abBlock[ GSM610_BYTESPERMONOBLOCK ];
+    
+    
+    hpbDstStart = hpbDst;
 
     
-    // while at least another full block of coded data
-    while (cbSrcLen >= GSM610_BYTESPERMONOBLOCK)
+    // for each block of coded data
+    while (cBlocks--)
     {
 	
 	// copy a block of data from stream buffer to our temp buffer	    
 	for (i=0; i<GSM610_BYTESPERMONOBLOCK; i++) abBlock[i] = *(hpbSrc++);
-	cbSrcLen -= GSM610_BYTESPERMONOBLOCK;
 	
 	// for each of the two frames in the block
 	for (nFrame=0; nFrame < 2; nFrame++)
@@ -719,7 +844,7 @@ LRESULT FNGLOBAL gsm610Decode
 	    // write decoded 16-bit PCM to dst.  our dst format
 	    // may be 8- or 16-bit PCM.
 	    //
-	    if (padsi->pwfxDst->wBitsPerSample == 16)
+	    if (f16Bit)
 	    {
 		// copy 16-bit samples from srop to hpbDst
 		for (j=0; j < GSM610_SAMPLESPERFRAME; j++)
@@ -741,11 +866,7 @@ LRESULT FNGLOBAL gsm610Decode
 	
     }
     
-#ifdef DEBUG
-//  ProfStop();
-#endif
-    
-    return (MMSYSERR_NOERROR);
+    return (DWORD)(hpbDst - hpbDstStart);
 }
 
 
@@ -765,6 +886,9 @@ LRESULT FNGLOBAL gsm610Decode
 //---------------------------------------------------------------------
 //---------------------------------------------------------------------
 EXTERN_C void CompACF(LPSHORT s, LPLONG l_ACF);
+#ifdef GSM610_SSE2
+LONG DotProductSSE2(LPSHORT a, LPSHORT b, UINT n);
+#endif
 void Compr(PSTREAMINSTANCE psi, LPLONG l_ACF, LPSHORT r);
 void CompLAR(PSTREAMINSTANCE psi, LPSHORT r, LPSHORT LAR);
 void CompLARc(PSTREAMINSTANCE psi, LPSHORT LAR, LPSHORT LARc);
@@ -1041,6 +1165,17 @@ void CompACF(LPSHORT s, LPLONG l_ACF)
     
     for (k=0; k<9; k++)
     {
+#ifdef GSM610_SSE2
+	//
+	// After the scaling above |s[k]| <= 2048, so these sums stay
+	// below 2**31 and a plain 32-bit sum matches l_add().
+	//
+	if (gfGsm610SSE2)
+	{
+	    l_ACF[k] = DotProductSSE2(&s[k], &s[0], 160-k) << 1;
+	    continue;
+	}
+#endif
 	l_ACF[k] = 0;
 	for (i=k; i<160; i++)
 	{
@@ -1071,6 +1206,43 @@ void CompACF(LPSHORT s, LPLONG l_ACF)
 }
 
 
+#ifdef GSM610_SSE2
+//---------------------------------------------------------------------
+//
+// DotProductSSE2()
+//
+// Returns the sum of a[i]*b[i] for i in 0..n-1, wrapping at 32 bits like
+// the 'C' loops it replaces.  pmaddwd only overflows when both products
+// of a pair are -32768*-32768; neither caller passes -32768 in a[].
+//
+//---------------------------------------------------------------------
+
+LONG DotProductSSE2(LPSHORT a, LPSHORT b, UINT n)
+{
+    __m128i xmmSum = _mm_setzero_si128();
+    LONG    l_sum;
+    UINT    i;
+
+    for (i=0; i+8<=n; i+=8)
+    {
+	xmmSum = _mm_add_epi32(xmmSum,
+			       _mm_madd_epi16(_mm_loadu_si128((__m128i *)&a[i]),
+					      _mm_loadu_si128((__m128i *)&b[i])));
+    }
+    xmmSum = _mm_add_epi32(xmmSum, _mm_srli_si128(xmmSum, 8));
+    xmmSum = _mm_add_epi32(xmmSum, _mm_srli_si128(xmmSum, 4));
+    l_sum  = _mm_cvtsi128_si32(xmmSum);
+
+    for ( ; i<n; i++)
+    {
+	l_sum += (LONG)a[i] * (LONG)b[i];
+    }
+
+    return l_sum;
+}
+#endif
+
+
 //---------------------------------------------------------------------
 //
 // Compr()
@@ -1452,6 +1624,11 @@ void encodeLTPAnalysis(PSTREAMINSTANCE psi, LPSHORT d, LPSHORT pNc, LPSHORT pbc)
     for (lambda=40; lambda<=120; lambda++)
     {
         register LONG l_result = 0;
+#ifdef GSM610_SSE2
+        if (gfGsm610SSE2)
+            l_result = DotProductSSE2(wt, &psi->dp[120-lambda], 40);
+        else
+#endif
         for (k=39; k>=0; k--)
         {
             l_result += (LONG)(wt[k]) * (LONG)(psi->dp[120-lambda+k]);
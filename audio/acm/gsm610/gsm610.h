@@ -76,15 +76,55 @@ extern "C"                          // assume C declarations for C++
 //
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - ; 
 
+typedef BYTE HUGE *HPBYTE;
+
+//
+//  The batch encoder and decoder (gsmbatch.c) split a long buffer into
+//  segments of whole blocks and convert the segments on separate threads.
+//  Each segment's stream instance is primed by converting up to
+//  GSM610_BATCH_PRIMEBLOCKS blocks before the segment and discarding the
+//  output, so that the filter state at the boundary is close to what a
+//  single pass would have; see gsmbatch.c.
+//
+#define GSM610_BATCH_MAXTHREADS         32
+#define GSM610_BATCH_MINBLOCKS          64      // shortest segment worth a thread
+#define GSM610_BATCH_PRIMEBLOCKS        8
+
+
 //
 //  function prototypes from GSM610.C
 //
 //
+extern BOOL gfGsm610SSE2;           // use the SSE2 encode routines
+
+void FNGLOBAL gsm610Init
+(
+    void
+);
+
 void FNGLOBAL gsm610Reset
 (
     PSTREAMINSTANCE         psi
 );
 
+DWORD FNGLOBAL gsm610EncodeBuffer
+(
+    PSTREAMINSTANCE         psi,
+    HPBYTE                  hpbSrc,
+    DWORD                   cbSrcLen,
+    BOOL                    f16Bit,
+    HPBYTE                  hpbDst
+);
+
+DWORD FNGLOBAL gsm610DecodeBuffer
+(
+    PSTREAMINSTANCE         psi,
+    HPBYTE                  hpbSrc,
+    DWORD                   cBlocks,
+    BOOL                    f16Bit,
+    HPBYTE                  hpbDst
+);
+
 LRESULT FNGLOBAL gsm610Decode
 (
     LPACMDRVSTREAMINSTANCE  padsi,
@@ -97,6 +137,28 @@ LRESULT FNGLOBAL gsm610Encode
     LPACMDRVSTREAMHEADER    padsh
 );
 
+//
+//  function prototypes from GSMBATCH.C
+//
+//
+DWORD FNGLOBAL gsm610EncodeBatch
+(
+    HPBYTE                  hpbSrc,
+    DWORD                   cbSrcLen,
+    BOOL                    f16Bit,
+    HPBYTE                  hpbDst,
+    UINT                    cThreads
+);
+
+DWORD FNGLOBAL gsm610DecodeBatch
+(
+    HPBYTE                  hpbSrc,
+    DWORD                   cBlocks,
+    BOOL                    f16Bit,
+    HPBYTE                  hpbDst,
+    UINT                    cThreads
+);
+
 
 
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - ; 
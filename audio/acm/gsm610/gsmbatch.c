@@ -0,0 +1,404 @@
+//==========================================================================;
+//
+//  THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY
+//  KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR
+//  PURPOSE.
+//
+//  Copyright (c) 1993-1999 Microsoft Corporation
+//
+//--------------------------------------------------------------------------;
+//
+//  gsmbatch.c
+//
+//  Description:
+//	This file contains batch encode and decode routines for converting
+//	long buffers of GSM 06.10 on several threads at once.  They are not
+//	used by the ACM driver itself, which converts each stream serially;
+//	they are for applications that link gsm610.c directly to transcode
+//	whole files.
+//
+//	The buffer is split into segments of whole blocks, one per thread.
+//	The first segment starts from a reset stream instance, as a
+//	conversion flagged ACM_STREAMCONVERTF_START would.  Every other
+//	segment gets its own stream instance, which is primed by converting
+//	up to GSM610_BATCH_PRIMEBLOCKS blocks before the segment and throwing
+//	the output away.  The decoder's state (the LTP history, the LAR
+//	interpolation and the synthesis filter) is rebuilt within a frame
+//	or two, so decoded segments join the single-pass output after the
+//	first few samples.  The encoder's offset compensation filter forgets
+//	its past slowly, and its parameter search picks different but
+//	equally good codes from then on, so an encoded segment is not the
+//	same bit stream a single pass would produce; it decodes to speech
+//	of the same quality.  With one thread, or a buffer too short to
+//	split, the output is exactly that of gsm610EncodeBuffer or
+//	gsm610DecodeBuffer.
+//
+//==========================================================================;
+
+#include <windows.h>
+#include <windowsx.h>
+#include <mmsystem.h>
+#include <mmreg.h>
+#include <msacm.h>
+#include <msacmdrv.h>
+
+#include "codec.h"
+#include "gsm610.h"
+
+#include "debug.h"
+
+
+//
+//  One segment of a batch conversion.
+//
+typedef struct tGSM610SEGMENT
+{
+    STREAMINSTANCE	si;		// this segment's codec state
+    BOOL		fEncode;
+    BOOL		f16Bit;
+    HPBYTE		hpbPrime;	// first block to prime with
+    DWORD		cPrimeBlocks;
+    HPBYTE		hpbSrc;
+    DWORD		cbSrc;		// encode: bytes of PCM
+    DWORD		cBlocks;	// decode: blocks of GSM 6.10
+    HPBYTE		hpbDst;
+    DWORD		cbDst;		// bytes written
+#ifdef WIN32
+    HANDLE		hThread;
+#endif
+
+} GSM610SEGMENT, FAR *LPGSM610SEGMENT;
+
+
+//--------------------------------------------------------------------------;
+//
+//  void gsmbatchConvertSegment
+//
+//  Description:
+//	Primes the segment's stream instance, then converts the segment.
+//
+//  Arguments:
+//	LPGSM610SEGMENT pseg: The segment.
+//
+//  Return (void):
+//
+//--------------------------------------------------------------------------;
+
+void FNLOCAL gsmbatchConvertSegment
+(
+    LPGSM610SEGMENT	    pseg
+)
+{
+    //
+    // Big enough for the PCM of the priming blocks, which is larger
+    // than their encoded data.
+    //
+    BYTE    abPrime[GSM610_BATCH_PRIMEBLOCKS * GSM610_SAMPLESPERMONOBLOCK * sizeof(SHORT)];
+    UINT    cbSample;
+
+    cbSample = pseg->f16Bit ? sizeof(SHORT) : 1;
+
+    gsm610Reset(&pseg->si);
+
+    if (pseg->fEncode)
+    {
+	if (0 != pseg->cPrimeBlocks)
+	{
+	    gsm610EncodeBuffer(&pseg->si, pseg->hpbPrime,
+			       pseg->cPrimeBlocks * GSM610_SAMPLESPERMONOBLOCK * cbSample,
+			       pseg->f16Bit, (HPBYTE)abPrime);
+	}
+	pseg->cbDst = gsm610EncodeBuffer(&pseg->si, pseg->hpbSrc, pseg->cbSrc,
+					 pseg->f16Bit, pseg->hpbDst);
+    }
+    else
+    {
+	if (0 != pseg->cPrimeBlocks)
+	{
+	    gsm610DecodeBuffer(&pseg->si, pseg->hpbPrime, pseg->cPrimeBlocks,
+			       pseg->f16Bit, (HPBYTE)abPrime);
+	}
+	pseg->cbDst = gsm610DecodeBuffer(&pseg->si, pseg->hpbSrc, pseg->cBlocks,
+					 pseg->f16Bit, pseg->hpbDst);
+    }
+
+    return;
+}
+
+
+#ifdef WIN32
+//--------------------------------------------------------------------------;
+//
+//  DWORD gsmbatchSegmentThread
+//
+//  Description:
+//	Thread procedure for the segments after the first.
+//
+//  Arguments:
+//	LPVOID pv: The segment.
+//
+//  Return (DWORD):
+//	Zero.
+//
+//--------------------------------------------------------------------------;
+
+DWORD WINAPI gsmbatchSegmentThread
+(
+    LPVOID		    pv
+)
+{
+    gsmbatchConvertSegment((LPGSM610SEGMENT)pv);
+    return 0;
+}
+#endif
+
+
+//--------------------------------------------------------------------------;
+//
+//  DWORD gsmbatchConvert
+//
+//  Description:
+//	Splits a conversion into segments and runs them, the first on the
+//	calling thread and the others on threads of their own.  If a thread
+//	can't be created, its segment is converted on the calling thread.
+//
+//  Arguments:
+//	BOOL fEncode: TRUE to encode; FALSE to decode.
+//
+//	HPBYTE hpbSrc: The source.
+//
+//	DWORD cbSrcLen: Encode only: the length of the PCM, in bytes.
+//
+//	DWORD cBlocks: The number of GSM 6.10 blocks to decode, or that the
+//	encode will produce.
+//
+//	BOOL f16Bit: TRUE if the PCM is 16-bit; FALSE if it is 8-bit.
+//
+//	HPBYTE hpbDst: The destination.
+//
+//	UINT cThreads: The most threads to use.
+//
+//  Return (DWORD):
+//	The number of bytes written to hpbDst.
+//
+//--------------------------------------------------------------------------;
+
+DWORD FNLOCAL gsmbatchConvert
+(
+    BOOL		    fEncode,
+    HPBYTE		    hpbSrc,
+    DWORD		    cbSrcLen,
+    DWORD		    cBlocks,
+    BOOL		    f16Bit,
+    HPBYTE		    hpbDst,
+    UINT		    cThreads
+)
+{
+    GSM610SEGMENT	segOne;
+    LPGSM610SEGMENT	pseg;
+    LPGSM610SEGMENT	aseg;
+    UINT		cSegments;
+    UINT		nSegment;
+    DWORD		cbPCMBlock;
+    DWORD		nFirstBlock;
+    DWORD		nEndBlock;
+    DWORD		cbDst;
+#ifdef WIN32
+    HANDLE		ahThread[GSM610_BATCH_MAXTHREADS];
+    UINT		cWait;
+    DWORD		dwThreadId;
+#endif
+
+    cbPCMBlock = GSM610_SAMPLESPERMONOBLOCK * (f16Bit ? sizeof(SHORT) : 1);
+
+    //
+    // One segment per thread, but no shorter than GSM610_BATCH_MINBLOCKS.
+    //
+    cSegments = (UINT)min(cThreads, GSM610_BATCH_MAXTHREADS);
+    if ((DWORD)cSegments > cBlocks / GSM610_BATCH_MINBLOCKS)
+	cSegments = (UINT)(cBlocks / GSM610_BATCH_MINBLOCKS);
+    if (0 == cSegments)
+	cSegments = 1;
+
+    aseg = NULL;
+    if (cSegments > 1)
+    {
+	aseg = (LPGSM610SEGMENT)GlobalAllocPtr(GPTR, cSegments * sizeof(GSM610SEGMENT));
+	if (NULL == aseg)
+	{
+	    DPF(1, "gsmbatchConvert: no memory for segments, converting serially.");
+	    cSegments = 1;
+	}
+    }
+    if (NULL == aseg)
+    {
+	aseg = &segOne;
+    }
+
+    for (nSegment=0; nSegment<cSegments; nSegment++)
+    {
+	pseg	    = &aseg[nSegment];
+	nFirstBlock = (cBlocks / cSegments) * nSegment + min(nSegment, cBlocks % cSegments);
+	nEndBlock   = nFirstBlock + (cBlocks / cSegments) + ((nSegment < cBlocks % cSegments) ? 1 : 0);
+
+	pseg->fEncode	   = fEncode;
+	pseg->f16Bit	   = f16Bit;
+	pseg->cPrimeBlocks = min(nFirstBlock, GSM610_BATCH_PRIMEBLOCKS);
+	pseg->cBlocks	   = nEndBlock - nFirstBlock;
+
+	if (fEncode)
+	{
+	    pseg->hpbPrime = hpbSrc + (nFirstBlock - pseg->cPrimeBlocks) * cbPCMBlock;
+	    pseg->hpbSrc   = hpbSrc + nFirstBlock * cbPCMBlock;
+	    pseg->hpbDst   = hpbDst + nFirstBlock * GSM610_BYTESPERMONOBLOCK;
+
+	    // The last segment takes the partial block at the end, if any.
+	    if (nSegment == cSegments - 1)
+		pseg->cbSrc = cbSrcLen - nFirstBlock * cbPCMBlock;
+	    else
+		pseg->cbSrc = pseg->cBlocks * cbPCMBlock;
+	}
+	else
+	{
+	    pseg->hpbPrime = hpbSrc + (nFirstBlock - pseg->cPrimeBlocks) * GSM610_BYTESPERMONOBLOCK;
+	    pseg->hpbSrc   = hpbSrc + nFirstBlock * GSM610_BYTESPERMONOBLOCK;
+	    pseg->hpbDst   = hpbDst + nFirstBlock * cbPCMBlock;
+	}
+	pseg->cbDst = 0;
+    }
+
+#ifdef WIN32
+    cWait = 0;
+    for (nSegment=1; nSegment<cSegments; nSegment++)
+    {
+	pseg = &aseg[nSegment];
+	pseg->hThread = CreateThread(NULL, 0, gsmbatchSegmentThread, pseg, 0, &dwThreadId);
+	if (NULL != pseg->hThread)
+	    ahThread[cWait++] = pseg->hThread;
+    }
+
+    gsmbatchConvertSegment(&aseg[0]);
+
+    for (nSegment=1; nSegment<cSegments; nSegment++)
+    {
+	if (NULL == aseg[nSegment].hThread)
+	    gsmbatchConvertSegment(&aseg[nSegment]);
+    }
+
+    if (0 != cWait)
+    {
+	WaitForMultipleObjects(cWait, ahThread, TRUE, INFINITE);
+	while (cWait--)
+	    CloseHandle(ahThread[cWait]);
+    }
+#else
+    for (nSegment=0; nSegment<cSegments; nSegment++)
+    {
+	gsmbatchConvertSegment(&aseg[nSegment]);
+    }
+#endif
+
+    cbDst = 0;
+    for (nSegment=0; nSegment<cSegments; nSegment++)
+    {
+	cbDst += aseg[nSegment].cbDst;
+    }
+
+    if (aseg != &segOne)
+    {
+	GlobalFreePtr(aseg);
+    }
+
+    return cbDst;
+}
+
+
+//--------------------------------------------------------------------------;
+//
+//  DWORD gsm610EncodeBatch
+//
+//  Description:
+//	Encodes a buffer of mono PCM to GSM 6.10 on up to cThreads threads.
+//	A partial block at the end is padded with silence, as gsm610Encode
+//	does when the conversion is not block aligned.
+//
+//  Arguments:
+//	HPBYTE hpbSrc: The PCM to encode.
+//
+//	DWORD cbSrcLen: The length of the PCM, in bytes.
+//
+//	BOOL f16Bit: TRUE if the PCM is 16-bit; FALSE if it is 8-bit.
+//
+//	HPBYTE hpbDst: Destination for the encoded blocks.  It must have
+//	room for GSM610_BYTESPERMONOBLOCK bytes per block, counting the
+//	partial block.
+//
+//	UINT cThreads: The most threads to use; 1 encodes serially on the
+//	calling thread.
+//
+//  Return (DWORD):
+//	The number of bytes written to hpbDst.
+//
+//--------------------------------------------------------------------------;
+
+DWORD FNGLOBAL gsm610EncodeBatch
+(
+    HPBYTE		    hpbSrc,
+    DWORD		    cbSrcLen,
+    BOOL		    f16Bit,
+    HPBYTE		    hpbDst,
+    UINT		    cThreads
+)
+{
+    DWORD   cSamples;
+    DWORD   cBlocks;
+
+    cSamples = f16Bit ? cbSrcLen / sizeof(SHORT) : cbSrcLen;
+    cBlocks  = (cSamples + GSM610_SAMPLESPERMONOBLOCK - 1) / GSM610_SAMPLESPERMONOBLOCK;
+
+    DPF(3, "gsm610EncodeBatch: %lu blocks, %u threads.", cBlocks, cThreads);
+
+    return gsmbatchConvert(TRUE, hpbSrc, cSamples * (f16Bit ? sizeof(SHORT) : 1),
+			   cBlocks, f16Bit, hpbDst, cThreads);
+}
+
+
+//--------------------------------------------------------------------------;
+//
+//  DWORD gsm610DecodeBatch
+//
+//  Description:
+//	Decodes whole GSM 6.10 blocks to mono PCM on up to cThreads threads.
+//
+//  Arguments:
+//	HPBYTE hpbSrc: The GSM 6.10 blocks.
+//
+//	DWORD cBlocks: The number of blocks to decode.
+//
+//	BOOL f16Bit: TRUE to write 16-bit PCM; FALSE for 8-bit.
+//
+//	HPBYTE hpbDst: Destination for the PCM; GSM610_SAMPLESPERMONOBLOCK
+//	samples per block.
+//
+//	UINT cThreads: The most threads to use; 1 decodes serially on the
+//	calling thread.
+//
+//  Return (DWORD):
+//	The number of bytes written to hpbDst.
+//
+//--------------------------------------------------------------------------;
+
+DWORD FNGLOBAL gsm610DecodeBatch
+(
+    HPBYTE		    hpbSrc,
+    DWORD		    cBlocks,
+    BOOL		    f16Bit,
+    HPBYTE		    hpbDst,
+    UINT		    cThreads
+)
+{
+    DPF(3, "gsm610DecodeBatch: %lu blocks, %u threads.", cBlocks, cThreads);
+
+    return gsmbatchConvert(FALSE, hpbSrc, 0, cBlocks, f16Bit, hpbDst, cThreads);
+}
@@ -0,0 +1,572 @@
+//==========================================================================;
+//
+//  THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY
+//  KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR
+//  PURPOSE.
+//
+//  Copyright (c) 1992-1999 Microsoft Corporation
+//
+//--------------------------------------------------------------------------;
+//
+//  imabench.c
+//
+//  Description:
+//      Console benchmark for the IMA ADPCM conversion routines.  The
+//      codec algorithm (imaadpcm.c) is compiled straight into the program,
+//      without the ACM driver around it, so the routines can be timed and
+//      checked without installing the codec.
+//
+//      A few seconds of synthetic speech-like audio are encoded in each of
+//      the four PCM formats and decoded back, a whole buffer per call as
+//      the ACM does for a large conversion.  The program reports each
+//      conversion's throughput and how many times faster than real time it
+//      ran.  It also checks that every decode is bit-exact, both against a
+//      one-block-per-call decode and against a plain nibble-at-a-time
+//      decoder (imabenchReferenceDecode, below, which follows the codec's
+//      original decode loops), and exits with 1 if any differ.
+//
+//      Usage:  imabench [-r<rate>] [-s<seconds>] [-b<block align>] [-n<count>]
+//
+//==========================================================================;
+
+#include <windows.h>
+#include <windowsx.h>
+#include <mmsystem.h>
+#include <mmreg.h>
+#include <msacm.h>
+#include <msacmdrv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "codec.h"
+#include "imaadpcm.h"
+
+
+#define IMABENCH_DEFAULT_RATE       22050
+#define IMABENCH_DEFAULT_SECONDS    30
+#define IMABENCH_DEFAULT_COUNT      4       // timed passes per conversion
+
+
+//
+//  The conversions to time.  Decode and encode share a prototype (see
+//  STREAMCONVERTPROC in codec.h).
+//
+typedef struct tIMABENCHFORMAT
+{
+    LPCSTR                  pszName;
+    UINT                    nChannels;
+    UINT                    nBitsPerSample;
+    STREAMCONVERTPROC       fnEncode;
+    STREAMCONVERTPROC       fnDecode;
+
+} IMABENCHFORMAT;
+
+static const IMABENCHFORMAT gaFormats[] =
+{
+    { "mono 8-bit",     1,  8, imaadpcmEncode4Bit_M08, imaadpcmDecode4Bit_M08 },
+    { "mono 16-bit",    1, 16, imaadpcmEncode4Bit_M16, imaadpcmDecode4Bit_M16 },
+    { "stereo 8-bit",   2,  8, imaadpcmEncode4Bit_S08, imaadpcmDecode4Bit_S08 },
+    { "stereo 16-bit",  2, 16, imaadpcmEncode4Bit_S16, imaadpcmDecode4Bit_S16 }
+};
+
+
+static const short gaStep[89] =
+{
+        7,     8,     9,    10,    11,    12,    13,
+       14,    16,    17,    19,    21,    23,    25,
+       28,    31,    34,    37,    41,    45,    50,
+       55,    60,    66,    73,    80,    88,    97,
+      107,   118,   130,   143,   157,   173,   190,
+      209,   230,   253,   279,   307,   337,   371,
+      408,   449,   494,   544,   598,   658,   724,
+      796,   876,   963,  1060,  1166,  1282,  1411,
+     1552,  1707,  1878,  2066,  2272,  2499,  2749,
+     3024,  3327,  3660,  4026,  4428,  4871,  5358,
+     5894,  6484,  7132,  7845,  8630,  9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350,
+    22385, 24623, 27086, 29794, 32767
+};
+
+static const short gaNextStep[16] =
+{
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+
+
+//--------------------------------------------------------------------------;
+//
+//  int imabenchReferenceSample
+//
+//  Description:
+//      This routine decodes one ADPCM sample and updates the step index,
+//      exactly as the codec's original per-format decode loops did.
+//
+//  Arguments:
+//      int nEncSample:  The 4-bit encoded sample.
+//      int nPredSample:  The previous decoded sample.
+//      int *pnStepIndex:  The step index; updated.
+//
+//  Return (int):  The decoded sample.
+//
+//--------------------------------------------------------------------------;
+
+static int imabenchReferenceSample
+(
+    int                     nEncSample,
+    int                     nPredSample,
+    int                 *   pnStepIndex
+)
+{
+    LONG                    lDifference;
+    LONG                    lNewSample;
+    int                     nStepSize;
+
+    nStepSize   = gaStep[*pnStepIndex];
+    lDifference = nStepSize>>3;
+    if (nEncSample & 4)
+        lDifference += nStepSize;
+    if (nEncSample & 2)
+        lDifference += nStepSize>>1;
+    if (nEncSample & 1)
+        lDifference += nStepSize>>2;
+    if (nEncSample & 8)
+        lDifference = -lDifference;
+
+    lNewSample = nPredSample + lDifference;
+    if( lNewSample > 32767 )
+        lNewSample = 32767;
+    else if( lNewSample < -32768 )
+        lNewSample = -32768;
+
+    *pnStepIndex += gaNextStep[nEncSample];
+    if( *pnStepIndex < 0 )
+        *pnStepIndex = 0;
+    else if( *pnStepIndex > 88 )
+        *pnStepIndex = 88;
+
+    return (int)lNewSample;
+}
+
+
+
+//--------------------------------------------------------------------------;
+//
+//  DWORD imabenchReferenceDecode
+//
+//  Description:
+//      This routine decodes a buffer of ADPCM to PCM one nibble at a time.
+//      It follows the structure of the codec's original decode routines:
+//      a short last block is decoded for mono, and stereo data is assumed
+//      to be block aligned.
+//
+//  Arguments:
+//      HPBYTE pbSrc:  The ADPCM data.
+//      DWORD cbSrcLength:  The length of the ADPCM data (in bytes).
+//      HPBYTE pbDst:  The PCM buffer.
+//      UINT nBlockAlignment:  The block alignment of the ADPCM data.
+//      UINT nChannels:  The number of channels (1 or 2).
+//      BOOL f16Bit:  TRUE for 16-bit PCM; FALSE for 8-bit.
+//
+//  Return (DWORD):  The number of bytes of PCM written, or zero if a block
+//      header is invalid.
+//
+//--------------------------------------------------------------------------;
+
+static DWORD imabenchReferenceDecode
+(
+    HPBYTE                  pbSrc,
+    DWORD                   cbSrcLength,
+    HPBYTE                  pbDst,
+    UINT                    nBlockAlignment,
+    UINT                    nChannels,
+    BOOL                    f16Bit
+)
+{
+    HPBYTE                  pbDstStart;
+    HPBYTE                  pbBlock;
+    UINT                    cbHeader;
+    UINT                    cbBlockLength;
+    UINT                    cbData;
+    UINT                    uChannel;
+    UINT                    uByte;
+    DWORD                   dwHeader;
+    BYTE                    bSample;
+    int                     anPredSample[2];
+    int                     anStepIndex[2];
+    int                     anSample[2][8];
+    int                     i;
+
+    pbDstStart = pbDst;
+    cbHeader   = IMAADPCM_HEADER_LENGTH * nChannels;
+
+    while( cbSrcLength >= cbHeader )
+    {
+        cbBlockLength  = (UINT)min(cbSrcLength, nBlockAlignment);
+        cbSrcLength   -= cbBlockLength;
+        pbBlock        = pbSrc;
+        pbSrc         += cbBlockLength;
+
+        for( uChannel=0; uChannel<nChannels; uChannel++ )
+        {
+            dwHeader = *(DWORD HUGE_T *)(pbBlock + uChannel * IMAADPCM_HEADER_LENGTH);
+            anPredSample[uChannel] = (int)(short)LOWORD(dwHeader);
+            anStepIndex[uChannel]  = (int)(BYTE)HIWORD(dwHeader);
+            if( anStepIndex[uChannel] > 88 )
+                return 0;
+        }
+        pbBlock += cbHeader;
+        cbData   = cbBlockLength - cbHeader;
+
+#define IMABENCH_PUT(n)                                                 \
+        if( f16Bit ) {                                                  \
+            *(short HUGE_T *)pbDst = (short)(n);                        \
+            pbDst += sizeof(short);                                     \
+        } else {                                                        \
+            *pbDst++ = (BYTE)(((n) >> 8) + 128);                        \
+        }
+
+        for( uChannel=0; uChannel<nChannels; uChannel++ )
+        {
+            IMABENCH_PUT(anPredSample[uChannel]);
+        }
+
+        if( 1 == nChannels )
+        {
+            for( uByte=0; uByte<cbData; uByte++ )
+            {
+                bSample = *pbBlock++;
+                anPredSample[0] = imabenchReferenceSample(bSample & 0x0F, anPredSample[0], &anStepIndex[0]);
+                IMABENCH_PUT(anPredSample[0]);
+                anPredSample[0] = imabenchReferenceSample(bSample >> 4, anPredSample[0], &anStepIndex[0]);
+                IMABENCH_PUT(anPredSample[0]);
+            }
+        }
+        else
+        {
+            for( uByte=0; uByte+8<=cbData; uByte+=8 )
+            {
+                for( uChannel=0; uChannel<2; uChannel++ )
+                {
+                    DWORD   dw = *(DWORD HUGE_T *)(pbBlock + uChannel * sizeof(DWORD));
+
+                    for( i=0; i<8; i++ )
+                    {
+                        anPredSample[uChannel] = imabenchReferenceSample((int)(dw & 0x0F), anPredSample[uChannel], &anStepIndex[uChannel]);
+                        anSample[uChannel][i]  = anPredSample[uChannel];
+                        dw >>= 4;
+                    }
+                }
+                pbBlock += 8;
+
+                for( i=0; i<8; i++ )
+                {
+                    IMABENCH_PUT(anSample[0][i]);
+                    IMABENCH_PUT(anSample[1][i]);
+                }
+            }
+        }
+
+#undef IMABENCH_PUT
+    }
+
+    return (DWORD)(pbDst - pbDstStart);
+}
+
+
+
+//--------------------------------------------------------------------------;
+//
+//  void imabenchSynthesize
+//
+//  Description:
+//      This routine fills a buffer with speech-like test audio:  a few
+//      drifting partials, amplitude modulated at a syllable rate, with a
+//      little noise.  The right channel of a stereo buffer is a slightly
+//      detuned copy of the left.
+//
+//  Arguments:
+//      short *psDst:  The buffer, 16-bit PCM.
+//      DWORD cFrames:  The number of sample frames.
+//      UINT nChannels:  The number of channels (1 or 2).
+//      UINT nSamplesPerSec:  The sample rate.
+//
+//  Return (void):
+//
+//--------------------------------------------------------------------------;
+
+static void imabenchSynthesize
+(
+    short               *   psDst,
+    DWORD                   cFrames,
+    UINT                    nChannels,
+    UINT                    nSamplesPerSec
+)
+{
+    DWORD                   dwFrame;
+    UINT                    uChannel;
+    double                  dTime;
+    double                  dPitch;
+    double                  dEnvelope;
+    double                  dSample;
+
+    srand(1);
+    for( dwFrame=0; dwFrame<cFrames; dwFrame++ )
+    {
+        for( uChannel=0; uChannel<nChannels; uChannel++ )
+        {
+            dTime     = (double)dwFrame / nSamplesPerSec;
+            dPitch    = 6.2831853 * (140.0 + 30.0 * sin(dTime * 1.7)) * (1.0 + 0.003 * uChannel);
+            dEnvelope = 0.55 + 0.45 * sin(dTime * 6.2831853 * 4.0);
+            dSample   = 0.50 * sin(dPitch * dTime)
+                      + 0.25 * sin(dPitch * dTime * 3.0)
+                      + 0.12 * sin(dPitch * dTime * 7.0);
+            dSample   = dSample * dEnvelope * 26000.0 + (rand() % 1025) - 512;
+
+            if( dSample > 32767.0 )
+                dSample = 32767.0;
+            else if( dSample < -32768.0 )
+                dSample = -32768.0;
+
+            *psDst++ = (short)dSample;
+        }
+    }
+}
+
+
+
+//--------------------------------------------------------------------------;
+//
+//  int main
+//
+//  Description:
+//      Parses the command line, then encodes and decodes the test audio
+//      in each format, timing the conversions and checking the decodes.
+//
+//  Return (int):  0 if every decode matched; 1 otherwise.
+//
+//--------------------------------------------------------------------------;
+
+int __cdecl main
+(
+    int                     argc,
+    char                *   argv[]
+)
+{
+    const IMABENCHFORMAT *  pFormat;
+    LARGE_INTEGER           liFrequency;
+    LARGE_INTEGER           liStart;
+    LARGE_INTEGER           liEnd;
+    UINT                    nSamplesPerSec  = IMABENCH_DEFAULT_RATE;
+    UINT                    cSeconds        = IMABENCH_DEFAULT_SECONDS;
+    UINT                    nBlockAlignment = 0;
+    UINT                    cPasses         = IMABENCH_DEFAULT_COUNT;
+    UINT                    nBlockAlign;
+    UINT                    cSamplesPerBlock;
+    UINT                    uFormat;
+    UINT                    uPass;
+    UINT                    cbPCMSample;
+    DWORD                   cFrames;
+    DWORD                   cBlocks;
+    DWORD                   cbPCM;
+    DWORD                   cbADPCM;
+    DWORD                   cbDecoded;
+    DWORD                   cbBlock;
+    DWORD                   cbOffset;
+    DWORD                   dwFrame;
+    short               *   psSource;
+    HPBYTE                  pbPCM;
+    HPBYTE                  pbADPCM;
+    HPBYTE                  pbDecoded;
+    HPBYTE                  pbCheck;
+    double                  dEncodeSeconds;
+    double                  dDecodeSeconds;
+    double                  dAudioSeconds;
+    int                     nStepIndexL;
+    int                     nStepIndexR;
+    int                     nResult = 0;
+    int                     i;
+
+    for( i=1; i<argc; i++ )
+    {
+        if( ('-' != argv[i][0]) && ('/' != argv[i][0]) )
+            break;
+
+        switch( argv[i][1] )
+        {
+            case 'r':   nSamplesPerSec  = atoi(&argv[i][2]);    break;
+            case 's':   cSeconds        = atoi(&argv[i][2]);    break;
+            case 'b':   nBlockAlignment = atoi(&argv[i][2]);    break;
+            case 'n':   cPasses         = atoi(&argv[i][2]);    break;
+            default:    i = argc;                               break;
+        }
+    }
+
+    if( (i != argc) || (0 == nSamplesPerSec) || (0 == cSeconds) || (0 == cPasses) )
+    {
+        printf("usage: imabench [-r<rate>] [-s<seconds>] [-b<block align>] [-n<count>]\n");
+        printf("       -b sets the mono block alignment; stereo blocks are twice as long.\n");
+        printf("       The default is the codec's own, 256 bytes per 11 kHz.\n");
+        return 2;
+    }
+
+    imaadpcmInit();
+    QueryPerformanceFrequency(&liFrequency);
+
+    printf("IMA ADPCM, %u Hz, %u seconds, %u passes\n\n", nSamplesPerSec, cSeconds, cPasses);
+    printf("%-14s %8s %12s %8s %12s %8s\n", "format", "block", "encode MB/s", "x real", "decode MB/s", "x real");
+
+    for( uFormat=0; uFormat<SIZEOF_ARRAY(gaFormats); uFormat++ )
+    {
+        pFormat = &gaFormats[uFormat];
+
+        //
+        //  Same block alignment as the codec suggests (see
+        //  imaadpcmBlockAlign() in codec.c), unless given.
+        //
+        if( 0 != nBlockAlignment )
+            nBlockAlign = nBlockAlignment * pFormat->nChannels;
+        else
+        {
+            nBlockAlign = 256 * pFormat->nChannels;
+            if( nSamplesPerSec > 11025 )
+                nBlockAlign *= nSamplesPerSec / 11000;
+        }
+
+        if( (2 == pFormat->nChannels) && (0 != (nBlockAlign - 8) % 8) )
+        {
+            printf("%-14s skipped: block alignment %u is not a whole number of DWORD pairs\n",
+                   pFormat->pszName, nBlockAlign);
+            continue;
+        }
+
+        cSamplesPerBlock = (nBlockAlign - IMAADPCM_HEADER_LENGTH * pFormat->nChannels) * 8
+                         / (IMAADPCM_BITS_PER_SAMPLE * pFormat->nChannels) + 1;
+        cBlocks          = (nSamplesPerSec * cSeconds) / cSamplesPerBlock;
+        cFrames          = cBlocks * cSamplesPerBlock;
+        cbPCMSample      = pFormat->nChannels * pFormat->nBitsPerSample / 8;
+        cbPCM            = cFrames * cbPCMSample;
+        cbADPCM          = cBlocks * nBlockAlign;
+        dAudioSeconds    = (double)cFrames / nSamplesPerSec;
+
+        psSource  = (short *)malloc(cFrames * pFormat->nChannels * sizeof(short));
+        pbPCM     = (HPBYTE)malloc(cbPCM);
+        pbADPCM   = (HPBYTE)malloc(cbADPCM);
+        pbDecoded = (HPBYTE)malloc(cbPCM);
+        pbCheck   = (HPBYTE)malloc(cbPCM);
+        if( !psSource || !pbPCM || !pbADPCM || !pbDecoded || !pbCheck )
+        {
+            printf("out of memory\n");
+            return 2;
+        }
+
+        imabenchSynthesize(psSource, cFrames, pFormat->nChannels, nSamplesPerSec);
+        if( 16 == pFormat->nBitsPerSample )
+        {
+            CopyMemory(pbPCM, psSource, cbPCM);
+        }
+        else
+        {
+            for( dwFrame=0; dwFrame<cFrames * pFormat->nChannels; dwFrame++ )
+                pbPCM[dwFrame] = (BYTE)((psSource[dwFrame] >> 8) + 128);
+        }
+
+        //
+        //  Encode.  The step index carries from one conversion to the
+        //  next, so start each pass from the same state.
+        //
+        dEncodeSeconds = 0.0;
+        for( uPass=0; uPass<cPasses; uPass++ )
+        {
+            nStepIndexL = 0;
+            nStepIndexR = 0;
+            QueryPerformanceCounter(&liStart);
+            pFormat->fnEncode(pbPCM, cbPCM, pbADPCM, nBlockAlign, cSamplesPerBlock,
+                              &nStepIndexL, &nStepIndexR);
+            QueryPerformanceCounter(&liEnd);
+            dEncodeSeconds += (double)(liEnd.QuadPart - liStart.QuadPart) / liFrequency.QuadPart;
+        }
+
+        //
+        //  Decode the whole buffer per call.
+        //
+        dDecodeSeconds = 0.0;
+        cbDecoded      = 0;
+        for( uPass=0; uPass<cPasses; uPass++ )
+        {
+            QueryPerformanceCounter(&liStart);
+            cbDecoded = pFormat->fnDecode(pbADPCM, cbADPCM, pbDecoded, nBlockAlign, cSamplesPerBlock,
+                                          &nStepIndexL, &nStepIndexR);
+            QueryPerformanceCounter(&liEnd);
+            dDecodeSeconds += (double)(liEnd.QuadPart - liStart.QuadPart) / liFrequency.QuadPart;
+        }
+
+        printf("%-14s %8u %12.1f %8.0f %12.1f %8.0f\n",
+               pFormat->pszName, nBlockAlign,
+               (double)cbPCM * cPasses / dEncodeSeconds / 1048576.0,
+               dAudioSeconds * cPasses / dEncodeSeconds,
+               (double)cbPCM * cPasses / dDecodeSeconds / 1048576.0,
+               dAudioSeconds * cPasses / dDecodeSeconds);
+
+        //
+        //  Check the decode against one block per call, and against the
+        //  reference decoder.  A mono buffer which ends in a short block
+        //  goes through the single-block path, so check that too.
+        //
+        if( cbDecoded != cbPCM )
+        {
+            printf("%-14s decoded %lu bytes, expected %lu\n", pFormat->pszName, cbDecoded, cbPCM);
+            nResult = 1;
+        }
+
+        FillMemory(pbCheck, cbPCM, 0xCC);
+        for( cbOffset=0; cbOffset<cbADPCM; cbOffset+=nBlockAlign )
+        {
+            cbBlock = pFormat->fnDecode(pbADPCM + cbOffset, nBlockAlign,
+                                        pbCheck + (cbOffset / nBlockAlign) * cSamplesPerBlock * cbPCMSample,
+                                        nBlockAlign, cSamplesPerBlock, &nStepIndexL, &nStepIndexR);
+            if( cbBlock != cSamplesPerBlock * cbPCMSample )
+                break;
+        }
+        if( (cbOffset < cbADPCM) || (0 != memcmp(pbCheck, pbDecoded, cbPCM)) )
+        {
+            printf("%-14s batched decode differs from one block per call\n", pFormat->pszName);
+            nResult = 1;
+        }
+
+        FillMemory(pbCheck, cbPCM, 0xCC);
+        cbBlock = imabenchReferenceDecode(pbADPCM, cbADPCM, pbCheck, nBlockAlign,
+                                          pFormat->nChannels, (16 == pFormat->nBitsPerSample));
+        if( (cbBlock != cbPCM) || (0 != memcmp(pbCheck, pbDecoded, cbPCM)) )
+        {
+            printf("%-14s decode differs from the reference decoder\n", pFormat->pszName);
+            nResult = 1;
+        }
+
+        if( (1 == pFormat->nChannels) && (cbADPCM > nBlockAlign) )
+        {
+            cbBlock   = cbADPCM - nBlockAlign / 2 - 1;
+            cbDecoded = pFormat->fnDecode(pbADPCM, cbBlock, pbDecoded, nBlockAlign, cSamplesPerBlock,
+                                          &nStepIndexL, &nStepIndexR);
+            if( (cbDecoded != imabenchReferenceDecode(pbADPCM, cbBlock, pbCheck, nBlockAlign,
+                                                      1, (16 == pFormat->nBitsPerSample))) ||
+                (0 != memcmp(pbCheck, pbDecoded, cbDecoded)) )
+            {
+                printf("%-14s decode of a short last block differs from the reference decoder\n",
+                       pFormat->pszName);
+                nResult = 1;
+            }
+        }
+
+        free(psSource);
+        free(pbPCM);
+        free(pbADPCM);
+        free(pbDecoded);
+        free(pbCheck);
+    }
+
+    printf("\n%s\n", (0 == nResult) ? "All decodes match." : "DECODE MISMATCH.");
+    return nResult;
+}
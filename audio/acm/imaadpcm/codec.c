@@ -2792,6 +2792,7 @@ EXTERN_C LRESULT FNEXPORT DriverProc
 #ifdef WIN32
             DbgInitialize(TRUE);
 #endif
+            imaadpcmInit();
             return(1L);
 
         //
@@ -57,6 +57,18 @@
 
 #include "debug.h"
 
+//
+//  The decoders' output stage has an SSE2 version for x86 and x64, used
+//  when the processor supports it.
+//
+#if defined(_X86_) || defined(_AMD64_)
+#define IMAADPCM_SSE2
+#include <emmintrin.h>
+#ifndef PF_XMMI64_INSTRUCTIONS_AVAILABLE
+#define PF_XMMI64_INSTRUCTIONS_AVAILABLE    10
+#endif
+#endif
+
 
 //
 //  This array is used by imaadpcmNextStepIndex to determine the next step
@@ -427,413 +439,522 @@ INLINE BOOL imaadpcmValidStepIndex
 //
 //==========================================================================;
 
+//
+//  The decoders are table driven.  For each step index and encoded
+//  sample, gaDecodeStep holds the difference that imaadpcmSampleDecode()
+//  would add to the predicted sample and the step index that
+//  imaadpcmNextStepIndex() would return, so decoding a sample takes one
+//  lookup, an add and a clamp.  The step index is kept multiplied by 16 so
+//  that the encoded sample can simply be added to it.  imaadpcmInit() fills
+//  in the table when the driver is loaded.
+//
+typedef struct tIMAADPCMDECODESTEP
+{
+    LONG                    lDifference;
+    int                     nNextStepIndex;     // times 16
+
+} IMAADPCMDECODESTEP;
+
+static IMAADPCMDECODESTEP   gaDecodeStep[89 * 16];
+
+#define imaadpcmTableDecode(nEncodedSample,nPredictedSample,nStepIndex)   \
+{                                                                       \
+    const IMAADPCMDECODESTEP *  pds;                                    \
+                                                                        \
+    pds = &gaDecodeStep[nStepIndex + nEncodedSample];                   \
+    nPredictedSample += pds->lDifference;                               \
+    if( nPredictedSample > 32767 )                                      \
+        nPredictedSample = 32767;                                       \
+    if( nPredictedSample < -32768 )                                     \
+        nPredictedSample = -32768;                                      \
+    nStepIndex = pds->nNextStepIndex;                                   \
+}
+
+
+//
+//  Blocks are independent once their headers have been read, so the
+//  decoders work on IMAADPCM_BATCH_LANES channels at a time:  four mono
+//  blocks, or both channels of two stereo blocks.  Each channel is a lane.
+//  Each sample in a lane depends on the one before it, but the lanes don't
+//  depend on each other, so decoding them in lockstep lets the processor
+//  overlap the table lookups of one lane with those of the next.
+//
+//  A pass decodes one DWORD (eight samples) from every lane into a row of
+//  a small buffer.  The output stage then converts the rows to 8-bit if
+//  need be and interleaves stereo pairs, using SSE2 on processors that
+//  have it.
+//
+typedef struct tIMAADPCMLANE
+{
+    HPBYTE                  pbSrc;          // next DWORD of encoded samples
+    HPBYTE                  pbDst;          // next output sample
+    int                     nPredSample;
+    int                     nStepIndex;     // times 16
+
+} IMAADPCMLANE;
+
+static BOOL                 gfSSE2 = FALSE;
+
+
+
 //--------------------------------------------------------------------------;
 //  
-//  DWORD imaadpcmDecode4Bit_M08
-//  DWORD imaadpcmDecode4Bit_M16
-//  DWORD imaadpcmDecode4Bit_S08
-//  DWORD imaadpcmDecode4Bit_S16
+//  VOID imaadpcmInit
 //  
 //  Description:
-//      These functions decode a buffer of data from ADPCM to PCM in the
-//      specified format.  The appropriate function is called once for each
-//      ACMDM_STREAM_CONVERT message received.  Note that since these
-//      functions must share the same prototype as the encoding functions
-//      (see acmdStreamOpen() and acmdStreamConvert() in codec.c for more
-//      details), not all the parameters are used by these routines.
+//      This routine fills in the decode table and checks whether the
+//      processor supports SSE2.  It must be called before any of the
+//      decode routines; the driver calls it on DRV_LOAD.
 //  
 //  Arguments:
-//      HPBYTE pbSrc:  Pointer to the source buffer (ADPCM data).
-//      DWORD cbSrcLength:  The length of the source buffer (in bytes).
-//      HPBYTE pbDst:  Pointer to the destination buffer (PCM data).  Note
-//                      that it is assumed that the destination buffer is
-//                      large enough to hold all the encoded data; see
-//                      acmdStreamSize() in codec.c for more details.
-//      UINT nBlockAlignment:  The block alignment of the ADPCM data (in
-//                      bytes).
-//      UINT cSamplesPerBlock:  The number of samples in each ADPCM block;
-//                      not used for decoding.
-//      int *pnStepIndexL:  Pointer to the step index value (left channel)
-//                      in the STREAMINSTANCE structure; not used for
-//                      decoding.
-//      int *pnStepIndexR:  Pointer to the step index value (right channel)
-//                      in the STREAMINSTANCE structure; not used for
-//                      decoding.
+//      None.
 //  
-//  Return (DWORD):  The number of bytes used in the destination buffer.
+//  Return (VOID):
 //  
 //--------------------------------------------------------------------------;
 
-DWORD FNGLOBAL imaadpcmDecode4Bit_M08
+VOID FNGLOBAL imaadpcmInit
 (
-    HPBYTE                  pbSrc,
-    DWORD                   cbSrcLength,
-    HPBYTE                  pbDst,
-    UINT                    nBlockAlignment,
-    UINT                    cSamplesPerBlock,
-    int                 *   pnStepIndexL,
-    int                 *   pnStepIndexR
+    VOID
 )
 {
-    HPBYTE                  pbDstStart;
-    UINT                    cbHeader;
-    UINT                    cbBlockLength;
-    BYTE                    bSample;
+    IMAADPCMDECODESTEP *    pds;
+    LONG                    lDifference;
     int                     nStepSize;
-
-    int                     nEncSample;
-    int                     nPredSample;
     int                     nStepIndex;
+    int                     nEncSample;
 
-    
-    pbDstStart = pbDst;
-    cbHeader = IMAADPCM_HEADER_LENGTH * 1;  //  1 = number of channels.
+    for( nStepIndex=0; nStepIndex<=88; nStepIndex++ )
+    {
+        nStepSize = step[nStepIndex];
 
+        for( nEncSample=0; nEncSample<16; nEncSample++ )
+        {
+            //
+            //  Same calculation as imaadpcmSampleDecode(), less the clamp,
+            //  which is done after the difference is added.
+            //
+            lDifference = nStepSize>>3;
+            if (nEncSample & 4) 
+                lDifference += nStepSize;
+            if (nEncSample & 2) 
+                lDifference += nStepSize>>1;
+            if (nEncSample & 1) 
+                lDifference += nStepSize>>2;
+            if (nEncSample & 8)
+                lDifference = -lDifference;
+
+            pds = &gaDecodeStep[(nStepIndex << 4) + nEncSample];
+            pds->lDifference    = lDifference;
+            pds->nNextStepIndex = imaadpcmNextStepIndex(nEncSample, nStepIndex) << 4;
+        }
+    }
 
-    DPF(3,"Starting imaadpcmDecode4Bit_M08().");
+#ifdef IMAADPCM_SSE2
+    gfSSE2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+#endif
 
+} // imaadpcmInit()
 
-    //
-    //
-    //
-    while (cbSrcLength >= cbHeader)
+
+
+//--------------------------------------------------------------------------;
+//  
+//  HPBYTE imaadpcmWriteSample
+//  
+//  Description:
+//      This routine writes a single decoded sample in 8-bit or 16-bit PCM.
+//  
+//  Arguments:
+//      HPBYTE pbDst:  Where to write the sample.
+//      int nSample:  The decoded sample.
+//      BOOL f16Bit:  TRUE for 16-bit output; FALSE for 8-bit.
+//  
+//  Return (HPBYTE):  The position after the sample.
+//  
+//--------------------------------------------------------------------------;
+
+INLINE HPBYTE imaadpcmWriteSample
+(
+    HPBYTE                  pbDst,
+    int                     nSample,
+    BOOL                    f16Bit
+)
+{
+    if( f16Bit )
     {
-        DWORD       dwHeader;
+        *(short HUGE_T *)pbDst = (short)nSample;
+        return pbDst + sizeof(short);
+    }
 
-        cbBlockLength  = (UINT)min(cbSrcLength, nBlockAlignment);
-        cbSrcLength   -= cbBlockLength;
-        cbBlockLength -= cbHeader;
+    *pbDst = (BYTE)((nSample >> 8) + 128);
+    return pbDst + 1;
+}
 
-        //
-        //  block header
-        //
-        dwHeader = *(DWORD HUGE_T *)pbSrc;
-        pbSrc   += sizeof(DWORD);
-        nPredSample = (int)(short)LOWORD(dwHeader);
-        nStepIndex  = (int)(BYTE)HIWORD(dwHeader);
 
-        if( !imaadpcmValidStepIndex(nStepIndex) ) {
-            //
-            //  The step index is out of range - this is considered a fatal
-            //  error as the input stream is corrupted.  We fail by returning
-            //  zero bytes converted.
-            //
-            DPF(1,"imaadpcmDecode4Bit_M08: invalid step index.");
-            return 0;
-        }
-        
 
-        //
-        //  write out first sample
-        //
-        *pbDst++ = (BYTE)((nPredSample >> 8) + 128);
+//--------------------------------------------------------------------------;
+//  
+//  void imaadpcmWriteGroups
+//  
+//  Description:
+//      This routine is the output stage for imaadpcmDecodeGroups().  It
+//      writes the eight samples decoded for each lane to the lane's output
+//      position, converting them to 8-bit PCM if necessary.  For stereo,
+//      lanes are taken in left/right pairs and the pair is interleaved to
+//      the output position of the left lane.
+//  
+//  Arguments:
+//      short asGroup[][8]:  The decoded samples, one row per lane.
+//      IMAADPCMLANE *paLane:  The lanes.
+//      UINT cLanes:  The number of lanes.
+//      UINT nChannels:  The number of channels (1 or 2).
+//      BOOL f16Bit:  TRUE for 16-bit output; FALSE for 8-bit.
+//  
+//  Return (void):
+//  
+//--------------------------------------------------------------------------;
 
+static void imaadpcmWriteGroups
+(
+    short                   asGroup[][8],
+    IMAADPCMLANE        *   paLane,
+    UINT                    cLanes,
+    UINT                    nChannels,
+    BOOL                    f16Bit
+)
+{
+    HPBYTE                  pbDst;
+    UINT                    uLane;
+    int                     i;
 
+#ifdef IMAADPCM_SSE2
+    if( gfSSE2 )
+    {
         //
+        //  8-bit output is the high byte of each sample, offset by 128.
+        //  The arithmetic shift leaves values which pack without
+        //  saturating, and flipping the top bit adds the offset.
         //
-        //
-        while (cbBlockLength--)
+        __m128i             xmmOffset = _mm_set1_epi8((char)0x80);
+        __m128i             xmmLeft;
+        __m128i             xmmRight;
+        __m128i             xmmLow;
+        __m128i             xmmHigh;
+
+        for( uLane=0; uLane<cLanes; uLane+=nChannels )
         {
-            bSample = *pbSrc++;
+            pbDst   = paLane[uLane].pbDst;
+            xmmLeft = _mm_loadu_si128((__m128i *)asGroup[uLane]);
 
-            //
-            //  sample 1
-            //
-            nEncSample  = (bSample & (BYTE)0x0F);
-            nStepSize   = step[nStepIndex];
-            nPredSample = imaadpcmSampleDecode(nEncSample, nPredSample, nStepSize);
-            nStepIndex  = imaadpcmNextStepIndex(nEncSample, nStepIndex);
+            if( 1 == nChannels )
+            {
+                if( f16Bit )
+                {
+                    _mm_storeu_si128((__m128i *)pbDst, xmmLeft);
+                    pbDst += 8 * sizeof(short);
+                }
+                else
+                {
+                    xmmLeft = _mm_srai_epi16(xmmLeft, 8);
+                    xmmLeft = _mm_xor_si128(_mm_packs_epi16(xmmLeft, xmmLeft), xmmOffset);
+                    _mm_storel_epi64((__m128i *)pbDst, xmmLeft);
+                    pbDst += 8;
+                }
+            }
+            else
+            {
+                xmmRight = _mm_loadu_si128((__m128i *)asGroup[uLane + 1]);
+                xmmLow   = _mm_unpacklo_epi16(xmmLeft, xmmRight);
+                xmmHigh  = _mm_unpackhi_epi16(xmmLeft, xmmRight);
+
+                if( f16Bit )
+                {
+                    _mm_storeu_si128((__m128i *)pbDst, xmmLow);
+                    _mm_storeu_si128((__m128i *)(pbDst + 16), xmmHigh);
+                    pbDst += 16 * sizeof(short);
+                }
+                else
+                {
+                    xmmLow  = _mm_srai_epi16(xmmLow, 8);
+                    xmmHigh = _mm_srai_epi16(xmmHigh, 8);
+                    xmmLow  = _mm_xor_si128(_mm_packs_epi16(xmmLow, xmmHigh), xmmOffset);
+                    _mm_storeu_si128((__m128i *)pbDst, xmmLow);
+                    pbDst += 16;
+                }
+            }
 
-            //
-            //  write out sample
-            //
-            *pbDst++ = (BYTE)((nPredSample >> 8) + 128);
+            paLane[uLane].pbDst = pbDst;
+        }
+        return;
+    }
+#endif
 
-            //
-            //  sample 2
-            //
-            nEncSample  = (bSample >> 4);
-            nStepSize   = step[nStepIndex];
-            nPredSample = imaadpcmSampleDecode(nEncSample, nPredSample, nStepSize);
-            nStepIndex  = imaadpcmNextStepIndex(nEncSample, nStepIndex);
+    for( uLane=0; uLane<cLanes; uLane+=nChannels )
+    {
+        pbDst = paLane[uLane].pbDst;
 
-            //
-            //  write out sample
-            //
-            *pbDst++ = (BYTE)((nPredSample >> 8) + 128);
+        for( i=0; i<8; i++ )
+        {
+            pbDst = imaadpcmWriteSample(pbDst, asGroup[uLane][i], f16Bit);
+            if( 2 == nChannels )
+                pbDst = imaadpcmWriteSample(pbDst, asGroup[uLane + 1][i], f16Bit);
         }
-    }
 
-    //
-    //  We return the number of bytes used in the destination.  This is
-    //  simply the difference in bytes from where we started.
-    //
-    return (DWORD)(pbDst - pbDstStart);
+        paLane[uLane].pbDst = pbDst;
+    }
 
-} // imaadpcmDecode4Bit_M08()
+} // imaadpcmWriteGroups()
 
 
 
 //--------------------------------------------------------------------------;
+//  
+//  void imaadpcmDecodeGroups
+//  
+//  Description:
+//      This routine decodes cGroups DWORDs of encoded samples from each
+//      lane, the lanes in lockstep.  For stereo, the DWORDs of a lane are
+//      every other DWORD of the block.  The lanes' predicted samples and
+//      step indices are kept in local arrays while decoding, so that the
+//      compiler can hold them in registers.
+//  
+//  Arguments:
+//      IMAADPCMLANE *paLane:  The lanes.
+//      UINT cLanes:  The number of lanes; at most IMAADPCM_BATCH_LANES.
+//      UINT cGroups:  The number of DWORDs to decode from each lane.
+//      UINT nChannels:  The number of channels (1 or 2).
+//      BOOL f16Bit:  TRUE for 16-bit output; FALSE for 8-bit.
+//  
+//  Return (void):
+//  
 //--------------------------------------------------------------------------;
 
-DWORD FNGLOBAL imaadpcmDecode4Bit_M16
+static void imaadpcmDecodeGroups
 (
-    HPBYTE                  pbSrc,
-    DWORD                   cbSrcLength,
-    HPBYTE                  pbDst,
-    UINT                    nBlockAlignment,
-    UINT                    cSamplesPerBlock,
-    int                 *   pnStepIndexL,
-    int                 *   pnStepIndexR
+    IMAADPCMLANE        *   paLane,
+    UINT                    cLanes,
+    UINT                    cGroups,
+    UINT                    nChannels,
+    BOOL                    f16Bit
 )
 {
-    HPBYTE                  pbDstStart;
-    UINT                    cbHeader;
-    UINT                    cbBlockLength;
-    BYTE                    bSample;
-    int                     nStepSize;
-
+    short                   asGroup[IMAADPCM_BATCH_LANES][8];
+    DWORD                   adwData[IMAADPCM_BATCH_LANES];
+    int                     anPredSample[IMAADPCM_BATCH_LANES];
+    int                     anStepIndex[IMAADPCM_BATCH_LANES];
+    UINT                    cbStride;
+    UINT                    uLane;
     int                     nEncSample;
-    int                     nPredSample;
-    int                     nStepIndex;
-
-    
-    pbDstStart = pbDst;
-    cbHeader = IMAADPCM_HEADER_LENGTH * 1;  //  1 = number of channels.
-
+    int                     i;
 
-    DPF(3,"Starting imaadpcmDecode4Bit_M16().");
+    ASSERT( cLanes <= IMAADPCM_BATCH_LANES );
 
+    cbStride = sizeof(DWORD) * nChannels;
 
-    //
-    //
-    //
-    while (cbSrcLength >= cbHeader)
+    for( uLane=0; uLane<cLanes; uLane++ )
     {
-        DWORD       dwHeader;
-
-        cbBlockLength  = (UINT)min(cbSrcLength, nBlockAlignment);
-        cbSrcLength   -= cbBlockLength;
-        cbBlockLength -= cbHeader;
-
-        //
-        //  block header
-        //
-        dwHeader = *(DWORD HUGE_T *)pbSrc;
-        pbSrc   += sizeof(DWORD);
-        nPredSample = (int)(short)LOWORD(dwHeader);
-        nStepIndex  = (int)(BYTE)HIWORD(dwHeader);
+        anPredSample[uLane] = paLane[uLane].nPredSample;
+        anStepIndex[uLane]  = paLane[uLane].nStepIndex;
+    }
 
-        if( !imaadpcmValidStepIndex(nStepIndex) ) {
-            //
-            //  The step index is out of range - this is considered a fatal
-            //  error as the input stream is corrupted.  We fail by returning
-            //  zero bytes converted.
-            //
-            DPF(1,"imaadpcmDecode4Bit_M16: invalid step index.");
-            return 0;
+    while( cGroups-- )
+    {
+        for( uLane=0; uLane<cLanes; uLane++ )
+        {
+            adwData[uLane]       = *(DWORD HUGE_T *)paLane[uLane].pbSrc;
+            paLane[uLane].pbSrc += cbStride;
         }
-        
-
-        //
-        //  write out first sample
-        //
-        *(short HUGE_T *)pbDst = (short)nPredSample;
-        pbDst += sizeof(short);
-
 
         //
+        //  The first sample of each DWORD is in the low-order 4 bits.
         //
-        //
-        while (cbBlockLength--)
+        for( i=0; i<8; i++ )
         {
-            bSample = *pbSrc++;
-
-            //
-            //  sample 1
-            //
-            nEncSample  = (bSample & (BYTE)0x0F);
-            nStepSize   = step[nStepIndex];
-            nPredSample = imaadpcmSampleDecode(nEncSample, nPredSample, nStepSize);
-            nStepIndex  = imaadpcmNextStepIndex(nEncSample, nStepIndex);
-
-            //
-            //  write out sample
-            //
-            *(short HUGE_T *)pbDst = (short)nPredSample;
-            pbDst += sizeof(short);
-
-            //
-            //  sample 2
-            //
-            nEncSample  = (bSample >> 4);
-            nStepSize   = step[nStepIndex];
-            nPredSample = imaadpcmSampleDecode(nEncSample, nPredSample, nStepSize);
-            nStepIndex  = imaadpcmNextStepIndex(nEncSample, nStepIndex);
-
-            //
-            //  write out sample
-            //
-            *(short HUGE_T *)pbDst = (short)nPredSample;
-            pbDst += sizeof(short);
+            for( uLane=0; uLane<cLanes; uLane++ )
+            {
+                nEncSample       = (int)(adwData[uLane] & 0x0F);
+                adwData[uLane] >>= 4;
+                imaadpcmTableDecode(nEncSample, anPredSample[uLane], anStepIndex[uLane]);
+                asGroup[uLane][i] = (short)anPredSample[uLane];
+            }
         }
+
+        imaadpcmWriteGroups(asGroup, paLane, cLanes, nChannels, f16Bit);
     }
 
-    //
-    //  We return the number of bytes used in the destination.  This is
-    //  simply the difference in bytes from where we started.
-    //
-    return (DWORD)(pbDst - pbDstStart);
+    for( uLane=0; uLane<cLanes; uLane++ )
+    {
+        paLane[uLane].nPredSample = anPredSample[uLane];
+        paLane[uLane].nStepIndex  = anStepIndex[uLane];
+    }
 
-} // imaadpcmDecode4Bit_M16()
+} // imaadpcmDecodeGroups()
 
 
 
 //--------------------------------------------------------------------------;
+//  
+//  DWORD imaadpcmDecodeBlocks
+//  
+//  Description:
+//      This routine does the work for the four decode routines below.
+//      While there is a full batch of blocks left it decodes a batch at a
+//      time, then decodes the remaining blocks one at a time.  A short last
+//      block is allowed for mono data; stereo data should always be block
+//      aligned.
+//  
+//  Arguments:
+//      HPBYTE pbSrc:  Pointer to the source buffer (ADPCM data).
+//      DWORD cbSrcLength:  The length of the source buffer (in bytes).
+//      HPBYTE pbDst:  Pointer to the destination buffer (PCM data).
+//      UINT nBlockAlignment:  The block alignment of the ADPCM data (in
+//                      bytes).
+//      UINT nChannels:  The number of channels (1 or 2).
+//      BOOL f16Bit:  TRUE for 16-bit output; FALSE for 8-bit.
+//  
+//  Return (DWORD):  The number of bytes used in the destination buffer,
+//      or zero if a block header has an invalid step index.
+//  
 //--------------------------------------------------------------------------;
 
-DWORD FNGLOBAL imaadpcmDecode4Bit_S08
+static DWORD imaadpcmDecodeBlocks
 (
     HPBYTE                  pbSrc,
     DWORD                   cbSrcLength,
     HPBYTE                  pbDst,
     UINT                    nBlockAlignment,
-    UINT                    cSamplesPerBlock,
-    int                 *   pnStepIndexL,
-    int                 *   pnStepIndexR
+    UINT                    nChannels,
+    BOOL                    f16Bit
 )
 {
+    IMAADPCMLANE            aLane[IMAADPCM_BATCH_LANES];
+    IMAADPCMLANE        *   pLane;
     HPBYTE                  pbDstStart;
+    HPBYTE                  pbBlockDst;
     UINT                    cbHeader;
     UINT                    cbBlockLength;
-    int                     nStepSize;
+    UINT                    cbBlockData;
+    UINT                    cbBlockOut;
+    UINT                    cbTail;
+    UINT                    cBlocksPerBatch;
+    UINT                    cBlocks;
+    UINT                    uBlock;
+    UINT                    uChannel;
     DWORD                   dwHeader;
-    DWORD                   dwLeft;
-    DWORD                   dwRight;
-    int                     i;
-
-    int                     nEncSampleL;
-    int                     nPredSampleL;
-    int                     nStepIndexL;
-
-    int                     nEncSampleR;
-    int                     nPredSampleR;
-    int                     nStepIndexR;
+    BYTE                    bSample;
+    int                     nEncSample;
 
     
-    pbDstStart = pbDst;
-    cbHeader = IMAADPCM_HEADER_LENGTH * 2;  //  2 = number of channels.
-
-
-    DPF(3,"Starting imaadpcmDecode4Bit_S08().");
+    pbDstStart      = pbDst;
+    cbHeader        = IMAADPCM_HEADER_LENGTH * nChannels;
+    cBlocksPerBatch = IMAADPCM_BATCH_LANES / nChannels;
 
 
-    //
-    //
-    //
-    while( 0 != cbSrcLength )
+    while (cbSrcLength >= cbHeader)
     {
-        //
-        //  The data should always be block aligned.
-        //
-        ASSERT( cbSrcLength >= nBlockAlignment );
-
-        cbBlockLength  = nBlockAlignment;
-        cbSrcLength   -= cbBlockLength;
-        cbBlockLength -= cbHeader;
-
+        if( cbSrcLength / nBlockAlignment >= cBlocksPerBatch )
+        {
+            cBlocks       = cBlocksPerBatch;
+            cbBlockLength = nBlockAlignment;
+        }
+        else
+        {
+            cBlocks       = 1;
+            cbBlockLength = (UINT)min(cbSrcLength, nBlockAlignment);
+        }
 
         //
-        //  LEFT channel header
+        //  Stereo data should always be block aligned, and the data in a
+        //  block is in pairs of DWORDs, left then right.
         //
-        dwHeader = *(DWORD HUGE_T *)pbSrc;
-        pbSrc   += sizeof(DWORD);
-        nPredSampleL = (int)(short)LOWORD(dwHeader);
-        nStepIndexL  = (int)(BYTE)HIWORD(dwHeader);
-
-        if( !imaadpcmValidStepIndex(nStepIndexL) ) {
-            //
-            //  The step index is out of range - this is considered a fatal
-            //  error as the input stream is corrupted.  We fail by returning
-            //  zero bytes converted.
-            //
-            DPF(1,"imaadpcmDecode4Bit_S08: invalid step index (L).");
-            return 0;
+        cbBlockData = cbBlockLength - cbHeader;
+        if( 2 == nChannels )
+        {
+            ASSERT( cbBlockLength == nBlockAlignment );
+            ASSERT( 0 == cbBlockData%8 );
+            cbBlockData &= ~7;
         }
-        
+
         //
-        //  RIGHT channel header
+        //  Each block decodes to the sample in its header, plus two
+        //  samples for each byte of data.
         //
-        dwHeader = *(DWORD HUGE_T *)pbSrc;
-        pbSrc   += sizeof(DWORD);
-        nPredSampleR = (int)(short)LOWORD(dwHeader);
-        nStepIndexR  = (int)(BYTE)HIWORD(dwHeader);
+        cbBlockOut = (nChannels + cbBlockData * 2) * (f16Bit ? sizeof(short) : 1);
 
-        if( !imaadpcmValidStepIndex(nStepIndexR) ) {
-            //
-            //  The step index is out of range - this is considered a fatal
-            //  error as the input stream is corrupted.  We fail by returning
-            //  zero bytes converted.
-            //
-            DPF(1,"imaadpcmDecode4Bit_S08: invalid step index (R).");
-            return 0;
-        }
-        
 
         //
-        //  write out first sample
+        //  Read the block headers and write out the first sample of each
+        //  block.
         //
-        *pbDst++ = (BYTE)((nPredSampleL >> 8) + 128);
-        *pbDst++ = (BYTE)((nPredSampleR >> 8) + 128);
+        for( uBlock=0; uBlock<cBlocks; uBlock++ )
+        {
+            pbBlockDst = pbDst + uBlock * cbBlockOut;
+
+            for( uChannel=0; uChannel<nChannels; uChannel++ )
+            {
+                pLane = &aLane[uBlock * nChannels + uChannel];
+
+                dwHeader = *(DWORD HUGE_T *)(pbSrc + uBlock * nBlockAlignment
+                                                   + uChannel * IMAADPCM_HEADER_LENGTH);
+                pLane->nPredSample = (int)(short)LOWORD(dwHeader);
+                pLane->nStepIndex  = (int)(BYTE)HIWORD(dwHeader);
+
+                if( !imaadpcmValidStepIndex(pLane->nStepIndex) ) {
+                    //
+                    //  The step index is out of range - this is considered a fatal
+                    //  error as the input stream is corrupted.  We fail by returning
+                    //  zero bytes converted.
+                    //
+                    DPF(1,"imaadpcmDecodeBlocks: invalid step index.");
+                    return 0;
+                }
+
+                pLane->nStepIndex <<= 4;
+                pLane->pbSrc = pbSrc + uBlock * nBlockAlignment + cbHeader
+                                     + uChannel * sizeof(DWORD);
+
+                pbBlockDst = imaadpcmWriteSample(pbBlockDst, pLane->nPredSample, f16Bit);
+            }
+
+            aLane[uBlock * nChannels].pbDst = pbBlockDst;
+        }
 
 
         //
-        //  The first DWORD contains 4 left samples, the second DWORD
-        //  contains 4 right samples.  We process the source in 8-byte
-        //  chunks to make it easy to interleave the output correctly.
+        //  Decode the whole DWORDs of every lane together.  A mono block
+        //  may end in a few more bytes; decode those a lane at a time.
         //
-        ASSERT( 0 == cbBlockLength%8 );
-        while( 0 != cbBlockLength )
-        {
-            cbBlockLength -= 8;
-
-            dwLeft   = *(DWORD HUGE_T *)pbSrc;
-            pbSrc   += sizeof(DWORD);
-            dwRight  = *(DWORD HUGE_T *)pbSrc;
-            pbSrc   += sizeof(DWORD);
+        imaadpcmDecodeGroups(aLane, cBlocks * nChannels,
+                             cbBlockData / (sizeof(DWORD) * nChannels),
+                             nChannels, f16Bit);
 
-            for( i=8; i>0; i-- )
+        cbTail = cbBlockData % (sizeof(DWORD) * nChannels);
+        if( 0 != cbTail )
+        {
+            for( uBlock=0; uBlock<cBlocks; uBlock++ )
             {
-                //
-                //  LEFT channel
-                //
-                nEncSampleL  = (dwLeft & 0x0F);
-                nStepSize    = step[nStepIndexL];
-                nPredSampleL = imaadpcmSampleDecode(nEncSampleL, nPredSampleL, nStepSize);
-                nStepIndexL  = imaadpcmNextStepIndex(nEncSampleL, nStepIndexL);
+                UINT    cb;
 
-                //
-                //  RIGHT channel
-                //
-                nEncSampleR  = (dwRight & 0x0F);
-                nStepSize    = step[nStepIndexR];
-                nPredSampleR = imaadpcmSampleDecode(nEncSampleR, nPredSampleR, nStepSize);
-                nStepIndexR  = imaadpcmNextStepIndex(nEncSampleR, nStepIndexR);
+                pLane = &aLane[uBlock];
+                for( cb=cbTail; cb>0; cb-- )
+                {
+                    bSample = *pLane->pbSrc++;
 
-                //
-                //  write out sample
-                //
-                *pbDst++ = (BYTE)((nPredSampleL >> 8) + 128);
-                *pbDst++ = (BYTE)((nPredSampleR >> 8) + 128);
+                    nEncSample = (bSample & (BYTE)0x0F);
+                    imaadpcmTableDecode(nEncSample, pLane->nPredSample, pLane->nStepIndex);
+                    pLane->pbDst = imaadpcmWriteSample(pLane->pbDst, pLane->nPredSample, f16Bit);
 
-                //
-                //  Shift the next input sample into the low-order 4 bits.
-                //
-                dwLeft  >>= 4;
-                dwRight >>= 4;
+                    nEncSample = (bSample >> 4);
+                    imaadpcmTableDecode(nEncSample, pLane->nPredSample, pLane->nStepIndex);
+                    pLane->pbDst = imaadpcmWriteSample(pLane->pbDst, pLane->nPredSample, f16Bit);
+                }
             }
         }
+
+        pbSrc       += cBlocks * cbBlockLength;
+        cbSrcLength -= cBlocks * cbBlockLength;
+        pbDst       += cBlocks * cbBlockOut;
     }
 
     //
@@ -842,14 +963,49 @@ DWORD FNGLOBAL imaadpcmDecode4Bit_S08
     //
     return (DWORD)(pbDst - pbDstStart);
 
-} // imaadpcmDecode4Bit_S08()
+} // imaadpcmDecodeBlocks()
 
 
 
 //--------------------------------------------------------------------------;
+//  
+//  DWORD imaadpcmDecode4Bit_M08
+//  DWORD imaadpcmDecode4Bit_M16
+//  DWORD imaadpcmDecode4Bit_S08
+//  DWORD imaadpcmDecode4Bit_S16
+//  
+//  Description:
+//      These functions decode a buffer of data from ADPCM to PCM in the
+//      specified format.  The appropriate function is called once for each
+//      ACMDM_STREAM_CONVERT message received.  Note that since these
+//      functions must share the same prototype as the encoding functions
+//      (see acmdStreamOpen() and acmdStreamConvert() in codec.c for more
+//      details), not all the parameters are used by these routines.
+//      All four hand the work to imaadpcmDecodeBlocks().
+//  
+//  Arguments:
+//      HPBYTE pbSrc:  Pointer to the source buffer (ADPCM data).
+//      DWORD cbSrcLength:  The length of the source buffer (in bytes).
+//      HPBYTE pbDst:  Pointer to the destination buffer (PCM data).  Note
+//                      that it is assumed that the destination buffer is
+//                      large enough to hold all the encoded data; see
+//                      acmdStreamSize() in codec.c for more details.
+//      UINT nBlockAlignment:  The block alignment of the ADPCM data (in
+//                      bytes).
+//      UINT cSamplesPerBlock:  The number of samples in each ADPCM block;
+//                      not used for decoding.
+//      int *pnStepIndexL:  Pointer to the step index value (left channel)
+//                      in the STREAMINSTANCE structure; not used for
+//                      decoding.
+//      int *pnStepIndexR:  Pointer to the step index value (right channel)
+//                      in the STREAMINSTANCE structure; not used for
+//                      decoding.
+//  
+//  Return (DWORD):  The number of bytes used in the destination buffer.
+//  
 //--------------------------------------------------------------------------;
 
-DWORD FNGLOBAL imaadpcmDecode4Bit_S16
+DWORD FNGLOBAL imaadpcmDecode4Bit_M08
 (
     HPBYTE                  pbSrc,
     DWORD                   cbSrcLength,
@@ -860,143 +1016,75 @@ DWORD FNGLOBAL imaadpcmDecode4Bit_S16
     int                 *   pnStepIndexR
 )
 {
-    HPBYTE                  pbDstStart;
-    UINT                    cbHeader;
-    UINT                    cbBlockLength;
-    int                     nStepSize;
-    DWORD                   dwHeader;
-    DWORD                   dwLeft;
-    DWORD                   dwRight;
-    int                     i;
-
-    int                     nEncSampleL;
-    int                     nPredSampleL;
-    int                     nStepIndexL;
-
-    int                     nEncSampleR;
-    int                     nPredSampleR;
-    int                     nStepIndexR;
+    DPF(3,"Starting imaadpcmDecode4Bit_M08().");
 
-    
-    pbDstStart = pbDst;
-    cbHeader = IMAADPCM_HEADER_LENGTH * 2;  //  2 = number of channels.
+    return imaadpcmDecodeBlocks(pbSrc, cbSrcLength, pbDst, nBlockAlignment, 1, FALSE);
 
+} // imaadpcmDecode4Bit_M08()
 
-    DPF(3,"Starting imaadpcmDecode4Bit_S16().");
 
 
-    //
-    //
-    //
-    while( 0 != cbSrcLength )
-    {
-        //
-        //  The data should always be block aligned.
-        //
-        ASSERT( cbSrcLength >= nBlockAlignment );
+//--------------------------------------------------------------------------;
+//--------------------------------------------------------------------------;
 
-        cbBlockLength  = nBlockAlignment;
-        cbSrcLength   -= cbBlockLength;
-        cbBlockLength -= cbHeader;
+DWORD FNGLOBAL imaadpcmDecode4Bit_M16
+(
+    HPBYTE                  pbSrc,
+    DWORD                   cbSrcLength,
+    HPBYTE                  pbDst,
+    UINT                    nBlockAlignment,
+    UINT                    cSamplesPerBlock,
+    int                 *   pnStepIndexL,
+    int                 *   pnStepIndexR
+)
+{
+    DPF(3,"Starting imaadpcmDecode4Bit_M16().");
 
+    return imaadpcmDecodeBlocks(pbSrc, cbSrcLength, pbDst, nBlockAlignment, 1, TRUE);
 
-        //
-        //  LEFT channel header
-        //
-        dwHeader = *(DWORD HUGE_T *)pbSrc;
-        pbSrc   += sizeof(DWORD);
-        nPredSampleL = (int)(short)LOWORD(dwHeader);
-        nStepIndexL  = (int)(BYTE)HIWORD(dwHeader);
+} // imaadpcmDecode4Bit_M16()
 
-        if( !imaadpcmValidStepIndex(nStepIndexL) ) {
-            //
-            //  The step index is out of range - this is considered a fatal
-            //  error as the input stream is corrupted.  We fail by returning
-            //  zero bytes converted.
-            //
-            DPF(1,"imaadpcmDecode4Bit_S16: invalid step index %u (L).", nStepIndexL);
-            return 0;
-        }
-        
-        //
-        //  RIGHT channel header
-        //
-        dwHeader = *(DWORD HUGE_T *)pbSrc;
-        pbSrc   += sizeof(DWORD);
-        nPredSampleR = (int)(short)LOWORD(dwHeader);
-        nStepIndexR  = (int)(BYTE)HIWORD(dwHeader);
 
-        if( !imaadpcmValidStepIndex(nStepIndexR) ) {
-            //
-            //  The step index is out of range - this is considered a fatal
-            //  error as the input stream is corrupted.  We fail by returning
-            //  zero bytes converted.
-            //
-            DPF(1,"imaadpcmDecode4Bit_S16: invalid step index %u (R).",nStepIndexR);
-            return 0;
-        }
-        
 
-        //
-        //  write out first sample
-        //
-        *(DWORD HUGE_T *)pbDst = MAKELONG(nPredSampleL, nPredSampleR);
-        pbDst += sizeof(DWORD);
+//--------------------------------------------------------------------------;
+//--------------------------------------------------------------------------;
 
+DWORD FNGLOBAL imaadpcmDecode4Bit_S08
+(
+    HPBYTE                  pbSrc,
+    DWORD                   cbSrcLength,
+    HPBYTE                  pbDst,
+    UINT                    nBlockAlignment,
+    UINT                    cSamplesPerBlock,
+    int                 *   pnStepIndexL,
+    int                 *   pnStepIndexR
+)
+{
+    DPF(3,"Starting imaadpcmDecode4Bit_S08().");
 
-        //
-        //  The first DWORD contains 4 left samples, the second DWORD
-        //  contains 4 right samples.  We process the source in 8-byte
-        //  chunks to make it easy to interleave the output correctly.
-        //
-        ASSERT( 0 == cbBlockLength%8 );
-        while( 0 != cbBlockLength )
-        {
-            cbBlockLength -= 8;
+    return imaadpcmDecodeBlocks(pbSrc, cbSrcLength, pbDst, nBlockAlignment, 2, FALSE);
 
-            dwLeft   = *(DWORD HUGE_T *)pbSrc;
-            pbSrc   += sizeof(DWORD);
-            dwRight  = *(DWORD HUGE_T *)pbSrc;
-            pbSrc   += sizeof(DWORD);
+} // imaadpcmDecode4Bit_S08()
 
-            for( i=8; i>0; i-- )
-            {
-                //
-                //  LEFT channel
-                //
-                nEncSampleL  = (dwLeft & 0x0F);
-                nStepSize    = step[nStepIndexL];
-                nPredSampleL = imaadpcmSampleDecode(nEncSampleL, nPredSampleL, nStepSize);
-                nStepIndexL  = imaadpcmNextStepIndex(nEncSampleL, nStepIndexL);
 
-                //
-                //  RIGHT channel
-                //
-                nEncSampleR  = (dwRight & 0x0F);
-                nStepSize    = step[nStepIndexR];
-                nPredSampleR = imaadpcmSampleDecode(nEncSampleR, nPredSampleR, nStepSize);
-                nStepIndexR  = imaadpcmNextStepIndex(nEncSampleR, nStepIndexR);
 
-                //
-                //  write out sample
-                //
-                *(DWORD HUGE_T *)pbDst = MAKELONG(nPredSampleL, nPredSampleR);
-                pbDst += sizeof(DWORD);
+//--------------------------------------------------------------------------;
+//--------------------------------------------------------------------------;
 
-                //
-                //  Shift the next input sample into the low-order 4 bits.
-                //
-                dwLeft  >>= 4;
-                dwRight >>= 4;
-            }
-        }
-    }
+DWORD FNGLOBAL imaadpcmDecode4Bit_S16
+(
+    HPBYTE                  pbSrc,
+    DWORD                   cbSrcLength,
+    HPBYTE                  pbDst,
+    UINT                    nBlockAlignment,
+    UINT                    cSamplesPerBlock,
+    int                 *   pnStepIndexL,
+    int                 *   pnStepIndexR
+)
+{
+    DPF(3,"Starting imaadpcmDecode4Bit_S16().");
 
-    //
-    //  We return the number of bytes used in the destination.  This is
-    //  simply the difference in bytes from where we started.
-    //
-    return (DWORD)(pbDst - pbDstStart);
+    return imaadpcmDecodeBlocks(pbSrc, cbSrcLength, pbDst, nBlockAlignment, 2, TRUE);
 
 } // imaadpcmDecode4Bit_S16()
 
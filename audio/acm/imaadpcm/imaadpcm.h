@@ -46,6 +46,7 @@ extern "C"                          // assume C declarations for C++
 #define IMAADPCM_BITS_PER_SAMPLE    4
 #define IMAADPCM_WFX_EXTRA_BYTES    (sizeof(IMAADPCMWAVEFORMAT) - sizeof(WAVEFORMATEX))
 #define IMAADPCM_HEADER_LENGTH      4    // In bytes, per channel.
+#define IMAADPCM_BATCH_LANES        4    // Channels decoded in lockstep.
 
 #ifdef IMAADPCM_USECONFIG
 #define IMAADPCM_CONFIGTESTTIME     4   // seconds of PCM data for test.
@@ -59,6 +60,14 @@ extern "C"                          // assume C declarations for C++
 #endif
 
 
+//
+//  Decode table set-up; called once, before any conversion.
+//
+VOID FNGLOBAL imaadpcmInit
+(
+    VOID
+);
+
 //
 //  Conversion function prototypes.
 //
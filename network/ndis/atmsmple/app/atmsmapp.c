@@ -50,6 +50,7 @@ int __cdecl main(int argc, char *argv[])
 	g_ProgramOptions.dwPktSize      = DEFAULT_PKT_SIZE;
 	g_ProgramOptions.dwPktInterval  = DEFAULT_PKT_INTERVAL;
 	g_ProgramOptions.dwNumPkts      = DEFAULT_NUM_OF_PKTS;
+	g_ProgramOptions.dwPktsPerSend  = DEFAULT_PKTS_PER_SEND;
 
 
 	// parse the command line parameters
@@ -227,7 +228,8 @@ DWORD DoSendPacketsToDestinations()
 Routine Description:
 	 This routine does the sending of packets to one or more destinations.
 	 First a connect call is made to get a handle.  That handle is used for
-	 further sends.
+	 further sends.  Each send hands the driver up to dwPktsPerSend 
+	 packets in one buffer, which are completed back to us together.
 
 Arguments:
 	 NONE
@@ -236,8 +238,9 @@ Return Value:
 	 Status
 --*/
 {
-	DWORD           dw, dwSize;
+	DWORD           dw, dwSize, dwPkts;
 	PCONNECT_INFO   pCI;
+	SEND_INFO       SendInfo;
 	OVERLAPPED      Overlapped;
 	BOOL            bResult;
 	DWORD           dwReturnBytes;
@@ -324,8 +327,8 @@ Return Value:
 		printf("Successfully connected to destination(s) - Handle - 0x%p\n",
 			g_ProgramOptions.hSend);
 
-		// allocate a buffer to send 
-		dwSize = g_ProgramOptions.dwPktSize;
+		// allocate a buffer to send, big enough for a batch of packets
+		dwSize = g_ProgramOptions.dwPktSize * g_ProgramOptions.dwPktsPerSend;
 
 		pBuffer   = HeapAlloc(GetProcessHeap(), 0, dwSize);
 
@@ -338,20 +341,27 @@ Return Value:
 
 		FillPattern(pBuffer, dwSize);
 
+		SendInfo.hSend      = g_ProgramOptions.hSend;
+		SendInfo.ulPktSize  = g_ProgramOptions.dwPktSize;
+
 		// do the number of sends that were asked to do
-		for(dw = 0; dw < g_ProgramOptions.dwNumPkts; dw++)
+		for(dw = 0; dw < g_ProgramOptions.dwNumPkts; dw += dwPkts)
 		{
 
+			dwPkts = min(g_ProgramOptions.dwPktsPerSend,
+						 (g_ProgramOptions.dwNumPkts - dw));
+
 			ResetEvent(Overlapped.hEvent);
 			dwReturnBytes = 0;
 
 			bResult = DeviceIoControl(
 							 g_ProgramOptions.hDriver,
 							 (ULONG)IOCTL_SEND_TO_DSTS,
-							 &g_ProgramOptions.hSend,
-							 sizeof(HANDLE),
+							 &SendInfo,
+							 sizeof(SEND_INFO),
 							 pBuffer,	//Note! the buffer given here
-							 dwSize,	//Note! the size given here
+										//Note! the size given here
+							 (dwPkts * g_ProgramOptions.dwPktSize),
 							 &dwReturnBytes,
 							 &Overlapped);
 
@@ -382,7 +392,11 @@ Return Value:
 					break;
 				}
 
-				printf("Successfully send packet number %u\n", dw+1);
+				if(1 == dwPkts)
+					printf("Successfully send packet number %u\n", dw+1);
+				else
+					printf("Successfully send packets %u - %u\n", dw+1, 
+						dw+dwPkts);
 
 				Sleep(g_ProgramOptions.dwPktInterval);
 			}
@@ -674,10 +688,13 @@ void Usage()
 		"         /INTVL:100          -   Time interval between sends"
 		" (millisec).\n"
 		"         /SIZE:512           -   Packet Size (bytes).\n"
-		"         /NUMPKTS:10         -   No. of packets to send.\n\n"
+		"         /NUMPKTS:10         -   No. of packets to send.\n"
+		"         /BATCH:1            -   Packets handed down per send"
+		" (max %u).\n\n"
 
 		"    For RECV:\n"
-		"         /RECV               -   Receive pkts on the adapter\n\n");
+		"         /RECV               -   Receive pkts on the adapter\n\n",
+		MAX_PKTS_PER_SEND_TO_DSTS);
 
 	printf( " Example:\n\n"
 
@@ -711,7 +728,8 @@ void Usage()
 #define PKT_SIZE_OPT            108
 #define NUM_PKTS_OPT            109
 #define PMP_CONNECTION          110
-#define UNKNOWN_OPTION          111
+#define PKTS_PER_SEND_OPT       111
+#define UNKNOWN_OPTION          112
 
 struct _CmdOptions
 {
@@ -728,6 +746,7 @@ struct _CmdOptions
 	{_T("/SIZE:")        , PKT_SIZE_OPT},
 	{_T("/NUMPKTS:")     , NUM_PKTS_OPT},
 	{_T("/PMP")          , PMP_CONNECTION},
+	{_T("/BATCH:")       , PKTS_PER_SEND_OPT},
 };
 
 INT iCmdOptionsCounts = sizeof(CmdOptions)/sizeof(struct _CmdOptions);
@@ -819,6 +838,14 @@ Return Value:
 				g_ProgramOptions.fPMP = TRUE;
 				break;
 
+			case PKTS_PER_SEND_OPT:
+				g_ProgramOptions.dwPktsPerSend = atol(pVal);
+				if(0 == g_ProgramOptions.dwPktsPerSend)
+					g_ProgramOptions.dwPktsPerSend = 1;
+				if(g_ProgramOptions.dwPktsPerSend > MAX_PKTS_PER_SEND_TO_DSTS)
+					g_ProgramOptions.dwPktsPerSend = MAX_PKTS_PER_SEND_TO_DSTS;
+				break;
+
 			default:
 				printf("Unknown switch - %s\n", argv[iIndx]);
 				return FALSE;
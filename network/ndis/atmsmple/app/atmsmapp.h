@@ -38,6 +38,7 @@ typedef struct  _ProgramOptions {
     DWORD       dwPktSize;          // Send Pkts Size
     DWORD       dwPktInterval;      // Send Pkt Interval
     DWORD       dwNumPkts;          // Send Number of Pkts
+    DWORD       dwPktsPerSend;      // Send Pkts handed down per IOCTL
     DWORD       dwNumDsts;          // Send to destinations
     HANDLE      hDriver;            // Handle - to the driver
     HANDLE      hReceive;           // Handle - open for recv
@@ -60,6 +61,7 @@ typedef struct  _ProgramOptions {
 
 #define DEFAULT_PKT_INTERVAL    10      // millisecs
 #define DEFAULT_NUM_OF_PKTS     10
+#define DEFAULT_PKTS_PER_SEND   1
 
 #define MAX_BYTE_VALUE          0xFF
 
@@ -32,6 +32,7 @@ Revision History:
 
 #define MAX_FREE_PKTS_TO_KEEP       512
 #define MAX_PKTS_AT_ONCE_ON_TIMER   25
+#define MAX_PKTS_PER_SEND           MAX_PKTS_PER_SEND_TO_DSTS
 #define DEFAULT_TIMER_INTERVAL      MIN_DELAY       // in millisec
 
 
@@ -373,6 +374,19 @@ typedef struct _ProtRsvd
 #define GET_PROTO_RSVD(pPkt)    \
                     ((PPROTO_RSVD)(pPkt->ProtocolReserved))
 
+//
+// A send Irp may be split into several packets. The Irp is completed
+// once, when the last of its packets is completed by the miniport.
+// While the Irp is pending with us, its DriverContext holds the number
+// of packets outstanding, the bytes sent so far and the first failure.
+//
+#define SEND_IRP_PKTS_PENDING(pIrp)     \
+                    (*(PLONG)&(pIrp)->Tail.Overlay.DriverContext[0])
+#define SEND_IRP_BYTES_SENT(pIrp)       \
+                    (*(PLONG)&(pIrp)->Tail.Overlay.DriverContext[1])
+#define SEND_IRP_STATUS(pIrp)           \
+                    (*(PLONG)&(pIrp)->Tail.Overlay.DriverContext[2])
+
 //
 // Some global data
 //
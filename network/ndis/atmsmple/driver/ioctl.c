@@ -871,8 +871,11 @@ NTSTATUS AtmSmIoctlSendToDsts(
 /*++
 
 Routine Description:
-    This routine is used to send a packet to destination(s) for which we 
-    already have a connection.
+    This routine is used to send packets to destination(s) for which we 
+    already have a connection.  If the input is a SEND_INFO, the buffer
+    is split into packets of ulPktSize bytes which are all handed to the
+    VC together, else the whole buffer is sent as one packet.  The Irp
+    is completed when the last of its packets is completed.
     
     NOTE!  This uses Direct I/O for buffer to send data
 
@@ -887,6 +890,7 @@ Return Value:
    ULONG               ulInputBufLen, ulOutputBufLen;
    PATMSM_VC           pVc;
    ULONG               ulControlCode;
+   ULONG               ulPktSize, ulNumPkts;
 
    TraceIn(AtmSmIoctlSendToDsts);
 
@@ -896,7 +900,8 @@ Return Value:
 
    ulInputBufLen = pIrpSp->Parameters.DeviceIoControl.InputBufferLength;
 
-   if(sizeof(HANDLE) != ulInputBufLen)
+   if((sizeof(HANDLE) != ulInputBufLen) &&
+      (sizeof(SEND_INFO) != ulInputBufLen))
    {
       DbgErr(("Input buffer length is invalid!\n"));
       ASSERT(FALSE);
@@ -916,6 +921,29 @@ Return Value:
 
    DbgLoud(("Send - Output buffer length = %u\n", ulOutputBufLen));
 
+   ulPktSize = ulOutputBufLen;
+
+   if(sizeof(SEND_INFO) == ulInputBufLen)
+   {
+      PSEND_INFO  pSendInfo = (PSEND_INFO)pIrp->AssociatedIrp.SystemBuffer;
+
+      if((0 != pSendInfo->ulPktSize) && 
+         (pSendInfo->ulPktSize < ulOutputBufLen))
+         ulPktSize = pSendInfo->ulPktSize;
+   }
+
+   ulNumPkts = (ulOutputBufLen + ulPktSize - 1) / ulPktSize;
+
+   if(MAX_PKTS_PER_SEND < ulNumPkts)
+   {
+      DbgErr(("Send - Too many packets in one send - %u\n", ulNumPkts));
+      TraceOut(AtmSmIoctlSendToDsts);
+      return STATUS_INVALID_PARAMETER;
+   }
+
+   DbgLoud(("Send - %u packet(s) of %u bytes\n", ulNumPkts, ulPktSize));
+
+   // the handle is the first field of a SEND_INFO as well
    pVc  = (PATMSM_VC)(*(PHANDLE)(pIrp->AssociatedIrp.SystemBuffer));
 
    DbgLoud(("Connect Context is 0x%x\n", pVc));
@@ -935,72 +963,117 @@ Return Value:
    { // break off loop
 
       PNDIS_PACKET        pPacket;
+      PNDIS_PACKET        pPktList = NULL, pLastPkt = NULL;
+      PNDIS_BUFFER        pBuffer;
       PATMSM_ADAPTER      pAdapt = pVc->pAdapt;
-      //
-      //  Try to get a packet 
-      //
+      PUCHAR              pSrcVA = NULL;
+      ULONG               ul, ulOffset, ulBytes;
 
-      NdisAllocatePacket(
-         &Status,
-         &pPacket,
-         pAdapt->PacketPoolHandle
-         );
+#ifndef BUG_IN_NEW_DMA
+      // a single packet can go down with the Irp's Mdl, else each
+      // packet gets its own buffer descriptor over part of the data
+      if(1 < ulNumPkts)
+#endif  // BUG_IN_NEW_DMA
+      {
+         pSrcVA = MmGetSystemAddressForMdl(pIrp->MdlAddress);
 
-      if(NDIS_STATUS_SUCCESS != Status)
+         if(NULL == pSrcVA)
+         {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            break;
+         }
+      }
+
+      for(ul = 0, ulOffset = 0; ul < ulNumPkts; ul++, ulOffset += ulBytes)
       {
+         ulBytes = min(ulPktSize, (ulOutputBufLen - ulOffset));
 
          //
-         //  No free packets
+         //  Try to get a packet 
          //
-         Status = STATUS_UNSUCCESSFUL;
-         break;
-      }
-
-      (GET_PROTO_RSVD(pPacket))->pSendIrp=pIrp;
 
-#ifdef BUG_IN_NEW_DMA
-
-      {
-         PNDIS_BUFFER    pBuffer;
-         PVOID           pSrcVA    = 
-            MmGetSystemAddressForMdl(pIrp->MdlAddress);
-         UINT            uiBufSize = 
-            MmGetMdlByteCount(pIrp->MdlAddress);
-
-         // allocate the Buffer Descriptor
-         NdisAllocateBuffer(&Status,
-            &pBuffer,
-            pAdapt->BufferPoolHandle,
-            pSrcVA,
-            uiBufSize);
+         NdisAllocatePacket(
+            &Status,
+            &pPacket,
+            pAdapt->PacketPoolHandle
+            );
 
          if(NDIS_STATUS_SUCCESS != Status)
          {
-            NdisFreePacket(pPacket);
+            //
+            //  No free packets
+            //
             break;
          }
 
-         // add the buffer to the packet
-         NdisChainBufferAtFront(pPacket,
-            pBuffer);
+         if(pSrcVA)
+         {
+            // allocate the Buffer Descriptor
+            NdisAllocateBuffer(&Status,
+               &pBuffer,
+               pAdapt->BufferPoolHandle,
+               pSrcVA + ulOffset,
+               ulBytes);
+
+            if(NDIS_STATUS_SUCCESS != Status)
+            {
+               NdisFreePacket(pPacket);
+               break;
+            }
 
+            // add the buffer to the packet
+            NdisChainBufferAtFront(pPacket,
+               pBuffer);
+         }
+         else
+         {
+            //
+            //  Attach the send buffer to the packet
+            //
+            NdisChainBufferAtFront(pPacket, pIrp->MdlAddress);
+         }
+
+         (GET_PROTO_RSVD(pPacket))->pSendIrp = pIrp;
+         (GET_PROTO_RSVD(pPacket))->pPktNext = NULL;
+
+         if(pLastPkt)
+            (GET_PROTO_RSVD(pLastPkt))->pPktNext = pPacket;
+         else
+            pPktList = pPacket;
+
+         pLastPkt = pPacket;
       }
 
-#else   // BUG_IN_NEW_DMA
+      if(NDIS_STATUS_SUCCESS != Status)
+      {
+         // give back the packets we managed to build
+         while(pPktList)
+         {
+            pPacket  = pPktList;
+            pPktList = (GET_PROTO_RSVD(pPacket))->pPktNext;
+
+            NdisUnchainBufferAtFront(pPacket, &pBuffer);
 
-      //
-      //  Attach the send buffer to the packet
-      //
-      NdisChainBufferAtFront(pPacket, pIrp->MdlAddress);
+            if(pBuffer && (pBuffer != pIrp->MdlAddress))
+               NdisFreeBuffer(pBuffer);
 
-#endif  // BUG_IN_NEW_DMA
+            NdisFreePacket(pPacket);
+         }
+
+         Status = STATUS_UNSUCCESSFUL;
+         break;
+      }
+
+      SEND_IRP_PKTS_PENDING(pIrp) = (LONG)ulNumPkts;
+      SEND_IRP_BYTES_SENT(pIrp)   = 0;
+      SEND_IRP_STATUS(pIrp)       = NDIS_STATUS_SUCCESS;
 
       IoMarkIrpPending(pIrp);
 
       Status = STATUS_PENDING;
 
-      // send the packet on the VC
-      AtmSmSendPacketOnVc(pVc, pPacket);
+      // send the packets on the VC
+      AtmSmSendPacketsOnVc(pVc, pPktList, ulNumPkts);
 
    }while(FALSE);
 
@@ -379,9 +379,16 @@ AtmSmRequestComplete(
 // Prototypes in sendrecv.c
 //
 VOID
-AtmSmSendPacketOnVc(
+AtmSmSendPacketsOnVc(
     IN  PATMSM_VC               pVc,
-    IN  PNDIS_PACKET            pPacket
+    IN  PNDIS_PACKET            pPktList,
+    IN  ULONG                   ulNumPkts
+    );
+
+VOID
+AtmSmSendPacketChain(
+    IN  PATMSM_VC               pVc,
+    IN  PNDIS_PACKET            pPktList
     );
 
 VOID
@@ -29,21 +29,23 @@ Revision History:
 
 
 VOID
-AtmSmSendPacketOnVc(
+AtmSmSendPacketsOnVc(
     IN  PATMSM_VC               pVc,
-    IN  PNDIS_PACKET            pPacket
+    IN  PNDIS_PACKET            pPktList,
+    IN  ULONG                   ulNumPkts
     )
 /*++
 
 Routine Description:
 
-    Attempt to send a packet on a VC, if the VC is connecting, then
-    queue the packet on it.
+    Attempt to send a chain of packets on a VC, if the VC is connecting,
+    then queue the whole chain on it.
 
 Arguments:
 
     pVc           - Pointer to the VC
-    pPacket       - Packet to be sent
+    pPktList      - Packets to be sent, linked through pPktNext
+    ulNumPkts     - Number of packets in the chain
 
 Return Value:
 
@@ -52,19 +54,28 @@ Return Value:
 --*/
 {
     PATMSM_ADAPTER    pAdapt = pVc->pAdapt;
+    PNDIS_PACKET      pPacket;
 
-    DbgInfo(("AtmSmSendPacketOnVc: Packet %x, pVc %lx\n",
-                                                pPacket, pVc));
+    DbgInfo(("AtmSmSendPacketsOnVc: Packets %x (%u), pVc %lx\n",
+                                                pPktList, ulNumPkts, pVc));
 
 
     // if we can add a reference to the VC and if its state is active
-    // then we can send a packet on it
+    // then we can send packets on it
 
     if(!AtmSmReferenceVc(pVc)){
 
-        NDIS_SET_PACKET_STATUS(pPacket, NDIS_STATUS_CLOSING);
+        while(pPktList){
+
+            pPacket  = pPktList;
+
+            pPktList = GET_PROTO_RSVD(pPacket)->pPktNext;
 
-        AtmSmCoSendComplete(NDIS_STATUS_CLOSING, (NDIS_HANDLE)pVc, pPacket);
+            NDIS_SET_PACKET_STATUS(pPacket, NDIS_STATUS_CLOSING);
+
+            AtmSmCoSendComplete(NDIS_STATUS_CLOSING, (NDIS_HANDLE)pVc, 
+                                                                pPacket);
+        }
         
         return;
     }
@@ -72,38 +83,31 @@ Return Value:
     if(ATMSM_GET_VC_STATE(pVc) == ATMSM_VC_ACTIVE){    
 
         // we can send on the Vc
-        NDIS_SET_PACKET_STATUS(pPacket, NDIS_STATUS_SUCCESS);
-
-        NdisCoSendPackets(pVc->NdisVcHandle, &pPacket, 1);
+        AtmSmSendPacketChain(pVc, pPktList);
 
     } else {
-        // we will queue the packet on the Vc
+        // we will queue the packets on the Vc
 
-        PPROTO_RSVD     pPRsvd;
+        // find the tail of the chain before taking the lock
+        for(pPacket = pPktList; GET_PROTO_RSVD(pPacket)->pPktNext; 
+                    pPacket = GET_PROTO_RSVD(pPacket)->pPktNext)
+            ;
 
 
         ACQUIRE_ADAPTER_GEN_LOCK(pAdapt);
 
 
-        pPRsvd = GET_PROTO_RSVD(pPacket);
-
-
-        pPRsvd->pPktNext = NULL;
-
-
         if(pVc->pSendLastPkt){
 
-            pPRsvd = GET_PROTO_RSVD(pVc->pSendLastPkt);
-
-            pPRsvd->pPktNext = pPacket;
+            GET_PROTO_RSVD(pVc->pSendLastPkt)->pPktNext = pPktList;
 
         } else
-            pVc->pSendPktNext = pPacket;
+            pVc->pSendPktNext = pPktList;
 
 
         pVc->pSendLastPkt = pPacket;
 
-        pVc->ulSendPktsCount++;
+        pVc->ulSendPktsCount += ulNumPkts;
 
 
         RELEASE_ADAPTER_GEN_LOCK(pAdapt);
@@ -117,6 +121,56 @@ Return Value:
 }
 
 
+VOID
+AtmSmSendPacketChain(
+    IN  PATMSM_VC               pVc,
+    IN  PNDIS_PACKET            pPktList
+    )
+/*++
+
+Routine Description:
+
+    Hand a chain of packets to the miniport, MAX_PKTS_PER_SEND at a 
+    time, with one NdisCoSendPackets call per batch.  The caller has
+    a reference on the VC and the VC is active.
+
+Arguments:
+
+    pVc           - Pointer to the VC
+    pPktList      - Packets to be sent, linked through pPktNext
+
+Return Value:
+
+    None
+
+--*/
+{
+    PNDIS_PACKET    PacketArray[MAX_PKTS_PER_SEND];
+    ULONG           ulNumPkts;
+
+    while(pPktList){
+
+        // pick up the links before handing the packets down, the 
+        // miniport may complete them before NdisCoSendPackets returns
+        for(ulNumPkts = 0; 
+            pPktList && (ulNumPkts < MAX_PKTS_PER_SEND); 
+            ulNumPkts++){
+
+            PacketArray[ulNumPkts] = pPktList;
+
+            pPktList = GET_PROTO_RSVD(pPktList)->pPktNext;
+
+            NDIS_SET_PACKET_STATUS(PacketArray[ulNumPkts], 
+                                                NDIS_STATUS_SUCCESS);
+        }
+
+        NdisCoSendPackets(pVc->NdisVcHandle, PacketArray, ulNumPkts);
+    }
+
+    return;
+}
+
+
 VOID
 AtmSmSendQueuedPacketsOnVc(
     IN  PATMSM_VC       pVc
@@ -142,42 +196,28 @@ Return Value:
 --*/
 {
     PATMSM_ADAPTER  pAdapt = pVc->pAdapt;
-    PPROTO_RSVD     pPRsvd;
-    PNDIS_PACKET    pPacket;
+    PNDIS_PACKET    pPktList;
 
     TraceIn(AtmSmSendQueuedPacketsOnVc);
 
     ASSERT(ATMSM_GET_VC_STATE(pVc) == ATMSM_VC_ACTIVE);
 
 
+    // take the whole queue off the Vc at once
     ACQUIRE_ADAPTER_GEN_LOCK(pAdapt);
 
-    while(pVc->pSendPktNext){
+    pPktList = pVc->pSendPktNext;
 
-        pPacket = pVc->pSendPktNext;
+    pVc->pSendPktNext   = NULL;
+    pVc->pSendLastPkt   = NULL;
+    pVc->ulSendPktsCount = 0;
 
-        pPRsvd = GET_PROTO_RSVD(pPacket);
-
-        pVc->pSendPktNext = pPRsvd->pPktNext;
-
-        // this is the last packet
-        if(pVc->pSendLastPkt == pPacket)
-            pVc->pSendLastPkt = NULL;
-
-        pVc->ulSendPktsCount--;
-
-        RELEASE_ADAPTER_GEN_LOCK(pAdapt);
-
-        // we can send the packet now
-        NDIS_SET_PACKET_STATUS(pPacket, NDIS_STATUS_SUCCESS);
-
-        NdisCoSendPackets(pVc->NdisVcHandle, &pPacket, 1);
-
-        ACQUIRE_ADAPTER_GEN_LOCK(pAdapt);
-    }
+    RELEASE_ADAPTER_GEN_LOCK(pAdapt);
 
 
-    RELEASE_ADAPTER_GEN_LOCK(pAdapt);
+    // we can send the packets now
+    if(pPktList)
+        AtmSmSendPacketChain(pVc, pPktList);
 
     TraceOut(AtmSmSendQueuedPacketsOnVc);
 
@@ -194,7 +234,8 @@ AtmSmCoSendComplete(
 
 Routine Description:
 
-    Completion routine for the previously pended send. 
+    Completion routine for the previously pended send. The Irp the
+    packet was built from is completed with the last of its packets.
 
 Arguments:
 
@@ -210,6 +251,8 @@ Return Value:
     PATMSM_VC       pVc = (PATMSM_VC)ProtocolVcContext;
     PPROTO_RSVD     pPRsvd;
     PIRP            pIrp;
+    PNDIS_BUFFER    pBuffer;
+    UINT            uiPktLen;
 
     pPRsvd  = GET_PROTO_RSVD(pPacket);
 
@@ -224,36 +267,45 @@ Return Value:
 
     pIrp  = pPRsvd->pSendIrp;
 
-#ifdef BUG_IN_NEW_DMA
-
-    {
-        PNDIS_BUFFER    pBuffer;
+    ASSERT(pIrp);
 
-        NdisQueryPacket(pPacket,
-                        NULL,
-                        NULL,
-                        &pBuffer,
-                        NULL);
+    NdisQueryPacket(pPacket,
+                    NULL,
+                    NULL,
+                    &pBuffer,
+                    &uiPktLen);
 
+    // a buffer we allocated over part of the Irp's data (as opposed to
+    // the Irp's own Mdl) is ours to free
+    if(pBuffer && pIrp && (pBuffer != pIrp->MdlAddress))
         NdisFreeBuffer(pBuffer);
-    }
-
-#else   // BUG_IN_NEW_DMA
 
     NdisFreePacket(pPacket);
 
-#endif  // BUG_IN_NEW_DMA
+    if(pIrp){
 
-    ASSERT(pIrp);
+        if(NDIS_STATUS_SUCCESS == Status){
 
-    if(pIrp){
+            InterlockedExchangeAdd(&SEND_IRP_BYTES_SENT(pIrp), uiPktLen);
+
+        } else {
 
-        pIrp->IoStatus.Status = Status;
+            // remember the first failure
+            InterlockedCompareExchange(&SEND_IRP_STATUS(pIrp), 
+                                       Status, 
+                                       NDIS_STATUS_SUCCESS);
+        }
+
+        // not the last packet of this Irp
+        if(0 != InterlockedDecrement(&SEND_IRP_PKTS_PENDING(pIrp)))
+            return;
+
+        pIrp->IoStatus.Status = SEND_IRP_STATUS(pIrp);
 
         // the number of bytes we sent
-        if(NDIS_STATUS_SUCCESS == Status){
+        if(NDIS_STATUS_SUCCESS == pIrp->IoStatus.Status){
 
-            pIrp->IoStatus.Information = MmGetMdlByteCount(pIrp->MdlAddress);
+            pIrp->IoStatus.Information = SEND_IRP_BYTES_SENT(pIrp);
 
         } else {
 
@@ -154,7 +154,19 @@ typedef struct _ConnectInfo
                                FILE_READ_ACCESS  | FILE_WRITE_ACCESS)
 
 //  - IN -
-//  context obtained when the adapter was opened for sends
+//  context obtained when the adapter was opened for sends, or a
+//  SEND_INFO to have the buffer sent as several packets of ulPktSize
+//  bytes each (the last one may be shorter).  The send completes when
+//  all of its packets have been sent.
+//
+#define MAX_PKTS_PER_SEND_TO_DSTS   64
+
+typedef struct _SendInfo
+{
+   HANDLE  hSend;
+   ULONG   ulPktSize;
+}SEND_INFO, *PSEND_INFO;
+
 //  - OUT -
 //  a buffer and size that needs to be send
 
@@ -71,7 +71,7 @@ Revision History
 #define SCB_STATUS_SWI          BIT_10          // Software generated interrupt
 
 //- Interrupt ACK fields
-#define SCB_ACK_MASK      (BIT_9 | BIT_12_15)   // ACK Mask
+#define SCB_ACK_MASK      (BIT_9 | BIT_10 | BIT_12_15) // ACK Mask, SWI included
 #define SCB_ACK_CX              BIT_15          // CU Completed Action Cmd
 #define SCB_ACK_FR              BIT_14          // RU Received A Frame
 #define SCB_ACK_CNA             BIT_13          // CU Became Inactive (IDLE)
@@ -123,6 +123,14 @@ Revision History
 #define SCB_INT_MASK            BIT_0           // Mask interrupts
 #define SCB_SOFT_INT            BIT_1           // Generate a software interrupt
 
+// Specific interrupt masks (D101 and later, ignored by the 82557)
+#define SCB_FCP_INT_MASK        BIT_2           // Mask flow control pause int
+#define SCB_ER_INT_MASK         BIT_3           // Mask early receive int
+#define SCB_RNR_INT_MASK        BIT_4           // Mask RU not ready int
+#define SCB_CNA_INT_MASK        BIT_5           // Mask CU not active int
+#define SCB_FR_INT_MASK         BIT_6           // Mask frame received int
+#define SCB_CX_INT_MASK         BIT_7           // Mask CU command complete int
+
 
 //-------------------------------------------------------------------------
 // EEPROM bit definitions
@@ -461,7 +469,9 @@ typedef struct _SELF_TEST_STRUC {
 
 //-------------------------------------------------------------------------
 // Control/Status Registers (CSR)
+// (d100sim defines its own, whose SCB registers call into its model)
 //-------------------------------------------------------------------------
+#ifndef D100_HARNESS
 typedef struct _CSR_STRUC {
     USHORT      ScbStatus;              // SCB Status register
     UCHAR       ScbCommandLow;          // SCB Command register (low byte)
@@ -473,6 +483,7 @@ typedef struct _CSR_STRUC {
     ULONG       MDIControl;             // MDI Control Register
     ULONG       RxDMAByteCount;         // Receive DMA Byte count register
 } CSR_STRUC, *PCSR_STRUC;
+#endif
 
 //-------------------------------------------------------------------------
 // Error Counters
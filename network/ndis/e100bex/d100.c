@@ -600,6 +600,11 @@ D100Halt(NDIS_HANDLE MiniportAdapterContext)
     NdisMCancelTimer(&Adapter->D100AsyncResetTimer,
         &Cancelled);
 
+    // stop polling for receives
+    Adapter->RxPolling = FALSE;
+    NdisMCancelTimer(&Adapter->D100RxPollTimer,
+        &Cancelled);
+
     // Free the interrupt object
     NdisMDeregisterInterrupt(&Adapter->Interrupt);
 
@@ -943,6 +948,19 @@ D100Initialize(PNDIS_STATUS OpenErrorStatus,
         (PNDIS_TIMER_FUNCTION) D100ResetComplete,
         (PVOID) Adapter);
 
+    // ...and one to poll for receives under interrupt moderation.  The
+    // 82557 can't mask the frame received interrupt on its own, so it
+    // always takes an interrupt per event.
+    NdisMInitializeTimer(&Adapter->D100RxPollTimer,
+        Adapter->D100AdapterHandle,
+        (PNDIS_TIMER_FUNCTION) D100RxPollTimer,
+        (PVOID) Adapter);
+
+    if (Adapter->AiRevID < D101_A_STEP)
+        Adapter->IntModeration = 0;
+
+    NdisGetSystemUpTime(&Adapter->ModerationStart);
+
     // Enable board interrupts
     D100EnableInterrupt(Adapter);
 
@@ -991,6 +1009,12 @@ D100Reset(PBOOLEAN AddressingReset,
     // Disable interrupts while we re-init the transmit structures
     D100DisableInterrupt(Adapter);
 
+    // Take an interrupt per event again after the reset, the poll timer
+    // stops by itself
+    Adapter->RxPolling = FALSE;
+    Adapter->IntCauseMask = 0;
+    Adapter->ModerationFrames = 0;
+
     // The NDIS 5 support for deserialized miniports requires that
     // when reset is called, the driver de-queue and fail all uncompleted
     // sends, and complete any uncompleted sends. Essentially we must have
@@ -147,11 +147,28 @@ StartReceiveUnit(
                  IN PD100_ADAPTER Adapter
                  );
 
-BOOLEAN
+UINT
 ProcessRXInterrupt(
-                   IN PD100_ADAPTER Adapter
+                   IN PD100_ADAPTER Adapter,
+                   IN UINT Budget
                    );
 
+VOID
+D100AdjustModeration(
+                     IN PD100_ADAPTER Adapter,
+                     IN UINT Received
+                     );
+
+VOID
+D100RxPollTimer(PVOID sysspiff1,
+                NDIS_HANDLE MiniportAdapterContext,
+                PVOID sysspiff2, PVOID sysspiff3);
+
+BOOLEAN
+D100RxPollSync(
+               IN PVOID Context
+               );
+
 
 
 
@@ -265,6 +282,10 @@ PrepareForTransmit(PD100_ADAPTER Adapter,
                    PNDIS_PACKET Packet,
                    PD100SwTcb SwTcb);
 
+PNDIS_BUFFER
+SplitInlineFragments(PD100_ADAPTER Adapter,
+                     PD100SwTcb SwTcb);
+
 BOOLEAN
 AcquireCoalesceBuffer(PD100_ADAPTER Adapter,
                       PD100SwTcb SwTcb);
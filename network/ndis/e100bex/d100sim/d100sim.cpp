@@ -0,0 +1,525 @@
+/*++
+
+Copyright (c) 1990-2000  Microsoft Corporation
+
+Module Name:
+
+    d100sim.cpp
+
+Abstract:
+
+    User mode harness for the interrupt and receive path of the e100bex
+    driver. Builds interrup.c unchanged on top of the 8255x model in
+    i8255x.cpp, sets up the receive list the way SetupReceiveQueues
+    does, and plays traffic at it, servicing the interrupt line with
+    D100Isr and D100HandleInterrupt the way NDIS would and firing the
+    receive poll timer when it is due.
+
+    The adapter runs with a small RxBudget and the lowest
+    IntModerationRate, so that the DPC runs out of budget on every
+    burst and receives are polled whenever traffic is heavy. Both
+    depend on the software interrupt the driver raises to get back to
+    the frames it left on the list.
+
+    The traffic is bursts of frames, then a flood well above the
+    moderation rate, then bursts again, then nothing. Each frame is
+    checked as it is indicated, and afterwards d100sim checks that
+    every frame was indicated, in order, within the poll interval of
+    its arrival, that none was missed for want of an RFD, and that the
+    driver claimed every interrupt the adapter raised. It exits with 1
+    if not, so it can be scripted.
+
+Author:
+
+
+Environment:
+
+    User mode.
+
+Revision History:
+
+--*/
+
+#define D100_HARNESS 1
+#define new NewRmd          // d100pr.h names a parameter 'new'
+#include "..\interrup.c"
+#undef new
+
+
+#define HARNESS_RFD_PHYS        0x00100000
+
+#define DEFAULT_RX_BUDGET_LOW   16          // the lowest parse.c allows
+#define DEFAULT_MODERATION_LOW  1000        // likewise
+#define DEFAULT_NUM_RFD         32
+#define DEFAULT_POLL_INTERVAL   1
+
+#define FRAME_LENGTH            60
+#define STEP_US                 10          // harness time per step
+#define MAX_SERVICE_LOOPS       64          // interrupts serviced per step
+
+#define MAX_FRAMES              200000
+
+
+typedef struct _PHASE {
+    const char     *Name;
+    ULONG           Milliseconds;
+    ULONG           IntervalUs;             // between bursts, 0 for none
+    ULONG           Burst;                  // frames back to back
+} PHASE, *PPHASE;
+
+//
+// The bursts average 400 frames a second, under half the moderation
+// rate, and are longer than the budget; the flood is 20000 a second.
+// Each phase waits one interval before its first burst, so the frames
+// the last one left for the next poll are not piled onto it.
+//
+PHASE Phases[] = {
+    { "bursts",     600,    60000,  24 },
+    { "flood",      600,    50,     1  },
+    { "bursts",     600,    60000,  24 },
+    { "idle",       300,    0,      0  },
+};
+
+#define PHASE_COUNT     (sizeof(Phases) / sizeof(Phases[0]))
+
+
+D100_ADAPTER        Adapter;
+CSR_STRUC           Csr;
+
+PRFD_STRUC          Rfds;
+PD100SwRfd          SwRfds;
+PNDIS_PACKET        Packets;
+PNDIS_BUFFER        Buffers;
+
+ULONGLONG           Now;                    // harness time, in microseconds
+ULONGLONG           Arrival[MAX_FRAMES];
+ULONG               Sent;                   // frames put on the wire
+ULONG               Expected;               // next sequence to indicate
+
+ULONG               Indicated;
+ULONG               OutOfOrder;
+ULONG               WrongLength;
+ULONG               Unclaimed;
+ULONG               Dpcs;
+ULONGLONG           WorstLatency;
+
+ULONG               ErrorLogEntries;
+
+
+VOID
+NdisWriteErrorLogEntry(
+    IN NDIS_HANDLE          MiniportAdapterHandle,
+    IN NDIS_ERROR_CODE      ErrorCode,
+    IN ULONG                NumberOfErrorValues,
+    ...
+    )
+{
+    ErrorLogEntries++;
+}
+
+
+VOID
+D100SimSetTimer(
+    IN PNDIS_MINIPORT_TIMER Timer,
+    IN UINT                 MillisecondsToDelay
+    )
+{
+    Timer->Set = TRUE;
+    Timer->DueTime = Now + (ULONGLONG)MillisecondsToDelay * 1000;
+}
+
+
+VOID
+D100SimStall(
+    IN UINT                 MicroSeconds
+    )
+{
+    //
+    // The model accepts commands at once, so nothing is waited for
+    //
+}
+
+
+ULONG
+D100SimUpTime(
+    VOID
+    )
+{
+    return (ULONG)(Now / 1000);
+}
+
+
+VOID
+InitAndChainPacket(
+    IN OUT PD100_ADAPTER    Adapter,
+    IN OUT PD100SwRfd       SwRfdPtr
+    )
+/*++
+
+Routine Description:
+
+    As in d100.c: puts the RFD back at the end of the list, with the
+    EL bit moving to it.
+
+--*/
+{
+    PRFD_STRUC      Rfd;
+    PD100SwRfd      LastRfd;
+
+    Rfd = SwRfdPtr->Rfd;
+    Rfd->RfdCbHeader.CbStatus = 0;
+    Rfd->RfdActualCount = 0;
+    Rfd->RfdCbHeader.CbCommand = RFD_EL_BIT;
+    Rfd->RfdCbHeader.CbLinkPointer = DRIVER_NULL;
+
+    if (!QueueEmpty(&Adapter->RfdList)) {
+
+        LastRfd = (PD100SwRfd)QueueGetTail(&Adapter->RfdList);
+
+        Rfd = LastRfd->Rfd;
+        Rfd->RfdCbHeader.CbLinkPointer = SwRfdPtr->RfdPhys;
+        Rfd->RfdCbHeader.CbCommand = 0;
+    }
+
+    QueuePutTail(&Adapter->RfdList, &SwRfdPtr->Link);
+}
+
+
+BOOLEAN
+ProcessTXInterrupt(
+    IN OUT PD100_ADAPTER    Adapter
+    )
+{
+    //
+    // The harness sends nothing
+    //
+    return FALSE;
+}
+
+
+VOID
+NdisMIndicateReceivePacket(
+    IN NDIS_HANDLE          MiniportAdapterHandle,
+    IN PPNDIS_PACKET        ReceivePackets,
+    IN UINT                 NumberOfPackets
+    )
+/*++
+
+Routine Description:
+
+    The protocol: checks each frame against the one that should come
+    next, and returns the packets it may keep at once, the way
+    D100GetReturnedPackets would be called for them.
+
+--*/
+{
+    PNDIS_PACKET    Packet;
+    PD100SwRfd      SwRfd;
+    ULONG           Sequence;
+    ULONGLONG       Latency;
+    UINT            i;
+
+    for (i = 0; i < NumberOfPackets; i++) {
+
+        Packet = ReceivePackets[i];
+
+        memcpy(&Sequence, Packet->Head->VirtualAddress, sizeof(Sequence));
+
+        if (Packet->Head->Length != FRAME_LENGTH) {
+            WrongLength++;
+        }
+
+        if (Sequence != Expected || Sequence >= Sent) {
+
+            OutOfOrder++;
+
+        } else {
+
+            Latency = Now - Arrival[Sequence];
+
+            if (Latency > WorstLatency) {
+                WorstLatency = Latency;
+            }
+        }
+
+        Expected = Sequence + 1;
+        Indicated++;
+
+        if (NDIS_GET_PACKET_STATUS(Packet) != NDIS_STATUS_RESOURCES) {
+
+            SwRfd = *(D100SwRfd **)(Packet->MiniportReserved);
+
+            InitAndChainPacket(&Adapter, SwRfd);
+            --Adapter.UsedRfdCount;
+        }
+    }
+}
+
+
+BOOLEAN
+InitializeAdapter(
+    IN UINT                 NumRfd,
+    IN UINT                 RxBudget,
+    IN UINT                 ModerationRate,
+    IN UINT                 PollInterval
+    )
+/*++
+
+Routine Description:
+
+    Brings the adapter up the way D100Initialize leaves it for the
+    receive path: RFDs linked in a list ending in EL, the RU started at
+    the first one and interrupts enabled.
+
+--*/
+{
+    PRFD_STRUC      Rfd;
+    UINT            i;
+
+    Rfds = (PRFD_STRUC)calloc(NumRfd, sizeof(RFD_STRUC));
+    SwRfds = (PD100SwRfd)calloc(NumRfd, sizeof(D100SwRfd));
+    Packets = (PNDIS_PACKET)calloc(NumRfd, sizeof(NDIS_PACKET));
+    Buffers = (PNDIS_BUFFER)calloc(NumRfd, sizeof(NDIS_BUFFER));
+
+    if (Rfds == NULL || SwRfds == NULL || Packets == NULL || Buffers == NULL) {
+        return FALSE;
+    }
+
+    memset(&Adapter, 0, sizeof(Adapter));
+
+    Adapter.D100AdapterHandle = &Adapter;
+    Adapter.CSRAddress = &Csr;
+    Adapter.NumRfd = NumRfd;
+    Adapter.RxBudget = RxBudget;
+    Adapter.RxIndicateMax = MAX_ARRAY_RECEIVE_PACKETS;
+    Adapter.IntModeration = 1;
+    Adapter.IntModerationRate = ModerationRate;
+    Adapter.RxPollInterval = PollInterval;
+    Adapter.Last_RMD_used = NUM_RMD - 1;
+
+    QueueInitList(&Adapter.RfdList);
+
+    for (i = 0; i < NumRfd; i++) {
+
+        Rfd = &Rfds[i];
+
+        SwRfds[i].Rfd = Rfd;
+        SwRfds[i].RfdPhys = HARNESS_RFD_PHYS + i * sizeof(RFD_STRUC);
+
+        if (i < NumRfd - 1) {
+
+            Rfd->RfdCbHeader.CbCommand = 0;
+            Rfd->RfdCbHeader.CbLinkPointer =
+                HARNESS_RFD_PHYS + (i + 1) * sizeof(RFD_STRUC);
+
+        } else {
+
+            Rfd->RfdCbHeader.CbCommand = RFD_EL_BIT;
+            Rfd->RfdCbHeader.CbLinkPointer = DRIVER_NULL;
+        }
+
+        Rfd->RfdCbHeader.CbStatus = 0;
+        Rfd->RfdRbdPointer = DRIVER_NULL;
+        Rfd->RfdActualCount = 0;
+        Rfd->RfdSize = sizeof(ETH_RX_BUFFER_STRUC);
+
+        Buffers[i].VirtualAddress = &Rfd->RfdBuffer.RxMacHeader;
+        Buffers[i].Length = MAXIMUM_ETHERNET_PACKET_SIZE;
+
+        Packets[i].Head = &Buffers[i];
+        SwRfds[i].ReceivePacket = &Packets[i];
+        SwRfds[i].ReceiveBuffer = &Buffers[i];
+
+        *(PD100SwRfd *)Packets[i].MiniportReserved = &SwRfds[i];
+
+        QueuePutTail(&Adapter.RfdList, &SwRfds[i].Link);
+    }
+
+    I8255xInitialize(Rfds, HARNESS_RFD_PHYS, NumRfd);
+
+    StartReceiveUnit(&Adapter);
+
+    if ((Adapter.CSRAddress->ScbStatus & SCB_RUS_MASK) != SCB_RUS_READY) {
+        return FALSE;
+    }
+
+    NdisGetSystemUpTime(&Adapter.ModerationStart);
+    D100EnableInterrupt(&Adapter);
+
+    return TRUE;
+}
+
+
+VOID
+ServiceInterrupts(
+    VOID
+    )
+/*++
+
+Routine Description:
+
+    What NDIS does while the line is asserted: calls the ISR, and if
+    it asks for it the DPC, then re-enables interrupts. A line the
+    driver does not claim is counted once per step; on a real machine
+    it would keep interrupting until the OS disabled it.
+
+--*/
+{
+    BOOLEAN     Recognized;
+    BOOLEAN     QueueDpc;
+    UINT        Loops;
+
+    for (Loops = 0; Loops < MAX_SERVICE_LOOPS && I8255xInterruptPending(); Loops++) {
+
+        D100Isr(&Recognized, &QueueDpc, &Adapter);
+
+        if (!Recognized) {
+
+            Unclaimed++;
+            break;
+        }
+
+        if (QueueDpc) {
+
+            D100HandleInterrupt(&Adapter);
+            D100EnableInterrupt(&Adapter);
+
+            Dpcs++;
+        }
+    }
+}
+
+
+VOID
+RunPhase(
+    IN PPHASE               Phase
+    )
+{
+    ULONGLONG   End = Now + (ULONGLONG)Phase->Milliseconds * 1000;
+    ULONGLONG   NextBurst = Now + Phase->IntervalUs;
+    ULONG       FirstFrame = Sent;
+    ULONG       FirstIndicated = Indicated;
+    ULONG       FirstMissed = I8255xStatistics.FramesMissed;
+    ULONG       FirstSoftware = I8255xStatistics.SoftwareInterrupts;
+    ULONG       FirstDpc = Dpcs;
+    ULONG       i;
+
+    for (; Now < End; Now += STEP_US) {
+
+        if (Phase->IntervalUs != 0 && Now >= NextBurst) {
+
+            for (i = 0; i < Phase->Burst && Sent < MAX_FRAMES; i++) {
+
+                Arrival[Sent] = Now;
+
+                if (I8255xReceive(Sent, FRAME_LENGTH)) {
+                    Sent++;
+                }
+            }
+
+            NextBurst += Phase->IntervalUs;
+        }
+
+        if (Adapter.D100RxPollTimer.Set && Now >= Adapter.D100RxPollTimer.DueTime) {
+
+            Adapter.D100RxPollTimer.Set = FALSE;
+            D100RxPollTimer(NULL, &Adapter, NULL, NULL);
+        }
+
+        ServiceInterrupts();
+    }
+
+    printf("%-8s %6lu frames %6lu indicated %4lu missed %6lu DPCs "
+           "%6lu software interrupts, %s\n",
+            Phase->Name,
+            Sent - FirstFrame,
+            Indicated - FirstIndicated,
+            I8255xStatistics.FramesMissed - FirstMissed,
+            Dpcs - FirstDpc,
+            I8255xStatistics.SoftwareInterrupts - FirstSoftware,
+            Adapter.RxPolling ? "polling" : "interrupt per receive");
+}
+
+
+int
+__cdecl
+main(
+    int     argc,
+    char   *argv[]
+    )
+{
+    ULONG       numRfd = DEFAULT_NUM_RFD;
+    ULONG       rxBudget = DEFAULT_RX_BUDGET_LOW;
+    ULONG       moderationRate = DEFAULT_MODERATION_LOW;
+    ULONG       pollInterval = DEFAULT_POLL_INTERVAL;
+    ULONGLONG   latencyLimit;
+    BOOLEAN     failed;
+    ULONG       i;
+    int         arg;
+
+    for (arg = 1; arg < argc; arg++) {
+
+        if (argv[arg][0] == '-') {
+
+            switch (argv[arg][1]) {
+            case 'n': numRfd = strtoul(argv[arg] + 2, NULL, 0); continue;
+            case 'b': rxBudget = strtoul(argv[arg] + 2, NULL, 0); continue;
+            case 'm': moderationRate = strtoul(argv[arg] + 2, NULL, 0); continue;
+            case 'p': pollInterval = strtoul(argv[arg] + 2, NULL, 0); continue;
+            }
+        }
+
+        numRfd = 0;
+        break;
+    }
+
+    if (numRfd <= MIN_NUM_RFD || numRfd > MAX_RECEIVE_DESCRIPTORS
+        || rxBudget == 0 || moderationRate == 0
+        || pollInterval == 0 || pollInterval > 10) {
+
+        printf("usage: d100sim [-n<NumRfd>] [-b<RxBudget>] "
+               "[-m<IntModerationRate>] [-p<RxPollInterval>]\n");
+        return 2;
+    }
+
+    if (!InitializeAdapter(numRfd, rxBudget, moderationRate, pollInterval)) {
+        printf("d100sim: the adapter did not come up\n");
+        return 2;
+    }
+
+    printf("%lu RFDs, RxBudget %lu, IntModerationRate %lu, "
+           "RxPollInterval %lu ms\n",
+            numRfd, rxBudget, moderationRate, pollInterval);
+
+    for (i = 0; i < PHASE_COUNT; i++) {
+        RunPhase(&Phases[i]);
+    }
+
+    //
+    // Polled frames wait for the next poll, everything else is handled
+    // in the step it arrives in
+    //
+    latencyLimit = (ULONGLONG)pollInterval * 1000 + STEP_US;
+
+    printf("%lu frames, %lu indicated, %lu missed, %lu out of order, "
+           "%lu wrong length, %lu unclaimed interrupts, "
+           "worst latency %I64u us\n",
+            Sent, Indicated, I8255xStatistics.FramesMissed, OutOfOrder,
+            WrongLength, Unclaimed, WorstLatency);
+
+    failed = (BOOLEAN)(Indicated != Sent
+                    || I8255xStatistics.FramesMissed != 0
+                    || OutOfOrder != 0
+                    || WrongLength != 0
+                    || Unclaimed != 0
+                    || WorstLatency > latencyLimit
+                    || ErrorLogEntries != 0);
+
+    if (ErrorLogEntries != 0) {
+        printf("%lu error log entries\n", ErrorLogEntries);
+    }
+
+    printf("d100sim: %s\n", failed ? "FAILED" : "passed");
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,288 @@
+/*++
+
+Copyright (c) 1990-2000  Microsoft Corporation
+
+Module Name:
+
+    d100sim.h
+
+Abstract:
+
+    The NDIS definitions interrup.c needs, for building it into the
+    user mode harness, and the interface of the 8255x model
+    (i8255x.cpp).
+
+    The harness is C++ so that the SCB registers in CSR_STRUC can be
+    objects: every read and write the driver makes goes to the model,
+    which gives them the semantics of the chip. Interrupt status bits
+    are cleared by writing ones to them, the SI bit raises a software
+    interrupt and reads back as zero, and so on.
+
+Author:
+
+
+Environment:
+
+    User mode.
+
+Revision History:
+
+--*/
+
+#ifndef _D100SIM_
+#define _D100SIM_
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef DBG
+#define DBG 0
+#endif
+
+#define ASSERT(exp)
+#define DbgPrint                            printf
+#define NDIS_PAGEABLE_FUNCTION(_f)
+#define NDIS_INIT_FUNCTION(_f)
+
+
+//-------------------------------------------------------------------------
+// Status codes, handles and the other types the driver uses
+//-------------------------------------------------------------------------
+typedef LONG NTSTATUS;
+typedef int NDIS_STATUS, *PNDIS_STATUS;
+typedef PVOID NDIS_HANDLE, *PNDIS_HANDLE;
+typedef ULONG NDIS_OID, *PNDIS_OID;
+typedef ULONG NDIS_ERROR_CODE;
+typedef PVOID PDRIVER_OBJECT;
+typedef PVOID PUNICODE_STRING;
+
+#define NDIS_STATUS_SUCCESS                 ((NDIS_STATUS)0x00000000L)
+#define NDIS_STATUS_PENDING                 ((NDIS_STATUS)0x00000103L)
+#define NDIS_STATUS_RESOURCES               ((NDIS_STATUS)0xC000009AL)
+#define NDIS_STATUS_FAILURE                 ((NDIS_STATUS)0xC0000001L)
+
+#define NDIS_ERROR_CODE_TIMEOUT             0xC0001381L
+
+#define ETH_LENGTH_OF_ADDRESS               6
+
+typedef LARGE_INTEGER NDIS_PHYSICAL_ADDRESS, *PNDIS_PHYSICAL_ADDRESS;
+
+#define NDIS_PHYSICAL_ADDRESS_CONST(_Low, _High) \
+    { (ULONG)(_Low), (LONG)(_High) }
+
+typedef struct _NDIS_PHYSICAL_ADDRESS_UNIT {
+    NDIS_PHYSICAL_ADDRESS   PhysicalAddress;
+    UINT                    Length;
+} NDIS_PHYSICAL_ADDRESS_UNIT, *PNDIS_PHYSICAL_ADDRESS_UNIT;
+
+typedef enum _NDIS_MEDIUM {
+    NdisMedium802_3
+} NDIS_MEDIUM, *PNDIS_MEDIUM;
+
+typedef enum _NDIS_MEDIA_STATE {
+    NdisMediaStateConnected,
+    NdisMediaStateDisconnected
+} NDIS_MEDIA_STATE, *PNDIS_MEDIA_STATE;
+
+typedef enum _NDIS_INTERRUPT_MODE {
+    NdisInterruptLevelSensitive,
+    NdisInterruptLatched
+} NDIS_INTERRUPT_MODE, *PNDIS_INTERRUPT_MODE;
+
+typedef enum _NDIS_DEVICE_POWER_STATE {
+    NdisDeviceStateUnspecified,
+    NdisDeviceStateD0,
+    NdisDeviceStateD1,
+    NdisDeviceStateD2,
+    NdisDeviceStateD3
+} NDIS_DEVICE_POWER_STATE, *PNDIS_DEVICE_POWER_STATE;
+
+typedef struct _NDIS_MINIPORT_INTERRUPT {
+    PVOID                   Reserved;
+} NDIS_MINIPORT_INTERRUPT, *PNDIS_MINIPORT_INTERRUPT;
+
+typedef struct _NDIS_MINIPORT_TIMER {
+    BOOLEAN                 Set;
+    ULONGLONG               DueTime;        // harness time, in microseconds
+} NDIS_MINIPORT_TIMER, *PNDIS_MINIPORT_TIMER;
+
+//
+// Nothing in the harness runs concurrently with anything else
+//
+typedef struct _NDIS_SPIN_LOCK {
+    PVOID                   Reserved;
+} NDIS_SPIN_LOCK, *PNDIS_SPIN_LOCK;
+
+#define NdisAcquireSpinLock(_SpinLock)
+#define NdisReleaseSpinLock(_SpinLock)
+
+typedef BOOLEAN (*PNDIS_SYNCHRONIZE_ROUTINE)(PVOID SynchronizeContext);
+
+#define NdisMSynchronizeWithInterrupt(_Interrupt, _Routine, _Context) \
+    ((PNDIS_SYNCHRONIZE_ROUTINE)(_Routine))(_Context)
+
+#define NdisMAllocateSharedMemoryAsync(_Handle, _Length, _Cached, _Context) \
+    NDIS_STATUS_FAILURE
+
+
+//-------------------------------------------------------------------------
+// Packets have a single flat buffer
+//-------------------------------------------------------------------------
+typedef struct _NDIS_BUFFER {
+    struct _NDIS_BUFFER    *Next;
+    PVOID                   VirtualAddress;
+    UINT                    Length;
+} NDIS_BUFFER, *PNDIS_BUFFER;
+
+typedef struct _NDIS_PACKET {
+    PNDIS_BUFFER            Head;
+    NDIS_STATUS             Status;
+    UCHAR                   MiniportReserved[2 * sizeof(PVOID)];
+} NDIS_PACKET, *PNDIS_PACKET, **PPNDIS_PACKET;
+
+#define NDIS_SET_PACKET_STATUS(_Packet, _Status)    ((_Packet)->Status = (_Status))
+#define NDIS_GET_PACKET_STATUS(_Packet)             ((_Packet)->Status)
+
+#define NdisAdjustBufferLength(_Buffer, _Length)    ((_Buffer)->Length = (_Length))
+
+
+//-------------------------------------------------------------------------
+// Provided by the harness
+//-------------------------------------------------------------------------
+VOID
+NdisWriteErrorLogEntry(
+    IN NDIS_HANDLE          MiniportAdapterHandle,
+    IN NDIS_ERROR_CODE      ErrorCode,
+    IN ULONG                NumberOfErrorValues,
+    ...
+    );
+
+VOID
+NdisMIndicateReceivePacket(
+    IN NDIS_HANDLE          MiniportAdapterHandle,
+    IN PPNDIS_PACKET        ReceivePackets,
+    IN UINT                 NumberOfPackets
+    );
+
+VOID
+D100SimSetTimer(
+    IN PNDIS_MINIPORT_TIMER Timer,
+    IN UINT                 MillisecondsToDelay
+    );
+
+VOID
+D100SimStall(
+    IN UINT                 MicroSeconds
+    );
+
+ULONG
+D100SimUpTime(
+    VOID
+    );
+
+#define NdisMSetTimer(_Timer, _MillisecondsToDelay) \
+    D100SimSetTimer((_Timer), (_MillisecondsToDelay))
+
+#define NdisStallExecution(_MicroSeconds) \
+    D100SimStall(_MicroSeconds)
+
+#define NdisGetSystemUpTime(_pSystemUpTime) \
+    (*(_pSystemUpTime) = D100SimUpTime())
+
+
+//-------------------------------------------------------------------------
+// The 8255x model
+//-------------------------------------------------------------------------
+#define I8255X_SCB_STATUS           0
+#define I8255X_SCB_COMMAND_LOW      2
+#define I8255X_SCB_COMMAND_HIGH     3
+#define I8255X_SCB_GENERAL_POINTER  4
+
+typedef struct _I8255X_STATISTICS {
+    ULONG       FramesReceived;         // frames stored in an RFD
+    ULONG       FramesMissed;           // RU was not ready
+    ULONG       SoftwareInterrupts;     // writes of the SI bit
+    ULONG       ReceiveUnitStarts;      // RU start commands
+} I8255X_STATISTICS, *PI8255X_STATISTICS;
+
+extern I8255X_STATISTICS I8255xStatistics;
+
+struct _RFD_STRUC;
+
+VOID
+I8255xInitialize(
+    IN struct _RFD_STRUC   *Rfds,
+    IN ULONG                RfdPhys,
+    IN UINT                 RfdCount
+    );
+
+BOOLEAN
+I8255xReceive(
+    IN ULONG                Sequence,
+    IN UINT                 Length
+    );
+
+BOOLEAN
+I8255xInterruptPending(
+    VOID
+    );
+
+ULONG
+I8255xReadRegister(
+    IN UINT                 Register
+    );
+
+VOID
+I8255xWriteRegister(
+    IN UINT                 Register,
+    IN ULONG                Value
+    );
+
+//
+// An SCB register of the model, as the driver sees it
+//
+template <class T, UINT Register> class I8255X_REGISTER
+{
+public:
+    operator T() const
+    {
+        return (T) I8255xReadRegister(Register);
+    }
+
+    I8255X_REGISTER &operator=(T Value)
+    {
+        I8255xWriteRegister(Register, Value);
+        return *this;
+    }
+
+    I8255X_REGISTER &operator&=(T Value)
+    {
+        I8255xWriteRegister(Register, I8255xReadRegister(Register) & Value);
+        return *this;
+    }
+
+    I8255X_REGISTER &operator|=(T Value)
+    {
+        I8255xWriteRegister(Register, I8255xReadRegister(Register) | Value);
+        return *this;
+    }
+};
+
+//
+// Stands in for the one in 82557.h
+//
+typedef struct _CSR_STRUC {
+    I8255X_REGISTER<USHORT, I8255X_SCB_STATUS>          ScbStatus;
+    I8255X_REGISTER<UCHAR, I8255X_SCB_COMMAND_LOW>      ScbCommandLow;
+    I8255X_REGISTER<UCHAR, I8255X_SCB_COMMAND_HIGH>     ScbCommandHigh;
+    I8255X_REGISTER<ULONG, I8255X_SCB_GENERAL_POINTER>  ScbGeneralPointer;
+    ULONG       Port;
+    USHORT      FlashControl;
+    USHORT      EepromControl;
+    ULONG       MDIControl;
+    ULONG       RxDMAByteCount;
+} CSR_STRUC, *PCSR_STRUC;
+
+#endif // _D100SIM_
@@ -0,0 +1,294 @@
+/*++
+
+Copyright (c) 1990-2000  Microsoft Corporation
+
+Module Name:
+
+    i8255x.cpp
+
+Abstract:
+
+    Model of the parts of an 82558 the receive path of the e100bex
+    driver touches: the SCB status and command registers, the interrupt
+    line and the receive unit (RU) walking the simplified RFD list.
+
+    Interrupt causes are latched in the status word and cleared by
+    writing ones to them. The line is asserted while any cause is set
+    that is not masked, either by the M bit or by its specific mask
+    bit. The software interrupt has no specific mask. Writing the SI
+    bit sets SWI; SI itself reads back as zero.
+
+    Commands written to the low byte of the command word are accepted
+    at once, so it always reads back as zero. Only the RU start command
+    does anything; it starts the RU at the general pointer.
+
+    The RU stores each frame into the RFD it is at and raises FR. An
+    RFD with the EL bit set sends it to the no resources state with
+    RNR raised; so does arriving at the end of the list. Frames that
+    come in while the RU is not ready are missed.
+
+Author:
+
+
+Environment:
+
+    User mode.
+
+Revision History:
+
+--*/
+
+#define D100_HARNESS 1
+#define new NewRmd          // d100pr.h names a parameter 'new'
+#include "precomp.h"
+#undef new
+
+
+I8255X_STATISTICS   I8255xStatistics;
+
+static USHORT       ScbStatus;
+static UCHAR        ScbCommandHigh;
+static ULONG        ScbGeneralPointer;
+
+static PRFD_STRUC   RfdBase;
+static ULONG        RfdBasePhys;
+static UINT         RfdCount;
+static ULONG        RuPhys;             // RFD the RU will store into next
+
+
+//
+// Specific mask bit of each interrupt cause, by status bit
+//
+static const struct {
+    USHORT      Cause;
+    UCHAR       Mask;
+} CauseMasks[] = {
+    { SCB_STATUS_CX,    SCB_CX_INT_MASK  },
+    { SCB_STATUS_FR,    SCB_FR_INT_MASK  },
+    { SCB_STATUS_CNA,   SCB_CNA_INT_MASK },
+    { SCB_STATUS_RNR,   SCB_RNR_INT_MASK },
+    { SCB_STATUS_MDI,   0                },
+    { SCB_STATUS_SWI,   0                },
+    { SCB_ACK_ER,       SCB_ER_INT_MASK  },
+    { BIT_8,            SCB_FCP_INT_MASK },
+};
+
+#define CAUSE_COUNT     (sizeof(CauseMasks) / sizeof(CauseMasks[0]))
+
+
+static PRFD_STRUC
+RfdFromPhys(
+    IN ULONG                Phys
+    )
+{
+    ULONG Offset = Phys - RfdBasePhys;
+
+    if (Phys == DRIVER_NULL
+        || Phys < RfdBasePhys
+        || Offset % sizeof(RFD_STRUC) != 0
+        || Offset / sizeof(RFD_STRUC) >= RfdCount) {
+
+        return NULL;
+    }
+
+    return RfdBase + Offset / sizeof(RFD_STRUC);
+}
+
+
+static VOID
+SetRuStatus(
+    IN USHORT               Rus
+    )
+{
+    ScbStatus = (USHORT)((ScbStatus & ~SCB_RUS_MASK) | Rus);
+}
+
+
+VOID
+I8255xInitialize(
+    IN struct _RFD_STRUC   *Rfds,
+    IN ULONG                RfdPhys,
+    IN UINT                 Count
+    )
+/*++
+
+Routine Description:
+
+    Resets the model, with the receive unit idle and interrupts masked,
+    and tells it where the RFDs are.
+
+--*/
+{
+    memset(&I8255xStatistics, 0, sizeof(I8255xStatistics));
+
+    ScbStatus = SCB_RUS_IDLE | SCB_CUS_IDLE;
+    ScbCommandHigh = SCB_INT_MASK;
+    ScbGeneralPointer = 0;
+
+    RfdBase = Rfds;
+    RfdBasePhys = RfdPhys;
+    RfdCount = Count;
+    RuPhys = DRIVER_NULL;
+}
+
+
+BOOLEAN
+I8255xReceive(
+    IN ULONG                Sequence,
+    IN UINT                 Length
+    )
+/*++
+
+Routine Description:
+
+    A frame of Length bytes comes in off the wire. Its first four bytes
+    are Sequence, so the harness can tell the frames apart.
+
+Return Value:
+
+    TRUE if it was stored, FALSE if it was missed.
+
+--*/
+{
+    PRFD_STRUC Rfd;
+
+    if ((ScbStatus & SCB_RUS_MASK) != SCB_RUS_READY) {
+
+        I8255xStatistics.FramesMissed++;
+        return FALSE;
+    }
+
+    Rfd = RfdFromPhys(RuPhys);
+
+    if (Rfd == NULL || (Rfd->RfdCbHeader.CbStatus & RFD_STATUS_COMPLETE)) {
+
+        //
+        // Ran into an RFD the driver has not given back
+        //
+        SetRuStatus(SCB_RUS_NO_RESOURCES);
+        ScbStatus |= SCB_STATUS_RNR;
+
+        I8255xStatistics.FramesMissed++;
+        return FALSE;
+    }
+
+    memcpy(&Rfd->RfdBuffer, &Sequence, sizeof(Sequence));
+    Rfd->RfdActualCount = (USHORT)(Length | 0xC000);    // EOF and F
+    Rfd->RfdCbHeader.CbStatus = RFD_STATUS_COMPLETE | RFD_STATUS_OK;
+
+    ScbStatus |= SCB_STATUS_FR;
+    I8255xStatistics.FramesReceived++;
+
+    if (Rfd->RfdCbHeader.CbCommand & RFD_EL_BIT) {
+
+        SetRuStatus(SCB_RUS_NO_RESOURCES);
+        ScbStatus |= SCB_STATUS_RNR;
+
+    } else {
+
+        RuPhys = Rfd->RfdCbHeader.CbLinkPointer;
+    }
+
+    return TRUE;
+}
+
+
+BOOLEAN
+I8255xInterruptPending(
+    VOID
+    )
+/*++
+
+Routine Description:
+
+    Returns the state of the interrupt line.
+
+--*/
+{
+    UINT i;
+
+    if (ScbCommandHigh & SCB_INT_MASK) {
+        return FALSE;
+    }
+
+    for (i = 0; i < CAUSE_COUNT; i++) {
+
+        if ((ScbStatus & CauseMasks[i].Cause)
+            && !(ScbCommandHigh & CauseMasks[i].Mask)) {
+
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+
+ULONG
+I8255xReadRegister(
+    IN UINT                 Register
+    )
+{
+    switch (Register) {
+
+    case I8255X_SCB_STATUS:
+        return ScbStatus;
+
+    case I8255X_SCB_COMMAND_LOW:
+        return 0;
+
+    case I8255X_SCB_COMMAND_HIGH:
+        return ScbCommandHigh;
+
+    case I8255X_SCB_GENERAL_POINTER:
+        return ScbGeneralPointer;
+    }
+
+    return 0;
+}
+
+
+VOID
+I8255xWriteRegister(
+    IN UINT                 Register,
+    IN ULONG                Value
+    )
+{
+    switch (Register) {
+
+    case I8255X_SCB_STATUS:
+
+        //
+        // Only the interrupt causes are writable, and writing a one
+        // clears them
+        //
+        ScbStatus &= (USHORT)~(Value & 0xFF00);
+        break;
+
+    case I8255X_SCB_COMMAND_LOW:
+
+        if ((Value & SCB_RUC_MASK) == SCB_RUC_START) {
+
+            RuPhys = ScbGeneralPointer;
+            SetRuStatus(SCB_RUS_READY);
+
+            I8255xStatistics.ReceiveUnitStarts++;
+        }
+        break;
+
+    case I8255X_SCB_COMMAND_HIGH:
+
+        if (Value & SCB_SOFT_INT) {
+
+            ScbStatus |= SCB_STATUS_SWI;
+            I8255xStatistics.SoftwareInterrupts++;
+        }
+
+        ScbCommandHigh = (UCHAR)(Value & ~SCB_SOFT_INT);
+        break;
+
+    case I8255X_SCB_GENERAL_POINTER:
+        ScbGeneralPointer = Value;
+        break;
+    }
+}
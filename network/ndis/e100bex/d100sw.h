@@ -143,6 +143,21 @@ typedef struct _COALESCE {
 } COALESCE, *PCOALESCE;
 
 
+//-------------------------------------------------------------------------
+// D100_TX_COPY_STATS -- How the transmit path copied frames, returned by
+// OID_CUSTOM_TX_COPY_STATS
+//-------------------------------------------------------------------------
+typedef struct _D100_TX_COPY_STATS {
+
+    ULONG               CopyBreakFrames;        // whole frame copied into the TCB
+    ULONG               InlineFrames;           // leading fragments copied, rest mapped
+    ULONG               InlineBytes;            // bytes copied into TCBs for those
+    ULONG               CoalesceFrames;         // whole frame copied into a coalesce buffer
+    ULONG               CoalesceUnavailable;    // needed a coalesce buffer, none was free
+
+} D100_TX_COPY_STATS, *PD100_TX_COPY_STATS;
+
+
 //-------------------------------------------------------------------------
 // D100SwTcb -- Software Transmit Control Block.  This structure contains
 // all of the variables that are related to a specific Transmit Control
@@ -184,6 +199,12 @@ typedef struct _D100SwTcb {
     PCOALESCE           Coalesce;
     UINT                CoalesceBufferLen;
 
+    // Leading fragments no longer than the copy break are copied into the
+    // data area of the TCB, and sent ahead of the TBDs.  The buffers from
+    // MappedBuffer on are the ones that hold map registers.
+    UINT                InlineLength;
+    PNDIS_BUFFER        MappedBuffer;
+
     // Describes the length of the packet as sent by the protocol.
     UINT                PacketLength;
 
@@ -312,6 +333,14 @@ typedef struct _D100_ADAPTER
     // setup the timer structure used for Async Resets
     NDIS_MINIPORT_TIMER        D100AsyncResetTimer;
 
+    // Interrupt moderation.  While the receive rate is high the frame
+    // received interrupt is masked, and this timer polls for receives.
+    NDIS_MINIPORT_TIMER        D100RxPollTimer;
+    BOOLEAN             RxPolling;
+    UCHAR               IntCauseMask;   // specific masks set on interrupt enable
+    ULONG               ModerationStart;    // system up time of the sample, in ms
+    UINT                ModerationFrames;   // frames received during the sample
+
     // the pointer to the first packet we have queued in send
     // deserialized miniport support variables
     PNDIS_PACKET        FirstTxQueue;
@@ -363,6 +392,12 @@ typedef struct _D100_ADAPTER
 
     // Fields for various D100 specific parameters
     UINT                NumCoalesce;    // 'NumCoalese'
+    UINT                TxCopyBreak;    // 'TxCopyBreak'
+    UINT                RxBudget;       // 'RxBudget'
+    UINT                RxIndicateMax;  // 'RxIndicateMax'
+    UINT                IntModeration;  // 'IntModeration' (0=off, 1=adaptive)
+    UINT                IntModerationRate;  // 'IntModerationRate' (frames/sec)
+    UINT                RxPollInterval; // 'RxPollInterval' (ms)
     UINT                NumRfd;         // 'NumRfd'
     UINT                OriginalNumRfd;
     UINT                NumTbdPerTcb;   // 'NumTbdPerTcb'
@@ -445,6 +480,9 @@ typedef struct _D100_ADAPTER
     // physical mappings.
     D100_LIST_ENTRY     CoalesceBufferList;
 
+    // Transmit copy counters
+    D100_TX_COPY_STATS  TxCopyStats;
+
 
     // The Current Global Packet Filter and look ahead size.
     ULONG               PacketFilter;
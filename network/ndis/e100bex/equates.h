@@ -102,7 +102,12 @@ Revision History
 #define  MIN_NUM_RFD                            4
 #define  MAX_ARRAY_SEND_PACKETS                 8
 // limit our receive routine to indicating this many at a time
-#define  MAX_ARRAY_RECEIVE_PACKETS              16
+// (default for the 'RxIndicateMax' registry parameter)
+#define  MAX_ARRAY_RECEIVE_PACKETS              64
+// default for the 'RxBudget' registry parameter, receives per DPC
+#define  DEFAULT_RX_BUDGET                      256
+// the receive rate is sampled over this many milliseconds
+#define  MODERATION_SAMPLE_MS                   100
 #define  MAC_RESERVED_SWRFDPTR                  0
 #define  MAX_PACKETS_TO_ADD                     32
 
@@ -181,6 +186,7 @@ Revision History
 #define OID_CUSTOM_DRIVER_QUERY     0xFFA0C902
 #define OID_CUSTOM_ARRAY            0xFFA0C903
 #define OID_CUSTOM_STRING           0xFFA0C904
+#define OID_CUSTOM_TX_COPY_STATS    0xFFA0C905
 
 #endif      // _EQUATES_H
 
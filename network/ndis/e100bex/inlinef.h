@@ -116,9 +116,10 @@ D100EnableInterrupt(
 
     DEBUGCHAR(Adapter,'/');
 
-    // Enable interrupts on our PCI board by clearing the mask bit
+    // Enable interrupts on our PCI board by clearing the mask bit.  The
+    // frame received interrupt stays masked while receives are polled.
 
-    Adapter->CSRAddress->ScbCommandHigh = 0;
+    Adapter->CSRAddress->ScbCommandHigh = Adapter->IntCauseMask;
 }
 
 //-----------------------------------------------------------------------------
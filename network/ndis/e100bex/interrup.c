@@ -57,12 +57,20 @@ D100Isr(
 
 {
     PD100_ADAPTER Adapter = PD100_ADAPTER_FROM_CONTEXT_HANDLE(MiniportAdapterContext);
+    USHORT        AckPending;
+
+    // While receives are polled the frame received interrupt is masked, but
+    // its status bit is still set.  It must not make us claim an interrupt
+    // that belongs to another device on the line.
+    AckPending = (USHORT) (Adapter->CSRAddress->ScbStatus & SCB_ACK_MASK);
+    if (Adapter->IntCauseMask & SCB_FR_INT_MASK)
+        AckPending &= ~SCB_ACK_FR;
 
     // We want to process the interrupt if the output from our interrupt line
     // is high, and our interrupt is not masked.  If our interrupt line
     // is already masked, then we must be currently processing interrupts.
     if ((!(Adapter->CSRAddress->ScbCommandHigh & SCB_INT_MASK)) &&
-        (Adapter->CSRAddress->ScbStatus & SCB_ACK_MASK))
+        (AckPending))
     {
         //        DEBUGSTR(("Our INT -- slot %x\n", Adapter->AiSlot));
         *InterruptRecognized = TRUE;
@@ -87,6 +95,12 @@ D100Isr(
 //              transmits, etc). It will only be called with the adapter's
 //              interrupts masked. This is the DPC for this driver.
 //
+//              No more than RxBudget receives are processed per call.  If
+//              the budget runs out, a software interrupt brings us back for
+//              the rest once NDIS has re-enabled interrupts.  So does the
+//              receive poll timer.  SCB_ACK_MASK includes the software
+//              interrupt, so that the ISR claims it and the ack clears it.
+//
 // Arguments:
 //  MiniportAdapterContext (miniport) - The context value returned by the
 //                           Miniport when the adapter was initialized (see the
@@ -114,6 +128,9 @@ D100HandleInterrupt(
     // to optimize for hardware/protocol timing differences
     USHORT      DPCLoopCount = 2;
 
+    // receives processed so far, against Adapter->RxBudget
+    UINT        Received = 0;
+
     DEBUGFUNC("D100HandleInterrupt");
 
     NdisAcquireSpinLock(&Adapter->Lock);
@@ -144,7 +161,7 @@ D100HandleInterrupt(
         Adapter->CSRAddress->ScbStatus = AckCommand;
 
         // Go handle receive events
-        ProcessRXInterrupt(Adapter);
+        Received += ProcessRXInterrupt(Adapter, Adapter->RxBudget - Received);
 
         // Cleanup transmits
         ProcessTXInterrupt(Adapter);
@@ -152,9 +169,24 @@ D100HandleInterrupt(
         // Start the receive unit if it had stopped
         StartReceiveUnit(Adapter);
 
+        if (Received >= Adapter->RxBudget)
+            break;
+
         DPCLoopCount--;
     }
 
+    // If we stopped at the budget there may be receives left.  Their
+    // frame received status was acked already, so ask for a software
+    // interrupt; it is raised when interrupts are enabled again.
+    if (Received >= Adapter->RxBudget)
+    {
+        TRACE2(Adapter, ("Receive budget used, coming back\n"));
+        Adapter->CSRAddress->ScbCommandHigh = SCB_INT_MASK | SCB_SOFT_INT;
+    }
+
+    if (Adapter->IntModeration)
+        D100AdjustModeration(Adapter, Received);
+
     DEBUGCHAR(Adapter,'h');
 
     NdisReleaseSpinLock(&Adapter->Lock);
@@ -171,17 +203,22 @@ D100HandleInterrupt(
 //              those frames are dropped by the driver, and not indicated to
 //              the ndis wrapper.
 //
+//              Good frames are indicated in arrays of up to RxIndicateMax
+//              packets.  No more than Budget receive frames are taken off
+//              the list; the rest stay there for the next call.
+//
 // Arguments:
 //  Adapter - ptr to Adapter object instance
+//  Budget - the most receive frames to process
 //
 // Returns:
-//      TRUE if a receive was indicated
-//      FALSE if a receive was not indicated
+//      The number of receive frames processed, good or not
 //-----------------------------------------------------------------------------
 
-BOOLEAN
+UINT
 ProcessRXInterrupt(
-                   IN PD100_ADAPTER Adapter
+                   IN PD100_ADAPTER Adapter,
+                   IN UINT Budget
                    )
                    
 {
@@ -193,6 +230,7 @@ ProcessRXInterrupt(
     UINT            PacketArrayCount;
     UINT            PacketFreeCount;
     UINT            i;
+    UINT            Processed = 0;
     BOOLEAN         ContinueToCheckRFDs=FALSE;
     DEBUGFUNC("ProcessRxInterrupt")
     
@@ -205,9 +243,16 @@ ProcessRXInterrupt(
         PacketArrayCount = 0;
         PacketFreeCount = 0;
         
-        // We stay in the while loop until we have processed all pending receives.
+        // We stay in the while loop until we have processed all pending
+        // receives, or used up the budget.
         while (1)
         {
+            if (Processed >= Budget)
+            {
+                ContinueToCheckRFDs = FALSE;
+                break;
+            }
+
             if (QueueEmpty(&Adapter->RfdList))
             {
                 // This should never happen because we limit the number of 
@@ -234,6 +279,7 @@ ProcessRXInterrupt(
             
             // Remove the RFD from the head of the List
             QueueRemoveHead(&Adapter->RfdList);
+            Processed++;
 
             // Get the packet length
             SwRfd->FrameLength = ((Rfd->RfdActualCount) & 0x3fff);
@@ -326,8 +372,8 @@ ProcessRXInterrupt(
                 PacketArrayCount++;
                 
                 // this limits the number of packets that we will indicate
-                // to MAX_ARRAY_RECEIVE_PACKETS or the available number of RFDS
-                if (( PacketArrayCount >= MAX_ARRAY_RECEIVE_PACKETS) ||
+                // to RxIndicateMax or the available number of RFDS
+                if (( PacketArrayCount >= Adapter->RxIndicateMax) ||
                     ( Adapter->UsedRfdCount == Adapter->NumRfd))
                 {
                     ContinueToCheckRFDs = TRUE;
@@ -342,7 +388,7 @@ ProcessRXInterrupt(
         if (0 == PacketArrayCount)
         {
             DEBUGCHAR(Adapter,'g');
-            return(FALSE);
+            return(Processed);
         }
         
     #if DBG
@@ -392,7 +438,137 @@ ProcessRXInterrupt(
     ASSERT(Adapter->UsedRfdCount <= (Adapter->NumRfd - MIN_NUM_RFD));
     
     DEBUGCHAR(Adapter,'r');
-    return (TRUE);
+    return (Processed);
+}
+
+//-----------------------------------------------------------------------------
+// Procedure:   D100AdjustModeration
+//
+// Description: This routine implements adaptive interrupt moderation.  It
+//              samples the receive rate over MODERATION_SAMPLE_MS.  Above
+//              IntModerationRate frames per second it masks the frame
+//              received interrupt and polls for receives every
+//              RxPollInterval ms instead; below half that rate it goes back
+//              to an interrupt per event, for the latency.  The RU not ready
+//              interrupt is never masked, so a receive list that fills up
+//              between polls is still handled at once.
+//
+//              Called at the end of the DPC, with the adapter lock held.
+//              The masks take effect when NDIS re-enables interrupts.
+//
+// Arguments:
+//  Adapter - ptr to Adapter object instance
+//  Received - receives processed by this DPC
+//
+// Returns: (none)
+//-----------------------------------------------------------------------------
+
+VOID
+D100AdjustModeration(
+                     IN PD100_ADAPTER Adapter,
+                     IN UINT Received
+                     )
+
+{
+    ULONG           Now;
+    ULONG           Elapsed;
+    ULONG           Rate;
+
+    DEBUGFUNC("D100AdjustModeration");
+
+    Adapter->ModerationFrames += Received;
+
+    NdisGetSystemUpTime(&Now);
+    Elapsed = Now - Adapter->ModerationStart;
+
+    if (Elapsed >= MODERATION_SAMPLE_MS)
+    {
+        Rate = (ULONG) (((ULONGLONG) Adapter->ModerationFrames * 1000) / Elapsed);
+
+        Adapter->ModerationStart = Now;
+        Adapter->ModerationFrames = 0;
+
+        if ((!Adapter->RxPolling) && (Rate >= Adapter->IntModerationRate))
+        {
+            TRACE2(Adapter, ("%d frames/sec, polling receives\n", Rate));
+            Adapter->RxPolling = TRUE;
+            Adapter->IntCauseMask = SCB_FR_INT_MASK;
+        }
+        else if ((Adapter->RxPolling) && (Rate < Adapter->IntModerationRate / 2))
+        {
+            // Frames that came in since the last poll still have their
+            // status bit set, so unmasking interrupts raises one for them.
+            TRACE2(Adapter, ("%d frames/sec, interrupt per receive\n", Rate));
+            Adapter->RxPolling = FALSE;
+            Adapter->IntCauseMask = 0;
+        }
+    }
+
+    // Each poll sets up the next one
+    if (Adapter->RxPolling)
+        NdisMSetTimer(&Adapter->D100RxPollTimer, Adapter->RxPollInterval);
+}
+
+//-----------------------------------------------------------------------------
+// Procedure:   D100RxPollTimer
+//
+// Description: This is the receive poll timer.  It raises a software
+//              interrupt, so that the polled receives are processed by
+//              D100HandleInterrupt like any other.
+//
+// Arguments:
+//  MiniportAdapterContext - pointer to D100_ADAPTER
+//
+// Returns: (none)
+//-----------------------------------------------------------------------------
+
+VOID
+D100RxPollTimer(PVOID sysspiff1,
+                NDIS_HANDLE MiniportAdapterContext,
+                PVOID sysspiff2, PVOID sysspiff3)
+{
+    PD100_ADAPTER Adapter = PD100_ADAPTER_FROM_CONTEXT_HANDLE(MiniportAdapterContext);
+
+    DEBUGFUNC("D100RxPollTimer");
+
+    if (!Adapter->RxPolling)
+        return;
+
+    NdisMSynchronizeWithInterrupt(&Adapter->Interrupt,
+        (PVOID) D100RxPollSync,
+        (PVOID) Adapter);
+}
+
+//-----------------------------------------------------------------------------
+// Procedure:   D100RxPollSync
+//
+// Description: Raises the software interrupt for D100RxPollTimer.  Runs
+//              synchronized with D100Isr, so the mask it reads is not
+//              changed under it.  If interrupts are masked a DPC is running
+//              (or a reset), and the DPC sets up the next poll itself.
+//
+// Arguments:
+//  Context - pointer to D100_ADAPTER
+//
+// Returns:
+//      TRUE if the software interrupt was raised
+//-----------------------------------------------------------------------------
+
+BOOLEAN
+D100RxPollSync(
+               IN PVOID Context
+               )
+
+{
+    PD100_ADAPTER Adapter = (PD100_ADAPTER) Context;
+
+    if (Adapter->CSRAddress->ScbCommandHigh & SCB_INT_MASK)
+        return FALSE;
+
+    Adapter->CSRAddress->ScbCommandHigh =
+        (UCHAR) (Adapter->IntCauseMask | SCB_SOFT_INT);
+
+    return TRUE;
 }
 
 //-----------------------------------------------------------------------------
@@ -444,7 +620,8 @@ StartReceiveUnit(
     // we should process the rest of our receives
     if ((SwRfd == NULL) || (SwRfd->Rfd->RfdCbHeader.CbStatus))
     {
-        Status = ProcessRXInterrupt(Adapter);
+        // All of them, whatever the budget: the RU restarts at the head
+        Status = (BOOLEAN) (ProcessRXInterrupt(Adapter, (UINT) -1) != 0);
 
         // Get the new RFD "head" after processing the pending receives.
         SwRfd = (PD100SwRfd) QueueGetHead(&Adapter->RfdList);
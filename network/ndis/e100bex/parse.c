@@ -75,6 +75,12 @@ D100RegTabType D100GlobalRegTab[ ] = {
     {NDIS_STRING_CONST("NumTcb"),           "NumTcb",           0, D100_OFFSET(RegNumTcb),       D100_SIZE(RegNumTcb),         16,                              1,          0x40},
     {NDIS_STRING_CONST("NumTbdPerTcb"),     "NumTbdPerArray",   0, D100_OFFSET(NumTbdPerTcb),    D100_SIZE(NumTbdPerTcb),      8,                               1,          MAX_PHYS_DESC},
     {NDIS_STRING_CONST("NumCoalesce"),      "NumCoalesce",      0, D100_OFFSET(NumCoalesce),     D100_SIZE(NumCoalesce),       8,                               1,          32},
+    {NDIS_STRING_CONST("TxCopyBreak"),      "TxCopyBreak",      0, D100_OFFSET(TxCopyBreak),     D100_SIZE(TxCopyBreak),       ETH_MAX_COPY_LENGTH,             0,          TCB_BUFFER_SIZE},
+    {NDIS_STRING_CONST("RxBudget"),         "RxBudget",         0, D100_OFFSET(RxBudget),        D100_SIZE(RxBudget),          DEFAULT_RX_BUDGET,               16,         MAX_RECEIVE_DESCRIPTORS},
+    {NDIS_STRING_CONST("RxIndicateMax"),    "RxIndicateMax",    0, D100_OFFSET(RxIndicateMax),   D100_SIZE(RxIndicateMax),     MAX_ARRAY_RECEIVE_PACKETS,       1,          MAX_NUM_ALLOCATED_RFDS},
+    {NDIS_STRING_CONST("IntModeration"),    "IntModeration",    0, D100_OFFSET(IntModeration),   D100_SIZE(IntModeration),     1,                               0,          1},
+    {NDIS_STRING_CONST("IntModerationRate"),"IntModerationRate",0, D100_OFFSET(IntModerationRate),D100_SIZE(IntModerationRate),10000,                          1000,       200000},
+    {NDIS_STRING_CONST("RxPollInterval"),   "RxPollInterval",   0, D100_OFFSET(RxPollInterval),  D100_SIZE(RxPollInterval),    1,                               1,          10},
     {NDIS_STRING_CONST("MapRegisters"),     "MapRegisters",     0, D100_OFFSET(NumMapRegisters), D100_SIZE(NumMapRegisters),   64,                              0,          0xffff},
     {NDIS_STRING_CONST("PhyAddress"),       "PhyAddress",       0, D100_OFFSET(PhyAddress),      D100_SIZE(PhyAddress),        0xFF,                            0,          0xFF},
     {NDIS_STRING_CONST("Connector"),        "Connector",        0, D100_OFFSET(Connector),       D100_SIZE(Connector),         0,                               0,          0x2},
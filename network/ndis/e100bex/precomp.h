@@ -6,8 +6,14 @@
 ** ETHEREXPRESS PRO/100+(TM) NDIS 5.0 MINIPORT SAMPLE DRIVER               **
 ****************************************************************************/
 
+// The user mode harness in d100sim defines D100_HARNESS to build
+// interrup.c against its own NDIS definitions and 82557 model.
+#ifdef D100_HARNESS
+#include "d100sim.h"
+#else
 #include <ndis.h>
 #include <efilter.h>
+#endif
 
 #include "equates.h"
 #include "pci.h"
@@ -17,5 +23,7 @@
 #include "d100pr.h"
 #include "queue.h"
 #include "inlinef.h"
+#ifndef D100_HARNESS
 #include "e100bdat.h"
+#endif
 
@@ -21,8 +21,12 @@ Revision History
     - JCB 8/14/97 Example Driver Created
 *****************************************************************************/
 
+#ifdef D100_HARNESS
+#include "d100sim.h"
+#else
 #include <ndis.h>
 #include <efilter.h>
+#endif
 
 #include "equates.h"
 #include "pci.h"
@@ -684,7 +684,8 @@ D100QueryInformation(
         OID_CUSTOM_DRIVER_SET,
         OID_CUSTOM_DRIVER_QUERY,
         OID_CUSTOM_ARRAY,
-        OID_CUSTOM_STRING
+        OID_CUSTOM_STRING,
+        OID_CUSTOM_TX_COPY_STATS
     };
 
 
@@ -715,7 +716,7 @@ D100QueryInformation(
     // WMI support
     // check out the e100b.mof file for examples of how the below
     // maps into a .mof file for external advertisement of GUIDs
-#define NUM_CUSTOM_GUIDS 4
+#define NUM_CUSTOM_GUIDS 5
 
     static const NDIS_GUID GuidList[NUM_CUSTOM_GUIDS] =
     { { // {F4A80276-23B7-11d1-9ED9-00A0C9010057} example of a uint set
@@ -741,6 +742,12 @@ D100QueryInformation(
             OID_CUSTOM_STRING,
             (ULONG) -1, // size is -1 for ANSI or NDIS_STRING string types
             (fNDIS_GUID_TO_OID|fNDIS_GUID_ANSI_STRING)
+        },
+    { // {F4A8027A-23B7-11d1-9ED9-00A0C9010057} transmit copy counters
+            E100BTransmitCopyStatsGuid,
+            OID_CUSTOM_TX_COPY_STATS,
+            sizeof(D100_TX_COPY_STATS),
+            (fNDIS_GUID_TO_OID)
         }
     };
 
@@ -1001,6 +1008,13 @@ D100QueryInformation(
         MoveBytes = sizeof(VendorDescriptor);
         break;
 
+        // how the transmit path copied frames (see PrepareForTransmit)
+    case OID_CUSTOM_TX_COPY_STATS:
+        REQUEST(Adapter,("CUSTOM_TX_COPY_STATS got a QUERY\n"));
+        MoveSource = (PVOID) &Adapter->TxCopyStats;
+        MoveBytes = sizeof(Adapter->TxCopyStats);
+        break;
+
     default:
 
         // The query is for a driver statistic, so we need to first
@@ -227,28 +227,33 @@ SetupNextSend(PD100_ADAPTER Adapter,
         HwTcb->TxCbHeader.CbStatus = 0;
         HwTcb->TxCbThreshold = (UCHAR) Adapter->AiThreshold;
 
-        // If the packet is small then we don't use any TBDs, and we send
-        // the packet in simplified mode.
-        if (SwTcb->PacketLength <= MINIMUM_ETHERNET_PACKET_SIZE)
+        // If the whole packet was copied into the TCB then we don't use any
+        // TBDs, and we send the packet in simplified mode.
+        if (!SwTcb->TbdsUsed)
         {
             // Prep the hardware TCB.  This Tcb will not point to any TBDs
             // because the entire frame will be located in the TCB's data
-            // area.
+            // area.  Short frames are sent padded to the minimum length.
             HwTcb->TxCbHeader.CbCommand = CB_S_BIT | CB_TRANSMIT;
             HwTcb->TxCbTbdPointer = DRIVER_NULL;
             HwTcb->TxCbTbdNumber = 0;
-            HwTcb->TxCbCount = (CB_TX_EOF_BIT | 0x003C);
+
+            if (SwTcb->PacketLength < MINIMUM_ETHERNET_PACKET_SIZE)
+                HwTcb->TxCbCount = (CB_TX_EOF_BIT | MINIMUM_ETHERNET_PACKET_SIZE);
+            else
+                HwTcb->TxCbCount = (USHORT) (CB_TX_EOF_BIT | SwTcb->PacketLength);
         }
 
-        // If the packet is not small then we do use TBDs, and thus send the
-        // packet using flexible mode.
+        // Otherwise we do use TBDs, and thus send the packet using flexible
+        // mode.  Any leading fragments that were copied into the TCB's data
+        // area are sent first, followed by the buffers the TBDs point to.
         else
         {
             // Prep the hardware TCB
             HwTcb->TxCbHeader.CbCommand = CB_S_BIT | CB_TRANSMIT | CB_TX_SF_BIT;
             HwTcb->TxCbTbdPointer = SwTcb->FirstTbdPhys;
             HwTcb->TxCbTbdNumber = (UCHAR) SwTcb->TbdsUsed;
-            HwTcb->TxCbCount = 0;
+            HwTcb->TxCbCount = (USHORT) SwTcb->InlineLength;
         }
 
         // If the transmit unit is idle (very first transmit) then we must
@@ -353,6 +358,16 @@ SetupNextSend(PD100_ADAPTER Adapter,
 //      TRUE If we were able to acquire the necessary TBD's or Coalesce buffer
 //           for the packet in we are attempting to prepare for transmission.
 //      FALSE If we needed a coalesce buffer, and we didn't have any available.
+//
+// Notes:
+//      The copy policy is, in order of preference:
+//      - frames no longer than the copy break (or the minimum frame) are
+//        copied whole into the TCB's data area;
+//      - otherwise, leading fragments that together fit in the copy break
+//        (typically the protocol headers) are copied into the TCB's data
+//        area, and the rest of the frame is mapped for the TBDs;
+//      - only if that still needs more TBDs than a TCB has is the whole frame
+//        copied into a coalesce buffer.
 //-----------------------------------------------------------------------------
 
 BOOLEAN
@@ -387,6 +402,8 @@ PrepareForTransmit(PD100_ADAPTER Adapter,
     SwTcb->TbdsUsed = 0;
     SwTcb->Coalesce = (PCOALESCE) 0;
     SwTcb->CoalesceBufferLen = 0;
+    SwTcb->InlineLength = 0;
+    SwTcb->MappedBuffer = (PNDIS_BUFFER) 0;
 
     // Get a virtual buffer count and packet length.
     NdisQueryPacket(SwTcb->Packet,
@@ -416,34 +433,49 @@ PrepareForTransmit(PD100_ADAPTER Adapter,
     SwTcb->NumPhysDescCheck = SwTcb->NumPhysDesc;
 #endif
 
-    // If the packet is less than minimum size, then we'll just copy the packet
-    // into the data portion of the TCB.  This means that we won't be acquiring
-    // any TBD's.  We also won't need to get a coalesce buffer.
-    if (SwTcb->PacketLength <= MINIMUM_ETHERNET_PACKET_SIZE)
+    // If the packet is less than minimum size, or no longer than the copy
+    // break, then we'll just copy the packet into the data portion of the TCB.
+    // This means that we won't be acquiring any TBD's.  We also won't need to
+    // get a coalesce buffer.
+    if ((SwTcb->PacketLength <= MINIMUM_ETHERNET_PACKET_SIZE) ||
+        (SwTcb->PacketLength <= Adapter->TxCopyBreak))
     {
         TRACE2(Adapter, ("short packet\n"));
         CurrBuff = 0;
     }
 
-    // If there are too many physical mappings, try to get a coalesce buffer.
-    // We do this because its actually faster for us to copy many fragments
-    // into a big buffer and give that big buffer to the adapter, than to have
-    // the hardware fetch numerous small fragments (this often leads to
-    // underruns). The NDIS tester often asks us to send packets that
-    // have more than 30 physical components. This method also saves TBD resources.
-
-    else if (SwTcb->NumPhysDesc > Adapter->NumTbdPerTcb)
+    else
     {
-        // Debug Code
-        ASSERT(!SwTcb->Coalesce);
-        TRACE2(Adapter,
-            ("Failed-> Physical descriptors %d > num Tbd per Tcb %d\n",
-            SwTcb->NumPhysDesc, Adapter->NumTbdPerTcb));
-
-        // Try to get the coalesce buffer
-        if (!AcquireCoalesceBuffer(Adapter, SwTcb))
-            return (FALSE);
-        CurrBuff = 0;
+        // Leave the small leading fragments to be copied into the TCB, they
+        // don't need map registers or TBDs.
+        CurrBuff = SplitInlineFragments(Adapter, SwTcb);
+
+        // If there are still too many physical mappings, try to get a
+        // coalesce buffer.  We do this because its actually faster for us to
+        // copy many fragments into a big buffer and give that big buffer to
+        // the adapter, than to have the hardware fetch numerous small
+        // fragments (this often leads to underruns). The NDIS tester often
+        // asks us to send packets that have more than 30 physical components.
+        // This method also saves TBD resources.
+        if (SwTcb->NumPhysDesc > Adapter->NumTbdPerTcb)
+        {
+            // Debug Code
+            ASSERT(!SwTcb->Coalesce);
+            TRACE2(Adapter,
+                ("Failed-> Physical descriptors %d > num Tbd per Tcb %d\n",
+                SwTcb->NumPhysDesc, Adapter->NumTbdPerTcb));
+
+            // The coalesce buffer takes the whole frame
+            SwTcb->InlineLength = 0;
+
+            // Try to get the coalesce buffer
+            if (!AcquireCoalesceBuffer(Adapter, SwTcb))
+                return (FALSE);
+            CurrBuff = 0;
+        }
+
+        // The remaining buffers are mapped, and unmapped in TransmitCleanup
+        SwTcb->MappedBuffer = CurrBuff;
     }
 
     //  Clear NumPhysDesc.
@@ -554,6 +586,7 @@ PrepareForTransmit(PD100_ADAPTER Adapter,
 
         SwTcb->TbdsUsed = 1;
 
+        Adapter->TxCopyStats.CoalesceFrames++;
 
     }
 
@@ -563,6 +596,25 @@ PrepareForTransmit(PD100_ADAPTER Adapter,
         SwTcb->TbdsUsed = SwTcb->NumPhysDesc;
         ASSERT(!SwTcb->CoalesceBufferLen);
         ASSERT(SwTcb->MapsUsed);
+
+        // Copy the leading fragments into the immediate data portion of the
+        // TCB.  The adapter sends them ahead of the TBD buffers.
+        if (SwTcb->InlineLength)
+        {
+            ASSERT(SwTcb->InlineLength <= Adapter->TxCopyBreak);
+
+            D100CopyFromPacketToBuffer(Adapter,
+                SwTcb->Packet,
+                SwTcb->InlineLength,
+                (PCHAR) &SwTcb->Tcb->TxCbData,
+                SwTcb->FirstBuffer,
+                &BytesCopied);
+
+            ASSERT(BytesCopied == SwTcb->InlineLength);
+
+            Adapter->TxCopyStats.InlineFrames++;
+            Adapter->TxCopyStats.InlineBytes += SwTcb->InlineLength;
+        }
     }
 
     // check if we are using the TCB's data area with no TBDs.  This should
@@ -573,7 +625,8 @@ PrepareForTransmit(PD100_ADAPTER Adapter,
         ASSERT(!SwTcb->NumPhysDesc);
         ASSERT(!SwTcb->MapsUsed);
 
-        ASSERT(SwTcb->PacketLength <= MINIMUM_ETHERNET_PACKET_SIZE);
+        ASSERT((SwTcb->PacketLength <= MINIMUM_ETHERNET_PACKET_SIZE) ||
+               (SwTcb->PacketLength <= Adapter->TxCopyBreak));
 
         // Copy the packet into the immediate data portion of the TCB.
         D100CopyFromPacketToBuffer(Adapter,
@@ -586,6 +639,8 @@ PrepareForTransmit(PD100_ADAPTER Adapter,
 
         ASSERT(BytesCopied == SwTcb->PacketLength);
 
+        Adapter->TxCopyStats.CopyBreakFrames++;
+
         //        // Check for below minimum length packets.
         //        if (SwTcb->PacketLength < MINIMUM_ETHERNET_PACKET_SIZE)
         //        {
@@ -638,6 +693,73 @@ PrepareForTransmit(PD100_ADAPTER Adapter,
     return (TRUE);
 }
 
+//-----------------------------------------------------------------------------
+// Procedure:   SplitInlineFragments
+//
+// Description: This routine finds the leading fragments of a packet that
+//              together fit in the copy break.  Those are copied into the
+//              TCB's data area rather than mapped, which saves a map
+//              register and a TBD for each of them, and spares the adapter
+//              a bus fetch of a few bytes.  Protocol headers built in
+//              their own buffers are the usual case.
+//
+// Arguments:
+//      Adapter - ptr to Adapter object instance
+//      SwTcb - Pointer to a software structure that represents a hardware TCB.
+//
+// Result:
+//      SwTcb->InlineLength - The number of bytes to copy into the TCB
+//      SwTcb->NumPhysDesc - Reduced by the physical pages of those fragments
+//
+// Returns:
+//      The first buffer that is to be mapped.
+//-----------------------------------------------------------------------------
+
+PNDIS_BUFFER
+SplitInlineFragments(PD100_ADAPTER Adapter,
+                     PD100SwTcb SwTcb
+                     )
+{
+    PNDIS_BUFFER    CurrBuff;
+    UINT            Offset;
+    UINT            Length;
+    UINT            ArraySize;
+
+    DEBUGFUNC("SplitInlineFragments");
+
+    ASSERT(!SwTcb->InlineLength);
+    ASSERT(SwTcb->PacketLength > Adapter->TxCopyBreak);
+
+    CurrBuff = SwTcb->FirstBuffer;
+
+    // The packet is longer than the copy break, so this always stops on a
+    // buffer that holds data.
+    while (CurrBuff)
+    {
+        NdisQueryBufferOffset(CurrBuff, &Offset, &Length);
+
+        if (SwTcb->InlineLength + Length > Adapter->TxCopyBreak)
+            break;
+
+        NdisGetBufferPhysicalArraySize(CurrBuff, &ArraySize);
+
+        SwTcb->InlineLength += Length;
+        SwTcb->NumPhysDesc -= ArraySize;
+
+#if DBG
+        SwTcb->BufferCountCheck++;
+#endif
+
+        NdisGetNextBuffer(CurrBuff, &CurrBuff);
+    }
+
+    TRACE3(Adapter, ("%d bytes inline, %d physical descriptors left\n",
+        SwTcb->InlineLength, SwTcb->NumPhysDesc));
+
+    return (CurrBuff);
+}
+
+
 //-----------------------------------------------------------------------------
 // Procedure:   AcquireCoalesceBuffer
 //
@@ -674,6 +796,7 @@ AcquireCoalesceBuffer(PD100_ADAPTER Adapter,
     if (QueueEmpty(&Adapter->CoalesceBufferList))
     {
         TRACE2(Adapter, ("No free coalesce buffers!!!\n"));
+        Adapter->TxCopyStats.CoalesceUnavailable++;
         return (FALSE);
     }
 
@@ -944,8 +1067,9 @@ TransmitCleanup(PD100_ADAPTER Adapter)
         // unlock all of the pages held by this packet
         if (SwTcb->MapsUsed > 0)
         {
-            // start with the first buffer
-            CurrBuff = SwTcb->FirstBuffer;
+            // start with the first mapped buffer, the leading fragments that
+            // were copied into the TCB hold no map registers
+            CurrBuff = SwTcb->MappedBuffer;
 
             // free the map register associated with each buffer
             while (CurrBuff)
@@ -985,6 +1109,8 @@ TransmitCleanup(PD100_ADAPTER Adapter)
         //  Clear NumPhysDesc, and NumMapsUsed.
         SwTcb->NumPhysDesc =
             SwTcb->MapsUsed = 0;
+        SwTcb->InlineLength = 0;
+        SwTcb->MappedBuffer = (PNDIS_BUFFER) 0;
 
         // Free the TCB for the given frame
         TRACE3(Adapter, ("Releasing SwTcb %08x\n", SwTcb));
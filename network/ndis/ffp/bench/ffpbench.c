@@ -0,0 +1,1108 @@
+/*++
+
+Copyright (c) 1999  Microsoft Corporation
+
+Module Name:
+
+  ffpbench.c
+
+Abstract:
+
+  User-mode harness for the FFP fast forwarding cache. Replays a
+  libpcap trace (or a synthetic one with many concurrent flows)
+  and reports hit rate and cost per packet for
+
+    - the original direct-mapped cache with a spin lock per entry,
+      modelled here as it was before the cache became set associative,
+    - the set associative cache (IsPacketInFastForwardingCache and
+      SeedFastForwardingCache), and
+    - the whole receive and send path (FFPProcessReceivedPacket
+      and FFPProcessSentPacket) with filtering on, and
+    - the same with packets received FFPBENCH_RECEIVE_BATCH at a
+      time (FFPProcessReceivedPackets), and
+    - optionally, the whole path again after the cache is resized
+      with OID_FFP_PARAMS - without a flush, the entries are moved
+      to the resized cache while packets are received.
+
+  The harness ends by querying OID_FFP_CACHE_STATS and printing the
+  statistics FFP kept over all the replays.
+
+  The original cache is modelled with the original additive flow
+  hash; the others use the keyed hash of INIT_HASH_VALUE. The -s
+  trace (port scans and their replies) is one the additive hash
+  maps to few buckets.
+
+  A packet the cache does not forward is "routed" as IP would route
+  it - out of an adapter picked from its destination address - and
+  the cache learns the route. Every forwarded packet is checked
+  against that route.
+
+  The filtering code is built into this file the way ffp-fil.c
+  builds it, so that the harness can call the cache routines
+  directly; ffp-int.c and ffp-nof.c are linked as they are.
+
+Revision History:
+
+--*/
+
+#include <precomp.h>
+
+#define    __FILTER__    1
+#include "..\ffp-com.c"
+
+//
+// Harness Definitions
+//
+
+#define FFPBENCH_DEFAULT_ENTRIES        (1 << 14)
+#define FFPBENCH_DEFAULT_FLOWS          (1 << 15)
+#define FFPBENCH_DEFAULT_PACKETS        (1 << 20)
+#define FFPBENCH_DEFAULT_PASSES         3
+#define FFPBENCH_MAX_THREADS            16
+#define FFPBENCH_RECEIVE_BATCH          32
+
+//
+// A captured packet - the ethernet header, the IP header and the
+// dword after it (all that FFP looks at). The pad keeps the IP
+// header aligned, as receive buffers usually do.
+//
+
+typedef struct _BenchPacket
+{
+    USHORT          BP_Pad;
+    EnetHeader      BP_Ethernet;
+    FFPIPHeader     BP_Ip;
+    ULONG           BP_DwordAfterIPHeader;
+    ULONG           BP_Route;               // Index of the outgoing adapter
+} BenchPacket;
+
+//
+// The original fast forwarding cache entry - one per hash bucket,
+// each with its own spin lock
+//
+
+typedef struct _OldFFPCacheEntry
+{
+    IPHeaderInfo    FFPCE_IPInfo;
+    HANDLE          FFPCE_OutgoingAdapter;
+    EnetHeader      FFPCE_MACHeader;
+    LONG            FFPCE_CacheEntryType;
+} OldFFPCacheEntry;
+
+typedef enum _BenchMode
+{
+    BenchOldCache,
+    BenchNewCache,
+    BenchFullPath,
+    BenchBatchPath
+} BenchMode;
+
+typedef struct _BenchThread
+{
+    BenchMode       BT_Mode;
+    ULONG           BT_First;               // Packet the replay starts at
+    ULONG           BT_Forwarded;
+    ULONG           BT_Mismatched;
+} BenchThread;
+
+//
+// Harness Globals
+//
+
+FFPBENCH_ADAPTER    FFPBenchAdapters[FFPBENCH_ADAPTERS];
+
+BenchPacket        *BenchPackets;
+ULONG               BenchPacketCount;
+ULONG               BenchPasses = FFPBENCH_DEFAULT_PASSES;
+
+OldFFPCacheEntry   *OldCache;
+UCHAR              *OldCacheValidBmp;
+ULONG               OldCacheSize;
+ULONG               OldHashShift;
+ULONG               OldHashMask;
+
+//
+// The adapter a destination is routed to, and the
+// MAC header IP would build for it on that adapter
+//
+
+#define ROUTE_FOR_DEST(Dest)                                                  \
+    (1 + ((((Dest) * 0x9E3779B1) >> 16) % (FFPBENCH_ADAPTERS - 1)))
+
+#define ADAPTER_HANDLE(Route)           ((HANDLE)&FFPBenchAdapters[Route])
+
+VOID
+BuildRoutedHeader (
+    IN     BenchPacket                     *Packet,
+    OUT    EnetHeader                      *EthernetHeader
+    )
+{
+    EthernetHeader->EH_Dest.EA_Addr[0] = 0x02;
+    EthernetHeader->EH_Dest.EA_Addr[1] = 0x00;
+    *(ULONG UNALIGNED *)&EthernetHeader->EH_Dest.EA_Addr[2] = Packet->BP_Ip.Dest;
+
+    EthernetHeader->EH_Src.EA_Addr[0] = 0x02;
+    EthernetHeader->EH_Src.EA_Addr[1] = 0xFF;
+    EthernetHeader->EH_Src.EA_Addr[2] = 0x00;
+    EthernetHeader->EH_Src.EA_Addr[3] = 0x00;
+    EthernetHeader->EH_Src.EA_Addr[4] = 0x00;
+    EthernetHeader->EH_Src.EA_Addr[5] = (UCHAR)Packet->BP_Route;
+
+    EthernetHeader->EH_Type = 0x0008;
+}
+
+//
+// The original direct-mapped cache, and its additive flow
+// hash (dest addr rotated left by one bit, as intended)
+//
+
+#define OLD_INIT_HASH_VALUE(IpHeader)                                         \
+    ((IpHeader)->Src + (((IpHeader)->Dest << 1) | ((IpHeader)->Dest >> 31)))
+
+ULONG
+OldHashValue (
+    IN               ULONG                Value
+    )
+{
+    *((USHORT *) &Value) += *( ((USHORT *) &Value) + 1 );
+    *((USHORT *) &Value) += *( ((USHORT *) &Value)) >> OldHashShift;
+    Value &= OldHashMask;
+    return Value;
+}
+
+ULONG
+OldIsPacketInFastForwardingCache (
+    IN     UNALIGNED EnetHeader          *EthernetHeader,
+    IN     UNALIGNED FFPIPHeader         *IpHeader,
+    IN OUT ULONG                         *Hash,
+    OUT    HANDLE                        *OutgoingAdapter
+    )
+{
+    ULONG             hashindex;
+    UCHAR            *restofpacket;
+    OldFFPCacheEntry *cacheentry;
+    LONG              cacheentrytype;
+
+    restofpacket = (UCHAR *)IpHeader + 20;
+
+    switch (IpHeader->Protocol)
+    {
+        case IPPROTO_TCP:
+        case IPPROTO_UDP:
+            *Hash += *((ULONG *)restofpacket);
+            break;
+
+        case IPPROTO_ICMP:
+            *Hash += *((USHORT *)restofpacket);
+    }
+
+    hashindex = OldHashValue(*Hash);
+
+    if (!OldCacheValidBmp[hashindex])
+    {
+        return FFP_INDICATE_PACKET;
+    }
+
+    cacheentry = &OldCache[hashindex];
+
+    NdisAcquireSpinLock(&cacheentry->FFPCE_IPInfo.IPHI_SpinLock);
+
+    if (   IpHeader->Dest     != cacheentry->FFPCE_IPInfo.IPHI_DestAddress
+        || IpHeader->Src      != cacheentry->FFPCE_IPInfo.IPHI_SrcAddress
+        || IpHeader->Protocol != cacheentry->FFPCE_IPInfo.IPHI_Protocol
+        || (IpHeader->Protocol != IPPROTO_ICMP
+            && *((ULONG *) restofpacket) != *((ULONG *)
+                &(cacheentry->FFPCE_IPInfo.IPHI_FirstWordAfterIPHeader)))
+        || (IpHeader->Protocol == IPPROTO_ICMP
+            && *((USHORT *) restofpacket) !=
+                cacheentry->FFPCE_IPInfo.IPHI_FirstWordAfterIPHeader))
+    {
+        NdisReleaseSpinLock(&cacheentry->FFPCE_IPInfo.IPHI_SpinLock);
+        return FFP_INDICATE_PACKET;
+    }
+
+    if (cacheentry->FFPCE_CacheEntryType == FFP_FORWARD_PACKET)
+    {
+        IpHeader->Ttl--;
+        IpHeader->Xsum++;
+
+        NdisMoveMemory(EthernetHeader,
+                       &cacheentry->FFPCE_MACHeader,
+                       sizeof(EnetHeader));
+
+        *OutgoingAdapter = cacheentry->FFPCE_OutgoingAdapter;
+    }
+
+    cacheentrytype = cacheentry->FFPCE_CacheEntryType;
+
+    NdisReleaseSpinLock(&cacheentry->FFPCE_IPInfo.IPHI_SpinLock);
+
+    return cacheentrytype;
+}
+
+VOID
+OldSeedFastForwardingCache (
+    IN     UNALIGNED EnetHeader          *EthernetHeader,
+    IN     UNALIGNED FFPIPHeader         *IpHeader,
+    IN     ULONG                          Hash,
+    IN     HANDLE                         OutgoingAdapter
+    )
+{
+    ULONG             hashindex;
+    USHORT           *restofpacket;
+    OldFFPCacheEntry *cacheentry;
+
+    hashindex = OldHashValue(Hash);
+
+    cacheentry = &OldCache[hashindex];
+
+    NdisAcquireSpinLock(&cacheentry->FFPCE_IPInfo.IPHI_SpinLock);
+
+    OldCacheValidBmp[hashindex] = 1;
+
+    restofpacket = (USHORT *) ((UCHAR *)IpHeader + 20);
+
+    cacheentry->FFPCE_IPInfo.IPHI_DestAddress = IpHeader->Dest;
+    cacheentry->FFPCE_IPInfo.IPHI_SrcAddress  = IpHeader->Src;
+    cacheentry->FFPCE_IPInfo.IPHI_Protocol = IpHeader->Protocol;
+    cacheentry->FFPCE_IPInfo.IPHI_FirstWordAfterIPHeader = *restofpacket;
+    cacheentry->FFPCE_IPInfo.IPHI_SecondWordAfterIPHeader = *(restofpacket+1);
+    cacheentry->FFPCE_CacheEntryType = FFP_FORWARD_PACKET;
+    cacheentry->FFPCE_OutgoingAdapter = OutgoingAdapter;
+
+    NdisMoveMemory(&cacheentry->FFPCE_MACHeader,
+                   EthernetHeader,
+                   sizeof(EnetHeader));
+
+    NdisReleaseSpinLock(&cacheentry->FFPCE_IPInfo.IPHI_SpinLock);
+}
+
+BOOL
+OldAllocateCache (
+    IN     ULONG                           Entries
+    )
+{
+    ULONG             i;
+
+    OldCacheSize = Entries;
+    OldHashMask = Entries - 1;
+
+    for (OldHashShift = 16; Entries > 1; Entries >>= 1)
+    {
+        OldHashShift--;
+    }
+
+    OldCache = (OldFFPCacheEntry *)malloc(OldCacheSize * sizeof(OldFFPCacheEntry));
+    OldCacheValidBmp = (UCHAR *)calloc(OldCacheSize, sizeof(UCHAR));
+
+    if (OldCache == NULL || OldCacheValidBmp == NULL)
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < OldCacheSize; i++)
+    {
+        NdisAllocateSpinLock(&OldCache[i].FFPCE_IPInfo.IPHI_SpinLock);
+    }
+
+    return TRUE;
+}
+
+//
+// Replay
+//
+
+VOID
+CheckForwardedPacket (
+    IN OUT BenchThread                    *Thread,
+    IN     BenchPacket                    *Packet,
+    IN     BenchPacket                    *Scratch,
+    IN     ULONG                           Result,
+    IN     HANDLE                          OutgoingAdapter
+    )
+
+/*++
+
+  Routine Description
+
+      Counts a forwarded packet, and checks that it goes out
+      of the adapter its destination is routed to, with the
+      MAC header built for it and its TTL decremented.
+
+--*/
+{
+    if (Result == FFP_FORWARD_PACKET)
+    {
+        Thread->BT_Forwarded++;
+
+        if (OutgoingAdapter != ADAPTER_HANDLE(Packet->BP_Route) ||
+            *(ULONG UNALIGNED *)&Scratch->BP_Ethernet.EH_Dest.EA_Addr[2]
+                != Packet->BP_Ip.Dest ||
+            Scratch->BP_Ip.Ttl != Packet->BP_Ip.Ttl - 1)
+        {
+            Thread->BT_Mismatched++;
+        }
+    }
+    else
+    if (Result != FFP_INDICATE_PACKET)
+    {
+        Thread->BT_Mismatched++;
+    }
+}
+
+DWORD
+WINAPI
+ReplayThread (
+    IN     LPVOID                          Context
+    )
+
+/*++
+
+  Routine Description
+
+      Replays the trace BenchPasses times through the cache
+      or path the thread was started for, from the packet at
+      BT_First, counting forwarded and misrouted packets.
+
+--*/
+{
+    BenchThread      *thread = (BenchThread *)Context;
+    BenchPacket       scratch;        // Packet as the driver would see it
+    BenchPacket      *packet;         // Packet in the trace
+    EnetHeader        routedheader;   // MAC header IP would build
+    HANDLE            outgoingadapter;// Adapter FFP forwards to
+    ULONG             hash;           // Hash as FFP computes it
+    ULONG             retcode;        // Result of the lookup
+    ULONG             pass;
+    ULONG             i;
+    ULONG             n;
+
+    for (pass = 0; pass < BenchPasses; pass++)
+    {
+        for (n = 0, i = thread->BT_First; n < BenchPacketCount; n++, i++)
+        {
+            if (i == BenchPacketCount)
+            {
+                i = 0;
+            }
+
+            packet = &BenchPackets[i];
+            scratch = *packet;
+            outgoingadapter = NULL;
+
+            switch (thread->BT_Mode)
+            {
+            case BenchOldCache:
+                hash = OLD_INIT_HASH_VALUE(&scratch.BP_Ip) + scratch.BP_Ip.Protocol;
+
+                retcode = OldIsPacketInFastForwardingCache(&scratch.BP_Ethernet,
+                                                           &scratch.BP_Ip,
+                                                           &hash,
+                                                           &outgoingadapter);
+                if (retcode == FFP_INDICATE_PACKET)
+                {
+                    BuildRoutedHeader(packet, &routedheader);
+                    OldSeedFastForwardingCache(&routedheader,
+                                               &scratch.BP_Ip,
+                                               hash,
+                                               ADAPTER_HANDLE(packet->BP_Route));
+                }
+                break;
+
+            case BenchNewCache:
+                hash = INIT_HASH_VALUE(&scratch.BP_Ip) + PROTOCOL_HASH_VALUE(&scratch.BP_Ip);
+
+                retcode = IsPacketInFastForwardingCache(&scratch.BP_Ethernet,
+                                                        &scratch.BP_Ip,
+                                                        &hash,
+                                                        ADAPTER_HANDLE(0),
+                                                        &outgoingadapter);
+                if (retcode == FFP_INDICATE_PACKET)
+                {
+                    BuildRoutedHeader(packet, &routedheader);
+                    SeedFastForwardingCache(&routedheader,
+                                            &scratch.BP_Ip,
+                                            hash,
+                                            ADAPTER_HANDLE(0),
+                                            ADAPTER_HANDLE(packet->BP_Route),
+                                            FFP_FORWARD_PACKET);
+                }
+                break;
+
+            default:
+                retcode = CurrFFPFuncs->pFFPProcessReceivedPacket(&scratch.BP_Ethernet,
+                                                                  &scratch.BP_Ip,
+                                                                  ADAPTER_HANDLE(0),
+                                                                  &outgoingadapter);
+                if (retcode == FFP_INDICATE_PACKET)
+                {
+                    BuildRoutedHeader(packet, &scratch.BP_Ethernet);
+                    scratch.BP_Ip.Ttl--;
+                    CurrFFPFuncs->pFFPProcessSentPacket(&scratch.BP_Ethernet,
+                                                        &scratch.BP_Ip,
+                                                        ADAPTER_HANDLE(packet->BP_Route));
+                }
+                break;
+            }
+
+            CheckForwardedPacket(thread, packet, &scratch, retcode, outgoingadapter);
+        }
+    }
+
+    return 0;
+}
+
+DWORD
+WINAPI
+ReplayBatchThread (
+    IN     LPVOID                          Context
+    )
+
+/*++
+
+  Routine Description
+
+      Replays the trace BenchPasses times through the receive
+      path FFPBENCH_RECEIVE_BATCH packets at a time, as a
+      miniport indicating arrays of packets would, and sends
+      the packets that are not forwarded down the send path.
+
+--*/
+{
+    BenchThread      *thread = (BenchThread *)Context;
+    BenchPacket       scratch[FFPBENCH_RECEIVE_BATCH];
+    BenchPacket      *packet[FFPBENCH_RECEIVE_BATCH];
+    FFPReceivedPacket received[FFPBENCH_RECEIVE_BATCH];
+    ULONG             batchcount;
+    ULONG             pass;
+    ULONG             i;
+    ULONG             j;
+    ULONG             n;
+
+    for (pass = 0; pass < BenchPasses; pass++)
+    {
+        for (n = 0, i = thread->BT_First; n < BenchPacketCount; n += batchcount)
+        {
+            for (batchcount = 0;
+                 batchcount < FFPBENCH_RECEIVE_BATCH && n + batchcount < BenchPacketCount;
+                 batchcount++, i++)
+            {
+                if (i == BenchPacketCount)
+                {
+                    i = 0;
+                }
+
+                packet[batchcount] = &BenchPackets[i];
+                scratch[batchcount] = BenchPackets[i];
+
+                received[batchcount].FFPRP_EthernetHeader = &scratch[batchcount].BP_Ethernet;
+                received[batchcount].FFPRP_PacketHeader = &scratch[batchcount].BP_Ip;
+                received[batchcount].FFPRP_OutgoingAdapter = NULL;
+            }
+
+            CurrFFPFuncs->pFFPProcessReceivedPackets(received,
+                                                     batchcount,
+                                                     ADAPTER_HANDLE(0));
+
+            for (j = 0; j < batchcount; j++)
+            {
+                if (received[j].FFPRP_Result == FFP_INDICATE_PACKET)
+                {
+                    BuildRoutedHeader(packet[j], &scratch[j].BP_Ethernet);
+                    scratch[j].BP_Ip.Ttl--;
+                    CurrFFPFuncs->pFFPProcessSentPacket(&scratch[j].BP_Ethernet,
+                                                        &scratch[j].BP_Ip,
+                                                        ADAPTER_HANDLE(packet[j]->BP_Route));
+                }
+
+                CheckForwardedPacket(thread,
+                                     packet[j],
+                                     &scratch[j],
+                                     received[j].FFPRP_Result,
+                                     received[j].FFPRP_OutgoingAdapter);
+            }
+        }
+    }
+
+    return 0;
+}
+
+ULONG
+RunReplay (
+    IN     BenchMode                       Mode,
+    IN     const char                     *Name,
+    IN     ULONG                           Threads
+    )
+{
+    BenchThread       thread[FFPBENCH_MAX_THREADS];
+    HANDLE            handle[FFPBENCH_MAX_THREADS];
+    LARGE_INTEGER     frequency;
+    LARGE_INTEGER     start;
+    LARGE_INTEGER     stop;
+    double            seconds;
+    double            packets;
+    ULONG             forwarded = 0;
+    ULONG             mismatched = 0;
+    ULONG             i;
+
+    for (i = 0; i < Threads; i++)
+    {
+        thread[i].BT_Mode = Mode;
+        thread[i].BT_First = (ULONG)((ULONGLONG)BenchPacketCount * i / Threads);
+        thread[i].BT_Forwarded = 0;
+        thread[i].BT_Mismatched = 0;
+    }
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+
+    if (Threads == 1)
+    {
+        if (Mode == BenchBatchPath)
+        {
+            ReplayBatchThread(&thread[0]);
+        }
+        else
+        {
+            ReplayThread(&thread[0]);
+        }
+    }
+    else
+    {
+        for (i = 0; i < Threads; i++)
+        {
+            handle[i] = CreateThread(NULL,
+                                     0,
+                                     Mode == BenchBatchPath ? ReplayBatchThread
+                                                            : ReplayThread,
+                                     &thread[i],
+                                     0,
+                                     NULL);
+        }
+
+        WaitForMultipleObjects(Threads, handle, TRUE, INFINITE);
+
+        for (i = 0; i < Threads; i++)
+        {
+            CloseHandle(handle[i]);
+        }
+    }
+
+    QueryPerformanceCounter(&stop);
+
+    for (i = 0; i < Threads; i++)
+    {
+        forwarded += thread[i].BT_Forwarded;
+        mismatched += thread[i].BT_Mismatched;
+    }
+
+    seconds = (double)(stop.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+    packets = (double)BenchPacketCount * BenchPasses * Threads;
+
+    printf("%-30s %7.2f%% forwarded %8.1f ns/packet %8.2f Mpps",
+           Name,
+           100.0 * forwarded / packets,
+           seconds * 1e9 / packets,
+           packets / seconds / 1e6);
+
+    if (mismatched)
+    {
+        printf("  %lu MISROUTED", mismatched);
+    }
+
+    printf("\n");
+
+    return mismatched;
+}
+
+//
+// Traces
+//
+
+BOOL
+IsPacketForwardable (
+    IN     BenchPacket                    *Packet
+    )
+
+/*++
+
+  Routine Description
+
+      Keeps the packets that the fast forwarding cache would
+      handle at all - unfragmented IPv4 without options, TTL
+      above 1, not multicast or broadcast.
+
+--*/
+{
+    return IsPacketFastForwardingWorthy(&Packet->BP_Ethernet, &Packet->BP_Ip) &&
+           !TTL_PKT_EXPIRED(&Packet->BP_Ip) &&
+           NOT_FRAGMENTED(&Packet->BP_Ip);
+}
+
+ULONG
+SwapULong (
+    IN     ULONG                           Value,
+    IN     BOOL                            Swap
+    )
+{
+    if (!Swap)
+    {
+        return Value;
+    }
+
+    return (Value >> 24) | ((Value >> 8) & 0xFF00) |
+           ((Value << 8) & 0xFF0000) | (Value << 24);
+}
+
+BOOL
+LoadPcapTrace (
+    IN     const char                     *FileName,
+    IN     ULONG                           MaxPackets
+    )
+
+/*++
+
+  Routine Description
+
+      Reads the packets of a libpcap file with ethernet framing,
+      up to MaxPackets of those the cache could forward.
+
+--*/
+{
+    FILE             *file;
+    ULONG             globalheader[6];  // Magic ... link type
+    ULONG             recordheader[4];  // Seconds, fraction, captured, length
+    UCHAR             frame[sizeof(EnetHeader) + sizeof(FFPIPHeader) + sizeof(ULONG)];
+    BenchPacket      *packet;
+    ULONG             captured;
+    ULONG             skipped = 0;
+    BOOL              swap;
+
+    file = fopen(FileName, "rb");
+
+    if (file == NULL)
+    {
+        printf("ffpbench: cannot open %s\n", FileName);
+        return FALSE;
+    }
+
+    if (fread(globalheader, 24, 1, file) != 1)
+    {
+        globalheader[0] = 0;
+    }
+
+    swap = (globalheader[0] == 0xD4C3B2A1 || globalheader[0] == 0x4D3CB2A1);
+
+    if ((!swap && globalheader[0] != 0xA1B2C3D4 && globalheader[0] != 0xA1B23C4D) ||
+        SwapULong(globalheader[5], swap) != 1)
+    {
+        printf("ffpbench: %s is not an ethernet libpcap file\n", FileName);
+        fclose(file);
+        return FALSE;
+    }
+
+    BenchPackets = (BenchPacket *)malloc(MaxPackets * sizeof(BenchPacket));
+
+    if (BenchPackets == NULL)
+    {
+        fclose(file);
+        return FALSE;
+    }
+
+    while (BenchPacketCount < MaxPackets &&
+           fread(recordheader, sizeof(recordheader), 1, file) == 1)
+    {
+        captured = SwapULong(recordheader[2], swap);
+
+        if (captured < sizeof(frame))
+        {
+            fseek(file, captured, SEEK_CUR);
+            skipped++;
+            continue;
+        }
+
+        if (fread(frame, sizeof(frame), 1, file) != 1)
+        {
+            break;
+        }
+
+        fseek(file, captured - sizeof(frame), SEEK_CUR);
+
+        packet = &BenchPackets[BenchPacketCount];
+
+        NdisMoveMemory(&packet->BP_Ethernet, frame, sizeof(EnetHeader));
+        NdisMoveMemory(&packet->BP_Ip,
+                       frame + sizeof(EnetHeader),
+                       sizeof(FFPIPHeader) + sizeof(ULONG));
+
+        if (!IsPacketForwardable(packet))
+        {
+            skipped++;
+            continue;
+        }
+
+        packet->BP_Route = ROUTE_FOR_DEST(packet->BP_Ip.Dest);
+        BenchPacketCount++;
+    }
+
+    fclose(file);
+
+    printf("%s: %lu packets replayed, %lu skipped (not forwardable)\n",
+           FileName, BenchPacketCount, skipped);
+
+    return BenchPacketCount != 0;
+}
+
+ULONG
+NextRandom (
+    IN OUT ULONG                          *Seed
+    )
+{
+    *Seed = *Seed * 1664525 + 1013904223;
+    return *Seed;
+}
+
+#define NET_USHORT(Value)   ((USHORT)((((Value) & 0xFF) << 8) | ((Value) >> 8)))
+
+#define FFPBENCH_SCANNERS               8
+#define FFPBENCH_SCANNED_PORTS          64
+
+BOOL
+MakeSyntheticTrace (
+    IN     ULONG                           Flows,
+    IN     ULONG                           Packets,
+    IN     BOOL                            Scan
+    )
+
+/*++
+
+  Routine Description
+
+      Makes a trace of Packets TCP and UDP packets over Flows
+      flows, a few of them carrying most of the packets as on
+      a real link (flow popularity falls off as a cube).
+
+      With Scan, the flows are FFPBENCH_SCANNERS hosts probing
+      the first FFPBENCH_SCANNED_PORTS TCP ports of one address
+      after another, and the replies to the probes - every other
+      flow is the reverse of the one before it.
+
+--*/
+{
+    BenchPacket      *flows;
+    BenchPacket      *packet;
+    ULONG             seed = 0x1999;
+    ULONG             probe;
+    ULONG             scanner;
+    ULONG             target;
+    ULONG             port;
+    ULONG             i;
+    double            u;
+
+    flows = (BenchPacket *)malloc(Flows * sizeof(BenchPacket));
+    BenchPackets = (BenchPacket *)malloc(Packets * sizeof(BenchPacket));
+
+    if (flows == NULL || BenchPackets == NULL)
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < Flows; i++)
+    {
+        packet = &flows[i];
+
+        NdisZeroMemory(packet, sizeof(BenchPacket));
+
+        packet->BP_Ethernet.EH_Dest.EA_Addr[0] = 0x02;
+        packet->BP_Ethernet.EH_Src.EA_Addr[0] = 0x02;
+        packet->BP_Ethernet.EH_Src.EA_Addr[5] = 0x01;
+        packet->BP_Ethernet.EH_Type = 0x0008;
+
+        packet->BP_Ip.Verlen = 0x45;
+        packet->BP_Ip.Length = 0x2800;
+        packet->BP_Ip.Offset = 0x0040;                  // Don't fragment
+        packet->BP_Ip.Ttl = 64;
+        if (Scan)
+        {
+            probe = i / 2;
+            scanner = probe % FFPBENCH_SCANNERS;
+            target = probe / FFPBENCH_SCANNERS / FFPBENCH_SCANNED_PORTS;
+            port = 1 + probe / FFPBENCH_SCANNERS % FFPBENCH_SCANNED_PORTS;
+
+            packet->BP_Ip.Protocol = IPPROTO_TCP;
+            packet->BP_Ip.Src = 0x0A | ((1 + scanner) << 24);
+            packet->BP_Ip.Dest = 0x10AC | ((target & 0xFF00) << 8) | (target << 24);
+            packet->BP_DwordAfterIPHeader = NET_USHORT(40000 + scanner) 
+                                                | (NET_USHORT(port) << 16);
+
+            if (i & 1)
+            {
+                port = packet->BP_Ip.Src;
+                packet->BP_Ip.Src = packet->BP_Ip.Dest;
+                packet->BP_Ip.Dest = port;
+                packet->BP_DwordAfterIPHeader = 
+                    (packet->BP_DwordAfterIPHeader >> 16) |
+                    (packet->BP_DwordAfterIPHeader << 16);
+            }
+        }
+        else
+        {
+            packet->BP_Ip.Protocol = (NextRandom(&seed) >> 24) < 40 ? IPPROTO_UDP
+                                                                    : IPPROTO_TCP;
+            packet->BP_Ip.Src = 0x0A | (NextRandom(&seed) & 0xFFFFFF00);
+            packet->BP_Ip.Dest = 0xAC | (NextRandom(&seed) & 0xFFFF0F00) | 0x1000;
+            packet->BP_DwordAfterIPHeader = NextRandom(&seed);
+        }
+
+        packet->BP_Route = ROUTE_FOR_DEST(packet->BP_Ip.Dest);
+    }
+
+    for (i = 0; i < Packets; i++)
+    {
+        u = (NextRandom(&seed) >> 8) / (double)(1 << 24);
+
+        BenchPackets[i] = flows[(ULONG)(u * u * u * Flows)];
+        BenchPackets[i].BP_Ip.Id = (USHORT)i;
+    }
+
+    BenchPacketCount = Packets;
+
+    free(flows);
+
+    printf("synthetic%s: %lu packets over %lu flows\n", 
+           Scan ? " port scans" : "", Packets, Flows);
+
+    return TRUE;
+}
+
+//
+// Statistics
+//
+
+VOID
+PrintCacheStatistics (
+    VOID
+    )
+
+/*++
+
+  Routine Description
+
+      Queries OID_FFP_CACHE_STATS as a protocol would, and
+      prints the counters of each cache and the heavy flows.
+
+--*/
+{
+    static const char *cachenames[FFP_CACHES] = { "fast forwarding",
+                                                  "incoming",
+                                                  "fragment" };
+    FFPCacheStats     stats;
+    ULONG             written;
+    ULONG             needed;
+    ULONG             i;
+
+    stats.NdisProtocolType = NDIS_PROTOCOL_ID_TCP_IP;
+
+    if (FFPHandleOidQueryRequest(ADAPTER_HANDLE(0),
+                                 OID_FFP_CACHE_STATS,
+                                 &stats,
+                                 sizeof(stats),
+                                 &written,
+                                 &needed) != NDIS_STATUS_SUCCESS)
+    {
+        printf("ffpbench: OID_FFP_CACHE_STATS failed\n");
+        return;
+    }
+
+    printf("\n%-16s %10s %10s %10s %10s %8s\n",
+           "cache", "lookups", "hits", "seeds", "evictions", "busy");
+
+    for (i = 0; i < FFP_CACHES; i++)
+    {
+        printf("%-16s %10lu %10lu %10lu %10lu %8lu\n",
+               cachenames[i],
+               stats.Caches[i].FFPCC_Lookups,
+               stats.Caches[i].FFPCC_Hits,
+               stats.Caches[i].FFPCC_Seeds,
+               stats.Caches[i].FFPCC_Evictions,
+               stats.Caches[i].FFPCC_Busy);
+    }
+
+    printf("\nsets by valid ways:");
+
+    for (i = 0; i <= FFCACHE_WAYS; i++)
+    {
+        printf(" %lu", stats.SetOccupancy[i]);
+    }
+
+    printf("; forward entries %lu, incoming entries %lu\n",
+           stats.EntriesByType[FFP_FORWARD_PACKET + 1],
+           stats.IncomingCacheEntries);
+
+    printf("\nheaviest flows (1 in %lu packets sampled):\n", stats.FlowSampleRate);
+
+    for (i = 0; i < stats.TopFlowCount && i < 5; i++)
+    {
+        printf("  %08lX -> %08lX proto %2u ports %08lX  %8lu sampled (+/- %lu)\n",
+               stats.TopFlows[i].FFPFS_SrcAddress,
+               stats.TopFlows[i].FFPFS_DestAddress,
+               stats.TopFlows[i].FFPFS_Protocol,
+               stats.TopFlows[i].FFPFS_DwordAfterIPHeader,
+               stats.TopFlows[i].FFPFS_Packets,
+               stats.TopFlows[i].FFPFS_Error);
+    }
+}
+
+//
+// Main
+//
+
+ULONG
+CacheBytesForEntries (
+    IN     ULONG                           Entries
+    )
+
+/*++
+
+  Routine Description
+
+      Number of bytes to size the caches with (OID_FFP_PARAMS)
+      for a fast forwarding cache of Entries entries.
+
+--*/
+{
+    return (Entries >> FFCACHE_WAYS_SHIFT) * (sizeof(FFPCacheSet) + sizeof(UCHAR)) +
+           (DEFAULT_INCOMING_CACHE_ENTRIES + DEFAULT_FRAGMENT_CACHE_ENTRIES)
+                * (sizeof(IPHeaderInfo) + 2*sizeof(UCHAR));
+}
+
+int
+__cdecl
+main (
+    int                                    argc,
+    char                                  *argv[]
+    )
+{
+    ULONG             entries = FFPBENCH_DEFAULT_ENTRIES;
+    ULONG             flows = FFPBENCH_DEFAULT_FLOWS;
+    ULONG             packets = FFPBENCH_DEFAULT_PACKETS;
+    ULONG             threads = 1;
+    ULONG             resizeentries = 0;
+    BOOL              scan = FALSE;
+    ULONG             cachebytes;
+    ULONG             mismatched = 0;
+    const char       *tracefile = NULL;
+    char              name[32];
+    int               i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            switch (argv[i][1])
+            {
+            case 'c': entries = strtoul(argv[i] + 2, NULL, 0); continue;
+            case 'f': flows = strtoul(argv[i] + 2, NULL, 0); continue;
+            case 'p': packets = strtoul(argv[i] + 2, NULL, 0); continue;
+            case 'n': BenchPasses = strtoul(argv[i] + 2, NULL, 0); continue;
+            case 't': threads = strtoul(argv[i] + 2, NULL, 0); continue;
+            case 'r': resizeentries = strtoul(argv[i] + 2, NULL, 0); continue;
+            case 's': scan = TRUE; continue;
+            }
+        }
+        else
+        if (tracefile == NULL)
+        {
+            tracefile = argv[i];
+            continue;
+        }
+
+        printf("usage: ffpbench [-c<entries>] [-f<flows>] [-p<packets>] "
+               "[-n<passes>] [-t<threads>] [-r<entries>] [-s] [trace.pcap]\n");
+        return 2;
+    }
+
+    if (flows == 0 || packets == 0 || BenchPasses == 0 ||
+        threads == 0 || threads > FFPBENCH_MAX_THREADS)
+    {
+        printf("ffpbench: bad flow, packet, pass or thread count\n");
+        return 2;
+    }
+
+    if (tracefile ? !LoadPcapTrace(tracefile, packets)
+                  : !MakeSyntheticTrace(flows, packets, scan))
+    {
+        return 2;
+    }
+
+    //
+    // Bring up FFP as a driver would, sizing the caches
+    // in bytes (OID_FFP_PARAMS) for the number of entries
+    // asked for; the original layout gets as many entries
+    //
+
+    FFPStartup();
+
+    FFPSetControlFlags(CF_FFENABLED | CF_FILTERING, CF_FFENABLED | CF_FILTERING);
+
+    if (FFPSetParameters(CacheBytesForEntries(entries)) != NDIS_STATUS_SUCCESS ||
+        !OldAllocateCache(FastForwardingCacheSize))
+    {
+        printf("ffpbench: cannot allocate the caches\n");
+        return 2;
+    }
+
+    FFPGetParameters(&cachebytes);
+
+    printf("%lu entries: direct mapped %lu bytes, %u-way %lu bytes (%lu sets), "
+           "%lu pass(es) on %lu thread(s)\n\n",
+           FastForwardingCacheSize,
+           OldCacheSize * (sizeof(OldFFPCacheEntry) + sizeof(UCHAR)),
+           FFCACHE_WAYS,
+           FastForwardingCacheSets * (sizeof(FFPCacheSet) + sizeof(UCHAR)),
+           FastForwardingCacheSets,
+           BenchPasses,
+           threads);
+
+    mismatched += RunReplay(BenchOldCache, "direct mapped, entry locks", threads);
+
+    FFPFlushCaches();
+    mismatched += RunReplay(BenchNewCache, "set associative, lock-free", threads);
+
+    FFPFlushCaches();
+    mismatched += RunReplay(BenchFullPath, "receive and send path", threads);
+
+    FFPFlushCaches();
+    mismatched += RunReplay(BenchBatchPath, "batched receive and send path", threads);
+
+    //
+    // Resize the cache as warmed up by the batched path,
+    // and replay the whole path while the entries move
+    //
+
+    if (resizeentries)
+    {
+        if (FFPSetParameters(CacheBytesForEntries(resizeentries)) != NDIS_STATUS_SUCCESS)
+        {
+            printf("ffpbench: cannot resize the cache\n");
+            return 2;
+        }
+
+        sprintf(name, "resized to %lu entries", FastForwardingCacheSize);
+        mismatched += RunReplay(BenchFullPath, name, threads);
+    }
+
+    PrintCacheStatistics();
+
+    FFPShutdown();
+
+    if (mismatched)
+    {
+        printf("\nFAILED: %lu packets forwarded to the wrong adapter\n", mismatched);
+        return 1;
+    }
+
+    printf("\nAll forwarded packets took their learned route\n");
+
+    return 0;
+}
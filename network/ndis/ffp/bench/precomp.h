@@ -0,0 +1,178 @@
+/*++
+
+Copyright (c) 1999  Microsoft Corporation
+
+Module Name:
+
+  precomp.h
+
+Abstract:
+
+  Header for ffpbench, the user-mode harness for the FFP caches. It
+  stands in for the miniport that normally hosts the FFP code (see
+  ffp.htm), mapping the few NDIS services FFP uses onto Win32 and
+  providing the adapter macros FFP expects of its driver.
+
+Revision History:
+
+--*/
+
+#ifndef __FFP_BENCH_PRECOMP_H
+#define __FFP_BENCH_PRECOMP_H
+
+#include <windows.h>
+#include <ntddndis.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef FASTCALL
+#define FASTCALL                        __fastcall
+#endif
+
+//
+// NDIS types and status codes
+//
+
+typedef ULONG                           NDIS_STATUS;
+typedef PVOID                           NDIS_HANDLE;
+typedef LARGE_INTEGER                   NDIS_PHYSICAL_ADDRESS;
+
+#define NDIS_STATUS_SUCCESS             ((NDIS_STATUS)0x00000000L)
+#define NDIS_STATUS_RESOURCES           ((NDIS_STATUS)0xC000009AL)
+#define NDIS_STATUS_NOT_SUPPORTED       ((NDIS_STATUS)0xC00000BBL)
+#define NDIS_STATUS_INVALID_LENGTH      ((NDIS_STATUS)0xC0010014L)
+#define NDIS_STATUS_INVALID_DATA        ((NDIS_STATUS)0xC0010015L)
+
+#define NDIS_PROTOCOL_ID_TCP_IP         0x02
+
+#ifndef NT_SUCCESS
+#define NT_SUCCESS(Status)              ((LONG)(Status) >= 0)
+#endif
+
+#define DbgPrint                        printf
+
+#define KeMemoryBarrier()               MemoryBarrier()
+
+#define NdisGetCurrentSystemTime(_SystemTime_)                                \
+    GetSystemTimeAsFileTime((LPFILETIME)(_SystemTime_))
+
+#define KeGetCurrentProcessorNumber()   GetCurrentProcessorNumber()
+
+//
+// Memory
+//
+
+#define NdisAllocateMemory(_VirtualAddress_, _Length_, _Flags_, _Highest_)    \
+    ((*(PVOID *)(_VirtualAddress_) = malloc(_Length_)) != NULL                \
+        ? NDIS_STATUS_SUCCESS : NDIS_STATUS_RESOURCES)
+
+#define NdisFreeMemory(_VirtualAddress_, _Length_, _Flags_)                   \
+    free(_VirtualAddress_)
+
+#define NdisZeroMemory(_Destination_, _Length_)                               \
+    ZeroMemory(_Destination_, _Length_)
+
+#define NdisMoveMemory(_Destination_, _Source_, _Length_)                     \
+    MoveMemory(_Destination_, _Source_, _Length_)
+
+#define NdisSetPhysicalAddressHigh(_PhysicalAddress_, _Value_)                \
+    ((_PhysicalAddress_).HighPart = (_Value_))
+
+#define NdisSetPhysicalAddressLow(_PhysicalAddress_, _Value_)                 \
+    ((_PhysicalAddress_).LowPart = (_Value_))
+
+//
+// Spin locks - an interlocked exchange to acquire, as the
+// uncontended kernel spin lock costs at DISPATCH_LEVEL
+//
+
+typedef struct _NDIS_SPIN_LOCK
+{
+    LONG volatile   Lock;
+} NDIS_SPIN_LOCK, *PNDIS_SPIN_LOCK;
+
+#define NdisAllocateSpinLock(_SpinLock_)    ((_SpinLock_)->Lock = 0)
+#define NdisFreeSpinLock(_SpinLock_)
+
+#define NdisAcquireSpinLock(_SpinLock_)                                       \
+    while (InterlockedExchange((PLONG)&(_SpinLock_)->Lock, 1))                \
+        YieldProcessor()
+
+#define NdisReleaseSpinLock(_SpinLock_)                                       \
+    InterlockedExchange((PLONG)&(_SpinLock_)->Lock, 0)
+
+//
+// Packets and buffers - only enough for FFPOnPacketSendPath to
+// compile; the harness calls the FFP packet routines directly
+//
+
+typedef struct _NDIS_BUFFER
+{
+    struct _NDIS_BUFFER    *Next;
+    PVOID                   VirtualAddress;
+    UINT                    Length;
+} NDIS_BUFFER, *PNDIS_BUFFER;
+
+typedef struct _NDIS_PACKET
+{
+    PNDIS_BUFFER            Head;
+    UINT                    BufferCount;
+    UINT                    TotalLength;
+} NDIS_PACKET, *PNDIS_PACKET;
+
+#define NdisQueryPacket(_Packet_, _PhysicalBufferCount_, _BufferCount_,       \
+                        _FirstBuffer_, _TotalPacketLength_)                   \
+{                                                                             \
+    *(_PhysicalBufferCount_) = (_Packet_)->BufferCount;                       \
+    *(_BufferCount_)         = (_Packet_)->BufferCount;                       \
+    *(_FirstBuffer_)         = (_Packet_)->Head;                              \
+    *(_TotalPacketLength_)   = (_Packet_)->TotalLength;                       \
+}
+
+#define NdisQueryBuffer(_Buffer_, _VirtualAddress_, _Length_)                 \
+{                                                                             \
+    *(PVOID *)(_VirtualAddress_) = (_Buffer_)->VirtualAddress;                \
+    *(_Length_)                  = (_Buffer_)->Length;                        \
+}
+
+#define NdisGetNextBuffer(_CurrentBuffer_, _NextBuffer_)                      \
+    (*(_NextBuffer_) = (_CurrentBuffer_)->Next)
+
+#define NdisFlushBuffer(_Buffer_, _WriteToDevice_)
+
+//
+// FFP support
+//
+
+#if FFP_SUPPORT
+
+#include "ffp-def.h"
+
+//
+// The harness's adapters
+//
+
+#define FFPBENCH_ADAPTERS               4
+
+typedef struct _FFPBENCH_ADAPTER
+{
+    FFPAdapterStats         FFPStats;          // FFP Stats on this adapter
+} FFPBENCH_ADAPTER;
+
+extern FFPBENCH_ADAPTER     FFPBenchAdapters[FFPBENCH_ADAPTERS];
+
+#define FFP_ADAPTER_STATS(_MiniportAdapter_)                                  \
+    (&(((FFPBENCH_ADAPTER *)(_MiniportAdapter_))->FFPStats))
+
+#define GET_FIRST_ADAPTER()                                                   \
+    ((PVOID)&FFPBenchAdapters[0])
+
+#define ARE_ADAPTERS_LEFT(_CurrAdapter_)                                      \
+    (((FFPBENCH_ADAPTER *)(_CurrAdapter_)) < &FFPBenchAdapters[FFPBENCH_ADAPTERS])
+
+#define GET_NEXT_ADAPTER(_CurrAdapter_)                                       \
+    ((PVOID)(((FFPBENCH_ADAPTER *)(_CurrAdapter_)) + 1))
+
+#endif // FFP_SUPPORT
+
+#endif // __FFP_BENCH_PRECOMP_H
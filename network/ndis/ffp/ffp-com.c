@@ -30,48 +30,19 @@ HashValue (
 
   Routine Description
 
-      Calculate the hash value given a 32-bit word. The
-      hash computation has been changed from being
-      a V Mod M , to this "wierd" scheme to avoid the
-      DIV instruction that caused a big slowdown in
-      the fast path. Initially (and ideally) the hash
-      code was 
-         return Value % FastForwardingCacheSize;
-
-      Basically given a 32 bit word, we add the first 
-      half with the second half to get a 16 bit word. 
-      Then the first half (byte) in the word is added
-      to the second one (byte) after a shift. This 
-      operation is actually accomplished by adding the
-      word to itself at an offset and ANDing the extra 
-      bits out.
-
-      Assume dword  is     A B C D
-              =>    Adding the first and second half =>     A    B
-                                                       +    C    D
-                                                            ------
-                                                            X    Y
-                                                            ------
-
-      Then we get the hash value as =>    (X >> Shift) + Y 
-      [ This would reduce the range from 2^16 to 2^N (8 <= N <= 16) ]
-
-      As we add the first two words in the dword, we optimize all 
-      "Add TCP Src Port + Dst Port Words" operations by 
-      doing "Add Src Port + Dst Port Dword" [ Saves time as 32 bit
-      operations are faster than 8 or 16 bit operations ]
-
-      The hash computation has been changed - now instead of adding 
-      the source , destination ports, we add the whole dword [ just
-      as we always did in ICMP case when we add the type/code word ].
-      This can be done because - as part of the hash computation we 
-      are adding the first and second words resulting indirectly in
-      the addition of the source and destination ports.
-
-      Note that this hash has approximately the same cyclic behavior
-      for values of hash sizes = 2^N, for (8 <= N <= 16) as the mod
-      function.
-      
+      Calculate the fast forwarding cache set a flow hashes
+      to, given its 32-bit hash (see INIT_HASH_VALUE). The
+      hash is mixed once more with a key of its own and the
+      high bits of the product taken - they depend on every
+      bit of the hash, unlike its low bits. The number of
+      sets is a power of 2, so this needs neither a DIV
+      nor a mask.
+
+      As the high bits are taken, a flow's set in a cache
+      with 2^N sets is its set in a cache with 2^(N+1) sets
+      shifted right by a bit. A resize moves entries between
+      sets that way (see MigrateFastForwardingSets).
+
   Arguments
 
     Value    -    The 32 bit value that we are hashing
@@ -83,10 +54,7 @@ HashValue (
 --*/
 
 {
-    *((USHORT *) &Value) += *( ((USHORT *) &Value) + 1 );
-    *((USHORT *) &Value) += *( ((USHORT *) &Value)) >> FFHashShift;
-    Value &= FFHashMask;
-    return Value;
+    return FOLD_HASH_VALUE(Value, FFHashShift);
 }
 
 __inline
@@ -142,13 +110,186 @@ IsPacketFastForwardingWorthy (
 }
 
 
+static
+__inline
+ULONG
+TouchCacheWay (
+    IN               ULONG                LruOrder,
+    IN               ULONG                Way
+    )
+
+/*++
+
+  Routine Description
+
+      Moves a way to the front of a set's LRU order. The order
+      holds each way number of the set in a nibble, the most 
+      recently used way in the lowest one. Lookups update the
+      order without owning the set; the order is always stored
+      whole, so at worst one of two racing updates is lost.
+
+  Arguments
+
+    LruOrder - The set's current LRU order
+    Way      - The way that was just used
+
+  Return Value
+
+        The new LRU order
+
+--*/
+
+{
+    ULONG position;
+    ULONG above;
+    ULONG below;
+
+    for (position = 0; position < FFCACHE_WAYS - 1; position++)
+    {
+        if (((LruOrder >> (4 * position)) & 0xF) == Way)
+        {
+            break;
+        }
+    }
+
+    //
+    // Drop the way's nibble, shift the ways used more
+    // recently up by a nibble and put the way in front
+    //
+
+    above = ((LruOrder >> (4 * position)) >> 4) << 4 << (4 * position);
+    below = LruOrder & ((1 << (4 * position)) - 1);
+
+    return above | (below << 4) | Way;
+}
+
+static
+__inline
+ULONG
+IsFlowInCacheEntry (
+    IN     UNALIGNED FFPIPHeader         *IpHeader,
+    IN     FFPCacheEntry volatile        *CacheEntry
+    )
+
+/*++
+
+  Routine Description
+
+      Compares the exact flow fields of a packet with those
+      of a fast forwarding cache entry - since hash collisions
+      can happen and several flows share a set
+
+  Arguments
+
+      IpHeader   - pointer to atleast 24 bytes of the ip header.
+      CacheEntry - The cache entry the packet is compared with
+
+  Return Value
+
+        TRUE or FALSE
+
+--*/
+
+{
+#if __FILTER__
+    UCHAR            *restofpacket;   // Pointer to byte after the IP header
+#endif
+
+    if (   IpHeader->Dest     != CacheEntry->FFPCE_DestAddress 
+        || IpHeader->Src      != CacheEntry->FFPCE_SrcAddress
+#if __FILTER__
+        || IpHeader->Protocol != CacheEntry->FFPCE_Protocol
+#endif
+        )
+    {
+        return FALSE;
+    }
+
+#if __FILTER__
+    restofpacket = (UCHAR *)IpHeader + 20;
+
+    switch (IpHeader->Protocol)
+    {
+    case IPPROTO_UDP:
+    case IPPROTO_TCP:
+        if (*((ULONG *) restofpacket) != *((ULONG volatile *) 
+             &(CacheEntry->FFPCE_FirstWordAfterIPHeader)))
+        {
+            return FALSE;
+        }
+        
+        break;
+
+    case IPPROTO_ICMP:
+        if (*((USHORT *) restofpacket) != 
+             CacheEntry->FFPCE_FirstWordAfterIPHeader)
+        {
+            return FALSE;
+        }
+    }
+#endif
+
+    return TRUE;
+}
+
+#if __FILTER__
+
+static
+__inline
+VOID
+AddPortsToHash (
+    IN     UNALIGNED FFPIPHeader         *IpHeader,
+    IN OUT ULONG                         *Hash
+    )
+
+/*++
+
+  Routine Description
+
+      Adds the TCP/UDP src/dest ports dword (or) the ICMP
+      type/code word of a packet to its hash, which comes
+      in as src addr + dst addr + protocol.
+
+  Arguments
+
+      IpHeader - pointer to atleast 24 bytes of the ip header.
+      Hash     - Hash = src addr + dst addr + protocol for the packet
+                 on entry into this function
+
+  Return Value
+
+        None
+
+--*/
+
+{
+    UCHAR            *restofpacket;   // Pointer to byte after the IP header
+
+    restofpacket = (UCHAR *)IpHeader + 20;
+
+    switch (IpHeader->Protocol)
+    {
+        case IPPROTO_TCP:
+        case IPPROTO_UDP:
+            *Hash += PORTS_HASH_VALUE(*((ULONG *)restofpacket));
+            break;
+                    
+        case IPPROTO_ICMP:
+            *Hash += PORTS_HASH_VALUE(*((USHORT *)restofpacket));
+    }
+}
+
+#endif
+
 static
 ULONG
 FASTCALL
-IsPacketInFastForwardingCache (
+LookupForwardingCacheSet (
     IN     UNALIGNED EnetHeader          *EthernetHeader,
     IN     UNALIGNED FFPIPHeader         *IpHeader,
-    IN OUT ULONG                         *Hash, 
+    IN     ULONG                          Hash, 
+    IN     FFPCacheSet volatile          *CacheSet, 
+    IN     UCHAR volatile                *CacheSetValidWays, 
     IN     HANDLE                         IncomingAdapter, 
     OUT    HANDLE                        *OutgoingAdapter
     )
@@ -157,19 +298,23 @@ IsPacketInFastForwardingCache (
 
   Routine Description
 
-      Checks the fast forwarding cache. If packet is found as a
-      positive cache entry, it updates the ethernet header and
-      fixes the ttl and checksum and updates the adapter context
-      the packet should be forwarded to. Assumes incoming 'hash'
-      = src addr + dst addr + protocol, and fixes it to add the
-      TCP/UDP src/dest ports dword (or) the ICMP type/code word.
+      Looks the packet up in a set of a fast forwarding cache
+      (the one the packet hashes to). If packet is found as a positive cache entry,
+      it updates the ethernet header and fixes the ttl and checksum
+      and updates the adapter context the packet should be forwarded
+      to.
+
+      Takes no lock - see FFPCacheSet. A lookup that races with
+      a change to the set returns FFP_INDICATE_PACKET.
 
   Arguments
 
       EthernetHeader  - ethernet header in which the packet is encapsulated
+                        (NULL to only query the cache),
       IpHeader        - pointer to atleast 24 bytes of the ip header.
-      Hash            - Hash = src addr + dst addr + protocol for the packet
-                        on entry into this function,
+      Hash            - Hash = src addr + dst addr + protocol + ports info,
+      CacheSet        - The set the packet hashes to,
+      CacheSetValidWays - The set's byte of the cache's valid bitmap,
       IncomingAdapter - Handle of the adapter on which the packet came in
                         (currently not used at all),
       OutgoingAdapter - Handle to adapter context on which pkt to be fwded
@@ -182,113 +327,64 @@ IsPacketInFastForwardingCache (
 
 --*/
 {
-    ULONG             hashindex;      // Bucket into which packet would hash
+    ULONG             validways;      // Ways of the set holding an entry
+    ULONG             way;            // Way of the set being compared
+    LONG              sequence;       // Sequence number of the set on entry
+    ULONG             lruorder;       // LRU order of the set
+#if __FILTER__
     UCHAR            *restofpacket;   // Pointer to byte after the IP header
-    FFPCacheEntry    *cacheentry;     // Fast fwding cache entry for this query
+#endif
+    FFPCacheSet volatile   *cacheset;   // Set of the fast fwding cache
+    FFPCacheEntry volatile *cacheentry; // Fast fwding cache entry for query
     LONG              cacheentrytype; // Type of above fast forwarding entry
-
-    //
-    // To lookup in cache we must add the relevant fields. They are:
-    // (dest address, src address, protocol)
-    // if IPPROTO_TCP or udp - (src,dest dword)
-    // if icmp - (type,code word in the pkt)
-    //
-    // Hash value here = IpHeader->Dest+IpHeader->Src+IpHeader->Protocol;
-    //
+    HANDLE            outgoingadapter;// Outgoing adapter in the above entry
+    EnetHeader        macheader;      // MAC header in the above entry
 
 #if __FILTER__
     restofpacket = (UCHAR *)IpHeader + 20;
-
-#if FFP_DEBUG
-    FFPDbgPrint(("ROP = %08X, Inc Adap = %08X, ", 
-                 *((ULONG *)restofpacket), 
-                 IncomingAdapter));
 #endif
 
-    switch (IpHeader->Protocol)
+    //
+    // Check the valid bitmap first - an empty
+    // set is the common miss, and this saves
+    // touching the set's memory at all
+    //
+
+    if (*CacheSetValidWays == 0)
     {
-        case IPPROTO_TCP:
-        case IPPROTO_UDP:
-            *Hash += *((ULONG *)restofpacket);
-            break;
-                    
-        case IPPROTO_ICMP:
-            *Hash += *((USHORT *)restofpacket);
+        return FFP_INDICATE_PACKET;
     }
-#endif
 
-    hashindex = HashValue(*Hash);
+    cacheset = CacheSet;
 
-#if FFP_DEBUG
-    FFPDbgPrint(("IsPacketInFastFwdingCache: Hash1 = %08X, Hash2 = %04X\n",
-                 *Hash, 
-                 hashindex));
-#endif
+    sequence = cacheset->FFPCS_Sequence;
 
-    //
-    // You can make this check without having to 
-    // take the cache entry spinlock - worst case
-    // you use an consistent but obsolete entry
-    //
-
-    if (INVALID_FORWARDING_CACHE_ENTRY(hashindex))
+    if (sequence & 1)
     {
+        // A writer owns the set - let IP have the packet
         return FFP_INDICATE_PACKET;
     }
 
-    cacheentry = &FastForwardingCache[hashindex];
+    FFP_READ_BARRIER();
 
-    ACQUIRE_FORWARDING_ENTRY_SPINLOCK(cacheentry);
+    validways = *CacheSetValidWays;
 
     //
-    // Compare the exact fields - since hash collisions
-    // can happen and we dont keep lists on each bucket
+    // Compare the signature of each valid way first,
+    // then the exact fields of the one that matches
     //
 
-    if (   IpHeader->Dest     == cacheentry->FFPCE_IPInfo.IPHI_DestAddress 
-        && IpHeader->Src      == cacheentry->FFPCE_IPInfo.IPHI_SrcAddress
-#if __FILTER__
-        && IpHeader->Protocol == cacheentry->FFPCE_IPInfo.IPHI_Protocol
-#endif
-        )
+    for (way = 0; way < FFCACHE_WAYS; way++)
     {
-#if __FILTER__
-
-#if FFP_DEBUG
-        FFPDbgPrint(("First  Word: In Packet: %04X, In Cache: %04X\n", 
-                     *((USHORT *)restofpacket+0), 
-                     cacheentry->FFPCE_IPInfo.IPHI_FirstWordAfterIPHeader));
-
-        FFPDbgPrint(("Second Word: In Packet: %04X, In Cache: %04X\n", 
-                     *((USHORT *)restofpacket+1), 
-                     cacheentry->FFPCE_IPInfo.IPHI_SecondWordAfterIPHeader));
-#endif
-       switch (IpHeader->Protocol)
-       {
-       case IPPROTO_UDP:
-       case IPPROTO_TCP:
-           if (*((ULONG *) restofpacket) != *((ULONG *) 
-                &(cacheentry->FFPCE_IPInfo.IPHI_FirstWordAfterIPHeader)))
-           {
-               RELEASE_FORWARDING_ENTRY_SPINLOCK(cacheentry);
-               return FFP_INDICATE_PACKET;
-           }
-        
-           break;
-
-       case IPPROTO_ICMP:
-           if (*((USHORT *) restofpacket) != *((USHORT *) 
-                &(cacheentry->FFPCE_IPInfo.IPHI_FirstWordAfterIPHeader)))
-           {
-               RELEASE_FORWARDING_ENTRY_SPINLOCK(cacheentry);
-               return FFP_INDICATE_PACKET;
-           }
-       }
-#endif
-
-        // Cache entry matched perfectly - So we have a matching FFP
+        if ((validways & (1 << way)) &&
+            cacheset->FFPCS_Signature[way] == Hash &&
+            IsFlowInCacheEntry(IpHeader, &cacheset->FFPCS_Entry[way]))
+        {
+            break;
+        }
     }
-    else
+
+    if (way == FFCACHE_WAYS)
     {
 #if FFP_DEBUG
         // did not match - return
@@ -306,12 +402,52 @@ IsPacketInFastForwardingCache (
 
         FFPDbgPrint(("\n"));
 #endif
-        RELEASE_FORWARDING_ENTRY_SPINLOCK(cacheentry);
         return FFP_INDICATE_PACKET;
     }
 
+    //
+    // Cache entry matched perfectly - copy out what we
+    // need, then make sure no writer changed the set
+    // while we read it before acting on the copy
+    //
+
+    cacheentry = &cacheset->FFPCS_Entry[way];
+
+    cacheentrytype = cacheentry->FFPCE_CacheEntryType;
+
+    outgoingadapter = NULL;
+
+    if (cacheentrytype == FFP_FORWARD_PACKET)
+    {
+        outgoingadapter = cacheentry->FFPCE_OutgoingAdapter;
+        macheader = cacheentry->FFPCE_MACHeader;
+    }
+
+    FFP_READ_BARRIER();
+
+    if (cacheset->FFPCS_Sequence != sequence)
+    {
+        return FFP_INDICATE_PACKET;
+    }
+
+    COUNT_CACHE_EVENT(FFP_FF_CACHE, FFPCC_Hits);
+
+    FFP_PROCESSOR_COUNTERS()->FFPPC_HitsByType[cacheentrytype + 1]++;
+
+    //
+    // Keep the set's LRU order - skip the write if
+    // the way is already the most recently used
+    //
+
+    lruorder = cacheset->FFPCS_LruOrder;
+
+    if ((lruorder & 0xF) != way)
+    {
+        cacheset->FFPCS_LruOrder = TouchCacheWay(lruorder, way);
+    }
+
     FFPDbgPrint(("Found in FFC: CT %08X S %08X D %08X P %02X F %04X ",
-                 cacheentry->FFPCE_CacheEntryType,
+                 cacheentrytype,
                  IpHeader->Src,
                  IpHeader->Dest,
                  IpHeader->Protocol,
@@ -325,11 +461,14 @@ IsPacketInFastForwardingCache (
 
     FFPDbgPrint(("INC %04X OUT %04X\n",    
                  IncomingAdapter,
-                 cacheentry->FFPCE_OutgoingAdapter));
+                 outgoingadapter));
 
+    //
     // If we are fastforwarding, adjust TTL and XSUM
+    // (unless the caller is only querying the cache)
+    //
 
-    if (cacheentry->FFPCE_CacheEntryType == FFP_FORWARD_PACKET)
+    if (cacheentrytype == FFP_FORWARD_PACKET && EthernetHeader != NULL)
     {
         // This packet is going to be fast forwarded
         
@@ -347,28 +486,279 @@ IsPacketInFastForwardingCache (
         // card would use the new eth header for fwding
         //
 
-        NdisMoveMemory(EthernetHeader, 
-                       &cacheentry->FFPCE_MACHeader, 
-                       sizeof(EnetHeader));
+        NdisMoveMemory(EthernetHeader, 
+                       &macheader, 
+                       sizeof(EnetHeader));
+
+        // Fill in outgoing adapter from the cache entry
+        *OutgoingAdapter = outgoingadapter;
+
+        FFPDbgPrint(("And OUTMAC %02X.%02X.%02X.%02X.%02X.%02X\n",
+                     macheader.EH_Dest.EA_Addr[0],
+                     macheader.EH_Dest.EA_Addr[1],
+                     macheader.EH_Dest.EA_Addr[2],
+                     macheader.EH_Dest.EA_Addr[3],
+                     macheader.EH_Dest.EA_Addr[4],
+                     macheader.EH_Dest.EA_Addr[5]
+                    ));
+     }
+
+    return cacheentrytype;
+}
+
+static
+VOID
+FASTCALL
+SampleFlow (
+    IN     UNALIGNED FFPIPHeader         *IpHeader,
+    IN     LONG                           CacheEntryType
+    )
+
+/*++
+
+  Routine Description
+
+      Counts a sampled packet against its flow in the heavy flow
+      sample (see FFPFlowSample). A flow not in the sample takes
+      the place of the flow with the fewest packets. If another
+      processor is updating the sample, the packet is not counted.
+
+  Arguments
+
+      IpHeader       - pointer to atleast 24 bytes of the ip header.
+      CacheEntryType - Result of the packet's fast forwarding lookup
+
+  Return Value
+
+      None
+
+--*/
+
+{
+    ULONG             dwordafteripheader; // Ports or type and code of flow
+    FFPFlowSample    *flowsample;     // Sample of the packet's flow
+    FFPFlowSample    *fewest;         // Sample with the fewest packets
+    ULONG             i;
+
+    if (InterlockedCompareExchange((PLONG)&FFPTopFlowsOwner, 1, 0) != 0)
+    {
+        return;
+    }
+
+    dwordafteripheader = 0;
+
+#if __FILTER__
+    switch (IpHeader->Protocol)
+    {
+    case IPPROTO_TCP:
+    case IPPROTO_UDP:
+        dwordafteripheader = FIRST_DWORD_AFTER_IP_HEADER(IpHeader);
+        break;
+
+    case IPPROTO_ICMP:
+        dwordafteripheader = *((USHORT *)((UCHAR *)IpHeader + 20));
+    }
+#endif
+
+    fewest = &FFPTopFlows[0];
+
+    for (i = 0; i < FFP_SAMPLED_FLOWS; i++)
+    {
+        flowsample = &FFPTopFlows[i];
+
+        if (flowsample->FFPFS_Packets &&
+            flowsample->FFPFS_SrcAddress == IpHeader->Src &&
+            flowsample->FFPFS_DestAddress == IpHeader->Dest &&
+            flowsample->FFPFS_Protocol == IpHeader->Protocol &&
+            flowsample->FFPFS_DwordAfterIPHeader == dwordafteripheader)
+        {
+            break;
+        }
+
+        if (flowsample->FFPFS_Packets < fewest->FFPFS_Packets)
+        {
+            fewest = flowsample;
+        }
+    }
+
+    if (i == FFP_SAMPLED_FLOWS)
+    {
+        flowsample = fewest;
+
+        flowsample->FFPFS_SrcAddress = IpHeader->Src;
+        flowsample->FFPFS_DestAddress = IpHeader->Dest;
+        flowsample->FFPFS_Protocol = IpHeader->Protocol;
+        flowsample->FFPFS_DwordAfterIPHeader = dwordafteripheader;
+        flowsample->FFPFS_Error = flowsample->FFPFS_Packets;
+    }
+
+    flowsample->FFPFS_Packets++;
+    flowsample->FFPFS_CacheEntryType = (SHORT)CacheEntryType;
+
+    InterlockedExchange((PLONG)&FFPTopFlowsOwner, 0);
+}
+
+static
+ULONG
+FASTCALL
+LookupFastForwardingSet (
+    IN     UNALIGNED EnetHeader          *EthernetHeader,
+    IN     UNALIGNED FFPIPHeader         *IpHeader,
+    IN     ULONG                          Hash, 
+    IN     ULONG                          SetIndex, 
+    IN     HANDLE                         IncomingAdapter, 
+    OUT    HANDLE                        *OutgoingAdapter
+    )
+
+/*++
+
+  Routine Description
+
+      Looks the packet up in the set of the fast forwarding cache
+      it hashes to - see LookupForwardingCacheSet. While a resize
+      is in progress, a packet not found there is also looked up
+      in the retired cache, if its set there has not been moved
+      to the new cache yet.
+
+  Arguments
+
+      EthernetHeader  - ethernet header in which the packet is encapsulated
+                        (NULL to only query the cache),
+      IpHeader        - pointer to atleast 24 bytes of the ip header.
+      Hash            - Hash = src addr + dst addr + protocol + ports info,
+      SetIndex        - HashValue(Hash), the set the packet hashes to,
+      IncomingAdapter - Handle of the adapter on which the packet came in
+                        (currently not used at all),
+      OutgoingAdapter - Handle to adapter context on which pkt to be fwded
+
+  Return Value
+  
+   FFP_DISCARD_PACKET  in case of a negative forwarding cache entry,
+   FFP_INDICATE_PACKET in case of no matching entry (indicate to the IP layer),
+   FFP_FORWARD_PACKET  in case of a positive cache entry (OutgoingAdapter retd)
+
+--*/
+{
+    ULONG             retcode;        // Result of the lookup
+    ULONG             oldsetindex;    // Set of the packet in retired cache
+    FFPProcessorCounters *counters;   // This processor's statistics
+
+    retcode = LookupForwardingCacheSet(EthernetHeader,
+                                       IpHeader,
+                                       Hash,
+                                       &FastForwardingCache[SetIndex],
+                                       &FastForwardingCacheValidBmp[SetIndex],
+                                       IncomingAdapter,
+                                       OutgoingAdapter);
+
+    if (retcode == FFP_INDICATE_PACKET && FORWARDING_CACHE_MIGRATING())
+    {
+        oldsetindex = FOLD_HASH_VALUE(Hash, FFOldHashShift);
+
+        if ((LONG)oldsetindex >= FastForwardingCacheMigrated)
+        {
+            retcode = 
+                LookupForwardingCacheSet(EthernetHeader,
+                                         IpHeader,
+                                         Hash,
+                                         &FastForwardingCacheOld[oldsetindex],
+                                         &FastForwardingCacheOldValidBmp[oldsetindex],
+                                         IncomingAdapter,
+                                         OutgoingAdapter);
+        }
+    }
+
+    //
+    // Count the lookup, and every FFP_FLOW_SAMPLE_RATE
+    // lookups on this processor sample the packet's flow
+    //
+
+    counters = FFP_PROCESSOR_COUNTERS();
+
+    if ((counters->FFPPC_Caches[FFP_FF_CACHE].FFPCC_Lookups++ 
+            & (FFP_FLOW_SAMPLE_RATE - 1)) == 0)
+    {
+        SampleFlow(IpHeader, retcode);
+    }
+
+    return retcode;
+}
+
+static
+ULONG
+FASTCALL
+IsPacketInFastForwardingCache (
+    IN     UNALIGNED EnetHeader          *EthernetHeader,
+    IN     UNALIGNED FFPIPHeader         *IpHeader,
+    IN OUT ULONG                         *Hash, 
+    IN     HANDLE                         IncomingAdapter, 
+    OUT    HANDLE                        *OutgoingAdapter
+    )
+
+/*++
+
+  Routine Description
+
+      Checks the fast forwarding cache - see LookupFastForwardingSet.
+      Assumes incoming 'hash' = src addr + dst addr + protocol, and
+      fixes it to add the TCP/UDP src/dest ports dword (or) the ICMP
+      type/code word.
+
+  Arguments
+
+      EthernetHeader  - ethernet header in which the packet is encapsulated
+                        (NULL to only query the cache),
+      IpHeader        - pointer to atleast 24 bytes of the ip header.
+      Hash            - Hash = src addr + dst addr + protocol for the packet
+                        on entry into this function,
+      IncomingAdapter - Handle of the adapter on which the packet came in
+                        (currently not used at all),
+      OutgoingAdapter - Handle to adapter context on which pkt to be fwded
+
+  Return Value
+  
+   FFP_DISCARD_PACKET  in case of a negative forwarding cache entry,
+   FFP_INDICATE_PACKET in case of no matching entry (indicate to the IP layer),
+   FFP_FORWARD_PACKET  in case of a positive cache entry (OutgoingAdapter retd)
+
+--*/
+{
+    ULONG             setindex;       // Set into which packet would hash
+
+    //
+    // To lookup in cache we must add the relevant fields. They are:
+    // (dest address, src address, protocol)
+    // if IPPROTO_TCP or udp - (src,dest dword)
+    // if icmp - (type,code word in the pkt)
+    //
+    // Hash value here = IpHeader->Dest+IpHeader->Src+IpHeader->Protocol;
+    //
+
+#if __FILTER__
 
-        // Fill in outgoing adapter from the cache entry
-        *OutgoingAdapter = cacheentry->FFPCE_OutgoingAdapter;
+#if FFP_DEBUG
+    FFPDbgPrint(("ROP = %08X, Inc Adap = %08X, ", 
+                 *((ULONG *)((UCHAR *)IpHeader + 20)), 
+                 IncomingAdapter));
+#endif
 
-        FFPDbgPrint(("And OUTMAC %02X.%02X.%02X.%02X.%02X.%02X\n",
-                     cacheentry->FFPCE_MACHeader.EH_Dest.EA_Addr[0],
-                     cacheentry->FFPCE_MACHeader.EH_Dest.EA_Addr[1],
-                     cacheentry->FFPCE_MACHeader.EH_Dest.EA_Addr[2],
-                     cacheentry->FFPCE_MACHeader.EH_Dest.EA_Addr[3],
-                     cacheentry->FFPCE_MACHeader.EH_Dest.EA_Addr[4],
-                     cacheentry->FFPCE_MACHeader.EH_Dest.EA_Addr[5]
-                    ));
-     }
+    AddPortsToHash(IpHeader, Hash);
+#endif
 
-    cacheentrytype = cacheentry->FFPCE_CacheEntryType;
-    
-    RELEASE_FORWARDING_ENTRY_SPINLOCK(cacheentry);
+    setindex = HashValue(*Hash);
 
-    return cacheentrytype;
+#if FFP_DEBUG
+    FFPDbgPrint(("IsPacketInFastFwdingCache: Hash1 = %08X, Hash2 = %04X\n",
+                 *Hash, 
+                 setindex));
+#endif
+
+    return LookupFastForwardingSet(EthernetHeader,
+                                   IpHeader,
+                                   *Hash,
+                                   setindex,
+                                   IncomingAdapter,
+                                   OutgoingAdapter);
 }
 
 static
@@ -395,6 +785,10 @@ SeedFastForwardingCache(
       src addr + dst addr + protocol
          + ( src port, dst port dword)  in case of TCP/UDP.
 
+      The flow replaces its own entry if it has one in the
+      set, else takes a free way, else the least recently 
+      used way of the set.
+
     No checking is done whatsoever on any data being stored
     in the FF cache, Garbage In Garbage Out (GIGO)
     
@@ -412,12 +806,16 @@ SeedFastForwardingCache(
 
   Return Value
 
-      TRUE if set or FALSE if any error occured
+      TRUE if set or FALSE if any error occured (or the set was busy)
 --*/
 {
-    ULONG             hashindex;      // Bucket into which packet would hash
+    ULONG             setindex;       // Set into which packet would hash
+    ULONG             validways;      // Ways of the set holding an entry
+    ULONG             way;            // Way of the set the entry goes in
+    LONG              sequence;       // Sequence number of the set on entry
     USHORT           *restofpacket;   // Pointer to byte after the IP header
-    FFPCacheEntry    *cacheentry;     // Fast fwding cache entry for this query
+    FFPCacheSet      *cacheset;       // Set of the fast fwding cache
+    FFPCacheEntry    *cacheentry;     // Fast fwding cache entry for this seed
 
     //
     // If the incoming adapter and the outgoing adapter is the same, 
@@ -436,18 +834,18 @@ SeedFastForwardingCache(
     // IpHeader->Dest+IpHeader->Src+IpHeader->Protocol + (port/type/code info)
     //
 
-    hashindex = HashValue(Hash);
+    setindex = HashValue(Hash);
 
-    cacheentry = &FastForwardingCache[hashindex];
+    cacheset = &FastForwardingCache[setindex];
 
-    ACQUIRE_FORWARDING_ENTRY_SPINLOCK(cacheentry);
-
-    //
-    // Set the entry to valid after acquiring lock
-    // to prevent reads from reading invalid data
-    //
+    if (!TRY_CLAIM_FORWARDING_SET(cacheset, sequence))
+    {
+        // Another writer owns the set; a later packet will seed
+        COUNT_CACHE_EVENT(FFP_FF_CACHE, FFPCC_Busy);
+        return FALSE;
+    }
 
-    SET_FORWARDING_CACHE_ENTRY_TO_VALID(hashindex);
+    COUNT_CACHE_EVENT(FFP_FF_CACHE, FFPCC_Seeds);
 
 #if __FILTER__
     restofpacket = (USHORT *) ((UCHAR *)IpHeader+20);
@@ -463,14 +861,51 @@ SeedFastForwardingCache(
 #if FFP_DEBUG
   FFPDbgPrint(("SeedFastForwardingCache: Hash1 = %08X, Hash2 = %04X\n",
                Hash, 
-               HashValue(Hash)));
+               setindex));
 #endif
 
-    cacheentry->FFPCE_IPInfo.IPHI_DestAddress = IpHeader->Dest;
-    cacheentry->FFPCE_IPInfo.IPHI_SrcAddress  = IpHeader->Src;
+    //
+    // Pick the way - the flow's own entry, a free
+    // way, or the least recently used way, in that
+    // order of preference
+    //
+
+    validways = FastForwardingCacheValidBmp[setindex];
+
+    for (way = 0; way < FFCACHE_WAYS; way++)
+    {
+        if ((validways & (1 << way)) &&
+            cacheset->FFPCS_Signature[way] == Hash &&
+            IsFlowInCacheEntry(IpHeader, &cacheset->FFPCS_Entry[way]))
+        {
+            break;
+        }
+    }
+
+    if (way == FFCACHE_WAYS)
+    {
+        if (validways != (1 << FFCACHE_WAYS) - 1)
+        {
+            for (way = 0; validways & (1 << way); way++)
+                ;
+        }
+        else
+        {
+            way = (cacheset->FFPCS_LruOrder >> (4 * (FFCACHE_WAYS - 1))) & 0xF;
+
+            COUNT_CACHE_EVENT(FFP_FF_CACHE, FFPCC_Evictions);
+        }
+    }
+
+    cacheentry = &cacheset->FFPCS_Entry[way];
+
+    cacheset->FFPCS_Signature[way] = Hash;
+
+    cacheentry->FFPCE_DestAddress = IpHeader->Dest;
+    cacheentry->FFPCE_SrcAddress  = IpHeader->Src;
 
 #if __FILTER__
-    cacheentry->FFPCE_IPInfo.IPHI_Protocol = IpHeader->Protocol;
+    cacheentry->FFPCE_Protocol = IpHeader->Protocol;
 
     //
     // The following two fields may not be necessary for 
@@ -483,25 +918,26 @@ SeedFastForwardingCache(
 #if FFP_DEBUG
     FFPDbgPrint(("First  Word: In Packet: %04X, In Cache: %04X\n",
                 *restofpacket, 
-                cacheentry->FFPCE_IPInfo.IPHI_FirstWordAfterIPHeader));
+                cacheentry->FFPCE_FirstWordAfterIPHeader));
 
     FFPDbgPrint(("Second Word: In Packet: %04X, In Cache: %04X\n", 
                 *(restofpacket+1), 
-                cacheentry->FFPCE_IPInfo.IPHI_SecondWordAfterIPHeader));
+                cacheentry->FFPCE_SecondWordAfterIPHeader));
 #endif
 
-    cacheentry->FFPCE_IPInfo.IPHI_FirstWordAfterIPHeader = *restofpacket;
-    cacheentry->FFPCE_IPInfo.IPHI_SecondWordAfterIPHeader = *(restofpacket+1);
+    cacheentry->FFPCE_FirstWordAfterIPHeader = *restofpacket;
+    cacheentry->FFPCE_SecondWordAfterIPHeader = *(restofpacket+1);
 #endif
 
     cacheentry->FFPCE_CacheEntryType = CacheEntryType;
 
-    FFPDbgPrint(("Put in FFC: CT %08X S %08X D %08X P %02X F %04X ",
+    FFPDbgPrint(("Put in FFC: CT %08X S %08X D %08X P %02X F %04X W %u ",
                  CacheEntryType,
                  IpHeader->Src,
                  IpHeader->Dest,
                  IpHeader->Protocol,
-                 IpHeader->Id));
+                 IpHeader->Id,
+                 way));
         
 #if __FILTER__
     FFPDbgPrint(("P1 %04X P2 %04X ",
@@ -534,12 +970,242 @@ SeedFastForwardingCache(
                      EthernetHeader->EH_Dest.EA_Addr[5]
                     ));
     }
+
+    //
+    // Mark the way valid and most recently used
+    // before giving up the set
+    //
+
+    SET_FORWARDING_CACHE_WAY_TO_VALID(setindex, way);
+
+    cacheset->FFPCS_LruOrder = TouchCacheWay(cacheset->FFPCS_LruOrder, way);
         
-    RELEASE_FORWARDING_ENTRY_SPINLOCK(cacheentry);
+    RELEASE_FORWARDING_SET(cacheset, sequence);
+
+    return TRUE;
+}
+
+static
+__inline
+ULONG
+IsSameFlowEntry (
+    IN     FFPCacheEntry                 *CacheEntry1,
+    IN     FFPCacheEntry                 *CacheEntry2
+    )
+
+/*++
+
+  Routine Description
+
+      Compares the exact flow fields of two fast forwarding
+      cache entries (see IsFlowInCacheEntry)
+
+  Arguments
+
+      CacheEntry1 - The first cache entry
+      CacheEntry2 - The cache entry it is compared with
+
+  Return Value
+
+        TRUE or FALSE
+
+--*/
+
+{
+    if (   CacheEntry1->FFPCE_DestAddress != CacheEntry2->FFPCE_DestAddress 
+        || CacheEntry1->FFPCE_SrcAddress  != CacheEntry2->FFPCE_SrcAddress
+#if __FILTER__
+        || CacheEntry1->FFPCE_Protocol    != CacheEntry2->FFPCE_Protocol
+#endif
+        )
+    {
+        return FALSE;
+    }
+
+#if __FILTER__
+    switch (CacheEntry1->FFPCE_Protocol)
+    {
+    case IPPROTO_UDP:
+    case IPPROTO_TCP:
+        if (CacheEntry1->FFPCE_SecondWordAfterIPHeader != 
+             CacheEntry2->FFPCE_SecondWordAfterIPHeader)
+        {
+            return FALSE;
+        }
+
+        // Fall through to compare the first word
+
+    case IPPROTO_ICMP:
+        if (CacheEntry1->FFPCE_FirstWordAfterIPHeader != 
+             CacheEntry2->FFPCE_FirstWordAfterIPHeader)
+        {
+            return FALSE;
+        }
+    }
+#endif
 
     return TRUE;
 }
 
+static
+VOID
+FASTCALL
+MigrateFastForwardingSets (
+    IN     ULONG                          SetCount
+    )
+
+/*++
+
+  Routine Description
+
+      Moves the next few sets of a retired fast forwarding cache
+      to the new one, while a resize is in progress. The sets are
+      moved in order; FastForwardingCacheMigrated is the first set
+      not moved yet, and lookups of flows in sets after it also
+      look in the retired cache.
+
+      Each valid way goes to the set its signature hashes to in
+      the new cache, least recently used first - so that the most
+      recently used way of the set is so in the new set as well.
+      A flow that has been seeded in the new cache since the
+      resize keeps its new entry; other entries take a free way,
+      else the least recently used way, as when seeding. An entry
+      whose new set is owned by a writer is dropped.
+
+      Only one processor moves sets at a time; any other returns
+      at once, so the packet it is receiving is not held up.
+
+  Arguments
+
+      SetCount - Number of sets to move
+
+  Return Value
+
+      None
+
+--*/
+
+{
+    LONG              oldsetindex;    // Set of retired cache being moved
+    ULONG             oldvalidways;   // Ways of that set holding an entry
+    LONG              oldsequence;    // Sequence number of that set on entry
+    ULONG             oldlruorder;    // LRU order of that set
+    ULONG             setindex;       // Set in new cache an entry moves to
+    ULONG             validways;      // Ways of the new set holding an entry
+    LONG              sequence;       // Sequence number of new set on entry
+    ULONG             position;       // Position of a way in the LRU order
+    ULONG             oldway;         // Way of the retired set being moved
+    ULONG             way;            // Way of the new set the entry goes in
+    FFPCacheSet      *oldcacheset;    // Set of the retired cache
+    FFPCacheSet      *cacheset;       // Set of the new cache
+
+    if (InterlockedCompareExchange((PLONG)&FastForwardingCacheMigrator, 
+                                   1, 
+                                   0) != 0)
+    {
+        // Another processor is moving sets
+        return;
+    }
+
+    for ( ; SetCount; SetCount--)
+    {
+        oldsetindex = FastForwardingCacheMigrated;
+
+        if (oldsetindex >= (LONG)FastForwardingCacheOldSets)
+        {
+            // All moved (or the caches were flushed)
+            break;
+        }
+
+        oldcacheset = &FastForwardingCacheOld[oldsetindex];
+
+        if (!TRY_CLAIM_FORWARDING_SET(oldcacheset, oldsequence))
+        {
+            break;
+        }
+
+        oldvalidways = FastForwardingCacheOldValidBmp[oldsetindex];
+
+        oldlruorder = oldcacheset->FFPCS_LruOrder;
+
+        for (position = FFCACHE_WAYS; position-- > 0; )
+        {
+            oldway = (oldlruorder >> (4 * position)) & 0xF;
+
+            if (!(oldvalidways & (1 << oldway)))
+            {
+                continue;
+            }
+
+            setindex = HashValue(oldcacheset->FFPCS_Signature[oldway]);
+
+            cacheset = &FastForwardingCache[setindex];
+
+            if (!TRY_CLAIM_FORWARDING_SET(cacheset, sequence))
+            {
+                continue;
+            }
+
+            validways = FastForwardingCacheValidBmp[setindex];
+
+            for (way = 0; way < FFCACHE_WAYS; way++)
+            {
+                if ((validways & (1 << way)) &&
+                    cacheset->FFPCS_Signature[way] == 
+                        oldcacheset->FFPCS_Signature[oldway] &&
+                    IsSameFlowEntry(&cacheset->FFPCS_Entry[way],
+                                    &oldcacheset->FFPCS_Entry[oldway]))
+                {
+                    break;
+                }
+            }
+
+            if (way == FFCACHE_WAYS)
+            {
+                if (validways != (1 << FFCACHE_WAYS) - 1)
+                {
+                    for (way = 0; validways & (1 << way); way++)
+                        ;
+                }
+                else
+                {
+                    way = (cacheset->FFPCS_LruOrder 
+                                >> (4 * (FFCACHE_WAYS - 1))) & 0xF;
+                }
+
+                cacheset->FFPCS_Signature[way] = 
+                    oldcacheset->FFPCS_Signature[oldway];
+
+                NdisMoveMemory(&cacheset->FFPCS_Entry[way],
+                               &oldcacheset->FFPCS_Entry[oldway],
+                               sizeof(FFPCacheEntry));
+
+                SET_FORWARDING_CACHE_WAY_TO_VALID(setindex, way);
+
+                cacheset->FFPCS_LruOrder = 
+                    TouchCacheWay(cacheset->FFPCS_LruOrder, way);
+            }
+
+            RELEASE_FORWARDING_SET(cacheset, sequence);
+        }
+
+        //
+        // The set is moved - empty it, and move on to the next
+        // (unless the caches were flushed in the meantime)
+        //
+
+        FastForwardingCacheOldValidBmp[oldsetindex] = 0;
+
+        RELEASE_FORWARDING_SET(oldcacheset, oldsequence);
+
+        InterlockedCompareExchange((PLONG)&FastForwardingCacheMigrated,
+                                   oldsetindex + 1,
+                                   oldsetindex);
+    }
+
+    InterlockedExchange((PLONG)&FastForwardingCacheMigrator, 0);
+}
+
 static
 ULONG
 FASTCALL
@@ -586,11 +1252,11 @@ IsPacketInIncomingCache (
     {
     case IPPROTO_TCP:
     case IPPROTO_UDP:
-        *Hash += *((ULONG *)restofpacket);
+        *Hash += PORTS_HASH_VALUE(*((ULONG *)restofpacket));
         break;
                     
     case IPPROTO_ICMP:
-        *Hash += *((USHORT *)restofpacket);
+        *Hash += PORTS_HASH_VALUE(*((USHORT *)restofpacket));
     }
 #endif
 
@@ -599,7 +1265,9 @@ IsPacketInIncomingCache (
                  *Hash));
 #endif
 
-    hashindex = *Hash % IncomingCacheSize;
+    hashindex = RANGE_HASH_VALUE(*Hash, IncomingCacheSize);
+
+    COUNT_CACHE_EVENT(FFP_INCOMING_CACHE, FFPCC_Lookups);
 
     //
     // You can make this check without having to 
@@ -653,6 +1321,8 @@ IsPacketInIncomingCache (
 #endif
         *IncomingAdapter = incomingcacheentry->IPHI_Adapter;
 
+        COUNT_CACHE_EVENT(FFP_INCOMING_CACHE, FFPCC_Hits);
+
         FFPDbgPrint(("Found in Incoming: S %08X D %08X P %02X F %04X ",
                      IpHeader->Src,
                      IpHeader->Dest,
@@ -736,12 +1406,27 @@ SeedIncomingCache (
                  Hash));
 #endif
 
-    hashindex = Hash % IncomingCacheSize;
+    hashindex = RANGE_HASH_VALUE(Hash, IncomingCacheSize);
 
     incomingcacheentry = &IncomingCache [hashindex];
 
     ACQUIRE_INCOMING_ENTRY_SPINLOCK(incomingcacheentry);
 
+    COUNT_CACHE_EVENT(FFP_INCOMING_CACHE, FFPCC_Seeds);
+
+    if (!INVALID_INCOMING_CACHE_ENTRY(hashindex) &&
+        (incomingcacheentry->IPHI_DestAddress != IpHeader->Dest ||
+         incomingcacheentry->IPHI_SrcAddress != IpHeader->Src
+#if __FILTER__
+         || incomingcacheentry->IPHI_Protocol != IpHeader->Protocol
+         || *((ULONG *)&incomingcacheentry->IPHI_FirstWordAfterIPHeader) 
+                != FIRST_DWORD_AFTER_IP_HEADER(IpHeader)
+#endif
+        ))
+    {
+        COUNT_CACHE_EVENT(FFP_INCOMING_CACHE, FFPCC_Evictions);
+    }
+
     //
     // Set the entry to valid after acquiring lock
     // to prevent reads from reading invalid data
@@ -832,7 +1517,9 @@ IsPacketInFragmentCache (
                  Hash + IpHeader->Id));
 #endif
 
-    hashindex = (Hash + IpHeader->Id) % FragmentCacheSize;
+    hashindex = RANGE_HASH_VALUE(Hash + IpHeader->Id, FragmentCacheSize);
+
+    COUNT_CACHE_EVENT(FFP_FRAGMENT_CACHE, FFPCC_Lookups);
 
     //
     // You can make this check without having to 
@@ -865,6 +1552,8 @@ IsPacketInFragmentCache (
 
         *IncomingAdapter = fragmentcacheentry->IPHI_Adapter;
 
+        COUNT_CACHE_EVENT(FFP_FRAGMENT_CACHE, FFPCC_Hits);
+
         FFPDbgPrint(("Found in Fragment: S %08X D %08X " \
                      "P %02X F %04X P1P2 %08X INC %08X\n",
                      IpHeader->Src,
@@ -932,12 +1621,23 @@ SeedFragmentCache(
                  Hash + IpHeader->Id));
 #endif
 
-    hashindex = (Hash + IpHeader->Id) % FragmentCacheSize;
+    hashindex = RANGE_HASH_VALUE(Hash + IpHeader->Id, FragmentCacheSize);
 
     fragmentcacheentry = &FragmentCache [hashindex];
     
     ACQUIRE_FRAGMENT_ENTRY_SPINLOCK(fragmentcacheentry);
 
+    COUNT_CACHE_EVENT(FFP_FRAGMENT_CACHE, FFPCC_Seeds);
+
+    if (!INVALID_FRAGMENT_CACHE_ENTRY(hashindex) &&
+        (fragmentcacheentry->IPHI_DestAddress != IpHeader->Dest ||
+         fragmentcacheentry->IPHI_SrcAddress != IpHeader->Src ||
+         fragmentcacheentry->IPHI_Protocol != IpHeader->Protocol ||
+         fragmentcacheentry->IPHI_FragmentId != IpHeader->Id))
+    {
+        COUNT_CACHE_EVENT(FFP_FRAGMENT_CACHE, FFPCC_Evictions);
+    }
+
     //
     // Set the entry to valid after acquiring lock
     // to prevent reads from reading invalid data
@@ -1032,6 +1732,16 @@ FFPNoFiltering_FFPProcessReceivedPacket
                                            // for 1st fragment with current id
 #endif
 
+    //
+    // While the fast forwarding cache is being resized,
+    // move a few more sets of the retired cache to it
+    //
+
+    if (FORWARDING_CACHE_MIGRATING())
+    {
+        MigrateFastForwardingSets(FFP_MIGRATE_SETS);
+    }
+
     //
     // Check if the current packet is worthy of 
     // fast forwarding (except the TTL check)
@@ -1064,16 +1774,16 @@ FFPNoFiltering_FFPProcessReceivedPacket
     }
 
     //
-    // Initialize hash to the sum of src and dest IP addr ( rotate dest 
-    // addr left by one bit before adding, to remove any source,dest
-    // symmetry ). If filtering is enabled, add the protocol as we can
-    // filter based on protocol id (TCP, UDP, ICMP ...)
+    // Initialize hash to the keyed sum of src and dest IP addr ( each
+    // has its own key, to remove any source,dest symmetry - see
+    // INIT_HASH_VALUE ). If filtering is enabled, add the protocol as we
+    // can filter based on protocol id (TCP, UDP, ICMP ...)
     //
 
     hash = INIT_HASH_VALUE(PacketHeader);
     
 #if __FILTER__
-    hash += PacketHeader->Protocol;
+    hash += PROTOCOL_HASH_VALUE(PacketHeader);
 #endif
 
     //
@@ -1231,6 +1941,153 @@ FFPNoFiltering_FFPProcessReceivedPacket
 #endif // __FILTER__
 }
 
+ULONG
+FASTCALL
+#if __FILTER__
+FFPWithFiltering_FFPProcessReceivedPackets
+#else
+FFPNoFiltering_FFPProcessReceivedPackets
+#endif
+    (
+    IN OUT FFPReceivedPacket               *Packets, 
+    IN     ULONG                            PacketCount, 
+    IN     HANDLE                           IncomingAdapter
+    )
+
+/*++
+
+  Routine Description
+
+    Called on the up path with an array of packets received on
+    one adapter (as the miniport would indicate them with
+    NdisMIndicateReceivePacket). Does for each packet what
+    'FFPProcessReceivedPacket' does for one.
+
+    Packets are taken FFP_RECEIVE_BATCH at a time. The first pass
+    over a batch picks out the packets that may be fast forwarded,
+    hashes them and prefetches their fast forwarding cache sets;
+    the second pass looks them up. The cache misses of the whole
+    batch are then taken together rather than one per packet.
+    Fragments (when filtering) take the single packet path.
+
+  Arguments
+
+      Packets         - array of packets - the caller fills in the headers,
+                        this fills in FFPRP_Result, and FFPRP_OutgoingAdapter
+                        for packets to be forwarded,
+      PacketCount     - number of packets in the array,
+      IncomingAdapter - Handle of the adapter on which the packets came in
+      
+  Return Value
+  
+      Number of packets set to FFP_INDICATE_PACKET (to be indicated to IP)
+
+--*/
+
+{
+    ULONG  hash[FFP_RECEIVE_BATCH];     // Hash of each packet in the batch
+    ULONG  setindex[FFP_RECEIVE_BATCH]; // FF cache set of each packet 
+                                        // (~0 if not to be looked up)
+    ULONG  batchcount;                  // Num of packets in the batch
+    ULONG  indicatecount;               // Num of packets to indicate to IP
+    ULONG  retcode;                     // Result of the fast fwding lookup
+    ULONG  i;
+    UNALIGNED FFPIPHeader *packetheader;// IP header of the current packet
+
+    indicatecount = 0;
+
+    for ( ; PacketCount; Packets += batchcount, PacketCount -= batchcount)
+    {
+        if (FORWARDING_CACHE_MIGRATING())
+        {
+            MigrateFastForwardingSets(FFP_MIGRATE_SETS);
+        }
+
+        batchcount = (PacketCount < FFP_RECEIVE_BATCH) ? PacketCount 
+                                                       : FFP_RECEIVE_BATCH;
+
+        //
+        // First pass - hash the packets that might be fast
+        // forwarded and start fetching their cache sets
+        //
+
+        for (i = 0; i < batchcount; i++)
+        {
+            packetheader = Packets[i].FFPRP_PacketHeader;
+
+            Packets[i].FFPRP_Result = FFP_INDICATE_PACKET;
+
+            setindex[i] = ~0;
+
+            if (!IsPacketFastForwardingWorthy(Packets[i].FFPRP_EthernetHeader,
+                                              packetheader) ||
+                TTL_PKT_EXPIRED(packetheader))
+            {
+                continue;
+            }
+
+#if __FILTER__
+            if (IS_FRAGMENTED(packetheader))
+            {
+                Packets[i].FFPRP_Result = 
+                    FFPWithFiltering_FFPProcessReceivedPacket(
+                                              Packets[i].FFPRP_EthernetHeader,
+                                              packetheader,
+                                              IncomingAdapter,
+                                              &Packets[i].FFPRP_OutgoingAdapter);
+                continue;
+            }
+#endif
+
+            hash[i] = INIT_HASH_VALUE(packetheader);
+
+#if __FILTER__
+            hash[i] += PROTOCOL_HASH_VALUE(packetheader);
+
+            AddPortsToHash(packetheader, &hash[i]);
+#endif
+
+            setindex[i] = HashValue(hash[i]);
+
+            PREFETCH_FORWARDING_CACHE_SET(setindex[i]);
+        }
+
+        //
+        // Second pass - look the packets up, and for the
+        // ones not in the cache preserve the incoming
+        // adapter for use on the packet's down path
+        //
+
+        for (i = 0; i < batchcount; i++)
+        {
+            if (setindex[i] != ~0)
+            {
+                retcode = LookupFastForwardingSet(Packets[i].FFPRP_EthernetHeader,
+                                                  Packets[i].FFPRP_PacketHeader,
+                                                  hash[i],
+                                                  setindex[i],
+                                                  IncomingAdapter,
+                                                  &Packets[i].FFPRP_OutgoingAdapter);
+                if (retcode == FFP_INDICATE_PACKET)
+                {
+                    SeedIncomingCache(Packets[i].FFPRP_PacketHeader,
+                                      hash[i],
+                                      IncomingAdapter);
+                }
+
+                Packets[i].FFPRP_Result = retcode;
+            }
+
+            if (Packets[i].FFPRP_Result == FFP_INDICATE_PACKET)
+            {
+                indicatecount++;
+            }
+        }
+    }
+
+    return indicatecount;
+}
+
 VOID
 FASTCALL
 #if __FILTER__
@@ -1301,17 +2158,17 @@ FFPNoFiltering_FFPProcessSentPacket
 #endif
 
     //
-    // Initialize hash to the sum of src and dest IP addr 
-    // ( rotate dest addr left by one bit before adding,
-    // to remove any source,destination symmetry ). If
-    // filtering is enabled, add the protocol as we can
+    // Initialize hash to the keyed sum of src and dest
+    // IP addr ( each has its own key, to remove any
+    // source,destination symmetry ). If filtering
+    // is enabled, add the protocol as we can
     // filter based on protocol id (TCP, UDP, ICMP...).
     //
 
     hash = INIT_HASH_VALUE(PacketHeader);
     
 #if __FILTER__
-    hash += PacketHeader->Protocol;
+    hash += PROTOCOL_HASH_VALUE(PacketHeader);
 #endif
 
     //
@@ -1406,11 +2263,11 @@ FFPNoFiltering_FFPProcessSentPacket
                {
                case IPPROTO_TCP:
                case IPPROTO_UDP:
-                   hash += (ULONG) dwordAfterIPHeaderFirstFragment;
+                   hash += PORTS_HASH_VALUE((ULONG) dwordAfterIPHeaderFirstFragment);
                    break;
                         
                case IPPROTO_ICMP:
-                   hash += (USHORT) dwordAfterIPHeaderFirstFragment;
+                   hash += PORTS_HASH_VALUE((USHORT) dwordAfterIPHeaderFirstFragment);
                }
 
                //
@@ -1515,18 +2372,18 @@ FFPNoFiltering_FFPProcessSetInFFCache
     }
 
     //
-    // Initialize hash to the sum of src and 
-    // dest IP addr ( rotate dest addr left 
-    // by one bit before adding, to remove 
-    // any source,destination symmetry ). If
-    // filtering is enabled, add the protocol
-    // as we can filter based on the protocol.
+    // Initialize hash to the keyed sum of src
+    // and dest IP addr ( each has its own key,
+    // to remove any source,destination
+    // symmetry ). If filtering is enabled,
+    // add the protocol as we can filter
+    // based on the protocol.
     //
 
     hash = INIT_HASH_VALUE(PacketHeader);
     
 #if __FILTER__
-    hash += PacketHeader->Protocol;
+    hash += PROTOCOL_HASH_VALUE(PacketHeader);
 #endif
 
     //
@@ -1552,11 +2409,11 @@ FFPNoFiltering_FFPProcessSetInFFCache
         {
         case IPPROTO_TCP:
         case IPPROTO_UDP:
-            hash += *((ULONG *)restofpacket);
+            hash += PORTS_HASH_VALUE(*((ULONG *)restofpacket));
             break;
                     
         case IPPROTO_ICMP:
-            hash += *((USHORT *)restofpacket);
+            hash += PORTS_HASH_VALUE(*((USHORT *)restofpacket));
         }
     }
     else    
@@ -1614,11 +2471,11 @@ FFPNoFiltering_FFPProcessSetInFFCache
             {
             case IPPROTO_TCP:
             case IPPROTO_UDP:
-                hash += (ULONG) dwordAfterIPHeaderFirstFragment;
+                hash += PORTS_HASH_VALUE((ULONG) dwordAfterIPHeaderFirstFragment);
                 break;
                     
             case IPPROTO_ICMP:
-                hash += (USHORT) dwordAfterIPHeaderFirstFragment;
+                hash += PORTS_HASH_VALUE((USHORT) dwordAfterIPHeaderFirstFragment);
             }
         }
         else
@@ -1726,16 +2583,16 @@ FFPNoFiltering_FFPProcessQueryFFCache
     }
 
     //
-    // Initialize hash to the sum of src and dest IP addr ( rotate dest 
-    // addr left by one bit before adding, to remove any source,dest
-    // symmetry ). If filtering is enabled, add the protocol as we can
-    // filter based on protocol id (TCP, UDP, ICMP ...)
+    // Initialize hash to the keyed sum of src and dest IP addr ( each
+    // has its own key, to remove any source,dest symmetry - see
+    // INIT_HASH_VALUE ). If filtering is enabled, add the protocol as we
+    // can filter based on protocol id (TCP, UDP, ICMP ...)
     //
 
     hash = INIT_HASH_VALUE(PacketHeader);
     
 #if __FILTER__
-    hash += PacketHeader->Protocol;
+    hash += PROTOCOL_HASH_VALUE(PacketHeader);
 #endif
 
     //
@@ -40,14 +40,39 @@ Revision History:
 #define DEFAULT_INCOMING_CACHE_ENTRIES  0xAB
 #define DEFAULT_FRAGMENT_CACHE_ENTRIES  0xAB
 
-#define DEFAULT_FFCACHE_SIZE         1 << 10
-#define DEF_FFC_COMPUTED_SHIFT       16 - 10
+#define DEFAULT_FFCACHE_SIZE         (1 << 10)
 
-#define MIN_FFCACHE_SIZE              1 << 8
-#define MIN_FFC_COMPUTED_SHIFT        16 - 8
+#define MIN_FFCACHE_SIZE             (1 << 8)
 
-#define MAX_FFCACHE_SIZE             1 << 16
-#define MAX_FFC_COMPUTED_SHIFT       16 - 16
+#define MAX_FFCACHE_SIZE             (1 << 16)
+
+//
+// The fast forwarding cache is set associative - a flow hashes to a set
+// of FFCACHE_WAYS entries and may be kept in any of them. The cache
+// sizes above count entries; there are FFCACHE_WAYS times fewer sets.
+// At most 8 ways (a set's valid ways are bits in one UCHAR).
+//
+
+#define FFCACHE_WAYS_SHIFT           2
+#define FFCACHE_WAYS                 (1 << FFCACHE_WAYS_SHIFT)
+
+//
+// Keys of the flow hash - see INIT_HASH_VALUE
+//
+
+#define FFHASH_KEY_SRC               0
+#define FFHASH_KEY_DEST              1
+#define FFHASH_KEY_PROTOCOL          2
+#define FFHASH_KEY_PORTS             3
+#define FFHASH_KEY_FOLD              4
+#define FFHASH_KEYS                  5
+
+//
+// Sets of a retired fast forwarding cache moved to the new
+// cache per received packet while a resize is in progress
+//
+
+#define FFP_MIGRATE_SETS             4
 
 //
 // Packet Structure Definitions
@@ -133,29 +158,195 @@ typedef struct _IPHeaderInfo
 //
 typedef struct _FFPCacheEntry 
 {
-    IPHeaderInfo    FFPCE_IPInfo;              // Incoming Info for this flow
-    HANDLE          FFPCE_OutgoingAdapter;     // Outgoing adapter for flow
+    ULONG           FFPCE_SrcAddress;          // Src  IP address of flow
+    ULONG           FFPCE_DestAddress;         // Dest IP address of flow
+    USHORT          FFPCE_FirstWordAfterIPHeader;  // Source port for TCP/UDP
+                                               // and type and code for ICMP
+    USHORT          FFPCE_SecondWordAfterIPHeader; // Dest port for TCP/UDP
+                                               // and not used for ICMP
+    USHORT          FFPCE_Protocol;            // Protocol of flow (TCP..)
     EnetHeader      FFPCE_MACHeader;           // MAC hdr set for outgoing pkt
+    HANDLE          FFPCE_OutgoingAdapter;     // Outgoing adapter for flow
     LONG            FFPCE_CacheEntryType;      // Set to FFP_DISCARD_PACKET,
                                                //     or FFP_INDICATE_PACKET,
                                                //     or FFP_FORWARD_PACKET
 } FFPCacheEntry;
 
 //
-// Locking Fast Forwarding Cache Entry
+// Fast Forwarding Cache Set
+//
+// Lookups on the packet path take no lock. A writer owns a set while
+// its sequence number is odd - it claims the set by moving the number
+// from even to odd, and makes it even again when done. A reader that
+// finds the number odd, or changed once it has read the entry, treats
+// the packet as a miss and lets IP handle it. A writer that finds the
+// set owned by another does not wait; the cache is only a hint, and
+// the next packet of the flow will seed it again.
+//
+typedef struct _FFPCacheSet
+{
+    LONG volatile   FFPCS_Sequence;            // Odd while a writer owns set
+    ULONG           FFPCS_LruOrder;            // Way numbers, a nibble each,
+                                               // most recently used lowest
+    ULONG           FFPCS_Signature[FFCACHE_WAYS]; // Unfolded flow hash of
+                                               // the entry in each way
+    FFPCacheEntry   FFPCS_Entry[FFCACHE_WAYS]; // Entries in this set
+} FFPCacheSet;
+
+//
+// Claiming a Fast Forwarding Cache Set
+//
+
+#define TRY_CLAIM_FORWARDING_SET(cacheset, sequence)                         \
+    ((((sequence) = (cacheset)->FFPCS_Sequence) & 1) == 0 &&                  \
+     InterlockedCompareExchange((PLONG)&(cacheset)->FFPCS_Sequence,           \
+                                (sequence) + 1,                               \
+                                (sequence)) == (LONG)(sequence))
+
+#define RELEASE_FORWARDING_SET(cacheset, sequence)                           \
+    InterlockedExchange((PLONG)&(cacheset)->FFPCS_Sequence, (sequence) + 2)
+
+//
+// Orders a set's sequence number reads against its entry reads
+// (x86 and x64 processors never reorder loads with other loads)
+//
+
+#if defined(_X86_) || defined(_AMD64_)
+#define FFP_READ_BARRIER()
+#else
+#define FFP_READ_BARRIER()          KeMemoryBarrier()
+#endif
+
+//
+// Prefetch hint for cache memory about to be looked at
+// (nothing on processors the DDK has no hint for)
+//
+
+#ifdef PreFetchCacheLine
+#define FFP_PREFETCH(Address)       PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, (Address))
+#else
+#define FFP_PREFETCH(Address)
+#endif
+
+#define FFP_CACHE_LINE_SIZE         64
+
+//
+// Received packets handed to FFPProcessReceivedPackets - the
+// array a miniport would indicate in one go. The receive path
+// works on FFP_RECEIVE_BATCH packets at a time: it hashes them
+// and prefetches their cache sets, then looks them all up.
+//
+
+#define FFP_RECEIVE_BATCH           16
+
+typedef struct _FFPReceivedPacket
+{
+    UNALIGNED EnetHeader   *FFPRP_EthernetHeader;  // Header packet came in with
+    UNALIGNED FFPIPHeader  *FFPRP_PacketHeader;    // Atleast 24 bytes of IP hdr
+    HANDLE                  FFPRP_OutgoingAdapter; // Set for FFP_FORWARD_PACKET
+    LONG                    FFPRP_Result;          // Set to FFP_DISCARD_PACKET,
+                                                   //     or FFP_INDICATE_PACKET,
+                                                   //     or FFP_FORWARD_PACKET
+} FFPReceivedPacket;
+
+//
+// Cache Statistics
+//
+// Each processor counts in a slot of its own, so the packet path
+// never shares a counter (or its cache line) with another processor,
+// nor takes a lock to count. OID_FFP_CACHE_STATS sums the slots while
+// packets keep being forwarded - a snapshot is only as exact as the
+// counts of the packets in flight when it is taken.
 //
 
-#define ALLOCATE_FORWARDING_ENTRY_SPINLOCK(cacheentry)  \
-    NdisAllocateSpinLock(&((cacheentry))->FFPCE_IPInfo.IPHI_SpinLock)
+#define FFP_FF_CACHE                0           // Fast forwarding cache
+#define FFP_INCOMING_CACHE          1           // Incoming cache
+#define FFP_FRAGMENT_CACHE          2           // Fragment cache
+#define FFP_CACHES                  3
 
-#define ACQUIRE_FORWARDING_ENTRY_SPINLOCK(cacheentry)  \
-    NdisAcquireSpinLock(&((cacheentry))->FFPCE_IPInfo.IPHI_SpinLock)
+#define FFP_MAX_PROCESSORS          32          // Power of 2
+
+typedef struct _FFPCacheCounters
+{
+    ULONG           FFPCC_Lookups;             // Packets looked up
+    ULONG           FFPCC_Hits;                // Lookups that found the flow
+    ULONG           FFPCC_Seeds;               // Entries put in the cache
+    ULONG           FFPCC_Evictions;           // Seeds that replaced a
+                                               // valid entry of another flow
+    ULONG           FFPCC_Busy;                // Seeds not done as another
+                                               // writer owned the set
+} FFPCacheCounters;
+
+typedef struct _FFPProcessorCounters
+{
+    FFPCacheCounters FFPPC_Caches[FFP_CACHES]; // Counters of each cache
+    ULONG           FFPPC_HitsByType[3];       // FF cache hits on each type
+                                               // of entry (CACHEENTRYTYPE)
+    UCHAR           FFPPC_Pad[2 * FFP_CACHE_LINE_SIZE
+                              - FFP_CACHES * sizeof(FFPCacheCounters)
+                              - 3 * sizeof(ULONG)];
+} FFPProcessorCounters;
+
+//
+// Heavy Flow Sample
+//
+// One in FFP_FLOW_SAMPLE_RATE packets looked up in the fast forwarding
+// cache is counted against its flow in a table of FFP_SAMPLED_FLOWS
+// flows. A flow not in the table replaces the one with the fewest
+// packets and takes over its count (which is kept as the flow's error)
+// - so any flow with more than 1/FFP_SAMPLED_FLOWS of the sampled
+// packets is in the table, and no count is short of a flow's sampled
+// packets. OID_FFP_CACHE_STATS returns the FFP_TOP_FLOWS heaviest.
+//
 
-#define RELEASE_FORWARDING_ENTRY_SPINLOCK(cacheentry)  \
-    NdisReleaseSpinLock(&((cacheentry))->FFPCE_IPInfo.IPHI_SpinLock)
+#define FFP_SAMPLED_FLOWS           128
+#define FFP_TOP_FLOWS               16
+#define FFP_FLOW_SAMPLE_RATE        64          // Power of 2
 
-#define FREE_FORWARDING_ENTRY_SPINLOCK(cacheentry)     \
-    NdisFreeSpinLock(&((cacheentry))->FFPCE_IPInfo.IPHI_SpinLock)
+typedef struct _FFPFlowSample
+{
+    ULONG           FFPFS_SrcAddress;          // Src  IP address of flow
+    ULONG           FFPFS_DestAddress;         // Dest IP address of flow
+    ULONG           FFPFS_DwordAfterIPHeader;  // Ports for TCP/UDP, type and
+                                               // code for ICMP (if filtering)
+    USHORT          FFPFS_Protocol;            // Protocol of flow (TCP..)
+    SHORT           FFPFS_CacheEntryType;      // Result of the last lookup
+    ULONG           FFPFS_Packets;             // Sampled packets of the flow
+    ULONG           FFPFS_Error;               // Count taken over when the
+                                               // flow entered the table
+} FFPFlowSample;
+
+//
+// OID_FFP_CACHE_STATS (query) - a snapshot of the cache statistics
+// and the heavy flow sample. The OID is driver specific and is not
+// among the OID_FFP_ codes of ntddndis.h.
+//
+
+#define OID_FFP_CACHE_STATS         0xFF010220
+
+typedef struct _FFPCacheStats
+{
+    ULONG           NdisProtocolType;          // NDIS_PROTOCOL_ID_TCP_IP
+
+    ULONG           FastForwardingCacheSize;   // Entries in each cache
+    ULONG           FastForwardingCacheSets;
+    ULONG           IncomingCacheSize;
+    ULONG           FragmentCacheSize;
+
+    FFPCacheCounters Caches[FFP_CACHES];       // Summed over processors
+    ULONG           HitsByType[3];             // (see FFPProcessorCounters)
+
+    ULONG           SetOccupancy[FFCACHE_WAYS + 1]; // FF cache sets by the
+                                               // number of valid ways
+    ULONG           EntriesByType[3];          // Valid FF cache entries of
+                                               // each type (CACHEENTRYTYPE)
+    ULONG           IncomingCacheEntries;      // Valid incoming cache entries
+    ULONG           FragmentCacheEntries;      // Valid fragment cache entries
+
+    ULONG           FlowSampleRate;            // FFP_FLOW_SAMPLE_RATE
+    ULONG           TopFlowCount;              // Flows in TopFlows
+    FFPFlowSample   TopFlows[FFP_TOP_FLOWS];   // Heaviest flow first
+} FFPCacheStats;
 
 //
 // Function Pointers to FFP functions
@@ -179,6 +370,11 @@ typedef struct _FFPFunctions
 
     ULONG (FASTCALL *pFFPProcessQueryFFCache)    
                               (IN  UNALIGNED FFPIPHeader *PacketHeader);
+
+    ULONG (FASTCALL *pFFPProcessReceivedPackets)
+                              (IN OUT FFPReceivedPacket *Packets,
+                               IN  ULONG  PacketCount,
+                               IN  HANDLE IncomingAdapter);
 } FFPFunctions;
 
 //
@@ -190,7 +386,8 @@ extern NDIS_SPIN_LOCK FFPSpinLock;
 
 // Caches and Cache Sizes
 extern ULONG          FastForwardingCacheSize;
-extern FFPCacheEntry *FastForwardingCache;
+extern ULONG          FastForwardingCacheSets;
+extern FFPCacheSet   *FastForwardingCache;
 extern UCHAR         *FastForwardingCacheValidBmp;
 
 extern ULONG          IncomingCacheSize;
@@ -201,8 +398,17 @@ extern ULONG          FragmentCacheSize;
 extern IPHeaderInfo  *FragmentCache;
 extern UCHAR         *FragmentCacheValidBmp;
 
+// Fast forwarding cache being retired by a resize
+extern ULONG          FastForwardingCacheOldSets;
+extern FFPCacheSet   *FastForwardingCacheOld;
+extern UCHAR         *FastForwardingCacheOldValidBmp;
+extern LONG volatile  FastForwardingCacheMigrated;
+extern LONG volatile  FastForwardingCacheMigrator;
+
+// Hash Keys and Shifts
+extern ULONG          FFHashKeys[FFHASH_KEYS];
 extern ULONG          FFHashShift;
-extern ULONG          FFHashMask;
+extern ULONG          FFOldHashShift;
 
 // Cache Type Names
 extern const CHAR    *CacheEntryTypes[3];
@@ -220,6 +426,11 @@ extern LONGLONG       FastForwardedCount;
 extern LONGLONG       FastDroppedCount;
 extern LONGLONG       FastPassedupCount;
 
+extern FFPProcessorCounters FFPCounters[FFP_MAX_PROCESSORS];
+
+extern FFPFlowSample  FFPTopFlows[FFP_SAMPLED_FLOWS];
+extern LONG volatile  FFPTopFlowsOwner;
+
 
 //
 // Macros to acquire Global FFP Lock
@@ -264,20 +475,64 @@ extern LONGLONG       FastPassedupCount;
 // Hashing Macros
 //
 
-#define ROTATE_LEFT_VALUE(Value)  ((Value) << 1 + (Value) >> 31)
-#define INIT_HASH_VALUE(IpHeader) ((IpHeader)->Src \
-                                   + ROTATE_LEFT_VALUE((IpHeader)->Dest))
+//
+// A flow hashes to the sum of its fields, each multiplied by a
+// random odd key of its own (drawn by FFPStartup) - so the "src
+// addr + dst addr + protocol + ports" of the comments is a keyed
+// sum. As each field has its own key, the two directions of a
+// flow and flows that differ in one field only (a port scan) do
+// not hash alike. The sum is mixed once more, and its high bits
+// taken, to index a cache (FOLD_HASH_VALUE and RANGE_HASH_VALUE).
+//
+
+#define INIT_HASH_VALUE(IpHeader)                                            \
+    ((IpHeader)->Src  * FFHashKeys[FFHASH_KEY_SRC] +                          \
+     (IpHeader)->Dest * FFHashKeys[FFHASH_KEY_DEST])
+
+#define PROTOCOL_HASH_VALUE(IpHeader)                                        \
+    ((IpHeader)->Protocol * FFHashKeys[FFHASH_KEY_PROTOCOL])
+
+#define PORTS_HASH_VALUE(Ports)                                              \
+    ((Ports) * FFHashKeys[FFHASH_KEY_PORTS])
+
+#define MIX_HASH_VALUE(Value)                                                \
+    ((ULONG)(((Value) ^ ((Value) >> 16)) * FFHashKeys[FFHASH_KEY_FOLD]))
+
+#define FOLD_HASH_VALUE(Value, Shift)                                        \
+    (MIX_HASH_VALUE(Value) >> (Shift))
+
+#define RANGE_HASH_VALUE(Value, Range)                                       \
+    ((ULONG)(((ULONGLONG)MIX_HASH_VALUE(Value) * (Range)) >> 32))
 
 //
 // Macros to check if a cache entry is valid,
 // and validate or invalidate a cache entry.
 //
 
-#define INVALID_FORWARDING_CACHE_ENTRY(HashIndex)      \
-    (FastForwardingCacheValidBmp[(HashIndex)] == 0)
+#define FORWARDING_CACHE_MIGRATING()                   \
+    (FastForwardingCacheMigrated < (LONG)FastForwardingCacheOldSets)
 
-#define SET_FORWARDING_CACHE_ENTRY_TO_VALID(HashIndex) \
-    FastForwardingCacheValidBmp[(HashIndex)] = 1;
+#define INVALID_FORWARDING_CACHE_SET(SetIndex)         \
+    (FastForwardingCacheValidBmp[(SetIndex)] == 0)
+
+#define SET_FORWARDING_CACHE_WAY_TO_VALID(SetIndex, Way)  \
+    FastForwardingCacheValidBmp[(SetIndex)] |= (UCHAR)(1 << (Way));
+
+#define PREFETCH_FORWARDING_CACHE_SET(SetIndex)                               \
+{                                                                             \
+    ULONG _offset_;                                                           \
+                                                                              \
+    FFP_PREFETCH(&FastForwardingCacheValidBmp[(SetIndex)]);                   \
+                                                                              \
+    for (_offset_ = 0;                                                        \
+         _offset_ < sizeof(FFPCacheSet);                                      \
+         _offset_ += FFP_CACHE_LINE_SIZE)                                     \
+    {                                                                         \
+        FFP_PREFETCH((UCHAR *)&FastForwardingCache[(SetIndex)] + _offset_);   \
+    }                                                                         \
+                                                                              \
+    FFP_PREFETCH((UCHAR *)&FastForwardingCache[(SetIndex)+1] - 1);            \
+}
 
 #define INVALID_INCOMING_CACHE_ENTRY(HashIndex)        \
     (IncomingCacheValidBmp[(HashIndex)] == 0)
@@ -291,6 +546,16 @@ extern LONGLONG       FastPassedupCount;
 #define SET_FRAGMENT_CACHE_ENTRY_TO_VALID(HashIndex)   \
     FragmentCacheValidBmp[(HashIndex)] = 1;
 
+//
+// Statistics Macros
+//
+
+#define FFP_PROCESSOR_COUNTERS()                                              \
+    (&FFPCounters[KeGetCurrentProcessorNumber() & (FFP_MAX_PROCESSORS - 1)])
+
+#define COUNT_CACHE_EVENT(Cache, Counter)                                     \
+    (FFP_PROCESSOR_COUNTERS()->FFPPC_Caches[(Cache)].Counter++)
+
 //
 // Misc Macros
 //
@@ -350,6 +615,12 @@ FFPGetParameters (
     OUT      ULONG                         *FastforwardingCacheSize
     );
 
+VOID 
+FASTCALL 
+FFPGetCacheStatistics (
+    OUT      FFPCacheStats                 *CacheStats
+    );
+
 VOID
 FASTCALL 
 FFPFlushCaches (
@@ -416,6 +687,22 @@ FFPNoFiltering_FFPProcessReceivedPacket (
     OUT    HANDLE                          *OutgoingAdapter
     );
 
+ULONG
+FASTCALL
+FFPWithFiltering_FFPProcessReceivedPackets (
+    IN OUT FFPReceivedPacket               *Packets, 
+    IN     ULONG                            PacketCount, 
+    IN     HANDLE                           IncomingAdapter
+    );
+
+ULONG
+FASTCALL
+FFPNoFiltering_FFPProcessReceivedPackets (
+    IN OUT FFPReceivedPacket               *Packets, 
+    IN     ULONG                            PacketCount, 
+    IN     HANDLE                           IncomingAdapter
+    );
+
 VOID
 FASTCALL
 FFPWithFiltering_FFPProcessSentPacket (
@@ -486,7 +773,9 @@ FlushCaches (
 
 #define FlushCaches()                                                         \
     NdisZeroMemory(FastForwardingCacheValidBmp,                               \
-                   FastForwardingCacheSize * sizeof(CHAR));                   \
+                   FastForwardingCacheSets * sizeof(CHAR));                   \
+                                                                              \
+    FastForwardingCacheMigrated = (LONG)FastForwardingCacheOldSets;           \
                                                                               \
     NdisZeroMemory(IncomingCacheValidBmp,                                     \
                    IncomingCacheSize * sizeof(CHAR));                         \
@@ -568,6 +857,26 @@ FFPProcessReceivedPacket (
 #define FFPProcessReceivedPacket CurrFFPFuncs->pFFPProcessReceivedPacket
 
 
+/*++
+
+ULONG
+FASTCALL
+FFPProcessReceivedPackets (
+    IN OUT FFPReceivedPacket               *Packets, 
+    IN     ULONG                            PacketCount, 
+    IN     HANDLE                           IncomingAdapter
+    )
+
+  Routine Description
+
+    Dummy wrapper that calls the appropriate FFP handler 
+    for an array of packets received on one adapter.
+      
+--*/
+
+#define FFPProcessReceivedPackets CurrFFPFuncs->pFFPProcessReceivedPackets
+
+
 /*++
 
 VOID
@@ -29,7 +29,8 @@ FFPFunctions   FFPFilterFuncs = {
                                   &FFPWithFiltering_FFPProcessReceivedPacket,
                                   &FFPWithFiltering_FFPProcessSentPacket,
                                   &FFPWithFiltering_FFPProcessSetInFFCache,
-                                  &FFPWithFiltering_FFPProcessQueryFFCache
+                                  &FFPWithFiltering_FFPProcessQueryFFCache,
+                                  &FFPWithFiltering_FFPProcessReceivedPackets
                                 };
 
 // FFP Functions when filtering is OFF
@@ -37,7 +38,8 @@ FFPFunctions   FFPNofiltFuncs = {
                                   &FFPNoFiltering_FFPProcessReceivedPacket,
                                   &FFPNoFiltering_FFPProcessSentPacket,
                                   &FFPNoFiltering_FFPProcessSetInFFCache,
-                                  &FFPNoFiltering_FFPProcessQueryFFCache
+                                  &FFPNoFiltering_FFPProcessQueryFFCache,
+                                  &FFPNoFiltering_FFPProcessReceivedPackets
                                 };
 
 // String representation for cache entry types
@@ -67,6 +69,12 @@ LONGLONG   FastForwardedCount   = 0;
 LONGLONG   FastDroppedCount     = 0;
 LONGLONG   FastPassedupCount    = 0;
 
+// Cache statistics (a slot per processor), and heavy flow sample
+FFPProcessorCounters FFPCounters[FFP_MAX_PROCESSORS];
+
+FFPFlowSample      FFPTopFlows[FFP_SAMPLED_FLOWS];
+LONG volatile      FFPTopFlowsOwner     = 0;
+
 // To ensure atomicity in FFP state changes
 NDIS_SPIN_LOCK      FFPSpinLock;
 
@@ -75,7 +83,8 @@ NDIS_SPIN_LOCK      FFPSpinLock;
 //
 
 ULONG          FastForwardingCacheSize = 0;
-FFPCacheEntry *FastForwardingCache = NULL;
+ULONG          FastForwardingCacheSets = 0;
+FFPCacheSet   *FastForwardingCache = NULL;
 UCHAR         *FastForwardingCacheValidBmp = NULL;
 
 ULONG          IncomingCacheSize = 0;
@@ -86,8 +95,15 @@ ULONG          FragmentCacheSize = 0;
 IPHeaderInfo  *FragmentCache = NULL;
 UCHAR         *FragmentCacheValidBmp = NULL;
 
+ULONG          FastForwardingCacheOldSets = 0;
+FFPCacheSet   *FastForwardingCacheOld = NULL;
+UCHAR         *FastForwardingCacheOldValidBmp = NULL;
+LONG volatile  FastForwardingCacheMigrated = 0;
+LONG volatile  FastForwardingCacheMigrator = 0;
+
+ULONG          FFHashKeys[FFHASH_KEYS] = { 0 };
 ULONG          FFHashShift = 0;
-ULONG          FFHashMask = 0;
+ULONG          FFOldHashShift = 0;
 
 #endif // __FFP_GLB_H
 
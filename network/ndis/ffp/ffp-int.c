@@ -44,9 +44,29 @@ FFPStartup (
 --*/
 
 {
+    LARGE_INTEGER systemtime;
+    ULONG         seed;
+    UINT          i;
+
     // Allocate a lock to protect FFP resources in the future
     ALLOCATE_FFP_LOCK();
 
+    //
+    // Draw the keys of the flow hash - odd, so each
+    // key's product keeps every bit of its field
+    //
+
+    NdisGetCurrentSystemTime(&systemtime);
+
+    seed = systemtime.LowPart ^ systemtime.HighPart;
+
+    for (i = 0; i < FFHASH_KEYS; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+
+        FFHashKeys[i] = (seed ^ (seed >> 15)) | 1;
+    }
+
     return NDIS_STATUS_SUCCESS;
 }
 
@@ -269,16 +289,17 @@ FFPSetParameters (
 
   Arguments
 
-    fastforwardingcachesize = size (in bytes) taken up by FFP caches
+    FFCacheSize = size (in bytes) to be taken up by FFP caches, 0 for default
     
   Return Value
 
-      None
+      NDIS_STATUS_SUCCESS or NDIS_(error_status) 
 --*/
 {
     ULONG   fastforwardingcachesize;
     ULONG   incomingcachesize;
     ULONG   fragmentcachesize;
+    ULONG   othercachesbytes;
     ULONG   ffpwasenabled;
     ULONG   status;
 
@@ -300,6 +321,27 @@ FFPSetParameters (
     incomingcachesize = DEFAULT_INCOMING_CACHE_ENTRIES;
     fragmentcachesize = DEFAULT_FRAGMENT_CACHE_ENTRIES;
     fastforwardingcachesize = DEFAULT_FFCACHE_SIZE;
+
+    //
+    // What the incoming and fragment caches do not use goes
+    // to the fast forwarding cache (the inverse of the sum in 
+    // FFPGetParameters) - rounded and bounded when allocated
+    //
+
+    othercachesbytes = (incomingcachesize + fragmentcachesize) 
+                            * (sizeof(IPHeaderInfo) + 2*sizeof(UCHAR));
+
+    if (FFCacheSize)
+    {
+        fastforwardingcachesize = 1;
+
+        if (FFCacheSize > othercachesbytes + sizeof(FFPCacheSet))
+        {
+            fastforwardingcachesize = 
+                ((FFCacheSize - othercachesbytes) 
+                    / (sizeof(FFPCacheSet) + sizeof(UCHAR))) << FFCACHE_WAYS_SHIFT;
+        }
+    }
     
     status = FFPReInitializeCaches(fastforwardingcachesize,
                                    incomingcachesize,
@@ -336,8 +378,8 @@ FFPGetParameters (
     ACQUIRE_FFP_LOCK_SHARED();
     
     *FFCachesSize = 
-        FastForwardingCacheSize 
-                    * (sizeof(FFPCacheEntry) + sizeof(UCHAR)) 
+        FastForwardingCacheSets 
+                    * (sizeof(FFPCacheSet) + sizeof(UCHAR)) 
             + 
         (IncomingCacheSize + FragmentCacheSize) 
                     * (sizeof(IPHeaderInfo) + 2*sizeof(UCHAR));
@@ -345,6 +387,171 @@ FFPGetParameters (
     RELEASE_FFP_LOCK_SHARED();
 }
 
+VOID
+FASTCALL
+FFPGetCacheStatistics (
+    OUT              FFPCacheStats        *CacheStats
+    )
+/*++
+
+  Routine Description
+
+    Fills in a snapshot of the cache statistics - the counters
+    of all processors summed, the occupancy of each cache, and
+    the heavy flow sample, heaviest flow first. The packet path
+    is not stopped; it keeps counting while this runs.
+      
+  Arguments
+
+    CacheStats = snapshot (all but NdisProtocolType filled in)
+
+  Return Value
+
+    None
+--*/
+{
+    FFPProcessorCounters *counters;
+    FFPFlowSample         flowsample;
+    ULONG                 validways;
+    ULONG                 ways;
+    LONG                  cacheentrytype;
+    ULONG                 i;
+    ULONG                 j;
+
+    NdisZeroMemory((PUCHAR)CacheStats + sizeof(ULONG), 
+                   sizeof(FFPCacheStats) - sizeof(ULONG));
+
+    ACQUIRE_FFP_LOCK_SHARED();
+
+    CacheStats->FastForwardingCacheSize = FastForwardingCacheSize;
+    CacheStats->FastForwardingCacheSets = FastForwardingCacheSets;
+    CacheStats->IncomingCacheSize = IncomingCacheSize;
+    CacheStats->FragmentCacheSize = FragmentCacheSize;
+
+    // Sum the counters of each processor
+
+    for (i = 0; i < FFP_MAX_PROCESSORS; i++)
+    {
+        counters = &FFPCounters[i];
+
+        for (j = 0; j < FFP_CACHES; j++)
+        {
+            CacheStats->Caches[j].FFPCC_Lookups += 
+                counters->FFPPC_Caches[j].FFPCC_Lookups;
+            CacheStats->Caches[j].FFPCC_Hits += 
+                counters->FFPPC_Caches[j].FFPCC_Hits;
+            CacheStats->Caches[j].FFPCC_Seeds += 
+                counters->FFPPC_Caches[j].FFPCC_Seeds;
+            CacheStats->Caches[j].FFPCC_Evictions += 
+                counters->FFPPC_Caches[j].FFPCC_Evictions;
+            CacheStats->Caches[j].FFPCC_Busy += 
+                counters->FFPPC_Caches[j].FFPCC_Busy;
+        }
+
+        for (j = 0; j < 3; j++)
+        {
+            CacheStats->HitsByType[j] += counters->FFPPC_HitsByType[j];
+        }
+    }
+
+    //
+    // Count the valid ways of each fast forwarding cache set and
+    // the types of their entries (an entry being written as it is
+    // read might be counted under its old type)
+    //
+
+    for (i = 0; i < FastForwardingCacheSets; i++)
+    {
+        validways = FastForwardingCacheValidBmp[i];
+
+        for (ways = 0, j = 0; j < FFCACHE_WAYS; j++)
+        {
+            if (validways & (1 << j))
+            {
+                ways++;
+
+                cacheentrytype = 
+                    FastForwardingCache[i].FFPCS_Entry[j].FFPCE_CacheEntryType;
+
+                if (cacheentrytype >= FFP_DISCARD_PACKET && 
+                    cacheentrytype <= FFP_FORWARD_PACKET)
+                {
+                    CacheStats->EntriesByType[cacheentrytype + 1]++;
+                }
+            }
+        }
+
+        CacheStats->SetOccupancy[ways]++;
+    }
+
+    for (i = 0; i < IncomingCacheSize; i++)
+    {
+        if (!INVALID_INCOMING_CACHE_ENTRY(i))
+        {
+            CacheStats->IncomingCacheEntries++;
+        }
+    }
+
+    for (i = 0; i < FragmentCacheSize; i++)
+    {
+        if (!INVALID_FRAGMENT_CACHE_ENTRY(i))
+        {
+            CacheStats->FragmentCacheEntries++;
+        }
+    }
+
+    RELEASE_FFP_LOCK_SHARED();
+
+    //
+    // Pick the heaviest flows of the sample, heaviest first - 
+    // the packet path only ever holds the sample for a few
+    // compares, so wait for it
+    //
+
+    CacheStats->FlowSampleRate = FFP_FLOW_SAMPLE_RATE;
+
+    while (InterlockedCompareExchange((PLONG)&FFPTopFlowsOwner, 1, 0) != 0)
+        ;
+
+    for (i = 0; i < FFP_SAMPLED_FLOWS; i++)
+    {
+        flowsample = FFPTopFlows[i];
+
+        if (flowsample.FFPFS_Packets == 0)
+        {
+            continue;
+        }
+
+        j = CacheStats->TopFlowCount;
+
+        if (j == FFP_TOP_FLOWS)
+        {
+            if (CacheStats->TopFlows[j-1].FFPFS_Packets >= flowsample.FFPFS_Packets)
+            {
+                continue;
+            }
+
+            j--;
+        }
+        else
+        {
+            CacheStats->TopFlowCount++;
+        }
+
+        for ( ; 
+             j > 0 && 
+             CacheStats->TopFlows[j-1].FFPFS_Packets < flowsample.FFPFS_Packets; 
+             j--)
+        {
+            CacheStats->TopFlows[j] = CacheStats->TopFlows[j-1];
+        }
+
+        CacheStats->TopFlows[j] = flowsample;
+    }
+
+    InterlockedExchange((PLONG)&FFPTopFlowsOwner, 0);
+}
+
 VOID
 FASTCALL
 FFPFlushCaches (
@@ -383,6 +590,48 @@ FFPFlushCaches (
 // Helper Functions
 //
 
+static
+VOID
+FASTCALL
+FreeRetiredForwardingCache (
+    VOID
+    )
+/*++
+  Routine Description
+
+      Called to free the fast forwarding cache retired by a resize
+      (see FFPReInitializeCaches) - with the recv & send paths
+      disabled, as they might be looking at it otherwise.
+
+  Arguments
+
+      None
+
+  Return Value
+
+      None
+
+--*/
+{
+    if (FastForwardingCacheOld)
+    {
+        NdisFreeMemory(FastForwardingCacheOld, 
+                       FastForwardingCacheOldSets * sizeof(FFPCacheSet), 0);
+    }
+
+    if (FastForwardingCacheOldValidBmp)
+    {
+        NdisFreeMemory(FastForwardingCacheOldValidBmp, 
+                       FastForwardingCacheOldSets * sizeof(CHAR), 0);
+    }
+
+    FFOldHashShift = 0;
+    FastForwardingCacheOldSets = 0;
+    FastForwardingCacheOld = NULL;
+    FastForwardingCacheOldValidBmp = NULL;
+    FastForwardingCacheMigrated = 0;
+}
+
 static
 ULONG
 FASTCALL
@@ -408,15 +657,13 @@ FFPReInitializeCaches (
 
 --*/
 {
-    ULONG templong1;
-    ULONG templong2;
     UCHAR tempcount;
-    ULONG length;
     ULONG newffhashshift;
-    ULONG newffhashmask;
     ULONG newincomingcachesize;
     ULONG newfragmentcachesize;
     ULONG newfastforwardingcachesize;
+    ULONG newfastforwardingcachesets;
+    ULONG lruorder;
     UINT  i;
     NDIS_STATUS status;
     NDIS_PHYSICAL_ADDRESS phyaddr;
@@ -440,55 +687,42 @@ FFPReInitializeCaches (
 
     if ( fastforwardingcachesize == 0 )            // default = 2^10
     {
-        newfastforwardingcachesize = DEFAULT_FFCACHE_SIZE;
-        newffhashshift = DEF_FFC_COMPUTED_SHIFT;
-    }
-    else
-    if ( fastforwardingcachesize < MIN_FFCACHE_SIZE )    // = 2^8
-    {
-        newfastforwardingcachesize = MIN_FFCACHE_SIZE;
-        newffhashshift = MIN_FFC_COMPUTED_SHIFT;
+        fastforwardingcachesize = DEFAULT_FFCACHE_SIZE;
     }
     else
     if ( fastforwardingcachesize > MAX_FFCACHE_SIZE )    // = 2^16
     {
-        newfastforwardingcachesize = MAX_FFCACHE_SIZE;
-        newffhashshift = MAX_FFC_COMPUTED_SHIFT;
+        fastforwardingcachesize = MAX_FFCACHE_SIZE;
     }
-    else
-    {
-        //
-        // Increase the forwarding cache size to a power of 2
-        // It enables faster cache computation (without a mod)
-        //
 
-        templong1 = fastforwardingcachesize >> 8;
-        tempcount = 7;
-        while (templong1)
-        {
-            templong1 >>= 1;
-            tempcount++;
-        }
+    //
+    // Increase the forwarding cache size to a power of 2 (2^8 at least)
+    // It enables faster cache computation (without a mod)
+    //
 
-        newfastforwardingcachesize = 1 << tempcount;
-        if (newfastforwardingcachesize < fastforwardingcachesize)
-        {
-            newfastforwardingcachesize <<= 1;
-            tempcount++;
-        }
-            
-        newffhashshift = 16 - tempcount;
+    newfastforwardingcachesize = MIN_FFCACHE_SIZE;
+    tempcount = 8;
+    while (newfastforwardingcachesize < fastforwardingcachesize)
+    {
+        newfastforwardingcachesize <<= 1;
+        tempcount++;
     }
     
-    newffhashmask = newfastforwardingcachesize - 1;
+    //
+    // The hash picks a set of FFCACHE_WAYS entries, not an entry -
+    // it keeps as many high bits of the mixed hash as index a set
+    //
+
+    newfastforwardingcachesets = newfastforwardingcachesize >> FFCACHE_WAYS_SHIFT;
+    newffhashshift = 32 - (tempcount - FFCACHE_WAYS_SHIFT);
 
     FFPDbgPrint(("\nSuggested FF Cache Size: %lu\n"              \
-                 "\tActual Size: \t%lu\n\tActual Shift: \t%lu\n" \
-                 "\tActual Mask: \t%lu\n\n",
+                 "\tActual Size: \t%lu\n\tActual Sets: \t%lu\n" \
+                 "\tActual Shift: \t%lu\n\n",
                  fastforwardingcachesize,
                  newfastforwardingcachesize,
-                 newffhashshift,
-                 newffhashmask));
+                 newfastforwardingcachesets,
+                 newffhashshift));
 
     //
     // Initialize max phy address struct used in allocate memory calls
@@ -498,81 +732,108 @@ FFPReInitializeCaches (
     NdisSetPhysicalAddressLow (phyaddr, 0xffffffff);
 
     //
-    // Allocate (if cache size changed) and Zero FFP cache memory
+    // Allocate and initialize (if cache size changed) FFP cache memory -
+    // caches whose size does not change keep their contents
     //
 
     do
     {
         if (FastForwardingCacheSize != newfastforwardingcachesize)
         {
+            //
+            // A cache retired by an earlier resize is done with - the
+            // recv & send paths are disabled, so nothing looks at it
+            //
+
+            FreeRetiredForwardingCache();
+
+            //
+            // Retire the current cache rather than free it - the
+            // recv path moves its entries to the new one a few sets
+            // at a time, and looks up the sets not moved yet in it
+            // (see MigrateFastForwardingSets)
+            //
+
             if (FastForwardingCacheSize)
             {
-                FFPDbgPrint(("Free Mem: FFCache @ %08X, Size = %lu\n", 
+                FFPDbgPrint(("Retire Mem: FFCache @ %08X, Size = %lu\n", 
                              FastForwardingCache, 
                              FastForwardingCacheSize));
 
-                // Free the spinlock guarding each entry (dead code)
-                for (i = 0; i < FastForwardingCacheSize; i++)
-                {
-                    FREE_FORWARDING_ENTRY_SPINLOCK(&FastForwardingCache[i]);
-                }
+                FastForwardingCacheOld = FastForwardingCache;
+                FastForwardingCacheOldValidBmp = FastForwardingCacheValidBmp;
+                FastForwardingCacheOldSets = FastForwardingCacheSets;
+                FFOldHashShift = FFHashShift;
+            }
 
-                NdisFreeMemory(FastForwardingCache, 
-                               FastForwardingCacheSize * sizeof(FFPCacheEntry),
-                               0);
+            FastForwardingCacheMigrated = (LONG)FastForwardingCacheOldSets;
 
-                NdisFreeMemory(FastForwardingCacheValidBmp, 
-                               FastForwardingCacheSize * sizeof(CHAR), 
-                               0);
-            }
+            FastForwardingCache = NULL;
+            FastForwardingCacheValidBmp = NULL;
 
             FastForwardingCacheSize = newfastforwardingcachesize;
-            FFHashMask = newffhashmask;
+            FastForwardingCacheSets = newfastforwardingcachesets;
             FFHashShift = newffhashshift;
 
             status = 
              NdisAllocateMemory(&FastForwardingCache, 
-                                FastForwardingCacheSize*sizeof(FFPCacheEntry), 
+                                FastForwardingCacheSets*sizeof(FFPCacheSet), 
                                 0, 
                                 phyaddr);
 
             if (!NT_SUCCESS (status))
             {
+                FastForwardingCache = NULL;
                 break;
             }
 
             status = 
              NdisAllocateMemory(&FastForwardingCacheValidBmp, 
-                                FastForwardingCacheSize * sizeof(CHAR), 
+                                FastForwardingCacheSets * sizeof(CHAR), 
                                 0, 
                                 phyaddr);
 
             if (!NT_SUCCESS (status))
             {
+                FastForwardingCacheValidBmp = NULL;
                 break;
             }
 
             FFPDbgPrint(("Allocated Mem: FFCache @ %08X, Size = %lu\n", 
                          FastForwardingCache, 
                          FastForwardingCacheSize));
-        }
 
 #if 0
-        NdisZeroMemory ((VOID *)FastForwardingCache, 
-                        FastForwardingCacheSize * sizeof(FFPCacheEntry));
+            NdisZeroMemory ((VOID *)FastForwardingCache, 
+                            FastForwardingCacheSets * sizeof(FFPCacheSet));
 #endif
 
-        // Initialize the spinlock guarding each entry
-        for (i = 0; i < FastForwardingCacheSize; i++)
-        {
-            ALLOCATE_FORWARDING_ENTRY_SPINLOCK(&FastForwardingCache[i]);
-        }
+            //
+            // Initialize each set - no writer owns it, and 
+            // the LRU order lists every way (way 0 first)
+            //
+
+            lruorder = 0;
+            for (i = 0; i < FFCACHE_WAYS; i++)
+            {
+                lruorder |= i << (4 * i);
+            }
+
+            for (i = 0; i < FastForwardingCacheSets; i++)
+            {
+                FastForwardingCache[i].FFPCS_Sequence = 0;
+                FastForwardingCache[i].FFPCS_LruOrder = lruorder;
+            }
 
-        NdisZeroMemory ((VOID *)FastForwardingCacheValidBmp, 
-                        FastForwardingCacheSize * sizeof(CHAR));
+            NdisZeroMemory ((VOID *)FastForwardingCacheValidBmp, 
+                            FastForwardingCacheSets * sizeof(CHAR));
+
+            // Start moving the entries of the retired cache
+            FastForwardingCacheMigrated = 0;
+        }
         
         //
-        // Allocate (if cache size changed) and Zero Incoming cache memory
+        // Allocate and Zero (if cache size changed) Incoming cache memory
         //
 
         if (IncomingCacheSize != newincomingcachesize)
@@ -623,22 +884,22 @@ FFPReInitializeCaches (
             FFPDbgPrint(("Allocated Mem: IncCache @ %08X, Size = %lu\n", 
                          IncomingCache, 
                          IncomingCacheSize));
-        }
 #if 0
-        NdisZeroMemory((VOID *)IncomingCache, 
-                       IncomingCacheSize * sizeof(IPHeaderInfo));
+            NdisZeroMemory((VOID *)IncomingCache, 
+                           IncomingCacheSize * sizeof(IPHeaderInfo));
 #endif
 
-        // Initialize the spinlock guarding each entry
-        for (i = 0; i < IncomingCacheSize; i++)
-        {
-            ALLOCATE_INCOMING_ENTRY_SPINLOCK(&IncomingCache[i]);
-        }
+            // Initialize the spinlock guarding each entry
+            for (i = 0; i < IncomingCacheSize; i++)
+            {
+                ALLOCATE_INCOMING_ENTRY_SPINLOCK(&IncomingCache[i]);
+            }
 
-        NdisZeroMemory((VOID *)IncomingCacheValidBmp, 
-                       IncomingCacheSize * sizeof(CHAR));
+            NdisZeroMemory((VOID *)IncomingCacheValidBmp, 
+                           IncomingCacheSize * sizeof(CHAR));
+        }
 
-        // Allocate (if cache size changed) and Zero Fragment cache memory
+        // Allocate and Zero (if cache size changed) Fragment cache memory
 
         if (FragmentCacheSize != newfragmentcachesize)
         {
@@ -688,20 +949,20 @@ FFPReInitializeCaches (
             FFPDbgPrint(("Allocated Mem: FrgCache @ %08X, Size = %lu\n", 
                          FragmentCache, 
                          FragmentCacheSize));
-        }
 #if 0
-        NdisZeroMemory((VOID *)FragmentCache, 
-                       FragmentCacheSize * sizeof(IPHeaderInfo));
+            NdisZeroMemory((VOID *)FragmentCache, 
+                           FragmentCacheSize * sizeof(IPHeaderInfo));
 #endif
 
-        // Initialize the spinlock guarding each entry
-        for (i = 0; i < FragmentCacheSize; i++)
-        {
-            ALLOCATE_FRAGMENT_ENTRY_SPINLOCK(&FragmentCache[i]);
-        }
+            // Initialize the spinlock guarding each entry
+            for (i = 0; i < FragmentCacheSize; i++)
+            {
+                ALLOCATE_FRAGMENT_ENTRY_SPINLOCK(&FragmentCache[i]);
+            }
 
-        NdisZeroMemory((VOID *)FragmentCacheValidBmp, 
-                       FragmentCacheSize * sizeof(CHAR));
+            NdisZeroMemory((VOID *)FragmentCacheValidBmp, 
+                           FragmentCacheSize * sizeof(CHAR));
+        }
 
         FFPDbgPrint(("Final Cache Sizes: \n\tFastFwdingCache: %lu\n"   \
                      "\tIncomingCache: %lu\n\tFragmentCache: %lu\n\n",
@@ -746,25 +1007,21 @@ FFPDestroyCaches (
 
     if (FastForwardingCache)
     {
-        // Free the spinlock guarding each entry (dead code)
-        for (i = 0; i < FastForwardingCacheSize; i++)
-        {
-            FREE_FORWARDING_ENTRY_SPINLOCK(&FastForwardingCache[i]);
-        }
-
         NdisFreeMemory(FastForwardingCache, 
-                       FastForwardingCacheSize * sizeof(FFPCacheEntry), 0);
+                       FastForwardingCacheSets * sizeof(FFPCacheSet), 0);
     }
 
     if (FastForwardingCacheValidBmp)
     {
         NdisFreeMemory(FastForwardingCacheValidBmp, 
-                       FastForwardingCacheSize * sizeof(CHAR), 0);
+                       FastForwardingCacheSets * sizeof(CHAR), 0);
     }
     
-    FFHashMask = 0;
+    FreeRetiredForwardingCache();
+
     FFHashShift = 0;
     FastForwardingCacheSize = 0;
+    FastForwardingCacheSets = 0;
     FastForwardingCache = NULL;
     FastForwardingCacheValidBmp = NULL;
 
@@ -1389,6 +1646,42 @@ FFPHandleOidQueryRequest (
         break;
        }
 
+    case OID_FFP_CACHE_STATS:
+       {
+        FFPCacheStats *cacheStats;
+        
+        FFPDbgPrintX(("Netflex3QueryInformation:OID_FFP_CACHE_STATS:\n Buffer Length: %d\n",
+                                                    InformationBufferLength));
+
+        // Validate the incoming buffer size
+        if (InformationBufferLength != sizeof(FFPCacheStats))
+        {
+            *BytesNeeded = sizeof(FFPCacheStats);
+            Status = NDIS_STATUS_INVALID_LENGTH;
+            break;
+        }
+
+        cacheStats = (FFPCacheStats *)InformationBuffer;
+
+        if (cacheStats->NdisProtocolType != NDIS_PROTOCOL_ID_TCP_IP)
+        {
+            Status = NDIS_STATUS_NOT_SUPPORTED;
+            break;
+        }
+
+        *BytesWritten = sizeof(FFPCacheStats) - sizeof(ULONG);
+
+        FFPGetCacheStatistics(cacheStats);
+
+        FFPDbgPrintX(("Query Value: FFC Lookups %lu, Hits %lu, Evictions %lu, "
+                                    "Top Flows %lu\n",
+                        cacheStats->Caches[FFP_FF_CACHE].FFPCC_Lookups,
+                        cacheStats->Caches[FFP_FF_CACHE].FFPCC_Hits,
+                        cacheStats->Caches[FFP_FF_CACHE].FFPCC_Evictions,
+                        cacheStats->TopFlowCount));
+        break;
+       }
+
     default:
        {
         Status = NDIS_STATUS_NOT_SUPPORTED;
@@ -25,6 +25,12 @@ Revision History:
 
 #include "precomp.h"
 
+//
+// Slicing-by-8 tables for CardComputeCrc, built by
+// CardInitializeCrcTable from DriverEntry.
+//
+ULONG CardCrcTable[8][256];
+
 BOOLEAN
 CardSlotTest(
     IN PNE2000_ADAPTER Adapter
@@ -2544,6 +2550,67 @@ Return Value:
 
 }
 
+#pragma NDIS_INIT_FUNCTION(CardInitializeCrcTable)
+
+VOID
+CardInitializeCrcTable(
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    Builds CardCrcTable for CardComputeCrc.  CardCrcTable[0] is the
+    usual table for running the CRC a byte at a time; CardCrcTable[n]
+    also runs the result through n zero bytes, so that CardComputeCrc
+    can fold eight bytes into the CRC with eight independent lookups.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+    ULONG Crc;
+    UINT i, j;
+
+    for (i = 0; i < 256; i++) {
+
+        Crc = i;
+
+        for (j = 0; j < 8; j++) {
+
+            Crc = (Crc & 1) ? ((Crc >> 1) ^ 0xedb88320) : (Crc >> 1);
+
+        }
+
+        CardCrcTable[0][i] = Crc;
+
+    }
+
+    for (i = 0; i < 256; i++) {
+
+        Crc = CardCrcTable[0][i];
+
+        for (j = 1; j < 8; j++) {
+
+            Crc = (Crc >> 8) ^ CardCrcTable[0][Crc & 0xff];
+
+            CardCrcTable[j][i] = Crc;
+
+        }
+
+    }
+
+}
+
+
 ULONG
 CardComputeCrc(
     IN PUCHAR Buffer,
@@ -2569,77 +2636,103 @@ Return Value:
 
 Note:
 
-    This is adapted from the comments in the assembly language
-    version in _GENREQ.ASM of the DWB NE1000/2000 driver.
+    The bits of each byte go into the CRC least significant first, as
+    they go on the wire, so the CRC is computed bit reversed with the
+    slicing-by-8 tables from CardInitializeCrcTable and turned around
+    at the end.  The result is the same as that of the bit at a time
+    loop adapted from _GENREQ.ASM of the DWB NE1000/2000 driver.
 
 --*/
 
 {
-    ULONG Crc, Carry;
-    UINT i, j;
-    UCHAR CurByte;
+    ULONG Crc;
 
     Crc = 0xffffffff;
 
-    for (i = 0; i < Length; i++) {
+    while (Length >= 8) {
 
-        CurByte = Buffer[i];
+        Crc ^= (ULONG)Buffer[0] | ((ULONG)Buffer[1] << 8) |
+               ((ULONG)Buffer[2] << 16) | ((ULONG)Buffer[3] << 24);
 
-        for (j = 0; j < 8; j++) {
+        Crc = CardCrcTable[7][Crc & 0xff] ^
+              CardCrcTable[6][(Crc >> 8) & 0xff] ^
+              CardCrcTable[5][(Crc >> 16) & 0xff] ^
+              CardCrcTable[4][Crc >> 24] ^
+              CardCrcTable[3][Buffer[4]] ^
+              CardCrcTable[2][Buffer[5]] ^
+              CardCrcTable[1][Buffer[6]] ^
+              CardCrcTable[0][Buffer[7]];
+
+        Buffer += 8;
+        Length -= 8;
 
-            Carry = ((Crc & 0x80000000) ? 1 : 0) ^ (CurByte & 0x01);
+    }
 
-            Crc <<= 1;
+    if (Length >= 4) {
 
-            CurByte >>= 1;
+        Crc ^= (ULONG)Buffer[0] | ((ULONG)Buffer[1] << 8) |
+               ((ULONG)Buffer[2] << 16) | ((ULONG)Buffer[3] << 24);
 
-            if (Carry) {
+        Crc = CardCrcTable[3][Crc & 0xff] ^
+              CardCrcTable[2][(Crc >> 8) & 0xff] ^
+              CardCrcTable[1][(Crc >> 16) & 0xff] ^
+              CardCrcTable[0][Crc >> 24];
 
-                Crc = (Crc ^ 0x04c11db6) | Carry;
+        Buffer += 4;
+        Length -= 4;
 
-            }
+    }
 
-        }
+    while (Length > 0) {
+
+        Crc = (Crc >> 8) ^ CardCrcTable[0][(Crc ^ *Buffer) & 0xff];
+
+        Buffer++;
+        Length--;
 
     }
 
+    //
+    // Reverse the bits.
+    //
+
+    Crc = ((Crc >> 1) & 0x55555555) | ((Crc & 0x55555555) << 1);
+    Crc = ((Crc >> 2) & 0x33333333) | ((Crc & 0x33333333) << 2);
+    Crc = ((Crc >> 4) & 0x0f0f0f0f) | ((Crc & 0x0f0f0f0f) << 4);
+    Crc = ((Crc >> 8) & 0x00ff00ff) | ((Crc & 0x00ff00ff) << 8);
+    Crc = (Crc >> 16) | (Crc << 16);
+
     return Crc;
 
 }
 
-
-VOID
+
+UCHAR
 CardGetMulticastBit(
-    IN UCHAR Address[NE2000_LENGTH_OF_ADDRESS],
-    OUT UCHAR * Byte,
-    OUT UCHAR * Value
+    IN UCHAR Address[NE2000_LENGTH_OF_ADDRESS]
     )
 
 /*++
 
 Routine Description:
 
-    For a given multicast address, returns the byte and bit in
-    the card multicast registers that it hashes to. Calls
-    CardComputeCrc() to determine the CRC value.
+    For a given multicast address, returns the bit in the card
+    multicast registers that it hashes to. Calls CardComputeCrc()
+    to determine the CRC value.
 
 Arguments:
 
     Address - the address
 
-    Byte - the byte that it hashes to
-
-    Value - will have a 1 in the relevant bit
-
 Return Value:
 
-    None.
+    The bit number, 0 to 63.  The bit is (BitNumber % 8) of
+    register (BitNumber / 8).
 
 --*/
 
 {
     ULONG Crc;
-    UINT BitNumber;
 
     //
     // First compute the CRC.
@@ -2652,28 +2745,37 @@ Return Value:
     // The bit number is now in the 6 most significant bits of CRC.
     //
 
-    BitNumber = (UINT)((Crc >> 26) & 0x3f);
-
-    *Byte = (UCHAR)(BitNumber / 8);
-    *Value = (UCHAR)((UCHAR)1 << (BitNumber % 8));
+    return (UCHAR)((Crc >> 26) & 0x3f);
 }
-
+
 VOID
-CardFillMulticastRegs(
-    IN PNE2000_ADAPTER Adapter
+CardUpdateMulticastList(
+    IN PNE2000_ADAPTER Adapter,
+    IN PUCHAR Addresses,
+    IN UINT Count
     )
 
 /*++
 
 Routine Description:
 
-    Erases and refills the card multicast registers. Used when
-    an address has been deleted and all bits must be recomputed.
+    Makes Addresses the multicast list of the adapter and brings
+    Adapter->NicMulticastRegs up to date with it.  An address that
+    was already in the list keeps the bit it hashed to, so only the
+    added addresses are run through the CRC, and only the bits of
+    added and removed addresses are touched.  The registers that
+    changed are marked in Adapter->NicMulticastRegsChanged for
+    CardCopyChangedMulticastRegs.
 
 Arguments:
 
     Adapter - pointer to the adapter block
 
+    Addresses - the new list
+
+    Count - the number of addresses in the new list, no more than
+        DEFAULT_MULTICASTLISTMAX
+
 Return Value:
 
     None.
@@ -2681,30 +2783,95 @@ Return Value:
 --*/
 
 {
-    UINT i;
-    UCHAR Byte, Bit;
+    UCHAR Bits[DEFAULT_MULTICASTLISTMAX];
+    BOOLEAN Kept[DEFAULT_MULTICASTLISTMAX];
+    UCHAR OldRegs[8];
+    PUCHAR Address;
+    UCHAR Bit;
+    UINT i, j;
+
+    NE2000_MOVE_MEM(OldRegs, Adapter->NicMulticastRegs, 8);
+
+    for (i = 0; i < Adapter->MulticastCount; i++) {
+
+        Kept[i] = FALSE;
+
+    }
 
     //
-    // First turn all bits off.
+    // Find the bit of each address in the new list, turning on the
+    // bits of addresses that were not in the old one.
     //
 
-    for (i=0; i<8; i++) {
+    for (j = 0; j < Count; j++) {
+
+        Address = Addresses + (j * NE2000_LENGTH_OF_ADDRESS);
+
+        for (i = 0; i < Adapter->MulticastCount; i++) {
+
+            if (!Kept[i] &&
+                NdisEqualMemory(Address,
+                                Adapter->Addresses[i],
+                                NE2000_LENGTH_OF_ADDRESS)) {
+
+                break;
+
+            }
+
+        }
+
+        if (i < Adapter->MulticastCount) {
 
-        Adapter->NicMulticastRegs[i] = 0;
+            Kept[i] = TRUE;
+            Bits[j] = Adapter->MulticastBits[i];
+
+        } else {
+
+            Bit = CardGetMulticastBit(Address);
+
+            if (Adapter->MulticastBitCounts[Bit]++ == 0) {
+
+                Adapter->NicMulticastRegs[Bit / 8] |= (UCHAR)(1 << (Bit % 8));
+
+            }
+
+            Bits[j] = Bit;
+
+        }
 
     }
 
     //
-    // Now turn on the bit for each address in the multicast list.
+    // Turn off the bits no address hashes to any more.
     //
 
-    for ( ; i > 0; ) {
+    for (i = 0; i < Adapter->MulticastCount; i++) {
+
+        if (!Kept[i]) {
+
+            Bit = Adapter->MulticastBits[i];
 
-        i--;
+            if (--Adapter->MulticastBitCounts[Bit] == 0) {
 
-        CardGetMulticastBit(Adapter->Addresses[i], &Byte, &Bit);
+                Adapter->NicMulticastRegs[Bit / 8] &= (UCHAR)~(1 << (Bit % 8));
 
-        Adapter->NicMulticastRegs[Byte] |= Bit;
+            }
+
+        }
+
+    }
+
+    NE2000_MOVE_MEM(Adapter->Addresses, Addresses, Count * NE2000_LENGTH_OF_ADDRESS);
+    NE2000_MOVE_MEM(Adapter->MulticastBits, Bits, Count);
+    Adapter->MulticastCount = Count;
+
+    for (i = 0; i < 8; i++) {
+
+        if (Adapter->NicMulticastRegs[i] != OldRegs[i]) {
+
+            Adapter->NicMulticastRegsChanged |= (UCHAR)(1 << i);
+
+        }
 
     }
 
@@ -2716,7 +2883,7 @@ Return Value:
 
 
 
-
+
 BOOLEAN SyncCardStop(
     IN PVOID SynchronizeContext
 )
@@ -3008,7 +3175,8 @@ SyncCardCopyMulticastRegs(
 
 Routine Description:
 
-    Sets the eight bytes in the card multicast registers.
+    Sets the card multicast registers marked in
+    Adapter->NicMulticastRegsChanged from Adapter->NicMulticastRegs.
 
 Arguments:
 
@@ -3033,18 +3201,24 @@ Return Value:
 
     for (i=0; i<8; i++) {
 
-        NdisRawWritePortUchar( Adapter->IoPAddr+(NIC_MC_ADDR+i),
-                        Adapter->NicMulticastRegs[i]);
+        if (Adapter->NicMulticastRegsChanged & (1 << i)) {
+
+            NdisRawWritePortUchar( Adapter->IoPAddr+(NIC_MC_ADDR+i),
+                            Adapter->NicMulticastRegs[i]);
+
+        }
 
     }
 
+    Adapter->NicMulticastRegsChanged = 0;
+
     NdisRawWritePortUchar( Adapter->IoPAddr+NIC_COMMAND,
                     CR_START | CR_NO_DMA | CR_PAGE0);
 
     return FALSE;
 
 }
-
+
 BOOLEAN
 SyncCardAcknowledgeOverflow(
     IN PVOID SynchronizeContext
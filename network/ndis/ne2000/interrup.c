@@ -533,17 +533,27 @@ Return Value:
 
             PacketLen = (Adapter->PacketHeader[2]) + ((Adapter->PacketHeader[3])*256) - 4;
 
-            PacketLen = (PacketLen < Adapter->MaxLookAhead)?
-                         PacketLen :
-                         Adapter->MaxLookAhead;
-
             //
-            // Copy up the lookahead data
+            // Copy up the whole frame if it is small enough, so that it
+            // can be indicated without a second trip to the card in
+            // Ne2000TransferData.  Otherwise copy up the lookahead data.
             //
+            if (PacketLen > Adapter->RcvCopyLimit) {
+
+                PacketLen = (PacketLen < Adapter->MaxLookAhead)?
+                             PacketLen :
+                             Adapter->MaxLookAhead;
+
+                PacketLen += NE2000_HEADER_SIZE;
+
+            }
+
+            Adapter->LookaheadLength = PacketLen;
+
             if (!CardCopyUp(Adapter,
                             Adapter->Lookahead,
                             Adapter->PacketHeaderLoc,
-                            PacketLen + NE2000_HEADER_SIZE
+                            PacketLen
                             )) {
 
                 //
@@ -1280,10 +1290,11 @@ Return Value:
 #endif
 
     //
-    // Lookahead amount to indicate
+    // Lookahead amount to indicate, the whole packet if Ne2000RcvDpc
+    // copied it all up
     //
-    IndicateLen = (PacketLen > (Adapter->MaxLookAhead + NE2000_HEADER_SIZE)) ?
-                           (Adapter->MaxLookAhead + NE2000_HEADER_SIZE) :
+    IndicateLen = (PacketLen > Adapter->LookaheadLength) ?
+                           Adapter->LookaheadLength :
                            PacketLen;
 
     //
@@ -1441,6 +1452,35 @@ Notes:
     //
     BytesLeft = BytesWanted;
 
+    if (ByteOffset + BytesWanted <= Adapter->LookaheadLength) {
+
+        //
+        // Ne2000RcvDpc already copied this part of the packet up from
+        // the card; copy it from the lookahead buffer.
+        //
+        NdisQueryPacket(Packet, NULL, NULL, &CurBuffer, NULL);
+
+        while ((BytesLeft > 0) && (CurBuffer != (PNDIS_BUFFER)NULL)) {
+
+            NdisQueryBuffer(CurBuffer, (PVOID *)&BufStart, &BufLen);
+
+            BytesNow = (BufLen > BytesLeft) ? BytesLeft : BufLen;
+
+            NE2000_MOVE_MEM(BufStart, Adapter->Lookahead + ByteOffset, BytesNow);
+
+            ByteOffset += BytesNow;
+            BytesLeft -= BytesNow;
+
+            NdisGetNextBuffer(CurBuffer, &CurBuffer);
+
+        }
+
+        *BytesTransferred = BytesWanted - BytesLeft;
+
+        return(NDIS_STATUS_SUCCESS);
+
+    }
+
     {
 
         //
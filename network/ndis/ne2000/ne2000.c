@@ -207,6 +207,11 @@ Return Value:
     NewDriver->NdisWrapperHandle = NdisWrapperHandle;
     NewDriver->AdapterQueue = (PNE2000_ADAPTER)NULL;
 
+    //
+    // Build the tables for hashing multicast addresses.
+    //
+    CardInitializeCrcTable();
+
     //
     // Initialize the Miniport characteristics for the call to
     // NdisMRegisterMiniport.
@@ -812,6 +817,7 @@ RegisterAdapter:
     Adapter->MiniportAdapterHandle = MiniportAdapterHandle;
 
     Adapter->MaxLookAhead = NE2000_MAX_LOOKAHEAD;
+    Adapter->RcvCopyLimit = NE2000_MAX_FRAME_SIZE;
 
     //
     // Now do the work.
@@ -1765,15 +1771,30 @@ Return Value:
 
         }
 
+        if (OidLength > (Adapter->MulticastListMax * NE2000_LENGTH_OF_ADDRESS)){
+
+            StatusToReturn = NDIS_STATUS_MULTICAST_FULL;
+
+            *BytesRead = 0;
+            *BytesNeeded = 0;
+
+            break;
+
+        }
+
         //
-        // Set the new list on the adapter.
+        // Set the new list on the adapter.  Only the addresses that
+        // were added or removed are hashed.
         //
-        NdisMoveMemory(Adapter->Addresses, InfoBuffer, OidLength);
+        CardUpdateMulticastList(Adapter,
+                                (PUCHAR)InfoBuffer,
+                                OidLength / NE2000_LENGTH_OF_ADDRESS);
 
         //
         //  If we are currently receiving all multicast or
-        //  we are promsicuous then we DO NOT call this, or
-        //  it will reset thoes settings.
+        //  we are promsicuous then we DO NOT touch the card, or
+        //  it will reset thoes settings.  Otherwise write out just
+        //  the registers that changed.
         //
         if
         (
@@ -1781,7 +1802,7 @@ Return Value:
                                        NDIS_PACKET_TYPE_PROMISCUOUS))
         )
         {
-            StatusToReturn = DispatchSetMulticastAddressList(Adapter);
+            CardCopyChangedMulticastRegs(Adapter);
         }
         else
         {
@@ -2025,17 +2046,16 @@ Return Value:
 Implementation Note:
 
     When invoked, we are to make it so that the multicast list in the filter
-    package becomes the multicast list for the adapter. To do this, we
-    determine the required contents of the NIC multicast registers and
-    update them.
+    package becomes the multicast list for the adapter. The local copy of
+    the NIC multicast registers is kept up to date with the list by
+    CardUpdateMulticastList, so all there is to do is copy it to the NIC.
 
 
 --*/
 {
     //
-    // Update the local copy of the NIC multicast regs and copy them to the NIC
+    // Copy the local copy of the NIC multicast regs to the NIC
     //
-    CardFillMulticastRegs(Adapter);
     CardCopyMulticastRegs(Adapter);
 
     return NDIS_STATUS_SUCCESS;
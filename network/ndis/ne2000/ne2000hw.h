@@ -358,8 +358,38 @@ Revision History:
 //--
 
 #define CardCopyMulticastRegs(Adapter) \
-    NdisMSynchronizeWithInterrupt(&(Adapter)->Interrupt, \
-                SyncCardCopyMulticastRegs, (PVOID)(Adapter))
+    ((Adapter)->NicMulticastRegsChanged = 0xff, \
+     NdisMSynchronizeWithInterrupt(&(Adapter)->Interrupt, \
+                SyncCardCopyMulticastRegs, (PVOID)(Adapter)))
+
+
+//++
+//
+// VOID
+// CardCopyChangedMulticastRegs(
+//     IN PNE2000_ADAPTER Adapter
+//     )
+//
+// Routine Description:
+//
+//  Writes out the multicast registers marked in
+//  Adapter->NicMulticastRegsChanged, if any, from
+//  Adapter->NicMulticastRegs.  Calls SyncCardCopyMulticastRegs.
+//
+// Arguments:
+//
+//  Adapter - The adapter block.
+//
+// Return Value:
+//
+//  None.
+//
+//--
+
+#define CardCopyChangedMulticastRegs(Adapter) \
+    (((Adapter)->NicMulticastRegsChanged != 0) ? \
+     NdisMSynchronizeWithInterrupt(&(Adapter)->Interrupt, \
+                SyncCardCopyMulticastRegs, (PVOID)(Adapter)) : FALSE)
 
 
 
@@ -156,6 +156,11 @@ typedef enum {
 //
 #define NE2000_MAX_LOOKAHEAD (252 - NE2000_HEADER_SIZE)
 
+//
+// Size of the largest frame, without CRC
+//
+#define NE2000_MAX_FRAME_SIZE 1514
+
 //
 // Maximum number of transmit buffers on the card.
 //
@@ -473,6 +478,7 @@ typedef struct _NE2000_ADAPTER {
     //
 
     UCHAR NicMulticastRegs[8];          // contents of card multicast registers
+    UCHAR NicMulticastRegsChanged;      // bit n set if NicMulticastRegs[n] is not on the card
     UCHAR NicReceiveConfig;             // contents of NIC RCR
     UCHAR NicInterruptMask;             // contents of NIC IMR
 
@@ -481,6 +487,14 @@ typedef struct _NE2000_ADAPTER {
     //
     ULONG MaxLookAhead;
 
+    //
+    // Frames no longer than this are copied up from the card whole
+    // and indicated from Lookahead, so that protocols need not call
+    // Ne2000TransferData for them.  Longer frames are indicated with
+    // MaxLookAhead bytes of lookahead.
+    //
+    ULONG RcvCopyLimit;
+
     //
     // These are for the current packet being indicated.
     //
@@ -496,15 +510,28 @@ typedef struct _NE2000_ADAPTER {
     PUCHAR PacketHeaderLoc;
 
     //
-    // Lookahead buffer
+    // Number of bytes of the current packet copied into Lookahead.
+    //
+    UINT LookaheadLength;
+
+    //
+    // Lookahead buffer, large enough for a whole frame
     //
-    UCHAR Lookahead[NE2000_MAX_LOOKAHEAD + NE2000_HEADER_SIZE];
+    UCHAR Lookahead[NE2000_MAX_FRAME_SIZE];
 
     //
     // List of multicast addresses in use.
     //
     CHAR Addresses[DEFAULT_MULTICASTLISTMAX][NE2000_LENGTH_OF_ADDRESS];
 
+    //
+    // Number of addresses in Addresses, the multicast register bit
+    // each one hashes to, and how many addresses hash to each bit.
+    //
+    UINT MulticastCount;
+    UCHAR MulticastBits[DEFAULT_MULTICASTLISTMAX];
+    UCHAR MulticastBitCounts[64];
+
 } NE2000_ADAPTER, * PNE2000_ADAPTER;
 
 
@@ -756,6 +783,11 @@ CardCopyUp(
     IN UINT Length
     );
 
+VOID
+CardInitializeCrcTable(
+    VOID
+    );
+
 ULONG
 CardComputeCrc(
     IN PUCHAR Buffer,
@@ -769,16 +801,16 @@ CardGetPacketCrc(
     OUT UCHAR Crc[4]
     );
 
-VOID
+UCHAR
 CardGetMulticastBit(
-    IN UCHAR Address[NE2000_LENGTH_OF_ADDRESS],
-    OUT UCHAR * Byte,
-    OUT UCHAR * Value
+    IN UCHAR Address[NE2000_LENGTH_OF_ADDRESS]
     );
 
 VOID
-CardFillMulticastRegs(
-    IN PNE2000_ADAPTER Adapter
+CardUpdateMulticastList(
+    IN PNE2000_ADAPTER Adapter,
+    IN PUCHAR Addresses,
+    IN UINT Count
     );
 
 VOID
@@ -0,0 +1,763 @@
+/*++
+
+Copyright (c) 1990-2000  Microsoft Corporation
+
+Module Name:
+
+    dp8390.c
+
+Abstract:
+
+    Behavioural model of an NE2000: a National DP8390 with 16K of
+    buffer memory at 0x4000 and the station address PROM at 0, behind
+    the raw port macros of ne2ksim.h.
+
+    Modelled are the three register pages, the receive ring with
+    PSTART, PSTOP, BNRY and CURR, the 4 byte header the NIC stores in
+    front of every frame, remote DMA through the data port in byte and
+    word mode (including the wrap at PSTOP and the CRDA register the
+    write errata code polls), address filtering, ring overflow, the
+    tally counters and transmit completion.
+
+    Everything happens at once: a remote DMA is done when its last
+    byte has gone through the data port, a transmit when it is
+    started. The model counts the I/O cycles the driver spends, which
+    is what limits it on a real ISA bus.
+
+Author:
+
+
+Environment:
+
+    User mode.
+
+Revision History:
+
+--*/
+
+#include "ne2ksim.h"
+#include "..\ne2000hw.h"
+
+
+#define RAM_START           0x4000
+#define RAM_STOP            0x8000
+#define PROM_LENGTH         32
+
+#define RESET_PORT          0x18        // 0x18-0x1F, NIC_RESET among them
+
+#define CR_PAGE_MASK        (CR_PS0 | CR_PS1)
+#define CR_DMA_MASK         (CR_DMA_READ | CR_DMA_WRITE | CR_NO_DMA)
+
+#define TCR_LOOPBACK_MASK   0x06
+
+#define MSB(Value)          ((UCHAR)((((ULONG)Value) >> 8) & 0xff))
+#define LSB(Value)          ((UCHAR)(((ULONG)Value) & 0xff))
+
+
+typedef struct _DP8390 {
+
+    ULONG_PTR   IoBase;
+
+    UCHAR       Command;                // CR
+    UCHAR       PageStart;              // PSTART
+    UCHAR       PageStop;               // PSTOP
+    UCHAR       Boundary;               // BNRY
+    UCHAR       Current;                // CURR
+    UCHAR       TransmitPage;           // TPSR
+    USHORT      TransmitCount;          // TBCR
+    UCHAR       TransmitStatus;         // TSR
+    UCHAR       InterruptStatus;        // ISR
+    UCHAR       InterruptMask;          // IMR
+    UCHAR       DataConfig;             // DCR
+    UCHAR       TransmitConfig;         // TCR
+    UCHAR       ReceiveConfig;          // RCR
+    UCHAR       ReceiveStatus;          // RSR
+    UCHAR       PhysicalAddress[6];     // PAR
+    UCHAR       Multicast[8];           // MAR
+    USHORT      RemoteAddress;          // RSAR
+    USHORT      RemoteCount;            // RBCR
+    USHORT      DmaAddress;             // CRDA
+    USHORT      DmaCount;               // bytes left in the remote DMA
+    UCHAR       Counters[3];            // CNTR0-2
+
+    UCHAR       Memory[0x10000];
+
+    } DP8390, *PDP8390;
+
+
+DP8390              Nic;
+DP8390_STATISTICS   Dp8390Statistics;
+
+
+VOID
+Dp8390Initialize(
+    IN ULONG_PTR    IoBase,
+    IN PUCHAR       PermanentAddress,
+    IN BOOLEAN      EightBitSlot
+    )
+/*++
+
+Routine Description:
+
+    Powers the card up: stopped, with the PROM holding the station
+    address and the 'WW' or 'BB' signature CardSlotTest looks for.
+    Like on the card, every PROM byte appears twice.
+
+Arguments:
+
+    IoBase - port the driver will use as Adapter->IoPAddr.
+
+    PermanentAddress - the address in the PROM.
+
+    EightBitSlot - whether the card says it is in an 8 bit slot.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    UINT    i;
+
+    memset(&Nic, 0, sizeof(Nic));
+    memset(&Dp8390Statistics, 0, sizeof(Dp8390Statistics));
+
+    Nic.IoBase = IoBase;
+    Nic.Command = CR_STOP | CR_NO_DMA;
+    Nic.InterruptStatus = ISR_RESET;
+
+    memset(Nic.Memory, 0xFF, sizeof(Nic.Memory));
+
+    for (i = 0; i < PROM_LENGTH / 2; i++) {
+
+        UCHAR   Byte;
+
+        if (i < 6) {
+            Byte = PermanentAddress[i];
+        } else if (i >= 14) {
+            Byte = EightBitSlot ? 'B' : 'W';
+        } else {
+            Byte = 0;
+        }
+
+        Nic.Memory[2 * i] = Byte;
+        Nic.Memory[2 * i + 1] = Byte;
+    }
+}
+
+
+static
+VOID
+Dp8390Reset(
+    VOID
+    )
+{
+    Nic.Command = CR_STOP | CR_NO_DMA;
+    Nic.InterruptStatus |= ISR_RESET;
+    Nic.DmaCount = 0;
+}
+
+
+static
+USHORT
+Dp8390NextAddress(
+    USHORT  Address
+    )
+{
+    Address++;
+
+    //
+    // Remote DMA wraps around the receive ring
+    //
+    if (Nic.PageStop != 0 && Address == (USHORT)(Nic.PageStop << 8)) {
+        Address = (USHORT)(Nic.PageStart << 8);
+    }
+
+    return Address;
+}
+
+
+static
+UCHAR
+Dp8390DmaRead(
+    VOID
+    )
+/*++
+
+Routine Description:
+
+    Moves one byte from buffer memory to the data port.
+
+--*/
+{
+    UCHAR   Byte;
+
+    if (Nic.DmaAddress < PROM_LENGTH
+        || (Nic.DmaAddress >= RAM_START && Nic.DmaAddress < RAM_STOP)) {
+        Byte = Nic.Memory[Nic.DmaAddress];
+    } else {
+        Byte = 0xFF;
+    }
+
+    Nic.DmaAddress = Dp8390NextAddress(Nic.DmaAddress);
+
+    if (Nic.DmaCount != 0 && --Nic.DmaCount == 0) {
+        Nic.InterruptStatus |= ISR_DMA_DONE;
+    }
+
+    Dp8390Statistics.DataPortBytes++;
+
+    return Byte;
+}
+
+
+static
+VOID
+Dp8390DmaWrite(
+    UCHAR   Byte
+    )
+/*++
+
+Routine Description:
+
+    Moves one byte from the data port to buffer memory.
+
+--*/
+{
+    if (Nic.DmaAddress >= RAM_START && Nic.DmaAddress < RAM_STOP) {
+        Nic.Memory[Nic.DmaAddress] = Byte;
+    }
+
+    Nic.DmaAddress = Dp8390NextAddress(Nic.DmaAddress);
+
+    if (Nic.DmaCount != 0 && --Nic.DmaCount == 0) {
+        Nic.InterruptStatus |= ISR_DMA_DONE;
+    }
+
+    Dp8390Statistics.DataPortBytes++;
+}
+
+
+static
+VOID
+Dp8390Command(
+    UCHAR   Command
+    )
+{
+    Nic.Command = Command & ~CR_XMIT;
+
+    if (Command & CR_STOP) {
+
+        Nic.InterruptStatus |= ISR_RESET;
+
+    } else if (Command & CR_START) {
+
+        Nic.InterruptStatus &= ~ISR_RESET;
+    }
+
+    switch (Command & CR_DMA_MASK) {
+
+    case CR_DMA_READ:
+    case CR_DMA_WRITE:
+
+        Nic.DmaAddress = Nic.RemoteAddress;
+        Nic.DmaCount = Nic.RemoteCount;
+        Dp8390Statistics.RemoteDmas++;
+        break;
+
+    default:
+
+        Nic.DmaCount = 0;
+        break;
+    }
+
+    if ((Command & (CR_XMIT | CR_STOP)) == CR_XMIT) {
+
+        //
+        // The frame leaves at once. In loopback it does not reach the
+        // wire, which is all the driver can tell.
+        //
+        Nic.TransmitStatus = TSR_XMIT_OK;
+        Nic.InterruptStatus |= ISR_XMIT;
+
+        if ((Nic.TransmitConfig & TCR_LOOPBACK_MASK) == 0) {
+            Dp8390Statistics.FramesTransmitted++;
+        }
+    }
+}
+
+
+UCHAR
+Dp8390ReadPortUchar(
+    IN ULONG_PTR    Port
+    )
+{
+    UINT    Register = (UINT)(Port - Nic.IoBase) & 0x1F;
+    UCHAR   Value;
+
+    Dp8390Statistics.PortReads++;
+
+    if (Register >= RESET_PORT) {
+
+        Dp8390Reset();
+        return 0;
+    }
+
+    if (Register >= NIC_RACK_NIC) {
+
+        Value = Dp8390DmaRead();
+
+        //
+        // A byte access still moves a whole word in word mode
+        //
+        if (Nic.DataConfig & DCR_WORD_WIDE) {
+            Dp8390DmaRead();
+        }
+
+        return Value;
+    }
+
+    if (Register == NIC_COMMAND) {
+        return Nic.Command;
+    }
+
+    switch (Nic.Command & CR_PAGE_MASK) {
+
+    case CR_PAGE0:
+
+        switch (Register) {
+        case NIC_BOUNDARY:      return Nic.Boundary;
+        case NIC_XMIT_STATUS:   return Nic.TransmitStatus;
+        case NIC_INTR_STATUS:   return Nic.InterruptStatus;
+        case NIC_CRDA_LSB:      return LSB(Nic.DmaAddress);
+        case NIC_CRDA_MSB:      return MSB(Nic.DmaAddress);
+        case NIC_RCV_STATUS:    return Nic.ReceiveStatus;
+
+        case NIC_FAE_ERR_CNTR:
+        case NIC_CRC_ERR_CNTR:
+        case NIC_MISSED_CNTR:
+
+            //
+            // The tally counters clear when they are read
+            //
+            Value = Nic.Counters[Register - NIC_FAE_ERR_CNTR];
+            Nic.Counters[Register - NIC_FAE_ERR_CNTR] = 0;
+            return Value;
+        }
+        return 0xFF;
+
+    case CR_PAGE1:
+
+        if (Register < NIC_CURRENT) {
+            return Nic.PhysicalAddress[Register - NIC_PHYS_ADDR];
+        }
+        if (Register == NIC_CURRENT) {
+            return Nic.Current;
+        }
+        return Nic.Multicast[Register - NIC_MC_ADDR];
+
+    case CR_PAGE2:
+
+        switch (Register) {
+        case NIC_PAGE_START:    return Nic.PageStart;
+        case NIC_PAGE_STOP:     return Nic.PageStop;
+        case NIC_XMIT_START:    return Nic.TransmitPage;
+        case NIC_RCV_CONFIG:    return Nic.ReceiveConfig;
+        case NIC_XMIT_CONFIG:   return Nic.TransmitConfig;
+        case NIC_DATA_CONFIG:   return Nic.DataConfig;
+        case NIC_INTR_MASK:     return Nic.InterruptMask;
+        }
+        return 0xFF;
+    }
+
+    return 0xFF;
+}
+
+
+VOID
+Dp8390WritePortUchar(
+    IN ULONG_PTR    Port,
+    IN UCHAR        Data
+    )
+{
+    UINT    Register = (UINT)(Port - Nic.IoBase) & 0x1F;
+
+    Dp8390Statistics.PortWrites++;
+
+    if (Register >= RESET_PORT) {
+
+        Dp8390Reset();
+        return;
+    }
+
+    if (Register >= NIC_RACK_NIC) {
+
+        Dp8390DmaWrite(Data);
+
+        if (Nic.DataConfig & DCR_WORD_WIDE) {
+            Dp8390DmaWrite(0);
+        }
+        return;
+    }
+
+    if (Register == NIC_COMMAND) {
+        Dp8390Command(Data);
+        return;
+    }
+
+    switch (Nic.Command & CR_PAGE_MASK) {
+
+    case CR_PAGE0:
+
+        switch (Register) {
+        case NIC_PAGE_START:        Nic.PageStart = Data; break;
+        case NIC_PAGE_STOP:         Nic.PageStop = Data; break;
+        case NIC_BOUNDARY:          Nic.Boundary = Data; break;
+        case NIC_XMIT_START:        Nic.TransmitPage = Data; break;
+        case NIC_XMIT_COUNT_LSB:    Nic.TransmitCount = (Nic.TransmitCount & 0xFF00) | Data; break;
+        case NIC_XMIT_COUNT_MSB:    Nic.TransmitCount = (Nic.TransmitCount & 0x00FF) | (Data << 8); break;
+        case NIC_RMT_ADDR_LSB:      Nic.RemoteAddress = (Nic.RemoteAddress & 0xFF00) | Data; break;
+        case NIC_RMT_ADDR_MSB:      Nic.RemoteAddress = (Nic.RemoteAddress & 0x00FF) | (Data << 8); break;
+        case NIC_RMT_COUNT_LSB:     Nic.RemoteCount = (Nic.RemoteCount & 0xFF00) | Data; break;
+        case NIC_RMT_COUNT_MSB:     Nic.RemoteCount = (Nic.RemoteCount & 0x00FF) | (Data << 8); break;
+        case NIC_RCV_CONFIG:        Nic.ReceiveConfig = Data; break;
+        case NIC_XMIT_CONFIG:       Nic.TransmitConfig = Data; break;
+        case NIC_DATA_CONFIG:       Nic.DataConfig = Data; break;
+        case NIC_INTR_MASK:         Nic.InterruptMask = Data; break;
+
+        case NIC_INTR_STATUS:
+
+            //
+            // Writing ones acknowledges; RST only clears on a start
+            //
+            Nic.InterruptStatus &= ~(Data & ~ISR_RESET);
+            break;
+        }
+        break;
+
+    case CR_PAGE1:
+
+        if (Register < NIC_CURRENT) {
+            Nic.PhysicalAddress[Register - NIC_PHYS_ADDR] = Data;
+        } else if (Register == NIC_CURRENT) {
+            Nic.Current = Data;
+        } else {
+            Nic.Multicast[Register - NIC_MC_ADDR] = Data;
+        }
+        break;
+    }
+}
+
+
+USHORT
+Dp8390ReadPortUshort(
+    IN ULONG_PTR    Port
+    )
+{
+    UINT    Register = (UINT)(Port - Nic.IoBase) & 0x1F;
+    USHORT  Value;
+
+    if (Register < NIC_RACK_NIC || Register >= RESET_PORT
+        || !(Nic.DataConfig & DCR_WORD_WIDE)) {
+
+        //
+        // In byte mode the bus splits the access in two
+        //
+        Value = Dp8390ReadPortUchar(Port);
+        Value |= Dp8390ReadPortUchar(Port) << 8;
+
+        return Value;
+    }
+
+    //
+    // The card stores words low byte first
+    //
+    Dp8390Statistics.PortReads++;
+
+    Value = Dp8390DmaRead();
+    Value |= Dp8390DmaRead() << 8;
+
+    return Value;
+}
+
+
+VOID
+Dp8390WritePortUshort(
+    IN ULONG_PTR    Port,
+    IN USHORT       Data
+    )
+{
+    UINT    Register = (UINT)(Port - Nic.IoBase) & 0x1F;
+
+    if (Register < NIC_RACK_NIC || Register >= RESET_PORT
+        || !(Nic.DataConfig & DCR_WORD_WIDE)) {
+
+        Dp8390WritePortUchar(Port, LSB(Data));
+        Dp8390WritePortUchar(Port, MSB(Data));
+
+        return;
+    }
+
+    Dp8390Statistics.PortWrites++;
+
+    Dp8390DmaWrite(LSB(Data));
+    Dp8390DmaWrite(MSB(Data));
+}
+
+
+VOID
+Dp8390ReadPortBufferUchar(
+    IN ULONG_PTR    Port,
+    OUT PUCHAR      Buffer,
+    IN ULONG        Length
+    )
+{
+    while (Length-- != 0) {
+        *Buffer++ = Dp8390ReadPortUchar(Port);
+    }
+}
+
+
+VOID
+Dp8390ReadPortBufferUshort(
+    IN ULONG_PTR    Port,
+    OUT PUSHORT     Buffer,
+    IN ULONG        Length
+    )
+{
+    PUCHAR  Bytes = (PUCHAR)Buffer;
+
+    //
+    // The caller's buffer need not be aligned
+    //
+    while (Length-- != 0) {
+
+        USHORT  Value = Dp8390ReadPortUshort(Port);
+
+        *Bytes++ = LSB(Value);
+        *Bytes++ = MSB(Value);
+    }
+}
+
+
+VOID
+Dp8390WritePortBufferUchar(
+    IN ULONG_PTR    Port,
+    IN PUCHAR       Buffer,
+    IN ULONG        Length
+    )
+{
+    while (Length-- != 0) {
+        Dp8390WritePortUchar(Port, *Buffer++);
+    }
+}
+
+
+VOID
+Dp8390WritePortBufferUshort(
+    IN ULONG_PTR    Port,
+    IN PUSHORT      Buffer,
+    IN ULONG        Length
+    )
+{
+    PUCHAR  Bytes = (PUCHAR)Buffer;
+
+    while (Length-- != 0) {
+        Dp8390WritePortUshort(Port, (USHORT)(Bytes[0] | (Bytes[1] << 8)));
+        Bytes += 2;
+    }
+}
+
+
+ULONG
+Dp8390Crc(
+    IN PUCHAR   Buffer,
+    IN UINT     Length
+    )
+/*++
+
+Routine Description:
+
+    The ethernet CRC, most significant bit first as the NIC hashes
+    multicast addresses with it. The harness checks CardComputeCrc
+    against it.
+
+--*/
+{
+    ULONG   Crc = 0xFFFFFFFF;
+    UINT    i, Bit;
+
+    for (i = 0; i < Length; i++) {
+
+        UCHAR   Byte = Buffer[i];
+
+        for (Bit = 0; Bit < 8; Bit++, Byte >>= 1) {
+
+            if (((Crc >> 31) ^ Byte) & 1) {
+                Crc = (Crc << 1) ^ 0x04C11DB7;
+            } else {
+                Crc <<= 1;
+            }
+        }
+    }
+
+    return Crc;
+}
+
+
+static
+BOOLEAN
+Dp8390Accept(
+    PUCHAR  Frame,
+    PUCHAR  Status
+    )
+/*++
+
+Routine Description:
+
+    Applies the address filter of RCR, PAR and MAR to a frame.
+
+--*/
+{
+    static UCHAR    Broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    ULONG           Hash;
+
+    *Status = RSR_PACKET_OK;
+
+    if (!(Frame[0] & 1)) {
+
+        return (Nic.ReceiveConfig & RCR_ALL_PHYS)
+               || memcmp(Frame, Nic.PhysicalAddress, 6) == 0;
+    }
+
+    *Status |= RSR_MULTICAST;
+
+    if (memcmp(Frame, Broadcast, 6) == 0) {
+        return (Nic.ReceiveConfig & (RCR_BROADCAST | RCR_ALL_PHYS)) != 0;
+    }
+
+    if (Nic.ReceiveConfig & RCR_ALL_PHYS) {
+        return TRUE;
+    }
+
+    Hash = Dp8390Crc(Frame, 6) >> 26;
+
+    return (Nic.ReceiveConfig & RCR_MULTICAST)
+           && (Nic.Multicast[Hash >> 3] & (1 << (Hash & 7)));
+}
+
+
+BOOLEAN
+Dp8390Receive(
+    IN PUCHAR   Frame,
+    IN UINT     Length
+    )
+/*++
+
+Routine Description:
+
+    A frame arrives from the wire. If the receiver is running and the
+    frame passes the address filter, it is stored at CURR behind the
+    4 byte header (status, next page, byte count including the CRC),
+    CURR moves on and ISR_RCV is raised. The CRC itself is not
+    modelled: the four bytes after the frame are left as they are.
+
+Arguments:
+
+    Frame - the frame, without CRC.
+
+    Length - its length, at least 60 bytes.
+
+Return Value:
+
+    FALSE if the frame was missed because the ring is full or the
+    receiver is stopped, TRUE otherwise.
+
+--*/
+{
+    UCHAR   Status;
+    UINT    Count, Pages, Free, i;
+    USHORT  Address;
+    UCHAR   Next;
+
+    if ((Nic.Command & CR_STOP)
+        || (Nic.TransmitConfig & TCR_LOOPBACK_MASK)
+        || (Nic.ReceiveConfig & RCR_MONITOR)) {
+
+        Dp8390Statistics.FramesMissed++;
+        return FALSE;
+    }
+
+    if (!Dp8390Accept(Frame, &Status)) {
+
+        Dp8390Statistics.FramesRejected++;
+        return TRUE;
+    }
+
+    Count = Length + 4;
+    Pages = (Count + 4 + 255) >> 8;
+
+    //
+    // The NIC stops before CURR would run into BNRY
+    //
+    if (Nic.Boundary > Nic.Current) {
+        Free = Nic.Boundary - Nic.Current;
+    } else {
+        Free = (Nic.PageStop - Nic.PageStart) - (Nic.Current - Nic.Boundary);
+    }
+
+    if (Pages >= Free) {
+
+        Nic.InterruptStatus |= ISR_OVERFLOW;
+
+        if (Nic.Counters[2] != 0xFF) {
+            Nic.Counters[2]++;
+        }
+
+        Dp8390Statistics.FramesMissed++;
+        return FALSE;
+    }
+
+    Next = Nic.Current + (UCHAR)Pages;
+    if (Next >= Nic.PageStop) {
+        Next -= Nic.PageStop - Nic.PageStart;
+    }
+
+    Address = (USHORT)(Nic.Current << 8);
+
+    Nic.Memory[Address] = Status;
+    Nic.Memory[Address + 1] = Next;
+    Nic.Memory[Address + 2] = LSB(Count);
+    Nic.Memory[Address + 3] = MSB(Count);
+
+    Address += 4;
+
+    for (i = 0; i < Length; i++) {
+        Nic.Memory[Address] = Frame[i];
+        Address = Dp8390NextAddress(Address);
+    }
+
+    Nic.Current = Next;
+    Nic.ReceiveStatus = Status;
+    Nic.InterruptStatus |= ISR_RCV;
+
+    Dp8390Statistics.FramesReceived++;
+
+    return TRUE;
+}
+
+
+BOOLEAN
+Dp8390InterruptPending(
+    VOID
+    )
+/*++
+
+Routine Description:
+
+    Whether the INT line is asserted.
+
+--*/
+{
+    return (Nic.InterruptStatus & Nic.InterruptMask & 0x7F) != 0;
+}
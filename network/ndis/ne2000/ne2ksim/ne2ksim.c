@@ -0,0 +1,639 @@
+/*++
+
+Copyright (c) 1990-2000  Microsoft Corporation
+
+Module Name:
+
+    ne2ksim.c
+
+Abstract:
+
+    User mode harness for the receive path of the Novell 2000 driver.
+    Builds card.c and interrup.c unchanged on top of the DP8390 model
+    in dp8390.c, brings the adapter up the way Ne2000RegisterAdapter
+    does, and then feeds frames into the receive ring and services
+    the interrupts with Ne2000Isr and Ne2000HandleInterrupt.
+
+    The indications go to a protocol that copies every frame whole,
+    calling Ne2000TransferData for whatever was not in the lookahead
+    buffer, and checks it against what was put on the wire.
+
+    Each run is made twice: with Adapter->RcvCopyLimit at 0, which
+    indicates MaxLookAhead bytes and leaves the rest to
+    Ne2000TransferData, and at NE2000_MAX_FRAME_SIZE, which copies
+    frames up whole. For each it reports frames per second and CPU
+    cycles per byte of the driver alone, and the I/O cycles and remote
+    DMAs per frame that bound it on a real card.
+
+    Before the receive runs, CardComputeCrc is checked against the CRC
+    of the model, and the multicast list is put through random changes
+    the way Ne2000SetInformation makes them, comparing the multicast
+    registers of the card after each one with the ones the list hashes
+    to. ne2ksim exits with 1 if either check or any frame went wrong,
+    so it can be scripted.
+
+Author:
+
+
+Environment:
+
+    User mode.
+
+Revision History:
+
+--*/
+
+#include <intrin.h>
+
+#define NE2000_HARNESS 1
+#include "..\card.c"
+#include "..\interrup.c"
+
+
+#define HARNESS_IO_BASE         0x300
+
+#define DEFAULT_FRAMES          100000
+#define DEFAULT_BURST           4
+#define MAX_BURST               64
+
+#define MULTICAST_CHANGES       10000
+
+
+//
+// The simple IMIX: 7 small, 4 medium and 1 large frame
+//
+UINT FrameMix[] = { 60, 60, 60, 60, 60, 60, 60, 590, 590, 590, 590, 1514 };
+
+#define FRAME_MIX_LENGTH        (sizeof(FrameMix) / sizeof(FrameMix[0]))
+
+
+typedef struct _RUN {
+    ULONG           CopyLimit;
+    ULONG           Frames;             // frames indicated
+    ULONG           Transfers;          // Ne2000TransferData calls
+    ULONG           Wrong;              // frames indicated wrongly
+    double          Bytes;
+    ULONGLONG       Cycles;
+    LONGLONG        Ticks;
+    DP8390_STATISTICS Nic;
+    } RUN, *PRUN;
+
+
+NE2000_ADAPTER      Ne2000Adapter;
+
+UCHAR               WireFrames[FRAME_MIX_LENGTH][NE2000_MAX_FRAME_SIZE];
+
+UINT                Expected[MAX_BURST];
+ULONG               ExpectedHead, ExpectedTail;
+
+UCHAR               ProtocolFrame[NE2000_MAX_FRAME_SIZE];
+BOOLEAN             Verify;
+PRUN                CurrentRun;
+
+ULONG               ErrorLogEntries;
+
+
+VOID
+NdisWriteErrorLogEntry(
+    IN NDIS_HANDLE          MiniportAdapterHandle,
+    IN NDIS_ERROR_CODE      ErrorCode,
+    IN ULONG                NumberOfErrorValues,
+    ...
+    )
+{
+    ErrorLogEntries++;
+}
+
+
+VOID
+NdisMEthIndicateReceive(
+    IN NDIS_HANDLE          MiniportAdapterHandle,
+    IN NDIS_HANDLE          MiniportReceiveContext,
+    IN PVOID                HeaderBuffer,
+    IN UINT                 HeaderBufferSize,
+    IN PVOID                LookaheadBuffer,
+    IN UINT                 LookaheadBufferSize,
+    IN UINT                 PacketSize
+    )
+/*++
+
+Routine Description:
+
+    The protocol: copies the header and the lookahead data, and
+    transfers the rest of the frame if there is any.
+
+--*/
+{
+    NDIS_PACKET     Packet;
+    NDIS_BUFFER     Buffer;
+    UINT            Length;
+    UINT            Transferred;
+    UINT            Slot;
+
+    memcpy(ProtocolFrame, HeaderBuffer, HeaderBufferSize);
+    memcpy(ProtocolFrame + HeaderBufferSize, LookaheadBuffer, LookaheadBufferSize);
+
+    Length = HeaderBufferSize + LookaheadBufferSize;
+
+    if (LookaheadBufferSize < PacketSize) {
+
+        Buffer.Next = NULL;
+        Buffer.VirtualAddress = ProtocolFrame + Length;
+        Buffer.Length = PacketSize - LookaheadBufferSize;
+
+        Packet.Head = &Buffer;
+        Packet.TotalLength = Buffer.Length;
+
+        if (Ne2000TransferData(
+                &Packet,
+                &Transferred,
+                MiniportReceiveContext,
+                MiniportReceiveContext,
+                LookaheadBufferSize,
+                PacketSize - LookaheadBufferSize
+                ) == NDIS_STATUS_SUCCESS) {
+
+            Length += Transferred;
+        }
+
+        CurrentRun->Transfers++;
+    }
+
+    CurrentRun->Frames++;
+    CurrentRun->Bytes += Length;
+
+    if (Verify) {
+
+        if (ExpectedTail == ExpectedHead) {
+
+            CurrentRun->Wrong++;
+
+        } else {
+
+            Slot = Expected[ExpectedTail++ % MAX_BURST];
+
+            if (Length != FrameMix[Slot]
+                || memcmp(ProtocolFrame, WireFrames[Slot], Length) != 0) {
+
+                CurrentRun->Wrong++;
+            }
+        }
+    }
+}
+
+
+VOID
+NdisMEthIndicateReceiveComplete(
+    IN NDIS_HANDLE          MiniportAdapterHandle
+    )
+{
+}
+
+
+VOID
+NdisMSendComplete(
+    IN NDIS_HANDLE          MiniportAdapterHandle,
+    IN PNDIS_PACKET         Packet,
+    IN NDIS_STATUS          Status
+    )
+{
+}
+
+
+ULONG
+NdisReadPcmciaAttributeMemory(
+    IN NDIS_HANDLE          NdisAdapterHandle,
+    IN ULONG                Offset,
+    IN PVOID                Buffer,
+    IN ULONG                Length
+    )
+{
+    return 0;
+}
+
+
+BOOLEAN
+InitializeAdapter(
+    PNE2000_ADAPTER     Adapter,
+    BOOLEAN             EightBitSlot
+    )
+/*++
+
+Routine Description:
+
+    Powers up the model and brings the adapter up with the steps of
+    Ne2000RegisterAdapter, filtering directed and broadcast frames.
+
+Arguments:
+
+    Adapter - the adapter block.
+
+    EightBitSlot - whether the card should find itself in an 8 bit
+        slot.
+
+Return Value:
+
+    TRUE if the card came up.
+
+--*/
+{
+    static UCHAR    PermanentAddress[NE2000_LENGTH_OF_ADDRESS] =
+                        { 0x00, 0x00, 0x1B, 0x12, 0x34, 0x56 };
+    UINT            i;
+
+    memset(Adapter, 0, sizeof(*Adapter));
+
+    Dp8390Initialize(HARNESS_IO_BASE, PermanentAddress, EightBitSlot);
+
+    Adapter->IoBaseAddr = DEFAULT_IOBASEADDR;
+    Adapter->IoPAddr = HARNESS_IO_BASE;
+    Adapter->CardType = NE2000_ISA;
+    Adapter->BusType = NdisInterfaceIsa;
+    Adapter->NumBuffers = DEFAULT_NUMBUFFERS;
+    Adapter->MulticastListMax = DEFAULT_MULTICASTLISTMAX;
+    Adapter->MaxLookAhead = NE2000_MAX_LOOKAHEAD;
+    Adapter->RcvCopyLimit = NE2000_MAX_FRAME_SIZE;
+
+    if (!CardCheckParameters(Adapter) || !CardInitialize(Adapter)) {
+        return FALSE;
+    }
+
+    Adapter->XmitStart = Adapter->RamBase;
+    Adapter->NicXmitStart = (UCHAR)((PtrToUlong(Adapter->XmitStart)) >> 8);
+
+    Adapter->PageStart = Adapter->XmitStart +
+            (Adapter->NumBuffers * TX_BUF_SIZE);
+    Adapter->NicPageStart = Adapter->NicXmitStart +
+            (UCHAR)(Adapter->NumBuffers * BUFS_PER_TX);
+
+    Adapter->PageStop = Adapter->XmitStart + Adapter->RamSize;
+    Adapter->NicPageStop = Adapter->NicXmitStart + (UCHAR)(Adapter->RamSize >> 8);
+
+    Adapter->NicReceiveConfig = RCR_REJECT_ERR | RCR_BROADCAST;
+
+    Adapter->CurBufXmitting = (XMIT_BUF)-1;
+
+    for (i = 0; i < Adapter->NumBuffers; i++) {
+        Adapter->BufferStatus[i] = EMPTY;
+    }
+
+    if (!CardReadEthernetAddress(Adapter)) {
+        return FALSE;
+    }
+
+    Adapter->NicInterruptMask = IMR_RCV | IMR_XMIT | IMR_XMIT_ERR | IMR_OVERFLOW;
+
+    if (!CardSetup(Adapter)) {
+        return FALSE;
+    }
+
+    CardStart(Adapter);
+
+    return TRUE;
+}
+
+
+VOID
+BuildFrames(
+    PUCHAR      StationAddress
+    )
+/*++
+
+Routine Description:
+
+    Fills in one frame per entry of FrameMix, addressed to the
+    station, each with a different payload so a frame indicated in
+    place of another is noticed.
+
+--*/
+{
+    UINT    Slot, i;
+    PUCHAR  Frame;
+
+    for (Slot = 0; Slot < FRAME_MIX_LENGTH; Slot++) {
+
+        Frame = WireFrames[Slot];
+
+        memcpy(Frame, StationAddress, NE2000_LENGTH_OF_ADDRESS);
+        memcpy(Frame + 6, "\x02\x00\x00\x00\x00\x01", 6);
+        Frame[12] = 0x08;
+        Frame[13] = 0x00;
+
+        for (i = NE2000_HEADER_SIZE; i < FrameMix[Slot]; i++) {
+            Frame[i] = (UCHAR)(Slot * 31 + i);
+        }
+    }
+}
+
+
+BOOLEAN
+RunFrames(
+    PRUN        Run,
+    ULONG       Frames,
+    ULONG       Burst,
+    BOOLEAN     EightBitSlot
+    )
+/*++
+
+Routine Description:
+
+    Puts Frames frames on the wire, Burst of them per interrupt, and
+    has the driver receive them. Only the interrupt handling is timed.
+
+Arguments:
+
+    Run - the copy limit to use; receives the results.
+
+    Frames - number of frames.
+
+    Burst - frames received between interrupts.
+
+    EightBitSlot - whether to run the card in byte mode.
+
+Return Value:
+
+    FALSE if the adapter did not come up.
+
+--*/
+{
+    PNE2000_ADAPTER     Adapter = &Ne2000Adapter;
+    LARGE_INTEGER       Start, Stop;
+    ULONGLONG           StartCycles;
+    BOOLEAN             InterruptRecognized, QueueDpc;
+    ULONG               Sent, i;
+    UINT                Slot;
+
+    if (!InitializeAdapter(Adapter, EightBitSlot)) {
+        return FALSE;
+    }
+
+    Adapter->RcvCopyLimit = Run->CopyLimit;
+
+    BuildFrames(Adapter->StationAddress);
+
+    memset(&Dp8390Statistics, 0, sizeof(Dp8390Statistics));
+    ExpectedHead = ExpectedTail = 0;
+    CurrentRun = Run;
+
+    for (Sent = 0; Sent < Frames; ) {
+
+        for (i = 0; i < Burst && Sent < Frames; i++, Sent++) {
+
+            Slot = Sent % FRAME_MIX_LENGTH;
+
+            if (Dp8390Receive(WireFrames[Slot], FrameMix[Slot])) {
+                Expected[ExpectedHead++ % MAX_BURST] = Slot;
+            }
+        }
+
+        QueryPerformanceCounter(&Start);
+        StartCycles = __rdtsc();
+
+        while (Dp8390InterruptPending()) {
+
+            Ne2000Isr(&InterruptRecognized, &QueueDpc, Adapter);
+            Ne2000HandleInterrupt(Adapter);
+            Ne2000EnableInterrupt(Adapter);
+        }
+
+        Run->Cycles += __rdtsc() - StartCycles;
+        QueryPerformanceCounter(&Stop);
+        Run->Ticks += Stop.QuadPart - Start.QuadPart;
+    }
+
+    if (Verify && ExpectedTail != ExpectedHead) {
+        Run->Wrong += ExpectedHead - ExpectedTail;
+    }
+
+    Run->Nic = Dp8390Statistics;
+
+    return TRUE;
+}
+
+
+ULONG
+TestMulticast(
+    ULONG       Changes
+    )
+/*++
+
+Routine Description:
+
+    Checks CardComputeCrc against the CRC of the model on random
+    buffers of every length up to 64 bytes, then makes Changes random
+    changes to the multicast list with CardUpdateMulticastList and
+    CardCopyChangedMulticastRegs and reads the multicast registers
+    back from the card after each one. The new lists mostly reuse
+    addresses of the old one and draw the rest from a small range, so
+    addresses come and go and share bits.
+
+Arguments:
+
+    Changes - number of list changes.
+
+Return Value:
+
+    The number of wrong CRCs and wrong register contents.
+
+--*/
+{
+    PNE2000_ADAPTER Adapter = &Ne2000Adapter;
+    UCHAR           Buffer[64];
+    UCHAR           List[DEFAULT_MULTICASTLISTMAX][NE2000_LENGTH_OF_ADDRESS];
+    UCHAR           NewList[DEFAULT_MULTICASTLISTMAX][NE2000_LENGTH_OF_ADDRESS];
+    UCHAR           Regs[8], Reg;
+    ULONG           Wrong = 0, Writes = 0, Change;
+    UINT            Count = 0, NewCount, Length, Hash, i, j;
+
+    for (Length = 0; Length <= sizeof(Buffer); Length++) {
+
+        for (i = 0; i < Length; i++) {
+            Buffer[i] = (UCHAR)rand();
+        }
+
+        if (CardComputeCrc(Buffer, Length) != Dp8390Crc(Buffer, Length)) {
+            Wrong++;
+        }
+    }
+
+    if (!InitializeAdapter(Adapter, FALSE)) {
+        return Wrong + 1;
+    }
+
+    for (Change = 0; Change < Changes; Change++) {
+
+        NewCount = rand() % (DEFAULT_MULTICASTLISTMAX + 1);
+
+        for (j = 0; j < NewCount; j++) {
+
+            if (Count != 0 && (rand() % 4) != 0) {
+                memcpy(NewList[j], List[rand() % Count], NE2000_LENGTH_OF_ADDRESS);
+            } else {
+                memcpy(NewList[j], "\x01\x00\x5E\x00\x00", 5);
+                NewList[j][5] = (UCHAR)(rand() % 32);
+            }
+        }
+
+        memset(&Dp8390Statistics, 0, sizeof(Dp8390Statistics));
+
+        CardUpdateMulticastList(Adapter, (PUCHAR)NewList, NewCount);
+        CardCopyChangedMulticastRegs(Adapter);
+
+        Writes += Dp8390Statistics.PortWrites;
+
+        memcpy(List, NewList, sizeof(List));
+        Count = NewCount;
+
+        memset(Regs, 0, sizeof(Regs));
+
+        for (j = 0; j < Count; j++) {
+            Hash = Dp8390Crc(List[j], NE2000_LENGTH_OF_ADDRESS) >> 26;
+            Regs[Hash >> 3] |= (UCHAR)(1 << (Hash & 7));
+        }
+
+        NdisRawWritePortUchar(Adapter->IoPAddr + NIC_COMMAND,
+                        CR_START | CR_NO_DMA | CR_PAGE1);
+
+        for (i = 0; i < 8; i++) {
+
+            NdisRawReadPortUchar(Adapter->IoPAddr + (NIC_MC_ADDR + i), &Reg);
+
+            if (Reg != Regs[i]) {
+                Wrong++;
+                break;
+            }
+        }
+
+        NdisRawWritePortUchar(Adapter->IoPAddr + NIC_COMMAND,
+                        CR_START | CR_NO_DMA | CR_PAGE0);
+    }
+
+    printf("%lu multicast list changes: %4.2f register writes/change "
+           "(10 to rewrite all), %lu wrong\n",
+            Changes, (double)Writes / Changes, Wrong);
+
+    return Wrong;
+}
+
+
+int
+__cdecl
+main(
+    int     argc,
+    char   *argv[]
+    )
+{
+    ULONG           frames = DEFAULT_FRAMES;
+    ULONG           burst = DEFAULT_BURST;
+    ULONG           length = 0;
+    ULONG           copyLimit = (ULONG)-1;
+    BOOLEAN         eightBitSlot = FALSE;
+    RUN             runs[2];
+    RUN             check;
+    ULONG           runCount, wrong = 0;
+    LARGE_INTEGER   frequency;
+    double          seconds;
+    ULONG           i;
+    int             arg;
+
+    for (arg = 1; arg < argc; arg++) {
+
+        if (argv[arg][0] == '-') {
+
+            switch (argv[arg][1]) {
+            case 'n': frames = strtoul(argv[arg] + 2, NULL, 0); continue;
+            case 'q': burst = strtoul(argv[arg] + 2, NULL, 0); continue;
+            case 'l': length = strtoul(argv[arg] + 2, NULL, 0); continue;
+            case 'c': copyLimit = strtoul(argv[arg] + 2, NULL, 0); continue;
+            case '8': eightBitSlot = TRUE; continue;
+            }
+        }
+
+        frames = 0;
+        break;
+    }
+
+    if (frames == 0 || burst == 0 || burst > MAX_BURST
+        || (length != 0 && (length < 60 || length > NE2000_MAX_FRAME_SIZE))
+        || (copyLimit != (ULONG)-1 && copyLimit > NE2000_MAX_FRAME_SIZE)) {
+
+        printf("usage: ne2ksim [-n<frames>] [-q<frames per interrupt>] "
+               "[-l<frame length>] [-c<copy limit>] [-8]\n");
+        return 2;
+    }
+
+    if (length != 0) {
+        for (i = 0; i < FRAME_MIX_LENGTH; i++) {
+            FrameMix[i] = length;
+        }
+    }
+
+    memset(runs, 0, sizeof(runs));
+
+    if (copyLimit == (ULONG)-1) {
+        runs[0].CopyLimit = 0;
+        runs[1].CopyLimit = NE2000_MAX_FRAME_SIZE;
+        runCount = 2;
+    } else {
+        runs[0].CopyLimit = copyLimit;
+        runCount = 1;
+    }
+
+    CardInitializeCrcTable();
+
+    wrong += TestMulticast(MULTICAST_CHANGES);
+
+    QueryPerformanceFrequency(&frequency);
+
+    if (length != 0) {
+        printf("%lu frames of %lu bytes", frames, length);
+    } else {
+        printf("%lu frames of the simple IMIX", frames);
+    }
+
+    printf(", %lu per interrupt, %s slot\n",
+                burst, eightBitSlot ? "8 bit" : "16 bit");
+
+    for (i = 0; i < runCount; i++) {
+
+        //
+        // A checked pass first, then the timed one
+        //
+        memset(&check, 0, sizeof(check));
+        check.CopyLimit = runs[i].CopyLimit;
+
+        Verify = TRUE;
+
+        if (!RunFrames(&check, frames, burst, eightBitSlot)) {
+            printf("ne2ksim: the adapter did not come up\n");
+            return 2;
+        }
+
+        Verify = FALSE;
+
+        RunFrames(&runs[i], frames, burst, eightBitSlot);
+
+        wrong += check.Wrong;
+
+        seconds = (double)runs[i].Ticks / frequency.QuadPart;
+
+        printf("copy limit %4lu: %9.0f frames/s %6.2f cycles/byte "
+               "%6.1f I/O cycles/frame %4.2f remote DMAs/frame "
+               "%lu transfers, %lu missed, %lu wrong\n",
+                runs[i].CopyLimit,
+                runs[i].Frames / seconds,
+                (double)runs[i].Cycles / runs[i].Bytes,
+                (double)(runs[i].Nic.PortReads + runs[i].Nic.PortWrites)
+                    / runs[i].Frames,
+                (double)runs[i].Nic.RemoteDmas / runs[i].Frames,
+                runs[i].Transfers,
+                runs[i].Nic.FramesMissed,
+                check.Wrong);
+    }
+
+    if (ErrorLogEntries != 0) {
+        printf("%lu error log entries\n", ErrorLogEntries);
+    }
+
+    return (wrong != 0 || ErrorLogEntries != 0) ? 1 : 0;
+}
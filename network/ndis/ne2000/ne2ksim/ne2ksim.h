@@ -0,0 +1,295 @@
+/*++
+
+Copyright (c) 1990-2000  Microsoft Corporation
+
+Module Name:
+
+    ne2ksim.h
+
+Abstract:
+
+    The NDIS definitions card.c and interrup.c need, for building them
+    into the user mode harness, and the interface of the DP8390 model
+    (dp8390.c) the raw port macros are routed to.
+
+Author:
+
+
+Environment:
+
+    User mode.
+
+Revision History:
+
+--*/
+
+#ifndef _NE2KSIM_
+#define _NE2KSIM_
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef DBG
+#define DBG 0
+#endif
+
+#ifndef IN
+#define IN
+#endif
+
+#ifndef OUT
+#define OUT
+#endif
+
+#define ASSERT(exp)
+#define DbgPrint                            printf
+#define NDIS_PAGEABLE_FUNCTION(_f)
+#define NDIS_INIT_FUNCTION(_f)
+
+
+//
+// Status codes, handles and the other types the driver uses
+//
+
+typedef int NDIS_STATUS, *PNDIS_STATUS;
+typedef PVOID NDIS_HANDLE, *PNDIS_HANDLE;
+typedef ULONG NDIS_OID, *PNDIS_OID;
+typedef ULONG NDIS_ERROR_CODE;
+
+#define NDIS_STATUS_SUCCESS                 ((NDIS_STATUS)0x00000000L)
+#define NDIS_STATUS_PENDING                 ((NDIS_STATUS)0x00000103L)
+#define NDIS_STATUS_FAILURE                 ((NDIS_STATUS)0xC0000001L)
+
+#define NDIS_ERROR_CODE_HARDWARE_FAILURE    0xC000138AL
+#define NDIS_ERROR_CODE_DRIVER_FAILURE      0xC000138CL
+
+#define NDIS_PACKET_TYPE_ALL_MULTICAST      0x00000004
+
+#define ETH_LENGTH_OF_ADDRESS               6
+
+typedef enum _NDIS_MEDIUM {
+    NdisMedium802_3
+    } NDIS_MEDIUM, *PNDIS_MEDIUM;
+
+typedef enum _NDIS_INTERFACE_TYPE {
+    NdisInterfaceInternal,
+    NdisInterfaceIsa,
+    NdisInterfaceEisa,
+    NdisInterfaceMca
+    } NDIS_INTERFACE_TYPE;
+
+typedef struct _NDIS_MINIPORT_INTERRUPT {
+    PVOID               Reserved;
+    } NDIS_MINIPORT_INTERRUPT, *PNDIS_MINIPORT_INTERRUPT;
+
+typedef BOOLEAN (*PNDIS_SYNCHRONIZE_ROUTINE)(PVOID SynchronizeContext);
+
+//
+// Interrupts are not concurrent with anything in the harness
+//
+#define NdisMSynchronizeWithInterrupt(_Interrupt, _Routine, _Context) \
+    (_Routine)(_Context)
+
+#define NdisStallExecution(_MicroSeconds)
+#define NdisMoveMemory(_Destination, _Source, _Length) \
+    memcpy(_Destination, _Source, _Length)
+#define NdisEqualMemory(_Source1, _Source2, _Length) \
+    (memcmp(_Source1, _Source2, _Length) == 0)
+
+
+//
+// Packets are chains of flat buffers
+//
+
+typedef struct _NDIS_BUFFER {
+    struct _NDIS_BUFFER    *Next;
+    PVOID                   VirtualAddress;
+    UINT                    Length;
+    } NDIS_BUFFER, *PNDIS_BUFFER;
+
+typedef struct _NDIS_PACKET {
+    PNDIS_BUFFER            Head;
+    UINT                    TotalLength;
+    UCHAR                   MiniportReserved[2 * sizeof(PVOID)];
+    } NDIS_PACKET, *PNDIS_PACKET;
+
+#define NdisQueryPacket(_Packet, _PhysicalBufferCount, _BufferCount, _FirstBuffer, _TotalPacketLength) \
+{                                                                       \
+    PNDIS_BUFFER *_First = (_FirstBuffer);                              \
+    PUINT _Total = (_TotalPacketLength);                                \
+    if (_First != NULL) *_First = (_Packet)->Head;                      \
+    if (_Total != NULL) *_Total = (_Packet)->TotalLength;               \
+}
+
+#define NdisQueryBuffer(_Buffer, _VirtualAddress, _Length)              \
+{                                                                       \
+    *(_VirtualAddress) = (_Buffer)->VirtualAddress;                     \
+    *(_Length) = (_Buffer)->Length;                                     \
+}
+
+#define NdisGetNextBuffer(_CurrentBuffer, _NextBuffer)                  \
+    *(_NextBuffer) = (_CurrentBuffer)->Next
+
+
+//
+// Provided by the harness
+//
+
+VOID
+NdisWriteErrorLogEntry(
+    IN NDIS_HANDLE          MiniportAdapterHandle,
+    IN NDIS_ERROR_CODE      ErrorCode,
+    IN ULONG                NumberOfErrorValues,
+    ...
+    );
+
+VOID
+NdisMEthIndicateReceive(
+    IN NDIS_HANDLE          MiniportAdapterHandle,
+    IN NDIS_HANDLE          MiniportReceiveContext,
+    IN PVOID                HeaderBuffer,
+    IN UINT                 HeaderBufferSize,
+    IN PVOID                LookaheadBuffer,
+    IN UINT                 LookaheadBufferSize,
+    IN UINT                 PacketSize
+    );
+
+VOID
+NdisMEthIndicateReceiveComplete(
+    IN NDIS_HANDLE          MiniportAdapterHandle
+    );
+
+VOID
+NdisMSendComplete(
+    IN NDIS_HANDLE          MiniportAdapterHandle,
+    IN PNDIS_PACKET         Packet,
+    IN NDIS_STATUS          Status
+    );
+
+ULONG
+NdisReadPcmciaAttributeMemory(
+    IN NDIS_HANDLE          NdisAdapterHandle,
+    IN ULONG                Offset,
+    IN PVOID                Buffer,
+    IN ULONG                Length
+    );
+
+
+//
+// The DP8390 model
+//
+
+typedef struct _DP8390_STATISTICS {
+    ULONG       PortReads;              // I/O cycles, data port included
+    ULONG       PortWrites;
+    ULONG       DataPortBytes;          // bytes moved by remote DMA
+    ULONG       RemoteDmas;             // remote DMA commands issued
+    ULONG       FramesReceived;         // frames stored in the ring
+    ULONG       FramesRejected;         // not for this station
+    ULONG       FramesMissed;           // ring full or receiver stopped
+    ULONG       FramesTransmitted;
+    } DP8390_STATISTICS, *PDP8390_STATISTICS;
+
+extern DP8390_STATISTICS Dp8390Statistics;
+
+VOID
+Dp8390Initialize(
+    IN ULONG_PTR            IoBase,
+    IN PUCHAR               PermanentAddress,
+    IN BOOLEAN              EightBitSlot
+    );
+
+BOOLEAN
+Dp8390Receive(
+    IN PUCHAR               Frame,
+    IN UINT                 Length
+    );
+
+BOOLEAN
+Dp8390InterruptPending(
+    VOID
+    );
+
+ULONG
+Dp8390Crc(
+    IN PUCHAR               Buffer,
+    IN UINT                 Length
+    );
+
+UCHAR
+Dp8390ReadPortUchar(
+    IN ULONG_PTR            Port
+    );
+
+USHORT
+Dp8390ReadPortUshort(
+    IN ULONG_PTR            Port
+    );
+
+VOID
+Dp8390WritePortUchar(
+    IN ULONG_PTR            Port,
+    IN UCHAR                Data
+    );
+
+VOID
+Dp8390WritePortUshort(
+    IN ULONG_PTR            Port,
+    IN USHORT               Data
+    );
+
+VOID
+Dp8390ReadPortBufferUchar(
+    IN ULONG_PTR            Port,
+    OUT PUCHAR              Buffer,
+    IN ULONG                Length
+    );
+
+VOID
+Dp8390ReadPortBufferUshort(
+    IN ULONG_PTR            Port,
+    OUT PUSHORT             Buffer,
+    IN ULONG                Length
+    );
+
+VOID
+Dp8390WritePortBufferUchar(
+    IN ULONG_PTR            Port,
+    IN PUCHAR               Buffer,
+    IN ULONG                Length
+    );
+
+VOID
+Dp8390WritePortBufferUshort(
+    IN ULONG_PTR            Port,
+    IN PUSHORT              Buffer,
+    IN ULONG                Length
+    );
+
+#define NdisRawReadPortUchar(_Port, _Data) \
+    (*(_Data) = Dp8390ReadPortUchar((ULONG_PTR)(_Port)))
+
+#define NdisRawReadPortUshort(_Port, _Data) \
+    (*(_Data) = Dp8390ReadPortUshort((ULONG_PTR)(_Port)))
+
+#define NdisRawWritePortUchar(_Port, _Data) \
+    Dp8390WritePortUchar((ULONG_PTR)(_Port), (UCHAR)(_Data))
+
+#define NdisRawWritePortUshort(_Port, _Data) \
+    Dp8390WritePortUshort((ULONG_PTR)(_Port), (USHORT)(_Data))
+
+#define NdisRawReadPortBufferUchar(_Port, _Buffer, _Length) \
+    Dp8390ReadPortBufferUchar((ULONG_PTR)(_Port), (_Buffer), (_Length))
+
+#define NdisRawReadPortBufferUshort(_Port, _Buffer, _Length) \
+    Dp8390ReadPortBufferUshort((ULONG_PTR)(_Port), (_Buffer), (_Length))
+
+#define NdisRawWritePortBufferUchar(_Port, _Buffer, _Length) \
+    Dp8390WritePortBufferUchar((ULONG_PTR)(_Port), (_Buffer), (_Length))
+
+#define NdisRawWritePortBufferUshort(_Port, _Buffer, _Length) \
+    Dp8390WritePortBufferUshort((ULONG_PTR)(_Port), (_Buffer), (_Length))
+
+#endif // _NE2KSIM_
@@ -18,13 +18,18 @@ Environment:
 
 Notes:
 
-    optional-notes
+    The user mode harness in ne2ksim defines NE2000_HARNESS to build
+    card.c and interrup.c against its own NDIS definitions.
 
 Revision History:
 
 --*/
 
+#ifdef NE2000_HARNESS
+#include "ne2ksim.h"
+#else
 #include <ndis.h>
+#endif
 #include "ne2000hw.h"
 #include "ne2000sw.h"
 
@@ -0,0 +1,910 @@
+/*++
+
+Copyright (c) 1990-2000 Microsoft Corporation
+
+Module Name:
+
+    Batch.c
+
+Abstract:
+
+    Batched reads and writes. An IOCTL_PROTOCOL_READ_FRAMES request
+    is filled with as many frames as fit before it is completed, and
+    IOCTL_PROTOCOL_WRITE_FRAMES hands all the frames of a request to
+    the miniport with NdisSendPackets, so neither direction costs an
+    IRP per frame.
+
+Author:
+
+
+Environment:
+
+    Kernel mode only.
+
+Notes:
+
+    The frames of a write are described by partial MDLs of the
+    request's own MDL, built in descriptors that are allocated when
+    the adapter is bound. Nothing is allocated or copied per frame.
+
+    A read request keeps the number of bytes filled so far in
+    IoStatus.Information and the system address of its buffer in
+    DriverContext[0]. A write request counts its outstanding packets
+    in DriverContext[0], plus one while it is being submitted, and
+    keeps the status it will complete with in DriverContext[1]. Its
+    Information is the number of frames submitted, set before the
+    submission reference is dropped.
+
+Future:
+
+
+
+Revision History:
+
+--*/
+
+#include "ntddk.h"
+#include "ndis.h"
+#include "ntddpack.h"
+#include "packet.h"
+
+
+#define BATCH_BUFFER(_irp)      ((PUCHAR)(_irp)->Tail.Overlay.DriverContext[0])
+#define SEND_OUTSTANDING(_irp)  ((PLONG)&(_irp)->Tail.Overlay.DriverContext[0])
+#define SEND_STATUS(_irp)       ((PLONG)&(_irp)->Tail.Overlay.DriverContext[1])
+
+
+static
+PUCHAR
+PacketBatchReserve(
+    IN POPEN_INSTANCE   Open,
+    IN ULONG            CaptureLength,
+    IN ULONG            PacketLength,
+    IN OUT PLIST_ENTRY  CompleteList
+    )
+/*++
+
+Routine Description:
+
+    Reserves room for the next frame in the read request at the head
+    of the BatchList and fills in its record header. Requests the
+    frame doesn't fit in any more are moved to CompleteList. Called
+    with the BatchLock held.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    CaptureLength - number of frame bytes to store.
+
+    PacketLength - length of the frame on the wire.
+
+    CompleteList - receives the requests the caller must complete
+                   with PacketBatchComplete.
+
+Return Value:
+
+    Address the frame data must be copied to, or NULL if there is no
+    read request left. The CaptureLength of the record header says
+    how many bytes to copy; it is less than asked for if the frame
+    is larger than a whole request.
+
+--*/
+{
+    PPACKET_RING_FRAME  frame;
+    PIO_STACK_LOCATION  irpSp;
+    PLIST_ENTRY         entry;
+    PIRP                irp;
+    ULONG               length;
+    ULONG               recordLength;
+
+    recordLength = PACKET_RING_ALIGN(sizeof(PACKET_RING_FRAME) + CaptureLength);
+
+    while (!IsListEmpty(&Open->BatchList)) {
+
+        entry = Open->BatchList.Flink;
+        irp = CONTAINING_RECORD(entry, IRP, Tail.Overlay.ListEntry);
+        irpSp = IoGetCurrentIrpStackLocation(irp);
+
+        length = irpSp->Parameters.DeviceIoControl.OutputBufferLength
+                        & ~(PACKET_RING_ALIGNMENT - 1);
+
+        if (irp->IoStatus.Information == 0 && recordLength > length) {
+
+            CaptureLength = length - sizeof(PACKET_RING_FRAME);
+            recordLength = length;
+        }
+
+        if (recordLength <= length - irp->IoStatus.Information) {
+
+            frame = (PPACKET_RING_FRAME)(BATCH_BUFFER(irp)
+                                            + irp->IoStatus.Information);
+            frame->RecordLength = recordLength;
+            frame->CaptureLength = CaptureLength;
+            frame->PacketLength = PacketLength;
+            frame->Reserved = 0;
+            KeQuerySystemTime(&frame->TimeStamp);
+
+            irp->IoStatus.Information += recordLength;
+
+            return (PUCHAR)(frame + 1);
+        }
+
+        //
+        // This request is full, the frame goes to the next one.
+        //
+
+        RemoveEntryList(entry);
+        InsertTailList(CompleteList, entry);
+    }
+
+    DebugPrint(("No pending batch read, dropping packet\n"));
+
+    return NULL;
+}
+
+
+static
+VOID
+PacketBatchComplete(
+    IN POPEN_INSTANCE   Open,
+    IN PLIST_ENTRY      CompleteList
+    )
+/*++
+
+Routine Description:
+
+    Completes the read requests on CompleteList, which have already
+    been removed from the BatchList. A request that holds frames
+    completes successfully, an empty one as cancelled. Called without
+    the BatchLock.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    CompleteList - the requests.
+
+Return Value:
+
+--*/
+{
+    PLIST_ENTRY         entry;
+    PIRP                irp;
+
+    while (!IsListEmpty(CompleteList)) {
+
+        entry = RemoveHeadList(CompleteList);
+        irp = CONTAINING_RECORD(entry, IRP, Tail.Overlay.ListEntry);
+
+        //
+        // The cancel routine only completes a request it finds on the
+        // BatchList, so it is harmless if it is already running.
+        //
+
+        IoSetCancelRoutine(irp, NULL);
+
+        irp->IoStatus.Status = irp->IoStatus.Information != 0
+                                    ? STATUS_SUCCESS : STATUS_CANCELLED;
+
+        DebugPrint(("Batch read: %d bytes\n", irp->IoStatus.Information));
+
+        IoCompleteRequest(irp, IO_NO_INCREMENT);
+        IoDecrement(Open);
+    }
+}
+
+
+NTSTATUS
+PacketReadFrames(
+    IN POPEN_INSTANCE   Open,
+    IN PIRP             Irp
+    )
+/*++
+
+Routine Description:
+
+    Handles IOCTL_PROTOCOL_READ_FRAMES. Queues the request for the
+    receive handlers to fill.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    Irp - the read request.
+
+Return Value:
+
+    STATUS_PENDING if the request was queued, otherwise the status
+    the caller must complete the request with.
+
+--*/
+{
+    PIO_STACK_LOCATION  irpSp;
+    PUCHAR              buffer;
+    KIRQL               oldIrql;
+
+    irpSp = IoGetCurrentIrpStackLocation(Irp);
+
+    if (Irp->MdlAddress == NULL
+        || irpSp->Parameters.DeviceIoControl.OutputBufferLength
+                        < PACKET_FRAMES_MIN_LENGTH) {
+
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    //
+    // Map the buffer now, the receive handlers can't fail a request.
+    //
+
+    buffer = MmGetSystemAddressForMdlSafe(Irp->MdlAddress, NormalPagePriority);
+    if (buffer == NULL) {
+
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    Irp->Tail.Overlay.DriverContext[0] = buffer;
+    Irp->IoStatus.Information = 0;
+
+    KeAcquireSpinLock(&Open->BatchLock, &oldIrql);
+
+    IoSetCancelRoutine(Irp, PacketBatchCancelRoutine);
+
+    if (Irp->Cancel && IoSetCancelRoutine(Irp, NULL) != NULL) {
+
+        KeReleaseSpinLock(&Open->BatchLock, oldIrql);
+        return STATUS_CANCELLED;
+    }
+
+    InsertTailList(&Open->BatchList, &Irp->Tail.Overlay.ListEntry);
+
+    KeReleaseSpinLock(&Open->BatchLock, oldIrql);
+
+    return STATUS_PENDING;
+}
+
+
+VOID
+PacketBatchCancelRoutine (
+    IN PDEVICE_OBJECT   DeviceObject,
+    IN PIRP             Irp
+    )
+/*++
+
+Routine Description:
+
+    Cancel routine of the pending batch reads. The frames a request
+    already holds are not lost: it completes successfully with them.
+    The cancel spin lock is already acquired when this routine is
+    called.
+
+Arguments:
+
+    DeviceObject - pointer to the device object.
+
+    Irp - pointer to the IRP to be cancelled.
+
+Return Value:
+
+--*/
+{
+    POPEN_INSTANCE      open = DeviceObject->DeviceExtension;
+    LIST_ENTRY          completeList;
+    PLIST_ENTRY         thisEntry;
+    KIRQL               oldIrql;
+
+    DebugPrint(("PacketBatchCancelRoutine\n"));
+
+    InitializeListHead(&completeList);
+
+    oldIrql = Irp->CancelIrql;
+
+    KeAcquireSpinLockAtDpcLevel(&open->BatchLock);
+
+    IoReleaseCancelSpinLock( KeGetCurrentIrql() );
+
+    for (thisEntry = open->BatchList.Flink;
+         thisEntry != &open->BatchList;
+         thisEntry = thisEntry->Flink) {
+
+        if (thisEntry == &Irp->Tail.Overlay.ListEntry) {
+
+            RemoveEntryList(thisEntry);
+            InsertTailList(&completeList, thisEntry);
+            break;
+        }
+    }
+
+    KeReleaseSpinLock(&open->BatchLock, oldIrql);
+
+    PacketBatchComplete(open, &completeList);
+}
+
+
+VOID
+PacketCancelBatchReads(
+    IN POPEN_INSTANCE   Open
+    )
+/*++
+
+Routine Description:
+
+    Completes all the pending batch reads. Called on cleanup and on
+    unbind.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+Return Value:
+
+--*/
+{
+    LIST_ENTRY          completeList;
+    KIRQL               oldIrql;
+
+    InitializeListHead(&completeList);
+
+    KeAcquireSpinLock(&Open->BatchLock, &oldIrql);
+
+    while (!IsListEmpty(&Open->BatchList)) {
+
+        InsertTailList(&completeList, RemoveHeadList(&Open->BatchList));
+    }
+
+    KeReleaseSpinLock(&Open->BatchLock, oldIrql);
+
+    PacketBatchComplete(Open, &completeList);
+}
+
+
+VOID
+PacketBatchIndicate(
+    IN POPEN_INSTANCE   Open,
+    IN NDIS_HANDLE      MacReceiveContext,
+    IN PVOID            HeaderBuffer,
+    IN UINT             HeaderBufferSize,
+    IN PVOID            LookAheadBuffer,
+    IN UINT             LookaheadBufferSize,
+    IN UINT             PacketSize,
+    IN ULONG            CaptureLimit
+    )
+/*++
+
+Routine Description:
+
+    Stores a frame indicated to PacketReceiveIndicate in the pending
+    batch read. As in the ring, the frame is copied from the packet
+    descriptor if the miniport indicated one, and is otherwise cut at
+    the end of the lookahead data.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    HeaderBuffer ... PacketSize - as passed to PacketReceiveIndicate.
+
+    CaptureLimit - bytes of the frame to keep, as the filter decided.
+
+Return Value:
+
+--*/
+{
+    PNDIS_PACKET        packet;
+    LIST_ENTRY          completeList;
+    PUCHAR              data;
+    ULONG               captureLength;
+    KIRQL               oldIrql;
+
+    if (LookaheadBufferSize < PacketSize) {
+
+        packet = NdisGetReceivedPacket(Open->AdapterHandle, MacReceiveContext);
+        if (packet != NULL) {
+
+            PacketBatchReceivePacket(Open, packet, CaptureLimit);
+            return;
+        }
+    }
+
+    captureLength = HeaderBufferSize + LookaheadBufferSize;
+    if (captureLength > CaptureLimit) {
+        captureLength = CaptureLimit;
+    }
+
+    InitializeListHead(&completeList);
+
+    KeAcquireSpinLock(&Open->BatchLock, &oldIrql);
+
+    data = PacketBatchReserve(
+                Open,
+                captureLength,
+                HeaderBufferSize + PacketSize,
+                &completeList
+                );
+
+    if (data != NULL) {
+
+        captureLength = ((PPACKET_RING_FRAME)data - 1)->CaptureLength;
+
+        if (captureLength <= HeaderBufferSize) {
+
+            NdisMoveMappedMemory(data, HeaderBuffer, captureLength);
+        } else {
+
+            NdisMoveMappedMemory(data, HeaderBuffer, HeaderBufferSize);
+            NdisMoveMappedMemory(
+                data + HeaderBufferSize,
+                LookAheadBuffer,
+                captureLength - HeaderBufferSize
+                );
+        }
+    }
+
+    KeReleaseSpinLock(&Open->BatchLock, oldIrql);
+
+    PacketBatchComplete(Open, &completeList);
+}
+
+
+VOID
+PacketBatchReceivePacket(
+    IN POPEN_INSTANCE   Open,
+    IN PNDIS_PACKET     Packet,
+    IN ULONG            CaptureLimit
+    )
+/*++
+
+Routine Description:
+
+    Stores a frame indicated to PacketReceivePacket in the pending
+    batch read.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    Packet - pointer to the packet.
+
+    CaptureLimit - bytes of the frame to keep, as the filter decided.
+
+Return Value:
+
+--*/
+{
+    PPACKET_RING_FRAME  frame;
+    PNDIS_BUFFER        buffer;
+    LIST_ENTRY          completeList;
+    UINT                packetLength;
+    ULONG               captureLength;
+    PUCHAR              data;
+    KIRQL               oldIrql;
+
+    NdisQueryPacket(Packet, NULL, NULL, &buffer, &packetLength);
+
+    captureLength = packetLength;
+    if (captureLength > CaptureLimit) {
+        captureLength = CaptureLimit;
+    }
+
+    InitializeListHead(&completeList);
+
+    KeAcquireSpinLock(&Open->BatchLock, &oldIrql);
+
+    data = PacketBatchReserve(Open, captureLength, packetLength, &completeList);
+
+    if (data != NULL) {
+
+        frame = (PPACKET_RING_FRAME)data - 1;
+        frame->CaptureLength = PacketCopyBuffers(data, buffer, frame->CaptureLength);
+    }
+
+    KeReleaseSpinLock(&Open->BatchLock, oldIrql);
+
+    PacketBatchComplete(Open, &completeList);
+}
+
+
+VOID
+PacketBatchReceiveComplete(
+    IN POPEN_INSTANCE   Open
+    )
+/*++
+
+Routine Description:
+
+    Called at the end of each receive indication batch. Completes the
+    batch read that holds the frames of the batch, so the application
+    sees them without waiting for the request to fill up.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+Return Value:
+
+--*/
+{
+    LIST_ENTRY          completeList;
+    PLIST_ENTRY         entry;
+    PIRP                irp;
+    KIRQL               oldIrql;
+
+    InitializeListHead(&completeList);
+
+    KeAcquireSpinLock(&Open->BatchLock, &oldIrql);
+
+    if (!IsListEmpty(&Open->BatchList)) {
+
+        entry = Open->BatchList.Flink;
+        irp = CONTAINING_RECORD(entry, IRP, Tail.Overlay.ListEntry);
+
+        if (irp->IoStatus.Information != 0) {
+
+            RemoveEntryList(entry);
+            InsertTailList(&completeList, entry);
+        }
+    }
+
+    KeReleaseSpinLock(&Open->BatchLock, oldIrql);
+
+    PacketBatchComplete(Open, &completeList);
+}
+
+
+static
+VOID
+PacketWriteFramesDereference(
+    IN POPEN_INSTANCE   Open,
+    IN PIRP             Irp
+    )
+/*++
+
+Routine Description:
+
+    Drops a reference on a batch write and completes it when the
+    last one goes. Information already holds the number of frames
+    submitted.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    Irp - the write request.
+
+Return Value:
+
+--*/
+{
+    if (InterlockedDecrement(SEND_OUTSTANDING(Irp)) == 0) {
+
+        Irp->IoStatus.Status = *SEND_STATUS(Irp);
+
+        DebugPrint(("Batch write: %d frames, status %x\n",
+            Irp->IoStatus.Information, Irp->IoStatus.Status));
+
+        IoCompleteRequest(Irp, IO_NO_INCREMENT);
+        IoDecrement(Open);
+    }
+}
+
+
+NTSTATUS
+PacketWriteFrames(
+    IN POPEN_INSTANCE   Open,
+    IN PIRP             Irp
+    )
+/*++
+
+Routine Description:
+
+    Handles IOCTL_PROTOCOL_WRITE_FRAMES. Points a send descriptor at
+    each frame of the request and passes them to the miniport in
+    arrays of up to SEND_ARRAY_SIZE packets. The request completes
+    when the last of its packets does, with the number of frames
+    submitted. Sending stops early, without an error, when the
+    descriptors run out. A malformed record stops it and fails the
+    request, as does a send the adapter fails, so the count is only
+    a place to resume from when the request succeeds.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    Irp - the write request.
+
+Return Value:
+
+    STATUS_PENDING if frames were sent, otherwise the status the
+    caller must complete the request with.
+
+--*/
+{
+    PIO_STACK_LOCATION  irpSp;
+    PPACKET_RING_FRAME  frame;
+    PNDIS_PACKET        packets[SEND_ARRAY_SIZE];
+    PNDIS_PACKET        packet;
+    PPACKET_RESERVED    reserved;
+    PLIST_ENTRY         entry;
+    PUCHAR              buffer;
+    PUCHAR              virtualAddress;
+    ULONG               length;
+    ULONG               offset;
+    ULONG               recordLength;
+    ULONG               captureLength;
+    ULONG               count = 0;
+    ULONG               submitted = 0;
+    NTSTATUS            status = STATUS_INSUFFICIENT_RESOURCES;
+
+    irpSp = IoGetCurrentIrpStackLocation(Irp);
+    length = irpSp->Parameters.DeviceIoControl.OutputBufferLength;
+
+    if (Irp->MdlAddress == NULL || length < sizeof(PACKET_RING_FRAME)) {
+
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    buffer = MmGetSystemAddressForMdlSafe(Irp->MdlAddress, NormalPagePriority);
+    if (buffer == NULL) {
+
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    virtualAddress = MmGetMdlVirtualAddress(Irp->MdlAddress);
+
+    *SEND_OUTSTANDING(Irp) = 1;
+    *SEND_STATUS(Irp) = STATUS_SUCCESS;
+
+    for (offset = 0;
+         length - offset >= sizeof(PACKET_RING_FRAME);
+         offset += recordLength) {
+
+        //
+        // The application can change the buffer under us, so each
+        // header is read once and checked before it is used.
+        //
+
+        frame = (PPACKET_RING_FRAME)(buffer + offset);
+        recordLength = frame->RecordLength;
+        captureLength = frame->CaptureLength;
+
+        if (recordLength > length - offset
+            || recordLength < sizeof(PACKET_RING_FRAME)
+            || (recordLength & (PACKET_RING_ALIGNMENT - 1)) != 0
+            || captureLength > recordLength - sizeof(PACKET_RING_FRAME)
+            || captureLength < ETHERNET_HEADER_LENGTH
+            || ADDRESS_AND_SIZE_TO_SPAN_PAGES(
+                    virtualAddress + offset + sizeof(PACKET_RING_FRAME),
+                    captureLength) > SEND_MDL_PAGES) {
+
+            DebugPrint(("Batch write: bad record at %d\n", offset));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        entry = ExInterlockedRemoveHeadList(&Open->SendFreeList, &Open->SendLock);
+        if (entry == NULL) {
+
+            DebugPrint(("Batch write: out of send descriptors\n"));
+            break;
+        }
+
+        reserved = CONTAINING_RECORD(entry, PACKET_RESERVED, ListElement);
+        packet = CONTAINING_RECORD(reserved, NDIS_PACKET, ProtocolReserved);
+
+        IoBuildPartialMdl(
+            Irp->MdlAddress,
+            reserved->pMdl,
+            virtualAddress + offset + sizeof(PACKET_RING_FRAME),
+            captureLength
+            );
+
+        NdisChainBufferAtFront(packet, reserved->pMdl);
+        reserved->Irp = Irp;
+
+        InterlockedIncrement(SEND_OUTSTANDING(Irp));
+        submitted++;
+
+        packets[count++] = packet;
+
+        if (count == SEND_ARRAY_SIZE) {
+
+            NdisSendPackets(Open->AdapterHandle, packets, count);
+            count = 0;
+        }
+    }
+
+    if (count != 0) {
+
+        NdisSendPackets(Open->AdapterHandle, packets, count);
+    }
+
+    if (submitted == 0) {
+
+        return status;
+    }
+
+    //
+    // Nothing completes the request while we hold our reference, so
+    // Information can be set here. A malformed record overrides any
+    // send failure already recorded.
+    //
+
+    Irp->IoStatus.Information = submitted;
+
+    if (status == STATUS_INVALID_PARAMETER) {
+
+        InterlockedExchange(SEND_STATUS(Irp), STATUS_INVALID_PARAMETER);
+    }
+
+    PacketWriteFramesDereference(Open, Irp);
+
+    return STATUS_PENDING;
+}
+
+
+VOID
+PacketWriteFramesComplete(
+    IN POPEN_INSTANCE   Open,
+    IN PNDIS_PACKET     Packet,
+    IN NDIS_STATUS      Status
+    )
+/*++
+
+Routine Description:
+
+    Called by PacketSendComplete for the send descriptors. Puts the
+    descriptor back on the free list and completes the write request
+    if this was its last packet.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    Packet - the descriptor.
+
+    Status - status of the send.
+
+Return Value:
+
+--*/
+{
+    PIRP                irp;
+    PNDIS_BUFFER        buffer;
+
+    irp = RESERVED(Packet)->Irp;
+
+    if (Status != NDIS_STATUS_SUCCESS) {
+
+        InterlockedCompareExchange(
+            SEND_STATUS(irp),
+            STATUS_UNSUCCESSFUL,
+            STATUS_SUCCESS);
+    }
+
+    NdisUnchainBufferAtFront(Packet, &buffer);
+    MmPrepareMdlForReuse(RESERVED(Packet)->pMdl);
+    NdisReinitializePacket(Packet);
+
+    ExInterlockedInsertTailList(
+        &Open->SendFreeList,
+        &RESERVED(Packet)->ListElement,
+        &Open->SendLock);
+
+    PacketWriteFramesDereference(Open, irp);
+}
+
+
+NDIS_STATUS
+PacketAllocateSendDescriptors(
+    IN POPEN_INSTANCE   Open
+    )
+/*++
+
+Routine Description:
+
+    Allocates the send descriptors of an open instance, each with an
+    MDL large enough to describe any frame of up to SEND_MDL_PAGES
+    pages. Called from PacketBindAdapter.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+Return Value:
+
+    NDIS_STATUS_SUCCESS, or the status of the allocation that failed.
+
+--*/
+{
+    PNDIS_PACKET        packet;
+    PMDL                mdl;
+    NDIS_STATUS         status;
+    ULONG               i;
+
+    KeInitializeSpinLock(&Open->SendLock);
+    InitializeListHead(&Open->SendFreeList);
+
+    NdisAllocatePacketPool(
+        &status,
+        &Open->SendPool,
+        SEND_DESCRIPTORS,
+        sizeof(PACKET_RESERVED));
+
+    if (status != NDIS_STATUS_SUCCESS) {
+
+        Open->SendPool = NULL;
+        return status;
+    }
+
+    for (i = 0; i < SEND_DESCRIPTORS; i++) {
+
+        NdisAllocatePacket(&status, &packet, Open->SendPool);
+        if (status != NDIS_STATUS_SUCCESS) {
+            break;
+        }
+
+        mdl = IoAllocateMdl(NULL, SEND_MDL_PAGES * PAGE_SIZE, FALSE, FALSE, NULL);
+        if (mdl == NULL) {
+
+            NdisFreePacket(packet);
+            status = NDIS_STATUS_RESOURCES;
+            break;
+        }
+
+        RESERVED(packet)->Irp = NULL;
+        RESERVED(packet)->pMdl = mdl;
+
+        InsertTailList(&Open->SendFreeList, &RESERVED(packet)->ListElement);
+    }
+
+    if (status != NDIS_STATUS_SUCCESS) {
+
+        DebugPrint(("Packet: Failed to allocate send descriptors\n"));
+        PacketFreeSendDescriptors(Open);
+    }
+
+    return status;
+}
+
+
+VOID
+PacketFreeSendDescriptors(
+    IN POPEN_INSTANCE   Open
+    )
+/*++
+
+Routine Description:
+
+    Frees the send descriptors of an open instance. All of them must
+    be back on the free list, which is the case once the outstanding
+    IRPs have completed.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+Return Value:
+
+--*/
+{
+    PLIST_ENTRY         entry;
+    PPACKET_RESERVED    reserved;
+    PNDIS_PACKET        packet;
+
+    if (Open->SendPool == NULL) {
+        return;
+    }
+
+    while (!IsListEmpty(&Open->SendFreeList)) {
+
+        entry = RemoveHeadList(&Open->SendFreeList);
+        reserved = CONTAINING_RECORD(entry, PACKET_RESERVED, ListElement);
+        packet = CONTAINING_RECORD(reserved, NDIS_PACKET, ProtocolReserved);
+
+        IoFreeMdl(reserved->pMdl);
+        NdisFreePacket(packet);
+    }
+
+    NdisFreePacketPool(Open->SendPool);
+    Open->SendPool = NULL;
+}
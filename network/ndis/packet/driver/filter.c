@@ -0,0 +1,895 @@
+/*++
+
+Copyright (c) 1990-2000 Microsoft Corporation
+
+Module Name:
+
+    Filter.c
+
+Abstract:
+
+    In-driver packet filter. A program attached with
+    IOCTL_PROTOCOL_SET_FILTER is run on each received frame before
+    it is transferred or copied, and decides whether the frame is
+    kept and how much of it. Programs use the BSD packet filter
+    instruction set (see ntddpack.h).
+
+Author:
+
+
+Environment:
+
+    Kernel mode only. The validator and the interpreter are also
+    built into the user mode harness in ..\filtest, which defines
+    PACKET_FILTER_HARNESS and includes this file.
+
+Notes:
+
+    A program is validated once when it is attached: every jump
+    must go forward and stay in the program, the last instruction
+    must return, and scratch memory indexes and constant divisors
+    must be valid. The interpreter relies on this and so needs no
+    checks of its own besides the bounds of the frame.
+
+Future:
+
+
+
+Revision History:
+
+--*/
+
+#ifndef PACKET_FILTER_HARNESS
+#include "ntddk.h"
+#include "ndis.h"
+#include "ntddpack.h"
+#include "packet.h"
+#endif
+
+
+//
+// The frame as the filter sees it: a MAC header and the data that
+// follows, which need not be contiguous, and the length of the frame
+// on the wire. Loads past HeaderLength + DataLength reject the frame.
+//
+
+typedef struct _PACKET_FILTER_FRAME {
+
+    PUCHAR          Header;
+    ULONG           HeaderLength;
+    PUCHAR          Data;
+    ULONG           DataLength;
+    ULONG           PacketLength;
+
+}   PACKET_FILTER_FRAME, *PPACKET_FILTER_FRAME;
+
+
+static
+BOOLEAN
+PacketFilterLoad(
+    IN PPACKET_FILTER_FRAME Frame,
+    IN ULONG                Offset,
+    IN ULONG                Size,
+    OUT PULONG              Value
+    )
+/*++
+
+Routine Description:
+
+    Loads Size (1, 2 or 4) bytes of the frame at Offset in network
+    byte order.
+
+Arguments:
+
+    Frame - the frame.
+
+    Offset - offset of the first byte from the start of the frame.
+
+    Size - number of bytes.
+
+    Value - receives the value.
+
+Return Value:
+
+    FALSE if the bytes are not all within the frame.
+
+--*/
+{
+    PUCHAR              p;
+    ULONG               value;
+    ULONG               i;
+
+    if (Offset + Size <= Frame->HeaderLength && Offset + Size > Offset) {
+
+        p = Frame->Header + Offset;
+
+    } else if (Offset >= Frame->HeaderLength
+               && Offset - Frame->HeaderLength < Frame->DataLength
+               && Frame->DataLength - (Offset - Frame->HeaderLength) >= Size) {
+
+        p = Frame->Data + (Offset - Frame->HeaderLength);
+
+    } else {
+
+        //
+        // The bytes straddle the header and the data, or are
+        // beyond the end of the frame.
+        //
+
+        if (Offset >= Frame->HeaderLength + Frame->DataLength
+            || Frame->HeaderLength + Frame->DataLength - Offset < Size) {
+
+            return FALSE;
+        }
+
+        for (value = 0, i = 0; i < Size; i++, Offset++) {
+
+            value = (value << 8) | (Offset < Frame->HeaderLength
+                                    ? Frame->Header[Offset]
+                                    : Frame->Data[Offset - Frame->HeaderLength]);
+        }
+
+        *Value = value;
+        return TRUE;
+    }
+
+    switch (Size) {
+
+    case 4:
+        *Value = ((ULONG)p[0] << 24) | ((ULONG)p[1] << 16)
+                    | ((ULONG)p[2] << 8) | p[3];
+        break;
+
+    case 2:
+        *Value = ((ULONG)p[0] << 8) | p[1];
+        break;
+
+    default:
+        *Value = p[0];
+        break;
+    }
+
+    return TRUE;
+}
+
+
+BOOLEAN
+PacketFilterValidate(
+    IN PPACKET_FILTER_INSN  Program,
+    IN ULONG                Count
+    )
+/*++
+
+Routine Description:
+
+    Checks that a filter program is safe to run.
+
+Arguments:
+
+    Program - the instructions.
+
+    Count - number of instructions.
+
+Return Value:
+
+    TRUE if the program can be attached.
+
+--*/
+{
+    PPACKET_FILTER_INSN insn;
+    ULONG               i;
+    ULONG               left;           // instructions after this one
+
+    if (Count == 0 || Count > PACKET_FILTER_MAX_INSNS) {
+        return FALSE;
+    }
+
+    for (i = 0; i < Count; i++) {
+
+        insn = &Program[i];
+        left = Count - i - 1;
+
+        switch (BPF_CLASS(insn->Code)) {
+
+        case BPF_LD:
+        case BPF_LDX:
+
+            switch (insn->Code) {
+
+            case BPF_LD|BPF_W|BPF_ABS:
+            case BPF_LD|BPF_H|BPF_ABS:
+            case BPF_LD|BPF_B|BPF_ABS:
+            case BPF_LD|BPF_W|BPF_IND:
+            case BPF_LD|BPF_H|BPF_IND:
+            case BPF_LD|BPF_B|BPF_IND:
+            case BPF_LD|BPF_W|BPF_LEN:
+            case BPF_LD|BPF_IMM:
+            case BPF_LDX|BPF_W|BPF_LEN:
+            case BPF_LDX|BPF_IMM:
+            case BPF_LDX|BPF_B|BPF_MSH:
+                break;
+
+            case BPF_LD|BPF_MEM:
+            case BPF_LDX|BPF_MEM:
+                if (insn->K >= PACKET_FILTER_MEMWORDS) {
+                    return FALSE;
+                }
+                break;
+
+            default:
+                return FALSE;
+            }
+            break;
+
+        case BPF_ST:
+        case BPF_STX:
+
+            if (insn->Code != BPF_CLASS(insn->Code)
+                || insn->K >= PACKET_FILTER_MEMWORDS) {
+                return FALSE;
+            }
+            break;
+
+        case BPF_ALU:
+
+            switch (BPF_OP(insn->Code)) {
+
+            case BPF_DIV:
+            case BPF_MOD:
+                if (BPF_SRC(insn->Code) == BPF_K && insn->K == 0) {
+                    return FALSE;
+                }
+                break;
+
+            case BPF_ADD:
+            case BPF_SUB:
+            case BPF_MUL:
+            case BPF_OR:
+            case BPF_AND:
+            case BPF_XOR:
+            case BPF_LSH:
+            case BPF_RSH:
+                break;
+
+            case BPF_NEG:
+                if (insn->Code != (BPF_ALU|BPF_NEG)) {
+                    return FALSE;
+                }
+                break;
+
+            default:
+                return FALSE;
+            }
+
+            if (insn->Code & ~(0xf0 | BPF_X | 0x07)) {
+                return FALSE;
+            }
+            break;
+
+        case BPF_JMP:
+
+            switch (BPF_OP(insn->Code)) {
+
+            case BPF_JA:
+                if (insn->Code != (BPF_JMP|BPF_JA) || insn->K >= left) {
+                    return FALSE;
+                }
+                break;
+
+            case BPF_JEQ:
+            case BPF_JGT:
+            case BPF_JGE:
+            case BPF_JSET:
+                if ((insn->Code & ~(0xf0 | BPF_X | 0x07))
+                    || insn->JumpTrue >= left || insn->JumpFalse >= left) {
+                    return FALSE;
+                }
+                break;
+
+            default:
+                return FALSE;
+            }
+            break;
+
+        case BPF_RET:
+
+            if (insn->Code != (BPF_RET|BPF_K) && insn->Code != (BPF_RET|BPF_A)) {
+                return FALSE;
+            }
+            break;
+
+        case BPF_MISC:
+
+            if (insn->Code != (BPF_MISC|BPF_TAX) && insn->Code != (BPF_MISC|BPF_TXA)) {
+                return FALSE;
+            }
+            break;
+        }
+    }
+
+    //
+    // Jumps only go forward, so ending with a return
+    // means every path through the program returns.
+    //
+
+    return BPF_CLASS(Program[Count - 1].Code) == BPF_RET;
+}
+
+
+ULONG
+PacketFilterRun(
+    IN PPACKET_FILTER_INSN  Program,
+    IN PUCHAR               Header,
+    IN ULONG                HeaderLength,
+    IN PUCHAR               Data,
+    IN ULONG                DataLength,
+    IN ULONG                PacketLength
+    )
+/*++
+
+Routine Description:
+
+    Runs a validated filter program on a frame.
+
+Arguments:
+
+    Program - the instructions, checked by PacketFilterValidate.
+
+    Header - the MAC header of the frame.
+
+    HeaderLength - bytes at Header.
+
+    Data - the data that follows the header, which can be the
+           lookahead buffer of a receive indication.
+
+    DataLength - bytes at Data.
+
+    PacketLength - length of the frame on the wire.
+
+Return Value:
+
+    Number of bytes of the frame to keep, 0 to drop it.
+
+--*/
+{
+    PACKET_FILTER_FRAME frame;
+    PPACKET_FILTER_INSN insn;
+    ULONG               mem[PACKET_FILTER_MEMWORDS];
+    ULONG               a = 0;          // accumulator
+    ULONG               x = 0;          // index register
+    ULONG               k;
+
+    frame.Header = Header;
+    frame.HeaderLength = HeaderLength;
+    frame.Data = Data;
+    frame.DataLength = DataLength;
+    frame.PacketLength = PacketLength;
+
+    RtlZeroMemory(mem, sizeof(mem));
+
+    for (insn = Program; ; insn++) {
+
+        k = insn->K;
+
+        switch (insn->Code) {
+
+        case BPF_RET|BPF_K:
+            return k;
+
+        case BPF_RET|BPF_A:
+            return a;
+
+        case BPF_LD|BPF_W|BPF_ABS:
+            if (!PacketFilterLoad(&frame, k, 4, &a)) {
+                return 0;
+            }
+            break;
+
+        case BPF_LD|BPF_H|BPF_ABS:
+            if (!PacketFilterLoad(&frame, k, 2, &a)) {
+                return 0;
+            }
+            break;
+
+        case BPF_LD|BPF_B|BPF_ABS:
+            if (!PacketFilterLoad(&frame, k, 1, &a)) {
+                return 0;
+            }
+            break;
+
+        case BPF_LD|BPF_W|BPF_IND:
+            if (x + k < x || !PacketFilterLoad(&frame, x + k, 4, &a)) {
+                return 0;
+            }
+            break;
+
+        case BPF_LD|BPF_H|BPF_IND:
+            if (x + k < x || !PacketFilterLoad(&frame, x + k, 2, &a)) {
+                return 0;
+            }
+            break;
+
+        case BPF_LD|BPF_B|BPF_IND:
+            if (x + k < x || !PacketFilterLoad(&frame, x + k, 1, &a)) {
+                return 0;
+            }
+            break;
+
+        case BPF_LD|BPF_W|BPF_LEN:
+            a = PacketLength;
+            break;
+
+        case BPF_LDX|BPF_W|BPF_LEN:
+            x = PacketLength;
+            break;
+
+        case BPF_LD|BPF_IMM:
+            a = k;
+            break;
+
+        case BPF_LDX|BPF_IMM:
+            x = k;
+            break;
+
+        case BPF_LD|BPF_MEM:
+            a = mem[k];
+            break;
+
+        case BPF_LDX|BPF_MEM:
+            x = mem[k];
+            break;
+
+        case BPF_LDX|BPF_B|BPF_MSH:
+            //
+            // Length of the IP header at k
+            //
+            if (!PacketFilterLoad(&frame, k, 1, &x)) {
+                return 0;
+            }
+            x = (x & 0x0f) << 2;
+            break;
+
+        case BPF_ST:
+            mem[k] = a;
+            break;
+
+        case BPF_STX:
+            mem[k] = x;
+            break;
+
+        case BPF_JMP|BPF_JA:
+            insn += k;
+            break;
+
+        case BPF_JMP|BPF_JEQ|BPF_K:
+            insn += (a == k) ? insn->JumpTrue : insn->JumpFalse;
+            break;
+
+        case BPF_JMP|BPF_JGT|BPF_K:
+            insn += (a > k) ? insn->JumpTrue : insn->JumpFalse;
+            break;
+
+        case BPF_JMP|BPF_JGE|BPF_K:
+            insn += (a >= k) ? insn->JumpTrue : insn->JumpFalse;
+            break;
+
+        case BPF_JMP|BPF_JSET|BPF_K:
+            insn += (a & k) ? insn->JumpTrue : insn->JumpFalse;
+            break;
+
+        case BPF_JMP|BPF_JEQ|BPF_X:
+            insn += (a == x) ? insn->JumpTrue : insn->JumpFalse;
+            break;
+
+        case BPF_JMP|BPF_JGT|BPF_X:
+            insn += (a > x) ? insn->JumpTrue : insn->JumpFalse;
+            break;
+
+        case BPF_JMP|BPF_JGE|BPF_X:
+            insn += (a >= x) ? insn->JumpTrue : insn->JumpFalse;
+            break;
+
+        case BPF_JMP|BPF_JSET|BPF_X:
+            insn += (a & x) ? insn->JumpTrue : insn->JumpFalse;
+            break;
+
+        case BPF_ALU|BPF_ADD|BPF_X:     a += x;     break;
+        case BPF_ALU|BPF_SUB|BPF_X:     a -= x;     break;
+        case BPF_ALU|BPF_MUL|BPF_X:     a *= x;     break;
+        case BPF_ALU|BPF_AND|BPF_X:     a &= x;     break;
+        case BPF_ALU|BPF_OR|BPF_X:      a |= x;     break;
+        case BPF_ALU|BPF_XOR|BPF_X:     a ^= x;     break;
+
+        case BPF_ALU|BPF_LSH|BPF_X:
+            a = (x < 32) ? a << x : 0;
+            break;
+
+        case BPF_ALU|BPF_RSH|BPF_X:
+            a = (x < 32) ? a >> x : 0;
+            break;
+
+        case BPF_ALU|BPF_DIV|BPF_X:
+            if (x == 0) {
+                return 0;
+            }
+            a /= x;
+            break;
+
+        case BPF_ALU|BPF_MOD|BPF_X:
+            if (x == 0) {
+                return 0;
+            }
+            a %= x;
+            break;
+
+        case BPF_ALU|BPF_ADD|BPF_K:     a += k;     break;
+        case BPF_ALU|BPF_SUB|BPF_K:     a -= k;     break;
+        case BPF_ALU|BPF_MUL|BPF_K:     a *= k;     break;
+        case BPF_ALU|BPF_DIV|BPF_K:     a /= k;     break;
+        case BPF_ALU|BPF_MOD|BPF_K:     a %= k;     break;
+        case BPF_ALU|BPF_AND|BPF_K:     a &= k;     break;
+        case BPF_ALU|BPF_OR|BPF_K:      a |= k;     break;
+        case BPF_ALU|BPF_XOR|BPF_K:     a ^= k;     break;
+
+        case BPF_ALU|BPF_LSH|BPF_K:
+            a = (k < 32) ? a << k : 0;
+            break;
+
+        case BPF_ALU|BPF_RSH|BPF_K:
+            a = (k < 32) ? a >> k : 0;
+            break;
+
+        case BPF_ALU|BPF_NEG:
+            a = (ULONG)-(LONG)a;
+            break;
+
+        case BPF_MISC|BPF_TAX:
+            x = a;
+            break;
+
+        case BPF_MISC|BPF_TXA:
+            a = x;
+            break;
+
+        default:
+            //
+            // Not reached for a validated program
+            //
+            return 0;
+        }
+    }
+}
+
+
+#ifndef PACKET_FILTER_HARNESS
+
+static
+ULONG
+PacketFilterLimit(
+    IN PPACKET_FILTER_PROGRAM   Filter,
+    IN ULONG                    Result,
+    IN ULONG                    HeaderLength,
+    IN ULONG                    PacketLength
+    )
+/*++
+
+Routine Description:
+
+    Turns the result of a filter program into the number of bytes
+    to capture, applying the snap length. A kept frame is never cut
+    inside its MAC header.
+
+Arguments:
+
+    Filter - the filter of the open instance.
+
+    Result - what the program returned.
+
+    HeaderLength - length of the MAC header.
+
+    PacketLength - length of the frame.
+
+Return Value:
+
+    Number of bytes of the frame to capture, 0 to drop it.
+
+--*/
+{
+    if (Filter->SnapLength != 0 && Result > Filter->SnapLength) {
+        Result = Filter->SnapLength;
+    }
+
+    if (Result > PacketLength) {
+        Result = PacketLength;
+    }
+
+    if (Result != 0 && Result < HeaderLength) {
+        Result = HeaderLength;
+    }
+
+    return Result;
+}
+
+
+ULONG
+PacketFilterIndicate(
+    IN POPEN_INSTANCE   Open,
+    IN PVOID            HeaderBuffer,
+    IN UINT             HeaderBufferSize,
+    IN PVOID            LookAheadBuffer,
+    IN UINT             LookaheadBufferSize,
+    IN UINT             PacketSize
+    )
+/*++
+
+Routine Description:
+
+    Runs the filter of the open instance on a frame indicated to
+    PacketReceiveIndicate, on the header and lookahead data.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    The remaining arguments are those of PacketReceiveIndicate.
+
+Return Value:
+
+    Number of bytes of the frame (counting the header) to capture,
+    0 to drop it.
+
+--*/
+{
+    PPACKET_FILTER_PROGRAM  filter;
+    LOCK_STATE              lockState;
+    ULONG                   packetLength = HeaderBufferSize + PacketSize;
+    ULONG                   result;
+
+    //
+    // Don't take the lock when no filter is attached
+    //
+
+    if (Open->Filter == NULL) {
+        return packetLength;
+    }
+
+    NdisAcquireReadWriteLock(&Open->FilterLock, FALSE, &lockState);
+
+    filter = Open->Filter;
+
+    if (filter == NULL) {
+
+        result = packetLength;
+
+    } else {
+
+        result = packetLength;
+
+        if (filter->InstructionCount != 0) {
+
+            result = PacketFilterRun(
+                        filter->Instructions,
+                        HeaderBuffer,
+                        HeaderBufferSize,
+                        LookAheadBuffer,
+                        LookaheadBufferSize,
+                        packetLength
+                        );
+        }
+
+        result = PacketFilterLimit(filter, result, HeaderBufferSize, packetLength);
+    }
+
+    NdisReleaseReadWriteLock(&Open->FilterLock, &lockState);
+
+    return result;
+}
+
+
+ULONG
+PacketFilterPacket(
+    IN POPEN_INSTANCE   Open,
+    IN PNDIS_PACKET     Packet
+    )
+/*++
+
+Routine Description:
+
+    Runs the filter of the open instance on a packet indicated to
+    PacketReceivePacket. The program sees the first two buffers of
+    the packet, which normally hold the whole frame or its header
+    and the rest.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    Packet - pointer to the packet.
+
+Return Value:
+
+    Number of bytes of the frame to capture, 0 to drop it.
+
+--*/
+{
+    PPACKET_FILTER_PROGRAM  filter;
+    LOCK_STATE              lockState;
+    PNDIS_BUFFER            buffer, nextBuffer;
+    PVOID                   header = NULL, data = NULL;
+    UINT                    headerLength = 0, dataLength = 0;
+    UINT                    packetLength;
+    ULONG                   result;
+
+    NdisQueryPacket(Packet, NULL, NULL, &buffer, &packetLength);
+
+    if (Open->Filter == NULL) {
+        return packetLength;
+    }
+
+    if (buffer != NULL) {
+
+        NdisQueryBufferSafe(buffer, &header, &headerLength, NormalPagePriority);
+        if (header == NULL) {
+            headerLength = 0;
+        }
+
+        NdisGetNextBuffer(buffer, &nextBuffer);
+        if (nextBuffer != NULL) {
+
+            NdisQueryBufferSafe(nextBuffer, &data, &dataLength, NormalPagePriority);
+            if (data == NULL) {
+                dataLength = 0;
+            }
+        }
+    }
+
+    NdisAcquireReadWriteLock(&Open->FilterLock, FALSE, &lockState);
+
+    filter = Open->Filter;
+
+    if (filter == NULL) {
+
+        result = packetLength;
+
+    } else {
+
+        result = packetLength;
+
+        if (filter->InstructionCount != 0) {
+
+            result = PacketFilterRun(
+                        filter->Instructions,
+                        header,
+                        headerLength,
+                        data,
+                        dataLength,
+                        packetLength
+                        );
+        }
+
+        result = PacketFilterLimit(filter, result, ETHERNET_HEADER_LENGTH, packetLength);
+    }
+
+    NdisReleaseReadWriteLock(&Open->FilterLock, &lockState);
+
+    return result;
+}
+
+
+NTSTATUS
+PacketSetFilter(
+    IN POPEN_INSTANCE   Open,
+    IN PIRP             Irp
+    )
+/*++
+
+Routine Description:
+
+    Handles IOCTL_PROTOCOL_SET_FILTER. Validates the program and
+    replaces the filter of the open instance with it.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    Irp - the request, with a PACKET_FILTER_PROGRAM as input.
+
+Return Value:
+
+    NT status code.
+
+--*/
+{
+    PIO_STACK_LOCATION      irpSp;
+    PPACKET_FILTER_PROGRAM  program;
+    PPACKET_FILTER_PROGRAM  filter = NULL;
+    PPACKET_FILTER_PROGRAM  oldFilter;
+    LOCK_STATE              lockState;
+    ULONG                   length;
+
+    irpSp = IoGetCurrentIrpStackLocation(Irp);
+    program = Irp->AssociatedIrp.SystemBuffer;
+    length = irpSp->Parameters.DeviceIoControl.InputBufferLength;
+
+    if (length < PACKET_FILTER_PROGRAM_LENGTH(0)
+        || program->InstructionCount > PACKET_FILTER_MAX_INSNS
+        || length < PACKET_FILTER_PROGRAM_LENGTH(program->InstructionCount)) {
+
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (program->InstructionCount != 0
+        && !PacketFilterValidate(program->Instructions, program->InstructionCount)) {
+
+        DebugPrint(("Rejected filter program\n"));
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    //
+    // An empty program without a snap length removes the filter
+    //
+
+    if (program->InstructionCount != 0 || program->SnapLength != 0) {
+
+        length = PACKET_FILTER_PROGRAM_LENGTH(program->InstructionCount);
+
+        filter = ExAllocatePool(NonPagedPool, length);
+        if (filter == NULL) {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        RtlCopyMemory(filter, program, length);
+    }
+
+    NdisAcquireReadWriteLock(&Open->FilterLock, TRUE, &lockState);
+
+    oldFilter = Open->Filter;
+    Open->Filter = filter;
+
+    NdisReleaseReadWriteLock(&Open->FilterLock, &lockState);
+
+    if (oldFilter != NULL) {
+        ExFreePool(oldFilter);
+    }
+
+    DebugPrint(("Filter set: %d instructions, snap length %d\n",
+                    program->InstructionCount, program->SnapLength));
+
+    return STATUS_SUCCESS;
+}
+
+
+VOID
+PacketFreeFilter(
+    IN POPEN_INSTANCE   Open
+    )
+/*++
+
+Routine Description:
+
+    Removes the filter of the open instance, on cleanup and unbind.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+Return Value:
+
+--*/
+{
+    PPACKET_FILTER_PROGRAM  oldFilter;
+    LOCK_STATE              lockState;
+
+    NdisAcquireReadWriteLock(&Open->FilterLock, TRUE, &lockState);
+
+    oldFilter = Open->Filter;
+    Open->Filter = NULL;
+
+    NdisReleaseReadWriteLock(&Open->FilterLock, &lockState);
+
+    if (oldFilter != NULL) {
+        ExFreePool(oldFilter);
+    }
+}
+
+#endif
@@ -28,6 +28,7 @@ Revision History:
 
 #include "ntddk.h"
 #include "ndis.h"
+#include "ntddpack.h"
 #include "packet.h"
 
 
@@ -195,6 +196,20 @@ Return Value:
     
     PacketCancelReadIrps(DeviceObject);
 
+    PacketCancelBatchReads(open);
+
+    //
+    // Stop ring capture, this completes the pending map request.
+    //
+
+    PacketUnmapRing(open);
+
+    //
+    // The filter belongs to this handle, don't leave it to the next one.
+    //
+
+    PacketFreeFilter(open);
+
     //
     // Since the current implementation of NDIS doesn't
     // allow us to cancel requests pending at the 
@@ -406,6 +406,85 @@ Return Value:
 
         }
 
+    } else if (functionCode == IOCTL_PROTOCOL_MAP_RING) {
+
+        DebugPrint(("IoControl - Map ring\n"));
+
+        //
+        // The request stays pending for as long as the ring is mapped.
+        // It is completed by PacketUnmapRing or by the cancel routine.
+        //
+
+        status = PacketMapRing(open, Irp);
+
+        if (status != STATUS_PENDING) {
+
+            Irp->IoStatus.Status = status;
+            Irp->IoStatus.Information = 0;
+            IoCompleteRequest(Irp, IO_NO_INCREMENT);
+            IoDecrement(open);
+        }
+
+    } else if (functionCode == IOCTL_PROTOCOL_SET_FILTER) {
+
+        DebugPrint(("IoControl - Set filter\n"));
+
+        status = PacketSetFilter(open, Irp);
+
+        Irp->IoStatus.Status = status;
+        Irp->IoStatus.Information = 0;
+        IoCompleteRequest(Irp, IO_NO_INCREMENT);
+        IoDecrement(open);
+
+    } else if (functionCode == IOCTL_PROTOCOL_READ_FRAMES) {
+
+        DebugPrint(("IoControl - Read frames\n"));
+
+        //
+        // The request is completed by the receive handlers once it
+        // holds frames.
+        //
+
+        status = PacketReadFrames(open, Irp);
+
+        if (status != STATUS_PENDING) {
+
+            Irp->IoStatus.Status = status;
+            Irp->IoStatus.Information = 0;
+            IoCompleteRequest(Irp, IO_NO_INCREMENT);
+            IoDecrement(open);
+        }
+
+    } else if (functionCode == IOCTL_PROTOCOL_WRITE_FRAMES) {
+
+        DebugPrint(("IoControl - Write frames\n"));
+
+        //
+        // The request is completed by PacketSendComplete when the
+        // last of its frames has been sent.
+        //
+
+        status = PacketWriteFrames(open, Irp);
+
+        if (status != STATUS_PENDING) {
+
+            Irp->IoStatus.Status = status;
+            Irp->IoStatus.Information = 0;
+            IoCompleteRequest(Irp, IO_NO_INCREMENT);
+            IoDecrement(open);
+        }
+
+    } else if (functionCode == IOCTL_PROTOCOL_UNMAP_RING) {
+
+        DebugPrint(("IoControl - Unmap ring\n"));
+
+        PacketUnmapRing(open);
+
+        Irp->IoStatus.Status = STATUS_SUCCESS;
+        Irp->IoStatus.Information = 0;
+        IoCompleteRequest(Irp, IO_NO_INCREMENT);
+        IoDecrement(open);
+
     } else {
         //
         //  See if it is an Ndis request
@@ -888,6 +967,16 @@ Return Value:
             DebugPrint(("Packet: Failed to allocate packet pool\n"));
             break;
         }
+
+        //
+        //  And the descriptors for batched writes
+        //
+
+        status = PacketAllocateSendDescriptors(open);
+
+        if (status != NDIS_STATUS_SUCCESS) {
+            break;
+        }
         
         //
         //  Initializing the Event used for synchronizing open and close.
@@ -912,6 +1001,22 @@ Return Value:
         KeInitializeSpinLock(&open->RcvQSpinLock);
         InitializeListHead(&open->RcvList);
 
+        //
+        // Initialize the spinlock that guards the capture ring
+        //
+        KeInitializeSpinLock(&open->RingLock);
+
+        //
+        //  Initialize list for holding pending batch reads
+        //
+        KeInitializeSpinLock(&open->BatchLock);
+        InitializeListHead(&open->BatchList);
+
+        //
+        // Initialize the lock that guards the packet filter
+        //
+        NdisInitializeReadWriteLock(&open->FilterLock);
+
         //
         // Now open the adapter below and complete the initialization
         //
@@ -984,6 +1089,9 @@ Return Value:
         if (open && open->PacketPool != NULL) {
              NdisFreePacketPool(open->PacketPool);
         }
+        if (open) {
+             PacketFreeSendDescriptors(open);
+        }
         if (deviceObject != NULL) {
             IoDeleteDevice(deviceObject);
         }
@@ -1044,6 +1152,16 @@ Return Value:
         // 
 
         PacketCancelReadIrps(open->DeviceObject);
+
+        PacketCancelBatchReads(open);
+
+        //
+        // Stop ring capture and release the ring.
+        //
+
+        PacketUnmapRing(open);
+
+        PacketFreeFilter(open);
         
         //
         // Wait for all the outstanding IRPs to complete
@@ -1077,6 +1195,8 @@ Return Value:
         KeReleaseSpinLock(&Globals.GlobalLock, oldIrql);
         
         NdisFreePacketPool(open->PacketPool);
+
+        PacketFreeSendDescriptors(open);
         
         NdisFreeMemory(open->AdapterName.Buffer, open->AdapterName.Length, 0);
 
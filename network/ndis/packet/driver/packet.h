@@ -102,6 +102,49 @@ typedef struct _OPEN_INSTANCE {
 
     NDIS_EVENT          CleanupEvent;
 
+    //
+    // Shared capture ring (see ring.c). RingIrp is the pending
+    // IOCTL_PROTOCOL_MAP_RING request that keeps the ring memory locked.
+    // RingLock serializes the receive handlers that store frames in it
+    // and the mapping and unmapping of the ring.
+    //
+
+    KSPIN_LOCK          RingLock;
+    PIRP                RingIrp;
+    PPACKET_RING_HEADER RingHeader;
+    PUCHAR              RingData;
+    PKEVENT             RingEvent;
+    ULONG               RingSize;
+    ULONG               RingHead;       // private copy, never read back
+    ULONG               RingSnapLength;
+    ULONG               RingWakeupFrames;
+    ULONG               RingPending;    // frames stored since the last wakeup
+    ULONG               RingFrames;
+    ULONG               RingDrops;
+
+    //
+    // Packet filter attached with IOCTL_PROTOCOL_SET_FILTER (see
+    // filter.c). The receive handlers run it under a read lock.
+    //
+
+    NDIS_RW_LOCK        FilterLock;
+    PPACKET_FILTER_PROGRAM Filter;
+
+    //
+    // Batched reads and writes (see batch.c). BatchList holds the
+    // pending IOCTL_PROTOCOL_READ_FRAMES requests; the receive handlers
+    // fill the one at its head. The descriptors of SendPool are used by
+    // IOCTL_PROTOCOL_WRITE_FRAMES. Each is allocated at bind time with
+    // an MDL for one frame, and waits on SendFreeList between sends.
+    //
+
+    KSPIN_LOCK          BatchLock;
+    LIST_ENTRY          BatchList;
+
+    NDIS_HANDLE         SendPool;
+    KSPIN_LOCK          SendLock;
+    LIST_ENTRY          SendFreeList;
+
     //
     // List entry to link to the other deviceobjects.
     //
@@ -129,6 +172,10 @@ typedef struct _PACKET_RESERVED {
 
 #define  TRANSMIT_PACKETS    16
 
+#define  SEND_DESCRIPTORS    256    // per open, for IOCTL_PROTOCOL_WRITE_FRAMES
+#define  SEND_ARRAY_SIZE     32     // packets per NdisSendPackets call
+#define  SEND_MDL_PAGES      2      // pages a frame may span
+
 
 NTSTATUS
 DriverEntry(
@@ -308,6 +355,161 @@ PacketPNPHandler(
     );
 
 
+NTSTATUS
+PacketMapRing(
+    IN POPEN_INSTANCE   Open,
+    IN PIRP             Irp
+    );
+
+VOID
+PacketUnmapRing(
+    IN POPEN_INSTANCE   Open
+    );
+
+VOID
+PacketRingCancelRoutine (
+    IN PDEVICE_OBJECT   DeviceObject,
+    IN PIRP             Irp
+    );
+
+VOID
+PacketRingIndicate(
+    IN POPEN_INSTANCE   Open,
+    IN NDIS_HANDLE      MacReceiveContext,
+    IN PVOID            HeaderBuffer,
+    IN UINT             HeaderBufferSize,
+    IN PVOID            LookAheadBuffer,
+    IN UINT             LookaheadBufferSize,
+    IN UINT             PacketSize,
+    IN ULONG            CaptureLimit
+    );
+
+VOID
+PacketRingReceivePacket(
+    IN POPEN_INSTANCE   Open,
+    IN PNDIS_PACKET     Packet,
+    IN ULONG            CaptureLimit
+    );
+
+VOID
+PacketRingReceiveComplete(
+    IN POPEN_INSTANCE   Open
+    );
+
+BOOLEAN
+PacketFilterValidate(
+    IN PPACKET_FILTER_INSN  Program,
+    IN ULONG                Count
+    );
+
+ULONG
+PacketFilterRun(
+    IN PPACKET_FILTER_INSN  Program,
+    IN PUCHAR               Header,
+    IN ULONG                HeaderLength,
+    IN PUCHAR               Data,
+    IN ULONG                DataLength,
+    IN ULONG                PacketLength
+    );
+
+ULONG
+PacketFilterIndicate(
+    IN POPEN_INSTANCE   Open,
+    IN PVOID            HeaderBuffer,
+    IN UINT             HeaderBufferSize,
+    IN PVOID            LookAheadBuffer,
+    IN UINT             LookaheadBufferSize,
+    IN UINT             PacketSize
+    );
+
+ULONG
+PacketFilterPacket(
+    IN POPEN_INSTANCE   Open,
+    IN PNDIS_PACKET     Packet
+    );
+
+NTSTATUS
+PacketSetFilter(
+    IN POPEN_INSTANCE   Open,
+    IN PIRP             Irp
+    );
+
+VOID
+PacketFreeFilter(
+    IN POPEN_INSTANCE   Open
+    );
+
+NTSTATUS
+PacketReadFrames(
+    IN POPEN_INSTANCE   Open,
+    IN PIRP             Irp
+    );
+
+VOID
+PacketBatchCancelRoutine (
+    IN PDEVICE_OBJECT   DeviceObject,
+    IN PIRP             Irp
+    );
+
+VOID
+PacketCancelBatchReads(
+    IN POPEN_INSTANCE   Open
+    );
+
+VOID
+PacketBatchIndicate(
+    IN POPEN_INSTANCE   Open,
+    IN NDIS_HANDLE      MacReceiveContext,
+    IN PVOID            HeaderBuffer,
+    IN UINT             HeaderBufferSize,
+    IN PVOID            LookAheadBuffer,
+    IN UINT             LookaheadBufferSize,
+    IN UINT             PacketSize,
+    IN ULONG            CaptureLimit
+    );
+
+VOID
+PacketBatchReceivePacket(
+    IN POPEN_INSTANCE   Open,
+    IN PNDIS_PACKET     Packet,
+    IN ULONG            CaptureLimit
+    );
+
+VOID
+PacketBatchReceiveComplete(
+    IN POPEN_INSTANCE   Open
+    );
+
+NTSTATUS
+PacketWriteFrames(
+    IN POPEN_INSTANCE   Open,
+    IN PIRP             Irp
+    );
+
+VOID
+PacketWriteFramesComplete(
+    IN POPEN_INSTANCE   Open,
+    IN PNDIS_PACKET     Packet,
+    IN NDIS_STATUS      Status
+    );
+
+NDIS_STATUS
+PacketAllocateSendDescriptors(
+    IN POPEN_INSTANCE   Open
+    );
+
+VOID
+PacketFreeSendDescriptors(
+    IN POPEN_INSTANCE   Open
+    );
+
+ULONG
+PacketCopyBuffers(
+    OUT PUCHAR          Destination,
+    IN PNDIS_BUFFER     Buffer,
+    IN ULONG            Length
+    );
+
 VOID
 IoIncrement (
     IN  OUT POPEN_INSTANCE  Open
@@ -31,6 +31,7 @@ Revision History:
 
 #include "ntddk.h"
 #include "ndis.h"
+#include "ntddpack.h"
 #include "packet.h"
 
 
@@ -191,6 +192,7 @@ Return Value:
     ULONG               bufferLength;
     PPACKET_RESERVED    reserved;
     PMDL                pMdl;
+    ULONG               captureLength;
 
     DebugPrint(("ReceiveIndicate\n"));
 
@@ -201,6 +203,59 @@ Return Value:
         return NDIS_STATUS_SUCCESS;
     }
 
+    //
+    // Run the filter on the lookahead data, before we look for a
+    // read or transfer anything.
+    //
+    captureLength = PacketFilterIndicate(
+                        open,
+                        HeaderBuffer,
+                        HeaderBufferSize,
+                        LookAheadBuffer,
+                        LookaheadBufferSize,
+                        PacketSize
+                        );
+
+    if (captureLength == 0) {
+        return NDIS_STATUS_NOT_ACCEPTED;
+    }
+
+    //
+    // While a ring is mapped, frames go to the ring and not to reads.
+    //
+    if (open->RingIrp != NULL) {
+
+        PacketRingIndicate(
+            open,
+            MacReceiveContext,
+            HeaderBuffer,
+            HeaderBufferSize,
+            LookAheadBuffer,
+            LookaheadBufferSize,
+            PacketSize,
+            captureLength
+            );
+        return NDIS_STATUS_SUCCESS;
+    }
+
+    //
+    // Batch reads take frames before single reads do.
+    //
+    if (!IsListEmpty(&open->BatchList)) {
+
+        PacketBatchIndicate(
+            open,
+            MacReceiveContext,
+            HeaderBuffer,
+            HeaderBufferSize,
+            LookAheadBuffer,
+            LookaheadBufferSize,
+            PacketSize,
+            captureLength
+            );
+        return NDIS_STATUS_SUCCESS;
+    }
+
     //
     //  See if there are any pending read that we can satisfy
     //
@@ -236,11 +291,15 @@ Return Value:
     bufferLength=irpSp->Parameters.Read.Length-ETHERNET_HEADER_LENGTH;
 
     //
-    //  Find out how much to transfer
+    //  Find out how much to transfer, no more than the filter keeps
     //
     sizeToTransfer = (PacketSize < bufferLength) ?
                        PacketSize : bufferLength;
 
+    if (sizeToTransfer > captureLength - HeaderBufferSize) {
+        sizeToTransfer = captureLength - HeaderBufferSize;
+    }
+
     //
     //  copy the ethernet header into the actual readbuffer
     //
@@ -412,6 +471,8 @@ Routine Description:
     This is a required function. PacketReceiveComplete 
     is called to indicate that any received packets previously 
     indicated to PacketReceivePacket can now be postprocessed. 
+    This is where the application is woken up for the frames
+    stored in its ring or in a batch read during the batch.
     
 Arguments:
 
@@ -421,6 +482,20 @@ Return Value:
 
 --*/
 {
+    POPEN_INSTANCE      open;
+
+    open= (POPEN_INSTANCE)ProtocolBindingContext;
+
+    if (open->RingIrp != NULL) {
+
+        PacketRingReceiveComplete(open);
+    }
+
+    if (!IsListEmpty(&open->BatchList)) {
+
+        PacketBatchReceiveComplete(open);
+    }
+
     return;
 }
 
@@ -462,11 +537,30 @@ Return Value:
     PIO_STACK_LOCATION  irpSp;
     PMDL                mdl;
     NTSTATUS            status = STATUS_SUCCESS;
+    ULONG               captureLength;
 
     DebugPrint(("PacketReceivePacket\n"));
 
     open= (POPEN_INSTANCE)ProtocolBindingContext;
 
+    captureLength = PacketFilterPacket(open, Packet);
+
+    if (captureLength == 0) {
+        return 0;
+    }
+
+    if (open->RingIrp != NULL) {
+
+        PacketRingReceivePacket(open, Packet, captureLength);
+        return 0;
+    }
+
+    if (!IsListEmpty(&open->BatchList)) {
+
+        PacketBatchReceivePacket(open, Packet, captureLength);
+        return 0;
+    }
+
     //
     //  See if there are any pending read that we can satisfy
     //
@@ -540,6 +634,10 @@ Return Value:
 
     bufferLength=irpSp->Parameters.Read.Length;
 
+    if (bufferLength > captureLength) {
+        bufferLength = captureLength;
+    }
+
     NdisCopyFromPacketToPacket(myPacket, 0, bufferLength, Packet, 0, 
                                                &bytesTransfered);    
 
@@ -560,6 +658,62 @@ CleanExit:
 }
 
 
+ULONG
+PacketCopyBuffers(
+    OUT PUCHAR          Destination,
+    IN PNDIS_BUFFER     Buffer,
+    IN ULONG            Length
+    )
+/*++
+
+Routine Description:
+
+    Copies the start of a received frame out of its chain of buffers,
+    for the ring and the batch reads. If a buffer can't be mapped
+    because the system is low on resources, the copy stops there.
+
+Arguments:
+
+    Destination - where to copy to.
+
+    Buffer - first buffer of the packet.
+
+    Length - number of bytes to copy.
+
+Return Value:
+
+    The number of bytes copied.
+
+--*/
+{
+    PNDIS_BUFFER        nextBuffer;
+    PVOID               virtualAddress;
+    UINT                bufferLength;
+    ULONG               copied;
+
+    for (copied = 0; Buffer != NULL && copied < Length; ) {
+
+        NdisQueryBufferSafe(Buffer, &virtualAddress,
+                                &bufferLength, NormalPagePriority);
+        if (!virtualAddress) {
+            break;
+        }
+
+        if (bufferLength > Length - copied) {
+            bufferLength = Length - copied;
+        }
+
+        NdisMoveMappedMemory(Destination + copied, virtualAddress, bufferLength);
+        copied += bufferLength;
+
+        NdisGetNextBuffer(Buffer, &nextBuffer);
+        Buffer = nextBuffer;
+    }
+
+    return copied;
+}
+
+
 VOID
 PacketCancelRoutine (
     IN PDEVICE_OBJECT   DeviceObject,
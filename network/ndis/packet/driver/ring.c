@@ -0,0 +1,649 @@
+/*++
+
+Copyright (c) 1990-2000 Microsoft Corporation
+
+Module Name:
+
+    Ring.c
+
+Abstract:
+
+    Shared memory ring capture. Instead of completing one read IRP
+    per frame, the receive handlers store timestamped frames in a
+    ring that the application has mapped with IOCTL_PROTOCOL_MAP_RING,
+    and signal the application's event once per batch of frames.
+
+Author:
+
+
+Environment:
+
+    Kernel mode only.
+
+Notes:
+
+    The ring memory is described by the MDL of the pending map
+    request, so it stays locked exactly as long as that IRP is
+    outstanding. The driver keeps its own copy of the producer
+    offset and never trusts the values in the shared header for
+    addressing; a bad Tail from the application can only make the
+    ring look full.
+
+Future:
+
+
+
+Revision History:
+
+--*/
+
+#include "ntddk.h"
+#include "ndis.h"
+#include "ntddpack.h"
+#include "packet.h"
+
+
+static
+PUCHAR
+PacketRingReserve(
+    IN POPEN_INSTANCE   Open,
+    IN ULONG            CaptureLength,
+    IN ULONG            PacketLength
+    )
+/*++
+
+Routine Description:
+
+    Reserves room for the next frame in the ring and fills in its
+    record header. Called with the RingLock held and a ring mapped.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    CaptureLength - number of frame bytes that will be stored.
+
+    PacketLength - length of the frame on the wire.
+
+Return Value:
+
+    Address the CaptureLength bytes of frame data must be copied to,
+    or NULL if the ring is full. PacketRingCommit publishes the frame.
+
+--*/
+{
+    PPACKET_RING_FRAME  frame;
+    ULONG               recordLength;
+    ULONG               used;
+    ULONG               offset;
+    ULONG               contiguous;
+    ULONG               needed;
+
+    recordLength = PACKET_RING_ALIGN(sizeof(PACKET_RING_FRAME) + CaptureLength);
+
+    used = Open->RingHead - Open->RingHeader->Tail;
+    offset = Open->RingHead & (Open->RingSize - 1);
+    contiguous = Open->RingSize - offset;
+
+    //
+    // A record never wraps: if it doesn't fit before the end of the
+    // ring, the rest of the ring is filled with a pad record.
+    //
+
+    needed = recordLength;
+    if (contiguous < recordLength) {
+        needed += contiguous;
+    }
+
+    if (used > Open->RingSize || Open->RingSize - used < needed) {
+
+        Open->RingDrops++;
+        Open->RingHeader->Drops = Open->RingDrops;
+        return NULL;
+    }
+
+    if (contiguous < recordLength) {
+
+        frame = (PPACKET_RING_FRAME)(Open->RingData + offset);
+        frame->RecordLength = contiguous;
+        frame->CaptureLength = 0;
+        frame->PacketLength = 0;
+
+        Open->RingHead += contiguous;
+        offset = 0;
+    }
+
+    frame = (PPACKET_RING_FRAME)(Open->RingData + offset);
+    frame->RecordLength = recordLength;
+    frame->CaptureLength = CaptureLength;
+    frame->PacketLength = PacketLength;
+    KeQuerySystemTime(&frame->TimeStamp);
+
+    Open->RingHead += recordLength;
+
+    return (PUCHAR)(frame + 1);
+}
+
+
+static
+VOID
+PacketRingWakeup(
+    IN POPEN_INSTANCE   Open
+    )
+/*++
+
+Routine Description:
+
+    Signals the application if it is waiting for frames. Called with
+    the RingLock held and a ring mapped. An application that keeps up
+    with the ring never sets Waiting and so is never signalled.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+Return Value:
+
+--*/
+{
+    Open->RingPending = 0;
+
+    if (Open->RingHeader->Waiting) {
+
+        Open->RingHeader->Waiting = 0;
+        Open->RingHeader->Wakeups++;
+        KeSetEvent(Open->RingEvent, IO_NO_INCREMENT, FALSE);
+    }
+}
+
+
+static
+VOID
+PacketRingCommit(
+    IN POPEN_INSTANCE   Open
+    )
+/*++
+
+Routine Description:
+
+    Publishes the frame reserved last to the application. Called
+    with the RingLock held and a ring mapped.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+Return Value:
+
+--*/
+{
+    Open->RingFrames++;
+    Open->RingHeader->Frames = Open->RingFrames;
+
+    //
+    // The interlocked operation orders the frame data before the new
+    // Head, and the new Head before the read of Waiting in the wakeup.
+    //
+
+    InterlockedExchange((PLONG)&Open->RingHeader->Head, Open->RingHead);
+
+    Open->RingPending++;
+
+    if (Open->RingWakeupFrames != 0
+        && Open->RingPending >= Open->RingWakeupFrames) {
+
+        PacketRingWakeup(Open);
+    }
+}
+
+
+static
+PIRP
+PacketRingDetach(
+    IN POPEN_INSTANCE   Open,
+    OUT PKEVENT         *Event
+    )
+/*++
+
+Routine Description:
+
+    Disconnects the ring from the receive path. Called with the
+    RingLock held.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    Event - receives the application's event, which the caller must
+            dereference once the lock is released.
+
+Return Value:
+
+    The map request that described the ring. The caller completes it.
+
+--*/
+{
+    PIRP                irp;
+
+    irp = Open->RingIrp;
+    *Event = Open->RingEvent;
+
+    Open->RingIrp = NULL;
+    Open->RingHeader = NULL;
+    Open->RingData = NULL;
+    Open->RingEvent = NULL;
+
+    return irp;
+}
+
+
+NTSTATUS
+PacketMapRing(
+    IN POPEN_INSTANCE   Open,
+    IN PIRP             Irp
+    )
+/*++
+
+Routine Description:
+
+    Handles IOCTL_PROTOCOL_MAP_RING. Maps the output buffer of the
+    request as a capture ring and leaves the request pending.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    Irp - the map request.
+
+Return Value:
+
+    STATUS_PENDING if the ring is now in use, otherwise the status
+    the caller must complete the request with.
+
+--*/
+{
+    PIO_STACK_LOCATION  irpSp;
+    PPACKET_RING_SETUP  setup;
+    PPACKET_RING_HEADER header;
+    PKEVENT             event;
+    NTSTATUS            status;
+    KIRQL               oldIrql;
+    ULONG               length;
+    ULONG               size;
+
+    irpSp = IoGetCurrentIrpStackLocation(Irp);
+    setup = Irp->AssociatedIrp.SystemBuffer;
+    length = irpSp->Parameters.DeviceIoControl.OutputBufferLength;
+
+    if (irpSp->Parameters.DeviceIoControl.InputBufferLength
+                        < sizeof(PACKET_RING_SETUP)) {
+
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (Irp->MdlAddress == NULL
+        || length < sizeof(PACKET_RING_HEADER) + PACKET_RING_MIN_SIZE) {
+
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    header = MmGetSystemAddressForMdlSafe(Irp->MdlAddress, NormalPagePriority);
+    if (header == NULL) {
+
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    //
+    // Use the largest power of two that fits after the header, so
+    // the free running Head and Tail wrap with the ring.
+    //
+
+    length -= sizeof(PACKET_RING_HEADER);
+    for (size = PACKET_RING_MIN_SIZE; size <= length / 2; size *= 2)
+        ;
+
+    status = ObReferenceObjectByHandle(
+                    setup->Event,
+                    EVENT_MODIFY_STATE,
+                    *ExEventObjectType,
+                    Irp->RequestorMode,
+                    (PVOID *)&event,
+                    NULL
+                    );
+
+    if (!NT_SUCCESS(status)) {
+
+        return status;
+    }
+
+    RtlZeroMemory(header, sizeof(PACKET_RING_HEADER));
+    header->Size = size;
+    header->DataOffset = sizeof(PACKET_RING_HEADER);
+    header->SnapLength = setup->SnapLength;
+
+    KeAcquireSpinLock(&Open->RingLock, &oldIrql);
+
+    if (Open->RingIrp != NULL) {
+
+        KeReleaseSpinLock(&Open->RingLock, oldIrql);
+        ObDereferenceObject(event);
+        return STATUS_DEVICE_BUSY;
+    }
+
+    IoSetCancelRoutine(Irp, PacketRingCancelRoutine);
+
+    if (Irp->Cancel && IoSetCancelRoutine(Irp, NULL) != NULL) {
+
+        KeReleaseSpinLock(&Open->RingLock, oldIrql);
+        ObDereferenceObject(event);
+        return STATUS_CANCELLED;
+    }
+
+    Open->RingHeader = header;
+    Open->RingData = (PUCHAR)header + sizeof(PACKET_RING_HEADER);
+    Open->RingEvent = event;
+    Open->RingSize = size;
+    Open->RingHead = 0;
+    Open->RingSnapLength = setup->SnapLength;
+    Open->RingWakeupFrames = setup->WakeupFrames;
+    Open->RingPending = 0;
+    Open->RingFrames = 0;
+    Open->RingDrops = 0;
+    Open->RingIrp = Irp;
+
+    KeReleaseSpinLock(&Open->RingLock, oldIrql);
+
+    DebugPrint(("Mapped a ring of %d bytes\n", size));
+
+    return STATUS_PENDING;
+}
+
+
+VOID
+PacketUnmapRing(
+    IN POPEN_INSTANCE   Open
+    )
+/*++
+
+Routine Description:
+
+    Stops ring capture and completes the map request, which unlocks
+    the ring memory. Called for IOCTL_PROTOCOL_UNMAP_RING, on cleanup
+    and on unbind.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+Return Value:
+
+--*/
+{
+    PIRP                irp = NULL;
+    PKEVENT             event = NULL;
+    KIRQL               oldIrql;
+
+    KeAcquireSpinLock(&Open->RingLock, &oldIrql);
+
+    //
+    // If the cancel routine has already been claimed it is about to
+    // run and will detach the ring itself.
+    //
+
+    if (Open->RingIrp != NULL
+        && IoSetCancelRoutine(Open->RingIrp, NULL) != NULL) {
+
+        irp = PacketRingDetach(Open, &event);
+    }
+
+    KeReleaseSpinLock(&Open->RingLock, oldIrql);
+
+    if (irp) {
+
+        ObDereferenceObject(event);
+
+        irp->IoStatus.Status = STATUS_SUCCESS;
+        irp->IoStatus.Information = 0;
+        IoCompleteRequest(irp, IO_NO_INCREMENT);
+        IoDecrement(Open);
+    }
+}
+
+
+VOID
+PacketRingCancelRoutine (
+    IN PDEVICE_OBJECT   DeviceObject,
+    IN PIRP             Irp
+    )
+/*++
+
+Routine Description:
+
+    Cancel routine of the pending map request. The cancel spin lock
+    is already acquired when this routine is called.
+
+Arguments:
+
+    DeviceObject - pointer to the device object.
+
+    Irp - pointer to the IRP to be cancelled.
+
+Return Value:
+
+--*/
+{
+    POPEN_INSTANCE      open = DeviceObject->DeviceExtension;
+    PIRP                irpToComplete = NULL;
+    PKEVENT             event = NULL;
+    KIRQL               oldIrql;
+
+    DebugPrint(("PacketRingCancelRoutine\n"));
+
+    oldIrql = Irp->CancelIrql;
+
+    KeAcquireSpinLockAtDpcLevel(&open->RingLock);
+
+    IoReleaseCancelSpinLock( KeGetCurrentIrql() );
+
+    if (open->RingIrp == Irp) {
+
+        irpToComplete = PacketRingDetach(open, &event);
+    }
+
+    KeReleaseSpinLock(&open->RingLock, oldIrql);
+
+    if (irpToComplete) {
+
+        ObDereferenceObject(event);
+
+        irpToComplete->IoStatus.Status = STATUS_CANCELLED;
+        irpToComplete->IoStatus.Information = 0;
+        IoCompleteRequest(irpToComplete, IO_NO_INCREMENT);
+        IoDecrement(open);
+    }
+}
+
+
+VOID
+PacketRingIndicate(
+    IN POPEN_INSTANCE   Open,
+    IN NDIS_HANDLE      MacReceiveContext,
+    IN PVOID            HeaderBuffer,
+    IN UINT             HeaderBufferSize,
+    IN PVOID            LookAheadBuffer,
+    IN UINT             LookaheadBufferSize,
+    IN UINT             PacketSize,
+    IN ULONG            CaptureLimit
+    )
+/*++
+
+Routine Description:
+
+    Stores a frame indicated to PacketReceiveIndicate in the ring.
+    If the lookahead doesn't hold the whole frame but the miniport
+    indicated a packet descriptor, the frame is copied from the
+    packet instead, so no NdisTransferData is needed. Otherwise the
+    stored frame is cut at the end of the lookahead data.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    HeaderBuffer ... PacketSize - as passed to PacketReceiveIndicate.
+
+    CaptureLimit - bytes of the frame to keep, as the filter decided.
+
+Return Value:
+
+--*/
+{
+    PNDIS_PACKET        packet;
+    PUCHAR              data;
+    ULONG               captureLength;
+    KIRQL               oldIrql;
+
+    if (LookaheadBufferSize < PacketSize) {
+
+        packet = NdisGetReceivedPacket(Open->AdapterHandle, MacReceiveContext);
+        if (packet != NULL) {
+
+            PacketRingReceivePacket(Open, packet, CaptureLimit);
+            return;
+        }
+    }
+
+    captureLength = HeaderBufferSize + LookaheadBufferSize;
+    if (captureLength > CaptureLimit) {
+        captureLength = CaptureLimit;
+    }
+
+    KeAcquireSpinLock(&Open->RingLock, &oldIrql);
+
+    if (Open->RingHeader != NULL) {
+
+        if (Open->RingSnapLength != 0 && captureLength > Open->RingSnapLength) {
+            captureLength = Open->RingSnapLength;
+        }
+
+        data = PacketRingReserve(Open, captureLength, HeaderBufferSize + PacketSize);
+        if (data != NULL) {
+
+            if (captureLength <= HeaderBufferSize) {
+
+                NdisMoveMappedMemory(data, HeaderBuffer, captureLength);
+            } else {
+
+                NdisMoveMappedMemory(data, HeaderBuffer, HeaderBufferSize);
+                NdisMoveMappedMemory(
+                    data + HeaderBufferSize,
+                    LookAheadBuffer,
+                    captureLength - HeaderBufferSize
+                    );
+            }
+
+            PacketRingCommit(Open);
+        }
+    }
+
+    KeReleaseSpinLock(&Open->RingLock, oldIrql);
+}
+
+
+VOID
+PacketRingReceivePacket(
+    IN POPEN_INSTANCE   Open,
+    IN PNDIS_PACKET     Packet,
+    IN ULONG            CaptureLimit
+    )
+/*++
+
+Routine Description:
+
+    Stores a frame indicated to PacketReceivePacket in the ring.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+    Packet - pointer to the packet.
+
+    CaptureLimit - bytes of the frame to keep, as the filter decided.
+
+Return Value:
+
+--*/
+{
+    PNDIS_BUFFER        buffer;
+    UINT                packetLength;
+    ULONG               captureLength;
+    PUCHAR              data;
+    KIRQL               oldIrql;
+
+    NdisQueryPacket(Packet, NULL, NULL, &buffer, &packetLength);
+
+    captureLength = packetLength;
+    if (captureLength > CaptureLimit) {
+        captureLength = CaptureLimit;
+    }
+
+    KeAcquireSpinLock(&Open->RingLock, &oldIrql);
+
+    if (Open->RingHeader != NULL) {
+
+        if (Open->RingSnapLength != 0 && captureLength > Open->RingSnapLength) {
+            captureLength = Open->RingSnapLength;
+        }
+
+        data = PacketRingReserve(Open, captureLength, packetLength);
+        if (data != NULL) {
+
+            //
+            // If a buffer of the packet can't be mapped, the frame is
+            // stored with what was copied so far.
+            //
+
+            ((PPACKET_RING_FRAME)data - 1)->CaptureLength =
+                    PacketCopyBuffers(data, buffer, captureLength);
+
+            PacketRingCommit(Open);
+        }
+    }
+
+    KeReleaseSpinLock(&Open->RingLock, oldIrql);
+}
+
+
+VOID
+PacketRingReceiveComplete(
+    IN POPEN_INSTANCE   Open
+    )
+/*++
+
+Routine Description:
+
+    Called at the end of each receive indication batch. Wakes the
+    application for the frames stored since the last wakeup.
+
+Arguments:
+
+    Open - pointer to the device extension.
+
+Return Value:
+
+--*/
+{
+    KIRQL               oldIrql;
+
+    if (Open->RingPending == 0) {
+        return;
+    }
+
+    KeAcquireSpinLock(&Open->RingLock, &oldIrql);
+
+    if (Open->RingHeader != NULL && Open->RingPending != 0) {
+
+        PacketRingWakeup(Open);
+    }
+
+    KeReleaseSpinLock(&Open->RingLock, oldIrql);
+}
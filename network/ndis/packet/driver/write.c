@@ -31,6 +31,7 @@ Revision History:
 
 #include "ntddk.h"
 #include "ndis.h"
+#include "ntddpack.h"
 #include "packet.h"
 
 
@@ -106,6 +107,7 @@ Return Value:
     }
 
     RESERVED(pPacket)->Irp=Irp;
+    RESERVED(pPacket)->pMdl=NULL;
 
     //
     //  Attach the writes buffer to the packet
@@ -171,6 +173,19 @@ Return Value:
 
     DebugPrint(("Packet: SendComplete :%x\n", Status));
 
+    //
+    //  Only the descriptors of IOCTL_PROTOCOL_WRITE_FRAMES carry an MDL
+    //
+    if (RESERVED(pPacket)->pMdl != NULL) {
+
+        PacketWriteFramesComplete(
+            (POPEN_INSTANCE)ProtocolBindingContext,
+            pPacket,
+            Status
+            );
+        return;
+    }
+
     irp=RESERVED(pPacket)->Irp;
     irpSp = IoGetCurrentIrpStackLocation(irp);
 
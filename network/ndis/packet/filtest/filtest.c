@@ -0,0 +1,405 @@
+/*++
+
+Copyright (c) 1990-2000  Microsoft Corporation
+
+Module Name:
+
+    filtest.c
+
+Abstract:
+
+    User mode harness for the packet filter of the Packet driver.
+    Runs a filter program against the frames of a libpcap file
+    with the driver's own validator and interpreter (..\driver\filter.c)
+    and reports how many frames it keeps, how many bytes the driver
+    would copy, and what running it costs per frame.
+
+    Each frame is filtered twice: once whole, and once split into
+    the ethernet header and a lookahead buffer of -l bytes, the way
+    PacketReceiveIndicate sees it. A program that decides differently
+    on the two reads past the lookahead; raise the lookahead of the
+    adapter with OID_GEN_CURRENT_LOOKAHEAD for it.
+
+    The program is read as printed by "tcpdump -dd", one
+    { code, jt, jf, k } instruction per line. filtest exits with 1
+    if the driver would reject the program or if any frame is
+    decided differently with the lookahead, so it can be scripted.
+
+Author:
+
+
+Environment:
+
+    User mode.
+
+Revision History:
+
+--*/
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ntddpack.h>
+
+#define PACKET_FILTER_HARNESS 1
+#include "..\driver\filter.c"
+
+
+#define ETHERNET_HEADER_LENGTH      14
+
+#define DEFAULT_LOOKAHEAD           128
+#define DEFAULT_PASSES              10
+#define MAX_FRAMES                  (1 << 20)
+
+
+typedef struct _FRAME {
+    PUCHAR      Data;
+    ULONG       CaptureLength;      // bytes in the file
+    ULONG       PacketLength;       // bytes on the wire
+    } FRAME, *PFRAME;
+
+
+PACKET_FILTER_INSN  Program[PACKET_FILTER_MAX_INSNS];
+ULONG               ProgramLength;
+
+PFRAME              Frames;
+ULONG               FrameCount;
+
+
+BOOL
+LoadProgram(
+    char   *FileName
+    )
+/*++
+
+Routine Description:
+
+    Reads a filter program in the format of "tcpdump -dd".
+
+Arguments:
+
+    FileName - the file to read.
+
+Return Value:
+
+    TRUE if the file held a program.
+
+--*/
+{
+    FILE       *file;
+    char        line[256];
+    char       *p;
+    unsigned    code, jt, jf, k;
+
+    file = fopen(FileName, "r");
+    if (file == NULL) {
+        printf("filtest: cannot open %s\n", FileName);
+        return FALSE;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+
+        for (p = line; *p == ' ' || *p == '\t' || *p == '{'; p++)
+            ;
+
+        if (*p == '\0' || *p == '\n' || *p == '#') {
+            continue;
+        }
+
+        if (sscanf(p, "%i , %i , %i , %i", &code, &jt, &jf, &k) != 4) {
+            printf("filtest: bad instruction: %s", line);
+            fclose(file);
+            return FALSE;
+        }
+
+        if (ProgramLength == PACKET_FILTER_MAX_INSNS) {
+            printf("filtest: program longer than %d instructions\n",
+                        PACKET_FILTER_MAX_INSNS);
+            fclose(file);
+            return FALSE;
+        }
+
+        Program[ProgramLength].Code = (USHORT)code;
+        Program[ProgramLength].JumpTrue = (UCHAR)jt;
+        Program[ProgramLength].JumpFalse = (UCHAR)jf;
+        Program[ProgramLength].K = k;
+        ProgramLength++;
+    }
+
+    fclose(file);
+
+    return ProgramLength != 0;
+}
+
+
+ULONG
+SwapULong(
+    ULONG   Value,
+    BOOL    Swap
+    )
+{
+    if (!Swap) {
+        return Value;
+    }
+
+    return (Value >> 24) | ((Value >> 8) & 0xFF00) |
+           ((Value << 8) & 0xFF0000) | (Value << 24);
+}
+
+
+BOOL
+LoadTrace(
+    char   *FileName
+    )
+/*++
+
+Routine Description:
+
+    Reads the frames of a libpcap file with ethernet framing.
+
+Arguments:
+
+    FileName - the file to read.
+
+Return Value:
+
+    TRUE if the file held at least one frame.
+
+--*/
+{
+    FILE       *file;
+    ULONG       globalHeader[6];    // magic ... link type
+    ULONG       recordHeader[4];    // seconds, fraction, captured, length
+    PFRAME      frame;
+    BOOL        swap;
+
+    file = fopen(FileName, "rb");
+    if (file == NULL) {
+        printf("filtest: cannot open %s\n", FileName);
+        return FALSE;
+    }
+
+    if (fread(globalHeader, sizeof(globalHeader), 1, file) != 1) {
+        globalHeader[0] = 0;
+    }
+
+    swap = (globalHeader[0] == 0xD4C3B2A1 || globalHeader[0] == 0x4D3CB2A1);
+
+    if ((!swap && globalHeader[0] != 0xA1B2C3D4 && globalHeader[0] != 0xA1B23C4D)
+        || SwapULong(globalHeader[5], swap) != 1) {
+
+        printf("filtest: %s is not an ethernet libpcap file\n", FileName);
+        fclose(file);
+        return FALSE;
+    }
+
+    Frames = malloc(MAX_FRAMES * sizeof(FRAME));
+    if (Frames == NULL) {
+        fclose(file);
+        return FALSE;
+    }
+
+    while (FrameCount < MAX_FRAMES
+           && fread(recordHeader, sizeof(recordHeader), 1, file) == 1) {
+
+        frame = &Frames[FrameCount];
+        frame->CaptureLength = SwapULong(recordHeader[2], swap);
+        frame->PacketLength = SwapULong(recordHeader[3], swap);
+
+        if (frame->CaptureLength > 0x10000
+            || (frame->Data = malloc(frame->CaptureLength + 1)) == NULL
+            || fread(frame->Data, 1, frame->CaptureLength, file)
+                    != frame->CaptureLength) {
+            break;
+        }
+
+        FrameCount++;
+    }
+
+    fclose(file);
+
+    printf("%s: %lu frames\n", FileName, FrameCount);
+
+    return FrameCount != 0;
+}
+
+
+ULONG
+FilterSplit(
+    PFRAME  Frame,
+    ULONG   Lookahead
+    )
+/*++
+
+Routine Description:
+
+    Runs the program on a frame as PacketReceiveIndicate would: the
+    ethernet header and at most Lookahead bytes of data, in separate
+    buffers.
+
+Arguments:
+
+    Frame - the frame.
+
+    Lookahead - size of the lookahead buffer.
+
+Return Value:
+
+    What the program returned.
+
+--*/
+{
+    ULONG   header;
+    ULONG   data;
+
+    header = Frame->CaptureLength < ETHERNET_HEADER_LENGTH
+                ? Frame->CaptureLength : ETHERNET_HEADER_LENGTH;
+
+    data = Frame->CaptureLength - header;
+    if (data > Lookahead) {
+        data = Lookahead;
+    }
+
+    return PacketFilterRun(
+                Program,
+                Frame->Data,
+                header,
+                Frame->Data + header,
+                data,
+                Frame->PacketLength
+                );
+}
+
+
+int
+__cdecl
+main(
+    int     argc,
+    char   *argv[]
+    )
+{
+    char           *programFile = NULL;
+    char           *traceFile = NULL;
+    ULONG           lookahead = DEFAULT_LOOKAHEAD;
+    ULONG           snapLength = 0;
+    ULONG           passes = DEFAULT_PASSES;
+    ULONG           kept = 0, keptSplit = 0, different = 0;
+    double          bytesKept = 0, bytesWire = 0;
+    LARGE_INTEGER   frequency, start, stop;
+    ULONG           result, split;
+    ULONG           i, pass;
+    volatile ULONG  sink = 0;
+    int             arg;
+
+    for (arg = 1; arg < argc; arg++) {
+
+        if (argv[arg][0] == '-' && argv[arg][1] != '\0') {
+
+            switch (argv[arg][1]) {
+            case 'l': lookahead = strtoul(argv[arg] + 2, NULL, 0); continue;
+            case 's': snapLength = strtoul(argv[arg] + 2, NULL, 0); continue;
+            case 'n': passes = strtoul(argv[arg] + 2, NULL, 0); continue;
+            }
+
+        } else if (programFile == NULL) {
+
+            programFile = argv[arg];
+            continue;
+
+        } else if (traceFile == NULL) {
+
+            traceFile = argv[arg];
+            continue;
+        }
+
+        programFile = NULL;
+        break;
+    }
+
+    if (programFile == NULL || traceFile == NULL || passes == 0) {
+        printf("usage: filtest [-l<lookahead>] [-s<snaplen>] [-n<passes>] "
+               "program.txt trace.pcap\n");
+        return 2;
+    }
+
+    if (!LoadProgram(programFile)) {
+        return 2;
+    }
+
+    if (!PacketFilterValidate(Program, ProgramLength)) {
+        printf("filtest: the driver would reject this program\n");
+        return 1;
+    }
+
+    if (!LoadTrace(traceFile)) {
+        return 2;
+    }
+
+    //
+    // Decisions, whole and as indicated with a lookahead buffer
+    //
+
+    for (i = 0; i < FrameCount; i++) {
+
+        result = PacketFilterRun(
+                    Program,
+                    Frames[i].Data,
+                    Frames[i].CaptureLength,
+                    NULL,
+                    0,
+                    Frames[i].PacketLength
+                    );
+
+        split = FilterSplit(&Frames[i], lookahead);
+
+        bytesWire += Frames[i].PacketLength;
+
+        if (result != 0) {
+
+            kept++;
+
+            if (snapLength != 0 && result > snapLength) {
+                result = snapLength;
+            }
+            if (result > Frames[i].PacketLength) {
+                result = Frames[i].PacketLength;
+            }
+            bytesKept += result;
+        }
+
+        if (split != 0) {
+            keptSplit++;
+        }
+
+        if ((result != 0) != (split != 0)) {
+            different++;
+        }
+    }
+
+    printf("%lu instructions: %lu of %lu frames kept, %.0f of %.0f bytes copied\n",
+                ProgramLength, kept, FrameCount, bytesKept, bytesWire);
+
+    printf("lookahead %lu: %lu frames kept, %lu decided differently\n",
+                lookahead, keptSplit, different);
+
+    //
+    // Cost, as the driver runs it
+    //
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+
+    for (pass = 0; pass < passes; pass++) {
+        for (i = 0; i < FrameCount; i++) {
+            sink += FilterSplit(&Frames[i], lookahead);
+        }
+    }
+
+    QueryPerformanceCounter(&stop);
+
+    printf("%.1f ns per frame\n",
+                (double)(stop.QuadPart - start.QuadPart) * 1e9
+                    / frequency.QuadPart / ((double)passes * FrameCount));
+
+    return different ? 1 : 0;
+}
@@ -26,6 +26,203 @@ typedef struct _PACKET_OID_DATA {
 #define IOCTL_PROTOCOL_RESET        CTL_CODE(FILE_DEVICE_PROTOCOL, 2 , METHOD_BUFFERED, FILE_ANY_ACCESS)
 #define IOCTL_ENUM_ADAPTERS        CTL_CODE(FILE_DEVICE_PROTOCOL, 3 , METHOD_BUFFERED, FILE_ANY_ACCESS)
 
+//
+// Ring capture. The application passes a PACKET_RING_SETUP as the input
+// buffer and the ring memory as the output buffer of IOCTL_PROTOCOL_MAP_RING.
+// The driver keeps that request pending for as long as the ring is in use,
+// so the pages stay locked until IOCTL_PROTOCOL_UNMAP_RING, a cancel, or
+// the handle is closed.
+//
+
+#define IOCTL_PROTOCOL_MAP_RING     CTL_CODE(FILE_DEVICE_PROTOCOL, 4 , METHOD_OUT_DIRECT, FILE_ANY_ACCESS)
+#define IOCTL_PROTOCOL_UNMAP_RING   CTL_CODE(FILE_DEVICE_PROTOCOL, 5 , METHOD_BUFFERED, FILE_ANY_ACCESS)
+
+#define PACKET_RING_MIN_SIZE        0x10000
+#define PACKET_RING_ALIGNMENT       32
+
+#define PACKET_RING_ALIGN(_x) \
+            (((_x) + PACKET_RING_ALIGNMENT - 1) & ~(PACKET_RING_ALIGNMENT - 1))
+
+typedef struct _PACKET_RING_SETUP {
+
+    HANDLE          Event;          // auto-reset event signalled on wakeup
+    ULONG           SnapLength;     // bytes kept per frame, 0 for all
+    ULONG           WakeupFrames;   // frames per wakeup, 0 for end of batch
+
+}   PACKET_RING_SETUP, *PPACKET_RING_SETUP;
+
+//
+// The ring memory starts with this header. Frames are stored from
+// DataOffset on, in Size bytes (a power of two). Head and Tail are free
+// running byte counts: the driver only moves Head and the application
+// only moves Tail. The two live on separate cache lines.
+//
+
+typedef struct _PACKET_RING_HEADER {
+
+    ULONG           Size;
+    ULONG           DataOffset;
+    ULONG           SnapLength;
+    ULONG           Frames;         // frames stored in the ring
+    ULONG           Drops;          // frames lost because the ring was full
+    ULONG           Wakeups;        // times the event was signalled
+    volatile ULONG  Head;
+    ULONG           Reserved0[9];
+
+    volatile ULONG  Tail;
+    volatile ULONG  Waiting;        // set by the application before it waits
+    ULONG           Reserved1[14];
+
+}   PACKET_RING_HEADER, *PPACKET_RING_HEADER;
+
+//
+// Each frame is preceded by this header and padded out to
+// PACKET_RING_ALIGNMENT. A record with a PacketLength of zero only
+// fills the end of the ring and is skipped.
+//
+
+typedef struct _PACKET_RING_FRAME {
+
+    ULONG           RecordLength;   // bytes to the next record
+    ULONG           CaptureLength;  // bytes of frame data that follow
+    ULONG           PacketLength;   // length of the frame on the wire
+    ULONG           Reserved;
+    LARGE_INTEGER   TimeStamp;      // system time in 100ns units
+    ULONG           Reserved1[2];
+
+}   PACKET_RING_FRAME, *PPACKET_RING_FRAME;
+
+//
+// Packet filter. IOCTL_PROTOCOL_SET_FILTER attaches a PACKET_FILTER_PROGRAM
+// to the open instance; the driver runs it on every received frame, on the
+// lookahead data, before anything is copied. The instruction set and its
+// encoding are those of the BSD packet filter, so a program printed by
+// "tcpdump -dd" can be used as it is. The program returns the number of
+// bytes of the frame to keep, 0 to drop it. An empty program accepts
+// every frame and only sets the snap length.
+//
+
+#define IOCTL_PROTOCOL_SET_FILTER   CTL_CODE(FILE_DEVICE_PROTOCOL, 6 , METHOD_BUFFERED, FILE_ANY_ACCESS)
+
+#define PACKET_FILTER_MAX_INSNS     512
+#define PACKET_FILTER_MEMWORDS      16
+
+typedef struct _PACKET_FILTER_INSN {
+
+    USHORT          Code;
+    UCHAR           JumpTrue;
+    UCHAR           JumpFalse;
+    ULONG           K;
+
+}   PACKET_FILTER_INSN, *PPACKET_FILTER_INSN;
+
+typedef struct _PACKET_FILTER_PROGRAM {
+
+    ULONG               SnapLength;         // bytes kept per frame, 0 for all
+    ULONG               InstructionCount;
+    PACKET_FILTER_INSN  Instructions[1];
+
+}   PACKET_FILTER_PROGRAM, *PPACKET_FILTER_PROGRAM;
+
+#define PACKET_FILTER_PROGRAM_LENGTH(_Count) \
+            (FIELD_OFFSET(PACKET_FILTER_PROGRAM, Instructions) \
+                + (_Count) * sizeof(PACKET_FILTER_INSN))
+
+//
+// Instruction classes
+//
+
+#define BPF_CLASS(_code)    ((_code) & 0x07)
+#define BPF_LD              0x00
+#define BPF_LDX             0x01
+#define BPF_ST              0x02
+#define BPF_STX             0x03
+#define BPF_ALU             0x04
+#define BPF_JMP             0x05
+#define BPF_RET             0x06
+#define BPF_MISC            0x07
+
+//
+// Load sizes and addressing modes
+//
+
+#define BPF_SIZE(_code)     ((_code) & 0x18)
+#define BPF_W               0x00
+#define BPF_H               0x08
+#define BPF_B               0x10
+
+#define BPF_MODE(_code)     ((_code) & 0xe0)
+#define BPF_IMM             0x00
+#define BPF_ABS             0x20
+#define BPF_IND             0x40
+#define BPF_MEM             0x60
+#define BPF_LEN             0x80
+#define BPF_MSH             0xa0
+
+//
+// ALU and jump operations, and their operand
+//
+
+#define BPF_OP(_code)       ((_code) & 0xf0)
+#define BPF_ADD             0x00
+#define BPF_SUB             0x10
+#define BPF_MUL             0x20
+#define BPF_DIV             0x30
+#define BPF_OR              0x40
+#define BPF_AND             0x50
+#define BPF_LSH             0x60
+#define BPF_RSH             0x70
+#define BPF_NEG             0x80
+#define BPF_MOD             0x90
+#define BPF_XOR             0xa0
+
+#define BPF_JA              0x00
+#define BPF_JEQ             0x10
+#define BPF_JGT             0x20
+#define BPF_JGE             0x30
+#define BPF_JSET            0x40
+
+#define BPF_SRC(_code)      ((_code) & 0x08)
+#define BPF_K               0x00
+#define BPF_X               0x08
+
+//
+// Return values and miscellaneous operations
+//
+
+#define BPF_RVAL(_code)     ((_code) & 0x18)
+#define BPF_A               0x10
+
+#define BPF_MISCOP(_code)   ((_code) & 0xf8)
+#define BPF_TAX             0x00
+#define BPF_TXA             0x80
+
+#define BPF_STMT(_code, _k)             { (USHORT)(_code), 0, 0, _k }
+#define BPF_JUMP(_code, _k, _jt, _jf)   { (USHORT)(_code), _jt, _jf, _k }
+
+//
+// Batched reads and writes. IOCTL_PROTOCOL_READ_FRAMES completes with
+// as many frames as fit in its output buffer, stored as in the ring:
+// each one a PACKET_RING_FRAME followed by the frame data, padded out to
+// PACKET_RING_ALIGNMENT, with no pad records. The request completes
+// when the next frame doesn't fit or at the end of the receive batch,
+// and Information is the number of bytes used. Keep several of them
+// pending so no frames are lost while one is being processed.
+//
+// IOCTL_PROTOCOL_WRITE_FRAMES takes frames in the same format as its
+// output buffer; only RecordLength and CaptureLength are used. The frames
+// are sent in order and Information is the number of frames passed to the
+// adapter. It can be less than the number passed in if the driver ran out
+// of send descriptors, in which case the rest should be passed again. The
+// request fails with STATUS_INVALID_PARAMETER at a malformed record, and
+// with STATUS_UNSUCCESSFUL if the adapter failed any of the frames.
+//
+
+#define IOCTL_PROTOCOL_READ_FRAMES  CTL_CODE(FILE_DEVICE_PROTOCOL, 7 , METHOD_OUT_DIRECT, FILE_ANY_ACCESS)
+#define IOCTL_PROTOCOL_WRITE_FRAMES CTL_CODE(FILE_DEVICE_PROTOCOL, 8 , METHOD_IN_DIRECT, FILE_ANY_ACCESS)
+
+#define PACKET_FRAMES_MIN_LENGTH    2048
+
 #endif
 
 
@@ -5,6 +5,7 @@
 #define  IDM_SEND   103
 #define  IDM_READ   104
 #define  IDM_RESET  105
+#define  IDM_CAPTURE 106
 
 #define  IDM_NO_FILTER      110
 #define  IDM_DIRECTED       111
@@ -614,6 +614,685 @@ Return Value:
 
 }
 
+BOOL
+PacketSetBpf(
+    LPADAPTER           AdapterObject,
+    PPACKET_FILTER_INSN Instructions,
+    ULONG               Count,
+    ULONG               SnapLength
+    )
+/*++
+
+Routine Description:
+
+    This routine attaches a packet filter program to the adapter. The
+    driver validates the program and runs it on every received frame
+    before it copies any of it
+
+Arguments:
+
+    AdapterObject  - AdapterObject return by PacketOpenAdapter
+
+    Instructions   - the program
+
+    Count          - number of instructions, 0 to keep every frame
+
+    SnapLength     - bytes kept of each frame, 0 for the whole frame
+
+Return Value:
+
+    SUCCESS - TRUE
+    FAILURE - FALSE
+
+--*/
+
+{
+    PPACKET_FILTER_PROGRAM  Program;
+    ULONG                   Length;
+    OVERLAPPED              OverLapped;
+    DWORD                   BytesReturned;
+    BOOL                    Result;
+
+    Length=PACKET_FILTER_PROGRAM_LENGTH(Count);
+
+    Program=GlobalAllocPtr(
+        GMEM_MOVEABLE | GMEM_ZEROINIT,
+        Length
+        );
+
+    if (Program == NULL) {
+
+        return FALSE;
+
+    }
+
+    Program->SnapLength=SnapLength;
+    Program->InstructionCount=Count;
+    CopyMemory(Program->Instructions, Instructions, Count*sizeof(PACKET_FILTER_INSN));
+
+    ZeroMemory(&OverLapped, sizeof(OverLapped));
+    OverLapped.hEvent=CreateEvent(NULL, TRUE, FALSE, NULL);
+
+    Result=DeviceIoControl(
+        AdapterObject->hFile,
+        (DWORD)IOCTL_PROTOCOL_SET_FILTER,
+        Program,
+        Length,
+        NULL,
+        0,
+        &BytesReturned,
+        &OverLapped
+        );
+
+    if (!Result && GetLastError() == ERROR_IO_PENDING) {
+        Result=GetOverlappedResult(
+                   AdapterObject->hFile,
+                   &OverLapped,
+                   &BytesReturned,
+                   TRUE
+                   );
+    }
+
+    if (OverLapped.hEvent != NULL) {
+        CloseHandle(OverLapped.hEvent);
+    }
+
+    GlobalFreePtr(Program);
+
+    return Result;
+}
+
+
+PVOID
+PacketMapRing(
+    LPADAPTER  AdapterObject,
+    ULONG      Size,
+    ULONG      SnapLength,
+    ULONG      WakeupFrames
+    )
+/*++
+
+Routine Description:
+
+    This routine maps a shared capture ring on the adapter. The ring
+    memory is the output buffer of IOCTL_PROTOCOL_MAP_RING, which the
+    driver keeps pending until PacketUnmapRing
+
+Arguments:
+
+    AdapterObject  - AdapterObject return by PacketOpenAdapter
+
+    Size           - bytes of frame data the ring holds
+
+    SnapLength     - bytes kept of each frame, 0 for the whole frame
+
+    WakeupFrames   - frames stored before a waiting reader is woken
+
+Return Value:
+
+    SUCCESS - returns a ring object
+    FAILURE - NULL
+
+--*/
+
+{
+    LPRING              lpRing;
+    PACKET_RING_SETUP   Setup;
+    DWORD               BytesReturned;
+    BOOL                Result;
+
+    ODS("Packet32: PacketMapRing\n");
+
+    lpRing=(LPRING)GlobalAllocPtr(
+                             GMEM_MOVEABLE | GMEM_ZEROINIT,
+                             sizeof(RING)
+                             );
+
+    if (lpRing==NULL) {
+
+        ODS("Packet32: PacketMapRing GlobalAlloc Failed\n");
+
+        return NULL;
+
+    }
+
+    lpRing->hEvent=CreateEvent(NULL, FALSE, FALSE, NULL);
+    lpRing->OverLapped.hEvent=CreateEvent(NULL, TRUE, FALSE, NULL);
+
+    //
+    //  VirtualAlloc gives page aligned memory, so the driver
+    //  sees the header at the start of the first page
+    //
+    lpRing->Header=VirtualAlloc(
+                       NULL,
+                       sizeof(PACKET_RING_HEADER)+Size,
+                       MEM_COMMIT,
+                       PAGE_READWRITE
+                       );
+
+    if (lpRing->hEvent==NULL || lpRing->OverLapped.hEvent==NULL
+        || lpRing->Header==NULL) {
+
+        ODS("Packet32: PacketMapRing allocation Failed\n");
+
+        goto CleanExit;
+    }
+
+    Setup.Event=lpRing->hEvent;
+    Setup.SnapLength=SnapLength;
+    Setup.WakeupFrames=WakeupFrames;
+
+    Result=DeviceIoControl(
+        AdapterObject->hFile,
+        (DWORD)IOCTL_PROTOCOL_MAP_RING,
+        &Setup,
+        sizeof(Setup),
+        lpRing->Header,
+        sizeof(PACKET_RING_HEADER)+Size,
+        &BytesReturned,
+        &lpRing->OverLapped
+        );
+
+    //
+    //  The request only completes when the ring is unmapped, so
+    //  anything but a pending request means the ring is not in use
+    //
+    if (Result || GetLastError() != ERROR_IO_PENDING) {
+
+        ODS("Packet32: PacketMapRing Could not map ring\n");
+
+        goto CleanExit;
+    }
+
+    lpRing->Data=(PUCHAR)lpRing->Header+lpRing->Header->DataOffset;
+    lpRing->Size=lpRing->Header->Size;
+
+    return lpRing;
+
+CleanExit:
+
+    if (lpRing->Header != NULL) {
+        VirtualFree(lpRing->Header, 0, MEM_RELEASE);
+    }
+    if (lpRing->OverLapped.hEvent != NULL) {
+        CloseHandle(lpRing->OverLapped.hEvent);
+    }
+    if (lpRing->hEvent != NULL) {
+        CloseHandle(lpRing->hEvent);
+    }
+
+    GlobalFreePtr(lpRing);
+
+    return NULL;
+}
+
+
+VOID
+PacketUnmapRing(
+    LPADAPTER  AdapterObject,
+    LPRING     lpRing
+    )
+/*++
+
+Routine Description:
+
+    This routine stops ring capture and frees a ring mapped with
+    PacketMapRing
+
+Arguments:
+
+    AdapterObject  - AdapterObject return by PacketOpenAdapter
+
+    lpRing         - ring object returned by PacketMapRing
+
+Return Value:
+
+
+--*/
+
+{
+    OVERLAPPED  OverLapped;
+    DWORD       BytesReturned;
+    BOOL        Result;
+
+    ODS("Packet32: PacketUnmapRing\n");
+
+    ZeroMemory(&OverLapped, sizeof(OverLapped));
+    OverLapped.hEvent=CreateEvent(NULL, TRUE, FALSE, NULL);
+
+    Result=DeviceIoControl(
+        AdapterObject->hFile,
+        (DWORD)IOCTL_PROTOCOL_UNMAP_RING,
+        NULL,
+        0,
+        NULL,
+        0,
+        &BytesReturned,
+        &OverLapped
+        );
+
+    if (!Result && GetLastError() == ERROR_IO_PENDING) {
+        Result=GetOverlappedResult(
+                   AdapterObject->hFile,
+                   &OverLapped,
+                   &BytesReturned,
+                   TRUE
+                   );
+    }
+
+    if (!Result) {
+        //
+        //  Fall back to cancelling the map request
+        //
+        CancelIo(AdapterObject->hFile);
+    }
+
+    if (OverLapped.hEvent != NULL) {
+        CloseHandle(OverLapped.hEvent);
+    }
+
+    //
+    //  The ring memory stays locked until the map request completes
+    //
+    GetOverlappedResult(
+        AdapterObject->hFile,
+        &lpRing->OverLapped,
+        &BytesReturned,
+        TRUE
+        );
+
+    VirtualFree(lpRing->Header, 0, MEM_RELEASE);
+    CloseHandle(lpRing->OverLapped.hEvent);
+    CloseHandle(lpRing->hEvent);
+
+    GlobalFreePtr(lpRing);
+}
+
+
+BOOL
+PacketRingWait(
+    LPRING     lpRing,
+    DWORD      Timeout
+    )
+/*++
+
+Routine Description:
+
+    This routine waits until the ring holds frames that PacketRingNextFrame
+    has not returned yet. The driver only signals the event when Waiting
+    is set, and Head is checked again after setting it, so a frame stored
+    in between is never missed
+
+Arguments:
+
+    lpRing         - ring object returned by PacketMapRing
+
+    Timeout        - time to wait in milliseconds
+
+Return Value:
+
+    SUCCESS - TRUE if there are frames to read
+    FAILURE - FALSE if the wait timed out
+
+--*/
+
+{
+    PPACKET_RING_HEADER Header=lpRing->Header;
+
+    lpRing->Head=Header->Head;
+
+    if (lpRing->Head == lpRing->Tail) {
+
+        InterlockedExchange((PLONG)&Header->Waiting, 1);
+
+        lpRing->Head=Header->Head;
+
+        if (lpRing->Head == lpRing->Tail) {
+
+            WaitForSingleObject(lpRing->hEvent, Timeout);
+
+            lpRing->Head=Header->Head;
+        }
+
+        Header->Waiting=0;
+    }
+
+    return lpRing->Head != lpRing->Tail;
+}
+
+
+PPACKET_RING_FRAME
+PacketRingNextFrame(
+    LPRING     lpRing
+    )
+/*++
+
+Routine Description:
+
+    This routine returns the next frame seen by the last PacketRingWait.
+    The frame stays valid until PacketRingReleaseFrames
+
+Arguments:
+
+    lpRing         - ring object returned by PacketMapRing
+
+Return Value:
+
+    SUCCESS - pointer to the frame header, the frame data follows it
+    FAILURE - NULL if there are no more frames
+
+--*/
+
+{
+    PPACKET_RING_FRAME  Frame;
+
+    while (lpRing->Tail != lpRing->Head) {
+
+        Frame=(PPACKET_RING_FRAME)(lpRing->Data+(lpRing->Tail & (lpRing->Size-1)));
+
+        lpRing->Tail+=Frame->RecordLength;
+
+        //
+        //  Skip the padding at the end of the ring
+        //
+        if (Frame->PacketLength != 0) {
+            return Frame;
+        }
+    }
+
+    return NULL;
+}
+
+
+VOID
+PacketRingReleaseFrames(
+    LPRING     lpRing
+    )
+/*++
+
+Routine Description:
+
+    This routine gives the space of the frames returned so far back
+    to the driver
+
+Arguments:
+
+    lpRing         - ring object returned by PacketMapRing
+
+Return Value:
+
+
+--*/
+
+{
+    InterlockedExchange((PLONG)&lpRing->Header->Tail, lpRing->Tail);
+}
+
+
+BOOL
+PacketReceiveFrames(
+    LPADAPTER   AdapterObject,
+    LPPACKET    lpPacket,
+    BOOLEAN     Sync,
+    PULONG      BytesReceived
+    )
+/*++
+
+Routine Description:
+
+    This rotine issues a batch read. It completes with as many frames
+    as fit in the packet's buffer, or with the frames of one receive
+    batch; walk them with PacketNextFrame
+
+Arguments:
+
+    AdapterObject  - AdapterObject return by PacketOpenAdapter
+
+    lpPacket       - Packet object returned by PacketAllocatePacket and initialized
+                     by PacketInitPacket, with at least PACKET_FRAMES_MIN_LENGTH bytes
+
+    Sync           - TRUE if service should wait for the frames
+
+    BytesReceived  - bytes of the buffer used
+
+
+Return Value:
+
+    SUCCESS - TRUE if succeeded and SYNC==TRUE
+    FAILURE -
+
+--*/
+
+{
+    BOOL      Result;
+
+    if (!ResetEvent(lpPacket->OverLapped.hEvent)) {
+
+        return FALSE;
+
+    }
+
+    Result=DeviceIoControl(
+              AdapterObject->hFile,
+              (DWORD)IOCTL_PROTOCOL_READ_FRAMES,
+              NULL,
+              0,
+              lpPacket->Buffer,
+              lpPacket->Length,
+              BytesReceived,
+              &lpPacket->OverLapped
+              );
+    if(!Result) {
+
+        if (GetLastError() == ERROR_IO_PENDING) {
+
+            if (Sync) {
+                Result=GetOverlappedResult(
+                           AdapterObject->hFile,
+                           &lpPacket->OverLapped,
+                           BytesReceived,
+                           TRUE
+                           );
+
+            } else {
+                //
+                //  They will call PacketWaitPacket to get the real result
+                //
+                Result=TRUE;
+
+            }
+        }
+    }
+    return Result;
+}
+
+
+BOOL
+PacketSendFrames(
+    LPADAPTER   AdapterObject,
+    LPPACKET    lpPacket,
+    BOOLEAN     Sync,
+    PULONG      FramesSent
+    )
+/*++
+
+Routine Description:
+
+    This rotine sends all the frames stored in the packet's buffer
+    with PacketAddFrame in one request
+
+Arguments:
+
+    AdapterObject  - AdapterObject return by PacketOpenAdapter
+
+    lpPacket       - Packet object returned by PacketAllocatePacket and initialized
+                     by PacketInitPacket with the length PacketAddFrame returned
+
+    Sync           - TRUE if service should wait for the frames to transmit
+
+    FramesSent     - frames passed to the adapter. If the request succeeded
+                     and it is less than the number of frames, the driver
+                     was out of send descriptors and the remaining frames
+                     should be sent again. If it failed, a frame was
+                     malformed or the adapter failed a send
+
+
+Return Value:
+
+    SUCCESS - TRUE if succeeded and SYNC==TRUE
+    FAILURE -
+
+--*/
+
+{
+    BOOL      Result;
+
+    if (!ResetEvent(lpPacket->OverLapped.hEvent)) {
+
+        return FALSE;
+
+    }
+
+    Result=DeviceIoControl(
+              AdapterObject->hFile,
+              (DWORD)IOCTL_PROTOCOL_WRITE_FRAMES,
+              NULL,
+              0,
+              lpPacket->Buffer,
+              lpPacket->Length,
+              FramesSent,
+              &lpPacket->OverLapped
+              );
+    if(!Result) {
+
+        if (GetLastError() == ERROR_IO_PENDING) {
+
+            if (Sync) {
+                Result=GetOverlappedResult(
+                           AdapterObject->hFile,
+                           &lpPacket->OverLapped,
+                           FramesSent,
+                           TRUE
+                           );
+
+            } else {
+                //
+                //  They will call PacketWaitPacket to get the real result
+                //
+                Result=TRUE;
+
+            }
+        }
+    }
+    return Result;
+}
+
+
+PPACKET_RING_FRAME
+PacketNextFrame(
+    PVOID      Buffer,
+    ULONG      Length,
+    PULONG     Offset
+    )
+/*++
+
+Routine Description:
+
+    This routine returns the next frame of a buffer filled by
+    PacketReceiveFrames
+
+Arguments:
+
+    Buffer         - the packet's buffer
+
+    Length         - bytes received
+
+    Offset         - offset of the next record, 0 for the first one
+
+Return Value:
+
+    SUCCESS - pointer to the frame header, the frame data follows it
+    FAILURE - NULL if there are no more frames
+
+--*/
+
+{
+    PPACKET_RING_FRAME  Frame;
+
+    if (*Offset > Length || Length - *Offset < sizeof(PACKET_RING_FRAME)) {
+
+        return NULL;
+
+    }
+
+    Frame=(PPACKET_RING_FRAME)((PUCHAR)Buffer+*Offset);
+
+    *Offset+=Frame->RecordLength;
+
+    return Frame;
+}
+
+
+BOOL
+PacketAddFrame(
+    PVOID      Buffer,
+    ULONG      Length,
+    PULONG     Offset,
+    PVOID      Frame,
+    ULONG      FrameLength
+    )
+/*++
+
+Routine Description:
+
+    This routine appends a frame to a buffer for PacketSendFrames
+
+Arguments:
+
+    Buffer         - the packet's buffer
+
+    Length         - size of the buffer
+
+    Offset         - bytes of the buffer used so far, 0 for the first frame.
+                     Pass it to PacketInitPacket as the length to send
+
+    Frame          - the frame, starting with its ethernet header
+
+    FrameLength    - length of the frame
+
+Return Value:
+
+    SUCCESS - TRUE
+    FAILURE - FALSE if the buffer is full
+
+--*/
+
+{
+    PPACKET_RING_FRAME  Record;
+    ULONG               RecordLength;
+
+    RecordLength=PACKET_RING_ALIGN(sizeof(PACKET_RING_FRAME)+FrameLength);
+
+    if (*Offset > Length || Length - *Offset < RecordLength) {
+
+        return FALSE;
+
+    }
+
+    Record=(PPACKET_RING_FRAME)((PUCHAR)Buffer+*Offset);
+
+    ZeroMemory(Record, sizeof(PACKET_RING_FRAME));
+    Record->RecordLength=RecordLength;
+    Record->CaptureLength=FrameLength;
+    Record->PacketLength=FrameLength;
+    CopyMemory(Record+1, Frame, FrameLength);
+
+    *Offset+=RecordLength;
+
+    return TRUE;
+}
+
+
 BOOL
 PacketStartDriver(
     LPTSTR     ServiceName
@@ -22,6 +22,17 @@ typedef struct _PACKET {
     } PACKET, *LPPACKET;
 
 
+typedef struct _RING {
+    HANDLE              hEvent;      // signalled by the driver on wakeup
+    OVERLAPPED          OverLapped;  // for the pending map request
+    PPACKET_RING_HEADER Header;
+    PUCHAR              Data;
+    ULONG               Size;
+    ULONG               Head;        // Head seen by the last PacketRingWait
+    ULONG               Tail;        // next record PacketRingNextFrame returns
+    } RING, *LPRING;
+
+
 BOOL
 PacketStartDriver(
     LPTSTR     ServiceName
@@ -170,6 +181,191 @@ Return Value:
 --*/
 
 
+BOOL
+PacketSetBpf(
+    LPADAPTER           AdapterObject,
+    PPACKET_FILTER_INSN Instructions,
+    ULONG               Count,
+    ULONG               SnapLength
+    );
+/*++
+
+Routine Description:
+
+    This routine attaches a packet filter program to the adapter
+
+Arguments:
+
+    AdapterObject  - AdapterObject return by PacketOpenAdapter
+
+    Instructions   - the program, as printed by "tcpdump -dd"
+
+    Count          - number of instructions, 0 to keep every frame
+
+    SnapLength     - bytes kept of each frame, 0 for the whole frame
+
+Return Value:
+
+    SUCCESS - TRUE
+    FAILURE - FALSE if the driver rejected the program
+
+--*/
+
+PVOID
+PacketMapRing(
+    LPADAPTER  AdapterObject,
+    ULONG      Size,
+    ULONG      SnapLength,
+    ULONG      WakeupFrames
+    );
+/*++
+
+Routine Description:
+
+    This routine maps a shared capture ring on the adapter. While the
+    ring is mapped, received frames are stored in it instead of
+    completing reads
+
+Arguments:
+
+    AdapterObject  - AdapterObject return by PacketOpenAdapter
+
+    Size           - bytes of frame data the ring holds, a power of two
+                     of at least PACKET_RING_MIN_SIZE
+
+    SnapLength     - bytes kept of each frame, 0 for the whole frame
+
+    WakeupFrames   - frames stored before a waiting PacketRingWait is
+                     woken, 0 to wake only at the end of each receive batch
+
+Return Value:
+
+    SUCCESS - returns a ring object
+    FAILURE - NULL
+
+--*/
+
+VOID
+PacketUnmapRing(
+    LPADAPTER  AdapterObject,
+    LPRING     lpRing
+    );
+
+BOOL
+PacketRingWait(
+    LPRING     lpRing,
+    DWORD      Timeout
+    );
+/*++
+
+Routine Description:
+
+    This routine waits until the ring holds frames that PacketRingNextFrame
+    has not returned yet. It only blocks when the ring is empty
+
+Arguments:
+
+    lpRing         - ring object returned by PacketMapRing
+
+    Timeout        - time to wait in milliseconds
+
+Return Value:
+
+    SUCCESS - TRUE if there are frames to read
+    FAILURE - FALSE if the wait timed out
+
+--*/
+
+PPACKET_RING_FRAME
+PacketRingNextFrame(
+    LPRING     lpRing
+    );
+
+VOID
+PacketRingReleaseFrames(
+    LPRING     lpRing
+    );
+
+BOOL
+PacketReceiveFrames(
+    LPADAPTER   AdapterObject,
+    LPPACKET    lpPacket,
+    BOOLEAN     Sync,
+    PULONG      BytesReceived
+    );
+/*++
+
+Routine Description:
+
+    This rotine issues a batch read, which completes with many frames
+    stored as in the ring. Walk them with PacketNextFrame
+
+Arguments:
+
+    AdapterObject  - AdapterObject return by PacketOpenAdapter
+
+    lpPacket       - Packet object returned by PacketAllocatePacket and initialized
+                     by PacketInitPacket, with at least PACKET_FRAMES_MIN_LENGTH bytes
+
+    Sync           - TRUE if service should wait for the frames
+
+    BytesReceived  - bytes of the buffer used
+
+Return Value:
+
+    SUCCESS - TRUE if succeeded and SYNC==TRUE
+    FAILURE -
+
+--*/
+
+BOOL
+PacketSendFrames(
+    LPADAPTER   AdapterObject,
+    LPPACKET    lpPacket,
+    BOOLEAN     Sync,
+    PULONG      FramesSent
+    );
+/*++
+
+Routine Description:
+
+    This rotine sends the frames stored in the packet's buffer with
+    PacketAddFrame in one request
+
+Arguments:
+
+    AdapterObject  - AdapterObject return by PacketOpenAdapter
+
+    lpPacket       - Packet object initialized by PacketInitPacket with the
+                     length PacketAddFrame returned
+
+    Sync           - TRUE if service should wait for the frames to transmit
+
+    FramesSent     - frames passed to the adapter
+
+Return Value:
+
+    SUCCESS - TRUE if succeeded and SYNC==TRUE
+    FAILURE -
+
+--*/
+
+PPACKET_RING_FRAME
+PacketNextFrame(
+    PVOID      Buffer,
+    ULONG      Length,
+    PULONG     Offset
+    );
+
+BOOL
+PacketAddFrame(
+    PVOID      Buffer,
+    ULONG      Length,
+    PULONG     Offset,
+    PVOID      Frame,
+    ULONG      FrameLength
+    );
+
 ULONG
 PacketGetAdapterNames(
     PTSTR   pStr,
@@ -70,6 +70,8 @@ TCHAR   szTitle[]=TEXT("Packet Driver Test Application");
 UINT    showdump=0;
 
 #define NUMBER_OF_PACKETS_TO_SEND 5
+#define CAPTURE_RING_SIZE         0x100000
+#define CAPTURE_TIMEOUT           5000
 #define MAX_ADAPTERS 10
 char Buffer[MAX_ADAPTERS * 256];
 
@@ -501,6 +503,74 @@ HandleCommands(
           return TRUE;
 
 
+        case IDM_CAPTURE:
+          if(Adapter.OpenInstance != NULL)
+          {
+              if (Filter != 0) {
+
+                  LPRING              Ring;
+                  PPACKET_RING_FRAME  Frame;
+                  ULONG               Frames = 0;
+                  DWORD               Start;
+                  TCHAR               Text[80];
+
+                  //
+                  // Capture through a shared ring for a few seconds and
+                  // show the last frame received.
+                  //
+
+                  Ring=PacketMapRing(
+                           Adapter.OpenInstance,
+                           CAPTURE_RING_SIZE,
+                           1514,
+                           32
+                           );
+
+                  if (Ring == NULL) {
+                      MessageBox(hWnd, TEXT("Capture Failed"), TEXT("Error!"), MB_OK);
+                      return TRUE;
+                  }
+
+                  Start=GetTickCount();
+
+                  while (GetTickCount()-Start < CAPTURE_TIMEOUT
+                         && PacketRingWait(Ring, CAPTURE_TIMEOUT)) {
+
+                      while ((Frame=PacketRingNextFrame(Ring)) != NULL) {
+
+                          CopyMemory(Adapter.lpMem, Frame+1, Frame->CaptureLength);
+                          Adapter.PacketLength = Frame->CaptureLength;
+                          Frames++;
+                      }
+
+                      PacketRingReleaseFrames(Ring);
+                  }
+
+                  wsprintf(Text, TEXT("%u frames captured, %u dropped"),
+                              Frames, Ring->Header->Drops);
+
+                  PacketUnmapRing(Adapter.OpenInstance, Ring);
+
+                  MessageBox(hWnd, Text, TEXT("Capture"), MB_OK);
+
+                  if (Frames != 0) {
+                      SendMessage(hWnd, WM_LBUTTONDOWN, 0,0l);
+                  }
+              }
+              else
+              {
+                  MessageBox(hWnd, 
+                              TEXT("Set the filter to a valid mode"), 
+                              TEXT("Error!"), MB_OK);
+              }
+          }
+          else
+          {
+                MessageBox(hWnd, TEXT("Device not open"), TEXT("Error!"), MB_OK);
+          }
+          return TRUE;
+
+
         case IDM_SEND:
           if(Adapter.OpenInstance != NULL)
           {
@@ -154,6 +154,60 @@ Return Value:
 }
 
 
+VOID
+MPPrepareSendPacket(
+	IN	PNDIS_PACKET			MyPacket,
+	IN	PNDIS_PACKET			Packet,
+	IN	UINT					Flags
+	)
+/*++
+
+Routine Description:
+
+	Makes our packet describe the packet that was sent to us: same buffers, flags, OOB data
+	and per packet info. The OOB data includes the media specific information, so that needs
+	no separate copy.
+
+Arguments:
+
+	MyPacket				Our packet descriptor, to be sent below
+	Packet					Packet sent to us
+	Flags					Packet flags to send with
+
+Return Value:
+
+	None
+
+--*/
+{
+	PRSVD			Rsvd;
+
+	Rsvd = (PRSVD)(MyPacket->ProtocolReserved);
+	Rsvd->OriginalPkt = Packet;
+
+	MyPacket->Private.Flags = Flags;
+
+	MyPacket->Private.Head = Packet->Private.Head;
+	MyPacket->Private.Tail = Packet->Private.Tail;
+	NdisSetPacketFlags(MyPacket, NDIS_FLAGS_DONT_LOOPBACK);
+
+	//
+	// Copy the OOB Offset from the original packet to the new
+	// packet.
+	//
+	NdisMoveMemory(NDIS_OOB_DATA_FROM_PACKET(MyPacket),
+				   NDIS_OOB_DATA_FROM_PACKET(Packet),
+				   sizeof(NDIS_PACKET_OOB_DATA));
+
+	//
+	// Copy the per packet info into the new packet
+	// This includes ClassificationHandle, etc.
+	// Make sure other stuff is not copied !!!
+	//
+	NdisIMCopySendPerPacketInfo(MyPacket, Packet);
+}
+
+
 NDIS_STATUS
 MPSend(
 	IN	NDIS_HANDLE				MiniportAdapterContext,
@@ -165,7 +219,7 @@ MPSend(
 Routine Description:
 
 	Send handler. Just re-wrap the packet and send it below. Re-wrapping is necessary since
-	NDIS uses the WrapperReserved for its own use.
+	NDIS uses the WrapperReserved for its own use. Not used while MPSendPackets is registered.
 
 	LBFO- All sends will be done in the secondary miniport of the bundle.
 
@@ -186,9 +240,7 @@ Return Value:
 	PADAPT			pAdapt = (PADAPT)MiniportAdapterContext;
 	NDIS_STATUS		Status;
 	PNDIS_PACKET	MyPacket;
-	PRSVD			Rsvd;
-	PVOID			MediaSpecificInfo = NULL;
-	ULONG			MediaSpecificInfoSize = 0;
+	KIRQL			OldIrql;
 
 	//
 	//  According to our LBFO design, all sends will be performed on the secondary miniport
@@ -205,52 +257,16 @@ Return Value:
 		return NDIS_STATUS_FAILURE;
 	}
 
+	//
+	// The descriptor caches are per processor, stay on this one
+	//
+	KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
 
-	NdisAllocatePacket(&Status,
-					   &MyPacket,
-					   pAdapt->SendPacketPoolHandle);
+	MyPacket = PtAllocatePacket(pAdapt->SendCache, pAdapt->SendPacketPoolHandle);
 
-	if (Status == NDIS_STATUS_SUCCESS)
+	if (MyPacket != NULL)
 	{
-		PNDIS_PACKET_EXTENSION	Old, New;
-
-		Rsvd = (PRSVD)(MyPacket->ProtocolReserved);
-		Rsvd->OriginalPkt = Packet;
-		MyPacket->Private.Flags = Flags;
-
-		MyPacket->Private.Head = Packet->Private.Head;
-		MyPacket->Private.Tail = Packet->Private.Tail;
-		NdisSetPacketFlags(MyPacket, NDIS_FLAGS_DONT_LOOPBACK);
-
-		//
-		// Copy the OOB Offset from the original packet to the new
-		// packet.
-		//
-		NdisMoveMemory(NDIS_OOB_DATA_FROM_PACKET(MyPacket),
-					   NDIS_OOB_DATA_FROM_PACKET(Packet),
-					   sizeof(NDIS_PACKET_OOB_DATA));
-
-		//
-		// Copy the per packet info into the new packet
-		// This includes ClassificationHandle, etc.
-		// Make sure other stuff is not copied !!!
-		//
-		NdisIMCopySendPerPacketInfo(MyPacket, Packet);
-		
-		//
-		// Copy the Media specific information
-		//
-		NDIS_GET_PACKET_MEDIA_SPECIFIC_INFO(Packet,
-											&MediaSpecificInfo,
-											&MediaSpecificInfoSize);
-
-		if (MediaSpecificInfo || MediaSpecificInfoSize)
-		{
-			NDIS_SET_PACKET_MEDIA_SPECIFIC_INFO(MyPacket,
-												MediaSpecificInfo,
-												MediaSpecificInfoSize);
-		}
-
+		MPPrepareSendPacket(MyPacket, Packet, Flags);
 
 		NdisSend(&Status,
 				 pAdapt->BindingHandle,
@@ -260,7 +276,7 @@ Return Value:
 		if (Status != NDIS_STATUS_PENDING)
 		{
 			NdisIMCopySendCompletePerPacketInfo (Packet, MyPacket);
-			NdisFreePacket(MyPacket);
+			PtFreePacket(pAdapt->SendCache, MyPacket);
 		}
 	}
 	else
@@ -270,8 +286,11 @@ Return Value:
 		//	- By keeping separate send and receive pools
 		//	- Dynamically allocate more pools as needed and free them when not needed
 		//
+		Status = NDIS_STATUS_RESOURCES;
 	}
 
+	KeLowerIrql(OldIrql);
+
 	return(Status);
 }
 
@@ -286,7 +305,10 @@ MPSendPackets(
 
 Routine Description:
 
-	Batched send-handler. TBD. Either this or the Send function can be specified but not both.
+	Batched send-handler. Re-wraps each packet in a descriptor from the per-processor cache
+	and forwards the array below with NdisSendPackets, PT_SEND_ARRAY_SIZE packets at a time.
+	PtSendComplete is called for every packet passed to NdisSendPackets, whatever its status,
+	so only the packets that could not be re-wrapped are completed here.
 	LBFO - The Send will be done on the secondary miniport of the bundle
 
 Arguments:
@@ -302,86 +324,40 @@ Return Value:
 --*/
 {
 	PADAPT			pAdapt = (PADAPT)MiniportAdapterContext;
-	NDIS_STATUS		Status;
+	PNDIS_PACKET	SendArray[PT_SEND_ARRAY_SIZE];
+	UINT			SendCount = 0;
 	UINT			i;
-	PVOID			MediaSpecificInfo = NULL;
-	UINT			MediaSpecificInfoSize = 0;
+	KIRQL			OldIrql;
 
 	//
 	//	Route all sends to the seondary, if no secondary exists, it will point to itself
 	//
 	pAdapt = pAdapt->pSecondaryAdapt;
 
+	//
+	// The descriptor caches are per processor, stay on this one
+	//
+	KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+
 	for (i = 0; i < NumberOfPackets; i++)
 	{
-		PRSVD			Rsvd;
 		PNDIS_PACKET	Packet, MyPacket;
+		NDIS_STATUS		Status;
 
 		Packet = PacketArray[i];
 
 		if (IsIMDeviceStateOn(pAdapt) == FALSE)
 		{
+			MyPacket = NULL;
 			Status = NDIS_STATUS_FAILURE;
-			break;
 		}
-
-		NdisAllocatePacket(&Status,
-						   &MyPacket,
-						   pAdapt->SendPacketPoolHandle);
-
-		if (Status == NDIS_STATUS_SUCCESS)
+		else
 		{
-			PNDIS_PACKET_EXTENSION	Old, New;
-
-			Rsvd = (PRSVD)(MyPacket->ProtocolReserved);
-			Rsvd->OriginalPkt = Packet;
-
-			MyPacket->Private.Flags = NdisGetPacketFlags(Packet);
-
-			MyPacket->Private.Head = Packet->Private.Head;
-			MyPacket->Private.Tail = Packet->Private.Tail;
-			NdisSetPacketFlags(MyPacket, NDIS_FLAGS_DONT_LOOPBACK);
-
-			//
-			// Copy the OOB Offset from the original packet to the new
-			// packet.
-			//
-			NdisMoveMemory(NDIS_OOB_DATA_FROM_PACKET(MyPacket),
-						   NDIS_OOB_DATA_FROM_PACKET(Packet),
-						   sizeof(NDIS_PACKET_OOB_DATA));
-			//
-			// Copy the per packet info into the new packet
-			// This includes ClassificationHandle, etc.
-			// Make sure other stuff is not copied !!!
-			//
-			NdisIMCopySendPerPacketInfo(MyPacket, Packet);
-
-			//
-			// Copy the Media specific information
-			//
-			NDIS_GET_PACKET_MEDIA_SPECIFIC_INFO(Packet,
-												&MediaSpecificInfo,
-												&MediaSpecificInfoSize);
-
-			if (MediaSpecificInfo || MediaSpecificInfoSize)
-			{
-				NDIS_SET_PACKET_MEDIA_SPECIFIC_INFO(MyPacket,
-													MediaSpecificInfo,
-													MediaSpecificInfoSize);
-			}
-
-			NdisSend(&Status,
-					 pAdapt->BindingHandle,
-					 MyPacket);
-
-			if (Status != NDIS_STATUS_PENDING)
-			{
-				NdisIMCopySendCompletePerPacketInfo (Packet, MyPacket);
-				NdisFreePacket(MyPacket);
-			}
+			MyPacket = PtAllocatePacket(pAdapt->SendCache, pAdapt->SendPacketPoolHandle);
+			Status = NDIS_STATUS_RESOURCES;
 		}
 
-		if (Status != NDIS_STATUS_PENDING)
+		if (MyPacket == NULL)
 		{
 			//
 			// We are out of packets. Silently drop it. Alternatively we can deal with it:
@@ -394,8 +370,26 @@ Return Value:
 
 			// LBFO - Complete with the prmary's miniport handle
 			// We should use the miniport handle that was used to call this function
+			continue;
+		}
+
+		MPPrepareSendPacket(MyPacket, Packet, NdisGetPacketFlags(Packet));
+
+		SendArray[SendCount++] = MyPacket;
+
+		if (SendCount == PT_SEND_ARRAY_SIZE)
+		{
+			NdisSendPackets(pAdapt->BindingHandle, SendArray, SendCount);
+			SendCount = 0;
 		}
 	}
+
+	if (SendCount != 0)
+	{
+		NdisSendPackets(pAdapt->BindingHandle, SendArray, SendCount);
+	}
+
+	KeLowerIrql(OldIrql);
 }
 
 
@@ -859,7 +853,7 @@ Return Value:
 	Resvd = (PRSVD)(Packet->MiniportReserved);
 	MyPacket = Resvd->OriginalPkt;
 
-	NdisFreePacket(Packet);
+	PtFreePacket(pAdapt->RecvCache, Packet);
 	NdisReturnPackets(&MyPacket, 1);
 }
 
@@ -1040,8 +1034,11 @@ Return Value:
 
 
 	//
-	// Free the resources now
+	// Free the resources now. The cached descriptors go back to their pools first.
 	//
+	PtDrainPacketCache(pAdapt->SendCache);
+	PtDrainPacketCache(pAdapt->RecvCache);
+
 	NdisFreePacketPool(pAdapt->SendPacketPoolHandle);
 	NdisFreePacketPool(pAdapt->RecvPacketPoolHandle);
 	NdisFreeMemory(pAdapt->BundleUniString.Buffer, MAX_BUNDLEID_LENGTH,0);
@@ -94,9 +94,11 @@ Return Value:
 
 	//
 	// Either the Send or the SendPackets handler should be specified.
-	// If SendPackets handler is specified, SendHandler is ignored
+	// If SendPackets handler is specified, SendHandler is ignored.
+	// We use SendPackets, so that each array of packets the protocols
+	// above send goes down in one NdisSendPackets call.
 	//
-	// MChars.SendPacketsHandler = MPSendPackets;
+	MChars.SendPacketsHandler = MPSendPackets;
 
 	Status = NdisIMRegisterLayeredMiniport(WrapperHandle,
 										   &MChars,
@@ -150,3 +152,219 @@ Return Value:
 }
 
 
+PNDIS_PACKET
+PtAllocatePacket(
+	IN	PPT_PACKET_CACHE		Cache,
+	IN	NDIS_HANDLE				PoolHandle
+	)
+/*++
+
+Routine Description:
+
+	Allocates a packet descriptor from the cache of the current processor, or from the pool
+	if that cache is empty. A cached descriptor is handed out in the state NdisAllocatePacket
+	would leave it in. Called at DISPATCH_LEVEL.
+
+Arguments:
+
+	Cache					The adapter's array of caches for this pool
+	PoolHandle				The pool the cache was filled from
+
+Return Value:
+
+	The descriptor, or NULL if the pool is exhausted
+
+--*/
+{
+	PPT_PACKET_CACHE	pCache = &Cache[KeGetCurrentProcessorNumber()];
+	PSINGLE_LIST_ENTRY	Entry;
+	PNDIS_PACKET		Packet;
+	NDIS_STATUS			Status;
+
+	ASSERT(KeGetCurrentProcessorNumber() < PT_MAX_PROCESSORS);
+
+	Entry = PopEntryList(&pCache->FreeList);
+
+	if (Entry != NULL)
+	{
+		pCache->Depth--;
+
+		Packet = CONTAINING_RECORD(Entry, NDIS_PACKET, ProtocolReserved);
+
+		NdisReinitializePacket(Packet);
+		NdisZeroMemory(NDIS_OOB_DATA_FROM_PACKET(Packet), sizeof(NDIS_PACKET_OOB_DATA));
+		NdisZeroMemory(NDIS_PACKET_EXTENSION_FROM_PACKET(Packet), sizeof(NDIS_PACKET_EXTENSION));
+	}
+	else
+	{
+		NdisDprAllocatePacket(&Status, &Packet, PoolHandle);
+
+		if (Status != NDIS_STATUS_SUCCESS)
+		{
+			return NULL;
+		}
+	}
+
+	pCache->InUse++;
+
+	return Packet;
+}
+
+
+VOID
+PtFreePacket(
+	IN	PPT_PACKET_CACHE		Cache,
+	IN	PNDIS_PACKET			Packet
+	)
+/*++
+
+Routine Description:
+
+	Gives a packet descriptor back to the cache of the current processor, or to its pool if
+	that cache is full. The processor need not be the one the descriptor was allocated on.
+	Called at DISPATCH_LEVEL.
+
+Arguments:
+
+	Cache					The adapter's array of caches for the descriptor's pool
+	Packet					The descriptor
+
+Return Value:
+
+	None
+
+--*/
+{
+	PPT_PACKET_CACHE	pCache = &Cache[KeGetCurrentProcessorNumber()];
+
+	ASSERT(KeGetCurrentProcessorNumber() < PT_MAX_PROCESSORS);
+
+	pCache->InUse--;
+
+	if (pCache->Depth < PT_PACKET_CACHE_DEPTH)
+	{
+		PushEntryList(&pCache->FreeList, (PSINGLE_LIST_ENTRY)Packet->ProtocolReserved);
+		pCache->Depth++;
+	}
+	else
+	{
+		NdisDprFreePacket(Packet);
+	}
+}
+
+
+VOID
+PtFillPacketCache(
+	IN	PPT_PACKET_CACHE		Cache,
+	IN	NDIS_HANDLE				PoolHandle
+	)
+/*++
+
+Routine Description:
+
+	Preallocates half the depth of the cache of every processor, so the first packets do not
+	go to the pool. Called at bind time, before any packet flows.
+
+Arguments:
+
+	Cache					The adapter's array of caches for this pool
+	PoolHandle				The pool to allocate from
+
+Return Value:
+
+	None. A cache that could not be filled fills up as packets are freed.
+
+--*/
+{
+	PNDIS_PACKET		Packet;
+	NDIS_STATUS			Status;
+	ULONG				Processor, i;
+
+	for (Processor = 0;
+		 Processor < (ULONG)NdisSystemProcessorCount() && Processor < PT_MAX_PROCESSORS;
+		 Processor++)
+	{
+		for (i = 0; i < PT_PACKET_CACHE_DEPTH / 2; i++)
+		{
+			NdisAllocatePacket(&Status, &Packet, PoolHandle);
+
+			if (Status != NDIS_STATUS_SUCCESS)
+			{
+				return;
+			}
+
+			PushEntryList(&Cache[Processor].FreeList, (PSINGLE_LIST_ENTRY)Packet->ProtocolReserved);
+			Cache[Processor].Depth++;
+		}
+	}
+}
+
+
+VOID
+PtDrainPacketCache(
+	IN	PPT_PACKET_CACHE		Cache
+	)
+/*++
+
+Routine Description:
+
+	Frees the descriptors of all the caches of a pool back to it, before the pool is freed.
+	No packets may be flowing.
+
+Arguments:
+
+	Cache					The adapter's array of caches
+
+Return Value:
+
+	None
+
+--*/
+{
+	PSINGLE_LIST_ENTRY	Entry;
+	ULONG				Processor;
+
+	for (Processor = 0; Processor < PT_MAX_PROCESSORS; Processor++)
+	{
+		while ((Entry = PopEntryList(&Cache[Processor].FreeList)) != NULL)
+		{
+			NdisFreePacket(CONTAINING_RECORD(Entry, NDIS_PACKET, ProtocolReserved));
+		}
+
+		Cache[Processor].Depth = 0;
+	}
+}
+
+
+LONG
+PtPacketsInUse(
+	IN	PPT_PACKET_CACHE		Cache
+	)
+/*++
+
+Routine Description:
+
+	Counts the descriptors allocated through a set of caches that have not been freed yet.
+	This replaces NdisPacketPoolUsage, which also counts the cached descriptors. The count is
+	only exact once no more packets are being allocated.
+
+Arguments:
+
+	Cache					The adapter's array of caches
+
+Return Value:
+
+	The number of descriptors in use
+
+--*/
+{
+	LONG				InUse = 0;
+	ULONG				Processor;
+
+	for (Processor = 0; Processor < PT_MAX_PROCESSORS; Processor++)
+	{
+		InUse += Cache[Processor].InUse;
+	}
+
+	return InUse;
+}
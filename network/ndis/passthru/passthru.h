@@ -27,6 +27,7 @@ Revision History:
 
 //advance declaration
 typedef struct _ADAPT ADAPT, *PADAPT;
+typedef struct _PT_PACKET_CACHE PT_PACKET_CACHE, *PPT_PACKET_CACHE;
 
 extern
 NTSTATUS
@@ -200,6 +201,13 @@ MPSend(
 	IN	UINT					Flags
 	);
 
+VOID
+MPPrepareSendPacket(
+	IN	PNDIS_PACKET			MyPacket,
+	IN	PNDIS_PACKET			Packet,
+	IN	UINT					Flags
+	);
+
 NDIS_STATUS
 MPQueryInformation(
 	IN	NDIS_HANDLE				MiniportAdapterContext,
@@ -289,6 +297,39 @@ MPProcessSetPowerOid(
 
 
 
+//
+// Packet descriptor caches
+//
+PNDIS_PACKET
+PtAllocatePacket(
+	IN	PPT_PACKET_CACHE		Cache,
+	IN	NDIS_HANDLE				PoolHandle
+	);
+
+VOID
+PtFreePacket(
+	IN	PPT_PACKET_CACHE		Cache,
+	IN	PNDIS_PACKET			Packet
+	);
+
+VOID
+PtFillPacketCache(
+	IN	PPT_PACKET_CACHE		Cache,
+	IN	NDIS_HANDLE				PoolHandle
+	);
+
+VOID
+PtDrainPacketCache(
+	IN	PPT_PACKET_CACHE		Cache
+	);
+
+LONG
+PtPacketsInUse(
+	IN	PPT_PACKET_CACHE		Cache
+	);
+
+
+
 #define DBGPRINT(Fmt)										\
 	{														\
 		DbgPrint("*** %s (%d) *** ", __FILE__, __LINE__);	\
@@ -307,6 +348,27 @@ typedef struct _ProtRsvd
 } RSVD, *PRSVD;
 
 
+//
+// Per-processor caches of free packet descriptors. The send and receive paths take their
+// descriptors from the cache of the current processor, and give them back to it, without
+// taking the lock of the packet pool. A cache is only touched at DISPATCH_LEVEL on its own
+// processor, so it needs no lock either. While a descriptor is cached, the first pointer of
+// its ProtocolReserved area (see RSVD) links it into the cache.
+//
+#define PT_MAX_PROCESSORS		32		// as many as Windows 2000 supports
+#define PT_PACKET_CACHE_DEPTH	32		// descriptors kept per processor
+#define PT_SEND_ARRAY_SIZE		32		// packets per NdisSendPackets call
+#define PT_CACHE_LINE_SIZE		64
+
+typedef struct _PT_PACKET_CACHE
+{
+	SINGLE_LIST_ENTRY	FreeList;
+	ULONG				Depth;			// descriptors on FreeList
+	LONG				InUse;			// allocated on this processor less freed on it
+	UCHAR				Pad[PT_CACHE_LINE_SIZE - sizeof(SINGLE_LIST_ENTRY) - 2 * sizeof(ULONG)];
+} PT_PACKET_CACHE, *PPT_PACKET_CACHE;
+
+
 //
 // Event Codes related to the PassthruEvent Structure
 //
@@ -369,6 +431,9 @@ typedef struct _ADAPT
 	PADAPT						pSecondaryAdapt;		// Pointer to Secondary's structure
 	KSPIN_LOCK					SpinLock;				// Spin Lock to protect the global list
 
+	PT_PACKET_CACHE				SendCache[PT_MAX_PROCESSORS];	// Descriptors from SendPacketPoolHandle
+	PT_PACKET_CACHE				RecvCache[PT_MAX_PROCESSORS];	// Descriptors from RecvPacketPoolHandle
+
 } ADAPT, *PADAPT;
 
 extern	NDIS_PHYSICAL_ADDRESS			HighestAcceptableMax;
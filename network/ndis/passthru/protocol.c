@@ -191,7 +191,12 @@ Return Value:
 		  	break;
 		}
 
-
+		//
+		// Stock the per-processor descriptor caches, so the first packets of each
+		// processor do not need to go to the pools
+		//
+		PtFillPacketCache(pAdapt->SendCache, pAdapt->SendPacketPoolHandle);
+		PtFillPacketCache(pAdapt->RecvCache, pAdapt->RecvPacketPoolHandle);
 
 		//
 		// Now open the adapter below and complete the initialization
@@ -243,11 +248,13 @@ Return Value:
 		{
 			if (pAdapt->SendPacketPoolHandle != NULL)
 			{
+				 PtDrainPacketCache(pAdapt->SendCache);
 				 NdisFreePacketPool(pAdapt->SendPacketPoolHandle);
 			}
 
 			if (pAdapt->RecvPacketPoolHandle != NULL)
 			{
+				 PtDrainPacketCache(pAdapt->RecvCache);
 				 NdisFreePacketPool(pAdapt->RecvPacketPoolHandle);
 			}
 
@@ -661,18 +668,21 @@ Return Value:
 	PNDIS_PACKET	Pkt;
 	PRSVD			Rsvd;
 
-	//
-	// Returning the Send on the Primary, will point to itself if there is no bundle
-	//
-	pAdapt = pAdapt->pPrimaryAdapt;
-
 	Rsvd =(PRSVD)(Packet->ProtocolReserved);
 	Pkt = Rsvd->OriginalPkt;
 
 
 	NdisIMCopySendCompletePerPacketInfo (Pkt, Packet);
 
-	NdisDprFreePacket(Packet);
+	//
+	// The descriptor goes back to the caches of the binding it was sent on
+	//
+	PtFreePacket(pAdapt->SendCache, Packet);
+
+	//
+	// Returning the Send on the Primary, will point to itself if there is no bundle
+	//
+	pAdapt = pAdapt->pPrimaryAdapt;
 
 	NdisMSendComplete(pAdapt->MiniportHandle,
 							 Pkt,
@@ -768,11 +778,9 @@ Return Value:
 			 //
 			 // Get a packet off the pool and indicate that up
 			 //
-			 NdisDprAllocatePacket(&Status,
-										  &MyPacket,
-										  pAdapt->RecvPacketPoolHandle);
+			 MyPacket = PtAllocatePacket(pAdapt->RecvCache, pAdapt->RecvPacketPoolHandle);
 
-			 if(Status == NDIS_STATUS_SUCCESS)
+			 if(MyPacket != NULL)
 			 {
 				  MyPacket->Private.Head = Packet->Private.Head;
 				  MyPacket->Private.Tail = Packet->Private.Tail;
@@ -798,7 +806,7 @@ Return Value:
 				  NdisMIndicateReceivePacket(pAdapt->MiniportHandle, &MyPacket, 1);
 
 				  ASSERT(NDIS_GET_PACKET_STATUS(MyPacket) == NDIS_STATUS_RESOURCES);
-				  NdisDprFreePacket(MyPacket);
+				  PtFreePacket(pAdapt->RecvCache, MyPacket);
 				  break;
 			 }
 		}
@@ -955,11 +963,9 @@ Return Value:
 	//
 	// Get a packet off the pool and indicate that up
 	//
-	NdisDprAllocatePacket(&Status,
-						   &MyPacket,
-						   pAdapt->RecvPacketPoolHandle);
+	MyPacket = PtAllocatePacket(pAdapt->RecvCache, pAdapt->RecvPacketPoolHandle);
 
-	if(Status == NDIS_STATUS_SUCCESS)
+	if(MyPacket != NULL)
 	{
 		Resvd =(PRSVD)(MyPacket->MiniportReserved);
 		Resvd->OriginalPkt = Packet;
@@ -988,7 +994,7 @@ Return Value:
 
 		if(Status == NDIS_STATUS_RESOURCES)
 		{
-		  NdisDprFreePacket(MyPacket);
+		  PtFreePacket(pAdapt->RecvCache, MyPacket);
 		}
 
 		return((Status != NDIS_STATUS_RESOURCES) ? 1 : 0);
@@ -1241,7 +1247,11 @@ Return Value:
            pAdapt->StandingBy = TRUE;
 	   }
 
-	   while(NdisPacketPoolUsage(pAdapt->SendPacketPoolHandle) != 0)
+	   //
+	   // The pool usage also counts the descriptors sitting in the caches,
+	   // so count the ones in use through the caches instead
+	   //
+	   while(PtPacketsInUse(pAdapt->SendCache) != 0)
 	   {
 	  	   //
 	  	   // sleep till outstanding sends complete
@@ -1257,7 +1267,7 @@ Return Value:
 	  	   NdisMSleep(10);
 	   }
 
-	   ASSERT(NdisPacketPoolUsage(pAdapt->SendPacketPoolHandle) == 0);
+	   ASSERT(PtPacketsInUse(pAdapt->SendCache) == 0);
 	   ASSERT(pAdapt->OutstandingRequests == FALSE);
 	}
 	else
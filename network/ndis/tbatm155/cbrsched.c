@@ -0,0 +1,244 @@
+/*++
+
+Copyright (c) 1999 Microsoft Corporation. All rights reserved.
+
+   File:       cbrsched.c
+
+
+Abstract:
+
+	This module keeps the list of CBR VCs and compiles the CBR schedule
+	table from it in host memory.  tbAtm155SetCbrTblsInSRAM writes the
+	result to the standby schedule table on SRAM.
+
+Author:
+
+Environment:
+
+	Kernel mode
+
+Revision History:
+
+--*/
+
+#include "precomp.h"
+#pragma hdrstop
+
+#define MODULE_NUMBER	MODULE_CBRSCHED
+
+
+VOID
+tbAtm155InitCbrSchedule(
+   IN  PTBATM155_CBR_SCHEDULE  pSchedule
+   )
+/*++
+
+Routine Description:
+
+   This routine will empty the CBR schedule.  The copies of the SRAM
+   tables are set the way tbAtm155InitSRAM_1KVCs and
+   tbAtm155InitSRAM_4KVCs leave CBR schedule tables 1 and 2.
+
+Arguments:
+
+   pSchedule   -   Pointer to the CBR schedule.
+
+Return Value:
+
+   None.
+
+--*/
+{
+   ULONG   Idx;
+
+   pSchedule->NumOfVcs = 0;
+   pSchedule->NumOfEntries = 0;
+
+   for (Idx = 0; Idx < MAX_CBR_SCHEDULE_ENTRIES; Idx++)
+   {
+       pSchedule->Table[Idx] = 0;
+       pSchedule->Sram[0][Idx] = CBR_SCHEDULE_ENTRY_EOT;
+       pSchedule->Sram[1][Idx] = CBR_SCHEDULE_ENTRY_EOT;
+   }
+}
+
+
+NDIS_STATUS
+tbAtm155AddCbrVc(
+   IN  PTBATM155_CBR_SCHEDULE  pSchedule,
+   IN  USHORT                  Vci,
+   IN  USHORT                  NumOfEntries
+   )
+/*++
+
+Routine Description:
+
+   This routine will add a VC to the CBR schedule.  The VCs are kept
+   with the most entries first, in the order they were added otherwise.
+
+Arguments:
+
+   pSchedule       -   Pointer to the CBR schedule.
+   Vci             -   The VC.
+   NumOfEntries    -   Number of entries the VC takes in the CBR
+                       schedule table.
+
+Return Value:
+
+   NDIS_STATUS_SUCCESS     if the VC was added.
+   NDIS_STATUS_FAILURE     if the CBR schedule table is too full to hold it.
+
+--*/
+{
+   ULONG   Idx;
+
+   if ((NumOfEntries == 0) ||
+       ((pSchedule->NumOfEntries + NumOfEntries) > MAX_CBR_SCHEDULE_ENTRIES))
+   {
+       return(NDIS_STATUS_FAILURE);
+   }
+
+   for (Idx = pSchedule->NumOfVcs;
+        (Idx > 0) && (pSchedule->Vc[Idx - 1].NumOfEntries < NumOfEntries);
+        Idx--)
+   {
+       pSchedule->Vc[Idx] = pSchedule->Vc[Idx - 1];
+   }
+
+   pSchedule->Vc[Idx].Vci = Vci;
+   pSchedule->Vc[Idx].NumOfEntries = NumOfEntries;
+
+   pSchedule->NumOfVcs++;
+   pSchedule->NumOfEntries += NumOfEntries;
+
+   return(NDIS_STATUS_SUCCESS);
+}
+
+
+VOID
+tbAtm155RemoveCbrVc(
+   IN  PTBATM155_CBR_SCHEDULE  pSchedule,
+   IN  USHORT                  Vci
+   )
+/*++
+
+Routine Description:
+
+   This routine will remove a VC from the CBR schedule.
+
+Arguments:
+
+   pSchedule   -   Pointer to the CBR schedule.
+   Vci         -   The VC.
+
+Return Value:
+
+   None.
+
+--*/
+{
+   ULONG   Idx;
+
+   for (Idx = 0; Idx < pSchedule->NumOfVcs; Idx++)
+   {
+       if (pSchedule->Vc[Idx].Vci == Vci)
+       {
+           pSchedule->NumOfEntries -= pSchedule->Vc[Idx].NumOfEntries;
+           pSchedule->NumOfVcs--;
+
+           for ( ; Idx < pSchedule->NumOfVcs; Idx++)
+           {
+               pSchedule->Vc[Idx] = pSchedule->Vc[Idx + 1];
+           }
+
+           break;
+       }
+   }
+}
+
+
+VOID
+tbAtm155CompileCbrSchedule(
+   IN  PTBATM155_CBR_SCHEDULE  pSchedule
+   )
+/*++
+
+Routine Description:
+
+   This routine will compile the CBR schedule table for all of the
+   VCs of the schedule into pSchedule->Table in one pass.
+
+   Each VC starts at the first entry still free and its entries are
+   spread evenly over the table from there.  An entry that is taken
+   already is replaced with the nearest free one, looking after it
+   first.  The entries are placed relative to the start of the VC
+   rather than to the entry placed before, so a displaced entry does
+   not push the ones after it and the CDV, Cell Delay Variation, of a
+   VC stays within the distance to the nearest free entry.  The VCs
+   with the most entries go first since they have the least room to
+   move.
+
+Arguments:
+
+   pSchedule   -   Pointer to the CBR schedule.  tbAtm155AddCbrVc has
+                   made sure all of the entries fit.
+
+Return Value:
+
+   None.
+
+--*/
+{
+   PUSHORT                         pTable = pSchedule->Table;
+   TBATM155_CBR_SCHEDULE_ENTRY     phEntry;
+   ULONG                           VcIdx, Idx, NumOfEntries;
+   ULONG                           Start, Ideal, Distance, Entry;
+
+   for (Entry = 0; Entry < MAX_CBR_SCHEDULE_ENTRIES; Entry++)
+   {
+       pTable[Entry] = 0;
+   }
+
+   for (VcIdx = 0, Start = 0; VcIdx < pSchedule->NumOfVcs; VcIdx++)
+   {
+       NumOfEntries = pSchedule->Vc[VcIdx].NumOfEntries;
+
+       phEntry.data = 0;
+       phEntry.VC = pSchedule->Vc[VcIdx].Vci;
+       phEntry.Active = 1;
+
+       //
+       // The entries are only ever taken, so the first free entry
+       // never moves back.
+       //
+       while (pTable[Start] != 0)
+       {
+           Start++;
+       }
+
+       for (Idx = 0; Idx < NumOfEntries; Idx++)
+       {
+           Ideal = Start + ((Idx * MAX_CBR_SCHEDULE_ENTRIES) / NumOfEntries);
+
+           for (Distance = 0; TRUE; Distance++)
+           {
+               Entry = (Ideal + Distance) % MAX_CBR_SCHEDULE_ENTRIES;
+               if (pTable[Entry] == 0)
+               {
+                   break;
+               }
+
+               Entry = (Ideal + MAX_CBR_SCHEDULE_ENTRIES - Distance) %
+                           MAX_CBR_SCHEDULE_ENTRIES;
+               if (pTable[Entry] == 0)
+               {
+                   break;
+               }
+           }
+
+           pTable[Entry] = phEntry.data;
+       }
+   }
+
+   pTable[MAX_CBR_SCHEDULE_ENTRIES - 1] |= CBR_SCHEDULE_ENTRY_EOT;
+}
@@ -0,0 +1,495 @@
+/*++
+
+Copyright (c) 1999 Microsoft Corporation. All rights reserved.
+
+   File:       cbrsim.c
+
+
+Abstract:
+
+	Offline simulator of the CBR schedule of the Toshiba ATM 155
+	driver.  Builds cbrsched.c unchanged, opens a set of CBR VCs one
+	after another the way tbAtm155SetCbrTblsInSRAM does, then closes
+	every other one, and reports:
+
+	-   the SRAM writes the changes took, against the reads and writes
+	    of every table entry the driver used to make on each change,
+	-   the cell spacing each VC gets from the compiled table: the
+	    ideal spacing, the largest gap and the CDV, Cell Delay
+	    Variation, as the peak to peak difference between the slot of
+	    each cell and its ideal slot.
+
+	The VCs are given by their peak cell rates in cells/s, as a list
+	or, by default, a mix of 64 Kb/s, T1 and E1 circuits.  Each takes
+	the number of schedule entries tbAtm155AdjustTrafficParameters
+	gives it when rounding the flow up.  cbrsim exits with 1 if a
+	compiled table does not hold exactly the entries of its VCs.
+
+	usage: cbrsim [-n<VCs>] [-r<PCR>[,<PCR>...]] [-v]
+
+Author:
+
+Environment:
+
+	User mode
+
+Revision History:
+
+--*/
+
+#define TBATM155_CBRSIM 1
+#include "..\cbrsched.c"
+
+
+#define DEFAULT_VCS            200
+#define FIRST_VCI              32
+#define MAX_RATES              64
+
+//
+//	One entry of the schedule table is one cell time at the line rate.
+//
+#define SLOT_TIME_US           (1000000.0 / TBATM155_MAX_BANDWIDTH)
+
+
+//
+//	The default mix: 64 Kb/s voice, T1 and E1 circuits.
+//
+ULONG  DefaultRates[] = { 150, 150, 150, 150, 150, 150, 150, 150, 3642, 4831 };
+
+#define NUM_DEFAULT_RATES      (sizeof(DefaultRates) / sizeof(DefaultRates[0]))
+
+
+TBATM155_CBR_SCHEDULE  Schedule;
+ULONG                  Current;            // the table the SAR is running
+ULONG                  Errors;
+
+
+USHORT
+NumOfEntriesForRate(
+   IN  ULONG   PeakCellRate
+   )
+/*++
+
+Routine Description:
+
+   The number of schedule entries tbAtm155AdjustTrafficParameters
+   gives a flow when rounding it up.  Rates below the cell clock take
+   one entry and a pre-scale.
+
+--*/
+{
+   ULONG   NumOfEntries;
+
+   NumOfEntries = (PeakCellRate + TBATM155_CELL_CLOCK_RATE - 1) /
+                       TBATM155_CELL_CLOCK_RATE;
+
+   return((USHORT)((NumOfEntries == 0) ? 1 : NumOfEntries));
+}
+
+
+VOID
+CheckTable(
+   VOID
+   )
+/*++
+
+Routine Description:
+
+   Checks that the compiled table holds the entries of every VC of
+   the schedule, nothing else, and EOT on the last entry only.
+
+--*/
+{
+   TBATM155_CBR_SCHEDULE_ENTRY     phEntry;
+   ULONG                           VcIdx, Idx, Count, Total = 0;
+
+   for (VcIdx = 0; VcIdx < Schedule.NumOfVcs; VcIdx++)
+   {
+       for (Idx = 0, Count = 0; Idx < MAX_CBR_SCHEDULE_ENTRIES; Idx++)
+       {
+           phEntry.data = Schedule.Table[Idx];
+
+           if (phEntry.Active && (phEntry.VC == Schedule.Vc[VcIdx].Vci))
+           {
+               Count++;
+           }
+       }
+
+       if (Count != Schedule.Vc[VcIdx].NumOfEntries)
+       {
+           printf("VC %u has %lu entries instead of %u\n",
+               Schedule.Vc[VcIdx].Vci, Count, Schedule.Vc[VcIdx].NumOfEntries);
+           Errors++;
+       }
+
+       Total += Count;
+   }
+
+   for (Idx = 0, Count = 0; Idx < MAX_CBR_SCHEDULE_ENTRIES; Idx++)
+   {
+       phEntry.data = Schedule.Table[Idx];
+
+       if (phEntry.Active)
+       {
+           Count++;
+       }
+
+       if (phEntry.EOT != (Idx == (MAX_CBR_SCHEDULE_ENTRIES - 1)))
+       {
+           printf("EOT wrong on entry %lu\n", Idx);
+           Errors++;
+       }
+   }
+
+   if (Count != Total)
+   {
+       printf("%lu active entries belong to no VC\n", Count - Total);
+       Errors++;
+   }
+}
+
+
+ULONG
+SwitchTables(
+   VOID
+   )
+/*++
+
+Routine Description:
+
+   Compiles the schedule and writes it to the standby table the way
+   tbAtm155SetCbrTblsInSRAM does, then switches to it.
+
+Return Value:
+
+   The number of SRAM writes.
+
+--*/
+{
+   PUSHORT     pStSram = Schedule.Sram[Current ^ 1];
+   ULONG       Idx, Writes = 0;
+
+   tbAtm155CompileCbrSchedule(&Schedule);
+
+   CheckTable();
+
+   for (Idx = 0; Idx < MAX_CBR_SCHEDULE_ENTRIES; Idx++)
+   {
+       if (pStSram[Idx] != Schedule.Table[Idx])
+       {
+           pStSram[Idx] = Schedule.Table[Idx];
+           Writes++;
+       }
+   }
+
+   Current ^= 1;
+
+   return(Writes);
+}
+
+
+ULONG
+OldPeepholeOps(
+   IN  USHORT  NumOfEntries
+   )
+/*++
+
+Routine Description:
+
+   The fewest peephole reads and writes the old tbAtm155SetCbrTblsInSRAM
+   made for a change: it copied the whole table entry by entry, read
+   each entry it was about to take, and read and wrote the last entry
+   to set EOT.
+
+--*/
+{
+   return((2 * MAX_CBR_SCHEDULE_ENTRIES) + (2 * NumOfEntries) + 2);
+}
+
+
+VOID
+ReportSpacing(
+   IN  PULONG  Rates,
+   IN  ULONG   NumOfVcs,
+   IN  BOOLEAN fVerbose
+   )
+/*++
+
+Routine Description:
+
+   Reports the cell spacing of each VC in the running table, per VC
+   if fVerbose, and per peak cell rate in any case.
+
+--*/
+{
+   TBATM155_CBR_SCHEDULE_ENTRY     phEntry;
+   PUSHORT                         pTable = Schedule.Sram[Current];
+   ULONG                           VcIdx, Idx, Count, First, Prev, Gap;
+   ULONG                           MaxGap, Rate, Class;
+   double                          Spacing, Offset, MinOffset, MaxOffset, Cdv;
+   double                          ClassWorst, ClassSum;
+   ULONG                           ClassVcs, ClassMaxGap;
+   USHORT                          NumOfEntries;
+
+   if (fVerbose)
+   {
+       printf("    VCI      PCR  entries  spacing  max gap  CDV (us)\n");
+   }
+
+   for (Class = 0; Class < NumOfVcs; Class++)
+   {
+       Rate = Rates[Class];
+
+       //
+       //  Only report each rate once, at its first VC.
+       //
+       for (Idx = 0; (Idx < Class) && (Rates[Idx] != Rate); Idx++)
+           ;
+
+       if ((Idx < Class) && !fVerbose)
+       {
+           continue;
+       }
+
+       ClassVcs = 0;
+       ClassWorst = 0;
+       ClassSum = 0;
+       ClassMaxGap = 0;
+
+       for (VcIdx = 0; VcIdx < NumOfVcs; VcIdx++)
+       {
+           if ((Rates[VcIdx] != Rate) || (fVerbose && (VcIdx != Class)))
+           {
+               continue;
+           }
+
+           NumOfEntries = NumOfEntriesForRate(Rate);
+           Spacing = (double)MAX_CBR_SCHEDULE_ENTRIES / NumOfEntries;
+
+           MinOffset = MaxOffset = 0;
+           MaxGap = 0;
+           First = Prev = 0;
+
+           for (Idx = 0, Count = 0; Idx < MAX_CBR_SCHEDULE_ENTRIES; Idx++)
+           {
+               phEntry.data = pTable[Idx];
+
+               if (!phEntry.Active || (phEntry.VC != (FIRST_VCI + VcIdx)))
+               {
+                   continue;
+               }
+
+               if (Count == 0)
+               {
+                   First = Idx;
+               }
+               else
+               {
+                   Gap = Idx - Prev;
+                   if (Gap > MaxGap)
+                   {
+                       MaxGap = Gap;
+                   }
+               }
+
+               Offset = (Idx - First) - (Count * Spacing);
+               if (Offset < MinOffset)
+               {
+                   MinOffset = Offset;
+               }
+               if (Offset > MaxOffset)
+               {
+                   MaxOffset = Offset;
+               }
+
+               Prev = Idx;
+               Count++;
+           }
+
+           if (Count == 0)
+           {
+               //
+               //  Closed, or never fit.
+               //
+               continue;
+           }
+
+           Gap = First + MAX_CBR_SCHEDULE_ENTRIES - Prev;
+           if (Gap > MaxGap)
+           {
+               MaxGap = Gap;
+           }
+
+           Cdv = (MaxOffset - MinOffset) * SLOT_TIME_US;
+
+           if (fVerbose)
+           {
+               printf("%7lu %8lu %8u %8.1f %8lu %9.1f\n",
+                   FIRST_VCI + VcIdx, Rate, NumOfEntries, Spacing, MaxGap, Cdv);
+           }
+
+           ClassVcs++;
+           ClassSum += Cdv;
+           if (Cdv > ClassWorst)
+           {
+               ClassWorst = Cdv;
+           }
+           if (MaxGap > ClassMaxGap)
+           {
+               ClassMaxGap = MaxGap;
+           }
+       }
+
+       if (!fVerbose && (ClassVcs != 0))
+       {
+           printf("%8lu cells/s: %4lu VCs, %4u entries, spacing %7.1f, "
+                  "max gap %5lu, CDV mean %7.1f us, worst %7.1f us\n",
+               Rate,
+               ClassVcs,
+               NumOfEntriesForRate(Rate),
+               (double)MAX_CBR_SCHEDULE_ENTRIES / NumOfEntriesForRate(Rate),
+               ClassMaxGap,
+               ClassSum / ClassVcs,
+               ClassWorst);
+       }
+   }
+}
+
+
+int
+__cdecl
+main(
+   int     argc,
+   char    *argv[]
+   )
+{
+   ULONG       Rates[MAX_CBR_SCHEDULE_ENTRIES];
+   ULONG       RateList[MAX_RATES];
+   ULONG       NumOfRates = 0;
+   ULONG       NumOfVcs = DEFAULT_VCS;
+   BOOLEAN     fVerbose = FALSE;
+   ULONG       Writes, OldOps, Opened, Refused, Closed;
+   ULONG       VcIdx;
+   char        *p;
+   int         arg;
+
+   for (arg = 1; arg < argc; arg++)
+   {
+       if (argv[arg][0] == '-')
+       {
+           switch (argv[arg][1])
+           {
+               case 'n':
+                   NumOfVcs = strtoul(argv[arg] + 2, NULL, 0);
+                   continue;
+
+               case 'r':
+                   for (p = argv[arg] + 2; (*p != '\0') && (NumOfRates < MAX_RATES); )
+                   {
+                       RateList[NumOfRates++] = strtoul(p, &p, 0);
+                       if (*p == ',')
+                       {
+                           p++;
+                       }
+                   }
+                   continue;
+
+               case 'v':
+                   fVerbose = TRUE;
+                   continue;
+           }
+       }
+
+       NumOfVcs = 0;
+       break;
+   }
+
+   if ((NumOfVcs == 0) || (NumOfVcs > MAX_CBR_SCHEDULE_ENTRIES - FIRST_VCI))
+   {
+       printf("usage: cbrsim [-n<VCs>] [-r<PCR>[,<PCR>...]] [-v]\n");
+       return(2);
+   }
+
+   if (NumOfRates == 0)
+   {
+       for (NumOfRates = 0; NumOfRates < NUM_DEFAULT_RATES; NumOfRates++)
+       {
+           RateList[NumOfRates] = DefaultRates[NumOfRates];
+       }
+   }
+
+   for (VcIdx = 0; VcIdx < NumOfVcs; VcIdx++)
+   {
+       Rates[VcIdx] = RateList[VcIdx % NumOfRates];
+
+       if (Rates[VcIdx] == 0)
+       {
+           printf("cbrsim: a peak cell rate of 0\n");
+           return(2);
+       }
+   }
+
+   tbAtm155InitCbrSchedule(&Schedule);
+   Current = 0;
+
+   //
+   //  Open the VCs one after another, as at startup.
+   //
+   Writes = OldOps = Opened = Refused = 0;
+
+   for (VcIdx = 0; VcIdx < NumOfVcs; VcIdx++)
+   {
+       if (NDIS_STATUS_SUCCESS != tbAtm155AddCbrVc(
+                                       &Schedule,
+                                       (USHORT)(FIRST_VCI + VcIdx),
+                                       NumOfEntriesForRate(Rates[VcIdx])))
+       {
+           Rates[VcIdx] = 0;
+           Refused++;
+           continue;
+       }
+
+       Writes += SwitchTables();
+       OldOps += OldPeepholeOps(NumOfEntriesForRate(Rates[VcIdx]));
+       Opened++;
+   }
+
+   printf("opened %lu VCs (%lu did not fit), %lu of %u entries: "
+          "%lu SRAM writes, was at least %lu peephole operations\n",
+       Opened, Refused, Schedule.NumOfEntries, MAX_CBR_SCHEDULE_ENTRIES,
+       Writes, OldOps);
+
+   ReportSpacing(Rates, NumOfVcs, fVerbose);
+
+   //
+   //  Close every other VC.
+   //
+   Writes = OldOps = Closed = 0;
+
+   for (VcIdx = 0; VcIdx < NumOfVcs; VcIdx += 2)
+   {
+       if (Rates[VcIdx] == 0)
+       {
+           continue;
+       }
+
+       tbAtm155RemoveCbrVc(&Schedule, (USHORT)(FIRST_VCI + VcIdx));
+
+       Writes += SwitchTables();
+       OldOps += OldPeepholeOps(0);
+       Rates[VcIdx] = 0;
+       Closed++;
+   }
+
+   printf("closed %lu VCs: %lu SRAM writes, was at least %lu peephole operations\n",
+       Closed, Writes, OldOps);
+
+   ReportSpacing(Rates, NumOfVcs, fVerbose);
+
+   if (Errors != 0)
+   {
+       printf("%lu errors\n", Errors);
+   }
+
+   return((Errors != 0) ? 1 : 0);
+}
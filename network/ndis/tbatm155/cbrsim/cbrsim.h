@@ -0,0 +1,43 @@
+/*++
+
+Copyright (c) 1999 Microsoft Corporation. All rights reserved.
+
+   File:       cbrsim.h
+
+
+Abstract:
+
+	The few NDIS definitions cbrsched.c and the SRAM table definitions
+	need for building them into cbrsim in user mode.
+
+Author:
+
+Environment:
+
+	User mode
+
+Revision History:
+
+--*/
+
+#ifndef __CBRSIM_H
+#define __CBRSIM_H
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef IN
+#define IN
+#endif
+
+#ifndef OUT
+#define OUT
+#endif
+
+typedef int NDIS_STATUS, *PNDIS_STATUS;
+
+#define NDIS_STATUS_SUCCESS    ((NDIS_STATUS)0x00000000L)
+#define NDIS_STATUS_FAILURE    ((NDIS_STATUS)0xC0000001L)
+
+#endif // __CBRSIM_H
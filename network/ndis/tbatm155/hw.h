@@ -108,6 +108,13 @@ typedef struct _RECV_BUFFER_POOL       RECV_BUFFER_POOL, *PRECV_BUFFER_POOL;
 // Note: make sure don't be larger than 25.
 #define DEFAULT_RECEIVE_BUFFERS		    20              
 //
+//  Number of receive buffers a VC may have indicated up before its
+//  packets are indicated with NDIS_STATUS_RESOURCES, and the number it
+//  has to get back under to have them indicated normally again.
+//
+#define RECV_HIGH_WATER_MARK               DEFAULT_RECEIVE_BUFFERS
+#define RECV_LOW_WATER_MARK                (DEFAULT_RECEIVE_BUFFERS / 2)
+//
 //  For SlotTag reason, so new, limited the maximum number of receive buffers 
 //  to be this number.
 //
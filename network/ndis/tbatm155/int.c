@@ -501,6 +501,19 @@ Return Value:
                ("RemainingReceiveBigSlots: %ld\n",
                  pSar->RecvDmaQ.RemainingReceiveBigSlots));
 
+           //
+           //  Count it if there are no free receive buffers left to
+           //  post to the slots.
+           //
+           if (0 == pSar->FreeBigBufferQ.BufferCount)
+           {
+               pSar->BigRecvPoolExhausted++;
+
+               DBGPRINT(DBG_COMP_INT, DBG_LEVEL_ERR,
+                   ("'BIG' receive buffers exhausted: %lu\n",
+                     pSar->BigRecvPoolExhausted));
+           }
+
            tbAtm155QueueRecvBuffersToReceiveSlots(
                pAdapter, 
                RECV_BIG_BUFFER);
@@ -522,6 +535,19 @@ Return Value:
                ("RemainingReceiveSmallSlots: %ld\n",
                  pSar->RecvDmaQ.RemainingReceiveSmallSlots));
 
+           //
+           //  Count it if there are no free receive buffers left to
+           //  post to the slots.
+           //
+           if (0 == pSar->FreeSmallBufferQ.BufferCount)
+           {
+               pSar->SmallRecvPoolExhausted++;
+
+               DBGPRINT(DBG_COMP_INT, DBG_LEVEL_ERR,
+                   ("'SMALL' receive buffers exhausted: %lu\n",
+                     pSar->SmallRecvPoolExhausted));
+           }
+
            tbAtm155QueueRecvBuffersToReceiveSlots(
                pAdapter,
                RECV_SMALL_BUFFER);
@@ -417,6 +417,40 @@ typedef struct _TBATM155_CBR_SCHEDULE_ENTRY
    *PTBATM155_CBR_SCHEDULE_ENTRY;
 
 
+//
+// A CBR VC and the number of entries it takes in the CBR schedule table
+//
+
+typedef struct _TBATM155_CBR_VC
+{
+   USHORT      Vci;
+   USHORT      NumOfEntries;
+}
+   TBATM155_CBR_VC,
+   *PTBATM155_CBR_VC;
+
+
+//
+// The CBR schedule as the driver keeps it in host memory.
+//   Vc[]    -   the CBR VCs, with the most entries first.
+//   Table[] -   the schedule compiled from Vc[] by
+//               tbAtm155CompileCbrSchedule.
+//   Sram[]  -   what CBR schedule tables 1 and 2 on SRAM hold, so only
+//               the entries that differ from Table[] are written.
+//
+
+typedef struct _TBATM155_CBR_SCHEDULE
+{
+   ULONG               NumOfVcs;
+   ULONG               NumOfEntries;
+   TBATM155_CBR_VC     Vc[MAX_CBR_SCHEDULE_ENTRIES];
+   USHORT              Table[MAX_CBR_SCHEDULE_ENTRIES];
+   USHORT              Sram[2][MAX_CBR_SCHEDULE_ENTRIES];
+}
+   TBATM155_CBR_SCHEDULE,
+   *PTBATM155_CBR_SCHEDULE;
+
+
 //
 // structure of entry of ABR Value Table
 //   4 words/entry,  1 entry/VC
@@ -25,6 +25,18 @@ Revision History:
 
 --*/
 
+#ifdef TBATM155_CBRSIM
+
+//
+//	cbrsim builds cbrsched.c in user mode on the SRAM table
+//	definitions alone.
+//
+#include "cbrsim.h"
+#include "hw.h"
+#include "peephole.h"
+
+#else
+
 #include <ndis.h>
 #include <atm.h>
 
@@ -40,4 +52,6 @@ Revision History:
 #include "tbatm155.h"
 #include "tbmeteor.h"
 
+#endif // end of TBATM155_CBRSIM
+
 
@@ -269,6 +269,33 @@ tbAtm155TransmitPacket(
 #endif // end of TB_DBG
     
 
+///
+//	PROTOTYPES FOR CBR schedule
+///
+VOID
+tbAtm155InitCbrSchedule(
+   IN  PTBATM155_CBR_SCHEDULE  pSchedule
+   );
+
+NDIS_STATUS
+tbAtm155AddCbrVc(
+   IN  PTBATM155_CBR_SCHEDULE  pSchedule,
+   IN  USHORT                  Vci,
+   IN  USHORT                  NumOfEntries
+   );
+
+VOID
+tbAtm155RemoveCbrVc(
+   IN  PTBATM155_CBR_SCHEDULE  pSchedule,
+   IN  USHORT                  Vci
+   );
+
+VOID
+tbAtm155CompileCbrSchedule(
+   IN  PTBATM155_CBR_SCHEDULE  pSchedule
+   );
+
+
 ///
 //	PROTOTYPES FOR VC Creation and Deletion
 ///
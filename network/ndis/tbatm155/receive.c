@@ -1594,6 +1594,8 @@ Return Value:
                        ("Slot Congestion detected, discard packet.\n"));
                    NdisInterlockedIncrement(&pVc->StatInfo.RecvCellsDropped);
                    NdisInterlockedIncrement(&pAdapter->StatInfo.RecvCellsDropped);
+                   NdisInterlockedIncrement(&pVc->StatInfo.RecvPdusNoBuffer);
+                   NdisInterlockedIncrement(&pAdapter->StatInfo.RecvPdusNoBuffer);
 				    break;
 
                case OtherCellErrDiscard:
@@ -2142,6 +2144,45 @@ Return Value:
        pAdapter->StatInfo.RecvCellsOk += pSegCompleting->BufferCount;
        pVc->StatInfo.RecvCellsOk += pSegCompleting->BufferCount;
 
+       //
+       //  If the VC holds its share of the receive buffers in packets
+       //  the protocols have not returned yet, indicate this one with
+       //  NDIS_STATUS_RESOURCES so it is copied and the buffers can be
+       //  posted to the receive slots again right away.
+       //
+       NdisDprAcquireSpinLock(&pVc->lock);
+
+       if (pRecvSegInfo->BuffersIndicated >= pRecvSegInfo->RecvHighWaterMark)
+       {
+           pRecvSegInfo->fRecvOverWaterMark = TRUE;
+       }
+       else if (pRecvSegInfo->BuffersIndicated < pRecvSegInfo->RecvLowWaterMark)
+       {
+           pRecvSegInfo->fRecvOverWaterMark = FALSE;
+       }
+
+       if (pRecvSegInfo->fRecvOverWaterMark)
+       {
+           Status = NDIS_STATUS_RESOURCES;
+
+           pAdapter->StatInfo.RecvPdusCopied++;
+           pVc->StatInfo.RecvPdusCopied++;
+       }
+       else
+       {
+           Status = NDIS_STATUS_SUCCESS;
+
+           pRecvSegInfo->BuffersIndicated += pSegCompleting->BufferCount;
+
+           RECV_BUFFER_SET_FLAG(
+               pSegCompleting->BufListHead,
+               fRECV_BUFFER_INDICATED);
+       }
+
+       NdisDprReleaseSpinLock(&pVc->lock);
+
+       NDIS_SET_PACKET_STATUS(Packet, Status);
+
        //
        //  Initialize the queue to ready to receive the next packet
        //  for this VC.
@@ -2155,8 +2196,6 @@ Return Value:
        //
        NdisDprReleaseSpinLock(&pRecvDmaQ->lock);
 
-		Status = NDIS_GET_PACKET_STATUS(Packet);
-
        NdisMCoIndicateReceivePacket(pVc->NdisVcHandle, &Packet, 1);
 
        NdisDprAcquireSpinLock(&pRecvDmaQ->lock);
@@ -2346,6 +2385,8 @@ Return Value:
    UCHAR               BufferType = pVc->RecvBufType;
    PSAR_INFO			pSar = pAdapter->HardwareInfo->SarInfo;
    PRECV_BUFFER_QUEUE  pBufferQ;
+   BOOLEAN             fIndicated;
+   ULONG               BufferCount = 0;
 
    DBGPRINT(DBG_COMP_RECV, DBG_LEVEL_INFO,
        ("==>tbAtm155ProcessReturnPacket\n"));
@@ -2366,6 +2407,14 @@ Return Value:
        pBufferQ = &pSar->FreeSmallBufferQ;
    }
 
+   //
+   //	Was the packet indicated up, rather than dropped or copied?
+   //	The flag has to be cleared before the buffer is back on the
+   //	free queue.
+   //
+   fIndicated = RECV_BUFFER_TEST_FLAG(pRecvHeader, fRECV_BUFFER_INDICATED);
+   RECV_BUFFER_CLEAR_FLAG(pRecvHeader, fRECV_BUFFER_INDICATED);
+
    //
    //	Walk the list and reset the buffer lengths.
    //
@@ -2382,6 +2431,8 @@ Return Value:
 
        tbAtm155InsertRecvBufferAtTail(pBufferQ, ptmpRecvHeader, TRUE);
 
+       BufferCount++;
+
    } // end of FOR
 
    dbgLogRecvPacket(pVc->DebugInfo, pRecvInfo, pBufferQ->BufferCount,  0, 'tncp');
@@ -2395,6 +2446,17 @@ Return Value:
    //	Decrement the outstanding references on the VC.
    //
    NdisAcquireSpinLock(&pVc->lock);
+
+   //
+   //	Give the buffers back to the VC's share.
+   //
+   if (fIndicated && (NULL != pVc->RecvSegInfo))
+   {
+       ASSERT(pVc->RecvSegInfo->BuffersIndicated >= BufferCount);
+
+       pVc->RecvSegInfo->BuffersIndicated -= BufferCount;
+   }
+
    tbAtm155DereferenceVc(pVc);
    if ((1 == pVc->References) && (VC_TEST_FLAG(pVc, fVC_DEACTIVATING)))
    {
@@ -77,6 +77,9 @@ NDIS_OID gTbAtm155OidListSupported[] =
    OID_TBATM_READ_PEEPHOLE,
    OID_TBATM_WRITE_CSR,
    OID_TBATM_READ_CSR,
+   OID_TBATM_RCV_PDUS_COPIED,
+   OID_TBATM_RCV_BIG_POOL_EXHAUSTED,
+   OID_TBATM_RCV_SMALL_POOL_EXHAUSTED,
    // custom oid WMI support
    OID_VENDOR_STRING
 };
@@ -897,6 +900,27 @@ Return Value:
 
 			break;
 
+		case OID_TBATM_RCV_PDUS_COPIED:
+
+			Data = pStatInfo->RecvPdusCopied;
+
+			break;
+
+		//
+		//	The receive buffer pools are shared by all the VCs.
+		//
+		case OID_TBATM_RCV_BIG_POOL_EXHAUSTED:
+
+			Data = pAdapter->HardwareInfo->SarInfo->BigRecvPoolExhausted;
+
+			break;
+
+		case OID_TBATM_RCV_SMALL_POOL_EXHAUSTED:
+
+			Data = pAdapter->HardwareInfo->SarInfo->SmallRecvPoolExhausted;
+
+			break;
+
 		default:
 
 			DBGPRINT(DBG_COMP_REQUEST, DBG_LEVEL_ERR,
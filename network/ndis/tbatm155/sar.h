@@ -838,6 +838,13 @@ struct _SAR_INFO
    //
    USHORT                  MaxRecvBufferCount;
 
+   //
+   //  Number of times the "Big" or "Small" receive slots ran low with
+   //  no free receive buffers left to post to them.
+   //
+   ULONG                   BigRecvPoolExhausted;
+   ULONG                   SmallRecvPoolExhausted;
+
 #if    DBG
 
    //
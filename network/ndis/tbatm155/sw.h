@@ -160,6 +160,19 @@ typedef struct _RECV_BUFFER_HEADER
 
 #define RECV_BUFFER_HEADER_SIG         0x30303030
 
+//
+//	Flag definitions for the receive buffer.  These are only set on the
+//	first receive buffer of a packet.
+//
+#define fRECV_BUFFER_INDICATED         0x00000001
+
+//
+//	Macros used for accessing the receive buffer flags
+//
+#define RECV_BUFFER_TEST_FLAG(x, f)    (((x)->Flags & (f)) == (f))
+#define RECV_BUFFER_SET_FLAG(x, f)     ((x)->Flags |= (f))
+#define RECV_BUFFER_CLEAR_FLAG(x, f)   ((x)->Flags &= ~(f))
+
 //
 //	Indices into the ALLOCATION_INFO array...
 //
@@ -373,6 +386,22 @@ struct _RECV_SEG_INFO
    PRECV_BUFFER_QUEUE          FreeSmallBufQ;
    PRECV_BUFFER_QUEUE          FreeBigBufQ;
 
+   //
+   //	Number of receive buffers in the packets of this VC that have
+   //	been indicated up and not returned yet.  Once it reaches
+   //	RecvHighWaterMark the packets are indicated with
+   //	NDIS_STATUS_RESOURCES, so the protocols copy them and the buffers
+   //	go straight back to the receive slots, until it is back under
+   //	RecvLowWaterMark.  This keeps a bursty VC from holding the receive
+   //	buffers all of the other VCs receive into.
+   //
+   //	These are protected by the VC_BLOCK's lock.
+   //
+   ULONG                       BuffersIndicated;
+   ULONG                       RecvHighWaterMark;
+   ULONG                       RecvLowWaterMark;
+   BOOLEAN                     fRecvOverWaterMark;
+
    NDIS_SPIN_LOCK			    lock;
 };
 
@@ -702,6 +731,11 @@ typedef struct _HARDWARE_INFO
 	ULONG	        pSramCbrScheduleTbl_1;  // Point to CBR schedule table 1.
 	ULONG	        pSramCbrScheduleTbl_2;  // Point to CBR schedule table 2.
 
+   //
+   //  The CBR schedule, compiled in host memory.
+   //
+   TBATM155_CBR_SCHEDULE   CbrSchedule;
+
 	//
 	//	address of the adapter.
 	//
@@ -740,6 +774,7 @@ typedef struct _TBATM155_STATISTICS_INFO
    ULONG   RecvCellsDropped;
    ULONG   RecvInvalidVpiVci;
    ULONG   RecvReassemblyErr;
+   ULONG   RecvPdusCopied;         // indicated with NDIS_STATUS_RESOURCES
 }
    TBATM155_STATISTICS_INFO,
    *PTBATM155_STATISTICS_INFO;
@@ -46,6 +46,7 @@ Revision History:
 #define MODULE_SUNI_LITE   0x000c0000
 #define MODULE_PLC2        0x000d0000
 #define MODULE_TBMETEOR    0x000e0000
+#define MODULE_CBRSCHED    0x000f0000
 
 
 //
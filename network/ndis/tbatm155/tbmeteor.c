@@ -146,6 +146,12 @@ Return Value:
            break;
        }       
        
+       //
+       //  Start the CBR schedule kept in host memory off empty, with
+       //  the copies of both tables as they were just written.
+       //
+       tbAtm155InitCbrSchedule(&pHwInfo->CbrSchedule);
+
        
        //
        //  Initialize the ACR lookup table structure, containing 512 1-word 
@@ -289,6 +295,12 @@ Return Value:
            break;
        }       
        
+       //
+       //  Start the CBR schedule kept in host memory off empty, with
+       //  the copies of both tables as they were just written.
+       //
+       tbAtm155InitCbrSchedule(&pHwInfo->CbrSchedule);
+
        
        //
        //  Initialize the ACR lookup table structure, containing 512 1-word 
@@ -45,5 +45,8 @@ typedef struct {                   // structure to access CSR
 #define OID_TBATM_READ_PEEPHOLE    0xFF102F02
 #define OID_TBATM_WRITE_CSR        0xFF102F03
 #define OID_TBATM_READ_CSR	        0xFF102F04
+#define OID_TBATM_RCV_PDUS_COPIED           0xFF102F05 // statistics, per VC or adapter
+#define OID_TBATM_RCV_BIG_POOL_EXHAUSTED    0xFF102F06 // statistics, adapter
+#define OID_TBATM_RCV_SMALL_POOL_EXHAUSTED  0xFF102F07 // statistics, adapter
 #define OID_VENDOR_STRING	        0xFF102F10
 
@@ -628,6 +628,12 @@ Routine Description:
 
    This routine will setup the tables for CBR flow on on-board SRAM.
 
+   The VC is added to or removed from the CBR schedule kept in host
+   memory and the schedule table is compiled there for all of the CBR
+   VCs.  Only the entries of the standby table on SRAM that differ
+   from the compiled table are written, then the SAR is switched to
+   the standby table.
+
 Arguments:
 
    pAdapter    -   Pointer to the adapter to program.
@@ -643,21 +649,12 @@ Return Value:
 --*/
 {
    PHARDWARE_INFO                  pHwInfo = pAdapter->HardwareInfo;
-   PXMIT_SEG_INFO                  pXmitSegInfo = pVc->XmitSegInfo;
-   PATM_FLOW_PARAMETERS            pXmitFlow = &pVc->Transmit;
+   PTBATM155_CBR_SCHEDULE          pSchedule = &pHwInfo->CbrSchedule;
    TB155PCISAR_CNTRL1              regControl1;
-   TBATM155_CBR_SCHEDULE_ENTRY     phData;
-   ULONG                           pCurrCbrTbl, pStCbrTbl, pAddr;
+   ULONG                           pStCbrTbl;
+   PUSHORT                         pStSram;
    USHORT                          Idx;
    NDIS_STATUS                     Status;
-   ULONG                           pEndCbrTbl;
-   USHORT                          CellInterval, Curr_CI;
-   USHORT                          Count_Fract_CI, Indx_Fract_CI;
-   ULONG                           pTemp;
-   BOOLEAN                         fFound1stEntry = FALSE;
-   TBATM155_CBR_SCHEDULE_ENTRY     phOpenVc;
-   ULONG                           bak_pAddr, bak_pTemp;
-   ULONG                           pEntryAddr_1st;
 
    DBGPRINT(DBG_COMP_VC, DBG_LEVEL_INFO, 
                ("==>tbAtm155SetCbrTblsInSRAM\n"));
@@ -669,305 +666,96 @@ Return Value:
    if (regControl1.CBR_ST_Sel == 0)
    {
        //
-       // 1. Set CBR schedule table 1 is currently used.
-       // 2. Set the CBR schedule table 2 is selected. 
+       // 1. CBR schedule table 1 is currently used.
+       // 2. Set up CBR schedule table 2.
        // 3. Set CBR_ST_Sel bit to select CBR schedule table 2.
        //
-       pCurrCbrTbl = pHwInfo->pSramCbrScheduleTbl_1;
-       pStCbrTbl  = pHwInfo->pSramCbrScheduleTbl_2;
+       pStCbrTbl = pHwInfo->pSramCbrScheduleTbl_2;
+       pStSram = pSchedule->Sram[1];
        regControl1.CBR_ST_Sel = 1;
    }
    else
    {
        //
-       // 1. Set CBR schedule table 2 is Currently used.
-       // 2. Set the CBR schedule table 1 is selected.
+       // 1. CBR schedule table 2 is currently used.
+       // 2. Set up CBR schedule table 1.
        // 3. Set CBR_ST_Sel bit to select CBR schedule table 1.
        //
-       pCurrCbrTbl = pHwInfo->pSramCbrScheduleTbl_2;
-       pStCbrTbl  = pHwInfo->pSramCbrScheduleTbl_1;
+       pStCbrTbl = pHwInfo->pSramCbrScheduleTbl_1;
+       pStSram = pSchedule->Sram[0];
        regControl1.CBR_ST_Sel = 0;
    }
 
    do
    {   
-       // 
-       // 1. Copy contents of Schedule tables from "Current" to "Select"
-       // 2. Find the 1st "active=0" entry as well.
-       // 
-       for (Idx = 0, pAddr = pStCbrTbl;
-            Idx < MAX_CBR_SCHEDULE_ENTRIES;
-            Idx++, pCurrCbrTbl++, pAddr++)
+       if (fOpenVC)
        {
-           TBATM155_PH_READ_SRAM(pAdapter, pCurrCbrTbl, &phData.data, &Status);
-           if (NDIS_STATUS_SUCCESS != Status)
-           {
-               DBGPRINT(DBG_COMP_INIT,DBG_LEVEL_ERR,
-                   ("Failed rd CBR Schedule table (copy)! \n"));
-               break;
-           }
-       
-           if ((fOpenVC == FALSE) && (phData.VC == pVc->VpiVci.Vci))
-           {
-               //
-               // if this entry is not void or the VC is de-activated.
-               //
-               phData.data = 0;
-           }
-
-           if (fFound1stEntry == FALSE)
-           {
-               if (phData.Active == 0)
-               {
-                   // 
-                   // Found the 1st of the "active=0 entry.
-                   // 1. remember the address 
-                   // 2. set the flag to indicate the entry has been found.
-                   // 
-                   pEntryAddr_1st = pAddr;
-                   fFound1stEntry = TRUE;
-               }
-           }
+           Status = tbAtm155AddCbrVc(
+                       pSchedule,
+                       (USHORT)pVc->VpiVci.Vci,
+                       (USHORT)pVc->CbrNumOfEntris);
 
-           //
-           // copy this entry to destination also reset the EOT regardless.
-           //
-           phData.EOT = 0;
-           TBATM155_PH_WRITE_SRAM(pAdapter, pAddr, phData.data, &Status);
            if (NDIS_STATUS_SUCCESS != Status)
            {
-               DBGPRINT(DBG_COMP_INIT,DBG_LEVEL_ERR,
-                   ("Failed wr CBR Schedule table (Copy)! \n"));
+               DBGPRINT(DBG_COMP_VC, DBG_LEVEL_ERR,
+                   ("Not enough entries on CBR schedule table.!\n"));
                break;
            }
-
-       } // end of FOR
-
-       //
-       //  Remember the end of destination CBR table to use later.
-       //
-       pEndCbrTbl = pAddr - 1;
-
-       if ((NDIS_STATUS_SUCCESS != Status) || (fOpenVC != TRUE))
-       {
-           //
-           // Exit, due to either
-           // 1. error detected, or
-           // 2. don't need to handle activate any entries for a new VC.
-           //
-           break;
        }
-
-       //
-       // Calculate all of the variables for handling CDV, Cell Delay
-       // Variation, correctly.
-       //
-       CellInterval = (USHORT)(MAX_CBR_SCHEDULE_ENTRIES / pVc->CbrNumOfEntris);
-       Curr_CI = CellInterval;
-
-       Count_Fract_CI = 0;
-       if (MAX_CBR_SCHEDULE_ENTRIES % pVc->CbrNumOfEntris)
+       else
        {
-           // 
-           // Handle the fraction of the difference between the theorical
-           // interval and actual interval on CBR schedule table.
-           // 
-           Count_Fract_CI = (USHORT) (pVc->CbrNumOfEntris / 
-                                     (MAX_CBR_SCHEDULE_ENTRIES % pVc->CbrNumOfEntris));
-           Count_Fract_CI = Count_Fract_CI + 1;
-           Indx_Fract_CI = Count_Fract_CI;
+           tbAtm155RemoveCbrVc(pSchedule, (USHORT)pVc->VpiVci.Vci);
        }
 
+       tbAtm155CompileCbrSchedule(pSchedule);
+
        //
-       // Set up the necessary entry data of the activated VC.
+       // Write the entries of the standby table that changed.
        //
-       phOpenVc.data = 0;
-       phOpenVc.VC = (USHORT)pVc->VpiVci.Vci;
-       phOpenVc.Active = 1;
+       Status = NDIS_STATUS_SUCCESS;
 
-       // 
-       // Set up the entries of the VC
-       // 
-       for (pAddr = pEntryAddr_1st, Idx = (USHORT)pVc->CbrNumOfEntris;
-            Idx > 0;
-            Curr_CI = CellInterval, Idx--)
+       for (Idx = 0; Idx < MAX_CBR_SCHEDULE_ENTRIES; Idx++)
        {
-           TBATM155_PH_READ_SRAM(pAdapter, pAddr, &phData.data, &Status);
-           if (NDIS_STATUS_SUCCESS != Status)
-           {
-               DBGPRINT(DBG_COMP_INIT,DBG_LEVEL_ERR,
-                   ("Failed wr CBR Schedule table (Add more Entries)! \n"));
-               break;
-           }
-
-           if (phData.Active == 1)
-           {
-               //
-               // Let's find an available CBR entry around this pAddr.
-               //
-               for (pTemp = 1; TRUE; pTemp++)
-               {
-                   //
-                   // Let's looking for available entry around 
-                   // pAddr (+/-) pTemp
-                   // Make sure not over the beginning and the end of 
-                   // the CBR table.
-                   //
-                   if ((pAddr + pTemp) <= pEndCbrTbl)
-                   {
-                       //
-                       // Check if (pAddr + pTemp) entry is available
-                       //
-                       TBATM155_PH_READ_SRAM(
-                           pAdapter, 
-                           (pAddr + pTemp), 
-                           &phData.data, 
-                           &Status);
-
-                       if (NDIS_STATUS_SUCCESS != Status)
-                       {
-                           DBGPRINT(DBG_COMP_INIT,DBG_LEVEL_ERR,
-                               ("Failed wr CBR Schedule table (Add more Entries)! \n"));
-                           break;
-                       }
-
-                       if (phData.Active == 0)
-                       {
-                           //
-                           // Adjust Cell interval for the next entry.
-                           //
-                           pAddr += pTemp;
-                           if (Curr_CI > (USHORT) pTemp)
-                           {
-                               Curr_CI -= (USHORT) pTemp;
-                           }
-                           else
-                           {
-                               Curr_CI = 1;
-                           }
-                           break;
-                       }
-                   }
-
-                   if ((pAddr - pTemp) >= pStCbrTbl) 
-                   {
-                       //
-                       // Check if (pAddr - pTemp) entry is available
-                       //
-                       TBATM155_PH_READ_SRAM(
-                           pAdapter, 
-                           (pAddr - pTemp), 
-                           &phData.data, 
-                           &Status);
-
-                       if (NDIS_STATUS_SUCCESS != Status)
-                       {
-                           DBGPRINT(DBG_COMP_INIT,DBG_LEVEL_ERR,
-                               ("Failed wr CBR Schedule table (Add more Entries)! \n"));
-                           break;
-                       }
-
-                       if (phData.Active == 0)
-                       {
-                           //
-                           // Adjust Cell interval for the next entry.
-                           //
-                           pAddr -= pTemp;
-                           Curr_CI += (USHORT) pTemp;
-                           break;
-                       }
-                   }
-
-                   if (((pAddr + pTemp) > pEndCbrTbl) || ((pAddr - pTemp) < pStCbrTbl))
-                   {
-                       Status = NDIS_STATUS_FAILURE;
-
-                       DBGPRINT(DBG_COMP_SPECIAL, DBG_LEVEL_ERR,
-                               ("Failed to write CBR Schedule table! \n"));
-
-                       DBGBREAK(DBG_COMP_SPECIAL, DBG_LEVEL_FATAL);
-
-                       break;
-                   }
-               } // end of FOR (pTemp = 1; TRUE; pTemp++)
-           } // end of (phData.Active == 1)
-
-           if (NDIS_STATUS_SUCCESS != Status)
-           {
-               break;
-           }
-
-           TBATM155_PH_WRITE_SRAM(pAdapter, pAddr, phOpenVc.data, &Status);
-           if (NDIS_STATUS_SUCCESS != Status)
+           if (pStSram[Idx] != pSchedule->Table[Idx])
            {
-               DBGPRINT(DBG_COMP_INIT,DBG_LEVEL_ERR,
-                   ("Failed wr CBR Schedule table (Copy)! \n"));
-               break;
-           }
+               TBATM155_PH_WRITE_SRAM(
+                   pAdapter,
+                   (pStCbrTbl + Idx),
+                   pSchedule->Table[Idx],
+                   &Status);
 
-           if (Count_Fract_CI > 0) 
-           {
-               Indx_Fract_CI--;
-               if (Indx_Fract_CI == 0)
+               if (NDIS_STATUS_SUCCESS != Status)
                {
-                   Indx_Fract_CI = Count_Fract_CI;
-                   Curr_CI++;
+                   DBGPRINT(DBG_COMP_INIT,DBG_LEVEL_ERR,
+                       ("Failed wr CBR Schedule table! \n"));
+                   break;
                }
-           }
 
-           pAddr += (ULONG) Curr_CI;
-           if (pAddr > pEndCbrTbl)
-           {
-               //
-               // wrap around. But we should never get into this case.
-               //
-               pAddr = pEntryAddr_1st + (CellInterval / 2);
-           }       
-
-       } // end of FOR 
-
-       if (NDIS_STATUS_SUCCESS != Status)
-       {
-           break;
+               pStSram[Idx] = pSchedule->Table[Idx];
+           }
        }
-   
-   } while (FALSE);
 
-   if (NDIS_STATUS_SUCCESS == Status)
-   {
-       do
+       if (NDIS_STATUS_SUCCESS != Status)
        {
            //
-           // Set EOT to the CBR table now.
+           // The tables on SRAM are left alone, so take the VC back out.
            //
-           TBATM155_PH_READ_SRAM(pAdapter, pEndCbrTbl, &phData.data, &Status);
-           if (NDIS_STATUS_SUCCESS != Status)
-           {
-               DBGPRINT(DBG_COMP_INIT,DBG_LEVEL_ERR,
-                   ("Failed rd CBR Schedule table (copy)! \n"));
-               break;
-           }
-
-           phData.EOT = 1;
-       
-           TBATM155_PH_WRITE_SRAM(pAdapter, pEndCbrTbl, phData.data, &Status);
-           if (NDIS_STATUS_SUCCESS != Status)
+           if (fOpenVC)
            {
-               DBGPRINT(DBG_COMP_INIT,DBG_LEVEL_ERR,
-                   ("Failed wr CBR Schedule table (Add more Entries)! \n"));
-               break;
+               tbAtm155RemoveCbrVc(pSchedule, (USHORT)pVc->VpiVci.Vci);
            }
 
-           //
-           // Select to the new setup CBR schedule table.
-           //
-           TBATM155_WRITE_PORT(
-               &pHwInfo->TbAtm155_SAR->SAR_Cntrl1,
-               regControl1.reg);
+           break;
+       }
 
-       } while (FALSE);
+       //
+       // Select to the new setup CBR schedule table.
+       //
+       TBATM155_WRITE_PORT(
+           &pHwInfo->TbAtm155_SAR->SAR_Cntrl1,
+           regControl1.reg);
 
-   }
+   } while (FALSE);
 
    DBGPRINT(DBG_COMP_VC, DBG_LEVEL_INFO, 
                ("<==tbAtm155SetCbrTblsInSRAM (Status: 0x%lx)\n", Status));
@@ -1444,6 +1232,13 @@ Return Value:
        pRecvSegInfo->FreeSmallBufQ = &pSar->FreeSmallBufferQ;
        pRecvSegInfo->FreeBigBufQ = &pSar->FreeBigBufferQ;
 
+       //
+       //	The VC may hold as many receive buffers as its pool adds to
+       //	the free receive buffer queues before its packets are copied.
+       //
+       pRecvSegInfo->RecvHighWaterMark = RECV_HIGH_WATER_MARK;
+       pRecvSegInfo->RecvLowWaterMark = RECV_LOW_WATER_MARK;
+
        //
        //	Allocate a receive buffer information structure.
        //
@@ -12,12 +12,20 @@
 #endif
 #endif
 
-#include <winerror.h>
-
 /*****************************************************************************
  * Includes common to all implementation files
  *****************************************************************************/
 
+#ifdef DDKSYNTH_USER_MODE
+
+// The ddkrender host builds the synth core as a user-mode program.
+//
+#include "umhelp.h"
+
+#else // !DDKSYNTH_USER_MODE
+
+#include <winerror.h>
+
 #define PC_NEW_NAMES    1
 
 #include <stdunk.h>
@@ -28,6 +36,9 @@
 #include <dmdls.h>          // DLS definitions
 
 #include "kernhelp.h"
+
+#endif // !DDKSYNTH_USER_MODE
+
 #include "CSynth.h"
 #include "synth.h"
 #include "muldiv32.h"
@@ -96,31 +96,31 @@ HRESULT CControlLogic::Init(CInstManager *pInstruments, CSynth *pSynth)
 	m_pInstruments = pInstruments;
     m_vrGainAdjust = 0;
 
-    m_Notes.Init();
+    HRESULT hr = m_Notes.Init(MIDI_NOTE_EVENTS);
 
     int iRecIdx;
-    for (iRecIdx = 0; iRecIdx < sizeof(m_ModWheel) / sizeof(*m_ModWheel); iRecIdx++)
+    for (iRecIdx = 0; SUCCEEDED(hr) && (iRecIdx < 16); iRecIdx++)
     {
-        m_ModWheel[iRecIdx].Init();
-    }
-    for (iRecIdx = 0; iRecIdx < sizeof(m_PitchBend) / sizeof(*m_PitchBend); iRecIdx++)
-    {
-        m_PitchBend[iRecIdx].Init();
-    }
-    for (iRecIdx = 0; iRecIdx < sizeof(m_Volume) / sizeof(*m_Volume); iRecIdx++)
-    {
-        m_Volume[iRecIdx].Init();
-    }
-    for (iRecIdx = 0; iRecIdx < sizeof(m_Expression) / sizeof(*m_Expression); iRecIdx++)
-    {
-        m_Expression[iRecIdx].Init();
-    }
-    for (iRecIdx = 0; iRecIdx < sizeof(m_Pan) / sizeof(*m_Pan); iRecIdx++)
-    {
-        m_Pan[iRecIdx].Init();
+        hr = m_ModWheel[iRecIdx].Init();
+        if (SUCCEEDED(hr))
+        {
+            hr = m_PitchBend[iRecIdx].Init();
+        }
+        if (SUCCEEDED(hr))
+        {
+            hr = m_Volume[iRecIdx].Init();
+        }
+        if (SUCCEEDED(hr))
+        {
+            hr = m_Expression[iRecIdx].Init();
+        }
+        if (SUCCEEDED(hr))
+        {
+            hr = m_Pan[iRecIdx].Init();
+        }
     }
 
-	return S_OK;
+	return hr;
 }
 
 /*****************************************************************************
@@ -137,11 +137,13 @@ void CControlLogic::ClearMIDI(STIME stEndTime)
         m_fEmpty = TRUE;
         for (dwIndex = 0;dwIndex < 16; dwIndex++)
         {
-            m_fEmpty = m_ModWheel[dwIndex].ClearMIDI(stEndTime)
-                && m_PitchBend[dwIndex].ClearMIDI(stEndTime)
-                && m_Volume[dwIndex].ClearMIDI(stEndTime)
-                && m_Expression[dwIndex].ClearMIDI(stEndTime)
-                && m_Pan[dwIndex].ClearMIDI(stEndTime);
+            // Clear every recorder, even after one reports it is not
+            // yet empty, so none of them keeps old events around.
+            m_fEmpty &= m_ModWheel[dwIndex].ClearMIDI(stEndTime);
+            m_fEmpty &= m_PitchBend[dwIndex].ClearMIDI(stEndTime);
+            m_fEmpty &= m_Volume[dwIndex].ClearMIDI(stEndTime);
+            m_fEmpty &= m_Expression[dwIndex].ClearMIDI(stEndTime);
+            m_fEmpty &= m_Pan[dwIndex].ClearMIDI(stEndTime);
         }
     }
 	::LeaveCriticalSection(&m_CriticalSection);
@@ -344,18 +346,19 @@ void CControlLogic::QueueNotes(STIME stEndTime)
 				}
 			}
 			// While we are working with the instrument, including copying
-			// the data over from the region, we have to make sure it
-			// can not be removed from the instrument list.
-			EnterCriticalSection(&m_pInstruments->m_CriticalSection);
+			// the data over from the region, it can not be removed from
+			// the instrument list: unloading waits for the synth's
+			// critical section, which the mix holds.
+            CSourceRegion * pRegion = NULL;
             CInstrument * pInstrument = 
-                m_pInstruments->GetInstrument(dwProgram,note.m_bKey);
+                m_pInstruments->GetInstrument(dwProgram,note.m_bKey,note.m_bVelocity,&pRegion);
             if (!pInstrument) 
 			{
 				if (dwProgram & F_INSTRUMENT_DRUMS)
 				{
 					dwProgram = F_INSTRUMENT_DRUMS;
 					pInstrument = 
-						m_pInstruments->GetInstrument(dwProgram,note.m_bKey);
+						m_pInstruments->GetInstrument(dwProgram,note.m_bKey,note.m_bVelocity,&pRegion);
 				}
 				else if (m_fXGActive)
 				{
@@ -363,26 +366,24 @@ void CControlLogic::QueueNotes(STIME stEndTime)
 					{
 						dwProgram &= 0x7F007F;				// Enforce 0 LSB
 						pInstrument = 
-							m_pInstruments->GetInstrument(dwProgram,note.m_bKey);
+							m_pInstruments->GetInstrument(dwProgram,note.m_bKey,note.m_bVelocity,&pRegion);
                         if (!pInstrument)
                         {
                             dwProgram = 0x7F0000;
 						    pInstrument = 
-							    m_pInstruments->GetInstrument(dwProgram,note.m_bKey);
+							    m_pInstruments->GetInstrument(dwProgram,note.m_bKey,note.m_bVelocity,&pRegion);
                         }
 					}
                     else
                     {
 						dwProgram &= 0x7F;	// Fall back to GM set.
 						pInstrument = 
-							m_pInstruments->GetInstrument(dwProgram,note.m_bKey);
+							m_pInstruments->GetInstrument(dwProgram,note.m_bKey,note.m_bVelocity,&pRegion);
 					}
 				}
 			}
             if (pInstrument != NULL)
             {
-                CSourceRegion * pRegion = 
-                    pInstrument->ScanForRegion(note.m_bKey);
                 if (pRegion != NULL)
                 {
                     WORD nPart = note.m_bPart;
@@ -463,7 +464,13 @@ void CControlLogic::QueueNotes(STIME stEndTime)
                         {
                             pVoice->m_fInUse = TRUE;
 
-                            m_pSynth->QueueVoice(pVoice);
+                            if (!m_pSynth->QueueVoice(pVoice))
+                            {
+                                pVoice->ClearVoice();
+                                pVoice->m_fInUse = FALSE;
+                                m_pSynth->m_VoicesFree.AddHead(pVoice);
+                                m_pSynth->m_BuildStats.dwNotesLost++;
+                            }
                         }
                         else
                         {
@@ -485,7 +492,6 @@ void CControlLogic::QueueNotes(STIME stEndTime)
                 Trace(1, "No instrument/region was found for patch # %lx, note %ld\n",
                           dwProgram, (long) note.m_bKey);
             }
-			LeaveCriticalSection(&m_pInstruments->m_CriticalSection);
         }
     }
 }
@@ -504,11 +510,11 @@ void CControlLogic::Flush(STIME stTime)
         m_fEmpty = TRUE;
         for (dwIndex = 0;dwIndex < 16; dwIndex++)
         {
-            m_fEmpty = m_ModWheel[dwIndex].FlushMIDI(stTime)
-                && m_PitchBend[dwIndex].FlushMIDI(stTime)
-                && m_Volume[dwIndex].FlushMIDI(stTime)
-                && m_Expression[dwIndex].FlushMIDI(stTime)
-                && m_Pan[dwIndex].FlushMIDI(stTime);
+            m_fEmpty &= m_ModWheel[dwIndex].FlushMIDI(stTime);
+            m_fEmpty &= m_PitchBend[dwIndex].FlushMIDI(stTime);
+            m_fEmpty &= m_Volume[dwIndex].FlushMIDI(stTime);
+            m_fEmpty &= m_Expression[dwIndex].FlushMIDI(stTime);
+            m_fEmpty &= m_Pan[dwIndex].FlushMIDI(stTime);
         }
         m_Notes.FlushMIDI(stTime);
     }
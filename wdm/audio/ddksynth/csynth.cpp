@@ -24,6 +24,7 @@ CSynth::CSynth()
     m_fCSInitialized = FALSE;
     ::InitializeCriticalSection(&m_CriticalSection);
     m_fCSInitialized = TRUE;
+    m_Instruments.m_pMixLock = &m_CriticalSection;
 
     for (nIndex = 0;nIndex < MAX_NUM_VOICES;nIndex++)
     {
@@ -43,9 +44,23 @@ CSynth::CSynth()
     }
 	m_ppControl = NULL;
 	m_dwControlCount = 0;
+    m_StealHeap.Reserve(MAX_NUM_VOICES + NUM_EXTRA_VOICES);
     m_nMaxVoices = MAX_NUM_VOICES;
     m_nExtraVoices = NUM_EXTRA_VOICES; 
     m_stLastStats = 0;
+    m_pMixThreads = NULL;
+    m_dwMixThreads = 0;
+    m_fMixThreadsExit = FALSE;
+    m_dwMixPartitions = 1;
+    m_ppMixVoices = NULL;
+    m_dwMixVoices = 0;
+    m_dwMixVoicesAllocated = 0;
+    m_plMixBuffer = NULL;
+    m_pStreams = NULL;
+    m_pvStreamThread = NULL;
+    m_fStreamThreadExit = FALSE;
+    m_lStreamUnderruns = 0;
+    m_dwInterpolation = MIX_INTERP_LINEAR;
     m_fAllowPanWhilePlayingNote = TRUE;
     m_fAllowVolumeChangeWhilePlayingNote = TRUE;
     ResetPerformanceStats();
@@ -83,6 +98,14 @@ CSynth::~CSynth()
         {
             delete pVoice;
         }
+        if (m_ppMixVoices)
+        {
+            delete [] m_ppMixVoices;
+        }
+        if (m_plMixBuffer)
+        {
+            delete [] m_plMixBuffer;
+        }
         DeleteCriticalSection(&m_CriticalSection);
     }
 }
@@ -133,6 +156,8 @@ static short ChangeVoiceCount(CVoiceList *pList,short nOld,short nCount)
  */
 HRESULT CSynth::SetMaxVoices(short nVoices,short nTempVoices)
 {
+    HRESULT hr;
+
     if (nVoices < 1)
     {
         nVoices = 1;
@@ -144,8 +169,10 @@ HRESULT CSynth::SetMaxVoices(short nVoices,short nTempVoices)
     ::EnterCriticalSection(&m_CriticalSection);
     m_nMaxVoices = ChangeVoiceCount(&m_VoicesFree,m_nMaxVoices,nVoices);
     m_nExtraVoices = ChangeVoiceCount(&m_VoicesExtra,m_nExtraVoices,nTempVoices);
+    // Every voice can be in use at once.
+    hr = m_StealHeap.Reserve(m_nMaxVoices + m_nExtraVoices);
     ::LeaveCriticalSection(&m_CriticalSection);
-    return S_OK;
+    return hr;
 }
 
 /*****************************************************************************
@@ -272,6 +299,16 @@ HRESULT CSynth::Open(DWORD dwCableCount, DWORD dwVoices)
 	{
 		return E_FAIL;	// Already opened.
 	}
+    if (m_plMixBuffer == NULL)
+    {
+        // Always sized for stereo, so a change of mode doesn't need it
+        // reallocated.
+        m_plMixBuffer = new(NonPagedPool,'BSmD') long[MIX_BUS_LENGTH << 1]; //  DmSB
+        if (m_plMixBuffer == NULL)
+        {
+            return E_OUTOFMEMORY;
+        }
+    }
     ::EnterCriticalSection(&m_CriticalSection);
 	hr = SetNumChannelGroups(dwCableCount);
 	if (SUCCEEDED(hr))
@@ -284,6 +321,39 @@ HRESULT CSynth::Open(DWORD dwCableCount, DWORD dwVoices)
 
     m_vrGainAdjust = 0;
     ::LeaveCriticalSection(&m_CriticalSection);
+
+    // Linear interpolation unless the MixInterpolation registry value
+    // asks for cubic (1) or sinc (2).
+    ULONG ulInterpolation;
+    if (GetRegValueDword(TEXT("Software\\Microsoft\\DirectMusic"),
+                         TEXT("MixInterpolation"),
+                         &ulInterpolation) &&
+        (ulInterpolation < MIX_INTERP_COUNT))
+    {
+        m_dwInterpolation = ulInterpolation;
+    }
+
+    // Parallel mixing is off unless the MixThreads registry value asks
+    // for worker threads.  Failing to start them just leaves it off.
+    ULONG ulMixThreads;
+    if (SUCCEEDED(hr) &&
+        GetRegValueDword(TEXT("Software\\Microsoft\\DirectMusic"),
+                         TEXT("MixThreads"),
+                         &ulMixThreads))
+    {
+        StartMixThreads(ulMixThreads);
+    }
+
+    // Waves longer than the StreamThreshold registry value, in samples,
+    // are streamed.  Not set, everything is resident.
+    ULONG ulStreamThreshold;
+    if (SUCCEEDED(hr) &&
+        GetRegValueDword(TEXT("Software\\Microsoft\\DirectMusic"),
+                         TEXT("StreamThreshold"),
+                         &ulStreamThreshold))
+    {
+        SetStreamThreshold(ulStreamThreshold);
+    }
 	return hr;
 }
 
@@ -294,6 +364,8 @@ HRESULT CSynth::Open(DWORD dwCableCount, DWORD dwVoices)
  */
 HRESULT CSynth::Close()
 {
+    StopMixThreads();
+
     ::EnterCriticalSection(&m_CriticalSection);
 	AllNotesOff();
 	DWORD dwX;
@@ -315,6 +387,9 @@ HRESULT CSynth::Close()
 
 
     ::LeaveCriticalSection(&m_CriticalSection);
+
+    // The notes are off, so the streams are all detached.
+    StopStreamThread();
 	return S_OK;
 }
    
@@ -412,48 +487,113 @@ void CSynth::Mix(short *pBuffer,DWORD dwLength,LONGLONG llPosition)
     PAGED_CODE();
 
     STIME stEndTime;
+    STIME stSliceStart;
+    STIME stSliceEnd;
+    DWORD dwSlice;
+    DWORD dwDone;
     CVoice *pVoice;
     CVoice *pNextVoice;
     long lNumVoices = 0;
+#ifdef _X86_
+    // The SSE2 mix kernels use the XMM registers.
+    KFLOATING_SAVE  FloatSave;
+    NTSTATUS        ntFloatStatus = KeSaveFloatingPointState(&FloatSave);
+#endif // _X86_
     ::EnterCriticalSection(&m_CriticalSection);
 
     LONG    lTime = - (LONG)::GetTheCurrentTime();
 
     stEndTime = llPosition + dwLength;
+    if (m_pStreams)
+    {
+        ReleaseStreams();
+    }
 	StealNotes(stEndTime);
 	DWORD dwX;
 	for (dwX = 0; dwX < m_dwControlCount; dwX++)
 	{
 		m_ppControl[dwX]->QueueNotes(stEndTime);
 	}
-    pVoice = m_VoicesInUse.GetHead();
-    for (;pVoice != NULL;pVoice = pNextVoice)
-    {
-        pNextVoice = pVoice->GetNext();
 
-        pVoice->Mix(pBuffer,dwLength,llPosition,stEndTime);
-        lNumVoices++;
+    // Mix as many bus lengths as it takes.  Each pass zeroes the bus, mixes
+    // the voices into it and FinishMix() scales it into the output.
+    for (dwDone = 0; m_plMixBuffer && (dwDone < dwLength); dwDone += dwSlice)
+    {
+        dwSlice = dwLength - dwDone;
+        if (dwSlice > MIX_BUS_LENGTH)
+        {
+            dwSlice = MIX_BUS_LENGTH;
+        }
+        stSliceStart = llPosition + dwDone;
+        stSliceEnd = stSliceStart + dwSlice;
+        RtlZeroMemory(m_plMixBuffer, (dwSlice << m_dwStereo) * sizeof(long));
 
-        if (pVoice->m_fInUse == FALSE) 
+        m_dwMixPartitions = 1;
+        if (m_dwMixThreads)
         {
-            m_VoicesInUse.Remove(pVoice);
-            m_VoicesFree.AddHead(pVoice);
-           // m_BuildStats.dwTotalSamples += (pVoice->m_stStopTime - pVoice->m_stStartTime);
-			if (pVoice->m_stStartTime < m_stLastStats)
-			{
-				m_BuildStats.dwTotalSamples += (long) (pVoice->m_stStopTime - m_stLastStats);
-			}
-			else
-			{
-				m_BuildStats.dwTotalSamples += (long) (pVoice->m_stStopTime - pVoice->m_stStartTime);
-			}
+            m_dwMixLength = dwSlice;
+            m_stMixStart = stSliceStart;
+            m_stMixEnd = stSliceEnd;
+            m_dwMixPartitions = PrepareMixPartitions();
         }
+        if (m_dwMixPartitions > 1)
+        {
+            // The workers take partitions 1 and up, this thread mixes
+            // partition 0 into the bus.
+            for (dwX = 1; dwX < m_dwMixPartitions; dwX++)
+            {
+                KeSetEvent(&m_pMixThreads[dwX - 1].StartEvent, 0, FALSE);
+            }
+            MixPartition(0, m_plMixBuffer);
+            for (dwX = 1; dwX < m_dwMixPartitions; dwX++)
+            {
+                KeWaitForSingleObject(&m_pMixThreads[dwX - 1].DoneEvent,
+                                      Executive, KernelMode, FALSE, NULL);
+            }
+            lNumVoices = m_dwMixVoices;
+        }
+        pVoice = m_VoicesInUse.GetHead();
+        for (;pVoice != NULL;pVoice = pNextVoice)
+        {
+            pNextVoice = pVoice->GetNext();
+
+            if (m_dwMixPartitions == 1)
+            {
+                pVoice->Mix(m_plMixBuffer,dwSlice,stSliceStart,stSliceEnd);
+                lNumVoices++;
+            }
+
+            if (pVoice->m_fInUse == FALSE) 
+            {
+                // Finished voices are retired here, on one thread, since
+                // releasing the wave is not safe from the mix workers.
+                pVoice->ClearVoice();
+                m_StealHeap.Remove(pVoice);
+                m_VoicesInUse.Remove(pVoice);
+                m_VoicesFree.AddHead(pVoice);
+               // m_BuildStats.dwTotalSamples += (pVoice->m_stStopTime - pVoice->m_stStartTime);
+			    if (pVoice->m_stStartTime < m_stLastStats)
+			    {
+				    m_BuildStats.dwTotalSamples += (long) (pVoice->m_stStopTime - m_stLastStats);
+			    }
+			    else
+			    {
+				    m_BuildStats.dwTotalSamples += (long) (pVoice->m_stStopTime - pVoice->m_stStartTime);
+			    }
+            }
+            else if (!pVoice->m_fNoteOn)
+            {
+                // Released voices are stolen quietest first, and the
+                // mix just moved their volume.
+                m_StealHeap.Update(pVoice);
+            }
+        }
+        FinishMix(&pBuffer[dwDone << m_dwStereo],dwSlice);
     }
 	for (dwX = 0; dwX < m_dwControlCount; dwX++)
 	{
 		m_ppControl[dwX]->ClearMIDI(stEndTime);
 	}
-    FinishMix(pBuffer,dwLength);
     if (stEndTime > m_stLastTime)
     {
         m_stLastTime = stEndTime;
@@ -489,64 +629,30 @@ void CSynth::Mix(short *pBuffer,DWORD dwLength,LONGLONG llPosition)
         RtlZeroMemory(&m_BuildStats, sizeof(m_BuildStats));
         m_stLastStats = m_stLastTime;
     }
+    if (m_pStreams)
+    {
+        // Read ahead of where the mix left the streamed voices.
+        KeSetEvent(&m_StreamEvent, 0, FALSE);
+    }
     ::LeaveCriticalSection(&m_CriticalSection);
+#ifdef _X86_
+    if (NT_SUCCESS(ntFloatStatus))
+    {
+        KeRestoreFloatingPointState(&FloatSave);
+    }
+#endif // _X86_
 }
 
 /*****************************************************************************
  * CSynth::OldestVoice()
  *****************************************************************************
  * Get the most likely candidate to be shut down, to support voice stealing.
- * Priority is looked at first, then age.
+ * Priority is looked at first, then age.  Voices already slated to be
+ * returned are passed over.
  */
 CVoice *CSynth::OldestVoice()
 {
-    CVoice *pVoice;
-    CVoice *pBest = NULL;
-    pVoice = m_VoicesInUse.GetHead();
-    pBest = pVoice;
-    if (pBest)
-    {
-        pVoice = pVoice->GetNext();
-        for (;pVoice;pVoice = pVoice->GetNext())
-        {
-		    if (!pVoice->m_fTag)
-		    {
-			    if (pBest->m_fTag)
-			    {
-				    pBest = pVoice;
-			    }
-			    else
-			    {
-                    if (pVoice->m_dwPriority <= pBest->m_dwPriority)
-                    {
-				        if (pVoice->m_fNoteOn) 
-				        {
-					        if (pBest->m_fNoteOn)
-					        {
-						        if (pBest->m_stStartTime > pVoice->m_stStartTime)
-						        {
-							        pBest = pVoice;
-						        }
-					        }
-				        }
-				        else
-				        {
-					        if (pBest->m_fNoteOn ||
-						        (pBest->m_vrVolume > pVoice->m_vrVolume))
-					        {
-						        pBest = pVoice;
-					        }
-				        }
-                    }
-			    }
-		    }
-        }
-        if (pBest->m_fTag)
-        {
-            pBest = NULL;
-        }
-    }
-    return pBest;
+    return m_StealHeap.GetTopUntagged();
 }
 
 /*****************************************************************************
@@ -554,49 +660,22 @@ CVoice *CSynth::OldestVoice()
  *****************************************************************************
  * Steal a voice, if possible.  If none are at or below this priority, then
  * return NULL, and this voice will go unheard.  If there IS a voice to be 
- * stolen, silence it first.
+ * stolen, silence it first.  The steal heap orders by priority first, so
+ * if the top voice is above this priority, every voice is.
  */
 CVoice *CSynth::StealVoice(DWORD dwPriority)
 {
-    CVoice *pVoice;
-    CVoice *pBest = NULL;
-    pVoice = m_VoicesInUse.GetHead();
-    for (;pVoice != NULL;pVoice = pVoice->GetNext())
-    {
-        if (pVoice->m_dwPriority <= dwPriority)
-        {
-            if (!pBest)
-            {
-                pBest = pVoice;
-            }
-            else
-            {
-                if (pVoice->m_fNoteOn == FALSE) 
-                {
-                    if ((pBest->m_fNoteOn == TRUE) ||
-                        (pBest->m_vrVolume > pVoice->m_vrVolume))
-                    {
-                        pBest = pVoice;
-                    }
-                }
-                else
-                {
-                    if (pBest->m_stStartTime > pVoice->m_stStartTime)
-                    {
-                        pBest = pVoice;
-                    }
-                }
-            }
-        }
-    }
-    if (pBest != NULL)
+    CVoice *pBest = m_StealHeap.GetTop();
+    if ((pBest != NULL) && (pBest->m_dwPriority <= dwPriority))
     {
         pBest->ClearVoice();
         pBest->m_fInUse = FALSE; 
+        m_StealHeap.Remove(pBest);
         m_VoicesInUse.Remove(pBest);
         pBest->SetNext(NULL);
+        return pBest;
     }
-    return pBest;
+    return NULL;
 }
 
 /*****************************************************************************
@@ -611,20 +690,27 @@ CVoice *CSynth::StealVoice(DWORD dwPriority)
  * so the note ons and offs overlap properly. So, the queue is
  * sorted in priority order with older notes later within one
  * priority level.
+ * Returns FALSE, without queueing the voice, if the steal heap has no
+ * room for it, which happens only if SetMaxVoices() could not grow it.
  */
-void CSynth::QueueVoice(CVoice *pVoice)
+BOOL CSynth::QueueVoice(CVoice *pVoice)
 {
+    if (!m_StealHeap.Insert(pVoice))
+    {
+        return FALSE;
+    }
+
     CVoice *pScan = m_VoicesInUse.GetHead();
     CVoice *pNext = NULL;
     if (!pScan) // Empty list?
     {
         m_VoicesInUse.AddHead(pVoice);
-        return;
+        return TRUE;
     }
     if (pScan->m_dwPriority > pVoice->m_dwPriority)
     {   // Are we lower priority than the head of the list?
         m_VoicesInUse.AddHead(pVoice);
-        return;
+        return TRUE;
     }
 
     pNext = pScan->GetNext();
@@ -635,7 +721,7 @@ void CSynth::QueueVoice(CVoice *pVoice)
             // Lower priority than next in the list.
             pScan->SetNext(pVoice);
             pVoice->SetNext(pNext);
-            return;
+            return TRUE;
         }
         pScan = pNext;
         pNext = pNext->GetNext();
@@ -643,6 +729,7 @@ void CSynth::QueueVoice(CVoice *pVoice)
     // Reached the end of the list.
     pScan->SetNext(pVoice);
     pVoice->SetNext(NULL);
+    return TRUE;
 }
 
 /*****************************************************************************
@@ -694,16 +781,22 @@ void CSynth::StealNotes(STIME stTime)
 /*****************************************************************************
  * CSynth::FinishMix()
  *****************************************************************************
- * Cleanup after the mix.
+ * Cleanup after the mix.  Add the bus, and the workers' buses, into the
+ * output and clip it to sixteen bits.
  */
 void CSynth::FinishMix(short *pBuffer,DWORD dwLength)
 {
     DWORD dwIndex;
+    DWORD dwThread;
 	long lMax = (long) m_BuildStats.dwMaxAmplitude;
 	long lTemp;
     for (dwIndex = 0; dwIndex < (dwLength << m_dwStereo); dwIndex++)
     {
-		lTemp = pBuffer[dwIndex];
+		lTemp = pBuffer[dwIndex] + m_plMixBuffer[dwIndex];
+        for (dwThread = 1; dwThread < m_dwMixPartitions; dwThread++)
+        {
+            lTemp += m_pMixThreads[dwThread - 1].plBuffer[dwIndex];
+        }
 		lTemp <<= 1;
 		if (lTemp < -32767) lTemp = -32767;
 		if (lTemp > 32767) lTemp = 32767;
@@ -716,6 +809,381 @@ void CSynth::FinishMix(short *pBuffer,DWORD dwLength)
 	m_BuildStats.dwMaxAmplitude = lMax;
 }
 
+/*****************************************************************************
+ * CSynth::StartMixThreads()
+ *****************************************************************************
+ * Start the workers for parallel mixing.  Each active voice belongs to one
+ * partition; partition 0 is mixed by the caller of Mix(), the others by a
+ * worker each.  dwThreads of 0 leaves mixing serial.
+ */
+HRESULT CSynth::StartMixThreads(DWORD dwThreads)
+{
+    PAGED_CODE();
+
+    DWORD dwX;
+
+    if (dwThreads > MAX_MIX_THREADS)
+    {
+        dwThreads = MAX_MIX_THREADS;
+    }
+    if ((dwThreads == 0) || m_pMixThreads)
+    {
+        return S_OK;
+    }
+    m_pMixThreads = new(NonPagedPool,'TSmD') MIXTHREAD[dwThreads]; //  DmST
+    if (m_pMixThreads == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+    m_fMixThreadsExit = FALSE;
+    for (dwX = 0; dwX < dwThreads; dwX++)
+    {
+        MIXTHREAD *pThread = &m_pMixThreads[dwX];
+
+        pThread->pSynth = this;
+        pThread->dwPartition = dwX + 1;
+        KeInitializeEvent(&pThread->StartEvent, SynchronizationEvent, FALSE);
+        KeInitializeEvent(&pThread->DoneEvent, SynchronizationEvent, FALSE);
+        pThread->plBuffer = new(NonPagedPool,'BSmD') long[MIX_BUS_LENGTH << 1]; //  DmSB
+        if (pThread->plBuffer == NULL)
+        {
+            break;
+        }
+        pThread->pvThread = KernHelpCreateThread(MixThread, pThread);
+        if (pThread->pvThread == NULL)
+        {
+            delete [] pThread->plBuffer;
+            pThread->plBuffer = NULL;
+            break;
+        }
+        m_dwMixThreads++;
+    }
+    if (m_dwMixThreads == 0)
+    {
+        delete [] m_pMixThreads;
+        m_pMixThreads = NULL;
+        return E_FAIL;
+    }
+    return S_OK;
+}
+
+/*****************************************************************************
+ * CSynth::StopMixThreads()
+ *****************************************************************************
+ * Stop the workers and free their buffers.  Safe to call if they were never
+ * started.
+ */
+void CSynth::StopMixThreads()
+{
+    PAGED_CODE();
+
+    DWORD dwX;
+
+    if (m_pMixThreads == NULL)
+    {
+        return;
+    }
+
+    ::EnterCriticalSection(&m_CriticalSection);
+    DWORD dwThreads = m_dwMixThreads;
+    m_dwMixThreads = 0;
+    m_dwMixPartitions = 1;
+    m_fMixThreadsExit = TRUE;
+    ::LeaveCriticalSection(&m_CriticalSection);
+
+    for (dwX = 0; dwX < dwThreads; dwX++)
+    {
+        KeSetEvent(&m_pMixThreads[dwX].StartEvent, 0, FALSE);
+        KernHelpWaitForThread(m_pMixThreads[dwX].pvThread);
+        delete [] m_pMixThreads[dwX].plBuffer;
+    }
+    delete [] m_pMixThreads;
+    m_pMixThreads = NULL;
+}
+
+/*****************************************************************************
+ * CSynth::PrepareMixPartitions()
+ *****************************************************************************
+ * Snapshot the active voices.  Returns the number of partitions to mix,
+ * which is 1 when there are too few voices to be worth splitting or memory
+ * is short.
+ */
+DWORD CSynth::PrepareMixPartitions()
+{
+    CVoice *pVoice;
+    DWORD   dwVoices = 0;
+
+    for (pVoice = m_VoicesInUse.GetHead(); pVoice; pVoice = pVoice->GetNext())
+    {
+        dwVoices++;
+    }
+    if (dwVoices < MIN_PARALLEL_VOICES)
+    {
+        return 1;
+    }
+
+    if (dwVoices > m_dwMixVoicesAllocated)
+    {
+        CVoice **ppVoices = new(NonPagedPool,'VSmD') CVoice *[dwVoices]; //  DmSV
+        if (ppVoices == NULL)
+        {
+            return 1;
+        }
+        if (m_ppMixVoices)
+        {
+            delete [] m_ppMixVoices;
+        }
+        m_ppMixVoices = ppVoices;
+        m_dwMixVoicesAllocated = dwVoices;
+    }
+
+    m_dwMixVoices = 0;
+    for (pVoice = m_VoicesInUse.GetHead(); pVoice; pVoice = pVoice->GetNext())
+    {
+        m_ppMixVoices[m_dwMixVoices++] = pVoice;
+    }
+
+    DWORD dwPartitions = m_dwMixThreads + 1;
+    if (dwPartitions > dwVoices / (MIN_PARALLEL_VOICES / 2))
+    {
+        dwPartitions = dwVoices / (MIN_PARALLEL_VOICES / 2);
+    }
+    return dwPartitions;
+}
+
+/*****************************************************************************
+ * CSynth::MixPartition()
+ *****************************************************************************
+ * Mix one partition of the active voices into plBuffer.  Voices are dealt
+ * out in turn, so notes started together are spread across partitions.
+ */
+void CSynth::MixPartition(DWORD dwPartition, long *plBuffer)
+{
+    DWORD dwIndex;
+
+    for (dwIndex = dwPartition; dwIndex < m_dwMixVoices; dwIndex += m_dwMixPartitions)
+    {
+        m_ppMixVoices[dwIndex]->Mix(plBuffer, m_dwMixLength, m_stMixStart, m_stMixEnd);
+    }
+}
+
+/*****************************************************************************
+ * CSynth::MixThread()
+ *****************************************************************************
+ * Worker thread for parallel mixing.  Waits for Mix() to hand it a
+ * partition, mixes it into the worker's own bus and signals completion.
+ */
+VOID NTAPI CSynth::MixThread(PVOID pvContext)
+{
+    MIXTHREAD * pThread = (MIXTHREAD *) pvContext;
+    CSynth *    pSynth = pThread->pSynth;
+
+    for (;;)
+    {
+        KeWaitForSingleObject(&pThread->StartEvent, Executive, KernelMode, FALSE, NULL);
+        if (pSynth->m_fMixThreadsExit)
+        {
+            break;
+        }
+#ifdef _X86_
+        KFLOATING_SAVE  FloatSave;
+        NTSTATUS        ntFloatStatus = KeSaveFloatingPointState(&FloatSave);
+#endif // _X86_
+        RtlZeroMemory(pThread->plBuffer,
+                      (pSynth->m_dwMixLength << pSynth->m_dwStereo) * sizeof(long));
+        pSynth->MixPartition(pThread->dwPartition, pThread->plBuffer);
+#ifdef _X86_
+        if (NT_SUCCESS(ntFloatStatus))
+        {
+            KeRestoreFloatingPointState(&FloatSave);
+        }
+#endif // _X86_
+        KeSetEvent(&pThread->DoneEvent, 0, FALSE);
+    }
+    KernHelpExitThread();
+}
+
+/*****************************************************************************
+ * CSynth::SetStreamThreshold()
+ *****************************************************************************
+ * Stream waves downloaded from now on if they are longer than dwSamples,
+ * and start the stream thread if it isn't running.  0 stops streaming new
+ * downloads; waves already streamed go on streaming.
+ */
+HRESULT CSynth::SetStreamThreshold(DWORD dwSamples)
+{
+    PAGED_CODE();
+
+    HRESULT hr = S_OK;
+
+    if (dwSamples)
+    {
+        hr = StartStreamThread();
+    }
+    if (SUCCEEDED(hr))
+    {
+        ::EnterCriticalSection(&m_Instruments.m_CriticalSection);
+        m_Instruments.m_dwStreamThreshold = dwSamples;
+        ::LeaveCriticalSection(&m_Instruments.m_CriticalSection);
+    }
+    return hr;
+}
+
+/*****************************************************************************
+ * CSynth::AttachStream()
+ *****************************************************************************
+ * Give a voice starting on a streamed wave a free stream.  Called from the
+ * mix, on the render thread.  Returns NULL if all MAX_STREAMS are playing.
+ */
+CWaveStream * CSynth::AttachStream(CWave *pWave, DWORD dwLoopStart, DWORD dwLoopEnd, BOOL fOneShot)
+{
+    DWORD dwIndex;
+
+    if (m_pStreams == NULL)
+    {
+        return NULL;
+    }
+    ReleaseStreams();
+    for (dwIndex = 0; dwIndex < MAX_STREAMS; dwIndex++)
+    {
+        if (m_pStreams[dwIndex].m_lState == STREAM_FREE)
+        {
+            m_pStreams[dwIndex].Attach(pWave, dwLoopStart, dwLoopEnd, fOneShot);
+            KeSetEvent(&m_StreamEvent, 0, FALSE);
+            return &m_pStreams[dwIndex];
+        }
+    }
+    Trace(2,"No stream free for wave %ld\n",pWave->m_dwID);
+    return NULL;
+}
+
+/*****************************************************************************
+ * CSynth::ReleaseStreams()
+ *****************************************************************************
+ * Release the streams the stream thread has finished closing.  Called with
+ * m_CriticalSection held.
+ */
+void CSynth::ReleaseStreams()
+{
+    DWORD dwIndex;
+
+    for (dwIndex = 0; dwIndex < MAX_STREAMS; dwIndex++)
+    {
+        if (m_pStreams[dwIndex].m_lState == STREAM_CLOSED)
+        {
+            m_pStreams[dwIndex].Release();
+        }
+    }
+}
+
+/*****************************************************************************
+ * CSynth::StartStreamThread()
+ *****************************************************************************
+ * Allocate the streams and start the thread that fills them.
+ */
+HRESULT CSynth::StartStreamThread()
+{
+    PAGED_CODE();
+
+    DWORD dwIndex;
+
+    if (m_pStreams)
+    {
+        return S_OK;
+    }
+    CWaveStream *pStreams = new(NonPagedPool,'QSmD') CWaveStream[MAX_STREAMS]; //  DmSQ
+    if (pStreams == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+    for (dwIndex = 0; dwIndex < MAX_STREAMS; dwIndex++)
+    {
+        if (FAILED(pStreams[dwIndex].Init()))
+        {
+            delete [] pStreams;
+            return E_OUTOFMEMORY;
+        }
+    }
+    m_fStreamThreadExit = FALSE;
+    KeInitializeEvent(&m_StreamEvent, SynchronizationEvent, FALSE);
+    m_pStreams = pStreams;
+    m_pvStreamThread = KernHelpCreateThread(StreamThread, this);
+    if (m_pvStreamThread == NULL)
+    {
+        m_pStreams = NULL;
+        delete [] pStreams;
+        return E_FAIL;
+    }
+    return S_OK;
+}
+
+/*****************************************************************************
+ * CSynth::StopStreamThread()
+ *****************************************************************************
+ * Stop the stream thread and free the streams.  Every voice must have been
+ * cleared.  Safe to call if streaming was never started.
+ */
+void CSynth::StopStreamThread()
+{
+    PAGED_CODE();
+
+    if (m_pStreams == NULL)
+    {
+        return;
+    }
+
+    m_fStreamThreadExit = TRUE;
+    KeSetEvent(&m_StreamEvent, 0, FALSE);
+    KernHelpWaitForThread(m_pvStreamThread);
+    m_pvStreamThread = NULL;
+
+    ::EnterCriticalSection(&m_CriticalSection);
+    ReleaseStreams();
+    delete [] m_pStreams;
+    m_pStreams = NULL;
+    ::LeaveCriticalSection(&m_CriticalSection);
+
+    ::EnterCriticalSection(&m_Instruments.m_CriticalSection);
+    m_Instruments.m_dwStreamThreshold = 0;
+    ::LeaveCriticalSection(&m_Instruments.m_CriticalSection);
+}
+
+/*****************************************************************************
+ * CSynth::StreamThread()
+ *****************************************************************************
+ * Woken after each mix and when a stream is attached, fills every attached
+ * stream from where its voice is playing.  It reads the pageable wave
+ * stores, so it is the only thread that may fault on them.
+ */
+VOID NTAPI CSynth::StreamThread(PVOID pvContext)
+{
+    CSynth *    pSynth = (CSynth *) pvContext;
+    DWORD       dwIndex;
+
+    for (;;)
+    {
+        KeWaitForSingleObject(&pSynth->m_StreamEvent, Executive, KernelMode, FALSE, NULL);
+        if (pSynth->m_fStreamThreadExit)
+        {
+            break;
+        }
+        for (dwIndex = 0; dwIndex < MAX_STREAMS; dwIndex++)
+        {
+            CWaveStream *pStream = &pSynth->m_pStreams[dwIndex];
+            if (InterlockedCompareExchange(&pStream->m_lState, STREAM_BUSY, STREAM_ACTIVE) == STREAM_ACTIVE)
+            {
+                pStream->Fill();
+                if (InterlockedCompareExchange(&pStream->m_lState, STREAM_ACTIVE, STREAM_BUSY) != STREAM_BUSY)
+                {
+                    // Detached while it was filled.
+                    InterlockedExchange(&pStream->m_lState, STREAM_CLOSED);
+                }
+            }
+        }
+    }
+    KernHelpExitThread();
+}
+
 /*****************************************************************************
  * CSynth::Unload()
  *****************************************************************************
@@ -875,6 +1343,7 @@ HRESULT CSynth::AllNotesOff()
 {
     CVoice *pVoice;
     ::EnterCriticalSection(&m_CriticalSection);
+    m_StealHeap.Clear();
     while (pVoice = m_VoicesInUse.RemoveHead())
     {
         pVoice->ClearVoice();
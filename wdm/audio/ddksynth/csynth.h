@@ -12,6 +12,8 @@
 
 #define MAX_CHANNEL_GROUPS  1000
 #define MAX_VOICES          1000
+#define MAX_MIX_THREADS     8       // Worker threads for parallel mixing.
+#define MIN_PARALLEL_VOICES 16      // Fewer active voices are mixed serially.
 
 #ifndef IDirectMusicSynthSink
 #define IDirectMusicSynthSink ISynthSinkDMus
@@ -20,6 +22,24 @@
 
 
 struct IDirectMusicSynthSink;
+class CSynth;
+
+/*****************************************************************************
+ * struct MIXTHREAD
+ *****************************************************************************
+ * One worker of the parallel mixer.  Each worker mixes its share of the
+ * active voices into a private bus, which FinishMix() adds into the
+ * output.
+ */
+typedef struct MIXTHREAD
+{
+    CSynth *        pSynth;
+    PVOID           pvThread;       // From KernHelpCreateThread().
+    KEVENT          StartEvent;     // Set when there is a partition to mix.
+    KEVENT          DoneEvent;      // Set when the partition is mixed.
+    DWORD           dwPartition;    // Mixes every m_dwMixPartitions'th voice from here.
+    long *          plBuffer;       // Private mix bus, MIX_BUS_LENGTH stereo frames.
+} MIXTHREAD;
 
 /*****************************************************************************
  * class CSynth
@@ -54,13 +74,24 @@ public:
     void            Mix(short *pBuffer,DWORD dwLength,LONGLONG llPosition);
     HRESULT         SetChannelPriority(DWORD dwChannelGroup,DWORD dwChannel,DWORD dwPriority);
     HRESULT         GetChannelPriority(DWORD dwChannelGroup,DWORD dwChannel,LPDWORD pdwPriority);
+    HRESULT         SetStreamThreshold(DWORD dwSamples);
+    CWaveStream *   AttachStream(CWave *pWave, DWORD dwLoopStart, DWORD dwLoopEnd, BOOL fOneShot);
 
 private:
     void            StealNotes(STIME stTime);
     void            FinishMix(short *pBuffer,DWORD dwlength);
     CVoice *        OldestVoice();
-    void            QueueVoice(CVoice *pVoice);
+    BOOL            QueueVoice(CVoice *pVoice);
     CVoice *        StealVoice(DWORD dwPriority);
+    HRESULT         StartMixThreads(DWORD dwThreads);
+    void            StopMixThreads();
+    DWORD           PrepareMixPartitions();
+    void            MixPartition(DWORD dwPartition, long *plBuffer);
+    static VOID NTAPI MixThread(PVOID pvContext);
+    HRESULT         StartStreamThread();
+    void            StopStreamThread();
+    void            ReleaseStreams();
+    static VOID NTAPI StreamThread(PVOID pvContext);
 
     STIME           m_stLastTime;       // Sample time of last mix.
     CVoiceList      m_VoicesFree;       // List of available voices.
@@ -73,6 +104,23 @@ private:
     PerfStats       m_BuildStats;       // Performance info accumulator.
     PerfStats       m_CopyStats;        // Performance information for display.
 
+    MIXTHREAD *     m_pMixThreads;      // Parallel mix workers, if enabled.
+    DWORD           m_dwMixThreads;     // Number of workers running.
+    BOOL            m_fMixThreadsExit;  // Tells the workers to exit.
+    DWORD           m_dwMixPartitions;  // Partitions in the current mix, 1 if serial.
+    CVoice **       m_ppMixVoices;      // Active voices, for partitioning.
+    DWORD           m_dwMixVoices;      // Number of entries used.
+    DWORD           m_dwMixVoicesAllocated;
+    DWORD           m_dwMixLength;      // Length of the current mix.
+    STIME           m_stMixStart;       // Start of the current mix.
+    STIME           m_stMixEnd;         // End of the current mix.
+    long *          m_plMixBuffer;      // Mix bus, MIX_BUS_LENGTH stereo frames.
+
+    CWaveStream *   m_pStreams;         // MAX_STREAMS prefetch buffers, if streaming.
+    PVOID           m_pvStreamThread;   // Fills them, from KernHelpCreateThread().
+    KEVENT          m_StreamEvent;      // Set after each mix to wake it.
+    BOOL            m_fStreamThreadExit;
+
 public: 
     // DLS-1 compatibility parameters: set these off to emulate hardware
     // which can't vary volume/pan during playing of a note.
@@ -84,7 +132,10 @@ public:
     STIME            m_stMaxSpan;       // Maximum time allowed for mix time span.
     DWORD            m_dwSampleRate;
     DWORD            m_dwStereo;
+    DWORD            m_dwInterpolation; // MIX_INTERP_LINEAR, _CUBIC or _SINC.
+    volatile LONG    m_lStreamUnderruns; // Streamed blocks mixed as silence.
     
+    CVoiceHeap       m_StealHeap;       // Voices in use, best to steal on top.
     CInstManager     m_Instruments;     // Instrument manager.
     CControlLogic ** m_ppControl;       // Array of open ControlLogics.
     DWORD            m_dwControlCount;  // # of open CLs.
@@ -355,6 +355,8 @@ CWave::CWave()
     m_dwID = 0;
     m_wPlayCount = 0;
     m_pWaveMem = NULL;
+    m_pvStore = NULL;
+    m_pnHead = NULL;
 }
 
 /*****************************************************************************
@@ -376,6 +378,16 @@ CWave::~CWave()
         }
         m_pWaveMem = NULL;
     }
+    if (m_pvStore)
+    {
+        KernHelpDeleteWaveStore(m_pvStore);
+        m_pvStore = NULL;
+    }
+    if (m_pnHead)
+    {
+        delete [] m_pnHead;
+        m_pnHead = NULL;
+    }
     m_pnWave = NULL;
 }
 
@@ -457,6 +469,8 @@ CSourceRegion::CSourceRegion()
     m_prTuning = 0;
     m_bKeyHigh = 127;
     m_bKeyLow = 0;
+    m_bVelocityHigh = 127;
+    m_bVelocityLow = 0;
     m_bGroup = 0;
     m_bAllowOverlap = FALSE;
 }
@@ -513,6 +527,8 @@ void CSourceRegion::Verify()
 CInstrument::CInstrument()
 {
     m_dwProgram = 0;
+    m_ppKeyRegions = NULL;
+    RtlZeroMemory(m_adwKeyIndex, sizeof(m_adwKeyIndex));
 }
 
 /*****************************************************************************
@@ -527,6 +543,10 @@ CInstrument::~CInstrument()
         CSourceRegion *pRegion = m_RegionList.RemoveHead();
         delete pRegion;
     }
+    if (m_ppKeyRegions)
+    {
+        delete [] m_ppKeyRegions;
+    }
 }
 
 /*****************************************************************************
@@ -574,35 +594,105 @@ void CInstrument::SetSampleRate(DWORD dwSampleRate)
     }
 }
 
+/*****************************************************************************
+ * CInstrument::BuildKeyTable()
+ *****************************************************************************
+ * Index the regions by key.  Called once the regions are downloaded, before
+ * the instrument is made visible to the mix.
+ */
+HRESULT CInstrument::BuildKeyTable()
+{
+    CSourceRegion *pRegion;
+    DWORD dwKey;
+    DWORD dwEntries = 0;
+
+    // Count the regions on each key, then turn the counts into offsets.
+    RtlZeroMemory(m_adwKeyIndex, sizeof(m_adwKeyIndex));
+    for (pRegion = m_RegionList.GetHead();pRegion;pRegion = pRegion->GetNext())
+    {
+        for (dwKey = pRegion->m_bKeyLow; (dwKey <= pRegion->m_bKeyHigh) && (dwKey < 128); dwKey++)
+        {
+            m_adwKeyIndex[dwKey + 1]++;
+        }
+    }
+    for (dwKey = 0; dwKey < 128; dwKey++)
+    {
+        m_adwKeyIndex[dwKey + 1] += m_adwKeyIndex[dwKey];
+    }
+    dwEntries = m_adwKeyIndex[128];
+
+    if (m_ppKeyRegions)
+    {
+        delete [] m_ppKeyRegions;
+        m_ppKeyRegions = NULL;
+    }
+    if (dwEntries == 0)
+    {
+        return S_OK;
+    }
+    m_ppKeyRegions = new(NonPagedPool,'KSmD') CSourceRegion *[dwEntries];   //  DmSK
+    if (m_ppKeyRegions == NULL)
+    {
+        RtlZeroMemory(m_adwKeyIndex, sizeof(m_adwKeyIndex));
+        return E_OUTOFMEMORY;
+    }
+
+    // Fill each key's entries in list order, which is the order
+    // ScanForRegion() used to search in.
+    DWORD adwFill[128];
+    RtlCopyMemory(adwFill, m_adwKeyIndex, sizeof(adwFill));
+    for (pRegion = m_RegionList.GetHead();pRegion;pRegion = pRegion->GetNext())
+    {
+        for (dwKey = pRegion->m_bKeyLow; (dwKey <= pRegion->m_bKeyHigh) && (dwKey < 128); dwKey++)
+        {
+            m_ppKeyRegions[adwFill[dwKey]++] = pRegion;
+        }
+    }
+    return S_OK;
+}
+
 /*****************************************************************************
  * CInstrument::ScanForRegion()
  *****************************************************************************
- * Retrieve the region with the given note value from the list.
+ * Retrieve the region that plays the given note value at the given
+ * velocity, from the key table.
  */
-CSourceRegion * CInstrument::ScanForRegion(DWORD dwNoteValue)
+CSourceRegion * CInstrument::ScanForRegion(DWORD dwNoteValue, DWORD dwVelocity)
 {
-    CSourceRegion *pRegion = m_RegionList.GetHead();
-    for (;pRegion;pRegion = pRegion->GetNext())
+    if (dwNoteValue >= 128)
+    {
+        return NULL;
+    }
+    DWORD dwIndex = m_adwKeyIndex[dwNoteValue];
+    DWORD dwEnd = m_adwKeyIndex[dwNoteValue + 1];
+    for (; dwIndex < dwEnd; dwIndex++)
     {
-        if (dwNoteValue >= pRegion->m_bKeyLow &&
-            dwNoteValue <= pRegion->m_bKeyHigh)
+        CSourceRegion *pRegion = m_ppKeyRegions[dwIndex];
+        if (dwVelocity >= pRegion->m_bVelocityLow &&
+            dwVelocity <= pRegion->m_bVelocityHigh)
         {
-            break ;
+            return pRegion;
         }
     }
-    return pRegion;
+    return NULL;
 }
 
 /*****************************************************************************
  * CInstManager::SetSampleRate()
  *****************************************************************************
  * Set the sample rate for this instrument manager (forward to instruments).
+ * This rewrites the regions' articulations, which the mix reads on note on
+ * without taking m_CriticalSection, so the mix is locked out as well.
  */
 void CInstManager::SetSampleRate(DWORD dwSampleRate)
 {
     DWORD dwIndex;
     
     m_dwSampleRate = dwSampleRate;
+    if (m_pMixLock)
+    {
+        EnterCriticalSection(m_pMixLock);
+    }
     EnterCriticalSection(&m_CriticalSection);
 
     for (dwIndex = 0; dwIndex < INSTRUMENT_HASH_SIZE; dwIndex++)
@@ -614,6 +704,10 @@ void CInstManager::SetSampleRate(DWORD dwSampleRate)
         }
     }
     LeaveCriticalSection(&m_CriticalSection);
+    if (m_pMixLock)
+    {
+        LeaveCriticalSection(m_pMixLock);
+    }
 }
 
 /*****************************************************************************
@@ -625,6 +719,8 @@ CInstManager::CInstManager()
 {
     m_fCSInitialized = FALSE;
     m_dwSampleRate = 22050;
+    m_pMixLock = NULL;
+    m_dwStreamThreshold = 0;
     InitializeCriticalSection(&m_CriticalSection);
     m_fCSInitialized = TRUE;
 }
@@ -687,28 +783,32 @@ void CInstManager::Verify()
 /*****************************************************************************
  * CInstManager::GetInstrument()
  *****************************************************************************
- * Get the instrument that matches this program/key.
+ * Get the instrument that matches this program/key/velocity, and the
+ * region in it that plays the note.  An instrument with the program but
+ * no region for this key and velocity is passed over, so the next one
+ * with the program gets a chance.  The caller holds *m_pMixLock, so no
+ * other lock is needed.
  */
-CInstrument * CInstManager::GetInstrument(DWORD dwProgram,DWORD dwKey)
+CInstrument * CInstManager::GetInstrument(DWORD dwProgram,DWORD dwKey,DWORD dwVelocity,
+                                          CSourceRegion **ppRegion)
 {
-    EnterCriticalSection(&m_CriticalSection);
     CInstrument *pInstrument = m_InstrumentList[dwProgram % INSTRUMENT_HASH_SIZE].GetHead();
     for (;pInstrument != NULL; pInstrument = pInstrument->GetNext())
     {
         if (pInstrument->m_dwProgram == dwProgram) 
         {
-            if (pInstrument->ScanForRegion(dwKey) != NULL)
+            *ppRegion = pInstrument->ScanForRegion(dwKey, dwVelocity);
+            if (*ppRegion != NULL)
             {
                 break;
             }
             else
             {
-                Trace(1,"No region was found in instrument 0x%lx that matched note 0x%lx\n",
-                    dwProgram, dwKey);
+                Trace(1,"No region was found in instrument 0x%lx that matched note 0x%lx velocity 0x%lx\n",
+                    dwProgram, dwKey, dwVelocity);
             }
         }
     }
-    LeaveCriticalSection(&m_CriticalSection);
     return (pInstrument);
 }
 
@@ -1000,6 +1100,18 @@ HRESULT CSourceRegion::Download(DMUS_DOWNLOADINFO * pInfo, // DMUS_DOWNLOADINFO
     // Read the Region chunk...
     m_bKeyHigh = (BYTE) pdmRegion->RangeKey.usHigh;
     m_bKeyLow = (BYTE) pdmRegion->RangeKey.usLow;
+    // DLS level 1 ignores the velocity range, and some collections leave
+    // it zero; only a real range layers the region.
+    if ((pdmRegion->RangeVelocity.usHigh != 0) &&
+        (pdmRegion->RangeVelocity.usHigh >= pdmRegion->RangeVelocity.usLow))
+    {
+        m_bVelocityHigh = (BYTE) pdmRegion->RangeVelocity.usHigh;
+        m_bVelocityLow = (BYTE) pdmRegion->RangeVelocity.usLow;
+        if (pdmRegion->RangeVelocity.usHigh > 127)
+        {
+            m_bVelocityHigh = 127;
+        }
+    }
     if (pdmRegion->fusOptions & F_RGN_OPTION_SELFNONEXCLUSIVE)
     {
         m_bAllowOverlap = TRUE;
@@ -1202,6 +1314,18 @@ HRESULT CInstManager::DownloadInstrument(
                 }
             }
         }
+        HRESULT hr = pInstrument->BuildKeyTable();
+        if (FAILED(hr))
+        {
+            delete pInstrument;
+            return hr;
+        }
+        // Link the finished instrument in while the mix is locked out, since
+        // it looks instruments up without taking m_CriticalSection.
+        if (m_pMixLock)
+        {
+            EnterCriticalSection(m_pMixLock);
+        }
         EnterCriticalSection(&m_CriticalSection);
         // If this is a GM instrument, make sure that it will be searched for last by placing it at
         // the end of the list. The DLS spec states that
@@ -1216,6 +1340,10 @@ HRESULT CInstManager::DownloadInstrument(
             m_InstrumentList[pInstrument->m_dwProgram % INSTRUMENT_HASH_SIZE].AddHead(pInstrument);
         }
         LeaveCriticalSection(&m_CriticalSection);
+        if (m_pMixLock)
+        {
+            LeaveCriticalSection(m_pMixLock);
+        }
         *phDownload = (HANDLE) pInstrument;
         return S_OK;
     }
@@ -1241,7 +1369,8 @@ HRESULT CInstManager::DownloadWave(
     DMUS_DOWNLOADINFO *pInfo,   // DMUS_DOWNLOADINFO structure from the download chunk's head. 
                                 // This provides the total size of data, among other things.
     void *pvOffsetTable[],      // The table of offsets in the download data.
-    void *pvData)               // Finally, the data itself.
+    void *pvData,               // Finally, the data itself.
+    LPBOOL pbFree)              // Set if the wave is streamed and doesn't need the chunk.
 {
     // The start of the data should align with a DMUS_WAVE header.
     DMUS_WAVE *pdmWave = (DMUS_WAVE *) pvData; 
@@ -1305,6 +1434,43 @@ HRESULT CInstManager::DownloadWave(
             return DMUS_E_BADWAVE;
         }
         pWave->m_dwSampleLength++;  // We always add one sample to the end for interpolation.
+
+        // Long waves are streamed.  They are copied into a wave store, with
+        // only their head kept resident, and the chunk can be freed.  If
+        // the store can't be made, the wave plays from the chunk as usual.
+        if (m_dwStreamThreshold &&
+            (pWave->m_dwSampleLength > m_dwStreamThreshold) &&
+            (pWave->m_dwSampleLength > STREAM_HEAD_LENGTH))
+        {
+            DWORD dwShift = (pWave->m_bSampleType & SFORMAT_16) ? 1 : 0;
+            PVOID pvStore;
+
+            pWave->m_pvStore = KernHelpCreateWaveStore(pWave->m_dwSampleLength << dwShift, &pvStore);
+            pWave->m_pnHead = new(NonPagedPool,'WSmD') short[STREAM_HEAD_LENGTH]; //  DmSW
+            if (pWave->m_pvStore && pWave->m_pnHead)
+            {
+                // The extra sample is left to CopyFromWave().
+                RtlCopyMemory(pvStore, pWave->m_pnWave, (pWave->m_dwSampleLength - 1) << dwShift);
+                RtlCopyMemory(pWave->m_pnHead, pWave->m_pnWave, STREAM_HEAD_LENGTH << dwShift);
+                pWave->m_pnWave = (short *) pvStore;
+                pWave->m_pWaveMem = NULL;
+                *pbFree = TRUE;
+                Trace(3,"Streaming wave %ld, %ld samples\n",pWave->m_dwID,pWave->m_dwSampleLength);
+            }
+            else
+            {
+                if (pWave->m_pvStore)
+                {
+                    KernHelpDeleteWaveStore(pWave->m_pvStore);
+                    pWave->m_pvStore = NULL;
+                }
+                if (pWave->m_pnHead)
+                {
+                    delete [] pWave->m_pnHead;
+                    pWave->m_pnHead = NULL;
+                }
+            }
+        }
         EnterCriticalSection(&m_CriticalSection);
 
         // Place the wave in a hash table of wave lists to increase access speed.
@@ -1446,9 +1612,10 @@ HRESULT CInstManager::Download(LPHANDLE phDownload, // Download handle, to be re
         {
             // Wave does need to keep the  download chunk allocated, because it includes the
             // wave data buffer, which it will play directly out of, so indicate that
-            // the caller must not free it until it is unloaded.
+            // the caller must not free it until it is unloaded.  A streamed wave
+            // has its own copy, and DownloadWave sets it back.
             *pbFree = FALSE;
-            hr = DownloadWave(phDownload, pInfo, ppvOffsetTable, ppvOffsetTable[0]); 
+            hr = DownloadWave(phDownload, pInfo, ppvOffsetTable, ppvOffsetTable[0], pbFree); 
         }
         delete [] ppvOffsetTable;
     }
@@ -1484,6 +1651,12 @@ HRESULT CInstManager::Unload(
                                                         // to indicate which download is freed.
 {
     DWORD dwIndex;
+    // Lock the mix out, since it looks up instruments without
+    // m_CriticalSection.
+    if (m_pMixLock)
+    {
+        EnterCriticalSection(m_pMixLock);
+    }
     EnterCriticalSection(&m_CriticalSection);
 
     // First, check to see if this is an instrument. 
@@ -1503,6 +1676,10 @@ HRESULT CInstManager::Unload(
                 m_InstrumentList[dwIndex].Remove(pInstrument);
                 delete pInstrument;
                 LeaveCriticalSection(&m_CriticalSection);
+                if (m_pMixLock)
+                {
+                    LeaveCriticalSection(m_pMixLock);
+                }
                 return S_OK;
             }
         }
@@ -1531,11 +1708,19 @@ HRESULT CInstManager::Unload(
                 pWave->m_lpFreeHandle = lpFreeHandle;
                 pWave->Release();
                 LeaveCriticalSection(&m_CriticalSection);
+                if (m_pMixLock)
+                {
+                    LeaveCriticalSection(m_pMixLock);
+                }
                 return S_OK;
             }
         }
     }
     LeaveCriticalSection(&m_CriticalSection);
+    if (m_pMixLock)
+    {
+        LeaveCriticalSection(m_pMixLock);
+    }
     return E_FAIL;
 }
 
@@ -14,6 +14,7 @@ extern "C" {
 #include <wdm.h>
 };
 
+#include <stdio.h>                  // swprintf
 #include "ksdebug.h"
 #include "KernHelp.h"
 
@@ -193,3 +194,200 @@ PVOID KernHelpGetSysAddrForMdl(PMDL pMdl)
     return MappedAddress;
 }
 
+/*****************************************************************************
+ * KernHelpCreateThread()
+ *****************************************************************************
+ * Start a system thread at the same real-time priority as the render
+ * thread, and return a referenced pointer to its thread object.
+ */
+PVOID KernHelpCreateThread(PKSTART_ROUTINE StartRoutine, PVOID StartContext)
+{
+    HANDLE      ThreadHandle;
+    PVOID       ThreadObject = NULL;
+    NTSTATUS    Status;
+
+    Status = PsCreateSystemThread(&ThreadHandle,
+                                  THREAD_ALL_ACCESS,
+                                  NULL,         // Object attributes
+                                  NULL,         // Process
+                                  NULL,         // Client id
+                                  StartRoutine,
+                                  StartContext);
+    if (!NT_SUCCESS(Status))
+    {
+        return NULL;
+    }
+
+    Status = ObReferenceObjectByHandle(ThreadHandle,
+                                       THREAD_ALL_ACCESS,
+                                       NULL,
+                                       KernelMode,
+                                       &ThreadObject,
+                                       NULL);
+    ZwClose(ThreadHandle);
+    if (!NT_SUCCESS(Status))
+    {
+        return NULL;
+    }
+
+    KeSetPriorityThread((PKTHREAD)ThreadObject, LOW_REALTIME_PRIORITY);
+
+    return ThreadObject;
+}
+
+/*****************************************************************************
+ * KernHelpWaitForThread()
+ *****************************************************************************
+ * Wait for a thread started by KernHelpCreateThread to exit, then release
+ * the thread object.  Must be called at passive level.
+ */
+VOID KernHelpWaitForThread(PVOID ThreadObject)
+{
+    KeWaitForSingleObject(ThreadObject,
+                          Executive,
+                          KernelMode,
+                          FALSE,
+                          NULL);
+    ObDereferenceObject(ThreadObject);
+}
+
+/*****************************************************************************
+ * KernHelpExitThread()
+ *****************************************************************************
+ * System threads must terminate themselves.
+ */
+VOID KernHelpExitThread()
+{
+    PsTerminateSystemThread(STATUS_SUCCESS);
+}
+
+/*****************************************************************************
+ * struct WAVESTORE
+ *****************************************************************************
+ * A wave store is a temporary file mapped into system space.  The file is
+ * deleted when its handle is closed, so nothing is left behind if the
+ * system goes down while waves are loaded.
+ */
+typedef struct WAVESTORE
+{
+    HANDLE  FileHandle;
+    PVOID   SectionObject;
+    PVOID   MappedBase;
+} WAVESTORE;
+
+static LONG s_lWaveStoreCount = 0;  // Makes the file names unique.
+
+/*****************************************************************************
+ * KernHelpCreateWaveStore()
+ *****************************************************************************
+ * Create a file-backed store of Size bytes and map it into system space.
+ * Returns the store, and its address in *MappedBase, or NULL on failure.
+ * Must be called at passive level.  The mapping is pageable, so it must
+ * only be touched below DISPATCH_LEVEL.
+ */
+PVOID KernHelpCreateWaveStore(ULONG Size, PVOID *MappedBase)
+{
+    WAVESTORE *         pStore;
+    WCHAR               FileName[64];
+    UNICODE_STRING      UnicodeFileName;
+    OBJECT_ATTRIBUTES   ObjectAttributes;
+    IO_STATUS_BLOCK     IoStatus;
+    HANDLE              SectionHandle;
+    LARGE_INTEGER       MaximumSize;
+    SIZE_T              ViewSize = 0;
+    NTSTATUS            Status;
+
+    *MappedBase = NULL;
+    pStore = (WAVESTORE *) ExAllocatePoolWithTag(NonPagedPool, sizeof(WAVESTORE), 'FSmD'); //  DmSF
+    if (pStore == NULL)
+    {
+        return NULL;
+    }
+    RtlZeroMemory(pStore, sizeof(WAVESTORE));
+
+    swprintf(FileName, L"\\SystemRoot\\Temp\\DDKSynth%08lx.tmp",
+             InterlockedIncrement(&s_lWaveStoreCount));
+    RtlInitUnicodeString(&UnicodeFileName, FileName);
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &UnicodeFileName,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               NULL,        // Root directory
+                               NULL);       // Security descriptor
+
+    Status = ZwCreateFile(&pStore->FileHandle,
+                          GENERIC_READ | GENERIC_WRITE | DELETE | SYNCHRONIZE,
+                          &ObjectAttributes,
+                          &IoStatus,
+                          NULL,             // Allocation size
+                          FILE_ATTRIBUTE_TEMPORARY,
+                          0,                // No sharing
+                          FILE_OVERWRITE_IF,
+                          FILE_NON_DIRECTORY_FILE | FILE_DELETE_ON_CLOSE |
+                          FILE_SYNCHRONOUS_IO_NONALERT,
+                          NULL,
+                          0);
+    if (!NT_SUCCESS(Status))
+    {
+        ExFreePool(pStore);
+        return NULL;
+    }
+
+    InitializeObjectAttributes(&ObjectAttributes,
+                               NULL,
+                               OBJ_KERNEL_HANDLE,
+                               NULL,
+                               NULL);
+    MaximumSize.QuadPart = Size;
+    Status = ZwCreateSection(&SectionHandle,
+                             SECTION_ALL_ACCESS,
+                             &ObjectAttributes,
+                             &MaximumSize,
+                             PAGE_READWRITE,
+                             SEC_COMMIT,
+                             pStore->FileHandle);
+    if (NT_SUCCESS(Status))
+    {
+        Status = ObReferenceObjectByHandle(SectionHandle,
+                                           SECTION_ALL_ACCESS,
+                                           NULL,
+                                           KernelMode,
+                                           &pStore->SectionObject,
+                                           NULL);
+        ZwClose(SectionHandle);
+    }
+    if (NT_SUCCESS(Status))
+    {
+        Status = MmMapViewInSystemSpace(pStore->SectionObject,
+                                        &pStore->MappedBase,
+                                        &ViewSize);
+        if (!NT_SUCCESS(Status))
+        {
+            ObDereferenceObject(pStore->SectionObject);
+        }
+    }
+    if (!NT_SUCCESS(Status))
+    {
+        ZwClose(pStore->FileHandle);
+        ExFreePool(pStore);
+        return NULL;
+    }
+
+    *MappedBase = pStore->MappedBase;
+    return pStore;
+}
+
+/*****************************************************************************
+ * KernHelpDeleteWaveStore()
+ *****************************************************************************
+ * Unmap a store made by KernHelpCreateWaveStore and delete its file.  Must
+ * be called at passive level.
+ */
+VOID KernHelpDeleteWaveStore(PVOID Store)
+{
+    WAVESTORE *pStore = (WAVESTORE *) Store;
+
+    MmUnmapViewInSystemSpace(pStore->MappedBase);
+    ObDereferenceObject(pStore->SectionObject);
+    ZwClose(pStore->FileHandle);
+    ExFreePool(pStore);
+}
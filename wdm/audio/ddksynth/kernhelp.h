@@ -24,6 +24,18 @@ ULONG GetTheCurrentTime();
 
 PVOID KernHelpGetSysAddrForMdl(PMDL pMdl);
 
+// Worker threads for the parallel mixer.  The thread object returned by
+// KernHelpCreateThread is released by KernHelpWaitForThread.
+//
+PVOID KernHelpCreateThread(PKSTART_ROUTINE StartRoutine, PVOID StartContext);
+VOID  KernHelpWaitForThread(PVOID ThreadObject);
+VOID  KernHelpExitThread();
+
+// File-backed, pageable storage for streamed waves.  See kernhelp.cpp.
+//
+PVOID KernHelpCreateWaveStore(ULONG Size, PVOID *MappedBase);
+VOID  KernHelpDeleteWaveStore(PVOID Store);
+
 
 #ifndef _NEW_DELETE_OPERATORS_
 #define _NEW_DELETE_OPERATORS_
@@ -13,7 +13,6 @@
 #pragma code_seg()
 #pragma data_seg()
 
-CMIDIDataList * CMIDIRecorder::m_sFreeList = (CMIDIDataList *) NULL;
 //
 // Array for converting MIDI to volume.
 // value = log10((index/127)^4)*1000 where index = 0..127
@@ -38,20 +37,6 @@ const VREL vrMIDIToVREL[] = {
     -98,    -84,    -69,    -55,    -41,    -27,    -13,    0
 };
 
-/*****************************************************************************
- * Constructor for CMidiData object
- *****************************************************************************/
-/*****************************************************************************
- * CMIDIData::CMIDIData()
- *****************************************************************************
- * Constructor for this object.
- */
-CMIDIData::CMIDIData() 
-{
-    m_stTime = 0;
-    m_lData = 0;            
-}
-
 /*****************************************************************************
  * CMIDIRecorder::CMIDIRecorder()
  *****************************************************************************
@@ -59,13 +44,14 @@ CMIDIData::CMIDIData()
  */
 CMIDIRecorder::CMIDIRecorder()
 {
+    m_pEvents = NULL;
+    m_dwMask = 0;
+    m_dwHead = 0;
+    m_dwCount = 0;
     m_lCurrentData = 0;
     m_stCurrentTime = 0;
-    KeInitializeSpinLock(&m_SpinLock);
 }
 
-static USHORT fAlreadyDone = 0;
-
 /*****************************************************************************
  * CMIDIRecorder::~CMIDIRecorder()
  *****************************************************************************
@@ -73,110 +59,98 @@ static USHORT fAlreadyDone = 0;
  */
 CMIDIRecorder::~CMIDIRecorder()
 {
-    ClearMIDI(0x7FFFFFFF);
-
-    fAlreadyDone--;
-    if (fAlreadyDone == 0)
+    if (m_pEvents)
     {
-        if (CMIDIRecorder::m_sFreeList)
-        {
-            while (!CMIDIRecorder::m_sFreeList->IsEmpty())
-            {
-                CMIDIData *event;
-                event = CMIDIRecorder::m_sFreeList->RemoveHead();
-                delete event;
-            }
-            delete CMIDIRecorder::m_sFreeList;
-            CMIDIRecorder::m_sFreeList = NULL;
-        }
+        delete [] m_pEvents;
     }
 }
 
 /*****************************************************************************
  * CMIDIRecorder::Init()
  *****************************************************************************
- * Initialize the CMIDIRecorder object.  Make a list of CMIDIData objects for later.
+ * Initialize the CMIDIRecorder object.  Allocate the ring of events, which
+ * must be a power of 2 in size.
  */
-void CMIDIRecorder::Init()
+HRESULT CMIDIRecorder::Init(DWORD dwEvents)
 {
-    int nIndex;
-    if (!fAlreadyDone)
+    if (m_pEvents == NULL)
     {
-        CMIDIRecorder::m_sFreeList = new(NonPagedPool,'LSmD') CMIDIDataList;    //  DmSL
-        if (!CMIDIRecorder::m_sFreeList)
-        {
-            return;
-        }
-        CMIDIRecorder::m_sFreeList->RemoveAll();
-        for (nIndex = 0; nIndex < MAX_MIDI_EVENTS; nIndex++)
+        m_pEvents = new(NonPagedPool,'MSmD') MIDIEVENT[dwEvents];  //  DmSM
+        if (m_pEvents == NULL)
         {
-            CMIDIData *event;
-            if (event = new(NonPagedPool,'MSmD') CMIDIData)         //  DmSM
-            {
-                CMIDIRecorder::m_sFreeList->AddHead(event);
-            }
+            return E_OUTOFMEMORY;
         }
-        fAlreadyDone++;
+        m_dwMask = dwEvents - 1;
     }
+    m_dwHead = 0;
+    m_dwCount = 0;
+    return S_OK;
 }
 
 /*****************************************************************************
- * CMIDIRecorder::GrabSpinLock()
+ * CMIDIRecorder::Grow()
  *****************************************************************************
- * In kernel mode, acquire the spinlock.
+ * Double the ring, unwrapping the events to the start of the new one.
  */
-inline void CMIDIRecorder::GrabSpinLock()
+BOOL CMIDIRecorder::Grow()
 {
-    KeAcquireSpinLock(&m_SpinLock, &m_OldIrql);
+    DWORD       dwEvents = (m_dwMask + 1) << 1;
+    MIDIEVENT * pEvents = new(NonPagedPool,'MSmD') MIDIEVENT[dwEvents];  //  DmSM
+    DWORD       dwIndex;
+
+    if (pEvents == NULL)
+    {
+        return FALSE;
+    }
+    for (dwIndex = 0; dwIndex < m_dwCount; dwIndex++)
+    {
+        pEvents[dwIndex] = *GetEvent(dwIndex);
+    }
+    delete [] m_pEvents;
+    m_pEvents = pEvents;
+    m_dwMask = dwEvents - 1;
+    m_dwHead = 0;
+    return TRUE;
 }
 
 /*****************************************************************************
- * CMIDIRecorder::ReleaseSpinLock()
+ * CMIDIRecorder::FindAfter()
  *****************************************************************************
- * In kernel mode, release the spinlock.
+ * Binary search for the first event later than stTime.  Returns m_dwCount
+ * if there is none.
  */
-inline void CMIDIRecorder::ReleaseSpinLock()
+DWORD CMIDIRecorder::FindAfter(STIME stTime)
 {
-    KeReleaseSpinLock(&m_SpinLock, m_OldIrql);
+    DWORD dwLow = 0;
+    DWORD dwHigh = m_dwCount;
+
+    while (dwLow < dwHigh)
+    {
+        DWORD dwMiddle = (dwLow + dwHigh) >> 1;
+        if (GetEvent(dwMiddle)->stTime > stTime)
+        {
+            dwHigh = dwMiddle;
+        }
+        else
+        {
+            dwLow = dwMiddle + 1;
+        }
+    }
+    return dwLow;
 }
 
 /*****************************************************************************
  * CMIDIRecorder::FlushMIDI()
  *****************************************************************************
- * Remove all events from the event list, and put them back on the free list.
+ * Remove all events at or after the given time.
  */
 BOOL CMIDIRecorder::FlushMIDI(STIME stTime)
 {
-    GrabSpinLock();
-
-    CMIDIData *pMD;
-    CMIDIData *pLast = NULL;
-    for (pMD = m_EventList.GetHead();pMD != NULL;pMD = pMD->GetNext())
+    while (m_dwCount && (GetEvent(m_dwCount - 1)->stTime >= stTime))
     {
-        if (pMD->m_stTime >= stTime)
-        {
-            if (pLast == NULL)
-            {
-                m_EventList.RemoveAll();
-            }
-            else
-            {
-                pLast->SetNext(NULL);
-            }
-            if (CMIDIRecorder::m_sFreeList)
-            {
-                CMIDIRecorder::m_sFreeList->Cat(pMD);
-            }
-            break;
-        }
-        pLast = pMD;
+        m_dwCount--;
     }
-    
-    BOOL fIsEmpty = m_EventList.IsEmpty();
-
-    ReleaseSpinLock();
-
-    return fIsEmpty;
+    return (m_dwCount == 0);
 }
 
 /*****************************************************************************
@@ -186,33 +160,19 @@ BOOL CMIDIRecorder::FlushMIDI(STIME stTime)
  */
 BOOL CMIDIRecorder::ClearMIDI(STIME stTime)
 {
-    GrabSpinLock();
-
-    CMIDIData *pMD;
-    for (;pMD = m_EventList.GetHead();)
+    while (m_dwCount)
     {
-        if (pMD->m_stTime < stTime)
+        MIDIEVENT *pEvent = GetEvent(0);
+        if (pEvent->stTime >= stTime)
         {
-            m_EventList.RemoveHead();
-            m_stCurrentTime = pMD->m_stTime;
-            m_lCurrentData = pMD->m_lData;
-            if (CMIDIRecorder::m_sFreeList)
-            {
-                CMIDIRecorder::m_sFreeList->AddHead(pMD);
-            }
-            else
-            {
-                delete pMD; 
-            }
+            break;
         }
-        else break;
+        m_stCurrentTime = pEvent->stTime;
+        m_lCurrentData = pEvent->lData;
+        m_dwHead = (m_dwHead + 1) & m_dwMask;
+        m_dwCount--;
     }
-
-    BOOL fIsEmpty = m_EventList.IsEmpty();
-
-    ReleaseSpinLock();
-
-    return fIsEmpty;
+    return (m_dwCount == 0);
 }
 
 /*****************************************************************************
@@ -228,69 +188,33 @@ VREL CMIDIRecorder::VelocityToVolume(WORD nVelocity)
 /*****************************************************************************
  * CMIDIRecorder::RecordMIDI()
  *****************************************************************************
- * Queue up a given note at a given time.  Use an element from the free pool,
- * or allocate a new one if the pool is exhausted.
+ * Queue up a given event at a given time, after any events already queued
+ * for the same time.  Grows the ring if it is full.
  */
 BOOL CMIDIRecorder::RecordMIDI(STIME stTime, long lData)
 {
-    GrabSpinLock();
-
-    CMIDIData *pMD = NULL;
-    if (CMIDIRecorder::m_sFreeList)
+    if ((m_pEvents == NULL) || ((m_dwCount > m_dwMask) && !Grow()))
     {
-        pMD = CMIDIRecorder::m_sFreeList->RemoveHead();
+        Trace(1,"MIDI Event pool empty.\n");
+        return (FALSE);
     }
 
-    if (pMD == NULL)
+    // Slide later events up a slot.  In order input moves nothing.
+    DWORD dwIndex = m_dwCount++;
+    for (; dwIndex > 0; dwIndex--)
     {
-	    pMD = new(NonPagedPool,'MSmD') CMIDIData;   //  DmSM
-    }
-
-    if (pMD != NULL)
-    {
-	    CMIDIData *pScan = m_EventList.GetHead();
-	    CMIDIData *pNext;
-
-        pMD->m_stTime = stTime;
-        pMD->m_lData = lData;
-		if (pScan == NULL)
-		{
-			m_EventList.AddHead(pMD);
-		}
-		else
-		{
-			if (pScan->m_stTime > stTime)
-			{
-				m_EventList.AddHead(pMD);
-			}
-			else
-			{
-				for (;pScan != NULL; pScan = pNext)
-				{
-					pNext = pScan->GetNext();
-					if (pNext == NULL)
-					{
-						pScan->SetNext(pMD);
-					}
-					else
-					{
-						if (pNext->m_stTime > stTime)
-						{
-							pMD->SetNext(pNext);
-							pScan->SetNext(pMD);
-							break;
-						}
-					}
-				}
-			}
-		}
-        ReleaseSpinLock();
-        return (TRUE);
+        MIDIEVENT *pPrevious = GetEvent(dwIndex - 1);
+        if (pPrevious->stTime <= stTime)
+        {
+            break;
+        }
+        *GetEvent(dwIndex) = *pPrevious;
     }
 
-    ReleaseSpinLock();
-    Trace(1,"MIDI Event pool empty.\n");
-    return (FALSE);
+    MIDIEVENT *pEvent = GetEvent(dwIndex);
+    pEvent->stTime = stTime;
+    pEvent->lData = lData;
+    return (TRUE);
 }
 
 /*****************************************************************************
@@ -300,22 +224,13 @@ BOOL CMIDIRecorder::RecordMIDI(STIME stTime, long lData)
  */
 long CMIDIRecorder::GetData(STIME stTime)
 {
-    GrabSpinLock();
+    DWORD dwAfter = FindAfter(stTime);
 
-    CMIDIData *pMD = m_EventList.GetHead();
-    long lData = m_lCurrentData;
-    for (;pMD;pMD = pMD->GetNext())
+    if (dwAfter == 0)
     {
-        if (pMD->m_stTime > stTime)
-        {
-            break;
-        }
-        lData = pMD->m_lData;
+        return (m_lCurrentData);
     }
-
-    ReleaseSpinLock();
-
-    return (lData);
+    return (GetEvent(dwAfter - 1)->lData);
 }
 
 /*****************************************************************************
@@ -353,32 +268,20 @@ BOOL CNoteIn::RecordEvent(STIME stTime, DWORD dwPart, DWORD dwCommand, BYTE bDat
  */
 BOOL CNoteIn::GetNote(STIME stTime, CNote * pNote)
 {
-    GrabSpinLock();
-
-    CMIDIData *pMD = m_EventList.GetHead();
-    if (pMD != NULL)
+    if (m_dwCount)
     {
-        if (pMD->m_stTime <= stTime)
+        MIDIEVENT *pEvent = GetEvent(0);
+        if (pEvent->stTime <= stTime)
         {
-            pNote->m_stTime = pMD->m_stTime;
-            pNote->m_bPart = (BYTE) (pMD->m_lData >> 16);
-            pNote->m_bKey = (BYTE) (pMD->m_lData >> 8) & 0xFF;
-            pNote->m_bVelocity = (BYTE) pMD->m_lData & 0xFF;
-            m_EventList.RemoveHead();
-            if (CMIDIRecorder::m_sFreeList)
-            {
-                CMIDIRecorder::m_sFreeList->AddHead(pMD);
-            }
-            else
-            {
-                delete pMD; 
-            }
-            ReleaseSpinLock();
+            pNote->m_stTime = pEvent->stTime;
+            pNote->m_bPart = (BYTE) (pEvent->lData >> 16);
+            pNote->m_bKey = (BYTE) (pEvent->lData >> 8) & 0xFF;
+            pNote->m_bVelocity = (BYTE) pEvent->lData & 0xFF;
+            m_dwHead = (m_dwHead + 1) & m_dwMask;
+            m_dwCount--;
             return (TRUE);
         }
     }
-
-    ReleaseSpinLock();
     return (FALSE);
 }
 
@@ -390,59 +293,57 @@ BOOL CNoteIn::GetNote(STIME stTime, CNote * pNote)
  */
 void CNoteIn::FlushMIDI(STIME stTime)
 {
-    GrabSpinLock();
-
-    CMIDIData *pMD;
-    for (pMD = m_EventList.GetHead();pMD != NULL;pMD = pMD->GetNext())
+    DWORD dwIndex;
+    for (dwIndex = FindAfter(stTime - 1); dwIndex < m_dwCount; dwIndex++)
     {
-        if (pMD->m_stTime >= stTime)
-        {
-            pMD->m_stTime = stTime;     // Play now.
+        MIDIEVENT *pEvent = GetEvent(dwIndex);
+        pEvent->stTime = stTime;     // Play now.
 
-            BYTE command = (BYTE) ((pMD->m_lData & 0x0000FF00) >> 8);
-            if (command < NOTE_PROGRAMCHANGE)
-            {
-                pMD->m_lData &= 0xFFFFFF00; // Clear velocity to make note off.
-            }
-            //  otherwise it is a special command
-            //  so don't mess with the velocity
+        BYTE command = (BYTE) ((pEvent->lData & 0x0000FF00) >> 8);
+        if (command < NOTE_PROGRAMCHANGE)
+        {
+            pEvent->lData &= 0xFFFFFF00; // Clear velocity to make note off.
         }
+        //  otherwise it is a special command
+        //  so don't mess with the velocity
     }
-
-    ReleaseSpinLock();
 }
 
 
 /*****************************************************************************
  * CNoteIn::FlushPart()
  *****************************************************************************
- * Flush the given channel, with attention given to special events.
+ * Flush the given channel, with attention given to special events.  The
+ * flushed events move ahead of the other channels' later events, in
+ * their original order, so the queue stays sorted.
  */
 void CNoteIn::FlushPart(STIME stTime, BYTE bChannel)
 {
-    GrabSpinLock();
-
-    CMIDIData *pMD;
-    for (pMD = m_EventList.GetHead();pMD != NULL;pMD = pMD->GetNext())
+    DWORD dwFirst = FindAfter(stTime - 1);
+    DWORD dwIndex;
+    for (dwIndex = dwFirst; dwIndex < m_dwCount; dwIndex++)
     {
-        if (pMD->m_stTime >= stTime)
+        MIDIEVENT Event = *GetEvent(dwIndex);
+        if (bChannel == (BYTE) (Event.lData >> 16))
         {
-			if (bChannel == (BYTE) (pMD->m_lData >> 16))
-			{
-                pMD->m_stTime = stTime;     // Play now.
-
-                BYTE command = (BYTE) ((pMD->m_lData & 0x0000FF00) >> 8);
-                if (command < NOTE_PROGRAMCHANGE)
-                {
-                    pMD->m_lData &= 0xFFFFFF00; // Clear velocity to make note off.
-                }
-                //  otherwise it is a special command
-                //  so don't mess with the velocity
-			}
-		}
-    }
+            Event.stTime = stTime;     // Play now.
 
-    ReleaseSpinLock();
+            BYTE command = (BYTE) ((Event.lData & 0x0000FF00) >> 8);
+            if (command < NOTE_PROGRAMCHANGE)
+            {
+                Event.lData &= 0xFFFFFF00; // Clear velocity to make note off.
+            }
+            //  otherwise it is a special command
+            //  so don't mess with the velocity
+
+            DWORD dwMove;
+            for (dwMove = dwIndex; dwMove > dwFirst; dwMove--)
+            {
+                *GetEvent(dwMove) = *GetEvent(dwMove - 1);
+            }
+            *GetEvent(dwFirst++) = Event;
+        }
+    }
 }
 
 /*****************************************************************************
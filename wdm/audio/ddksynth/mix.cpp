@@ -3,1889 +3,1010 @@
 //      Mix.cpp
 //      Mix engines for MSSynth
 
-#include "common.h"
-
-#define STR_MODULENAME "DDKSynth.sys:Mix: "
-
-#pragma warning(disable : 4101 4102 4146)  
-
-#ifdef _ALPHA_
-
-extern "C" {
-	int __ADAWI(short, short *);
-};
-#pragma intrinsic(__ADAWI)
-
-#define ALPHA_OVERFLOW 2 
-#define ALPHA_NEGATIVE 8
-
-#else // !_ALPHA_
-//  TODO -- overflow detection for ia64? (+ axp64?)
-#endif // !_ALPHA_
-
-#pragma code_seg()
-/*****************************************************************************
- * CDigitalAudio::Mix8()
- *****************************************************************************
- * Implement a stereo eight-bit mix.
- * Heavily optimized for x86 non-MMX, plus C code for non-x86.
- */
-DWORD CDigitalAudio::Mix8(short * pBuffer,      DWORD dwLength, 
-                          DWORD dwDeltaPeriod,  VFRACT vfDeltaLVolume,
-                          VFRACT vfDeltaRVolume,PFRACT pfDeltaPitch, 
-                          PFRACT pfSampleLength,PFRACT pfLoopLength)
-{
-    DWORD dwI;
-    DWORD dwPosition;
-    long lM, lLM;
-    DWORD dwIncDelta = dwDeltaPeriod;
-    VFRACT dwFract;
-    char * pcWave = (char *) m_pnWave;
-    PFRACT pfSamplePos = m_pfLastSample;
-    VFRACT vfLVolume = m_vfLastLVolume;
-    VFRACT vfRVolume = m_vfLastRVolume;
-    PFRACT pfPitch = m_pfLastPitch;
-    PFRACT pfPFract = pfPitch << 8;
-    VFRACT vfLVFract = vfLVolume << 8;  // Keep high res version around.
-    VFRACT vfRVFract = vfRVolume << 8;  
-	dwLength <<= 1;
-
-#ifndef _X86_
-    for (dwI = 0; dwI < dwLength; )
-    {
-        if (pfSamplePos >= pfSampleLength)
-	    {	
-	        if (pfLoopLength)
-		    pfSamplePos -= pfLoopLength;
-	        else
-		    break;
-	    }
-        dwIncDelta--;
-        if (!dwIncDelta)    
-        {
-            dwIncDelta = dwDeltaPeriod;
-            pfPFract += pfDeltaPitch;
-            pfPitch = pfPFract >> 8;
-            vfLVFract += vfDeltaLVolume;
-            vfLVolume = vfLVFract >> 8;
-            vfRVFract += vfDeltaRVolume;
-            vfRVolume = vfRVFract >> 8;
-        }
-
-        dwPosition = pfSamplePos >> 12;
-        dwFract = pfSamplePos & 0xFFF;
-        pfSamplePos += pfPitch;
-
-        lLM = pcWave[dwPosition];
-        lM = ((pcWave[dwPosition + 1] - lLM) * dwFract) >> 12;
-        lM += lLM;
-        lLM = lM;
-
-        lLM *= vfLVolume;
-        lLM >>= 5;         // Signal bumps up to 15 bits.
-        lM *= vfRVolume;
-        lM >>= 5;
-
-#ifndef _X86_
-
-#ifdef _ALPHA_
-		int nBitmask;
-		if( ALPHA_OVERFLOW & (nBitmask = __ADAWI( (short) lLM, &pBuffer[dwI] )) )  {
-			if( ALPHA_NEGATIVE & nBitmask )  {
-				pBuffer[dwI] = 0x7FFF;
-			}
-			else  pBuffer[dwI] = (short) 0x8000;
-		}
-		if( ALPHA_OVERFLOW & (nBitmask = __ADAWI( (short) lM, &pBuffer[dwI+1] )) )  {
-			if( ALPHA_NEGATIVE & nBitmask )  {
-				pBuffer[dwI+1] = 0x7FFF;
-			}
-			else  pBuffer[dwI+1] = (short) 0x8000;
-		}
-#else // !_ALPHA_
-    // TODO -- overflow detection on ia64 (+ axp64?)
-#endif // !_ALPHA_
-
-#else // _X86_  (dead code)
-      //  Keep this around so we can use it to generate new assembly code (see below...)
-		pBuffer[dwI] += (short) lLM;
-
-        _asm{jno no_oflowl}
-        pBuffer[dwI] = 0x7fff;
-        _asm{js  no_oflowl}
-        pBuffer[dwI] = (short) 0x8000;
-no_oflowl:	
-
-		pBuffer[dwI+1] += (short) lM;
-
-        _asm{jno no_oflowr}
-        pBuffer[dwI+1] = 0x7fff;
-        _asm{js  no_oflowr}
-        pBuffer[dwI+1] = (short) 0x8000;
-no_oflowr:
-#endif // _X86_  (dead code)
-
-		dwI += 2;
-    }
-#else // _X86_
-	int i, a, b, c, total;
-	short * pBuf = pBuffer + dwLength, *pBufX;
-	dwI = - dwLength;
-
-	_asm {
-
-; 979  :     for (dwI = 0; dwI < dwLength; )
-
-//	Induction variables.
-	mov	edi, dwI
-	mov	ebx, DWORD PTR pfSamplePos
-
-// Previously set up.
-	cmp	DWORD PTR dwLength, 0
-	mov	edx, pfPFract
-
-	mov	ecx, DWORD PTR pfPitch
-	je	$L30539
-
-$L30536:
-	cmp	ebx, DWORD PTR pfSampleLength
-
-; 981  :         if (pfSamplePos >= pfSampleLength)
-
-	mov	esi, DWORD PTR dwIncDelta
-	jge	SHORT $L30540_
-
-$L30540:
-; 987  : 	        else
-; 988  : 		    break;
-; 990  :         dwIncDelta--;
-
-	dec	esi
-	mov	DWORD PTR dwIncDelta, esi
-
-; 991  :         if (!dwIncDelta)    
-
-	je	SHORT $L30541_
-
-$L30541:
-// esi, edx, edi		esi == dwIncDelta
-
-	mov	DWORD PTR i, 0
-
-; 1010 : 	b = dwIncDelta;
-
-// esi = b == dwIncDelta
-
-; 1011 : 	c = (pfSampleLength - pfSamplePos) / pfPitch;
-; 1009 : 	a = (dwLength - dwI) / 2;	// Remaining span.
-
-	mov	edx, edi
-	neg	edx
-	shr	edx, 1		// edx = a
-
-; 1017 : 	if (b < a && b < c)
-
-	cmp	esi, edx
-	jge	try_ax
-
-	mov	eax, ecx
-	imul	eax, esi
-	add	eax, ebx
-
-	cmp eax, DWORD PTR pfSampleLength 
-	jge	try_c
-
-; 1019 : 		i = b;
-
-	cmp	esi, 3
-	jl	got_it
-
-	mov	DWORD PTR i, esi
-	jmp	SHORT got_it
-
-; 1013 : 	if (a < b && a < c)
-
-try_a:
-
-	cmp	edx, esi
-	jge	try_c
-try_ax:
-	mov	eax, edx
-	imul	eax, ecx
-	add	eax, ebx
-
-	cmp eax, DWORD PTR pfSampleLength
-	jge	try_c
-
-; 1015 : 		i = a;
-
-	cmp	edx, 3
-	jl	got_it
-
-	mov	DWORD PTR i, edx
-	jmp	SHORT got_it
-
-; 1021 : 	else if (c < a && c < b)
-try_c:
-
-    push	edx
-	mov	eax, DWORD PTR pfSampleLength
-	sub	eax, ebx
-	cdq
-	idiv	ecx		// eax == c
-	pop	edx
-
-    cmp	eax, edx
-	jge	got_it
-try_cx:
-	cmp	eax, esi
-	jge	got_it
-
-; 1023 : 		i = c;
-
-	cmp	eax, 3
-	jl	$L30543	
-
-	mov DWORD PTR i, eax
-
-got_it:
-	mov	edx, DWORD PTR i
-	mov	eax, DWORD PTR pBuf
-
-	dec	edx
-	jl	$L30543
-
-	sub	DWORD PTR dwIncDelta, edx
-
-; 1093 :     return (dwI >> 1);
-; 1094 : }
-
-	lea	edx, [edx*2+2]			// Current span.
-	lea	eax, [eax+edi*2]		// Starting position.
-
-	add	edi, edx				// Remaining span.
-	lea	eax, [eax+edx*2]		// New ending position.
-
-	push	edi
-	mov	edi, edx				// Current span.
-
-	mov	DWORD PTR pBufX, eax
-	neg	edi
-
-$L30797:
-; 1005 : 			do
-; 1010 : 				dwPosition = pfSamplePos >> 12;
-; 1011 : 				dwFract = pfSamplePos & 0xFFF;
-
-	mov	edx, ebx
-	mov	esi, ebx
-
-	add	ebx, ecx
-	mov	ecx, DWORD PTR pcWave
-
-; 1012 : 				pfSamplePos += pfPitch;
-
-	sar	edx, 12					; 0000000cH
-	and	esi, 4095				; 00000fffH
-
-; 1013 : 
-; 1014 : 				lLM = (long) pcWave[dwPosition];
-
-	movsx	eax, BYTE PTR [ecx+edx]
-
-; 1015 : 				lM = ((pcWave[dwPosition+1] - lLM) * dwFract);
-; 1016 : 				lM >>= 12;
-; 1017 : 				lM += lLM;
-
-	movsx	edx, BYTE PTR [ecx+edx+1]
-
-; 1018 : 				lLM = lM;
-; 1019 : 				lLM *= vfLVolume;
-; 1020 : 				lLM >>= 5;         // Signal bumps up to 15 bits.
-; 1022 : 				pBuffer[dwI] += (short) lLM;
-; 1028 : 						lM *= vfRVolume;
-; 1029 : 						lM >>= 5;
-; 1030 : 				pBuffer[dwI+1] += (short) lM;
-; 1036 : 
-; 1037 : 				dwI += 2;
-	sub	edx, eax
-
-	imul	edx, esi
-
-	sar	edx, 12					; 0000000cH
-	mov	esi, DWORD PTR vfLVolume
-
-	add	edx, eax
-
-	imul	esi, edx
-
-	sar	esi, 5					; 00000005H
-	mov	eax, DWORD PTR pBufX
-
-	add	WORD PTR [eax+edi*2], si
-	mov	esi, DWORD PTR vfRVolume
-
-	jo	overflow_lx
-no_oflowlx:
+/*
+Structure of the mix.
 
-	imul	esi, edx
+        Each voice is mixed into a 32 bit bus, which CSynth::FinishMix()
+        scales and clips into the output once every voice is in.  So voices
+        no longer saturate against each other one at a time, and the order
+        they are mixed in makes no difference to the result.
 
-; 1038 : 			} while (--dwIncDelta);
+        The pitch and volume only change every dwDeltaPeriod samples, and the
+        loop point only needs checking when the sample position can reach it.
+        MixSpans() takes one step exactly like the old per-sample loops (loop
+        check, envelope step), then works out how many of the following
+        samples can be mixed with the same pitch and volume.  That span is
+        handed to two kernels: an interpolator, which reads the wave into a
+        short array of up to MIX_SPAN samples, and an accumulator, which
+        scales them by the volume and adds them into the bus.
 
-	sar	esi, 5					; 00000005H
-	mov	ecx, DWORD PTR pfPitch
+        Linear interpolation is computed as
 
-	add	WORD PTR [eax+edi*2+2], si
-	jo	overflow_rx
+        lM = (pcWave[dwPosition] * (0x1000 - dwFract) +
+              pcWave[dwPosition+1] * dwFract) >> 12;
 
-no_oflowrx:
+        which for sixteen bit waves is the same, bit for bit, as the old
 
-	add	edi, 2
-	jne	SHORT $L30797
+        lM = pcWave[dwPosition] +
+             (((pcWave[dwPosition+1] - pcWave[dwPosition]) * dwFract) >> 12);
 
-	pop	edi
+        Cubic and sinc interpolation take a filter from asCubicTable or
+        asSincTable, picked by the top eight bits of the fraction, and round
+        the 2.14 result.  Eight bit waves are read as sixteen bit samples
+        (shifted up eight), so one accumulator handles both formats.
 
-; 1039 : 			++dwIncDelta;
-; 1040 : 			continue;
+        The kernels come in C and SSE2 (mixsse2.cpp) versions that give
+        identical output.  Taps that would fall outside the wave are read
+        as silence by InterpolateEdge(), one sample at a time.
+*/
 
-	mov	edx, DWORD PTR pfPFract
-	cmp	edi, 0
-
-	jl	SHORT $L30536
-	jmp	SHORT $L30539
-
-$L30540_:
-
-; 982  : 	    {	
-; 983  : 	        if (pfLoopLength)
-
-	cmp	DWORD PTR pfLoopLength, 0
-	je	$L30539
-
-; 984  : 			{
-; 985  : 				pfSamplePos -= pfLoopLength;
-
-	sub	ebx, DWORD PTR pfLoopLength
-	jmp	$L30540
-
-$L30541_:
-; 994  :             pfPFract += pfDeltaPitch;
-
-	mov	ecx, DWORD PTR pfDeltaPitch
-	mov	esi, DWORD PTR vfDeltaLVolume
-
-	add	ecx, edx
-	mov	edx, DWORD PTR vfLVFract
-
-; 995  :             pfPitch = pfPFract >> 8;
-; 996  :             vfLVFract += vfDeltaLVolume;
-
-	mov	DWORD PTR pfPFract, ecx
-	add	edx, esi
-
-; 997  :             vfLVolume = vfLVFract >> 8;
-; 998  :             vfRVFract += vfDeltaRVolume;
-
-	sar	ecx, 8
-	mov	DWORD PTR vfLVFract, edx
-	
-	sar	edx, 8
-	mov	esi, DWORD PTR vfDeltaRVolume
-
-	mov	DWORD PTR vfLVolume, edx
-	mov	edx, DWORD PTR vfRVFract
-
-	add	edx, esi
-	mov	DWORD PTR pfPitch, ecx
-
-	mov	DWORD PTR vfRVFract, edx
-	mov	esi, DWORD PTR dwDeltaPeriod
-
-; 999  :             vfRVolume = vfRVFract >> 8;
-
-	sar	edx, 8
-	mov	DWORD PTR dwIncDelta, esi
-
-; 993  :             dwIncDelta = dwDeltaPeriod;
-
-	mov	DWORD PTR vfRVolume, edx
-	jmp	$L30541
-
-// Handle truncation.
-
-overflow_l:
-	mov	WORD PTR [eax+edi*2], 0x7fff
-	js	no_oflowl
-	mov	WORD PTR [eax+edi*2], 0x8000
-	jmp no_oflowl
-
-overflow_r:
-	mov	WORD PTR [eax+edi*2+2], 0x7fff
-	js	no_oflowr
-	mov	WORD PTR [eax+edi*2+2], 0x8000
-	jmp	no_oflowr
-
-overflow_lx:
-	mov	WORD PTR [eax+edi*2], 0x7fff
-	js	no_oflowlx
-	mov	WORD PTR [eax+edi*2], 0x8000
-	jmp	no_oflowlx
-
-overflow_rx:
-	mov	WORD PTR [eax+edi*2+2], 0x7fff
-	js	no_oflowrx
-	mov	WORD PTR [eax+edi*2+2], 0x8000
-	jmp	no_oflowrx
-
-$L30543:
-; 1041 : 		}
-; 1044 :         dwPosition = pfSamplePos >> 12;
-
-	mov	edx, ebx
-	mov	ecx, DWORD PTR pfPitch
-
-; 1045 :         dwFract = pfSamplePos & 0xFFF;
-
-	sar	edx, 12					; 0000000cH
-	mov	esi, ebx
-
-	add	ebx, ecx
-	and	esi, 4095				; 00000fffH
-
-; 1046 :         pfSamplePos += pfPitch;
-
-	mov	ecx, DWORD PTR pcWave
-
-; 1047 : 
-; 1048 :         lLM = (long) pcWave[dwPosition];
-
-	movsx	eax, BYTE PTR [ecx+edx]
-
-; 1049 :         lM = ((pcWave[dwPosition+1] - lLM) * dwFract);
-; 1050 :         lM >>= 12;
-; 1051 :         lM += lLM;
-
-	movsx	edx, BYTE PTR [ecx+edx+1]
-
-    sub	edx, eax
-	
-    imul	edx, esi
-
-; 1052 :         lLM = lM;
-; 1053 :         lLM *= vfLVolume;
-; 1054 :         lLM >>= 5;         // Signal bumps up to 15 bits.
-
-	sar	edx, 12					; 0000000cH
-	mov	esi, DWORD PTR vfLVolume
-
-	add	edx, eax
-
-; 1072 : 		pBuffer[dwI] += (short) lLM;
-
-	imul	esi, edx
-
-	sar	esi, 5					; 00000005H
-	mov	eax, DWORD PTR pBuf
-
-	add	WORD PTR [eax+edi*2], si
-	mov	esi, DWORD PTR vfRVolume
-
-	jo	overflow_l
-no_oflowl:
-
-; 1078 :         lM *= vfRVolume;
-; 1079 : 		lM >>= 5;
-
-	imul	esi, edx
-
-; 1080 : 		pBuffer[dwI+1] += (short) lM;
-; 1085 : no_oflowr:
-; 1087 : 		dwI += 2;
-
-	sar	esi, 5					; 00000005H
-	mov	ecx, DWORD PTR pfPitch
-
-	add	WORD PTR [eax+edi*2+2], si
-	mov	edx, DWORD PTR pfPFract
-
-	jo	overflow_r
-
-no_oflowr:
-; 978  : 
-; 979  :     for (dwI = 0; dwI < dwLength; )
-
-	add	edi, 2
-	jl $L30536
-
-$L30539:
-	mov DWORD PTR dwI, edi
-	mov DWORD PTR pfSamplePos, ebx
-}
-
-	dwI += dwLength;
-
-#endif // _X86_
+#include "common.h"
 
-    m_vfLastLVolume = vfLVolume;
-    m_vfLastRVolume = vfRVolume;
-    m_pfLastPitch = pfPitch;
-    m_pfLastSample = pfSamplePos;
-    return (dwI >> 1);
-}
+#define STR_MODULENAME "DDKSynth.sys:Mix: "
 
 /*****************************************************************************
- * CDigitalAudio::MixMono8()
+ * asCubicTable
  *****************************************************************************
- * Implement a mono eight-bit mix.
- * Heavily optimized for x86 non-MMX, plus C code for non-x86.
+ * Catmull-Rom filters for taps -1, 0, 1 and 2, one per phase.  Each row sums
+ * to exactly 1.0 in 2.14 fixed point, so a constant wave stays constant.
  */
-DWORD CDigitalAudio::MixMono8(short * pBuffer,    DWORD dwLength,
-                              DWORD dwDeltaPeriod,VFRACT vfDeltaVolume,
-                              PFRACT pfDeltaPitch,PFRACT pfSampleLength, 
-                              PFRACT pfLoopLength)
+const short asCubicTable[INTERP_PHASES][CUBIC_TAPS] =
 {
-    DWORD dwI;
-    DWORD dwPosition;
-    long lM;
-    DWORD dwIncDelta = dwDeltaPeriod;
-    VFRACT dwFract;
-    char * pcWave = (char *) m_pnWave;
-    PFRACT pfSamplePos = m_pfLastSample;
-    VFRACT vfVolume = m_vfLastLVolume;
-    PFRACT pfPitch = m_pfLastPitch;
-    PFRACT pfPFract = pfPitch << 8;
-    VFRACT vfVFract = vfVolume << 8;  // Keep high res version around. 
-
-#ifndef _X86_
-    for (dwI = 0; dwI < dwLength; )
-    {
-        if (pfSamplePos >= pfSampleLength)
-	    {	
-	        if (pfLoopLength)
-		    pfSamplePos -= pfLoopLength;
-	        else
-		    break;
-	    }
-        dwIncDelta--;
-        if (!dwIncDelta) 
-        {
-            dwIncDelta = dwDeltaPeriod;
-            pfPFract += pfDeltaPitch;
-            pfPitch = pfPFract >> 8;
-            vfVFract += vfDeltaVolume;
-            vfVolume = vfVFract >> 8;
-        }
-
-	    dwPosition = pfSamplePos >> 12;
-	    dwFract = pfSamplePos & 0xFFF;
-		pfSamplePos += pfPitch;
-
-	    lM = pcWave[dwPosition];
-	    lM += ((pcWave[dwPosition + 1] - lM) * dwFract) >> 12;
-		lM *= vfVolume;
-		lM >>= 5;
-
-#ifndef _X86_
-#ifdef _ALPHA_
-		int nBitmask;
-		if( ALPHA_OVERFLOW & (nBitmask = __ADAWI( (short) lM, &pBuffer[dwI] )) )  {
-			if( ALPHA_NEGATIVE & nBitmask )  {
-				pBuffer[dwI] = 0x7FFF;
-			}
-			else  pBuffer[dwI] = (short) 0x8000;
-		}
-#else // !_ALPHA_
-    //  TODO -- overflow code on ia64 (+ axp64?)
-#endif // !_ALPHA_
-
-#else // _X86_  (dead code)
-      // Keep this around so we can use it to generate new assembly code (see below...)
-		pBuffer[dwI] += (short) lM;
-        _asm{jno no_oflow}
-        pBuffer[dwI] = 0x7fff;
-        _asm{js  no_oflow}
-        pBuffer[dwI] = (short) 0x8000;
-no_oflow:
-#endif  // _X86_  (dead code)
-		dwI++;
-    }
-#else // _X86_
-	int i, a, b, c, total;
-	short * pBuf = pBuffer + dwLength, *pBufX;
-	dwI = - dwLength;
-
-	_asm {
-
-; 979  :     for (dwI = 0; dwI < dwLength; )
-
-//	Induction variables.
-	mov	edi, dwI
-	mov	ebx, DWORD PTR pfSamplePos
-
-// Previously set up.
-	cmp	DWORD PTR dwLength, 0
-	mov	edx, pfPFract
-
-	mov	ecx, DWORD PTR pfPitch
-	je	$L30539
-
-$L30536:
-	cmp	ebx, DWORD PTR pfSampleLength
-
-; 981  :         if (pfSamplePos >= pfSampleLength)
-
-	mov	esi, DWORD PTR dwIncDelta
-	jge	SHORT $L30540_
-
-$L30540:
-
-; 987  : 	        else
-; 988  : 		    break;
-; 990  :         dwIncDelta--;
-
-	dec	esi
-	mov	DWORD PTR dwIncDelta, esi
-
-; 991  :         if (!dwIncDelta)    
-
-	je	SHORT $L30541_
-
-$L30541:
-// esi, edx, edi		esi == dwIncDelta
-
-	mov	DWORD PTR i, 0
-
-; 1010 : 	b = dwIncDelta;
-// esi = b == dwIncDelta
-
-; 1011 : 	c = (pfSampleLength - pfSamplePos) / pfPitch;
-
-; 1009 : 	a = dwLength - dwI;	// Remaining span.
-
-	mov	edx, edi
-	neg	edx
-
-; 1017 : 	if (b < a && b < c)
-
-	cmp	esi, edx
-	jge	try_ax
-
-	mov	eax, ecx
-	imul	eax, esi
-	add	eax, ebx
-
-	cmp eax, DWORD PTR pfSampleLength 
-	jge	try_c
-
-; 1019 : 		i = b;
-
-	cmp	esi, 3
-	jl	got_it
-
-	mov	DWORD PTR i, esi
-	jmp	SHORT got_it
-
-; 1013 : 	if (a < b && a < c)
-
-try_a:
-
-	cmp	edx, esi
-	jge	try_c
-try_ax:
-	mov	eax, edx
-	imul	eax, ecx
-	add	eax, ebx
-
-	cmp eax, DWORD PTR pfSampleLength
-	jge	try_c
-
-; 1015 : 		i = a;
-
-	cmp	edx, 3
-	jl	got_it
-
-	mov	DWORD PTR i, edx
-	jmp	SHORT got_it
-
-; 1021 : 	else if (c < a && c < b)
-try_c:
-
-    push	edx
-	mov	eax, DWORD PTR pfSampleLength
-	sub	eax, ebx
-	cdq
-	idiv	ecx		// eax == c
-	pop	edx
-
-    cmp	eax, edx
-	jge	got_it
-try_cx:
-	cmp	eax, esi
-	jge	got_it
-
-; 1023 : 		i = c;
-
-	cmp	eax, 3
-	jl	$L30543
-
-	mov DWORD PTR i, eax
-
-got_it:
-	mov	edx, DWORD PTR i
-	mov	eax, DWORD PTR pBuf
-
-	dec	edx
-	jl	$L30543
-
-	sub	DWORD PTR dwIncDelta, edx
-
-; 1093 :     return (dwI);
-; 1094 : }
-
-	lea	edx, [edx+1]			// Current span.
-	lea	eax, [eax+edi*2]		// Starting position.
-
-	add	edi, edx				// Remaining span.
-	lea	eax, [eax+edx*2]		// New ending position.
-
-	push	edi
-	mov	edi, edx				// Current span.
-
-	mov	DWORD PTR pBufX, eax
-	neg	edi
-
-$L30797:
-		
-; 1005 : 			do
-; 1010 : 				dwPosition = pfSamplePos >> 12;
-; 1011 : 				dwFract = pfSamplePos & 0xFFF;
-
-	mov	edx, ebx
-	mov	esi, ebx
-
-	add	ebx, ecx
-	mov	ecx, DWORD PTR pcWave
-
-; 1012 : 				pfSamplePos += pfPitch;
-
-	sar	edx, 12					; 0000000cH
-	and	esi, 4095				; 00000fffH
-
-; 1013 : 
-; 1014 : 				lLM = (long) pcWave[dwPosition];
-
-	movsx	eax, BYTE PTR [ecx+edx]
-
-; 1015 : 				lM = ((pcWave[dwPosition+1] - lLM) * dwFract);
-; 1016 : 				lM >>= 12;
-; 1017 : 				lM += lLM;
-
-	movsx	edx, BYTE PTR [ecx+edx+1]
-
-	sub	edx, eax
-
-; 1018 : 				lLM = lM;
-; 1019 : 				lLM *= vfLVolume;
-; 1020 : 				lLM >>= 5;         // Signal bumps up to 15 bits.
-; 1022 : 				pBuffer[dwI] += (short) lLM;
-; 1027 : no_oflowx:	
-; 1037 : 				++dwI;
-
-	imul	edx, esi
-
-	sar	edx, 12					; 0000000cH
-	mov	esi, DWORD PTR vfVolume
-
-	mov	ecx, DWORD PTR pfPitch
-	add	edx, eax
-
-	imul	esi, edx
-
-	sar	esi, 5					; 00000005H
-	mov	eax, DWORD PTR pBufX
-
-	add	WORD PTR [eax+edi*2], si
-	jo	overflow_x
-
-no_oflowx:
-
-	inc	edi
-	jne	SHORT $L30797
-
-	pop	edi
-
-; 1039 : 			++dwIncDelta;
-; 1040 : 			continue;
-
-	mov	edx, DWORD PTR pfPFract
-	cmp	edi, 0
-
-	jl	SHORT $L30536
-	jmp	SHORT $L30539
-
-$L30540_:
-; 982  : 	    {	
-; 983  : 	        if (pfLoopLength)
-
-	cmp	DWORD PTR pfLoopLength, 0
-	je	$L30539
-
-; 984  : 			{
-; 985  : 				pfSamplePos -= pfLoopLength;
-
-	sub	ebx, DWORD PTR pfLoopLength
-	jmp	$L30540
-
-$L30541_:
-; 994  :             pfPFract += pfDeltaPitch;
-
-	mov	ecx, DWORD PTR pfDeltaPitch
-	mov	esi, DWORD PTR vfDeltaVolume
-
-	add	ecx, edx
-	mov	edx, DWORD PTR vfVFract
-
-; 995  :             pfPitch = pfPFract >> 8;
-; 996  :             vfVFract += vfDeltaVolume;
-
-	mov	DWORD PTR pfPFract, ecx
-	add	edx, esi
-
-; 997  :             vfLVolume = vfLVFract >> 8;
-
-	sar	ecx, 8
-	mov	DWORD PTR vfVFract, edx
-	
-	sar	edx, 8
-	mov	esi, DWORD PTR dwDeltaPeriod
-
-
-	mov	DWORD PTR vfVolume, edx
-	mov	DWORD PTR pfPitch, ecx
-
-
-	mov	DWORD PTR dwIncDelta, esi
-
-; 993  :             dwIncDelta = dwDeltaPeriod;
-
-	jmp	$L30541
-
-// Handle truncation.
-
-overflow_:
-	mov	WORD PTR [eax+edi*2], 0x7fff
-	js	no_oflow
-	mov	WORD PTR [eax+edi*2], 0x8000
-	jmp no_oflow
-
-overflow_x:
-	mov	WORD PTR [eax+edi*2], 0x7fff
-	js	no_oflowx
-	mov	WORD PTR [eax+edi*2], 0x8000
-	jmp	no_oflowx
-
-$L30543:
-; 1044 :         dwPosition = pfSamplePos >> 12;
-
-	mov	edx, ebx
-	mov	ecx, DWORD PTR pfPitch
-
-; 1045 :         dwFract = pfSamplePos & 0xFFF;
-
-	sar	edx, 12					; 0000000cH
-	mov	esi, ebx
-
-	add	ebx, ecx
-	and	esi, 4095				; 00000fffH
-
-; 1046 :         pfSamplePos += pfPitch;
-
-	mov	ecx, DWORD PTR pcWave
-
-; 1047 : 
-; 1048 :         lLM = (long) pcWave[dwPosition];
-
-	movsx	eax, BYTE PTR [ecx+edx]
-
-; 1049 :         lM = ((pcWave[dwPosition+1] - lLM) * dwFract);
-; 1050 :         lM >>= 12;
-; 1051 :         lM += lLM;
-
-	movsx	edx, BYTE PTR [ecx+edx+1]
-
-	sub	edx, eax
-
-	imul	edx, esi
-
-; 1052 :         lLM = lM;
-; 1053 :         lLM *= vfLVolume;
-; 1054 :         lLM >>= 5;         // Signal bumps up to 15 bits.
-
-	sar	edx, 12					; 0000000cH
-	mov	esi, DWORD PTR vfVolume
-
-	add	edx, eax
-
-; 1072 : 		pBuffer[dwI] += (short) lLM;
-
-	imul	esi, edx
-
-	sar	esi, 5					; 00000005H
-	mov	eax, DWORD PTR pBuf
-
-	add	WORD PTR [eax+edi*2], si
-	jo	overflow_
-no_oflow:
-	inc	edi
-	mov	edx, DWORD PTR pfPFract
-
-; 979  :     for (dwI = 0; dwI < dwLength; )
-
-	mov	ecx, DWORD PTR pfPitch
-	jl $L30536
-
-$L30539:
-	mov DWORD PTR dwI, edi
-	mov DWORD PTR pfSamplePos, ebx
-}
-
-	dwI += dwLength;
-
-#endif // _X86_
-
-    m_vfLastLVolume = vfVolume;
-    m_vfLastRVolume = vfVolume; // !!! is this right?
-    m_pfLastPitch = pfPitch;
-    m_pfLastSample = pfSamplePos;
-    return (dwI);
-}
-
+    {      0,  16384,      0,      0 },   //   0
+    {    -32,  16384,     32,      0 },   //   1
+    {    -63,  16381,     66,      0 },   //   2
+    {    -94,  16379,    100,     -1 },   //   3
+    {   -124,  16374,    136,     -2 },   //   4
+    {   -154,  16369,    172,     -3 },   //   5
+    {   -183,  16361,    210,     -4 },   //   6
+    {   -212,  16354,    248,     -6 },   //   7
+    {   -240,  16345,    287,     -8 },   //   8
+    {   -268,  16335,    327,    -10 },   //   9
+    {   -295,  16322,    369,    -12 },   //  10
+    {   -322,  16309,    411,    -14 },   //  11
+    {   -349,  16297,    453,    -17 },   //  12
+    {   -375,  16282,    497,    -20 },   //  13
+    {   -400,  16265,    542,    -23 },   //  14
+    {   -425,  16247,    588,    -26 },   //  15
+    {   -450,  16230,    634,    -30 },   //  16
+    {   -474,  16211,    681,    -34 },   //  17
+    {   -498,  16191,    729,    -38 },   //  18
+    {   -521,  16169,    778,    -42 },   //  19
+    {   -544,  16146,    828,    -46 },   //  20
+    {   -566,  16122,    879,    -51 },   //  21
+    {   -588,  16097,    930,    -55 },   //  22
+    {   -610,  16071,    983,    -60 },   //  23
+    {   -631,  16044,   1036,    -65 },   //  24
+    {   -651,  16015,   1090,    -70 },   //  25
+    {   -672,  15988,   1144,    -76 },   //  26
+    {   -691,  15957,   1200,    -82 },   //  27
+    {   -711,  15926,   1256,    -87 },   //  28
+    {   -730,  15894,   1313,    -93 },   //  29
+    {   -748,  15861,   1370,    -99 },   //  30
+    {   -766,  15827,   1429,   -106 },   //  31
+    {   -784,  15792,   1488,   -112 },   //  32
+    {   -801,  15756,   1548,   -119 },   //  33
+    {   -818,  15719,   1608,   -125 },   //  34
+    {   -835,  15681,   1670,   -132 },   //  35
+    {   -851,  15642,   1732,   -139 },   //  36
+    {   -866,  15602,   1794,   -146 },   //  37
+    {   -882,  15562,   1858,   -154 },   //  38
+    {   -897,  15520,   1922,   -161 },   //  39
+    {   -911,  15478,   1986,   -169 },   //  40
+    {   -925,  15433,   2052,   -176 },   //  41
+    {   -939,  15390,   2117,   -184 },   //  42
+    {   -953,  15345,   2184,   -192 },   //  43
+    {   -966,  15299,   2251,   -200 },   //  44
+    {   -978,  15252,   2319,   -209 },   //  45
+    {   -991,  15205,   2387,   -217 },   //  46
+    {  -1002,  15155,   2456,   -225 },   //  47
+    {  -1014,  15106,   2526,   -234 },   //  48
+    {  -1025,  15056,   2596,   -243 },   //  49
+    {  -1036,  15004,   2667,   -251 },   //  50
+    {  -1047,  14953,   2738,   -260 },   //  51
+    {  -1057,  14900,   2810,   -269 },   //  52
+    {  -1066,  14846,   2882,   -278 },   //  53
+    {  -1076,  14793,   2955,   -288 },   //  54
+    {  -1085,  14737,   3029,   -297 },   //  55
+    {  -1094,  14681,   3103,   -306 },   //  56
+    {  -1102,  14625,   3177,   -316 },   //  57
+    {  -1110,  14567,   3252,   -325 },   //  58
+    {  -1118,  14509,   3328,   -335 },   //  59
+    {  -1125,  14450,   3404,   -345 },   //  60
+    {  -1133,  14391,   3480,   -354 },   //  61
+    {  -1139,  14330,   3557,   -364 },   //  62
+    {  -1146,  14270,   3634,   -374 },   //  63
+    {  -1152,  14208,   3712,   -384 },   //  64
+    {  -1158,  14146,   3790,   -394 },   //  65
+    {  -1163,  14082,   3869,   -404 },   //  66
+    {  -1169,  14019,   3948,   -414 },   //  67
+    {  -1174,  13955,   4027,   -424 },   //  68
+    {  -1178,  13890,   4107,   -435 },   //  69
+    {  -1182,  13823,   4188,   -445 },   //  70
+    {  -1187,  13758,   4268,   -455 },   //  71
+    {  -1190,  13691,   4349,   -466 },   //  72
+    {  -1194,  13623,   4431,   -476 },   //  73
+    {  -1197,  13556,   4512,   -487 },   //  74
+    {  -1200,  13486,   4595,   -497 },   //  75
+    {  -1202,  13417,   4677,   -508 },   //  76
+    {  -1205,  13347,   4760,   -518 },   //  77
+    {  -1207,  13277,   4843,   -529 },   //  78
+    {  -1208,  13205,   4926,   -539 },   //  79
+    {  -1210,  13134,   5010,   -550 },   //  80
+    {  -1211,  13062,   5094,   -561 },   //  81
+    {  -1212,  12989,   5178,   -571 },   //  82
+    {  -1213,  12916,   5263,   -582 },   //  83
+    {  -1213,  12842,   5348,   -593 },   //  84
+    {  -1214,  12768,   5433,   -603 },   //  85
+    {  -1214,  12694,   5518,   -614 },   //  86
+    {  -1213,  12618,   5604,   -625 },   //  87
+    {  -1213,  12542,   5690,   -635 },   //  88
+    {  -1212,  12466,   5776,   -646 },   //  89
+    {  -1211,  12390,   5862,   -657 },   //  90
+    {  -1210,  12312,   5949,   -667 },   //  91
+    {  -1208,  12235,   6035,   -678 },   //  92
+    {  -1207,  12157,   6122,   -688 },   //  93
+    {  -1205,  12079,   6209,   -699 },   //  94
+    {  -1202,  11998,   6297,   -709 },   //  95
+    {  -1200,  11920,   6384,   -720 },   //  96
+    {  -1197,  11839,   6472,   -730 },   //  97
+    {  -1195,  11761,   6559,   -741 },   //  98
+    {  -1192,  11680,   6647,   -751 },   //  99
+    {  -1188,  11599,   6735,   -762 },   // 100
+    {  -1185,  11518,   6823,   -772 },   // 101
+    {  -1181,  11436,   6911,   -782 },   // 102
+    {  -1177,  11354,   7000,   -793 },   // 103
+    {  -1173,  11272,   7088,   -803 },   // 104
+    {  -1169,  11189,   7177,   -813 },   // 105
+    {  -1165,  11107,   7265,   -823 },   // 106
+    {  -1160,  11023,   7354,   -833 },   // 107
+    {  -1155,  10939,   7443,   -843 },   // 108
+    {  -1150,  10856,   7531,   -853 },   // 109
+    {  -1145,  10772,   7620,   -863 },   // 110
+    {  -1140,  10687,   7709,   -872 },   // 111
+    {  -1134,  10602,   7798,   -882 },   // 112
+    {  -1128,  10517,   7887,   -892 },   // 113
+    {  -1122,  10431,   7976,   -901 },   // 114
+    {  -1116,  10346,   8065,   -911 },   // 115
+    {  -1110,  10260,   8154,   -920 },   // 116
+    {  -1104,  10175,   8242,   -929 },   // 117
+    {  -1097,  10088,   8331,   -938 },   // 118
+    {  -1091,  10002,   8420,   -947 },   // 119
+    {  -1084,   9915,   8509,   -956 },   // 120
+    {  -1077,   9829,   8597,   -965 },   // 121
+    {  -1070,   9742,   8686,   -974 },   // 122
+    {  -1062,   9653,   8775,   -982 },   // 123
+    {  -1055,   9567,   8863,   -991 },   // 124
+    {  -1047,   9479,   8951,   -999 },   // 125
+    {  -1040,   9392,   9040,  -1008 },   // 126
+    {  -1032,   9304,   9128,  -1016 },   // 127
+    {  -1024,   9216,   9216,  -1024 },   // 128
+    {  -1016,   9128,   9304,  -1032 },   // 129
+    {  -1008,   9040,   9392,  -1040 },   // 130
+    {   -999,   8951,   9479,  -1047 },   // 131
+    {   -991,   8863,   9567,  -1055 },   // 132
+    {   -982,   8775,   9653,  -1062 },   // 133
+    {   -974,   8686,   9742,  -1070 },   // 134
+    {   -965,   8597,   9829,  -1077 },   // 135
+    {   -956,   8509,   9915,  -1084 },   // 136
+    {   -947,   8420,  10002,  -1091 },   // 137
+    {   -938,   8331,  10088,  -1097 },   // 138
+    {   -929,   8242,  10175,  -1104 },   // 139
+    {   -920,   8154,  10260,  -1110 },   // 140
+    {   -911,   8065,  10346,  -1116 },   // 141
+    {   -901,   7976,  10431,  -1122 },   // 142
+    {   -892,   7887,  10517,  -1128 },   // 143
+    {   -882,   7798,  10602,  -1134 },   // 144
+    {   -872,   7709,  10687,  -1140 },   // 145
+    {   -863,   7620,  10772,  -1145 },   // 146
+    {   -853,   7531,  10856,  -1150 },   // 147
+    {   -843,   7443,  10939,  -1155 },   // 148
+    {   -833,   7354,  11023,  -1160 },   // 149
+    {   -823,   7265,  11107,  -1165 },   // 150
+    {   -813,   7177,  11189,  -1169 },   // 151
+    {   -803,   7088,  11272,  -1173 },   // 152
+    {   -793,   7000,  11354,  -1177 },   // 153
+    {   -782,   6911,  11436,  -1181 },   // 154
+    {   -772,   6823,  11518,  -1185 },   // 155
+    {   -762,   6735,  11599,  -1188 },   // 156
+    {   -751,   6647,  11680,  -1192 },   // 157
+    {   -741,   6559,  11761,  -1195 },   // 158
+    {   -730,   6472,  11839,  -1197 },   // 159
+    {   -720,   6384,  11920,  -1200 },   // 160
+    {   -709,   6297,  11998,  -1202 },   // 161
+    {   -699,   6209,  12079,  -1205 },   // 162
+    {   -688,   6122,  12157,  -1207 },   // 163
+    {   -678,   6035,  12235,  -1208 },   // 164
+    {   -667,   5949,  12312,  -1210 },   // 165
+    {   -657,   5862,  12390,  -1211 },   // 166
+    {   -646,   5776,  12466,  -1212 },   // 167
+    {   -635,   5690,  12542,  -1213 },   // 168
+    {   -625,   5604,  12618,  -1213 },   // 169
+    {   -614,   5518,  12694,  -1214 },   // 170
+    {   -603,   5433,  12768,  -1214 },   // 171
+    {   -593,   5348,  12842,  -1213 },   // 172
+    {   -582,   5263,  12916,  -1213 },   // 173
+    {   -571,   5178,  12989,  -1212 },   // 174
+    {   -561,   5094,  13062,  -1211 },   // 175
+    {   -550,   5010,  13134,  -1210 },   // 176
+    {   -539,   4926,  13205,  -1208 },   // 177
+    {   -529,   4843,  13277,  -1207 },   // 178
+    {   -518,   4760,  13347,  -1205 },   // 179
+    {   -508,   4677,  13417,  -1202 },   // 180
+    {   -497,   4595,  13486,  -1200 },   // 181
+    {   -487,   4512,  13556,  -1197 },   // 182
+    {   -476,   4431,  13623,  -1194 },   // 183
+    {   -466,   4349,  13691,  -1190 },   // 184
+    {   -455,   4268,  13758,  -1187 },   // 185
+    {   -445,   4188,  13823,  -1182 },   // 186
+    {   -435,   4107,  13890,  -1178 },   // 187
+    {   -424,   4027,  13955,  -1174 },   // 188
+    {   -414,   3948,  14019,  -1169 },   // 189
+    {   -404,   3869,  14082,  -1163 },   // 190
+    {   -394,   3790,  14146,  -1158 },   // 191
+    {   -384,   3712,  14208,  -1152 },   // 192
+    {   -374,   3634,  14270,  -1146 },   // 193
+    {   -364,   3557,  14330,  -1139 },   // 194
+    {   -354,   3480,  14391,  -1133 },   // 195
+    {   -345,   3404,  14450,  -1125 },   // 196
+    {   -335,   3328,  14509,  -1118 },   // 197
+    {   -325,   3252,  14567,  -1110 },   // 198
+    {   -316,   3177,  14625,  -1102 },   // 199
+    {   -306,   3103,  14681,  -1094 },   // 200
+    {   -297,   3029,  14737,  -1085 },   // 201
+    {   -288,   2955,  14793,  -1076 },   // 202
+    {   -278,   2882,  14846,  -1066 },   // 203
+    {   -269,   2810,  14900,  -1057 },   // 204
+    {   -260,   2738,  14953,  -1047 },   // 205
+    {   -251,   2667,  15004,  -1036 },   // 206
+    {   -243,   2596,  15056,  -1025 },   // 207
+    {   -234,   2526,  15106,  -1014 },   // 208
+    {   -225,   2456,  15155,  -1002 },   // 209
+    {   -217,   2387,  15205,   -991 },   // 210
+    {   -209,   2319,  15252,   -978 },   // 211
+    {   -200,   2251,  15299,   -966 },   // 212
+    {   -192,   2184,  15345,   -953 },   // 213
+    {   -184,   2117,  15390,   -939 },   // 214
+    {   -176,   2052,  15433,   -925 },   // 215
+    {   -169,   1986,  15478,   -911 },   // 216
+    {   -161,   1922,  15520,   -897 },   // 217
+    {   -154,   1858,  15562,   -882 },   // 218
+    {   -146,   1794,  15602,   -866 },   // 219
+    {   -139,   1732,  15642,   -851 },   // 220
+    {   -132,   1670,  15681,   -835 },   // 221
+    {   -125,   1608,  15719,   -818 },   // 222
+    {   -119,   1548,  15756,   -801 },   // 223
+    {   -112,   1488,  15792,   -784 },   // 224
+    {   -106,   1429,  15827,   -766 },   // 225
+    {    -99,   1370,  15861,   -748 },   // 226
+    {    -93,   1313,  15894,   -730 },   // 227
+    {    -87,   1256,  15926,   -711 },   // 228
+    {    -82,   1200,  15957,   -691 },   // 229
+    {    -76,   1144,  15988,   -672 },   // 230
+    {    -70,   1090,  16015,   -651 },   // 231
+    {    -65,   1036,  16044,   -631 },   // 232
+    {    -60,    983,  16071,   -610 },   // 233
+    {    -55,    930,  16097,   -588 },   // 234
+    {    -51,    879,  16122,   -566 },   // 235
+    {    -46,    828,  16146,   -544 },   // 236
+    {    -42,    778,  16169,   -521 },   // 237
+    {    -38,    729,  16191,   -498 },   // 238
+    {    -34,    681,  16211,   -474 },   // 239
+    {    -30,    634,  16230,   -450 },   // 240
+    {    -26,    588,  16247,   -425 },   // 241
+    {    -23,    542,  16265,   -400 },   // 242
+    {    -20,    497,  16282,   -375 },   // 243
+    {    -17,    453,  16297,   -349 },   // 244
+    {    -14,    411,  16309,   -322 },   // 245
+    {    -12,    369,  16322,   -295 },   // 246
+    {    -10,    327,  16335,   -268 },   // 247
+    {     -8,    287,  16345,   -240 },   // 248
+    {     -6,    248,  16354,   -212 },   // 249
+    {     -4,    210,  16361,   -183 },   // 250
+    {     -3,    172,  16369,   -154 },   // 251
+    {     -2,    136,  16374,   -124 },   // 252
+    {     -1,    100,  16379,    -94 },   // 253
+    {      0,     66,  16381,    -63 },   // 254
+    {      0,     32,  16384,    -32 },   // 255
+};
 
 /*****************************************************************************
- * CDigitalAudio::Mix16()
+ * asSincTable
  *****************************************************************************
- * Implement a stereo sixteen-bit mix.
- * Heavily optimized for x86 non-MMX, plus C code for non-x86.
+ * Kaiser windowed (beta 6) sinc filters for taps -3 through 4, one per
+ * phase, with the cutoff at 0.9 of Nyquist to keep the image out of the
+ * top octave.  Each row sums to exactly 1.0 in 2.14 fixed point.
  */
-DWORD CDigitalAudio::Mix16(short * pBuffer,      DWORD dwLength, 
-                           DWORD dwDeltaPeriod,  VFRACT vfDeltaLVolume, 
-                           VFRACT vfDeltaRVolume,PFRACT pfDeltaPitch, 
-                           PFRACT pfSampleLength,PFRACT pfLoopLength)
+const short asSincTable[INTERP_PHASES][SINC_TAPS] =
 {
-    DWORD dwI;
-    DWORD dwPosition;
-    long lA;
-    long lM;
-    DWORD dwIncDelta = dwDeltaPeriod;
-    VFRACT dwFract;
-    short * pcWave = m_pnWave;
-    PFRACT pfSamplePos = m_pfLastSample;
-    VFRACT vfLVolume = m_vfLastLVolume;
-    VFRACT vfRVolume = m_vfLastRVolume;
-    PFRACT pfPitch = m_pfLastPitch;
-    PFRACT pfPFract = pfPitch << 8;
-    VFRACT vfLVFract = vfLVolume << 8;  // Keep high res version around.
-    VFRACT vfRVFract = vfRVolume << 8; 
-	dwLength <<= 1;
-
-#ifndef _X86_
-    for (dwI = 0; dwI < dwLength; )
-    {
-        if (pfSamplePos >= pfSampleLength)
-	    {	
-	        if (pfLoopLength)
-			{
-				pfSamplePos -= pfLoopLength;
-			}
-	        else
-		    break;
-	    }
-        dwIncDelta--;
-        if (!dwIncDelta)    
-        {
-            dwIncDelta = dwDeltaPeriod;
-            pfPFract += pfDeltaPitch;
-            pfPitch = pfPFract >> 8;
-            vfLVFract += vfDeltaLVolume;
-            vfLVolume = vfLVFract >> 8;
-            vfRVFract += vfDeltaRVolume;
-            vfRVolume = vfRVFract >> 8;
-        }
-        dwPosition = pfSamplePos >> 12;
-        dwFract = pfSamplePos & 0xFFF;
-        pfSamplePos += pfPitch;
-
-        lA = (long) pcWave[dwPosition];
-        lM = ((pcWave[dwPosition+1] - lA) * dwFract);
-        lM >>= 12;
-        lM += lA;
-        lA = lM;
-        lA *= vfLVolume;
-        lA >>= 13;         // Signal bumps up to 15 bits.
-		lM *= vfRVolume;
-		lM >>= 13;
-#ifndef _X86_
-#ifdef _ALPHA_
-		int nBitmask;
-		if( ALPHA_OVERFLOW & (nBitmask = __ADAWI( (short) lA, &pBuffer[dwI] )) )  {
-			if( ALPHA_NEGATIVE & nBitmask )  {
-				pBuffer[dwI] = 0x7FFF;
-			}
-			else  pBuffer[dwI] = (short) 0x8000;
-		}
-		if( ALPHA_OVERFLOW & (nBitmask = __ADAWI( (short) lM, &pBuffer[dwI+1] )) )  {
-			if( ALPHA_NEGATIVE & nBitmask )  {
-				pBuffer[dwI+1] = 0x7FFF;
-			}
-			else  pBuffer[dwI+1] = (short) 0x8000;
-		}
-#else // !_ALPHA_
-    //  TODO -- overflow detection on ia64 (+ axp64?)
-#endif // !_ALPHA_
-#else // _X86_  (dead code)
-      //  Keep this around so we can use it to generate new assembly code (see below...)
-		pBuffer[dwI] += (short) lA;
-
-        _asm{jno no_oflowl}
-        pBuffer[dwI] = 0x7fff;
-        _asm{js  no_oflowl}
-        pBuffer[dwI] = (short) 0x8000;
-no_oflowl:	
-
-		pBuffer[dwI+1] += (short) lM;
-
-        _asm{jno no_oflowr}
-        pBuffer[dwI+1] = 0x7fff;
-        _asm{js  no_oflowr}
-        pBuffer[dwI+1] = (short) 0x8000;
-no_oflowr:
-
-#endif // _X86_  (dead code)
-		dwI += 2;
-    }
-#else // _X86_
-	int i, a, b, c, total;
-	short * pBuf = pBuffer + dwLength, *pBufX;
-	dwI = - dwLength;
-
-	_asm {
-
-; 979  :     for (dwI = 0; dwI < dwLength; )
-
-//	Induction variables.
-	mov	edi, dwI
-	mov	ebx, DWORD PTR pfSamplePos
-
-// Previously set up.
-	cmp	DWORD PTR dwLength, 0
-	mov	edx, pfPFract
-
-	mov	ecx, DWORD PTR pfPitch
-	je	$L30539
-
-$L30536:
-	cmp	ebx, DWORD PTR pfSampleLength
-
-; 981  :         if (pfSamplePos >= pfSampleLength)
-
-	mov	esi, DWORD PTR dwIncDelta
-	jge	SHORT $L30540_
-
-$L30540:
-; 987  : 	        else
-; 988  : 		    break;
-; 990  :         dwIncDelta--;
-
-	dec	esi
-	mov	DWORD PTR dwIncDelta, esi
-
-; 991  :         if (!dwIncDelta)    
-
-	je	SHORT $L30541_
-
-$L30541:
-// esi, edx, edi		esi == dwIncDelta
-
-	mov	DWORD PTR i, 0
-
-; 1010 : 	b = dwIncDelta;
-// esi = b == dwIncDelta
-; 1011 : 	c = (pfSampleLength - pfSamplePos) / pfPitch;
-; 1009 : 	a = (dwLength - dwI) / 2;	// Remaining span.
-
-	mov	edx, edi
-	neg	edx
-	shr	edx, 1		// edx = a
-
-; 1017 : 	if (b < a && b < c)
-
-	cmp	esi, edx
-	jge	try_ax
-
-	mov	eax, ecx
-	imul	eax, esi
-	add	eax, ebx
-
-	cmp eax, DWORD PTR pfSampleLength 
-	jge	try_c
-
-; 1019 : 		i = b;
-
-	cmp	esi, 3
-	jl	got_it
-
-	mov	DWORD PTR i, esi
-	jmp	SHORT got_it
-
-; 1013 : 	if (a < b && a < c)
-
-try_a:
-
-	cmp	edx, esi
-	jge	try_c
-try_ax:
-	mov	eax, edx
-	imul	eax, ecx
-	add	eax, ebx
-
-	cmp eax, DWORD PTR pfSampleLength
-	jge	try_c
-
-; 1015 : 		i = a;
-
-	cmp	edx, 3
-	jl	got_it
-
-	mov	DWORD PTR i, edx
-	jmp	SHORT got_it
-
-; 1021 : 	else if (c < a && c < b)
-try_c:
-
-    push	edx
-	mov	eax, DWORD PTR pfSampleLength
-	sub	eax, ebx
-	cdq
-	idiv	ecx		// eax == c
-	pop	edx
-
-    cmp	eax, edx
-	jge	got_it
-try_cx:
-	cmp	eax, esi
-	jge	got_it
-
-; 1023 : 		i = c;
-
-	cmp	eax, 3
-	jl	$L30543
-
-	mov DWORD PTR i, eax
-
-got_it:
-	mov	edx, DWORD PTR i
-	mov	eax, DWORD PTR pBuf
-
-	dec	edx
-	jl	$L30543
-
-	sub	DWORD PTR dwIncDelta, edx
-
-; 1093 :     return (dwI >> 1);
-; 1094 : }
-
-	lea	edx, [edx*2+2]			// Current span.
-	lea	eax, [eax+edi*2]		// Starting position.
-
-	add	edi, edx				// Remaining span.
-	lea	eax, [eax+edx*2]		// New ending position.
-
-	push	edi
-	mov	edi, edx				// Current span.
-
-	mov	DWORD PTR pBufX, eax
-	neg	edi
-
-$L30797:
-		
-; 1005 : 			do
-; 1010 : 				dwPosition = pfSamplePos >> 12;
-; 1011 : 				dwFract = pfSamplePos & 0xFFF;
-
-	mov	edx, ebx
-	mov	esi, ebx
-
-	add	ebx, ecx
-	mov	ecx, DWORD PTR pcWave
-
-; 1012 : 				pfSamplePos += pfPitch;
-
-	sar	edx, 12					; 0000000cH
-	and	esi, 4095				; 00000fffH
-
-; 1014 : 				lA = (long) pcWave[dwPosition];
-
-	movsx	eax, WORD PTR [ecx+edx*2]
-
-; 1015 : 				lM = ((pcWave[dwPosition+1] - lA) * dwFract);
-; 1016 : 				lM >>= 12;
-; 1017 : 				lM += lA;
-
-	movsx	edx, WORD PTR [ecx+edx*2+2]
-	sub	edx, eax
-
-; 1018 : 				lA = lM;
-; 1019 : 				lA *= vfLVolume;
-; 1020 : 				lA >>= 13;         // Signal bumps up to 15 bits.
-; 1022 : 				pBuffer[dwI] += (short) lA;
-; 1027 : no_oflowlx:	
-; 1028 : 						lM *= vfRVolume;
-; 1029 : 						lM >>= 13;
-; 1030 : 				pBuffer[dwI+1] += (short) lM;
-; 1035 : no_oflowrx:
-; 1037 : 				dwI += 2;
-
-	imul	edx, esi
-
-	sar	edx, 12					; 0000000cH
-	mov	esi, DWORD PTR vfLVolume
-
-	add	edx, eax
-	mov	eax, DWORD PTR pBufX
-
-	imul	esi, edx
-
-	sar	esi, 13					; 0000000dH
-
-	add	WORD PTR [eax+edi*2], si
-
-	mov	esi, DWORD PTR vfRVolume
-	jo	overflow_lx
-no_oflowlx:
-
-	imul	esi, edx
-
-; 1038 : 			} while (--dwIncDelta);
-
-	sar	esi, 13					; 0000000dH
-	mov	ecx, DWORD PTR pfPitch
-
-	add	WORD PTR [eax+edi*2+2], si
-	jo	overflow_rx
-
-no_oflowrx:
-
-	add	edi, 2
-	jne	SHORT $L30797
-
-	pop	edi
-
-; 1039 : 			++dwIncDelta;
-; 1040 : 			continue;
-
-	mov	edx, DWORD PTR pfPFract
-	cmp	edi, 0
-
-	jl	SHORT $L30536
-	jmp	SHORT $L30539
-
-$L30540_:
-; 982  : 	    {	
-; 983  : 	        if (pfLoopLength)
-
-	cmp	DWORD PTR pfLoopLength, 0
-	je	$L30539
-
-; 985  : 				pfSamplePos -= pfLoopLength;
-
-	sub	ebx, DWORD PTR pfLoopLength
-	jmp	$L30540
-
-$L30541_:
-; 994  :             pfPFract += pfDeltaPitch;
-
-	mov	ecx, DWORD PTR pfDeltaPitch
-	mov	esi, DWORD PTR vfDeltaLVolume
-
-	add	ecx, edx
-	mov	edx, DWORD PTR vfLVFract
-
-; 995  :             pfPitch = pfPFract >> 8;
-; 996  :             vfLVFract += vfDeltaLVolume;
-
-	mov	DWORD PTR pfPFract, ecx
-	add	edx, esi
-
-; 997  :             vfLVolume = vfLVFract >> 8;
-; 998  :             vfRVFract += vfDeltaRVolume;
-
-	sar	ecx, 8
-	mov	DWORD PTR vfLVFract, edx
-	
-	sar	edx, 8
-	mov	esi, DWORD PTR vfDeltaRVolume
-
-	mov	DWORD PTR vfLVolume, edx
-	mov	edx, DWORD PTR vfRVFract
-
-	add	edx, esi
-	mov	DWORD PTR pfPitch, ecx
-
-	mov	DWORD PTR vfRVFract, edx
-	mov	esi, DWORD PTR dwDeltaPeriod
-
-; 999  :             vfRVolume = vfRVFract >> 8;
-
-	sar	edx, 8
-	mov	DWORD PTR dwIncDelta, esi
-
-; 993  :             dwIncDelta = dwDeltaPeriod;
-
-	mov	DWORD PTR vfRVolume, edx
-	jmp	$L30541
-
-// Handle truncation.
-overflow_l:
-	mov	WORD PTR [eax+edi*2], 0x7fff
-	js	no_oflowl
-	mov	WORD PTR [eax+edi*2], 0x8000
-	jmp no_oflowl
-
-overflow_r:
-	mov	WORD PTR [eax+edi*2+2], 0x7fff
-	js	no_oflowr
-	mov	WORD PTR [eax+edi*2+2], 0x8000
-	jmp	no_oflowr
-
-overflow_lx:
-	mov	WORD PTR [eax+edi*2], 0x7fff
-	js	no_oflowlx
-	mov	WORD PTR [eax+edi*2], 0x8000
-	jmp	no_oflowlx
-
-overflow_rx:
-	mov	WORD PTR [eax+edi*2+2], 0x7fff
-	js	no_oflowrx
-	mov	WORD PTR [eax+edi*2+2], 0x8000
-	jmp	no_oflowrx
-
-$L30543:
-; 1044 :         dwPosition = pfSamplePos >> 12;
-
-	mov	edx, ebx
-	mov	ecx, DWORD PTR pfPitch
-
-; 1045 :         dwFract = pfSamplePos & 0xFFF;
+    {    230,   -739,   1352,  14716,   1352,   -739,    230,    -18 },   //   0
+    {    226,   -724,   1299,  14718,   1405,   -754,    233,    -19 },   //   1
+    {    223,   -709,   1247,  14715,   1459,   -769,    237,    -19 },   //   2
+    {    219,   -694,   1195,  14715,   1513,   -784,    240,    -20 },   //   3
+    {    216,   -679,   1143,  14711,   1568,   -799,    244,    -20 },   //   4
+    {    212,   -665,   1091,  14711,   1622,   -814,    247,    -20 },   //   5
+    {    209,   -650,   1040,  14706,   1678,   -829,    251,    -21 },   //   6
+    {    206,   -635,    990,  14701,   1733,   -844,    254,    -21 },   //   7
+    {    202,   -621,    940,  14698,   1789,   -859,    257,    -22 },   //   8
+    {    199,   -606,    890,  14691,   1845,   -874,    261,    -22 },   //   9
+    {    196,   -592,    840,  14687,   1902,   -890,    264,    -23 },   //  10
+    {    192,   -578,    791,  14680,   1959,   -905,    268,    -23 },   //  11
+    {    189,   -563,    743,  14672,   2016,   -920,    271,    -24 },   //  12
+    {    185,   -549,    694,  14664,   2074,   -935,    275,    -24 },   //  13
+    {    182,   -535,    646,  14657,   2131,   -951,    278,    -24 },   //  14
+    {    179,   -520,    599,  14645,   2190,   -966,    282,    -25 },   //  15
+    {    176,   -506,    552,  14635,   2248,   -981,    285,    -25 },   //  16
+    {    172,   -492,    505,  14626,   2307,   -997,    289,    -26 },   //  17
+    {    169,   -478,    459,  14613,   2367,  -1012,    292,    -26 },   //  18
+    {    166,   -464,    413,  14601,   2426,  -1027,    296,    -27 },   //  19
+    {    163,   -451,    367,  14589,   2486,  -1042,    299,    -27 },   //  20
+    {    159,   -437,    322,  14577,   2546,  -1058,    303,    -28 },   //  21
+    {    156,   -423,    278,  14561,   2607,  -1073,    306,    -28 },   //  22
+    {    153,   -409,    234,  14545,   2668,  -1088,    310,    -29 },   //  23
+    {    150,   -396,    190,  14530,   2729,  -1103,    313,    -29 },   //  24
+    {    147,   -382,    146,  14514,   2790,  -1119,    317,    -29 },   //  25
+    {    143,   -369,    103,  14499,   2852,  -1134,    320,    -30 },   //  26
+    {    140,   -356,     61,  14481,   2914,  -1149,    323,    -30 },   //  27
+    {    137,   -343,     19,  14463,   2976,  -1164,    327,    -31 },   //  28
+    {    134,   -329,    -23,  14443,   3039,  -1179,    330,    -31 },   //  29
+    {    131,   -316,    -64,  14425,   3102,  -1195,    333,    -32 },   //  30
+    {    128,   -303,   -105,  14404,   3165,  -1210,    337,    -32 },   //  31
+    {    125,   -290,   -146,  14385,   3228,  -1225,    340,    -33 },   //  32
+    {    122,   -278,   -186,  14364,   3292,  -1240,    343,    -33 },   //  33
+    {    119,   -265,   -225,  14341,   3356,  -1255,    347,    -34 },   //  34
+    {    116,   -252,   -265,  14319,   3420,  -1270,    350,    -34 },   //  35
+    {    113,   -240,   -303,  14296,   3485,  -1285,    353,    -35 },   //  36
+    {    110,   -227,   -342,  14272,   3549,  -1299,    356,    -35 },   //  37
+    {    107,   -215,   -380,  14247,   3614,  -1314,    360,    -35 },   //  38
+    {    105,   -203,   -417,  14221,   3680,  -1329,    363,    -36 },   //  39
+    {    102,   -190,   -454,  14195,   3745,  -1344,    366,    -36 },   //  40
+    {     99,   -178,   -491,  14169,   3811,  -1358,    369,    -37 },   //  41
+    {     96,   -166,   -527,  14142,   3877,  -1373,    372,    -37 },   //  42
+    {     93,   -154,   -563,  14115,   3943,  -1387,    375,    -38 },   //  43
+    {     91,   -143,   -598,  14086,   4009,  -1402,    379,    -38 },   //  44
+    {     88,   -131,   -633,  14057,   4076,  -1416,    382,    -39 },   //  45
+    {     85,   -119,   -667,  14027,   4143,  -1431,    385,    -39 },   //  46
+    {     83,   -108,   -701,  13996,   4210,  -1445,    388,    -39 },   //  47
+    {     80,    -97,   -735,  13967,   4277,  -1459,    391,    -40 },   //  48
+    {     77,    -85,   -768,  13934,   4345,  -1473,    394,    -40 },   //  49
+    {     75,    -74,   -801,  13904,   4412,  -1487,    396,    -41 },   //  50
+    {     72,    -63,   -833,  13871,   4480,  -1501,    399,    -41 },   //  51
+    {     70,    -52,   -865,  13838,   4548,  -1515,    402,    -42 },   //  52
+    {     67,    -41,   -897,  13805,   4616,  -1529,    405,    -42 },   //  53
+    {     65,    -30,   -928,  13768,   4685,  -1542,    408,    -42 },   //  54
+    {     62,    -20,   -958,  13736,   4753,  -1556,    410,    -43 },   //  55
+    {     60,     -9,   -988,  13698,   4822,  -1569,    413,    -43 },   //  56
+    {     57,      1,  -1018,  13664,   4891,  -1583,    416,    -44 },   //  57
+    {     55,     11,  -1047,  13627,   4960,  -1596,    418,    -44 },   //  58
+    {     52,     22,  -1076,  13589,   5029,  -1609,    421,    -44 },   //  59
+    {     50,     32,  -1105,  13552,   5098,  -1622,    424,    -45 },   //  60
+    {     48,     42,  -1132,  13512,   5168,  -1635,    426,    -45 },   //  61
+    {     45,     52,  -1160,  13475,   5237,  -1648,    429,    -46 },   //  62
+    {     43,     61,  -1187,  13435,   5307,  -1660,    431,    -46 },   //  63
+    {     41,     71,  -1214,  13395,   5377,  -1673,    433,    -46 },   //  64
+    {     39,     81,  -1240,  13353,   5447,  -1685,    436,    -47 },   //  65
+    {     37,     90,  -1266,  13313,   5517,  -1698,    438,    -47 },   //  66
+    {     34,     99,  -1291,  13271,   5588,  -1710,    440,    -47 },   //  67
+    {     32,    109,  -1316,  13229,   5658,  -1722,    442,    -48 },   //  68
+    {     30,    118,  -1341,  13187,   5728,  -1734,    444,    -48 },   //  69
+    {     28,    127,  -1365,  13142,   5799,  -1746,    447,    -48 },   //  70
+    {     26,    136,  -1389,  13098,   5870,  -1757,    449,    -49 },   //  71
+    {     24,    144,  -1412,  13055,   5940,  -1769,    451,    -49 },   //  72
+    {     22,    153,  -1435,  13009,   6011,  -1780,    453,    -49 },   //  73
+    {     20,    161,  -1457,  12965,   6082,  -1791,    454,    -50 },   //  74
+    {     18,    170,  -1479,  12918,   6153,  -1802,    456,    -50 },   //  75
+    {     16,    178,  -1501,  12872,   6224,  -1813,    458,    -50 },   //  76
+    {     15,    186,  -1522,  12824,   6295,  -1824,    460,    -50 },   //  77
+    {     13,    194,  -1543,  12778,   6366,  -1834,    461,    -51 },   //  78
+    {     11,    202,  -1563,  12730,   6437,  -1845,    463,    -51 },   //  79
+    {      9,    210,  -1583,  12680,   6509,  -1855,    465,    -51 },   //  80
+    {      7,    218,  -1602,  12631,   6580,  -1865,    466,    -51 },   //  81
+    {      6,    225,  -1621,  12582,   6651,  -1875,    467,    -51 },   //  82
+    {      4,    233,  -1640,  12532,   6722,  -1884,    469,    -52 },   //  83
+    {      2,    240,  -1658,  12482,   6794,  -1894,    470,    -52 },   //  84
+    {      1,    247,  -1676,  12431,   6865,  -1903,    471,    -52 },   //  85
+    {     -1,    255,  -1694,  12379,   6937,  -1912,    472,    -52 },   //  86
+    {     -3,    262,  -1711,  12327,   7008,  -1921,    474,    -52 },   //  87
+    {     -4,    268,  -1727,  12275,   7079,  -1930,    475,    -52 },   //  88
+    {     -6,    275,  -1743,  12222,   7151,  -1938,    476,    -53 },   //  89
+    {     -7,    282,  -1759,  12169,   7222,  -1946,    476,    -53 },   //  90
+    {     -9,    288,  -1775,  12117,   7293,  -1954,    477,    -53 },   //  91
+    {    -10,    295,  -1790,  12061,   7365,  -1962,    478,    -53 },   //  92
+    {    -12,    301,  -1804,  12007,   7436,  -1970,    479,    -53 },   //  93
+    {    -13,    307,  -1818,  11952,   7507,  -1977,    479,    -53 },   //  94
+    {    -14,    313,  -1832,  11897,   7578,  -1985,    480,    -53 },   //  95
+    {    -16,    319,  -1846,  11842,   7650,  -1992,    480,    -53 },   //  96
+    {    -17,    325,  -1859,  11784,   7721,  -1998,    481,    -53 },   //  97
+    {    -18,    331,  -1871,  11727,   7792,  -2005,    481,    -53 },   //  98
+    {    -20,    337,  -1884,  11671,   7863,  -2011,    481,    -53 },   //  99
+    {    -21,    342,  -1896,  11614,   7934,  -2017,    481,    -53 },   // 100
+    {    -22,    347,  -1907,  11556,   8004,  -2023,    482,    -53 },   // 101
+    {    -23,    353,  -1918,  11497,   8075,  -2029,    482,    -53 },   // 102
+    {    -24,    358,  -1929,  11439,   8146,  -2034,    481,    -53 },   // 103
+    {    -26,    363,  -1939,  11381,   8216,  -2039,    481,    -53 },   // 104
+    {    -27,    368,  -1949,  11321,   8287,  -2044,    481,    -53 },   // 105
+    {    -28,    373,  -1959,  11262,   8357,  -2049,    481,    -53 },   // 106
+    {    -29,    377,  -1968,  11203,   8427,  -2053,    480,    -53 },   // 107
+    {    -30,    382,  -1977,  11140,   8498,  -2057,    480,    -52 },   // 108
+    {    -31,    386,  -1985,  11080,   8568,  -2061,    479,    -52 },   // 109
+    {    -32,    391,  -1994,  11019,   8638,  -2065,    479,    -52 },   // 110
+    {    -33,    395,  -2001,  10958,   8707,  -2068,    478,    -52 },   // 111
+    {    -34,    399,  -2009,  10897,   8777,  -2071,    477,    -52 },   // 112
+    {    -35,    403,  -2016,  10835,   8846,  -2074,    476,    -51 },   // 113
+    {    -36,    407,  -2023,  10772,   8916,  -2076,    475,    -51 },   // 114
+    {    -36,    411,  -2029,  10708,   8985,  -2078,    474,    -51 },   // 115
+    {    -37,    415,  -2035,  10645,   9054,  -2080,    473,    -51 },   // 116
+    {    -38,    418,  -2041,  10583,   9123,  -2082,    471,    -50 },   // 117
+    {    -39,    422,  -2046,  10519,   9191,  -2083,    470,    -50 },   // 118
+    {    -40,    425,  -2051,  10455,   9260,  -2084,    469,    -50 },   // 119
+    {    -40,    428,  -2055,  10390,   9328,  -2085,    467,    -49 },   // 120
+    {    -41,    432,  -2060,  10327,   9396,  -2086,    465,    -49 },   // 121
+    {    -42,    435,  -2064,  10261,   9464,  -2086,    464,    -48 },   // 122
+    {    -42,    438,  -2067,  10195,   9532,  -2086,    462,    -48 },   // 123
+    {    -43,    441,  -2071,  10130,   9599,  -2085,    460,    -47 },   // 124
+    {    -44,    443,  -2074,  10066,   9666,  -2084,    458,    -47 },   // 125
+    {    -44,    446,  -2076,   9998,   9734,  -2083,    456,    -47 },   // 126
+    {    -45,    449,  -2078,   9933,   9800,  -2082,    453,    -46 },   // 127
+    {    -45,    451,  -2080,   9865,   9867,  -2080,    451,    -45 },   // 128
+    {    -46,    453,  -2082,   9800,   9933,  -2078,    449,    -45 },   // 129
+    {    -47,    456,  -2083,   9734,   9998,  -2076,    446,    -44 },   // 130
+    {    -47,    458,  -2084,   9666,  10066,  -2074,    443,    -44 },   // 131
+    {    -47,    460,  -2085,   9599,  10130,  -2071,    441,    -43 },   // 132
+    {    -48,    462,  -2086,   9532,  10195,  -2067,    438,    -42 },   // 133
+    {    -48,    464,  -2086,   9464,  10261,  -2064,    435,    -42 },   // 134
+    {    -49,    465,  -2086,   9396,  10327,  -2060,    432,    -41 },   // 135
+    {    -49,    467,  -2085,   9328,  10390,  -2055,    428,    -40 },   // 136
+    {    -50,    469,  -2084,   9260,  10455,  -2051,    425,    -40 },   // 137
+    {    -50,    470,  -2083,   9191,  10519,  -2046,    422,    -39 },   // 138
+    {    -50,    471,  -2082,   9123,  10583,  -2041,    418,    -38 },   // 139
+    {    -51,    473,  -2080,   9054,  10645,  -2035,    415,    -37 },   // 140
+    {    -51,    474,  -2078,   8985,  10708,  -2029,    411,    -36 },   // 141
+    {    -51,    475,  -2076,   8916,  10772,  -2023,    407,    -36 },   // 142
+    {    -51,    476,  -2074,   8846,  10835,  -2016,    403,    -35 },   // 143
+    {    -52,    477,  -2071,   8777,  10897,  -2009,    399,    -34 },   // 144
+    {    -52,    478,  -2068,   8707,  10958,  -2001,    395,    -33 },   // 145
+    {    -52,    479,  -2065,   8638,  11019,  -1994,    391,    -32 },   // 146
+    {    -52,    479,  -2061,   8568,  11080,  -1985,    386,    -31 },   // 147
+    {    -52,    480,  -2057,   8498,  11140,  -1977,    382,    -30 },   // 148
+    {    -53,    480,  -2053,   8427,  11203,  -1968,    377,    -29 },   // 149
+    {    -53,    481,  -2049,   8357,  11262,  -1959,    373,    -28 },   // 150
+    {    -53,    481,  -2044,   8287,  11321,  -1949,    368,    -27 },   // 151
+    {    -53,    481,  -2039,   8216,  11381,  -1939,    363,    -26 },   // 152
+    {    -53,    481,  -2034,   8146,  11439,  -1929,    358,    -24 },   // 153
+    {    -53,    482,  -2029,   8075,  11497,  -1918,    353,    -23 },   // 154
+    {    -53,    482,  -2023,   8004,  11556,  -1907,    347,    -22 },   // 155
+    {    -53,    481,  -2017,   7934,  11614,  -1896,    342,    -21 },   // 156
+    {    -53,    481,  -2011,   7863,  11671,  -1884,    337,    -20 },   // 157
+    {    -53,    481,  -2005,   7792,  11727,  -1871,    331,    -18 },   // 158
+    {    -53,    481,  -1998,   7721,  11784,  -1859,    325,    -17 },   // 159
+    {    -53,    480,  -1992,   7650,  11842,  -1846,    319,    -16 },   // 160
+    {    -53,    480,  -1985,   7578,  11897,  -1832,    313,    -14 },   // 161
+    {    -53,    479,  -1977,   7507,  11952,  -1818,    307,    -13 },   // 162
+    {    -53,    479,  -1970,   7436,  12007,  -1804,    301,    -12 },   // 163
+    {    -53,    478,  -1962,   7365,  12061,  -1790,    295,    -10 },   // 164
+    {    -53,    477,  -1954,   7293,  12117,  -1775,    288,     -9 },   // 165
+    {    -53,    476,  -1946,   7222,  12169,  -1759,    282,     -7 },   // 166
+    {    -53,    476,  -1938,   7151,  12222,  -1743,    275,     -6 },   // 167
+    {    -52,    475,  -1930,   7079,  12275,  -1727,    268,     -4 },   // 168
+    {    -52,    474,  -1921,   7008,  12327,  -1711,    262,     -3 },   // 169
+    {    -52,    472,  -1912,   6937,  12379,  -1694,    255,     -1 },   // 170
+    {    -52,    471,  -1903,   6865,  12431,  -1676,    247,      1 },   // 171
+    {    -52,    470,  -1894,   6794,  12482,  -1658,    240,      2 },   // 172
+    {    -52,    469,  -1884,   6722,  12532,  -1640,    233,      4 },   // 173
+    {    -51,    467,  -1875,   6651,  12582,  -1621,    225,      6 },   // 174
+    {    -51,    466,  -1865,   6580,  12631,  -1602,    218,      7 },   // 175
+    {    -51,    465,  -1855,   6509,  12680,  -1583,    210,      9 },   // 176
+    {    -51,    463,  -1845,   6437,  12730,  -1563,    202,     11 },   // 177
+    {    -51,    461,  -1834,   6366,  12778,  -1543,    194,     13 },   // 178
+    {    -50,    460,  -1824,   6295,  12824,  -1522,    186,     15 },   // 179
+    {    -50,    458,  -1813,   6224,  12872,  -1501,    178,     16 },   // 180
+    {    -50,    456,  -1802,   6153,  12918,  -1479,    170,     18 },   // 181
+    {    -50,    454,  -1791,   6082,  12965,  -1457,    161,     20 },   // 182
+    {    -49,    453,  -1780,   6011,  13009,  -1435,    153,     22 },   // 183
+    {    -49,    451,  -1769,   5940,  13055,  -1412,    144,     24 },   // 184
+    {    -49,    449,  -1757,   5870,  13098,  -1389,    136,     26 },   // 185
+    {    -48,    447,  -1746,   5799,  13142,  -1365,    127,     28 },   // 186
+    {    -48,    444,  -1734,   5728,  13187,  -1341,    118,     30 },   // 187
+    {    -48,    442,  -1722,   5658,  13229,  -1316,    109,     32 },   // 188
+    {    -47,    440,  -1710,   5588,  13271,  -1291,     99,     34 },   // 189
+    {    -47,    438,  -1698,   5517,  13313,  -1266,     90,     37 },   // 190
+    {    -47,    436,  -1685,   5447,  13353,  -1240,     81,     39 },   // 191
+    {    -46,    433,  -1673,   5377,  13395,  -1214,     71,     41 },   // 192
+    {    -46,    431,  -1660,   5307,  13435,  -1187,     61,     43 },   // 193
+    {    -46,    429,  -1648,   5237,  13475,  -1160,     52,     45 },   // 194
+    {    -45,    426,  -1635,   5168,  13512,  -1132,     42,     48 },   // 195
+    {    -45,    424,  -1622,   5098,  13552,  -1105,     32,     50 },   // 196
+    {    -44,    421,  -1609,   5029,  13589,  -1076,     22,     52 },   // 197
+    {    -44,    418,  -1596,   4960,  13627,  -1047,     11,     55 },   // 198
+    {    -44,    416,  -1583,   4891,  13664,  -1018,      1,     57 },   // 199
+    {    -43,    413,  -1569,   4822,  13698,   -988,     -9,     60 },   // 200
+    {    -43,    410,  -1556,   4753,  13736,   -958,    -20,     62 },   // 201
+    {    -42,    408,  -1542,   4685,  13768,   -928,    -30,     65 },   // 202
+    {    -42,    405,  -1529,   4616,  13805,   -897,    -41,     67 },   // 203
+    {    -42,    402,  -1515,   4548,  13838,   -865,    -52,     70 },   // 204
+    {    -41,    399,  -1501,   4480,  13871,   -833,    -63,     72 },   // 205
+    {    -41,    396,  -1487,   4412,  13904,   -801,    -74,     75 },   // 206
+    {    -40,    394,  -1473,   4345,  13934,   -768,    -85,     77 },   // 207
+    {    -40,    391,  -1459,   4277,  13967,   -735,    -97,     80 },   // 208
+    {    -39,    388,  -1445,   4210,  13996,   -701,   -108,     83 },   // 209
+    {    -39,    385,  -1431,   4143,  14027,   -667,   -119,     85 },   // 210
+    {    -39,    382,  -1416,   4076,  14057,   -633,   -131,     88 },   // 211
+    {    -38,    379,  -1402,   4009,  14086,   -598,   -143,     91 },   // 212
+    {    -38,    375,  -1387,   3943,  14115,   -563,   -154,     93 },   // 213
+    {    -37,    372,  -1373,   3877,  14142,   -527,   -166,     96 },   // 214
+    {    -37,    369,  -1358,   3811,  14169,   -491,   -178,     99 },   // 215
+    {    -36,    366,  -1344,   3745,  14195,   -454,   -190,    102 },   // 216
+    {    -36,    363,  -1329,   3680,  14221,   -417,   -203,    105 },   // 217
+    {    -35,    360,  -1314,   3614,  14247,   -380,   -215,    107 },   // 218
+    {    -35,    356,  -1299,   3549,  14272,   -342,   -227,    110 },   // 219
+    {    -35,    353,  -1285,   3485,  14296,   -303,   -240,    113 },   // 220
+    {    -34,    350,  -1270,   3420,  14319,   -265,   -252,    116 },   // 221
+    {    -34,    347,  -1255,   3356,  14341,   -225,   -265,    119 },   // 222
+    {    -33,    343,  -1240,   3292,  14364,   -186,   -278,    122 },   // 223
+    {    -33,    340,  -1225,   3228,  14385,   -146,   -290,    125 },   // 224
+    {    -32,    337,  -1210,   3165,  14404,   -105,   -303,    128 },   // 225
+    {    -32,    333,  -1195,   3102,  14425,    -64,   -316,    131 },   // 226
+    {    -31,    330,  -1179,   3039,  14443,    -23,   -329,    134 },   // 227
+    {    -31,    327,  -1164,   2976,  14463,     19,   -343,    137 },   // 228
+    {    -30,    323,  -1149,   2914,  14481,     61,   -356,    140 },   // 229
+    {    -30,    320,  -1134,   2852,  14499,    103,   -369,    143 },   // 230
+    {    -29,    317,  -1119,   2790,  14514,    146,   -382,    147 },   // 231
+    {    -29,    313,  -1103,   2729,  14530,    190,   -396,    150 },   // 232
+    {    -29,    310,  -1088,   2668,  14545,    234,   -409,    153 },   // 233
+    {    -28,    306,  -1073,   2607,  14561,    278,   -423,    156 },   // 234
+    {    -28,    303,  -1058,   2546,  14577,    322,   -437,    159 },   // 235
+    {    -27,    299,  -1042,   2486,  14589,    367,   -451,    163 },   // 236
+    {    -27,    296,  -1027,   2426,  14601,    413,   -464,    166 },   // 237
+    {    -26,    292,  -1012,   2367,  14613,    459,   -478,    169 },   // 238
+    {    -26,    289,   -997,   2307,  14626,    505,   -492,    172 },   // 239
+    {    -25,    285,   -981,   2248,  14635,    552,   -506,    176 },   // 240
+    {    -25,    282,   -966,   2190,  14645,    599,   -520,    179 },   // 241
+    {    -24,    278,   -951,   2131,  14657,    646,   -535,    182 },   // 242
+    {    -24,    275,   -935,   2074,  14664,    694,   -549,    185 },   // 243
+    {    -24,    271,   -920,   2016,  14672,    743,   -563,    189 },   // 244
+    {    -23,    268,   -905,   1959,  14680,    791,   -578,    192 },   // 245
+    {    -23,    264,   -890,   1902,  14687,    840,   -592,    196 },   // 246
+    {    -22,    261,   -874,   1845,  14691,    890,   -606,    199 },   // 247
+    {    -22,    257,   -859,   1789,  14698,    940,   -621,    202 },   // 248
+    {    -21,    254,   -844,   1733,  14701,    990,   -635,    206 },   // 249
+    {    -21,    251,   -829,   1678,  14706,   1040,   -650,    209 },   // 250
+    {    -20,    247,   -814,   1622,  14711,   1091,   -665,    212 },   // 251
+    {    -20,    244,   -799,   1568,  14711,   1143,   -679,    216 },   // 252
+    {    -20,    240,   -784,   1513,  14715,   1195,   -694,    219 },   // 253
+    {    -19,    237,   -769,   1459,  14715,   1247,   -709,    223 },   // 254
+    {    -19,    233,   -754,   1405,  14718,   1299,   -724,    226 },   // 255
+};
 
-	sar	edx, 12					; 0000000cH
-	mov	esi, ebx
+#pragma code_seg()
+/*****************************************************************************
+ * ClampSample()
+ *****************************************************************************
+ * Round a 2.14 filter sum and clamp it to sixteen bits.  Cubic and sinc
+ * filters can overshoot on full scale waves.
+ */
+static __inline short ClampSample(long lSum)
+{
+    lSum = (lSum + (1 << (INTERP_COEFF_SHIFT - 1))) >> INTERP_COEFF_SHIFT;
+    if (lSum > 32767)
+    {
+        lSum = 32767;
+    }
+    else if (lSum < -32768)
+    {
+        lSum = -32768;
+    }
+    return (short) lSum;
+}
 
-	and	esi, 4095				; 00000fffH
-	add	ebx, ecx
+/*****************************************************************************
+ * InterpolateLinear8(), InterpolateLinear16()
+ *****************************************************************************
+ * Two point linear interpolation.
+ */
+static void InterpolateLinear8(short *pnOut, void *pvWave,
+                               PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount)
+{
+    char *pcWave = (char *) pvWave;
+    DWORD dwI;
 
-; 1046 :         pfSamplePos += pfPitch;
+    for (dwI = 0; dwI < dwCount; dwI++)
+    {
+        char *pc = &pcWave[pfSamplePos >> 12];
+        long lFract = pfSamplePos & 0xFFF;
 
-	mov	ecx, DWORD PTR pcWave
+        pnOut[dwI] = (short) ((pc[0] * (0x1000 - lFract) + pc[1] * lFract) >> 4);
+        pfSamplePos += pfPitch;
+    }
+}
 
-; 1047 : 
-; 1048 :         lA = (long) pcWave[dwPosition];
+static void InterpolateLinear16(short *pnOut, void *pvWave,
+                                PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount)
+{
+    short *pnWave = (short *) pvWave;
+    DWORD dwI;
 
-	movsx	eax, WORD PTR [ecx+edx*2]
+    for (dwI = 0; dwI < dwCount; dwI++)
+    {
+        short *pn = &pnWave[pfSamplePos >> 12];
+        long lFract = pfSamplePos & 0xFFF;
 
-; 1049 :         lM = ((pcWave[dwPosition+1] - lA) * dwFract);
-; 1050 :         lM >>= 12;
-; 1051 :         lM += lA;
+        pnOut[dwI] = (short) (pn[0] + (((pn[1] - pn[0]) * lFract) >> 12));
+        pfSamplePos += pfPitch;
+    }
+}
 
-	movsx	edx, WORD PTR [ecx+edx*2+2]
+/*****************************************************************************
+ * InterpolateCubic8(), InterpolateCubic16()
+ *****************************************************************************
+ * Four point interpolation through asCubicTable.
+ */
+static void InterpolateCubic8(short *pnOut, void *pvWave,
+                              PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount)
+{
+    char *pcWave = (char *) pvWave;
+    DWORD dwI;
 
-	sub	edx, eax
+    for (dwI = 0; dwI < dwCount; dwI++)
+    {
+        char *pc = &pcWave[(pfSamplePos >> 12) - 1];
+        const short *psTap = asCubicTable[(pfSamplePos & 0xFFF) >> INTERP_PHASE_SHIFT];
+        long lSum = (pc[0] * psTap[0] + pc[1] * psTap[1] +
+                     pc[2] * psTap[2] + pc[3] * psTap[3]) << 8;
 
-	imul	edx, esi
+        pnOut[dwI] = ClampSample(lSum);
+        pfSamplePos += pfPitch;
+    }
+}
 
-; 1052 :         lA = lM;
-; 1053 :         lA *= vfLVolume;
-; 1054 :         lA >>= 13;         // Signal bumps up to 15 bits.
+static void InterpolateCubic16(short *pnOut, void *pvWave,
+                               PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount)
+{
+    short *pnWave = (short *) pvWave;
+    DWORD dwI;
 
-	sar	edx, 12					; 0000000cH
-	mov	esi, DWORD PTR vfLVolume
+    for (dwI = 0; dwI < dwCount; dwI++)
+    {
+        short *pn = &pnWave[(pfSamplePos >> 12) - 1];
+        const short *psTap = asCubicTable[(pfSamplePos & 0xFFF) >> INTERP_PHASE_SHIFT];
+        long lSum = pn[0] * psTap[0] + pn[1] * psTap[1] +
+                    pn[2] * psTap[2] + pn[3] * psTap[3];
 
-	add	edx, eax
+        pnOut[dwI] = ClampSample(lSum);
+        pfSamplePos += pfPitch;
+    }
+}
 
-; 1072 : 		pBuffer[dwI] += (short) lA;
+/*****************************************************************************
+ * InterpolateSinc8(), InterpolateSinc16()
+ *****************************************************************************
+ * Eight point interpolation through asSincTable.
+ */
+static void InterpolateSinc8(short *pnOut, void *pvWave,
+                             PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount)
+{
+    char *pcWave = (char *) pvWave;
+    DWORD dwI;
+    DWORD dwTap;
 
-	imul	esi, edx
+    for (dwI = 0; dwI < dwCount; dwI++)
+    {
+        char *pc = &pcWave[(pfSamplePos >> 12) - 3];
+        const short *psTap = asSincTable[(pfSamplePos & 0xFFF) >> INTERP_PHASE_SHIFT];
+        long lSum = 0;
 
-	sar	esi, 13					; 0000000dH
-	mov	eax, DWORD PTR pBuf
+        for (dwTap = 0; dwTap < SINC_TAPS; dwTap++)
+        {
+            lSum += pc[dwTap] * psTap[dwTap];
+        }
+        pnOut[dwI] = ClampSample(lSum << 8);
+        pfSamplePos += pfPitch;
+    }
+}
 
-	add	WORD PTR [eax+edi*2], si
-	mov	esi, DWORD PTR vfRVolume
+static void InterpolateSinc16(short *pnOut, void *pvWave,
+                              PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount)
+{
+    short *pnWave = (short *) pvWave;
+    DWORD dwI;
+    DWORD dwTap;
 
-	jo	overflow_l
-no_oflowl:
+    for (dwI = 0; dwI < dwCount; dwI++)
+    {
+        short *pn = &pnWave[(pfSamplePos >> 12) - 3];
+        const short *psTap = asSincTable[(pfSamplePos & 0xFFF) >> INTERP_PHASE_SHIFT];
+        long lSum = 0;
 
-; 1077 : no_oflowl:	
-; 1078 :         lM *= vfRVolume;
-; 1079 : 		lM >>= 13;
+        for (dwTap = 0; dwTap < SINC_TAPS; dwTap++)
+        {
+            lSum += pn[dwTap] * psTap[dwTap];
+        }
+        pnOut[dwI] = ClampSample(lSum);
+        pfSamplePos += pfPitch;
+    }
+}
 
-	imul	esi, edx
+/*****************************************************************************
+ * AccumulateMono(), AccumulateStereo()
+ *****************************************************************************
+ * Scale interpolated samples by the volume and add them into the bus.
+ * The signal comes down from 16 + 12 bits to 15 bits, as it always has.
+ */
+static void AccumulateMono(long *plBuffer, short *pnSamples, DWORD dwCount,
+                           VFRACT vfLVolume, VFRACT vfRVolume)
+{
+    DWORD dwI;
 
-; 1080 : 		pBuffer[dwI+1] += (short) lM;
-; 1085 : no_oflowr:
-; 1086 : #endif  /* _ALPHA */
-; 1087 : 		dwI += 2;
+    for (dwI = 0; dwI < dwCount; dwI++)
+    {
+        plBuffer[dwI] += (pnSamples[dwI] * vfLVolume) >> 13;
+    }
+}
 
-	sar	esi, 13					; 0000000dH
-	mov	ecx, DWORD PTR pfPitch
+static void AccumulateStereo(long *plBuffer, short *pnSamples, DWORD dwCount,
+                             VFRACT vfLVolume, VFRACT vfRVolume)
+{
+    DWORD dwI;
 
-	add	WORD PTR [eax+edi*2+2], si
-	mov	edx, DWORD PTR pfPFract
+    for (dwI = 0; dwI < dwCount; dwI++)
+    {
+        plBuffer[dwI << 1] += (pnSamples[dwI] * vfLVolume) >> 13;
+        plBuffer[(dwI << 1) + 1] += (pnSamples[dwI] * vfRVolume) >> 13;
+    }
+}
 
-	jo	overflow_r
-no_oflowr:
+/*****************************************************************************
+ * Kernel tables
+ *****************************************************************************
+ * Indexed by [SSE2][eight bit][interpolation] and [SSE2][stereo].  Not
+ * static so that mixtest can run each SSE2 kernel against its C twin.
+ */
+const PFNINTERPOLATE apfnInterpolate[2][2][MIX_INTERP_COUNT] =
+{
+    {
+        { InterpolateLinear16, InterpolateCubic16, InterpolateSinc16 },
+        { InterpolateLinear8,  InterpolateCubic8,  InterpolateSinc8 }
+    },
+#ifdef SSE2_ENABLED
+    {
+        { InterpolateLinear16SSE2, InterpolateCubic16SSE2, InterpolateSinc16SSE2 },
+        { InterpolateLinear8SSE2,  InterpolateCubic8SSE2,  InterpolateSinc8SSE2 }
+    }
+#else // !SSE2_ENABLED
+    {
+        { InterpolateLinear16, InterpolateCubic16, InterpolateSinc16 },
+        { InterpolateLinear8,  InterpolateCubic8,  InterpolateSinc8 }
+    }
+#endif // !SSE2_ENABLED
+};
 
-	add	edi, 2
+const PFNACCUMULATE apfnAccumulate[2][2] =
+{
+    { AccumulateMono, AccumulateStereo },
+#ifdef SSE2_ENABLED
+    { AccumulateMonoSSE2, AccumulateStereoSSE2 }
+#else // !SSE2_ENABLED
+    { AccumulateMono, AccumulateStereo }
+#endif // !SSE2_ENABLED
+};
 
-; 978  : 
-; 979  :     for (dwI = 0; dwI < dwLength; )
+// Taps read before and after the sample position, by interpolation.
+static const long alTapsBefore[MIX_INTERP_COUNT] = { 0, 1, 3 };
+static const long alTapsAfter[MIX_INTERP_COUNT] = { 1, 2, 4 };
 
-	jl $L30536
+/*****************************************************************************
+ * SpanLength()
+ *****************************************************************************
+ * Number of samples, starting with the current one, that can be mixed
+ * with the current pitch and volume.  Limited by the envelope step, the
+ * space left in the buffer and the end of the sample.
+ */
+static __inline DWORD SpanLength(DWORD dwIncDelta, DWORD dwRemaining,
+                                 PFRACT pfSamplePos, PFRACT pfPitch,
+                                 PFRACT pfSampleLength)
+{
+    DWORD dwSpan = min(dwIncDelta, dwRemaining);
 
-$L30539:
-	mov DWORD PTR dwI, edi
-	mov DWORD PTR pfSamplePos, ebx
+    if (pfPitch > 0)
+    {
+        DWORD dwToEnd = 1;
+        if (pfSamplePos < pfSampleLength)
+        {
+            dwToEnd = ((pfSampleLength - pfSamplePos - 1) / pfPitch) + 1;
+        }
+        dwSpan = min(dwSpan, dwToEnd);
+    }
+    return dwSpan;
 }
 
-	dwI += dwLength;
-
-#endif // _X86_
+/*****************************************************************************
+ * CDigitalAudio::InterpolateEdge()
+ *****************************************************************************
+ * Interpolate one sample near the start or end of the wave, reading taps
+ * outside lFirst..lLast (relative to m_pnWave) as silence.  Gives the same
+ * result as the kernels wherever all the taps are inside the wave.
+ */
+short CDigitalAudio::InterpolateEdge(PFRACT pfSamplePos, DWORD dwInterpolation,
+                                     long lFirst, long lLast)
+{
+    long  alTap[SINC_TAPS];
+    long  lPosition = pfSamplePos >> 12;
+    long  lFract = pfSamplePos & 0xFFF;
+    long  lBefore = alTapsBefore[dwInterpolation];
+    long  lTaps = lBefore + alTapsAfter[dwInterpolation] + 1;
+    long  lTap;
+    long  lSum = 0;
+
+    for (lTap = 0; lTap < lTaps; lTap++)
+    {
+        long lIndex = lPosition - lBefore + lTap;
+        alTap[lTap] = 0;
+        if ((lIndex >= lFirst) && (lIndex <= lLast))
+        {
+            if (m_Source.m_bSampleType & SFORMAT_8)
+            {
+                alTap[lTap] = ((char *) m_pnWave)[lIndex] << 8;
+            }
+            else
+            {
+                alTap[lTap] = m_pnWave[lIndex];
+            }
+        }
+    }
 
-    m_vfLastLVolume = vfLVolume;
-    m_vfLastRVolume = vfRVolume;
-    m_pfLastPitch = pfPitch;
-    m_pfLastSample = pfSamplePos;
-    return (dwI >> 1);
+    switch (dwInterpolation)
+    {
+    case MIX_INTERP_CUBIC :
+        for (lTap = 0; lTap < CUBIC_TAPS; lTap++)
+        {
+            lSum += alTap[lTap] * asCubicTable[lFract >> INTERP_PHASE_SHIFT][lTap];
+        }
+        return ClampSample(lSum);
+    case MIX_INTERP_SINC :
+        for (lTap = 0; lTap < SINC_TAPS; lTap++)
+        {
+            lSum += alTap[lTap] * asSincTable[lFract >> INTERP_PHASE_SHIFT][lTap];
+        }
+        return ClampSample(lSum);
+    default :
+        if (m_Source.m_bSampleType & SFORMAT_8)
+        {
+            return (short) ((alTap[0] * (0x1000 - lFract) + alTap[1] * lFract) >> 12);
+        }
+        return (short) (alTap[0] + (((alTap[1] - alTap[0]) * lFract) >> 12));
+    }
 }
 
-
-
 /*****************************************************************************
- * CDigitalAudio::MixMono16()
+ * CDigitalAudio::MixSpans()
  *****************************************************************************
- * Implement a mono sixteen-bit mix.
- * Heavily optimized for x86 non-MMX, plus C code for non-x86.
+ * Mix dwLength samples of this voice into the bus, stepping the pitch and
+ * volume every dwDeltaPeriod samples and wrapping at the loop.  Returns the
+ * number of samples mixed, which is short of dwLength if a one shot wave
+ * runs out.  See the notes at the top of this file.
  */
-DWORD CDigitalAudio::MixMono16(short * pBuffer,    DWORD dwLength,
-                               DWORD dwDeltaPeriod,VFRACT vfDeltaVolume,
-                               PFRACT pfDeltaPitch,PFRACT pfSampleLength, 
-                               PFRACT pfLoopLength)
+DWORD CDigitalAudio::MixSpans(long *plBuffer,      DWORD dwLength,
+                              DWORD dwDeltaPeriod, VFRACT vfDeltaLVolume,
+                              VFRACT vfDeltaRVolume,PFRACT pfDeltaPitch,
+                              PFRACT pfSampleLength,PFRACT pfLoopLength,
+                              DWORD dwMixChoice,   DWORD dwInterpolation)
 {
+    short anSamples[MIX_SPAN];
     DWORD dwI;
-    DWORD dwPosition;
-    long lA;//, lB;
-    long lM;
+    DWORD dwSpan;
+    DWORD dwSafe;
     DWORD dwIncDelta = dwDeltaPeriod;
-    VFRACT dwFract;
-    short * pcWave = m_pnWave;
+    DWORD dwStereo = (dwMixChoice & SPLAY_STEREO) ? 1 : 0;
+    DWORD dwSSE2 = (dwMixChoice & SPLAY_SSE2) ? 1 : 0;
+    PFNINTERPOLATE pfnInterpolate =
+        apfnInterpolate[dwSSE2][(dwMixChoice & SFORMAT_8) ? 1 : 0][dwInterpolation];
+    PFNACCUMULATE pfnAccumulate = apfnAccumulate[dwSSE2][dwStereo];
     PFRACT pfSamplePos = m_pfLastSample;
-    VFRACT vfVolume = m_vfLastLVolume;
+    VFRACT vfLVolume = m_vfLastLVolume;
+    VFRACT vfRVolume = m_vfLastRVolume;
     PFRACT pfPitch = m_pfLastPitch;
     PFRACT pfPFract = pfPitch << 8;
-    VFRACT vfVFract = vfVolume << 8;  // Keep high res version around.
+    VFRACT vfLVFract = vfLVolume << 8;  // Keep high res version around.
+    VFRACT vfRVFract = vfRVolume << 8;
+
+    // Wave points that exist, relative to m_pnWave, which BeforeBigSampleMix()
+    // may have moved into the wave.  Spans whose taps all fall inside can
+    // run through the kernels.
+    long lFirst = - (long) m_dwAddressUpper;
+    long lLast = (long) (m_Source.m_pWave->m_dwSampleLength - 1 - m_dwAddressUpper);
+    long lBefore = alTapsBefore[dwInterpolation];
+    LONGLONG llSafeEnd = ((LONGLONG) (lLast - alTapsAfter[dwInterpolation] + 1)) << 12;
 
-#ifndef _X86_
-    for (dwI = 0; dwI < dwLength;)
+    if (!dwStereo)
+    {
+        vfRVolume = vfLVolume;
+    }
+
+    for (dwI = 0; dwI < dwLength; )
     {
         if (pfSamplePos >= pfSampleLength)
-	    {	
-	        if (pfLoopLength)
-		    pfSamplePos -= pfLoopLength;
-	        else
-		    break;
-	    }
+        {
+            if (pfLoopLength)
+                pfSamplePos -= pfLoopLength;
+            else
+                break;
+        }
         dwIncDelta--;
-        if (!dwIncDelta)   
+        if (!dwIncDelta)
         {
             dwIncDelta = dwDeltaPeriod;
             pfPFract += pfDeltaPitch;
             pfPitch = pfPFract >> 8;
-            vfVFract += vfDeltaVolume;
-            vfVolume = vfVFract >> 8;
+            vfLVFract += vfDeltaLVolume;
+            vfLVolume = vfLVFract >> 8;
+            vfRVFract += vfDeltaRVolume;
+            vfRVolume = vfRVFract >> 8;
+            if (!dwStereo)
+            {
+                vfRVolume = vfLVolume;
+            }
         }
 
-        dwPosition = pfSamplePos >> 12;
-        dwFract = pfSamplePos & 0xFFF;
-        pfSamplePos += pfPitch;
-
-        lA = (long) pcWave[dwPosition];
-        lM = (((pcWave[dwPosition+1] - lA) * dwFract) >> 12) + lA;
+        dwSpan = SpanLength(dwIncDelta,dwLength - dwI,pfSamplePos,pfPitch,pfSampleLength);
+        if (dwSpan > MIX_SPAN)
+        {
+            dwSpan = MIX_SPAN;
+        }
 
-        lM *= vfVolume; 
-        lM >>= 13;         // Signal bumps up to 12 bits.
+        // Trim the span to the samples whose taps are all in the wave.
+        dwSafe = 0;
+        if (((pfSamplePos >> 12) - lBefore >= lFirst) && (pfSamplePos < llSafeEnd))
+        {
+            dwSafe = dwSpan;
+            if (pfPitch > 0)
+            {
+                LONGLONG llToEnd = ((llSafeEnd - pfSamplePos - 1) / pfPitch) + 1;
+                if (llToEnd < dwSafe)
+                {
+                    dwSafe = (DWORD) llToEnd;
+                }
+            }
+        }
+        if (dwSafe)
+        {
+            dwSpan = dwSafe;
+            pfnInterpolate(anSamples,m_pnWave,pfSamplePos,pfPitch,dwSpan);
+        }
+        else
+        {
+            dwSpan = 1;
+            anSamples[0] = InterpolateEdge(pfSamplePos,dwInterpolation,lFirst,lLast);
+        }
+        pfnAccumulate(&plBuffer[dwI << dwStereo],anSamples,dwSpan,vfLVolume,vfRVolume);
 
-#ifndef _X86_
-#ifdef _ALPHA_
-		int nBitmask;
-		if( ALPHA_OVERFLOW & (nBitmask = __ADAWI( (short) lM, &pBuffer[dwI] )) )  {
-			if( ALPHA_NEGATIVE & nBitmask )  {
-				pBuffer[dwI] = 0x7FFF;
-			}
-			else  pBuffer[dwI] = (short) 0x8000;
-		}
-#else // !_ALPHA_
-    // TODO -- overflow detection for ia64 (+ axp64?)
-#endif // !_ALPHA_
-#else // _X86_  (dead code)
-        // Keep this around so we can use it to generate new assembly code (see below...)
-        pBuffer[dwI] += (short) lM;
-        _asm{jno no_oflow}
-        pBuffer[dwI] = 0x7fff;
-        _asm{js  no_oflow}
-        pBuffer[dwI] = (short) 0x8000;
-no_oflow:	
-#endif // _X86  (dead code)
-		dwI++;
+        pfSamplePos += pfPitch * (long) dwSpan;
+        dwIncDelta -= dwSpan - 1;
+        dwI += dwSpan;
     }
-#else // _X86_
-	int i, a, b, c, total;
-	short * pBuf = pBuffer + dwLength, *pBufX;
-	dwI = - dwLength;
-
-	_asm {
-
-; 979  :     for (dwI = 0; dwI < dwLength; )
-
-//	Induction variables.
-	mov	edi, dwI
-	mov	ebx, DWORD PTR pfSamplePos
-
-// Previously set up.
-	cmp	DWORD PTR dwLength, 0
-	mov	edx, pfPFract
-
-	mov	ecx, DWORD PTR pfPitch
-	je	$L30539
-
-$L30536:
-	cmp	ebx, DWORD PTR pfSampleLength
-
-; 981  :         if (pfSamplePos >= pfSampleLength)
-
-	mov	esi, DWORD PTR dwIncDelta
-	jge	SHORT $L30540_
-
-$L30540:
-; 987  : 	        else
-; 988  : 		    break;
-; 990  :         dwIncDelta--;
-
-	dec	esi
-	mov	DWORD PTR dwIncDelta, esi
-
-; 991  :         if (!dwIncDelta)    
-
-	je	SHORT $L30541_
-
-$L30541:
-// esi, edx, edi		esi == dwIncDelta
-
-	mov	DWORD PTR i, 0
-
-; 1010 : 	b = dwIncDelta;
-// esi = b == dwIncDelta
-; 1011 : 	c = (pfSampleLength - pfSamplePos) / pfPitch;
-; 1009 : 	a = dwLength - dwI;	// Remaining span.
-
-	mov	edx, edi
-	neg	edx
-
-; 1017 : 	if (b < a && b < c)
-
-	cmp	esi, edx
-	jge	try_ax
-
-	mov	eax, ecx
-	imul	eax, esi
-	add	eax, ebx
-
-	cmp eax, DWORD PTR pfSampleLength 
-	jge	try_c
-
-; 1019 : 		i = b;
-
-	cmp	esi, 3
-	jl	got_it
-
-	mov	DWORD PTR i, esi
-	jmp	SHORT got_it
-
-; 1013 : 	if (a < b && a < c)
-
-try_a:
-
-	cmp	edx, esi
-	jge	try_c
-try_ax:
-	mov	eax, edx
-	imul	eax, ecx
-	add	eax, ebx
-
-	cmp eax, DWORD PTR pfSampleLength
-	jge	try_c
-
-; 1015 : 		i = a;
-
-	cmp	edx, 3
-	jl	got_it
-
-	mov	DWORD PTR i, edx
-	jmp	SHORT got_it
-
-; 1021 : 	else if (c < a && c < b)
-try_c:
-	push	edx
-	mov	eax, DWORD PTR pfSampleLength
-	sub	eax, ebx
-	cdq
-	idiv	ecx		// eax == c
-	pop	edx
-
-    cmp	eax, edx
-	jge	got_it
-try_cx:
-	cmp	eax, esi
-	jge	got_it
-
-; 1023 : 		i = c;
-
-	cmp	eax, 3
-	jl	$L30543
-
-	mov DWORD PTR i, eax
-
-got_it:
-	mov	edx, DWORD PTR i
-	mov	eax, DWORD PTR pBuf
-
-	dec	edx
-	jl	$L30543
-
-	sub	DWORD PTR dwIncDelta, edx
-
-; 1093 :     return (dwI);
-; 1094 : }
-
-	lea	edx, [edx+1]			// Current span.
-	lea	eax, [eax+edi*2]		// Starting position.
-
-	add	edi, edx				// Remaining span.
-	lea	eax, [eax+edx*2]		// New ending position.
-
-	push	edi
-	mov	edi, edx				// Current span.
-
-	mov	DWORD PTR pBufX, eax
-	neg	edi
-
-$L30797:
-; 1005 : 			do
-; 1010 : 				dwPosition = pfSamplePos >> 12;
-; 1011 : 				dwFract = pfSamplePos & 0xFFF;
-
-	mov	edx, ebx
-	mov	esi, ebx
-
-	add	ebx, ecx
-	mov	ecx, DWORD PTR pcWave
-
-; 1012 : 				pfSamplePos += pfPitch;
-
-	sar	edx, 12					; 0000000cH
-	and	esi, 4095				; 00000fffH
-
-; 1013 : 
-; 1014 : 				lA = (long) pcWave[dwPosition];
-
-	movsx	eax, WORD PTR [ecx+edx*2]
-
-; 1015 : 				lM = ((pcWave[dwPosition+1] - lA) * dwFract);
-; 1016 : 				lM >>= 12;
-; 1017 : 				lM += lA;
-
-	movsx	edx, WORD PTR [ecx+edx*2+2]
-
-	sub	edx, eax
-
-; 1018 : 				lA = lM;
-; 1019 : 				lA *= vfLVolume;
-; 1020 : 				lA >>= 13;         // Signal bumps up to 15 bits.
-; 1022 : 				pBuffer[dwI] += (short) lA;
-; 1027 : no_oflowx:	
-; 1037 : 				++dwI;
-
-	imul	edx, esi
-
-	sar	edx, 12					; 0000000cH
-	mov	esi, DWORD PTR vfVolume
 
-	add	edx, eax
-	mov	ecx, DWORD PTR pfPitch
-
-	imul	esi, edx
-
-	sar	esi, 13					; 0000000dH
-	mov	eax, DWORD PTR pBufX
-
-	add	WORD PTR [eax+edi*2], si
-	jo	overflow_x
-no_oflowx:
-
-; 1038 : 			} while (--dwIncDelta);
-
-	inc	edi
-	jne	SHORT $L30797
-
-	pop	edi
-
-; 1039 : 			++dwIncDelta;
-; 1040 : 			continue;
-
-	mov	edx, DWORD PTR pfPFract
-	cmp	edi, 0
-
-	jl	SHORT $L30536
-	jmp	SHORT $L30539
-
-$L30540_:
-; 983  : 	        if (pfLoopLength)
-
-	cmp	DWORD PTR pfLoopLength, 0
-	je	$L30539
-
-; 985  : 				pfSamplePos -= pfLoopLength;
-
-	sub	ebx, DWORD PTR pfLoopLength
-	jmp	$L30540
-
-$L30541_:
-; 994  :             pfPFract += pfDeltaPitch;
-
-	mov	ecx, DWORD PTR pfDeltaPitch
-	mov	esi, DWORD PTR vfDeltaVolume
-
-	add	ecx, edx
-	mov	edx, DWORD PTR vfVFract
-
-; 995  :             pfPitch = pfPFract >> 8;
-; 996  :             vfVFract += vfDeltaVolume;
-
-	mov	DWORD PTR pfPFract, ecx
-	add	edx, esi
-
-; 997  :             vfVolume = vfVFract >> 8;
-
-	sar	ecx, 8
-	mov	DWORD PTR vfVFract, edx
-	
-	sar	edx, 8
-	mov	esi, DWORD PTR dwDeltaPeriod
-
-	mov	DWORD PTR vfVolume, edx
-	mov	DWORD PTR pfPitch, ecx
-
-
-	mov	DWORD PTR dwIncDelta, esi
-
-; 993  :             dwIncDelta = dwDeltaPeriod;
-
-	jmp	$L30541
-
-// Handle truncation.
-overflow_:
-	mov	WORD PTR [eax+edi*2], 0x7fff
-	js	no_oflow
-	mov	WORD PTR [eax+edi*2], 0x8000
-	jmp no_oflow
-
-overflow_x:
-	mov	WORD PTR [eax+edi*2], 0x7fff
-	js	no_oflowx
-	mov	WORD PTR [eax+edi*2], 0x8000
-	jmp	no_oflowx
-
-$L30543:
-; 1044 :         dwPosition = pfSamplePos >> 12;
-
-	mov	edx, ebx
-	mov	ecx, DWORD PTR pfPitch
-
-; 1045 :         dwFract = pfSamplePos & 0xFFF;
-
-	sar	edx, 12					; 0000000cH
-	mov	esi, ebx
-
-	and	esi, 4095				; 00000fffH
-	add	ebx, ecx
-
-; 1046 :         pfSamplePos += pfPitch;
-
-	mov	ecx, DWORD PTR pcWave
-
-; 1047 : 
-; 1048 :         lA = (long) pcWave[dwPosition];
-
-	movsx	eax, WORD PTR [ecx+edx*2]
-
-; 1049 :         lM = ((pcWave[dwPosition+1] - lA) * dwFract);
-; 1050 :         lM >>= 12;
-; 1051 :         lM += lA;
-
-	movsx	edx, WORD PTR [ecx+edx*2+2]
-
-	sub	edx, eax
-
-	imul	edx, esi
-
-; 1052 :         lA = lM;
-; 1053 :         lA *= vfVolume;
-; 1054 :         lA >>= 13;         // Signal bumps up to 15 bits.
-
-	sar	edx, 12					; 0000000cH
-	mov	esi, DWORD PTR vfVolume
-
-	add	edx, eax
-
-; 1072 : 		pBuffer[dwI] += (short) lA;
-
-	imul	esi, edx
-
-	sar	esi, 13					; 0000000dH
-	mov	eax, DWORD PTR pBuf
-
-	add	WORD PTR [eax+edi*2], si
-	jo	overflow_
-no_oflow:
-; 1077 : no_oflowl:	
-; 1087 : 		++dwI;
-
-	inc	edi
-	mov	edx, DWORD PTR pfPFract
-
-; 979  :     for (dwI = 0; dwI < dwLength; )
-
-	mov	ecx, DWORD PTR pfPitch
-	jl $L30536
-
-$L30539:
-	mov DWORD PTR dwI, edi
-	mov DWORD PTR pfSamplePos, ebx
-}
-	dwI += dwLength;
-
-#endif // _X86_
-    m_vfLastLVolume = vfVolume;
-    m_vfLastRVolume = vfVolume; // !!! is this right?
+    m_vfLastLVolume = vfLVolume;
+    m_vfLastRVolume = vfRVolume;
     m_pfLastPitch = pfPitch;
     m_pfLastSample = pfSamplePos;
     return (dwI);
 }
+
+#ifdef SSE2_ENABLED
+BOOL SSE2InstructionsSupported();
+#endif // SSE2_ENABLED
+
+/*****************************************************************************
+ * MixInstructionSet()
+ *****************************************************************************
+ * Pick the fastest mix kernels this processor supports.  Returns SPLAY_SSE2,
+ * or 0 for the C kernels above.
+ */
+DWORD MixInstructionSet()
+{
+#ifdef SSE2_ENABLED
+    if (SSE2InstructionsSupported())
+    {
+        return SPLAY_SSE2;
+    }
+#endif // SSE2_ENABLED
+    return 0;
+}
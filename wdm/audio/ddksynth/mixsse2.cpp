@@ -0,0 +1,480 @@
+//
+//      Copyright (c) 1996-2000 Microsoft Corporation.  All rights reserved.
+//      MixSSE2.cpp
+//      SSE2 Mix kernels for MSSynth
+
+/*
+Structure of the kernels.
+
+        These are drop-in replacements for the C kernels in mix.cpp, which
+        CDigitalAudio::MixSpans() picks when the processor has SSE2.  They
+        give identical output; see the notes at the top of mix.cpp.
+
+        Each interpolator works out four output samples at a time.  The
+        taps and filter coefficients for one output are multiplied pairwise
+        with PMADDWD, and the partial sums of the four outputs are added
+        across by transposing them, so the result is the same integer sum
+        the C code computes.  Rounding and the clamp to sixteen bits are
+        PADDD, PSRAD and PACKSSDW, which match ClampSample() exactly.
+
+        Linear interpolation maps onto PMADDWD through
+
+        lM = (pcWave[dwPosition] * (0x1000 - dwFract) +
+              pcWave[dwPosition+1] * dwFract) >> 12;
+
+        Eight bit taps are widened by unpacking them into the high byte of
+        each word, which is the same as the C code's shift up by eight.
+
+        The last one to three samples of a span are worked out by the same
+        code, with the positions past the end repeating the last one, so
+        nothing is read beyond the taps MixSpans() has checked.
+*/
+
+#include "common.h"
+
+#define STR_MODULENAME "DDKSynth.sys:SSE2: "
+
+#ifdef SSE2_ENABLED
+
+#include <emmintrin.h>
+
+#ifndef PF_XMMI64_INSTRUCTIONS_AVAILABLE
+#define PF_XMMI64_INSTRUCTIONS_AVAILABLE    10
+#endif
+
+#pragma code_seg()
+/*****************************************************************************
+ * Positions4()
+ *****************************************************************************
+ * Sample positions for the next four outputs.  Positions past dwLeft
+ * repeat the last one that is wanted.
+ */
+static __inline void Positions4(PFRACT apfPos[4], PFRACT pfSamplePos,
+                                PFRACT pfPitch, DWORD dwLeft)
+{
+    DWORD dwI;
+
+    for (dwI = 0; dwI < 4; dwI++)
+    {
+        apfPos[dwI] = pfSamplePos;
+        if (dwI + 1 < dwLeft)
+        {
+            pfSamplePos += pfPitch;
+        }
+    }
+}
+
+/*****************************************************************************
+ * Store4()
+ *****************************************************************************
+ * Pack four 32 bit outputs to sixteen bits, with saturation, and store
+ * the first dwLeft of them.
+ */
+static __inline void Store4(short *pnOut, __m128i mSum, DWORD dwLeft)
+{
+    __m128i mWords = _mm_packs_epi32(mSum, mSum);
+
+    if (dwLeft >= 4)
+    {
+        _mm_storel_epi64((__m128i *) pnOut, mWords);
+    }
+    else
+    {
+        short anTemp[8];
+        DWORD dwI;
+
+        _mm_storeu_si128((__m128i *) anTemp, mWords);
+        for (dwI = 0; dwI < dwLeft; dwI++)
+        {
+            pnOut[dwI] = anTemp[dwI];
+        }
+    }
+}
+
+/*****************************************************************************
+ * Round4()
+ *****************************************************************************
+ * Round four 2.14 filter sums to integers.
+ */
+static __inline __m128i Round4(__m128i mSum)
+{
+    mSum = _mm_add_epi32(mSum, _mm_set1_epi32(1 << (INTERP_COEFF_SHIFT - 1)));
+    return _mm_srai_epi32(mSum, INTERP_COEFF_SHIFT);
+}
+
+/*****************************************************************************
+ * LinearWeights4()
+ *****************************************************************************
+ * (0x1000 - dwFract) in the low word and dwFract in the high word of
+ * each doubleword, for four positions.
+ */
+static __inline __m128i LinearWeights4(PFRACT apfPos[4])
+{
+    __m128i mFract = _mm_set_epi32(apfPos[3] & 0xFFF, apfPos[2] & 0xFFF,
+                                   apfPos[1] & 0xFFF, apfPos[0] & 0xFFF);
+
+    return _mm_or_si128(_mm_sub_epi32(_mm_set1_epi32(0x1000), mFract),
+                        _mm_slli_epi32(mFract, 16));
+}
+
+/*****************************************************************************
+ * Linear8x4(), Linear16x4()
+ *****************************************************************************
+ * Linear interpolation of four outputs.
+ */
+static __inline __m128i Linear8x4(char *pcWave, PFRACT apfPos[4])
+{
+    char *pc0 = &pcWave[apfPos[0] >> 12];
+    char *pc1 = &pcWave[apfPos[1] >> 12];
+    char *pc2 = &pcWave[apfPos[2] >> 12];
+    char *pc3 = &pcWave[apfPos[3] >> 12];
+
+    __m128i mWave = _mm_set_epi16(pc3[1], pc3[0], pc2[1], pc2[0],
+                                  pc1[1], pc1[0], pc0[1], pc0[0]);
+
+    return _mm_srai_epi32(_mm_madd_epi16(mWave, LinearWeights4(apfPos)), 4);
+}
+
+static __inline __m128i Linear16x4(short *pnWave, PFRACT apfPos[4])
+{
+    short *pn0 = &pnWave[apfPos[0] >> 12];
+    short *pn1 = &pnWave[apfPos[1] >> 12];
+    short *pn2 = &pnWave[apfPos[2] >> 12];
+    short *pn3 = &pnWave[apfPos[3] >> 12];
+
+    __m128i mWave = _mm_set_epi16(pn3[1], pn3[0], pn2[1], pn2[0],
+                                  pn1[1], pn1[0], pn0[1], pn0[0]);
+
+    return _mm_srai_epi32(_mm_madd_epi16(mWave, LinearWeights4(apfPos)), 12);
+}
+
+/*****************************************************************************
+ * CubicTaps8(), CubicTaps16(), CubicCoeffs()
+ *****************************************************************************
+ * The four taps, as words, and the filter for one position, in the low
+ * half of a register.
+ */
+static __inline __m128i CubicTaps8(char *pcWave, PFRACT pfPos)
+{
+    __m128i mBytes = _mm_cvtsi32_si128(*(UNALIGNED long *) &pcWave[(pfPos >> 12) - 1]);
+
+    return _mm_unpacklo_epi8(_mm_setzero_si128(), mBytes);
+}
+
+static __inline __m128i CubicTaps16(short *pnWave, PFRACT pfPos)
+{
+    return _mm_loadl_epi64((__m128i *) &pnWave[(pfPos >> 12) - 1]);
+}
+
+static __inline __m128i CubicCoeffs(PFRACT pfPos)
+{
+    return _mm_loadl_epi64((__m128i *) asCubicTable[(pfPos & 0xFFF) >> INTERP_PHASE_SHIFT]);
+}
+
+/*****************************************************************************
+ * CubicSum4()
+ *****************************************************************************
+ * Filter four outputs, given their taps two to a register.  Each PMADDWD
+ * leaves two partial sums per output; add them across.
+ */
+static __inline __m128i CubicSum4(__m128i mTaps01, __m128i mTaps23,
+                                  PFRACT apfPos[4])
+{
+    __m128i mCoeffs01 = _mm_unpacklo_epi64(CubicCoeffs(apfPos[0]), CubicCoeffs(apfPos[1]));
+    __m128i mCoeffs23 = _mm_unpacklo_epi64(CubicCoeffs(apfPos[2]), CubicCoeffs(apfPos[3]));
+
+    // a0 a1 b0 b1 -> a0 b0 a1 b1, and the same for c and d.
+    __m128i mSum01 = _mm_shuffle_epi32(_mm_madd_epi16(mTaps01, mCoeffs01), _MM_SHUFFLE(3,1,2,0));
+    __m128i mSum23 = _mm_shuffle_epi32(_mm_madd_epi16(mTaps23, mCoeffs23), _MM_SHUFFLE(3,1,2,0));
+
+    return _mm_add_epi32(_mm_unpacklo_epi64(mSum01, mSum23),
+                         _mm_unpackhi_epi64(mSum01, mSum23));
+}
+
+/*****************************************************************************
+ * Cubic8x4(), Cubic16x4()
+ *****************************************************************************
+ * Four point interpolation of four outputs.
+ */
+static __inline __m128i Cubic8x4(char *pcWave, PFRACT apfPos[4])
+{
+    __m128i mTaps01 = _mm_unpacklo_epi64(CubicTaps8(pcWave, apfPos[0]), CubicTaps8(pcWave, apfPos[1]));
+    __m128i mTaps23 = _mm_unpacklo_epi64(CubicTaps8(pcWave, apfPos[2]), CubicTaps8(pcWave, apfPos[3]));
+
+    return Round4(CubicSum4(mTaps01, mTaps23, apfPos));
+}
+
+static __inline __m128i Cubic16x4(short *pnWave, PFRACT apfPos[4])
+{
+    __m128i mTaps01 = _mm_unpacklo_epi64(CubicTaps16(pnWave, apfPos[0]), CubicTaps16(pnWave, apfPos[1]));
+    __m128i mTaps23 = _mm_unpacklo_epi64(CubicTaps16(pnWave, apfPos[2]), CubicTaps16(pnWave, apfPos[3]));
+
+    return Round4(CubicSum4(mTaps01, mTaps23, apfPos));
+}
+
+/*****************************************************************************
+ * SincTaps8(), SincTaps16(), SincProduct()
+ *****************************************************************************
+ * The eight taps for one position, as words, and their four pairwise
+ * products with the filter.
+ */
+static __inline __m128i SincTaps8(char *pcWave, PFRACT pfPos)
+{
+    __m128i mBytes = _mm_loadl_epi64((__m128i *) &pcWave[(pfPos >> 12) - 3]);
+
+    return _mm_unpacklo_epi8(_mm_setzero_si128(), mBytes);
+}
+
+static __inline __m128i SincTaps16(short *pnWave, PFRACT pfPos)
+{
+    return _mm_loadu_si128((__m128i *) &pnWave[(pfPos >> 12) - 3]);
+}
+
+static __inline __m128i SincProduct(__m128i mTaps, PFRACT pfPos)
+{
+    __m128i mCoeffs = _mm_loadu_si128((__m128i *) asSincTable[(pfPos & 0xFFF) >> INTERP_PHASE_SHIFT]);
+
+    return _mm_madd_epi16(mTaps, mCoeffs);
+}
+
+/*****************************************************************************
+ * SincSum4()
+ *****************************************************************************
+ * Add the four partial sums of each of four outputs, by transposing.
+ */
+static __inline __m128i SincSum4(__m128i mP0, __m128i mP1, __m128i mP2, __m128i mP3)
+{
+    __m128i mSum01 = _mm_add_epi32(_mm_unpacklo_epi32(mP0, mP1), _mm_unpackhi_epi32(mP0, mP1));
+    __m128i mSum23 = _mm_add_epi32(_mm_unpacklo_epi32(mP2, mP3), _mm_unpackhi_epi32(mP2, mP3));
+
+    return _mm_add_epi32(_mm_unpacklo_epi64(mSum01, mSum23),
+                         _mm_unpackhi_epi64(mSum01, mSum23));
+}
+
+/*****************************************************************************
+ * Sinc8x4(), Sinc16x4()
+ *****************************************************************************
+ * Eight point interpolation of four outputs.
+ */
+static __inline __m128i Sinc8x4(char *pcWave, PFRACT apfPos[4])
+{
+    return Round4(SincSum4(SincProduct(SincTaps8(pcWave, apfPos[0]), apfPos[0]),
+                           SincProduct(SincTaps8(pcWave, apfPos[1]), apfPos[1]),
+                           SincProduct(SincTaps8(pcWave, apfPos[2]), apfPos[2]),
+                           SincProduct(SincTaps8(pcWave, apfPos[3]), apfPos[3])));
+}
+
+static __inline __m128i Sinc16x4(short *pnWave, PFRACT apfPos[4])
+{
+    return Round4(SincSum4(SincProduct(SincTaps16(pnWave, apfPos[0]), apfPos[0]),
+                           SincProduct(SincTaps16(pnWave, apfPos[1]), apfPos[1]),
+                           SincProduct(SincTaps16(pnWave, apfPos[2]), apfPos[2]),
+                           SincProduct(SincTaps16(pnWave, apfPos[3]), apfPos[3])));
+}
+
+/*****************************************************************************
+ * InterpolateLinear8SSE2(), InterpolateLinear16SSE2()
+ *****************************************************************************
+ * SSE2 versions of InterpolateLinear8() and InterpolateLinear16().
+ */
+void InterpolateLinear8SSE2(short *pnOut, void *pvWave,
+                            PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount)
+{
+    PFRACT apfPos[4];
+    DWORD  dwI;
+
+    for (dwI = 0; dwI < dwCount; dwI += 4)
+    {
+        Positions4(apfPos, pfSamplePos, pfPitch, dwCount - dwI);
+        Store4(&pnOut[dwI], Linear8x4((char *) pvWave, apfPos), dwCount - dwI);
+        pfSamplePos += pfPitch << 2;
+    }
+}
+
+void InterpolateLinear16SSE2(short *pnOut, void *pvWave,
+                             PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount)
+{
+    PFRACT apfPos[4];
+    DWORD  dwI;
+
+    for (dwI = 0; dwI < dwCount; dwI += 4)
+    {
+        Positions4(apfPos, pfSamplePos, pfPitch, dwCount - dwI);
+        Store4(&pnOut[dwI], Linear16x4((short *) pvWave, apfPos), dwCount - dwI);
+        pfSamplePos += pfPitch << 2;
+    }
+}
+
+/*****************************************************************************
+ * InterpolateCubic8SSE2(), InterpolateCubic16SSE2()
+ *****************************************************************************
+ * SSE2 versions of InterpolateCubic8() and InterpolateCubic16().
+ */
+void InterpolateCubic8SSE2(short *pnOut, void *pvWave,
+                           PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount)
+{
+    PFRACT apfPos[4];
+    DWORD  dwI;
+
+    for (dwI = 0; dwI < dwCount; dwI += 4)
+    {
+        Positions4(apfPos, pfSamplePos, pfPitch, dwCount - dwI);
+        Store4(&pnOut[dwI], Cubic8x4((char *) pvWave, apfPos), dwCount - dwI);
+        pfSamplePos += pfPitch << 2;
+    }
+}
+
+void InterpolateCubic16SSE2(short *pnOut, void *pvWave,
+                            PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount)
+{
+    PFRACT apfPos[4];
+    DWORD  dwI;
+
+    for (dwI = 0; dwI < dwCount; dwI += 4)
+    {
+        Positions4(apfPos, pfSamplePos, pfPitch, dwCount - dwI);
+        Store4(&pnOut[dwI], Cubic16x4((short *) pvWave, apfPos), dwCount - dwI);
+        pfSamplePos += pfPitch << 2;
+    }
+}
+
+/*****************************************************************************
+ * InterpolateSinc8SSE2(), InterpolateSinc16SSE2()
+ *****************************************************************************
+ * SSE2 versions of InterpolateSinc8() and InterpolateSinc16().
+ */
+void InterpolateSinc8SSE2(short *pnOut, void *pvWave,
+                          PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount)
+{
+    PFRACT apfPos[4];
+    DWORD  dwI;
+
+    for (dwI = 0; dwI < dwCount; dwI += 4)
+    {
+        Positions4(apfPos, pfSamplePos, pfPitch, dwCount - dwI);
+        Store4(&pnOut[dwI], Sinc8x4((char *) pvWave, apfPos), dwCount - dwI);
+        pfSamplePos += pfPitch << 2;
+    }
+}
+
+void InterpolateSinc16SSE2(short *pnOut, void *pvWave,
+                           PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount)
+{
+    PFRACT apfPos[4];
+    DWORD  dwI;
+
+    for (dwI = 0; dwI < dwCount; dwI += 4)
+    {
+        Positions4(apfPos, pfSamplePos, pfPitch, dwCount - dwI);
+        Store4(&pnOut[dwI], Sinc16x4((short *) pvWave, apfPos), dwCount - dwI);
+        pfSamplePos += pfPitch << 2;
+    }
+}
+
+/*****************************************************************************
+ * Scale4()
+ *****************************************************************************
+ * Multiply four words by four volumes and shift the products down to
+ * 15 bits, as doublewords.
+ */
+static __inline __m128i Scale4(__m128i mWords, __m128i mVolume)
+{
+    __m128i mLow = _mm_mullo_epi16(mWords, mVolume);
+    __m128i mHigh = _mm_mulhi_epi16(mWords, mVolume);
+
+    return _mm_srai_epi32(_mm_unpacklo_epi16(mLow, mHigh), 13);
+}
+
+/*****************************************************************************
+ * AddBus4()
+ *****************************************************************************
+ * Add four doublewords into the bus.
+ */
+static __inline void AddBus4(long *plBuffer, __m128i mValue)
+{
+    __m128i mBus = _mm_loadu_si128((__m128i *) plBuffer);
+    _mm_storeu_si128((__m128i *) plBuffer, _mm_add_epi32(mBus, mValue));
+}
+
+/*****************************************************************************
+ * AccumulateMonoSSE2(), AccumulateStereoSSE2()
+ *****************************************************************************
+ * SSE2 versions of AccumulateMono() and AccumulateStereo().
+ */
+void AccumulateMonoSSE2(long *plBuffer, short *pnSamples, DWORD dwCount,
+                        VFRACT vfLVolume, VFRACT vfRVolume)
+{
+    __m128i mVolume = _mm_set1_epi16((short) vfLVolume);
+    DWORD   dwI;
+
+    for (dwI = 0; dwI + 4 <= dwCount; dwI += 4)
+    {
+        __m128i mWords = _mm_loadl_epi64((__m128i *) &pnSamples[dwI]);
+        AddBus4(&plBuffer[dwI], Scale4(mWords, mVolume));
+    }
+    for (; dwI < dwCount; dwI++)
+    {
+        plBuffer[dwI] += (pnSamples[dwI] * vfLVolume) >> 13;
+    }
+}
+
+void AccumulateStereoSSE2(long *plBuffer, short *pnSamples, DWORD dwCount,
+                          VFRACT vfLVolume, VFRACT vfRVolume)
+{
+    __m128i mVolume = _mm_set_epi16((short) vfRVolume, (short) vfLVolume,
+                                    (short) vfRVolume, (short) vfLVolume,
+                                    (short) vfRVolume, (short) vfLVolume,
+                                    (short) vfRVolume, (short) vfLVolume);
+    DWORD   dwI;
+
+    for (dwI = 0; dwI + 4 <= dwCount; dwI += 4)
+    {
+        __m128i mWords = _mm_loadl_epi64((__m128i *) &pnSamples[dwI]);
+        mWords = _mm_unpacklo_epi16(mWords, mWords);     // S0 S0 S1 S1 ...
+
+        AddBus4(&plBuffer[dwI << 1], Scale4(mWords, mVolume));
+        AddBus4(&plBuffer[(dwI << 1) + 4], Scale4(_mm_unpackhi_epi64(mWords, mWords), mVolume));
+    }
+    for (; dwI < dwCount; dwI++)
+    {
+        plBuffer[dwI << 1] += (pnSamples[dwI] * vfLVolume) >> 13;
+        plBuffer[(dwI << 1) + 1] += (pnSamples[dwI] * vfRVolume) >> 13;
+    }
+}
+
+/*****************************************************************************
+ * SSE2Disabled()
+ *****************************************************************************
+ * Check the registry key to determine whether to ignore SSE2.
+ */
+static BOOL SSE2Disabled()
+{
+    ULONG ulValue;
+
+    if (!GetRegValueDword(
+            TEXT("Software\\Microsoft\\DirectMusic"),
+            TEXT("SSE2Disabled"),
+            &ulValue))
+    {
+        return FALSE;
+    }
+
+    return (BOOL)ulValue;
+}
+
+/*****************************************************************************
+ * SSE2InstructionsSupported()
+ *****************************************************************************
+ * Returns whether this CPU and OS support SSE2.  The OS check matters on
+ * x86, where XMM state is only saved for us if the kernel knows about it.
+ */
+BOOL SSE2InstructionsSupported()
+{
+    if (SSE2Disabled())
+    {
+        return FALSE;
+    }
+    return ExIsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+}
+
+#endif // SSE2_ENABLED
@@ -0,0 +1,250 @@
+//
+//      Copyright (c) 1996-2000 Microsoft Corporation.  All rights reserved.
+//      MixTest.cpp
+//
+//      mixtest: runs every SSE2 mix kernel in mix.cpp's tables against the
+//      C kernel it replaces, on random waves, sample positions, pitches,
+//      volumes and counts, and fails on the first output that differs by
+//      even one bit.  The driver relies on the two being interchangeable,
+//      so run this after any change to mix.cpp or mixsse2.cpp.
+//
+//      Usage:  mixtest [-n<trials>] [-s<seed>]
+//
+
+#include "common.h"
+
+#define MIXTEST_DEFAULT_TRIALS  20000
+#define MIXTEST_WAVE_LENGTH     (MIX_SPAN * 16)     // Room for a span at 8x pitch.
+#define MIXTEST_MAX_PITCH       (8 << 12)           // 8x, as PFRACT.
+#define MIXTEST_SLOP            8                   // Guard and misalignment room.
+#define MIXTEST_GUARD           0x5A5A
+
+DWORD MixInstructionSet();
+
+static const char *s_apszInterpolation[MIX_INTERP_COUNT] = { "linear", "cubic", "sinc" };
+static const char *s_apszFormat[2] = { "16 bit", "8 bit" };
+static const char *s_apszChannels[2] = { "mono", "stereo" };
+
+// Taps read before and after the sample position, by interpolation.
+static const long s_alTapsBefore[MIX_INTERP_COUNT] = { 0, 1, 3 };
+static const long s_alTapsAfter[MIX_INTERP_COUNT] = { 1, 2, 4 };
+
+static DWORD s_dwSeed;
+
+/*****************************************************************************
+ * MixTestRandom()
+ *****************************************************************************
+ * Linear congruential generator, so a seed reproduces a failure on any
+ * compiler's C runtime.
+ */
+static DWORD MixTestRandom(DWORD dwRange)
+{
+    s_dwSeed = s_dwSeed * 1664525 + 1013904223;
+    return (s_dwSeed >> 8) % dwRange;
+}
+
+/*****************************************************************************
+ * FillWave()
+ *****************************************************************************
+ * Random samples over the full range of the format, with runs pinned to
+ * the extremes now and then so that clamping gets exercised.
+ */
+static void FillWave(void *pvWave, DWORD dwLength, BOOL fEightBit)
+{
+    DWORD dwI;
+
+    for (dwI = 0; dwI < dwLength; dwI++)
+    {
+        long lSample = (long) MixTestRandom(0x10000) - 0x8000;
+
+        if (MixTestRandom(8) == 0)
+        {
+            lSample = (dwI & 1) ? 0x7FFF : -0x8000;
+        }
+        if (fEightBit)
+        {
+            ((char *) pvWave)[dwI] = (char) (lSample >> 8);
+        }
+        else
+        {
+            ((short *) pvWave)[dwI] = (short) lSample;
+        }
+    }
+}
+
+/*****************************************************************************
+ * TestInterpolate()
+ *****************************************************************************
+ * One trial of one interpolator.  Returns FALSE and prints the first
+ * difference if the SSE2 kernel does not match the C kernel.
+ */
+static BOOL TestInterpolate(BOOL fEightBit, DWORD dwInterpolation, DWORD dwTrial)
+{
+    static short    anWave[MIXTEST_WAVE_LENGTH + MIXTEST_SLOP];
+    short           anOut[2][MIX_SPAN + MIXTEST_SLOP * 2];
+    DWORD           dwSkew = MixTestRandom(MIXTEST_SLOP);
+    DWORD           dwCount = MixTestRandom(MIX_SPAN) + 1;
+    PFRACT          pfPitch = (PFRACT) MixTestRandom(MIXTEST_MAX_PITCH) + 1;
+    PFRACT          pfFirst = s_alTapsBefore[dwInterpolation] << 12;
+    PFRACT          pfLast = (MIXTEST_WAVE_LENGTH - s_alTapsAfter[dwInterpolation] - 1) << 12;
+    PFRACT          pfSamplePos;
+    void           *pvWave;
+    DWORD           dwSet;
+    DWORD           dwI;
+
+    // Every tap of the last sample must lie inside the wave.
+    //
+    if (pfPitch * (PFRACT) (dwCount - 1) > pfLast - pfFirst)
+    {
+        pfPitch = (pfLast - pfFirst) / (PFRACT) dwCount;
+    }
+    pfSamplePos = pfFirst +
+        (PFRACT) MixTestRandom(pfLast - pfFirst - pfPitch * (PFRACT) (dwCount - 1) + 1);
+
+    pvWave = fEightBit ? (void *) ((char *) anWave + dwSkew) : (void *) (anWave + dwSkew);
+    FillWave(pvWave, MIXTEST_WAVE_LENGTH, fEightBit);
+
+    for (dwSet = 0; dwSet < 2; dwSet++)
+    {
+        for (dwI = 0; dwI < MIX_SPAN + MIXTEST_SLOP * 2; dwI++)
+        {
+            anOut[dwSet][dwI] = (short) MIXTEST_GUARD;
+        }
+        apfnInterpolate[dwSet][fEightBit][dwInterpolation](
+            &anOut[dwSet][MIXTEST_SLOP], pvWave, pfSamplePos, pfPitch, dwCount);
+    }
+
+    for (dwI = 0; dwI < MIX_SPAN + MIXTEST_SLOP * 2; dwI++)
+    {
+        if (anOut[0][dwI] != anOut[1][dwI])
+        {
+            printf("FAIL: %s %s interpolation, trial %lu: position 0x%lx pitch 0x%lx count %lu\n"
+                   "      sample %ld is %d in C and %d in SSE2\n",
+                   s_apszFormat[fEightBit], s_apszInterpolation[dwInterpolation], dwTrial,
+                   pfSamplePos, pfPitch, dwCount,
+                   (long) dwI - MIXTEST_SLOP, anOut[0][dwI], anOut[1][dwI]);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*****************************************************************************
+ * TestAccumulate()
+ *****************************************************************************
+ * One trial of one accumulator.  The bus starts with the same random
+ * contents for both, and the words either side of the span must be left
+ * alone.
+ */
+static BOOL TestAccumulate(DWORD dwStereo, DWORD dwTrial)
+{
+    short   anSamples[MIX_SPAN];
+    long    alBus[2][(MIX_SPAN + MIXTEST_SLOP * 2) * 2];
+    long    alStart[(MIX_SPAN + MIXTEST_SLOP * 2) * 2];
+    DWORD   dwCount = MixTestRandom(MIX_SPAN) + 1;
+    DWORD   dwSkew = MixTestRandom(MIXTEST_SLOP);
+    VFRACT  vfLVolume = (VFRACT) MixTestRandom(0x8000);
+    VFRACT  vfRVolume = (VFRACT) MixTestRandom(0x8000);
+    DWORD   dwSet;
+    DWORD   dwI;
+
+    FillWave(anSamples, MIX_SPAN, FALSE);
+    for (dwI = 0; dwI < (MIX_SPAN + MIXTEST_SLOP * 2) * 2; dwI++)
+    {
+        alStart[dwI] = (long) (MixTestRandom(0x1000000) - 0x800000);
+    }
+
+    for (dwSet = 0; dwSet < 2; dwSet++)
+    {
+        memcpy(alBus[dwSet], alStart, sizeof(alStart));
+        apfnAccumulate[dwSet][dwStereo](&alBus[dwSet][dwSkew + MIXTEST_SLOP],
+                                        anSamples, dwCount, vfLVolume, vfRVolume);
+    }
+
+    for (dwI = 0; dwI < (MIX_SPAN + MIXTEST_SLOP * 2) * 2; dwI++)
+    {
+        if (alBus[0][dwI] != alBus[1][dwI])
+        {
+            printf("FAIL: %s accumulate, trial %lu: volume 0x%lx/0x%lx count %lu\n"
+                   "      bus word %ld is %ld in C and %ld in SSE2\n",
+                   s_apszChannels[dwStereo], dwTrial, vfLVolume, vfRVolume, dwCount,
+                   (long) dwI - (long) (dwSkew + MIXTEST_SLOP), alBus[0][dwI], alBus[1][dwI]);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*****************************************************************************
+ * main()
+ *****************************************************************************
+ */
+int __cdecl main(int argc, char *argv[])
+{
+    DWORD   dwTrials = MIXTEST_DEFAULT_TRIALS;
+    DWORD   dwFailures = 0;
+    DWORD   dwTrial;
+    DWORD   dwEightBit;
+    DWORD   dwInterpolation;
+    DWORD   dwStereo;
+    int     iArg;
+
+    s_dwSeed = GetTickCount();
+    for (iArg = 1; iArg < argc; iArg++)
+    {
+        if (argv[iArg][0] == '-' && argv[iArg][1] == 'n')
+        {
+            dwTrials = strtoul(&argv[iArg][2], NULL, 0);
+        }
+        else if (argv[iArg][0] == '-' && argv[iArg][1] == 's')
+        {
+            s_dwSeed = strtoul(&argv[iArg][2], NULL, 0);
+        }
+        else
+        {
+            printf("Usage: mixtest [-n<trials>] [-s<seed>]\n");
+            return 2;
+        }
+    }
+
+    if (!(MixInstructionSet() & SPLAY_SSE2))
+    {
+        printf("SSE2 is unavailable or SSE2Disabled is set; nothing to compare.\n");
+        return 0;
+    }
+    printf("mixtest: %lu trials per kernel, seed 0x%lx\n", dwTrials, s_dwSeed);
+
+    for (dwEightBit = 0; dwEightBit < 2; dwEightBit++)
+    {
+        for (dwInterpolation = 0; dwInterpolation < MIX_INTERP_COUNT; dwInterpolation++)
+        {
+            for (dwTrial = 0; dwTrial < dwTrials; dwTrial++)
+            {
+                if (!TestInterpolate((BOOL) dwEightBit, dwInterpolation, dwTrial))
+                {
+                    dwFailures++;
+                    break;
+                }
+            }
+        }
+    }
+    for (dwStereo = 0; dwStereo < 2; dwStereo++)
+    {
+        for (dwTrial = 0; dwTrial < dwTrials; dwTrial++)
+        {
+            if (!TestAccumulate(dwStereo, dwTrial))
+            {
+                dwFailures++;
+                break;
+            }
+        }
+    }
+
+    if (dwFailures)
+    {
+        printf("mixtest: %lu of %lu kernels differ\n", dwFailures, (DWORD) (2 * MIX_INTERP_COUNT + 2));
+        return 1;
+    }
+    printf("mixtest: SSE2 and C kernels match\n");
+    return 0;
+}
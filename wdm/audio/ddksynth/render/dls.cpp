@@ -0,0 +1,614 @@
+//
+//      Copyright (c) 1996-2000 Microsoft Corporation.  All rights reserved.
+//      Dls.cpp
+//
+//      Reads a DLS Level 1 collection and turns it into the download chunks
+//      that CSynth::Download() takes, the same way DirectMusic does before
+//      it hands them to the kernel synth.
+//
+
+#include "common.h"
+#include "render.h"
+
+#define FOURCC_WAVE_LIST    mmioFOURCC('w','a','v','e')
+#define FOURCC_FMT          mmioFOURCC('f','m','t',' ')
+#define FOURCC_DATA         mmioFOURCC('d','a','t','a')
+
+/*****************************************************************************
+ * LoadFileImage()
+ *****************************************************************************
+ * Read a whole file into memory.  Free the result with delete.
+ */
+BYTE * LoadFileImage(LPCSTR pszFileName, DWORD *pcbFile)
+{
+    FILE *  pFile = fopen(pszFileName, "rb");
+    BYTE *  pbFile = NULL;
+    long    lSize;
+
+    if (pFile == NULL)
+    {
+        return NULL;
+    }
+    if ((fseek(pFile, 0, SEEK_END) == 0) && ((lSize = ftell(pFile)) > 0))
+    {
+        fseek(pFile, 0, SEEK_SET);
+        pbFile = new BYTE[lSize];
+        if (pbFile && (fread(pbFile, 1, lSize, pFile) != (size_t) lSize))
+        {
+            delete [] pbFile;
+            pbFile = NULL;
+        }
+        *pcbFile = (DWORD) lSize;
+    }
+    fclose(pFile);
+    return pbFile;
+}
+
+/*****************************************************************************
+ * RiffNextChunk()
+ *****************************************************************************
+ * Step to the next chunk between *ppbPos and pbEnd.  Returns the chunk id,
+ * the data and its size.  For LIST chunks the data starts with the list type.
+ */
+static BOOL RiffNextChunk(BYTE **ppbPos, BYTE *pbEnd,
+                          FOURCC *pckid, BYTE **ppbData, DWORD *pcbData)
+{
+    BYTE *pbPos = *ppbPos;
+
+    if (pbPos + 8 > pbEnd)
+    {
+        return FALSE;
+    }
+    *pckid = *(FOURCC *) pbPos;
+    *pcbData = *(DWORD *) (pbPos + 4);
+    *ppbData = pbPos + 8;
+    if ((*pcbData > (DWORD) (pbEnd - *ppbData)))
+    {
+        return FALSE;
+    }
+    *ppbPos = *ppbData + ((*pcbData + 1) & ~1);
+    if (*ppbPos > pbEnd)
+    {
+        *ppbPos = pbEnd;
+    }
+    return TRUE;
+}
+
+/*****************************************************************************
+ * RiffFindChunk()
+ *****************************************************************************
+ * Find the first chunk with the given id (and list type, for LIST chunks)
+ * in a range.  Returns a pointer to the chunk data, past any list type.
+ */
+static BYTE * RiffFindChunk(BYTE *pbPos, BYTE *pbEnd, FOURCC ckid, FOURCC fccType,
+                            DWORD *pcbData)
+{
+    FOURCC  ckidFound;
+    BYTE *  pbData;
+    DWORD   cbData;
+
+    while (RiffNextChunk(&pbPos, pbEnd, &ckidFound, &pbData, &cbData))
+    {
+        if (ckidFound != ckid)
+        {
+            continue;
+        }
+        if (ckid == FOURCC_LIST)
+        {
+            if ((cbData < sizeof(FOURCC)) || (*(FOURCC *) pbData != fccType))
+            {
+                continue;
+            }
+            pbData += sizeof(FOURCC);
+            cbData -= sizeof(FOURCC);
+        }
+        *pcbData = cbData;
+        return pbData;
+    }
+    return NULL;
+}
+
+/*****************************************************************************
+ * struct DLSBUILDER
+ *****************************************************************************
+ * Lays out one download chunk: the DMUS_DOWNLOADINFO header, the offset
+ * table, then the structures it indexes.  The size is worked out up front
+ * so pointers handed out by BuilderAdd() stay valid.
+ */
+typedef struct DLSBUILDER
+{
+    BYTE *              pbChunk;
+    DWORD               cbChunk;
+    DWORD               cbUsed;
+    DWORD               dwMaxEntries;
+    DMUS_DOWNLOADINFO * pInfo;
+    DMUS_OFFSETTABLE *  pOffsetTable;
+} DLSBUILDER;
+
+#define DLS_ALIGN(cb)   (((cb) + 3) & ~3)
+
+/*****************************************************************************
+ * BuilderInit()
+ *****************************************************************************
+ * Allocate a download chunk with room for dwMaxEntries structures totalling
+ * no more than cbData bytes (before alignment).
+ */
+static BOOL BuilderInit(DLSBUILDER *pBuilder, DWORD dwDLType, DWORD dwDLId,
+                        DWORD dwMaxEntries, DWORD cbData)
+{
+    pBuilder->dwMaxEntries = dwMaxEntries;
+    pBuilder->cbUsed = DLS_ALIGN(sizeof(DMUS_DOWNLOADINFO) + dwMaxEntries * sizeof(ULONG));
+    pBuilder->cbChunk = pBuilder->cbUsed + cbData + dwMaxEntries * 3;
+
+    // The synth frees wave chunks itself with delete, so use plain operator new.
+    pBuilder->pbChunk = (BYTE *) ::operator new(pBuilder->cbChunk);
+    if (pBuilder->pbChunk == NULL)
+    {
+        return FALSE;
+    }
+    pBuilder->pInfo = (DMUS_DOWNLOADINFO *) pBuilder->pbChunk;
+    pBuilder->pOffsetTable = (DMUS_OFFSETTABLE *) (pBuilder->pbChunk + sizeof(DMUS_DOWNLOADINFO));
+    pBuilder->pInfo->dwDLType = dwDLType;
+    pBuilder->pInfo->dwDLId = dwDLId;
+    pBuilder->pInfo->dwNumOffsetTableEntries = 0;
+    pBuilder->pInfo->cbSize = pBuilder->cbUsed;
+    return TRUE;
+}
+
+/*****************************************************************************
+ * BuilderAdd()
+ *****************************************************************************
+ * Append a zeroed structure to the chunk and give it the next offset table
+ * index.  Returns NULL if the chunk was sized too small.
+ */
+static void * BuilderAdd(DLSBUILDER *pBuilder, DWORD cbData, ULONG *pulIndex)
+{
+    DWORD dwIndex = pBuilder->pInfo->dwNumOffsetTableEntries;
+
+    if ((dwIndex >= pBuilder->dwMaxEntries) ||
+        (pBuilder->cbUsed + cbData > pBuilder->cbChunk))
+    {
+        return NULL;
+    }
+    BYTE *pbData = pBuilder->pbChunk + pBuilder->cbUsed;
+    ZeroMemory(pbData, cbData);
+    pBuilder->pOffsetTable->ulOffsetTable[dwIndex] = pBuilder->cbUsed;
+    pBuilder->pInfo->dwNumOffsetTableEntries = dwIndex + 1;
+    pBuilder->cbUsed += DLS_ALIGN(cbData);
+    pBuilder->pInfo->cbSize = pBuilder->cbUsed;
+    if (pulIndex)
+    {
+        *pulIndex = dwIndex;
+    }
+    return pbData;
+}
+
+/*****************************************************************************
+ * AddDownload()
+ *****************************************************************************
+ * Append a finished chunk to the collection's download list.
+ */
+static HRESULT AddDownload(DLSCOLLECTION *pCollection, DMUS_DOWNLOADINFO *pInfo)
+{
+    if (pCollection->dwDownloads == pCollection->dwAllocated)
+    {
+        DWORD dwAllocated = pCollection->dwAllocated ? pCollection->dwAllocated * 2 : 256;
+        DLSDOWNLOAD *pDownloads = new DLSDOWNLOAD[dwAllocated];
+        if (pDownloads == NULL)
+        {
+            return E_OUTOFMEMORY;
+        }
+        if (pCollection->pDownloads)
+        {
+            CopyMemory(pDownloads, pCollection->pDownloads,
+                       pCollection->dwDownloads * sizeof(DLSDOWNLOAD));
+            delete [] pCollection->pDownloads;
+        }
+        pCollection->pDownloads = pDownloads;
+        pCollection->dwAllocated = dwAllocated;
+    }
+    DLSDOWNLOAD *pDownload = &pCollection->pDownloads[pCollection->dwDownloads++];
+    pDownload->pInfo = pInfo;
+    pDownload->hDownload = NULL;
+    pDownload->fSynthOwns = FALSE;
+    return S_OK;
+}
+
+/*****************************************************************************
+ * BuildWave()
+ *****************************************************************************
+ * Build the DMUS_DOWNLOADINFO_WAVE chunk for one 'wave' list.  The pool
+ * table index doubles as the download id, which is what regions link to.
+ */
+static HRESULT BuildWave(DLSCOLLECTION *pCollection, DWORD dwPoolIndex,
+                         BYTE *pbWave, DWORD cbWave, WSMPL **ppWsmp)
+{
+    DWORD   cbFormat, cbData, cbWsmp;
+    BYTE *  pbFormat = RiffFindChunk(pbWave, pbWave + cbWave, FOURCC_FMT, 0, &cbFormat);
+    BYTE *  pbData = RiffFindChunk(pbWave, pbWave + cbWave, FOURCC_DATA, 0, &cbData);
+
+    *ppWsmp = (WSMPL *) RiffFindChunk(pbWave, pbWave + cbWave, FOURCC_WSMP, 0, &cbWsmp);
+    if ((pbFormat == NULL) || (pbData == NULL) || (cbFormat < sizeof(PCMWAVEFORMAT)))
+    {
+        return DMUS_E_BADWAVE;
+    }
+
+    // Pad with one silent sample for the interpolator, as DirectMusic does.
+    DLSBUILDER Builder;
+    if (!BuilderInit(&Builder, DMUS_DOWNLOADINFO_WAVE, dwPoolIndex, 2,
+                     sizeof(DMUS_WAVE) + sizeof(DMUS_WAVEDATA) + cbData + 2))
+    {
+        return E_OUTOFMEMORY;
+    }
+    ULONG ulDataIdx;
+    DMUS_WAVE *pdmWave = (DMUS_WAVE *) BuilderAdd(&Builder, sizeof(DMUS_WAVE), NULL);
+    DMUS_WAVEDATA *pdmWaveData = (DMUS_WAVEDATA *)
+        BuilderAdd(&Builder, sizeof(DMUS_WAVEDATA) + cbData + 2, &ulDataIdx);
+
+    CopyMemory(&pdmWave->WaveformatEx, pbFormat, sizeof(PCMWAVEFORMAT));
+    pdmWave->WaveformatEx.cbSize = 0;
+    pdmWave->ulWaveDataIdx = ulDataIdx;
+    pdmWaveData->cbSize = cbData;
+    CopyMemory(pdmWaveData->byData, pbData, cbData);
+    if (pdmWave->WaveformatEx.wBitsPerSample == 8)
+    {
+        pdmWaveData->byData[cbData] = 0x80;     // Unsigned silence.
+    }
+
+    pCollection->dwWaves++;
+    pCollection->ullWaveBytes += cbData;
+    return AddDownload(pCollection, Builder.pInfo);
+}
+
+/*****************************************************************************
+ * ArticulationSize()
+ *****************************************************************************
+ * Space needed for the articulation in a 'lart' list, and the number of
+ * offset table entries it takes.
+ */
+static DWORD ArticulationSize(BYTE *pbLart, DWORD cbLart, DWORD *pdwEntries)
+{
+    DWORD cbArt1;
+    CONNECTIONLIST *pConnections = (CONNECTIONLIST *)
+        RiffFindChunk(pbLart, pbLart + cbLart, FOURCC_ART1, 0, &cbArt1);
+
+    if ((pConnections == NULL) || (cbArt1 < sizeof(CONNECTIONLIST)))
+    {
+        return 0;
+    }
+    *pdwEntries += 2;
+    return DLS_ALIGN(sizeof(DMUS_ARTICULATION2)) +
+           DLS_ALIGN(sizeof(CONNECTIONLIST) + pConnections->cConnections * sizeof(CONNECTION));
+}
+
+/*****************************************************************************
+ * AddArticulation()
+ *****************************************************************************
+ * Copy the 'art1' connection list from a 'lart' list into the chunk as a
+ * DMUS_ARTICULATION2.  Returns its offset table index, or 0 if there is none.
+ */
+static ULONG AddArticulation(DLSBUILDER *pBuilder, BYTE *pbLart, DWORD cbLart)
+{
+    DWORD cbArt1;
+    CONNECTIONLIST *pConnections = (CONNECTIONLIST *)
+        RiffFindChunk(pbLart, pbLart + cbLart, FOURCC_ART1, 0, &cbArt1);
+
+    if ((pConnections == NULL) || (cbArt1 < sizeof(CONNECTIONLIST)))
+    {
+        return 0;
+    }
+
+    DWORD cConnections = pConnections->cConnections;
+    if (pConnections->cbSize + cConnections * sizeof(CONNECTION) > cbArt1)
+    {
+        cConnections = (cbArt1 - pConnections->cbSize) / sizeof(CONNECTION);
+    }
+
+    ULONG ulArtIdx, ulListIdx;
+    DMUS_ARTICULATION2 *pdmArtic = (DMUS_ARTICULATION2 *)
+        BuilderAdd(pBuilder, sizeof(DMUS_ARTICULATION2), &ulArtIdx);
+    CONNECTIONLIST *pList = (CONNECTIONLIST *)
+        BuilderAdd(pBuilder, sizeof(CONNECTIONLIST) + cConnections * sizeof(CONNECTION), &ulListIdx);
+    if ((pdmArtic == NULL) || (pList == NULL))
+    {
+        return 0;
+    }
+
+    // The synth expects the connections straight after the list header.
+    pList->cbSize = sizeof(CONNECTIONLIST);
+    pList->cConnections = cConnections;
+    CopyMemory(pList + 1, (BYTE *) pConnections + pConnections->cbSize,
+               cConnections * sizeof(CONNECTION));
+    pdmArtic->ulArtIdx = ulListIdx;
+    return ulArtIdx;
+}
+
+/*****************************************************************************
+ * BuildInstrument()
+ *****************************************************************************
+ * Build the DMUS_DOWNLOADINFO_INSTRUMENT2 chunk for one 'ins ' list.
+ * Regions without their own 'wsmp' take it from the wave they play.
+ */
+static HRESULT BuildInstrument(DLSCOLLECTION *pCollection, DWORD dwId,
+                               BYTE *pbIns, DWORD cbIns,
+                               WSMPL **ppWaveWsmp, DWORD dwPoolSize)
+{
+    BYTE *  pbEnd = pbIns + cbIns;
+    DWORD   cbChunk, cbRgn, cbLart, cbLrgn;
+    FOURCC  ckid;
+    BYTE *  pbPos;
+
+    INSTHEADER *pHeader = (INSTHEADER *) RiffFindChunk(pbIns, pbEnd, FOURCC_INSH, 0, &cbChunk);
+    BYTE *pbLrgn = RiffFindChunk(pbIns, pbEnd, FOURCC_LIST, FOURCC_LRGN, &cbLrgn);
+    BYTE *pbLart = RiffFindChunk(pbIns, pbEnd, FOURCC_LIST, FOURCC_LART, &cbLart);
+    if ((pHeader == NULL) || (pbLrgn == NULL))
+    {
+        return DMUS_E_BADINSTRUMENT;
+    }
+
+    // Size the chunk.
+    DWORD dwEntries = 1;
+    DWORD cbData = DLS_ALIGN(sizeof(DMUS_INSTRUMENT));
+    if (pbLart)
+    {
+        cbData += ArticulationSize(pbLart, cbLart, &dwEntries);
+    }
+    BYTE *pbRgn;
+    for (pbPos = pbLrgn; RiffNextChunk(&pbPos, pbLrgn + cbLrgn, &ckid, &pbRgn, &cbRgn); )
+    {
+        if ((ckid == FOURCC_LIST) && (cbRgn >= sizeof(FOURCC)) &&
+            (*(FOURCC *) pbRgn == FOURCC_RGN))
+        {
+            BYTE *pbRgnLart = RiffFindChunk(pbRgn + 4, pbRgn + cbRgn, FOURCC_LIST, FOURCC_LART, &cbLart);
+            dwEntries++;
+            cbData += DLS_ALIGN(sizeof(DMUS_REGION));
+            if (pbRgnLart)
+            {
+                cbData += ArticulationSize(pbRgnLart, cbLart, &dwEntries);
+            }
+        }
+    }
+
+    DLSBUILDER Builder;
+    if (!BuilderInit(&Builder, DMUS_DOWNLOADINFO_INSTRUMENT2, dwId, dwEntries, cbData))
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    DMUS_INSTRUMENT *pdmInstrument = (DMUS_INSTRUMENT *)
+        BuilderAdd(&Builder, sizeof(DMUS_INSTRUMENT), NULL);
+    ULONG ulBank = pHeader->Locale.ulBank;
+    pdmInstrument->ulPatch = (ulBank & F_INSTRUMENT_DRUMS) |
+                             ((ulBank & 0x7F00) << 8) |
+                             ((ulBank & 0x7F) << 8) |
+                             (pHeader->Locale.ulInstrument & 0x7F);
+    if (pbLart)
+    {
+        pdmInstrument->ulGlobalArtIdx = AddArticulation(&Builder, pbLart, cbLart);
+    }
+
+    ULONG *pulNextRegion = &pdmInstrument->ulFirstRegionIdx;
+    for (pbPos = pbLrgn; RiffNextChunk(&pbPos, pbLrgn + cbLrgn, &ckid, &pbRgn, &cbRgn); )
+    {
+        if ((ckid != FOURCC_LIST) || (cbRgn < sizeof(FOURCC)) ||
+            (*(FOURCC *) pbRgn != FOURCC_RGN))
+        {
+            continue;
+        }
+        BYTE *      pbRgnEnd = pbRgn + cbRgn;
+        DWORD       cbRgnh, cbWsmp, cbWlnk;
+        RGNHEADER * pRgnh = (RGNHEADER *) RiffFindChunk(pbRgn + 4, pbRgnEnd, FOURCC_RGNH, 0, &cbRgnh);
+        WSMPL *     pWsmp = (WSMPL *) RiffFindChunk(pbRgn + 4, pbRgnEnd, FOURCC_WSMP, 0, &cbWsmp);
+        WAVELINK *  pWlnk = (WAVELINK *) RiffFindChunk(pbRgn + 4, pbRgnEnd, FOURCC_WLNK, 0, &cbWlnk);
+        BYTE *      pbRgnLart = RiffFindChunk(pbRgn + 4, pbRgnEnd, FOURCC_LIST, FOURCC_LART, &cbLart);
+
+        if ((pRgnh == NULL) || (pWlnk == NULL) || (pWlnk->ulTableIndex >= dwPoolSize))
+        {
+            delete Builder.pbChunk;
+            return DMUS_E_BADINSTRUMENT;
+        }
+        if (pWsmp == NULL)
+        {
+            pWsmp = ppWaveWsmp[pWlnk->ulTableIndex];
+        }
+
+        ULONG ulRegionIdx;
+        DMUS_REGION *pdmRegion = (DMUS_REGION *) BuilderAdd(&Builder, sizeof(DMUS_REGION), &ulRegionIdx);
+        pdmRegion->RangeKey = pRgnh->RangeKey;
+        pdmRegion->RangeVelocity = pRgnh->RangeVelocity;
+        pdmRegion->fusOptions = pRgnh->fusOptions;
+        pdmRegion->usKeyGroup = pRgnh->usKeyGroup;
+        pdmRegion->WaveLink = *pWlnk;
+        if (pWsmp)
+        {
+            pdmRegion->WSMP = *pWsmp;
+            pdmRegion->WSMP.cbSize = sizeof(WSMPL);
+            if (pWsmp->cSampleLoops)
+            {
+                // Only the first loop is used by the synth.
+                pdmRegion->WSMP.cSampleLoops = 1;
+                pdmRegion->WLOOP[0] = *(WLOOP *) ((BYTE *) pWsmp + pWsmp->cbSize);
+            }
+        }
+        else
+        {
+            pdmRegion->WSMP.cbSize = sizeof(WSMPL);
+            pdmRegion->WSMP.usUnityNote = 60;
+        }
+        if (pbRgnLart)
+        {
+            pdmRegion->ulRegionArtIdx = AddArticulation(&Builder, pbRgnLart, cbLart);
+        }
+
+        *pulNextRegion = ulRegionIdx;
+        pulNextRegion = &pdmRegion->ulNextRegionIdx;
+        pCollection->dwRegions++;
+    }
+
+    pCollection->dwInstruments++;
+    return AddDownload(pCollection, Builder.pInfo);
+}
+
+/*****************************************************************************
+ * DlsLoadCollection()
+ *****************************************************************************
+ * Parse a DLS file into download chunks, waves first.
+ */
+HRESULT DlsLoadCollection(LPCSTR pszFileName, DLSCOLLECTION *pCollection)
+{
+    DWORD   cbFile, cbPtbl, cbWvpl, cbLins;
+    HRESULT hr = S_OK;
+
+    ZeroMemory(pCollection, sizeof(DLSCOLLECTION));
+
+    BYTE *pbFile = LoadFileImage(pszFileName, &cbFile);
+    if (pbFile == NULL)
+    {
+        return E_FAIL;
+    }
+    BYTE *pbEnd = pbFile + cbFile;
+    if ((cbFile < 12) || (*(FOURCC *) pbFile != FOURCC_RIFF) ||
+        (*(FOURCC *) (pbFile + 8) != FOURCC_DLS))
+    {
+        delete [] pbFile;
+        return DMUS_E_INVALIDFILE;
+    }
+
+    BYTE *pbBody = pbFile + 12;
+    POOLTABLE *pPoolTable = (POOLTABLE *) RiffFindChunk(pbBody, pbEnd, FOURCC_PTBL, 0, &cbPtbl);
+    BYTE *pbWvpl = RiffFindChunk(pbBody, pbEnd, FOURCC_LIST, FOURCC_WVPL, &cbWvpl);
+    BYTE *pbLins = RiffFindChunk(pbBody, pbEnd, FOURCC_LIST, FOURCC_LINS, &cbLins);
+    if ((pPoolTable == NULL) || (pbWvpl == NULL) || (pbLins == NULL))
+    {
+        delete [] pbFile;
+        return DMUS_E_INVALIDFILE;
+    }
+
+    // Waves, in pool table order.  Cue offsets are relative to the
+    // wave pool list data, which starts at the 'wvpl' list type.
+    DWORD   dwPoolSize = pPoolTable->cCues;
+    POOLCUE *pCues = (POOLCUE *) ((BYTE *) pPoolTable + pPoolTable->cbSize);
+    WSMPL ** ppWaveWsmp = new WSMPL *[dwPoolSize + 1];
+    if (ppWaveWsmp == NULL)
+    {
+        delete [] pbFile;
+        return E_OUTOFMEMORY;
+    }
+    DWORD dwIndex;
+    for (dwIndex = 0; SUCCEEDED(hr) && (dwIndex < dwPoolSize); dwIndex++)
+    {
+        BYTE *  pbPos = pbWvpl - sizeof(FOURCC) + pCues[dwIndex].ulOffset;
+        FOURCC  ckid;
+        BYTE *  pbWave;
+        DWORD   cbWave;
+
+        hr = DMUS_E_BADWAVE;
+        if ((pbPos >= pbWvpl) &&
+            RiffNextChunk(&pbPos, pbWvpl + cbWvpl, &ckid, &pbWave, &cbWave) &&
+            (ckid == FOURCC_LIST) && (cbWave >= sizeof(FOURCC)) &&
+            (*(FOURCC *) pbWave == FOURCC_WAVE_LIST))
+        {
+            hr = BuildWave(pCollection, dwIndex, pbWave + 4, cbWave - 4, &ppWaveWsmp[dwIndex]);
+        }
+    }
+
+    // Then the instruments.
+    BYTE *  pbPos = pbLins;
+    FOURCC  ckid;
+    BYTE *  pbIns;
+    DWORD   cbIns;
+    DWORD   dwId = dwPoolSize;
+    while (SUCCEEDED(hr) && RiffNextChunk(&pbPos, pbLins + cbLins, &ckid, &pbIns, &cbIns))
+    {
+        if ((ckid == FOURCC_LIST) && (cbIns >= sizeof(FOURCC)) &&
+            (*(FOURCC *) pbIns == FOURCC_INS))
+        {
+            hr = BuildInstrument(pCollection, dwId++, pbIns + 4, cbIns - 4, ppWaveWsmp, dwPoolSize);
+        }
+    }
+
+    delete [] ppWaveWsmp;
+    delete [] pbFile;
+    if (FAILED(hr))
+    {
+        DlsFreeCollection(pCollection);
+    }
+    return hr;
+}
+
+/*****************************************************************************
+ * DlsDownload()
+ *****************************************************************************
+ * Download every chunk to the synth.  Instrument chunks are freed as soon
+ * as the synth has parsed them; wave chunks now belong to the synth.
+ */
+HRESULT DlsDownload(CSynth *pSynth, DLSCOLLECTION *pCollection)
+{
+    DWORD dwIndex;
+
+    for (dwIndex = 0; dwIndex < pCollection->dwDownloads; dwIndex++)
+    {
+        DLSDOWNLOAD *pDownload = &pCollection->pDownloads[dwIndex];
+        BOOL fFree = TRUE;
+
+        HRESULT hr = pSynth->Download(&pDownload->hDownload, pDownload->pInfo, &fFree);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+        if (fFree)
+        {
+            delete pDownload->pInfo;
+        }
+        else
+        {
+            pDownload->fSynthOwns = TRUE;
+        }
+        pDownload->pInfo = NULL;
+    }
+    return S_OK;
+}
+
+/*****************************************************************************
+ * DlsUnload()
+ *****************************************************************************
+ * Unload instruments, then the waves they used.  With no callback the
+ * synth deletes each wave chunk once the last voice is done with it.
+ */
+void DlsUnload(CSynth *pSynth, DLSCOLLECTION *pCollection)
+{
+    DWORD dwIndex;
+
+    for (dwIndex = pCollection->dwDownloads; dwIndex > 0; dwIndex--)
+    {
+        DLSDOWNLOAD *pDownload = &pCollection->pDownloads[dwIndex - 1];
+        if (pDownload->hDownload)
+        {
+            pSynth->Unload(pDownload->hDownload, NULL, NULL);
+            pDownload->hDownload = NULL;
+        }
+    }
+}
+
+/*****************************************************************************
+ * DlsFreeCollection()
+ *****************************************************************************
+ * Free any chunks that were never handed to the synth.
+ */
+void DlsFreeCollection(DLSCOLLECTION *pCollection)
+{
+    DWORD dwIndex;
+
+    for (dwIndex = 0; dwIndex < pCollection->dwDownloads; dwIndex++)
+    {
+        if (pCollection->pDownloads[dwIndex].pInfo)
+        {
+            delete pCollection->pDownloads[dwIndex].pInfo;
+        }
+    }
+    if (pCollection->pDownloads)
+    {
+        delete [] pCollection->pDownloads;
+    }
+    ZeroMemory(pCollection, sizeof(DLSCOLLECTION));
+}
@@ -0,0 +1,436 @@
+//
+//      Copyright (c) 1996-2000 Microsoft Corporation.  All rights reserved.
+//      Render.cpp
+//
+//      ddkrender: plays a Standard MIDI File through the ddksynth engine
+//      (CSynth) with a DLS collection, faster than real time, and writes
+//      the result to a wave file.  It times each stage so changes to the
+//      mix loops, voice allocation or MIDI path can be measured without
+//      loading the driver.
+//
+//      Usage:  ddkrender [options] collection.dls song.mid [output.wav]
+//              ddkrender [options] -s<notes> collection.dls [output.wav]
+//
+//      The second form plays a generated song instead of a file, to load
+//      voice allocation and stealing.
+//
+
+#include "common.h"
+#include "render.h"
+
+#define RENDER_DEFAULT_RATE     22050
+#define RENDER_DEFAULT_VOICES   MAX_NUM_VOICES
+#define RENDER_DEFAULT_BUFFER   10          // Milliseconds per Mix() call.
+#define RENDER_DEFAULT_TAIL     2000        // Milliseconds after the last event.
+#define RENDER_REGISTRY_INTERP  ((DWORD) -1) // Use the MixInterpolation registry value.
+#define RENDER_STRESS_SECONDS   10          // Length of the generated song.
+
+static const char *s_apszInterpolation[MIX_INTERP_COUNT] = { "linear", "cubic", "sinc" };
+
+/*****************************************************************************
+ * class CRenderSink
+ *****************************************************************************
+ * The host clock is the sample position itself, so reference times handed
+ * to PlayBuffer() are already in samples.
+ */
+class CRenderSink : public ISynthSinkDMus
+{
+public:
+    HRESULT RefTimeToSample(REFERENCE_TIME rtTime, LONGLONG *pllSampleTime)
+    {
+        *pllSampleTime = rtTime;
+        return S_OK;
+    }
+};
+
+/*****************************************************************************
+ * struct RENDERSTAGE
+ *****************************************************************************
+ * Wall clock time spent in one stage of the run.
+ */
+typedef struct RENDERSTAGE
+{
+    LONGLONG    llTicks;
+    LPCSTR      pszName;
+} RENDERSTAGE;
+
+enum { STAGE_LOAD, STAGE_DOWNLOAD, STAGE_MIDI, STAGE_MIX, STAGE_WRITE, STAGE_COUNT };
+
+static RENDERSTAGE  s_aStages[STAGE_COUNT] =
+{
+    { 0, "load files"   },
+    { 0, "download"     },
+    { 0, "MIDI input"   },
+    { 0, "mix"          },
+    { 0, "wave write"   },
+};
+static LONGLONG     s_llFrequency;
+
+static __inline LONGLONG RenderNow()
+{
+    LARGE_INTEGER li;
+    QueryPerformanceCounter(&li);
+    return li.QuadPart;
+}
+
+static __inline double RenderMs(LONGLONG llTicks)
+{
+    return (double) llTicks * 1000.0 / (double) s_llFrequency;
+}
+
+/*****************************************************************************
+ * WaveOpen()
+ *****************************************************************************
+ * Write a 16 bit PCM wave header with the sizes left blank.
+ */
+static FILE * WaveOpen(LPCSTR pszFileName, DWORD dwSampleRate, DWORD dwChannels)
+{
+    FILE *pFile = fopen(pszFileName, "wb");
+    if (pFile == NULL)
+    {
+        return NULL;
+    }
+
+    PCMWAVEFORMAT   Format;
+    DWORD           adwHeader[5];
+
+    Format.wf.wFormatTag = WAVE_FORMAT_PCM;
+    Format.wf.nChannels = (WORD) dwChannels;
+    Format.wf.nSamplesPerSec = dwSampleRate;
+    Format.wf.nBlockAlign = (WORD) (dwChannels * sizeof(short));
+    Format.wf.nAvgBytesPerSec = dwSampleRate * Format.wf.nBlockAlign;
+    Format.wBitsPerSample = 16;
+
+    adwHeader[0] = FOURCC_RIFF;
+    adwHeader[1] = 0;
+    adwHeader[2] = mmioFOURCC('W','A','V','E');
+    adwHeader[3] = mmioFOURCC('f','m','t',' ');
+    adwHeader[4] = sizeof(Format);
+    fwrite(adwHeader, sizeof(adwHeader), 1, pFile);
+    fwrite(&Format, sizeof(Format), 1, pFile);
+
+    adwHeader[0] = mmioFOURCC('d','a','t','a');
+    adwHeader[1] = 0;
+    fwrite(adwHeader, sizeof(DWORD) * 2, 1, pFile);
+    return pFile;
+}
+
+/*****************************************************************************
+ * WaveClose()
+ *****************************************************************************
+ * Fill in the RIFF and data sizes and close the file.
+ */
+static void WaveClose(FILE *pFile, DWORD cbData)
+{
+    DWORD cbRiff = 4 + 8 + sizeof(PCMWAVEFORMAT) + 8 + cbData;
+
+    fseek(pFile, 4, SEEK_SET);
+    fwrite(&cbRiff, sizeof(DWORD), 1, pFile);
+    fseek(pFile, 12 + 8 + sizeof(PCMWAVEFORMAT) + 4, SEEK_SET);
+    fwrite(&cbData, sizeof(DWORD), 1, pFile);
+    fclose(pFile);
+}
+
+/*****************************************************************************
+ * Usage()
+ *****************************************************************************
+ */
+static void Usage()
+{
+    printf("usage: ddkrender [options] collection.dls song.mid [output.wav]\n"
+           "       ddkrender [options] -s<notes> collection.dls [output.wav]\n"
+           "  -r<rate>    sample rate (default %d)\n"
+           "  -m          mono output (default stereo)\n"
+           "  -p<voices>  voice limit (default %d)\n"
+           "  -b<ms>      mix buffer length (default %d)\n"
+           "  -t<ms>      tail rendered after the last event (default %d)\n"
+           "  -n<count>   render the song this many times (default 1)\n"
+           "  -i<mode>    interpolation: 0 linear, 1 cubic, 2 sinc (default from registry)\n"
+           "  -s<notes>   play %d s of random notes at this many a second\n"
+           "  -w<samples> stream waves longer than this (default from registry)\n",
+           RENDER_DEFAULT_RATE, RENDER_DEFAULT_VOICES,
+           RENDER_DEFAULT_BUFFER, RENDER_DEFAULT_TAIL, RENDER_STRESS_SECONDS);
+}
+
+/*****************************************************************************
+ * main()
+ *****************************************************************************
+ */
+int __cdecl main(int argc, char **argv)
+{
+    DWORD   dwSampleRate = RENDER_DEFAULT_RATE;
+    DWORD   dwChannels = 2;
+    DWORD   dwVoices = RENDER_DEFAULT_VOICES;
+    DWORD   dwBufferMs = RENDER_DEFAULT_BUFFER;
+    DWORD   dwTailMs = RENDER_DEFAULT_TAIL;
+    DWORD   dwRepeat = 1;
+    DWORD   dwInterpolation = RENDER_REGISTRY_INTERP;
+    DWORD   dwStressNotes = 0;
+    DWORD   dwStreamThreshold = 0;
+    LPCSTR  apszFiles[3] = { NULL, NULL, NULL };
+    int     nFiles = 0;
+    int     nArg;
+
+    for (nArg = 1; nArg < argc; nArg++)
+    {
+        char *psz = argv[nArg];
+        if ((psz[0] == '-') || (psz[0] == '/'))
+        {
+            DWORD dwValue = strtoul(psz + 2, NULL, 10);
+            switch (psz[1])
+            {
+            case 'r': dwSampleRate = dwValue; break;
+            case 'm': dwChannels = 1; break;
+            case 'p': dwVoices = dwValue; break;
+            case 'b': dwBufferMs = dwValue; break;
+            case 't': dwTailMs = dwValue; break;
+            case 'n': dwRepeat = dwValue; break;
+            case 'i': dwInterpolation = dwValue; break;
+            case 's': dwStressNotes = dwValue; break;
+            case 'w': dwStreamThreshold = dwValue; break;
+            default:  Usage(); return 1;
+            }
+        }
+        else if (nFiles < 3)
+        {
+            apszFiles[nFiles++] = psz;
+        }
+    }
+
+    // A generated song takes the place of the song file.
+    if (dwStressNotes && (nFiles > 0))
+    {
+        apszFiles[2] = apszFiles[1];
+        apszFiles[1] = NULL;
+        nFiles++;
+    }
+    if ((nFiles < 2) || (dwSampleRate < 8000) || (dwSampleRate > 96000) ||
+        (dwVoices == 0) || (dwBufferMs == 0) || (dwRepeat == 0) ||
+        ((dwInterpolation != RENDER_REGISTRY_INTERP) && (dwInterpolation >= MIX_INTERP_COUNT)))
+    {
+        Usage();
+        return 1;
+    }
+
+    LARGE_INTEGER liFrequency;
+    QueryPerformanceFrequency(&liFrequency);
+    s_llFrequency = liFrequency.QuadPart;
+
+    // Load the collection and the song.
+    DLSCOLLECTION   Collection;
+    SMFSONG         Song;
+    LONGLONG        llStart = RenderNow();
+    HRESULT         hr = DlsLoadCollection(apszFiles[0], &Collection);
+    if (FAILED(hr))
+    {
+        printf("ddkrender: can't load collection %s (%08lx)\n", apszFiles[0], hr);
+        return 1;
+    }
+    if (dwStressNotes)
+    {
+        hr = SmfStressSong(dwSampleRate, dwStressNotes, RENDER_STRESS_SECONDS, &Song);
+    }
+    else
+    {
+        hr = SmfLoadSong(apszFiles[1], dwSampleRate, &Song);
+    }
+    if (FAILED(hr))
+    {
+        printf("ddkrender: can't load song %s (%08lx)\n",
+               apszFiles[1] ? apszFiles[1] : "(stress)", hr);
+        DlsFreeCollection(&Collection);
+        return 1;
+    }
+    s_aStages[STAGE_LOAD].llTicks = RenderNow() - llStart;
+
+    // Bring up the synth and download the collection.
+    CSynth *pSynth = new CSynth;
+    if (pSynth == NULL)
+    {
+        SmfFreeSong(&Song);
+        DlsFreeCollection(&Collection);
+        return 1;
+    }
+    hr = pSynth->Open(1, dwVoices);
+    if (SUCCEEDED(hr) && (dwInterpolation != RENDER_REGISTRY_INTERP))
+    {
+        pSynth->m_dwInterpolation = dwInterpolation;
+    }
+    if (SUCCEEDED(hr) && dwStreamThreshold)
+    {
+        hr = pSynth->SetStreamThreshold(dwStreamThreshold);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pSynth->Activate(dwSampleRate, dwChannels);
+    }
+    if (SUCCEEDED(hr))
+    {
+        llStart = RenderNow();
+        hr = DlsDownload(pSynth, &Collection);
+        s_aStages[STAGE_DOWNLOAD].llTicks = RenderNow() - llStart;
+    }
+    if (FAILED(hr))
+    {
+        printf("ddkrender: can't start the synth (%08lx)\n", hr);
+        DlsUnload(pSynth, &Collection);
+        pSynth->Close();
+        delete pSynth;
+        SmfFreeSong(&Song);
+        DlsFreeCollection(&Collection);
+        return 1;
+    }
+
+    FILE *pWaveFile = NULL;
+    if (apszFiles[2])
+    {
+        pWaveFile = WaveOpen(apszFiles[2], dwSampleRate, dwChannels);
+        if (pWaveFile == NULL)
+        {
+            printf("ddkrender: can't create %s\n", apszFiles[2]);
+        }
+    }
+
+    // Render.  Each pass plays the whole song and its tail; events are
+    // queued just ahead of the buffer they fall in, as the port driver does.
+    DWORD       dwBufferLength = dwSampleRate * dwBufferMs / 1000;
+    short *     pBuffer = new short[dwBufferLength * dwChannels];
+    LONGLONG    llSongLength = Song.llLength + (LONGLONG) dwSampleRate * dwTailMs / 1000;
+    LONGLONG    llPosition = 0;
+    LONGLONG    llNextStats = dwSampleRate;
+    DWORD       cbWritten = 0;
+    DWORD       dwEventsPlayed = 0;
+    DWORD       dwStatsSamples = 0;
+    DWORD       dwVoiceSum = 0;
+    DWORD       dwPeakVoices = 0;
+    DWORD       dwNotesLost = 0;
+    DWORD       dwMaxAmplitude = 0;
+    CRenderSink Sink;
+    DWORD       dwPass;
+
+    if (pBuffer == NULL)
+    {
+        dwRepeat = 0;
+    }
+    for (dwPass = 0; dwPass < dwRepeat; dwPass++)
+    {
+        LONGLONG    llPassStart = llPosition;
+        DWORD       dwEvent = 0;
+
+        while (llPosition < llPassStart + llSongLength)
+        {
+            LONGLONG llEnd = llPosition + dwBufferLength;
+
+            llStart = RenderNow();
+            while ((dwEvent < Song.dwEvents) &&
+                   (Song.pEvents[dwEvent].llSampleTime + llPassStart < llEnd))
+            {
+                SMFEVENT *pEvent = &Song.pEvents[dwEvent++];
+                if (pEvent->cbSysEx)
+                {
+                    pSynth->PlayBuffer(&Sink, pEvent->llSampleTime + llPassStart,
+                                       pEvent->pbSysEx, pEvent->cbSysEx, 1);
+                }
+                else
+                {
+                    pSynth->PlayBuffer(&Sink, pEvent->llSampleTime + llPassStart,
+                                       pEvent->abShort, 3, 1);
+                }
+                dwEventsPlayed++;
+            }
+            LONGLONG llMidi = RenderNow();
+            s_aStages[STAGE_MIDI].llTicks += llMidi - llStart;
+
+            ZeroMemory(pBuffer, dwBufferLength * dwChannels * sizeof(short));
+            pSynth->Mix(pBuffer, dwBufferLength, llPosition);
+            LONGLONG llMix = RenderNow();
+            s_aStages[STAGE_MIX].llTicks += llMix - llMidi;
+
+            if (pWaveFile)
+            {
+                DWORD cbBuffer = dwBufferLength * dwChannels * sizeof(short);
+                fwrite(pBuffer, cbBuffer, 1, pWaveFile);
+                cbWritten += cbBuffer;
+                s_aStages[STAGE_WRITE].llTicks += RenderNow() - llMix;
+            }
+            llPosition = llEnd;
+
+            // The synth rolls its statistics over once a second.
+            if (llPosition >= llNextStats)
+            {
+                PerfStats Stats;
+                pSynth->GetPerformanceStats(&Stats);
+                dwStatsSamples++;
+                dwVoiceSum += Stats.dwVoices;
+                dwNotesLost += Stats.dwNotesLost;
+                if (Stats.dwVoices > dwPeakVoices)
+                {
+                    dwPeakVoices = Stats.dwVoices;
+                }
+                if (Stats.dwMaxAmplitude > dwMaxAmplitude)
+                {
+                    dwMaxAmplitude = Stats.dwMaxAmplitude;
+                }
+                llNextStats += dwSampleRate;
+            }
+        }
+        pSynth->AllNotesOff();
+    }
+
+    if (pWaveFile)
+    {
+        llStart = RenderNow();
+        WaveClose(pWaveFile, cbWritten);
+        s_aStages[STAGE_WRITE].llTicks += RenderNow() - llStart;
+    }
+
+    // Report.
+    double  dSeconds = (double) llPosition / (double) dwSampleRate;
+    double  dMixMs = RenderMs(s_aStages[STAGE_MIX].llTicks);
+    double  dRenderMs = RenderMs(s_aStages[STAGE_MIDI].llTicks + s_aStages[STAGE_MIX].llTicks);
+    double  dAverageVoices = dwStatsSamples ? (double) dwVoiceSum / dwStatsSamples : 0.0;
+    int     nStage;
+
+    printf("collection  %s: %lu waves (%I64u bytes), %lu instruments, %lu regions\n",
+           apszFiles[0], Collection.dwWaves, Collection.ullWaveBytes,
+           Collection.dwInstruments, Collection.dwRegions);
+    printf("song        %s: %lu events, %.2f s\n",
+           apszFiles[1] ? apszFiles[1] : "(stress)", Song.dwEvents, (double) Song.llLength / dwSampleRate);
+    printf("output      %lu Hz, %s, %lu voices, %lu ms buffers, %lu pass(es), %s interpolation\n",
+           dwSampleRate, (dwChannels == 2) ? "stereo" : "mono", dwVoices, dwBufferMs, dwRepeat,
+           s_apszInterpolation[pSynth->m_dwInterpolation]);
+    printf("\n");
+    for (nStage = 0; nStage < STAGE_COUNT; nStage++)
+    {
+        printf("%-12s%10.2f ms\n", s_aStages[nStage].pszName, RenderMs(s_aStages[nStage].llTicks));
+    }
+    printf("\n");
+    printf("rendered            %.2f s of audio, %lu events\n", dSeconds, dwEventsPlayed);
+    if (dRenderMs > 0.0)
+    {
+        printf("speed               %.1fx real time\n", dSeconds * 1000.0 / dRenderMs);
+        printf("voice throughput    %.1f voice-seconds per second\n",
+               dAverageVoices * dSeconds * 1000.0 / dRenderMs);
+    }
+    if (dSeconds > 0.0)
+    {
+        printf("mix cost            %.3f ms per second of audio\n", dMixMs / dSeconds);
+    }
+    printf("voices              %.1f average, %lu peak\n", dAverageVoices, dwPeakVoices);
+    printf("notes lost          %lu\n", dwNotesLost);
+    printf("stream underruns    %ld\n", pSynth->m_lStreamUnderruns);
+    printf("peak amplitude      %lu\n", dwMaxAmplitude);
+
+    // Shut down.
+    if (pBuffer)
+    {
+        delete [] pBuffer;
+    }
+    DlsUnload(pSynth, &Collection);
+    pSynth->Close();
+    delete pSynth;
+    SmfFreeSong(&Song);
+    DlsFreeCollection(&Collection);
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+/*
+    Copyright (c) 1996-2000 Microsoft Corporation.  All rights reserved.
+*/
+
+//
+// Render.h
+//
+// Declarations for the ddkrender host: DLS collection loader, Standard
+// MIDI File reader and the timing helpers used by the benchmark report.
+//
+
+#ifndef _RENDER_H_
+#define _RENDER_H_
+
+/*****************************************************************************
+ * struct DLSDOWNLOAD
+ *****************************************************************************
+ * One download chunk (DMUS_DOWNLOADINFO, offset table and data) built from
+ * the collection, in the form CSynth::Download() expects.
+ */
+typedef struct DLSDOWNLOAD
+{
+    DMUS_DOWNLOADINFO * pInfo;          // Start of the download chunk.
+    HANDLE              hDownload;      // Handle returned by CSynth::Download().
+    BOOL                fSynthOwns;     // Synth keeps the chunk until unload.
+} DLSDOWNLOAD;
+
+/*****************************************************************************
+ * struct DLSCOLLECTION
+ *****************************************************************************
+ * All downloads for one DLS collection.  Waves come first, since
+ * instruments are linked to waves that are already downloaded.
+ */
+typedef struct DLSCOLLECTION
+{
+    DLSDOWNLOAD *       pDownloads;
+    DWORD               dwDownloads;    // Entries used.
+    DWORD               dwAllocated;    // Entries allocated.
+    DWORD               dwWaves;
+    DWORD               dwInstruments;
+    DWORD               dwRegions;
+    ULONGLONG           ullWaveBytes;   // Total sample data.
+} DLSCOLLECTION;
+
+HRESULT DlsLoadCollection(LPCSTR pszFileName, DLSCOLLECTION *pCollection);
+HRESULT DlsDownload(CSynth *pSynth, DLSCOLLECTION *pCollection);
+void    DlsUnload(CSynth *pSynth, DLSCOLLECTION *pCollection);
+void    DlsFreeCollection(DLSCOLLECTION *pCollection);
+
+/*****************************************************************************
+ * struct SMFEVENT
+ *****************************************************************************
+ * One MIDI event from the song, time stamped in samples.
+ */
+typedef struct SMFEVENT
+{
+    LONGLONG            llSampleTime;   // When it plays, in samples.
+    DWORD               dwTick;         // Original tick, for sorting.
+    DWORD               dwOrder;        // File order, to keep the sort stable.
+    BYTE                abShort[4];     // Channel message, if cbSysEx is 0.
+    BYTE *              pbSysEx;        // F0 ... F7, allocated per event.
+    DWORD               cbSysEx;
+} SMFEVENT;
+
+/*****************************************************************************
+ * struct SMFSONG
+ *****************************************************************************
+ * All channel and SysEx events of a Standard MIDI File, merged across
+ * tracks and sorted by time.
+ */
+typedef struct SMFSONG
+{
+    BYTE *              pbFile;         // File image.
+    SMFEVENT *          pEvents;
+    DWORD               dwEvents;
+    DWORD               dwAllocated;
+    LONGLONG            llLength;       // Time of the last event, in samples.
+} SMFSONG;
+
+HRESULT SmfLoadSong(LPCSTR pszFileName, DWORD dwSampleRate, SMFSONG *pSong);
+HRESULT SmfStressSong(DWORD dwSampleRate, DWORD dwNotesPerSecond, DWORD dwSeconds, SMFSONG *pSong);
+void    SmfFreeSong(SMFSONG *pSong);
+
+BYTE *  LoadFileImage(LPCSTR pszFileName, DWORD *pcbFile);
+
+#endif // _RENDER_H_
@@ -0,0 +1,435 @@
+//
+//      Copyright (c) 1996-2000 Microsoft Corporation.  All rights reserved.
+//      Smf.cpp
+//
+//      Reads a Standard MIDI File (format 0 or 1) into one list of events,
+//      time stamped in samples at the render rate.
+//
+
+#include "common.h"
+#include "render.h"
+
+#define FOURCC_MTHD     mmioFOURCC('M','T','h','d')
+#define FOURCC_MTRK     mmioFOURCC('M','T','r','k')
+
+#define SMF_META        0xFF
+#define SMF_META_TEMPO  0x51
+#define SMF_DEFAULT_TEMPO   500000      // Microseconds per quarter note.
+
+/*****************************************************************************
+ * SmfWord(), SmfDword()
+ *****************************************************************************
+ * SMF numbers are big-endian.
+ */
+static __inline DWORD SmfWord(BYTE *pb)
+{
+    return (pb[0] << 8) | pb[1];
+}
+
+static __inline DWORD SmfDword(BYTE *pb)
+{
+    return (pb[0] << 24) | (pb[1] << 16) | (pb[2] << 8) | pb[3];
+}
+
+/*****************************************************************************
+ * SmfReadVarLen()
+ *****************************************************************************
+ * Read a variable length quantity.  Returns FALSE at the end of the track.
+ */
+static BOOL SmfReadVarLen(BYTE **ppb, BYTE *pbEnd, DWORD *pdwValue)
+{
+    DWORD dwValue = 0;
+    int   nBytes;
+
+    for (nBytes = 0; nBytes < 4; nBytes++)
+    {
+        if (*ppb >= pbEnd)
+        {
+            return FALSE;
+        }
+        BYTE b = *(*ppb)++;
+        dwValue = (dwValue << 7) | (b & 0x7F);
+        if (!(b & 0x80))
+        {
+            *pdwValue = dwValue;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*****************************************************************************
+ * SmfAddEvent()
+ *****************************************************************************
+ * Append an event to the song, growing the list as needed.
+ */
+static SMFEVENT * SmfAddEvent(SMFSONG *pSong, DWORD dwTick)
+{
+    if (pSong->dwEvents == pSong->dwAllocated)
+    {
+        DWORD dwAllocated = pSong->dwAllocated ? pSong->dwAllocated * 2 : 4096;
+        SMFEVENT *pEvents = new SMFEVENT[dwAllocated];
+        if (pEvents == NULL)
+        {
+            return NULL;
+        }
+        if (pSong->pEvents)
+        {
+            CopyMemory(pEvents, pSong->pEvents, pSong->dwEvents * sizeof(SMFEVENT));
+            delete [] pSong->pEvents;
+        }
+        pSong->pEvents = pEvents;
+        pSong->dwAllocated = dwAllocated;
+    }
+    SMFEVENT *pEvent = &pSong->pEvents[pSong->dwEvents];
+    ZeroMemory(pEvent, sizeof(SMFEVENT));
+    pEvent->dwTick = dwTick;
+    pEvent->dwOrder = pSong->dwEvents++;
+    return pEvent;
+}
+
+/*****************************************************************************
+ * SmfReadTrack()
+ *****************************************************************************
+ * Add the channel, SysEx and tempo events of one track to the song.  Tempo
+ * changes are kept as meta events with abShort[0] == 0xFF and the tempo in
+ * cbSysEx; they are folded into the sample times and dropped afterwards.
+ */
+static HRESULT SmfReadTrack(SMFSONG *pSong, BYTE *pbTrack, BYTE *pbEnd)
+{
+    static const BYTE abDataBytes[8] = { 2, 2, 2, 2, 1, 1, 2, 0 };
+    DWORD   dwTick = 0;
+    BYTE    bRunningStatus = 0;
+
+    while (pbTrack < pbEnd)
+    {
+        DWORD dwDelta;
+        if (!SmfReadVarLen(&pbTrack, pbEnd, &dwDelta) || (pbTrack >= pbEnd))
+        {
+            break;
+        }
+        dwTick += dwDelta;
+
+        BYTE bStatus = *pbTrack;
+        if (bStatus & 0x80)
+        {
+            pbTrack++;
+        }
+        else if (bRunningStatus)
+        {
+            bStatus = bRunningStatus;
+        }
+        else
+        {
+            return DMUS_E_INVALIDFILE;
+        }
+
+        if (bStatus < 0xF0)
+        {
+            DWORD cbData = abDataBytes[(bStatus >> 4) & 7];
+            if (pbTrack + cbData > pbEnd)
+            {
+                break;
+            }
+            bRunningStatus = bStatus;
+            SMFEVENT *pEvent = SmfAddEvent(pSong, dwTick);
+            if (pEvent == NULL)
+            {
+                return E_OUTOFMEMORY;
+            }
+            pEvent->abShort[0] = bStatus;
+            pEvent->abShort[1] = (cbData > 0) ? pbTrack[0] : 0;
+            pEvent->abShort[2] = (cbData > 1) ? pbTrack[1] : 0;
+            pbTrack += cbData;
+        }
+        else if ((bStatus == 0xF0) || (bStatus == 0xF7))
+        {
+            // F0 messages are sent with their F0; an F7 escape
+            // sends its data bytes as they are.
+            DWORD cbData;
+            bRunningStatus = 0;
+            if (!SmfReadVarLen(&pbTrack, pbEnd, &cbData) || (cbData > (DWORD) (pbEnd - pbTrack)))
+            {
+                break;
+            }
+            SMFEVENT *pEvent = SmfAddEvent(pSong, dwTick);
+            if (pEvent == NULL)
+            {
+                return E_OUTOFMEMORY;
+            }
+            if (bStatus == 0xF0)
+            {
+                pEvent->pbSysEx = new BYTE[cbData + 1];
+                if (pEvent->pbSysEx == NULL)
+                {
+                    return E_OUTOFMEMORY;
+                }
+                pEvent->pbSysEx[0] = 0xF0;
+                CopyMemory(pEvent->pbSysEx + 1, pbTrack, cbData);
+                pEvent->cbSysEx = cbData + 1;
+            }
+            else
+            {
+                pEvent->pbSysEx = new BYTE[cbData ? cbData : 1];
+                if (pEvent->pbSysEx == NULL)
+                {
+                    return E_OUTOFMEMORY;
+                }
+                CopyMemory(pEvent->pbSysEx, pbTrack, cbData);
+                pEvent->cbSysEx = cbData;
+            }
+            pbTrack += cbData;
+        }
+        else if (bStatus == SMF_META)
+        {
+            DWORD cbData;
+            if ((pbTrack >= pbEnd))
+            {
+                break;
+            }
+            BYTE bType = *pbTrack++;
+            if (!SmfReadVarLen(&pbTrack, pbEnd, &cbData) || (cbData > (DWORD) (pbEnd - pbTrack)))
+            {
+                break;
+            }
+            if ((bType == SMF_META_TEMPO) && (cbData == 3))
+            {
+                SMFEVENT *pEvent = SmfAddEvent(pSong, dwTick);
+                if (pEvent == NULL)
+                {
+                    return E_OUTOFMEMORY;
+                }
+                pEvent->abShort[0] = SMF_META;
+                pEvent->cbSysEx = (pbTrack[0] << 16) | (pbTrack[1] << 8) | pbTrack[2];
+            }
+            else if (bType == 0x2F)
+            {
+                break;                  // End of track.
+            }
+            pbTrack += cbData;
+        }
+        else
+        {
+            // System common and real time messages have no place in a file.
+            return DMUS_E_INVALIDFILE;
+        }
+    }
+    return S_OK;
+}
+
+/*****************************************************************************
+ * SmfCompareEvents()
+ *****************************************************************************
+ * Sort by tick, keeping file order for events on the same tick.
+ */
+static int __cdecl SmfCompareEvents(const void *pv1, const void *pv2)
+{
+    const SMFEVENT *pEvent1 = (const SMFEVENT *) pv1;
+    const SMFEVENT *pEvent2 = (const SMFEVENT *) pv2;
+
+    if (pEvent1->dwTick != pEvent2->dwTick)
+    {
+        return (pEvent1->dwTick < pEvent2->dwTick) ? -1 : 1;
+    }
+    return (pEvent1->dwOrder < pEvent2->dwOrder) ? -1 : 1;
+}
+
+/*****************************************************************************
+ * SmfLoadSong()
+ *****************************************************************************
+ * Read the file, merge its tracks and convert ticks to sample times
+ * through the tempo map.
+ */
+HRESULT SmfLoadSong(LPCSTR pszFileName, DWORD dwSampleRate, SMFSONG *pSong)
+{
+    DWORD   cbFile;
+    HRESULT hr = S_OK;
+
+    ZeroMemory(pSong, sizeof(SMFSONG));
+
+    BYTE *pbFile = LoadFileImage(pszFileName, &cbFile);
+    if (pbFile == NULL)
+    {
+        return E_FAIL;
+    }
+    pSong->pbFile = pbFile;
+
+    BYTE *pbEnd = pbFile + cbFile;
+    if ((cbFile < 14) || (*(FOURCC *) pbFile != FOURCC_MTHD) || (SmfDword(pbFile + 4) < 6))
+    {
+        SmfFreeSong(pSong);
+        return DMUS_E_INVALIDFILE;
+    }
+    DWORD dwTracks = SmfWord(pbFile + 10);
+    DWORD dwDivision = SmfWord(pbFile + 12);
+    if (dwDivision == 0)
+    {
+        SmfFreeSong(pSong);
+        return DMUS_E_INVALIDFILE;
+    }
+
+    BYTE *pbChunk = pbFile + 8 + SmfDword(pbFile + 4);
+    while (SUCCEEDED(hr) && dwTracks && (pbChunk + 8 <= pbEnd))
+    {
+        DWORD cbChunk = SmfDword(pbChunk + 4);
+        BYTE *pbData = pbChunk + 8;
+        if (cbChunk > (DWORD) (pbEnd - pbData))
+        {
+            cbChunk = (DWORD) (pbEnd - pbData);
+        }
+        if (*(FOURCC *) pbChunk == FOURCC_MTRK)
+        {
+            hr = SmfReadTrack(pSong, pbData, pbData + cbChunk);
+            dwTracks--;
+        }
+        pbChunk = pbData + cbChunk;
+    }
+    if (FAILED(hr))
+    {
+        SmfFreeSong(pSong);
+        return hr;
+    }
+
+    qsort(pSong->pEvents, pSong->dwEvents, sizeof(SMFEVENT), SmfCompareEvents);
+
+    // Walk the tempo map.  With SMPTE division the tick rate is fixed,
+    // otherwise it follows the tempo.  Times are kept in sample units
+    // scaled by the division so rounding does not accumulate.
+    DWORD       dwTempo = SMF_DEFAULT_TEMPO;
+    DWORD       dwLastTick = 0;
+    LONGLONG    llTime = 0;
+    DWORD       dwIn, dwOut = 0;
+    for (dwIn = 0; dwIn < pSong->dwEvents; dwIn++)
+    {
+        SMFEVENT *pEvent = &pSong->pEvents[dwIn];
+        LONGLONG llTicks = pEvent->dwTick - dwLastTick;
+
+        if (dwDivision & 0x8000)
+        {
+            LONGLONG llFramesPerSecond = (BYTE) -(char) (dwDivision >> 8);
+            LONGLONG llTicksPerFrame = dwDivision & 0xFF;
+            llTime += llTicks * dwSampleRate * 1000000 / (llFramesPerSecond * llTicksPerFrame);
+        }
+        else
+        {
+            llTime += llTicks * dwTempo * dwSampleRate / dwDivision;
+        }
+        dwLastTick = pEvent->dwTick;
+
+        if ((pEvent->abShort[0] == SMF_META) && (pEvent->pbSysEx == NULL))
+        {
+            dwTempo = pEvent->cbSysEx ? pEvent->cbSysEx : SMF_DEFAULT_TEMPO;
+            continue;
+        }
+        pEvent->llSampleTime = llTime / 1000000;
+        pSong->pEvents[dwOut++] = *pEvent;
+    }
+    pSong->dwEvents = dwOut;
+    pSong->llLength = llTime / 1000000;
+
+    return S_OK;
+}
+
+/*****************************************************************************
+ * SmfStressSong()
+ *****************************************************************************
+ * Build a synthetic song that starts dwNotesPerSecond notes a second for
+ * dwSeconds, on random channels, keys and velocities, each held 0.1 to 2
+ * seconds.  Run against a small voice limit it keeps the synth stealing
+ * voices on nearly every note.  The generator is seeded the same way every
+ * time so runs can be compared.
+ */
+HRESULT SmfStressSong(DWORD dwSampleRate, DWORD dwNotesPerSecond, DWORD dwSeconds, SMFSONG *pSong)
+{
+    DWORD   dwSeed = 0x1234567;
+    DWORD   dwNotes = dwNotesPerSecond * dwSeconds;
+    DWORD   dwChannel;
+    DWORD   dwNote;
+
+    ZeroMemory(pSong, sizeof(SMFSONG));
+
+    // A different program on each channel, so notes spread over the
+    // collection's instruments.
+    for (dwChannel = 0; dwChannel < 16; dwChannel++)
+    {
+        SMFEVENT *pEvent = SmfAddEvent(pSong, 0);
+        if (pEvent == NULL)
+        {
+            SmfFreeSong(pSong);
+            return E_OUTOFMEMORY;
+        }
+        pEvent->abShort[0] = (BYTE) (0xC0 | dwChannel);
+        pEvent->abShort[1] = (BYTE) (dwChannel * 8);
+    }
+
+    for (dwNote = 0; dwNote < dwNotes; dwNote++)
+    {
+        DWORD dwStart = (DWORD) ((ULONGLONG) dwNote * dwSampleRate / dwNotesPerSecond);
+        DWORD dwRandom;
+
+        dwSeed = dwSeed * 1103515245 + 12345;
+        dwRandom = dwSeed >> 8;
+        dwChannel = dwRandom & 0x0F;
+        BYTE bKey = (BYTE) (24 + ((dwRandom >> 4) % 84));
+        BYTE bVelocity = (BYTE) (32 + ((dwRandom >> 12) & 0x5F));
+
+        dwSeed = dwSeed * 1103515245 + 12345;
+        DWORD dwHold = dwSampleRate / 10 + (DWORD) ((ULONGLONG) (dwSeed >> 8) * 19 * dwSampleRate / 10 / 0x1000000);
+
+        SMFEVENT *pOn = SmfAddEvent(pSong, dwStart);
+        SMFEVENT *pOff = pOn ? SmfAddEvent(pSong, dwStart + dwHold) : NULL;
+        if (pOff == NULL)
+        {
+            SmfFreeSong(pSong);
+            return E_OUTOFMEMORY;
+        }
+        pOn = pOff - 1;             // The second add may have moved the list.
+        pOn->abShort[0] = (BYTE) (0x90 | dwChannel);
+        pOn->abShort[1] = bKey;
+        pOn->abShort[2] = bVelocity;
+        pOff->abShort[0] = (BYTE) (0x80 | dwChannel);
+        pOff->abShort[1] = bKey;
+    }
+
+    qsort(pSong->pEvents, pSong->dwEvents, sizeof(SMFEVENT), SmfCompareEvents);
+
+    // Ticks are already samples.
+    for (dwNote = 0; dwNote < pSong->dwEvents; dwNote++)
+    {
+        SMFEVENT *pEvent = &pSong->pEvents[dwNote];
+        pEvent->llSampleTime = pEvent->dwTick;
+        if (pEvent->llSampleTime > pSong->llLength)
+        {
+            pSong->llLength = pEvent->llSampleTime;
+        }
+    }
+
+    return S_OK;
+}
+
+/*****************************************************************************
+ * SmfFreeSong()
+ *****************************************************************************
+ * Free the events and the file image.
+ */
+void SmfFreeSong(SMFSONG *pSong)
+{
+    DWORD dwIndex;
+
+    for (dwIndex = 0; dwIndex < pSong->dwEvents; dwIndex++)
+    {
+        if (pSong->pEvents[dwIndex].pbSysEx)
+        {
+            delete [] pSong->pEvents[dwIndex].pbSysEx;
+        }
+    }
+    if (pSong->pEvents)
+    {
+        delete [] pSong->pEvents;
+    }
+    if (pSong->pbFile)
+    {
+        delete [] pSong->pbFile;
+    }
+    ZeroMemory(pSong, sizeof(SMFSONG));
+}
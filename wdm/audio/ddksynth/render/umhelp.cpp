@@ -0,0 +1,252 @@
+/*
+    Copyright (c) 1998-2000 Microsoft Corporation.  All rights reserved.
+*/
+
+//
+// UmHelp.cpp
+//
+// User-mode versions of the kernhelp.cpp wrappers, for the ddkrender host.
+//
+
+#include "common.h"
+#include <stdarg.h>
+
+/*****************************************************************************
+ * operator new()
+ *****************************************************************************
+ * Allocate zeroed memory, as the kernel allocators in kernhelp.h do.
+ */
+void * __cdecl operator new(size_t iSize)
+{
+    return calloc(1, iSize ? iSize : 1);
+}
+
+void * __cdecl operator new[](size_t iSize)
+{
+    return calloc(1, iSize ? iSize : 1);
+}
+
+/*****************************************************************************
+ * operator delete()
+ *****************************************************************************
+ * Delete function.
+ */
+void __cdecl operator delete(void *pVoid)
+{
+    free(pVoid);
+}
+
+void __cdecl operator delete[](void *pVoid)
+{
+    free(pVoid);
+}
+
+/*****************************************************************************
+ * GetRegValueDword()
+ *****************************************************************************
+ * Convenience function to encapsulate registry reads.  The kernel build
+ * reads the same key, so the SSE2Disabled and MixInterpolation switches
+ * apply to the host too.
+ */
+int GetRegValueDword(LPTSTR RegPath,LPTSTR ValueName,PULONG Value)
+{
+    HKEY    hKey;
+    DWORD   dwType;
+    DWORD   cbValue = sizeof(ULONG);
+    int     ReturnValue = 0;
+
+    if (RegOpenKeyEx(HKEY_LOCAL_MACHINE, RegPath, 0, KEY_QUERY_VALUE, &hKey) != ERROR_SUCCESS)
+    {
+        return 0;
+    }
+    if (RegQueryValueEx(hKey, ValueName, NULL, &dwType, (LPBYTE) Value, &cbValue) == ERROR_SUCCESS)
+    {
+        if (dwType == REG_DWORD && cbValue == sizeof(ULONG))
+        {
+            ReturnValue = 1;
+        }
+    }
+    RegCloseKey(hKey);
+
+    return ReturnValue;
+}
+
+/*****************************************************************************
+ * GetTheCurrentTime()
+ *****************************************************************************
+ * Get the current time, in milliseconds.
+ */
+ULONG GetTheCurrentTime()
+{
+    return timeGetTime();
+}
+
+/*****************************************************************************
+ * struct THREADSTART
+ *****************************************************************************
+ * Carries a kernel-style start routine through CreateThread().
+ */
+typedef struct THREADSTART
+{
+    PKSTART_ROUTINE StartRoutine;
+    PVOID           StartContext;
+} THREADSTART;
+
+static DWORD WINAPI ThreadStart(LPVOID pvParameter)
+{
+    THREADSTART Start = *(THREADSTART *) pvParameter;
+
+    delete (THREADSTART *) pvParameter;
+    Start.StartRoutine(Start.StartContext);
+    return 0;
+}
+
+/*****************************************************************************
+ * KernHelpCreateThread()
+ *****************************************************************************
+ * Start a thread at the priority the render host mixes at.  The handle
+ * stands in for the kernel thread object.
+ */
+PVOID KernHelpCreateThread(PKSTART_ROUTINE StartRoutine, PVOID StartContext)
+{
+    THREADSTART *pStart = new THREADSTART;
+    DWORD       dwThreadId;
+
+    if (pStart == NULL)
+    {
+        return NULL;
+    }
+    pStart->StartRoutine = StartRoutine;
+    pStart->StartContext = StartContext;
+
+    HANDLE hThread = CreateThread(NULL, 0, ThreadStart, pStart, 0, &dwThreadId);
+    if (hThread == NULL)
+    {
+        delete pStart;
+        return NULL;
+    }
+    SetThreadPriority(hThread, GetThreadPriority(GetCurrentThread()));
+    return hThread;
+}
+
+/*****************************************************************************
+ * KernHelpWaitForThread()
+ *****************************************************************************
+ * Wait for the thread to exit and close its handle.
+ */
+VOID KernHelpWaitForThread(PVOID ThreadObject)
+{
+    WaitForSingleObject((HANDLE) ThreadObject, INFINITE);
+    CloseHandle((HANDLE) ThreadObject);
+}
+
+/*****************************************************************************
+ * KernHelpExitThread()
+ *****************************************************************************
+ * Exit the calling thread.
+ */
+VOID KernHelpExitThread()
+{
+    ExitThread(0);
+}
+
+/*****************************************************************************
+ * struct WAVESTORE
+ *****************************************************************************
+ * A temporary file and its mapping, which back a streamed wave.
+ */
+typedef struct WAVESTORE
+{
+    HANDLE  hFile;
+    HANDLE  hMapping;
+    PVOID   pvView;
+} WAVESTORE;
+
+/*****************************************************************************
+ * KernHelpCreateWaveStore()
+ *****************************************************************************
+ * Create a temporary file of Size bytes, deleted when it is closed, and map
+ * it.  Returns the store, and its address in *MappedBase, or NULL.
+ */
+PVOID KernHelpCreateWaveStore(ULONG Size, PVOID *MappedBase)
+{
+    TCHAR       szPath[MAX_PATH];
+    TCHAR       szFile[MAX_PATH];
+    WAVESTORE * pStore;
+
+    *MappedBase = NULL;
+    if (!GetTempPath(MAX_PATH, szPath) ||
+        !GetTempFileName(szPath, TEXT("dls"), 0, szFile))
+    {
+        return NULL;
+    }
+    pStore = new WAVESTORE;
+    if (pStore == NULL)
+    {
+        DeleteFile(szFile);
+        return NULL;
+    }
+    pStore->hFile = CreateFile(szFile, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                               CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                               NULL);
+    if (pStore->hFile == INVALID_HANDLE_VALUE)
+    {
+        DeleteFile(szFile);
+        delete pStore;
+        return NULL;
+    }
+    pStore->hMapping = CreateFileMapping(pStore->hFile, NULL, PAGE_READWRITE, 0, Size, NULL);
+    if (pStore->hMapping != NULL)
+    {
+        pStore->pvView = MapViewOfFile(pStore->hMapping, FILE_MAP_WRITE, 0, 0, Size);
+        if (pStore->pvView == NULL)
+        {
+            CloseHandle(pStore->hMapping);
+        }
+    }
+    if (pStore->pvView == NULL)
+    {
+        CloseHandle(pStore->hFile);
+        delete pStore;
+        return NULL;
+    }
+
+    *MappedBase = pStore->pvView;
+    return pStore;
+}
+
+/*****************************************************************************
+ * KernHelpDeleteWaveStore()
+ *****************************************************************************
+ * Unmap the store, which deletes its file.
+ */
+VOID KernHelpDeleteWaveStore(PVOID Store)
+{
+    WAVESTORE *pStore = (WAVESTORE *) Store;
+
+    UnmapViewOfFile(pStore->pvView);
+    CloseHandle(pStore->hMapping);
+    CloseHandle(pStore->hFile);
+    delete pStore;
+}
+
+#if DBG
+/*****************************************************************************
+ * DbgTrace()
+ *****************************************************************************
+ * Print trace output from the synth core to the debugger.
+ */
+void DbgTrace(int nLevel, LPSTR pszFormat, ...)
+{
+    char    szBuffer[256];
+    va_list va;
+
+    va_start(va, pszFormat);
+    _vsnprintf(szBuffer, sizeof(szBuffer) - 1, pszFormat, va);
+    va_end(va);
+    szBuffer[sizeof(szBuffer) - 1] = 0;
+
+    OutputDebugStringA(szBuffer);
+}
+#endif // DBG
@@ -0,0 +1,154 @@
+/*
+    Copyright (c) 1998-2000 Microsoft Corporation.  All rights reserved.
+*/
+
+//
+// UmHelp.h
+//
+// User-mode stand-ins for the kernel services used by the synth core, so
+// that csynth.cpp, instr.cpp, voice.cpp and friends build unchanged into
+// the ddkrender host.  This replaces both the kernel headers and kernhelp.h.
+//
+
+#ifndef _UmHelp_
+#define _UmHelp_
+
+#include <windows.h>
+#include <mmsystem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <dmerror.h>        // Error codes
+#include <dmdls.h>          // DLS definitions
+
+// muldiv32.h supplies its own MulDiv; keep it from colliding with kernel32's.
+//
+#define MulDiv DDKSynthMulDiv
+
+// Kernel status codes
+//
+typedef LONG NTSTATUS;
+#ifndef NT_SUCCESS
+#define NT_SUCCESS(Status)  ((NTSTATUS)(Status) >= 0)
+#endif
+#ifndef STATUS_SUCCESS
+#define STATUS_SUCCESS      ((NTSTATUS)0x00000000L)
+#endif
+
+#define PAGED_CODE()
+
+// Spin locks become critical sections; there is no IRQL in user mode.
+//
+typedef CRITICAL_SECTION KSPIN_LOCK;
+typedef UCHAR KIRQL;
+
+#define KeInitializeSpinLock(pLock)         InitializeCriticalSection(pLock)
+#define KeAcquireSpinLock(pLock,pOldIrql)   (EnterCriticalSection(pLock), *(pOldIrql) = 0)
+#define KeReleaseSpinLock(pLock,OldIrql)    LeaveCriticalSection(pLock)
+
+// The OS saves FPU and XMM state for user threads.
+//
+typedef struct _KFLOATING_SAVE
+{
+    ULONG   Dummy;
+} KFLOATING_SAVE, *PKFLOATING_SAVE;
+
+#define KeSaveFloatingPointState(pSave)     STATUS_SUCCESS
+#define KeRestoreFloatingPointState(pSave)
+
+#define ExIsProcessorFeaturePresent(Feature) IsProcessorFeaturePresent(Feature)
+
+// Events are Win32 auto-reset events; the parallel mixer only uses
+// SynchronizationEvent objects.  They are closed when the process exits.
+//
+typedef HANDLE KEVENT;
+
+#define KeInitializeEvent(pEvent,Type,State)    (*(pEvent) = CreateEvent(NULL, FALSE, State, NULL))
+#define KeSetEvent(pEvent,Increment,Wait)       SetEvent(*(pEvent))
+#define KeWaitForSingleObject(pObject,Reason,Mode,Alertable,pTimeout) \
+                                                WaitForSingleObject(*(pObject), INFINITE)
+
+typedef VOID (NTAPI *PKSTART_ROUTINE)(PVOID StartContext);
+
+// Pool types are accepted and ignored by the allocators below.
+//
+typedef enum _POOL_TYPE
+{
+    NonPagedPool,
+    PagedPool
+} POOL_TYPE;
+
+// Same interface as kernhelp.h.
+//
+int GetRegValueDword(LPTSTR RegPath,LPTSTR ValueName,PULONG Value);
+
+ULONG GetTheCurrentTime();
+
+PVOID KernHelpCreateThread(PKSTART_ROUTINE StartRoutine, PVOID StartContext);
+VOID  KernHelpWaitForThread(PVOID ThreadObject);
+VOID  KernHelpExitThread();
+
+PVOID KernHelpCreateWaveStore(ULONG Size, PVOID *MappedBase);
+VOID  KernHelpDeleteWaveStore(PVOID Store);
+
+/*****************************************************************************
+ * operator new
+ *****************************************************************************
+ * The kernel allocators in kernhelp.h zero their memory, and the synth
+ * relies on it.  The global operator new in umhelp.cpp does the same, these
+ * accept the pool type and tag used by the kernel build.
+ */
+inline PVOID operator new
+(
+    size_t      iSize,
+    POOL_TYPE   poolType
+)
+{
+    return ::operator new(iSize);
+}
+
+inline PVOID operator new
+(
+    size_t      iSize,
+    POOL_TYPE   poolType,
+    ULONG       tag
+)
+{
+    return ::operator new(iSize);
+}
+
+inline PVOID operator new[]
+(
+    size_t      iSize,
+    POOL_TYPE   poolType,
+    ULONG       tag
+)
+{
+    return ::operator new(iSize);
+}
+
+// The synth core calls RefTimeToSample() on the sink it is handed in
+// PlayBuffer(); the host implements this with its own notion of time.
+//
+struct ISynthSinkDMus
+{
+    virtual HRESULT RefTimeToSample(REFERENCE_TIME rtTime, LONGLONG *pllSampleTime) = 0;
+};
+
+// Debug trace facility
+//
+#if DBG
+#define Trace   DbgTrace
+void DbgTrace(int nLevel, LPSTR pszFormat, ...);
+#else
+#define Trace
+#endif
+
+#define ASSERT assert
+
+// Paramter validation unused
+//
+#define V_INAME(x)
+#define V_BUFPTR_READ(p,cb)
+
+#endif // _UmHelp_
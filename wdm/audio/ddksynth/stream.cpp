@@ -0,0 +1,318 @@
+//      Stream.cpp
+//      Copyright (c) 1996-2000 Microsoft Corporation.  All Rights Reserved.
+//
+//      Prefetch buffers for voices playing streamed waves.  See the notes
+//      above STREAM_BLOCK_SHIFT in synth.h.
+//
+//      The render thread attaches a stream when a voice starts and detaches
+//      it when the voice is retired.  The mix, on the render thread or a mix
+//      worker, calls GetBlock() as the voice reaches each block.  The stream
+//      thread calls Fill().  Slots change hands through interlocked tags, so
+//      none of this takes the synth's critical section:
+//
+//      The mix publishes the slot it is about to read in m_lMixSlot and then
+//      checks the slot's tag.  The stream thread sets a slot's tag to
+//      STREAM_FILLING and then checks m_lMixSlot.  Both are interlocked, so
+//      at least one of them sees the other and a slot is never refilled
+//      while it is mixed.
+
+#include "common.h"
+
+#define STR_MODULENAME "DDKSynth.sys:Stream: "
+
+
+#pragma code_seg()
+/*****************************************************************************
+ * CWaveStream::CWaveStream()
+ *****************************************************************************
+ * Constructor for the stream.
+ */
+CWaveStream::CWaveStream()
+{
+    DWORD dwSlot;
+
+    m_lState = STREAM_FREE;
+    m_pWave = NULL;
+    m_pbSlots = NULL;
+    m_dwSlotBytes = (STREAM_BLOCK + (STREAM_GUARD << 1)) * sizeof(short);
+    m_dwLoopStart = 0;
+    m_dwLoopEnd = 0;
+    m_fOneShot = TRUE;
+    m_lCursor = 0;
+    m_lMixSlot = STREAM_NO_BLOCK;
+    for (dwSlot = 0; dwSlot < STREAM_SLOTS; dwSlot++)
+    {
+        m_alBlock[dwSlot] = STREAM_NO_BLOCK;
+    }
+}
+
+/*****************************************************************************
+ * CWaveStream::~CWaveStream()
+ *****************************************************************************
+ * Destructor for the stream.  The synth releases the wave first.
+ */
+CWaveStream::~CWaveStream()
+{
+    ASSERT(m_pWave == NULL);
+    if (m_pbSlots)
+    {
+        delete [] m_pbSlots;
+    }
+}
+
+/*****************************************************************************
+ * CWaveStream::Init()
+ *****************************************************************************
+ * Allocate the slots.  They are read by the mix, so they are nonpaged.
+ */
+HRESULT CWaveStream::Init()
+{
+    if (m_pbSlots == NULL)
+    {
+        m_pbSlots = new(NonPagedPool,'RSmD') BYTE[m_dwSlotBytes * STREAM_SLOTS]; //  DmSR
+        if (m_pbSlots == NULL)
+        {
+            return E_OUTOFMEMORY;
+        }
+    }
+    return S_OK;
+}
+
+/*****************************************************************************
+ * CWaveStream::Attach()
+ *****************************************************************************
+ * Start streaming the wave for a voice, from its beginning.  Called on the
+ * render thread with the stream free.
+ */
+void CWaveStream::Attach(CWave *pWave, DWORD dwLoopStart, DWORD dwLoopEnd, BOOL fOneShot)
+{
+    DWORD dwSlot;
+
+    ASSERT(m_lState == STREAM_FREE);
+    m_pWave = pWave;
+    m_pWave->AddRef();
+    m_dwLoopStart = dwLoopStart;
+    m_dwLoopEnd = dwLoopEnd;
+    m_fOneShot = fOneShot || (dwLoopEnd <= dwLoopStart);
+    m_lCursor = 0;
+    m_lMixSlot = STREAM_NO_BLOCK;
+    for (dwSlot = 0; dwSlot < STREAM_SLOTS; dwSlot++)
+    {
+        m_alBlock[dwSlot] = STREAM_NO_BLOCK;
+    }
+    InterlockedExchange(&m_lState, STREAM_ACTIVE);
+}
+
+/*****************************************************************************
+ * CWaveStream::Detach()
+ *****************************************************************************
+ * The voice is done with the stream.  If the stream thread is filling it,
+ * leave it CLOSING; the stream thread marks it CLOSED and the render thread
+ * releases it after the next mix.
+ */
+void CWaveStream::Detach()
+{
+    for (;;)
+    {
+        if (InterlockedCompareExchange(&m_lState, STREAM_CLOSED, STREAM_ACTIVE) == STREAM_ACTIVE)
+        {
+            Release();
+            return;
+        }
+        if (InterlockedCompareExchange(&m_lState, STREAM_CLOSING, STREAM_BUSY) == STREAM_BUSY)
+        {
+            return;
+        }
+    }
+}
+
+/*****************************************************************************
+ * CWaveStream::Release()
+ *****************************************************************************
+ * Release the wave of a CLOSED stream and free the stream.  Called on the
+ * render thread, which owns the wave reference counts.
+ */
+void CWaveStream::Release()
+{
+    ASSERT(m_lState == STREAM_CLOSED);
+    if (m_pWave)
+    {
+        m_pWave->Release();
+        m_pWave = NULL;
+    }
+    InterlockedExchange(&m_lState, STREAM_FREE);
+}
+
+/*****************************************************************************
+ * CWaveStream::NextBlock()
+ *****************************************************************************
+ * The block played after lBlock: the next one, or the loop start from the
+ * last block of the loop.  STREAM_NO_BLOCK past the end of a one shot.
+ */
+LONG CWaveStream::NextBlock(LONG lBlock)
+{
+    if (!m_fOneShot && (lBlock == (LONG) ((m_dwLoopEnd - 1) >> STREAM_BLOCK_SHIFT)))
+    {
+        return (LONG) (m_dwLoopStart >> STREAM_BLOCK_SHIFT);
+    }
+    if ((((DWORD) lBlock + 1) << STREAM_BLOCK_SHIFT) >= m_pWave->m_dwSampleLength)
+    {
+        return STREAM_NO_BLOCK;
+    }
+    return lBlock + 1;
+}
+
+/*****************************************************************************
+ * CWaveStream::GetBlock()
+ *****************************************************************************
+ * Called by the mix as the voice enters a block.  Returns the address of
+ * the block's first sample, or NULL if it hasn't been read in yet.  Blocks
+ * in the resident head are always there.
+ */
+short * CWaveStream::GetBlock(DWORD dwBlock)
+{
+    DWORD dwSlot;
+    DWORD dwShift = (m_pWave->m_bSampleType & SFORMAT_16) ? 1 : 0;
+
+    InterlockedExchange(&m_lCursor, (LONG) dwBlock);
+    if (dwBlock < STREAM_HEAD_BLOCKS)
+    {
+        return (short *) ((BYTE *) m_pWave->m_pnHead + ((dwBlock << STREAM_BLOCK_SHIFT) << dwShift));
+    }
+    for (dwSlot = 0; dwSlot < STREAM_SLOTS; dwSlot++)
+    {
+        if (m_alBlock[dwSlot] == (LONG) dwBlock)
+        {
+            InterlockedExchange(&m_lMixSlot, (LONG) dwSlot);
+            if (m_alBlock[dwSlot] == (LONG) dwBlock)
+            {
+                return (short *) (m_pbSlots + (dwSlot * m_dwSlotBytes) + (STREAM_GUARD << dwShift));
+            }
+        }
+    }
+    return NULL;
+}
+
+/*****************************************************************************
+ * CWaveStream::FillSlot()
+ *****************************************************************************
+ * Read lBlock and its guard samples from the wave store into a slot, unless
+ * the mix is reading the slot.  Samples beyond either end of the wave are
+ * silence.  Runs on the stream thread, below DISPATCH_LEVEL, since the
+ * store is pageable.
+ */
+void CWaveStream::FillSlot(DWORD dwSlot, LONG lBlock)
+{
+    LONG    lOld = m_alBlock[dwSlot];
+    DWORD   dwShift = (m_pWave->m_bSampleType & SFORMAT_16) ? 1 : 0;
+    BYTE *  pbSlot = m_pbSlots + (dwSlot * m_dwSlotBytes);
+    LONG    lFirst = (lBlock << STREAM_BLOCK_SHIFT) - STREAM_GUARD;
+    LONG    lCount = STREAM_BLOCK + (STREAM_GUARD << 1);
+    LONG    lLength = (LONG) m_pWave->m_dwSampleLength;
+
+    if ((lOld == STREAM_FILLING) ||
+        (InterlockedCompareExchange(&m_alBlock[dwSlot], STREAM_FILLING, lOld) != lOld))
+    {
+        return;
+    }
+    if (m_lMixSlot == (LONG) dwSlot)
+    {
+        InterlockedExchange(&m_alBlock[dwSlot], lOld);
+        return;
+    }
+
+    RtlZeroMemory(pbSlot, m_dwSlotBytes);
+    if (lFirst < 0)
+    {
+        pbSlot += (-lFirst) << dwShift;
+        lCount += lFirst;
+        lFirst = 0;
+    }
+    if (lFirst + lCount > lLength)
+    {
+        lCount = lLength - lFirst;
+    }
+    if (lCount > 0)
+    {
+        RtlCopyMemory(pbSlot, (BYTE *) m_pWave->m_pnWave + (lFirst << dwShift), lCount << dwShift);
+    }
+    InterlockedExchange(&m_alBlock[dwSlot], lBlock);
+}
+
+/*****************************************************************************
+ * CWaveStream::Fill()
+ *****************************************************************************
+ * Read in the blocks the voice will play next, in the order it will play
+ * them, reusing slots that hold blocks it won't.  Called by the stream
+ * thread with the stream BUSY.
+ */
+void CWaveStream::Fill()
+{
+    LONG    alWanted[STREAM_SLOTS];
+    DWORD   dwWanted = 0;
+    DWORD   dwStep;
+    DWORD   dwIndex;
+    DWORD   dwSlot;
+    LONG    lBlock = m_lCursor;
+
+    // Blocks in the resident head are passed over.  A loop shorter than
+    // the slots comes round again; stop when it does.
+    for (dwStep = 0; (dwStep < STREAM_SLOTS + STREAM_HEAD_BLOCKS) && (dwWanted < STREAM_SLOTS); dwStep++)
+    {
+        if (lBlock >= STREAM_HEAD_BLOCKS)
+        {
+            for (dwIndex = 0; dwIndex < dwWanted; dwIndex++)
+            {
+                if (alWanted[dwIndex] == lBlock)
+                {
+                    break;
+                }
+            }
+            if (dwIndex < dwWanted)
+            {
+                break;
+            }
+            alWanted[dwWanted++] = lBlock;
+        }
+        lBlock = NextBlock(lBlock);
+        if (lBlock == STREAM_NO_BLOCK)
+        {
+            break;
+        }
+    }
+
+    for (dwIndex = 0; dwIndex < dwWanted; dwIndex++)
+    {
+        lBlock = alWanted[dwIndex];
+        for (dwSlot = 0; dwSlot < STREAM_SLOTS; dwSlot++)
+        {
+            if (m_alBlock[dwSlot] == lBlock)
+            {
+                break;
+            }
+        }
+        if (dwSlot < STREAM_SLOTS)
+        {
+            continue;   // Already in.
+        }
+        for (dwSlot = 0; dwSlot < STREAM_SLOTS; dwSlot++)
+        {
+            DWORD dwCheck;
+            for (dwCheck = 0; dwCheck < dwWanted; dwCheck++)
+            {
+                if (m_alBlock[dwSlot] == alWanted[dwCheck])
+                {
+                    break;
+                }
+            }
+            if (dwCheck == dwWanted)
+            {
+                FillSlot(dwSlot, lBlock);
+                if (m_alBlock[dwSlot] == lBlock)
+                {
+                    break;
+                }
+            }
+        }
+    }
+}
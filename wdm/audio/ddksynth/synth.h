@@ -176,9 +176,33 @@
 */
 #define SFORMAT_16              1       // Sixteen bit sample.
 #define SFORMAT_8               2       // Eight bit sample.
-#define SPLAY_MMX               0x10    // Use MMX processor (16 bit only).
+#define SPLAY_SSE2              0x20    // Use SSE2 interpolation and mix kernels.
 #define SPLAY_STEREO            0x40    // Stereo output.
 
+/*  SSE2 kernels are intrinsics and build for both x86 and x64.
+*/
+#if defined(_X86_) || defined(_AMD64_)
+#define SSE2_ENABLED    1
+#endif
+
+/*  Interpolation used to read samples between wave points.  Linear uses
+    the full 12 bit fraction of the sample position; cubic and sinc use
+    tables of INTERP_PHASES filters, indexed by the top 8 bits of it.
+*/
+#define MIX_INTERP_LINEAR       0       // Two point linear.
+#define MIX_INTERP_CUBIC        1       // Four point Catmull-Rom.
+#define MIX_INTERP_SINC         2       // Eight point windowed sinc.
+#define MIX_INTERP_COUNT        3
+
+#define INTERP_PHASES           256
+#define INTERP_PHASE_SHIFT      4       // 12 bit fraction to 8 bit phase.
+#define INTERP_COEFF_SHIFT      14      // Filter taps are 2.14 fixed point.
+#define CUBIC_TAPS              4
+#define SINC_TAPS               8
+
+#define MIX_SPAN                64      // Samples interpolated per kernel call.
+#define MIX_BUS_LENGTH          1024    // Sample frames mixed per pass of the bus.
+
 
 /*  For internal representation, volume is stored in Volume Cents, 
     where each increment represents 1/100 of a dB.
@@ -328,6 +352,8 @@ public:
     WORD            m_wPlayCount;       // Wave is currently being played.
     BYTE            m_bSampleType;
     DMUS_DOWNLOADINFO * m_pWaveMem;
+    PVOID           m_pvStore;          // Wave store, if streamed.  m_pnWave is in it.
+    short *         m_pnHead;           // Resident start of a streamed wave.
 };
 
 /*****************************************************************************
@@ -344,6 +370,74 @@ public:
 };
 
 
+/*  Streaming.  A wave longer than the stream threshold is downloaded into
+    a wave store, a file mapped into system space, and only its first
+    STREAM_HEAD_BLOCKS blocks are kept resident.  A voice playing it borrows
+    a CWaveStream from the synth, whose slots hold the next blocks in
+    playback order.  The synth's stream thread fills them from the store
+    after each mix, and the mix reads each block in place, rebasing the
+    wave pointer the way BeforeBigSampleMix() does.  A block that isn't in
+    yet is mixed as silence and counted as an underrun.
+
+    Every slot holds STREAM_GUARD samples either side of its block, so the
+    interpolation taps never leave the slot.
+*/
+#define STREAM_BLOCK_SHIFT  12                  // 4096 sample blocks.
+#define STREAM_BLOCK        (1 << STREAM_BLOCK_SHIFT)
+#define STREAM_GUARD        8                   // Samples either side of a block.
+#define STREAM_SLOTS        4                   // Blocks buffered for each voice.
+#define STREAM_HEAD_BLOCKS  4                   // Blocks resident at the start of a wave.
+#define STREAM_HEAD_LENGTH  ((STREAM_HEAD_BLOCKS << STREAM_BLOCK_SHIFT) + STREAM_GUARD)
+#define MAX_STREAMS         32                  // Streamed voices playing at once.
+
+#define STREAM_NO_BLOCK     (-1)                // Slot empty, or no next block.
+#define STREAM_FILLING      (-2)                // Slot being filled.
+
+// CWaveStream states.  The render thread attaches and detaches streams,
+// the stream thread fills ACTIVE ones.  A stream detached while it is being
+// filled is left CLOSING, and the stream thread marks it CLOSED for the
+// render thread to release.
+//
+#define STREAM_FREE         0
+#define STREAM_ACTIVE       1
+#define STREAM_BUSY         2
+#define STREAM_CLOSING      3
+#define STREAM_CLOSED       4
+
+/*****************************************************************************
+ * class CWaveStream
+ *****************************************************************************
+ * Prefetch buffer for one voice playing a streamed wave.
+ */
+class CWaveStream
+{
+public:
+                    CWaveStream();
+                    ~CWaveStream();
+    HRESULT         Init();
+    void            Attach(CWave *pWave, DWORD dwLoopStart, DWORD dwLoopEnd, BOOL fOneShot);
+    void            Detach();
+    void            Release();
+    void            Fill();
+    short *         GetBlock(DWORD dwBlock);
+
+    volatile LONG   m_lState;           // STREAM_FREE etc.
+
+private:
+    LONG            NextBlock(LONG lBlock);
+    void            FillSlot(DWORD dwSlot, LONG lBlock);
+
+    CWave *         m_pWave;            // Wave being streamed, referenced.
+    BYTE *          m_pbSlots;          // STREAM_SLOTS slots, nonpaged.
+    DWORD           m_dwSlotBytes;      // Bytes per slot, for 16 bit samples.
+    DWORD           m_dwLoopStart;      // Loop, in samples.
+    DWORD           m_dwLoopEnd;
+    BOOL            m_fOneShot;
+    volatile LONG   m_alBlock[STREAM_SLOTS];    // Block in each slot, or STREAM_NO_BLOCK.
+    volatile LONG   m_lCursor;          // Block the mix is playing.
+    volatile LONG   m_lMixSlot;         // Slot the mix is reading, not to be refilled.
+};
+
 /*****************************************************************************
  * class CSourceSample
  *****************************************************************************
@@ -403,6 +497,8 @@ public:
     BYTE        m_bAllowOverlap;            // Allow overlapping of note.
     BYTE        m_bKeyHigh;                 // Upper note value for region.
     BYTE        m_bKeyLow;                  // Lower note value.
+    BYTE        m_bVelocityHigh;            // Upper velocity value for region.
+    BYTE        m_bVelocityLow;             // Lower velocity value.
     BYTE        m_bGroup;                   // Logical group (for drums.)
 };
 
@@ -429,8 +525,13 @@ public:
  * The CInstrument can be either a Drum or a Melodic instrument.
  * If a drum, it has up to 128 pairings of articulations and
  * regions. If melodic, all regions share the same articulation.
- * ScanForRegion is called by ControlLogic to get the region
+ * ScanForRegion is called by CInstManager::GetInstrument to get the region
  * that corresponds to a note.
+ *
+ * BuildKeyTable() indexes the regions by key once the instrument
+ * is downloaded, so finding a note's region does not walk the
+ * region list.  A key usually has one region; when regions are
+ * layered by velocity, its entry lists each of them in list order.
  */
 class CInstrument : public CListItem
 {
@@ -444,12 +545,15 @@ public:
         {return(CInstrument *)CListItem::GetNext();};
 
     void            SetSampleRate(DWORD dwSampleRate);
-    CSourceRegion * ScanForRegion(DWORD dwNoteValue);
+    CSourceRegion * ScanForRegion(DWORD dwNoteValue, DWORD dwVelocity);
+    HRESULT         BuildKeyTable();
     HRESULT         LoadRegions( BYTE *p, BYTE *pEnd, DWORD dwSampleRate);
     HRESULT         Load( BYTE *p, BYTE *pEnd, DWORD dwSampleRate);
     
     CSourceRegionList m_RegionList;         // Linked list of regions.
     DWORD             m_dwProgram;          // Which program change it represents.
+    CSourceRegion **  m_ppKeyRegions;       // Regions by key, from BuildKeyTable().
+    DWORD             m_adwKeyIndex[129];   // Key n's regions start at m_ppKeyRegions[m_adwKeyIndex[n]].
 };
 
 /*****************************************************************************
@@ -473,13 +577,20 @@ public:
  * Manages the instruments, including sample rates, downloads, and waves.
  * Utilizes a hash scheme for quick location of waves and instruments 
  * (they can become numerous).
+ *
+ * GetInstrument() is called on every note on, from the mix, and takes no
+ * lock.  Instruments are linked into and unlinked from the hash lists
+ * only while holding *m_pMixLock, the synth's critical section, which the
+ * mix holds throughout; so the mix never sees a half built instrument or
+ * one being freed.
  */
 class CInstManager 
 {
 public:
                     CInstManager();
                     ~CInstManager();
-    CInstrument *   GetInstrument(DWORD dwPatch,DWORD dwKey);
+    CInstrument *   GetInstrument(DWORD dwPatch,DWORD dwKey,DWORD dwVelocity,
+                                  CSourceRegion **ppRegion);
     void            Verify();           // Verifies that the data is valid.
     void            SetSampleRate(DWORD dwSampleRate);
     HRESULT         Download(LPHANDLE phDownload, 
@@ -497,7 +608,8 @@ private:
     HRESULT         DownloadWave(LPHANDLE phDownload,
                                 DMUS_DOWNLOADINFO *pInfo, 
                                 void *pvOffsetTable[], 
-                                void *pvData);
+                                void *pvData,
+                                LPBOOL pbFree);
     
     CInstrumentList m_InstrumentList[INSTRUMENT_HASH_SIZE];
     CWavePool       m_WavePool[WAVE_HASH_SIZE];
@@ -505,38 +617,25 @@ private:
     DWORD           m_dwSampleRate;     // Sample rate requested by app.
 
 public:
+    CRITICAL_SECTION * m_pMixLock;      // Held by the mix; guards the instrument lists.
+    DWORD           m_dwStreamThreshold;    // Longer waves are streamed, 0 for none.
     CRITICAL_SECTION m_CriticalSection; // Critical section to manage access.
     BOOL            m_fCSInitialized;   
 };
 
 /*****************************************************************************
- * class CMIDIData
+ * struct MIDIEVENT
  *****************************************************************************
  * Represents a single MIDI event.
  */
-class CMIDIData : public CListItem 
+typedef struct MIDIEVENT
 {
-public:
-                CMIDIData();
-    CMIDIData *  GetNext()  {return (CMIDIData *)CListItem::GetNext();};
-    
-    STIME       m_stTime;   // Time this event was recorded.
-    long        m_lData;    // Data stored in event.            
-};
+    STIME       stTime;     // Time this event was recorded.
+    long        lData;      // Data stored in event.
+} MIDIEVENT;
 
-/*****************************************************************************
- * class CMIDIDataList
- *****************************************************************************
- * Implements a list of CMIDIData objects.
- */
-class CMIDIDataList : public CList
-{
-public:
-    CMIDIData *GetHead()    {return (CMIDIData *)CList::GetHead();};
-    CMIDIData *RemoveHead() {return (CMIDIData *)CList::RemoveHead();};
-};
-
-#define MAX_MIDI_EVENTS     1000
+#define MIDI_NOTE_EVENTS    256     // Initial queue size for notes, a power of 2.
+#define MIDI_CONTROL_EVENTS 64      // Initial queue size for each controller.
 
 /*****************************************************************************
  * class CMIDIRecorder
@@ -548,52 +647,45 @@ public:
  * each of them may reliably manage MIDI events
  * coming in.
  *
- * CMIDIRecorder uses a linked list of CMIDIData
- * structures to keep track of the changes within
- * the time slice.
- *
- * Allocation and freeing of the CMIDIData events 
- * is kept fast and efficient because they are
- * always pulled from the static pool m_pFreeList,
- * which is really a list of events pulled directly
- * from the static array m_sEventBuffer. This is
- * safe because we can make the assumption that
- * the maximum MIDI rate is 1000 events per second.
- * Since we are managing time slices of roughly
- * 1/16 of a second, a buffer of 100 events would
- * be overkill.
+ * Each recorder keeps its events in its own ring
+ * of MIDIEVENTs, sorted by time, allocated by Init()
+ * when the CControlLogic is set up.  MIDI almost
+ * always arrives in time order, so recording is an
+ * append at the tail, and a late event only moves
+ * the few events after it.  Events are consumed from
+ * the head, and GetData() finds its value with a
+ * binary search.  The ring doubles if a burst fills
+ * it.
  *
- * Although CMIDIRecorder is subclassed to several 
- * different event types, they all share the one
- * static free list. 
+ * There is no lock.  Recording and flushing happen
+ * in CSynth::PlayBuffer() and consuming in
+ * CSynth::Mix(), which hold the synth's critical
+ * section; the parallel mix workers only call
+ * GetData(), while the render thread waits for them.
  */
 class CMIDIRecorder
 {
 public:
                 CMIDIRecorder();
-                ~CMIDIRecorder();        // Be sure to clear local list.
-    void        Init();                  // Inits the free list.
-    static void InitTables();
+                ~CMIDIRecorder();
+    HRESULT     Init(DWORD dwEvents = MIDI_CONTROL_EVENTS); // Allocates the ring.
     BOOL        FlushMIDI(STIME stTime); // Clear after time stamp.
     BOOL        ClearMIDI(STIME stTime); // Clear up to time stamp.
     BOOL        RecordMIDI(STIME stTime, long lData); // MIDI input goes here.
     long        GetData(STIME stTime);   // Gets data at time.
     static VREL VelocityToVolume(WORD nVelocity);
 
-    static CMIDIDataList * m_sFreeList;  // Free list of events.
-
 protected:
-    void        GrabSpinLock();
-    void        ReleaseSpinLock();
-
-    CMIDIDataList m_EventList;           // This recorder's list.
+    MIDIEVENT * GetEvent(DWORD dwIndex) {return &m_pEvents[(m_dwHead + dwIndex) & m_dwMask];};
+    DWORD       FindAfter(STIME stTime); // Index of the first event after stTime.
+    BOOL        Grow();
+
+    MIDIEVENT *   m_pEvents;             // Ring of events, oldest at m_dwHead.
+    DWORD         m_dwMask;              // Ring size - 1.
+    DWORD         m_dwHead;              // Ring index of the oldest event.
+    DWORD         m_dwCount;             // Events queued.
     STIME         m_stCurrentTime;       // Time for current value.
     long          m_lCurrentData;        // Current value.
-
-private:
-    KSPIN_LOCK    m_SpinLock;
-    KIRQL         m_OldIrql;
-
 };
 
 /*****************************************************************************
@@ -852,6 +944,34 @@ private:
  * change in volume and pitch.
  */
 
+/*  Mix kernels.  An interpolator fills pnOut with dwCount samples read
+    from the wave at pfSamplePos, pfSamplePos + pfPitch, ..., scaled to
+    sixteen bits whatever the wave format.  An accumulator scales those
+    samples by the volume and adds them into the 32 bit mix bus.
+*/
+typedef void (*PFNINTERPOLATE)(short *pnOut, void *pvWave,
+                               PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount);
+typedef void (*PFNACCUMULATE)(long *plBuffer, short *pnSamples, DWORD dwCount,
+                              VFRACT vfLVolume, VFRACT vfRVolume);
+
+extern const short asCubicTable[INTERP_PHASES][CUBIC_TAPS];
+extern const short asSincTable[INTERP_PHASES][SINC_TAPS];
+
+// Kernel tables in mix.cpp, [SSE2][eight bit][interpolation] and [SSE2][stereo].
+extern const PFNINTERPOLATE apfnInterpolate[2][2][MIX_INTERP_COUNT];
+extern const PFNACCUMULATE apfnAccumulate[2][2];
+
+#ifdef SSE2_ENABLED
+void InterpolateLinear8SSE2(short *pnOut, void *pvWave, PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount);
+void InterpolateLinear16SSE2(short *pnOut, void *pvWave, PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount);
+void InterpolateCubic8SSE2(short *pnOut, void *pvWave, PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount);
+void InterpolateCubic16SSE2(short *pnOut, void *pvWave, PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount);
+void InterpolateSinc8SSE2(short *pnOut, void *pvWave, PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount);
+void InterpolateSinc16SSE2(short *pnOut, void *pvWave, PFRACT pfSamplePos, PFRACT pfPitch, DWORD dwCount);
+void AccumulateMonoSSE2(long *plBuffer, short *pnSamples, DWORD dwCount, VFRACT vfLVolume, VFRACT vfRVolume);
+void AccumulateStereoSSE2(long *plBuffer, short *pnSamples, DWORD dwCount, VFRACT vfLVolume, VFRACT vfRVolume);
+#endif // SSE2_ENABLED
+
 #define MAX_SAMPLE  4095
 #define MIN_SAMPLE  (-4096)
 
@@ -868,53 +988,32 @@ public:
                     CSourceSample *pSample,
                     VREL vrBaseLVolume, VREL vrBaseRVolume,
                     PREL prBasePitch, long lKey);
-    BOOL        Mix(short *pBuffer,DWORD dwLength,
+    BOOL        Mix(long *plBuffer,DWORD dwLength,
                     VREL dwVolumeL, VREL dwVolumeR, PREL dwPitch,
                     DWORD dwStereo);
     void        ClearVoice();
     static PFRACT PRELToPFRACT(PREL prPitch); // Pitch cents to pitch.
 
 private:
-    DWORD       Mix8(short * pBuffer, DWORD dwLength,DWORD dwDeltaPeriod,
+    DWORD       MixSpans(long *plBuffer, DWORD dwLength, DWORD dwDeltaPeriod,
                     VFRACT vfDeltaLVolume, VFRACT vfDeltaRVolume,
-                    PFRACT pfDeltaPitch, 
-                    PFRACT pfSampleLength, PFRACT pfLoopLength);
-    DWORD       MixMono8(short * pBuffer, DWORD dwLength,DWORD dwDeltaPeriod,
-                    VFRACT vfDeltaVolume, 
-                    PFRACT pfDeltaPitch, 
-                    PFRACT pfSampleLength, PFRACT pfLoopLength);
-    DWORD       Mix16(short * pBuffer, DWORD dwLength, DWORD dwDeltaPeriod,
-                    VFRACT vfDeltaLVolume, VFRACT vfDeltaRVolume,
-                    PFRACT pfDeltaPitch, 
-                    PFRACT pfSampleLength, PFRACT pfLoopLength);
-    DWORD       MixMono16(short * pBuffer, DWORD dwLength,DWORD dwDeltaPeriod,
-                    VFRACT vfDeltaVolume, 
-                    PFRACT pfDeltaPitch, 
-                    PFRACT pfSampleLength, PFRACT pfLoopLength);
-    DWORD _cdecl Mix8X(short * pBuffer, DWORD dwLength, DWORD dwDeltaPeriod,
-                     VFRACT vfDeltaLVolume, VFRACT vfDeltaRVolume,
-                     PFRACT pfDeltaPitch, 
-                     PFRACT pfSampleLength, PFRACT pfLoopLength);
-    DWORD _cdecl Mix16X(short * pBuffer, DWORD dwLength, DWORD dwDeltaPeriod,
-                     VFRACT vfDeltaLVolume, VFRACT vfDeltaRVolume,
-                     PFRACT pfDeltaPitch, 
-                     PFRACT pfSampleLength, PFRACT pfLoopLength);
-    DWORD       MixMono16X(short * pBuffer, DWORD dwLength,DWORD dwDeltaPeriod,
-                    VFRACT vfDeltaVolume, 
-                    PFRACT pfDeltaPitch, 
-                    PFRACT pfSampleLength, PFRACT pfLoopLength);
-    DWORD       MixMono8X(short * pBuffer, DWORD dwLength,DWORD dwDeltaPeriod,
-                    VFRACT vfDeltaVolume, 
-                    PFRACT pfDeltaPitch, 
-                    PFRACT pfSampleLength, PFRACT pfLoopLength);
+                    PFRACT pfDeltaPitch,
+                    PFRACT pfSampleLength, PFRACT pfLoopLength,
+                    DWORD dwMixChoice, DWORD dwInterpolation);
+    short       InterpolateEdge(PFRACT pfSamplePos, DWORD dwInterpolation,
+                    long lFirst, long lLast);
     void        BeforeBigSampleMix();
     void        AfterBigSampleMix();
+    BOOL        MixStreamed(long *plBuffer, DWORD dwLength, DWORD dwDeltaPeriod,
+                    VFRACT vfDeltaLVolume, VFRACT vfDeltaRVolume,
+                    PFRACT pfDeltaPitch, PFRACT pfNewPitch,
+                    DWORD dwMixChoice, DWORD dwStereo);
     static VFRACT VRELToVFRACT(VREL vrVolume); // dB to absolute.
     
     CSourceSample   m_Source;           // Preset values for sample.
     CSynth *        m_pSynth;           // For access to sample rate, etc.
 
-    BOOL            m_fMMXEnabled;
+    DWORD           m_dwMixFlags;       // SPLAY_SSE2, if supported.
 
     short *         m_pnWave;           // Private pointer to wave.
     VREL            m_vrBaseLVolume;    // Overall left volume.
@@ -936,6 +1035,8 @@ private:
     ULONGLONG       m_ullLoopEnd;       // Used to track > 1m wave.
     ULONGLONG       m_ullSampleLength;  // Used to track > 1m wave.
     DWORD           m_dwAddressUpper;   // Temp storage for upper bits of address.
+    BOOL            m_fStreamed;        // Wave is streamed; mix through MixStreamed().
+    CWaveStream *   m_pStream;          // Its prefetch buffer, NULL if none was free.
 };
 
 /*****************************************************************************
@@ -978,7 +1079,7 @@ public:
     PREL        GetNewPitch(STIME stTime);  // Return current pitch value
     void        GetNewVolume(STIME stTime, VREL& vrVolume, VREL &vrVolumeR);
                                             // Return current volume value
-    DWORD       Mix(short *pBuffer,DWORD dwLength,STIME stStart,STIME stEnd);
+    DWORD       Mix(long *plBuffer,DWORD dwLength,STIME stStart,STIME stEnd);
 
 private:
     CVoiceLFO       m_LFO;              // LFO.
@@ -1009,8 +1110,12 @@ public:
     DWORD           m_dwProgram;        // Bank and Patch choice.
     DWORD           m_dwPriority;       // Priority.
     CControlLogic * m_pControl;         // Which control group is playing voice.
+    DWORD           m_dwHeapIndex;      // Position in the steal heap, or VOICE_NOT_QUEUED.
+    VREL            m_vrStealVolume;    // m_vrVolume as last seen by the steal heap.
 };
 
+#define VOICE_NOT_QUEUED    0xFFFFFFFF
+
 
 /*****************************************************************************
  * class CVoiceList
@@ -1025,6 +1130,37 @@ public:
     CVoice *     GetItem(LONG lIndex) {return (CVoice *) CList::GetItem(lIndex);};
 };
 
+/*****************************************************************************
+ * class CVoiceHeap
+ *****************************************************************************
+ * Binary heap of the voices in use, with the best voice to steal on top.
+ * Each voice records its position, so a voice whose place in the stealing
+ * order changes can be moved or removed in O(log n) without a search.
+ */
+class CVoiceHeap
+{
+public:
+                CVoiceHeap();
+                ~CVoiceHeap();
+    HRESULT     Reserve(DWORD dwCapacity);
+    BOOL        Insert(CVoice *pVoice);
+    void        Remove(CVoice *pVoice);
+    void        Update(CVoice *pVoice);
+    void        Clear();
+    CVoice *    GetTop() {return m_dwCount ? m_ppVoices[0] : NULL;};
+    CVoice *    GetTopUntagged(DWORD dwIndex = 0);
+    static BOOL StealsBefore(CVoice *pVoice, CVoice *pOther);
+
+private:
+    void        Place(DWORD dwIndex, CVoice *pVoice);
+    void        SiftUp(DWORD dwIndex);
+    void        SiftDown(DWORD dwIndex);
+
+    CVoice **   m_ppVoices;         // Heap array.
+    DWORD       m_dwCount;          // Voices in the heap.
+    DWORD       m_dwCapacity;       // Entries allocated.
+};
+
 /*****************************************************************************
  * struct PerfStats
  *****************************************************************************
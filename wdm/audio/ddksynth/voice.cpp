@@ -9,10 +9,6 @@
 #define STR_MODULENAME "DDKSynth.sys:Voice: "
 
 
-#ifdef _X86_
-#define MMX_ENABLED 1
-#endif
-
 #pragma code_seg()
 /*****************************************************************************
  * CVoiceLFO::CVoiceLFO()
@@ -405,7 +401,7 @@ PREL CVoiceEG::GetPitch(STIME stTime, STIME *pstNextTime)
     return prLevel;
 }
 
-BOOL MultiMediaInstructionsSupported();
+DWORD MixInstructionSet();
 
 /*****************************************************************************
  * CDigitalAudio::CDigitalAudio()
@@ -434,9 +430,10 @@ CDigitalAudio::CDigitalAudio()
     m_ullLoopEnd = 0;
     m_ullSampleLength = 0;
     m_fElGrande = FALSE;
-#ifdef MMX_ENABLED
-    m_fMMXEnabled = MultiMediaInstructionsSupported();
-#endif // MMX_ENABLED
+    m_dwAddressUpper = 0;
+    m_fStreamed = FALSE;
+    m_pStream = NULL;
+    m_dwMixFlags = MixInstructionSet();
 };
 
 /*****************************************************************************
@@ -687,6 +684,11 @@ PFRACT CDigitalAudio::PRELToPFRACT(PREL prPitch)
  */
 void CDigitalAudio::ClearVoice()
 {
+    if (m_pStream != NULL)
+    {
+        m_pStream->Detach();
+        m_pStream = NULL;
+    }
     if (m_Source.m_pWave != NULL)
     {
         m_Source.m_pWave->PlayOff();
@@ -723,8 +725,11 @@ STIME CDigitalAudio::StartVoice(CSynth *pSynth,    CSourceSample *pSample,
     m_pfBasePitch /= pSynth->m_dwSampleRate;
     m_pfLastPitch = m_pfBasePitch;
     
-    m_fElGrande = pSample->m_dwSampleLength >= 0x80000;     // Greater than 512k.
-    if ((pSample->m_dwLoopEnd - pSample->m_dwLoopStart) >= 0x80000)
+    // Streamed waves are mixed a block at a time from 64 bit positions, so
+    // neither the big sample rebasing nor its loop limit applies.
+    m_fStreamed = (pSample->m_pWave->m_pvStore != NULL);
+    m_fElGrande = !m_fStreamed && (pSample->m_dwSampleLength >= 0x80000);    // Greater than 512k.
+    if (!m_fStreamed && ((pSample->m_dwLoopEnd - pSample->m_dwLoopStart) >= 0x80000))
     {   // We can't handle loops greater than 1 meg!
         m_Source.m_bOneShot = TRUE;
     }
@@ -742,7 +747,7 @@ STIME CDigitalAudio::StartVoice(CSynth *pSynth,    CSourceSample *pSample,
     {
         m_Source.m_bOneShot = TRUE;
     }
-    if (m_fElGrande)
+    if (m_fElGrande || m_fStreamed)
     {
         m_pfSampleLength = 0x7FFFFFFF;
     }
@@ -750,6 +755,13 @@ STIME CDigitalAudio::StartVoice(CSynth *pSynth,    CSourceSample *pSample,
     {
         m_pfSampleLength = (long) m_ullSampleLength;
     }
+    if (m_fStreamed)
+    {
+        // Without a free stream the voice plays the resident head only.
+        m_pStream = pSynth->AttachStream(pSample->m_pWave,
+                                         pSample->m_dwLoopStart, pSample->m_dwLoopEnd,
+                                         m_Source.m_bOneShot);
+    }
     return (0); // !!! what is this return value?
 }
 
@@ -849,13 +861,120 @@ void CDigitalAudio::AfterBigSampleMix()
     }
 }
 
+/*****************************************************************************
+ * CDigitalAudio::MixStreamed()
+ *****************************************************************************
+ * Mix a streamed wave.  Each block is mixed in place from the resident head
+ * or the voice's stream, with m_pnWave and the position rebased to the
+ * block.  A block that hasn't been read in yet is skipped in silence and
+ * counted.  Loops wrap here, between blocks.  Returns FALSE when a one shot
+ * runs out.
+ */
+BOOL CDigitalAudio::MixStreamed(long *plBuffer, DWORD dwLength, DWORD dwDeltaPeriod,
+                                VFRACT vfDeltaLVolume, VFRACT vfDeltaRVolume,
+                                PFRACT pfDeltaPitch, PFRACT pfNewPitch,
+                                DWORD dwMixChoice, DWORD dwStereo)
+{
+    ULONGLONG ullEnd;
+    ULONGLONG ullLoopLength = 0;
+    ULONGLONG ullBase;
+    ULONGLONG ullBlockEnd;
+    DWORD dwBlock;
+    DWORD dwSoFar;
+    DWORD dwStart = 0;
+    short *pnBlock;
+
+    if (m_Source.m_bOneShot)
+    {
+        ullEnd = m_ullSampleLength;
+    }
+    else
+    {
+        ullEnd = m_ullLoopEnd;
+        ullLoopLength = m_ullLoopEnd - m_ullLoopStart;
+        if (ullLoopLength <= (ULONGLONG) pfNewPitch)
+        {
+            return FALSE;
+        }
+    }
+
+    while (dwLength > 0)
+    {
+        if (m_ullLastSample >= ullEnd)
+        {
+            if (ullLoopLength == 0)
+            {
+                return FALSE;
+            }
+            m_ullLastSample -= ullLoopLength;
+            continue;
+        }
+        dwBlock = (DWORD) (m_ullLastSample >> (12 + STREAM_BLOCK_SHIFT));
+        ullBase = ((ULONGLONG) dwBlock) << (12 + STREAM_BLOCK_SHIFT);
+        ullBlockEnd = ullBase + (((ULONGLONG) STREAM_BLOCK) << 12);
+        if (ullBlockEnd > ullEnd)
+        {
+            ullBlockEnd = ullEnd;
+        }
+
+        if (m_pStream)
+        {
+            pnBlock = m_pStream->GetBlock(dwBlock);
+        }
+        else if (dwBlock < STREAM_HEAD_BLOCKS)
+        {
+            DWORD dwShift = (m_Source.m_bSampleType & SFORMAT_16) ? 1 : 0;
+            pnBlock = (short *) ((BYTE *) m_Source.m_pWave->m_pnHead +
+                                 ((dwBlock << STREAM_BLOCK_SHIFT) << dwShift));
+        }
+        else
+        {
+            pnBlock = NULL;
+        }
+
+        m_pfLastSample = (PFRACT) (m_ullLastSample - ullBase);
+        if (pnBlock)
+        {
+            m_pnWave = pnBlock;
+            m_dwAddressUpper = dwBlock << STREAM_BLOCK_SHIFT;
+            dwSoFar = MixSpans(&plBuffer[dwStart],dwLength,dwDeltaPeriod,
+                vfDeltaLVolume, vfDeltaRVolume,
+                pfDeltaPitch,
+                (PFRACT) (ullBlockEnd - ullBase), 0,
+                dwMixChoice, m_pSynth->m_dwInterpolation);
+            m_dwAddressUpper = 0;
+        }
+        else
+        {
+            // Underrun.  Move through the block at the current pitch.
+            dwSoFar = dwLength;
+            if (m_pfLastPitch > 0)
+            {
+                DWORD dwToEnd = (DWORD) (((ullBlockEnd - ullBase - m_pfLastSample - 1) /
+                                          m_pfLastPitch) + 1);
+                dwSoFar = min(dwSoFar, dwToEnd);
+            }
+            m_pfLastSample += m_pfLastPitch * (long) dwSoFar;
+            InterlockedIncrement(&m_pSynth->m_lStreamUnderruns);
+        }
+        m_ullLastSample = ullBase + m_pfLastSample;
+        if (dwSoFar == 0)
+        {
+            break;
+        }
+        dwStart += dwSoFar << dwStereo;
+        dwLength -= dwSoFar;
+    }
+    return TRUE;
+}
+
 /*****************************************************************************
  * CDigitalAudio::Mix()
  *****************************************************************************
- * Do a mix on this buffer.  This handles loops and calling the different mix 
- * functions (depending on format).
+ * Do a mix on this bus.  This handles loops and calls MixSpans() with the
+ * kernels for the wave format and the synth's interpolation.
  */
-BOOL CDigitalAudio::Mix(short *pBuffer, DWORD dwLength, // length in SAMPLES
+BOOL CDigitalAudio::Mix(long *plBuffer, DWORD dwLength, // length in SAMPLES
                         VREL  vrVolumeL,VREL  vrVolumeR,
                         PREL  prPitch,  DWORD dwStereo)
 {
@@ -869,7 +988,7 @@ BOOL CDigitalAudio::Mix(short *pBuffer, DWORD dwLength, // length in SAMPLES
     VFRACT vfDeltaRVolume;
     DWORD dwPeriod = 64;
     DWORD dwSoFar;
-    DWORD dwStart; // position in WORDs
+    DWORD dwStart; // position in the bus
     DWORD dwMixChoice = dwStereo ? SPLAY_STEREO : 0;
     if (dwLength == 0)      // Attack was instant. 
     {
@@ -909,7 +1028,8 @@ BOOL CDigitalAudio::Mix(short *pBuffer, DWORD dwLength, // length in SAMPLES
         dwPeriod = 512;     // Make it happen anyway.
     }
 
-    // This makes MMX sound a little better (MMX bug will be fixed)
+    // Steps a multiple of four samples apart keep the spans between them
+    // in whole groups for the SSE2 kernels.
     dwPeriod += 3;
     dwPeriod &= 0xFFFFFFFC;
 
@@ -922,19 +1042,27 @@ BOOL CDigitalAudio::Mix(short *pBuffer, DWORD dwLength, // length in SAMPLES
     vfDeltaLVolume = MulDiv(vfNewLVolume - m_vfLastLVolume,dwPeriod << 8,dwLength);
     vfDeltaRVolume = MulDiv(vfNewRVolume - m_vfLastRVolume,dwPeriod << 8,dwLength);
 
-    if (m_fMMXEnabled && (dwLength > 8))
-    {
-       dwMixChoice |= SPLAY_MMX; 
-    }
+    dwMixChoice |= m_dwMixFlags;
     dwMixChoice |= m_Source.m_bSampleType;
     dwStart = 0;
 
-    for (;;)
+    if (m_fStreamed)
     {
-        if (dwLength <= 8)
+        if (!MixStreamed(plBuffer,dwLength,dwPeriod,
+                         vfDeltaLVolume,vfDeltaRVolume,
+                         pfDeltaPitch,pfNewPitch,
+                         dwMixChoice,dwStereo))
         {
-            dwMixChoice &= ~SPLAY_MMX;
+            return FALSE;
         }
+        m_vfLastLVolume = vfNewLVolume;
+        m_vfLastRVolume = vfNewRVolume;
+        m_pfLastPitch = pfNewPitch;
+        return TRUE;
+    }
+
+    for (;;)
+    {
         if (m_fElGrande)
         {
             BeforeBigSampleMix();
@@ -953,63 +1081,11 @@ BOOL CDigitalAudio::Mix(short *pBuffer, DWORD dwLength, // length in SAMPLES
                 return FALSE;
             }
         }
-        switch (dwMixChoice)
-        {
-        case SFORMAT_8 | SPLAY_STEREO : 
-            dwSoFar = Mix8(&pBuffer[dwStart],dwLength,dwPeriod,
-                vfDeltaLVolume, vfDeltaRVolume,
-                pfDeltaPitch, 
-                pfEnd, pfLoopLen);
-            break;
-        case SFORMAT_8 : 
-            dwSoFar = MixMono8(&pBuffer[dwStart],dwLength,dwPeriod,
-                vfDeltaLVolume,
-                pfDeltaPitch, 
-                pfEnd, pfLoopLen);
-            break;
-        case SFORMAT_16 | SPLAY_STEREO : 
-            dwSoFar = Mix16(&pBuffer[dwStart],dwLength,dwPeriod,
-                vfDeltaLVolume, vfDeltaRVolume,
-                pfDeltaPitch, 
-                pfEnd, pfLoopLen);
-            break;
-        case SFORMAT_16 :
-            dwSoFar = MixMono16(&pBuffer[dwStart],dwLength,dwPeriod,
-                vfDeltaLVolume,
-                pfDeltaPitch, 
-                pfEnd, pfLoopLen);
-            break;
-#ifdef MMX_ENABLED
-        case SFORMAT_8 | SPLAY_MMX | SPLAY_STEREO : 
-            dwSoFar = Mix8X(&pBuffer[dwStart],dwLength,dwPeriod,
-                vfDeltaLVolume, vfDeltaRVolume ,
-                pfDeltaPitch, 
-                pfEnd, pfLoopLen);
-        
-            break;
-        case SFORMAT_16 | SPLAY_MMX | SPLAY_STEREO : 
-            dwSoFar = Mix16X(&pBuffer[dwStart],dwLength,dwPeriod,
-                vfDeltaLVolume, vfDeltaRVolume,
-                pfDeltaPitch, 
-                pfEnd, pfLoopLen);
-            break; 
-        case SFORMAT_8 | SPLAY_MMX : 
-            dwSoFar = MixMono8X(&pBuffer[dwStart],dwLength,dwPeriod,
-                vfDeltaLVolume,
-                pfDeltaPitch, 
-                pfEnd, pfLoopLen);
-        
-            break;
-        case SFORMAT_16 | SPLAY_MMX : 
-            dwSoFar = MixMono16X(&pBuffer[dwStart],dwLength,dwPeriod,
-                vfDeltaLVolume, 
-                pfDeltaPitch, 
-                pfEnd, pfLoopLen);
-            break; 
-#endif
-        default :
-            return (FALSE);
-        }
+        dwSoFar = MixSpans(&plBuffer[dwStart],dwLength,dwPeriod,
+            vfDeltaLVolume, vfDeltaRVolume,
+            pfDeltaPitch,
+            pfEnd, pfLoopLen,
+            dwMixChoice, m_pSynth->m_dwInterpolation);
         if (m_fElGrande)
         {
             AfterBigSampleMix();
@@ -1062,6 +1138,8 @@ CVoice::CVoice()
     m_stStopTime = 0x7fffffffffffffff;
     m_vrVolume = 0;
     m_fAllowOverlap = FALSE;
+    m_dwHeapIndex = VOICE_NOT_QUEUED;
+    m_vrStealVolume = 0;
 }
 
 /*****************************************************************************
@@ -1105,6 +1183,7 @@ void CVoice::StopVoice(STIME stTime)
         m_fNoteOn = FALSE;
         m_fSustainOn = FALSE;
         m_stStopTime = stTime;
+        m_pSynth->m_StealHeap.Update(this);
     }
 }
 
@@ -1130,6 +1209,7 @@ void CVoice::QuickStopVoice(STIME stTime)
     {
         m_VolumeEG.QuickStopVoice(m_stStopTime,m_pSynth->m_dwSampleRate);
     }
+    m_pSynth->m_StealHeap.Update(this);
 }
 
 /*****************************************************************************
@@ -1319,9 +1399,10 @@ PREL CVoice::GetNewPitch(STIME stTime)
  * CVoice::Mix()
  *****************************************************************************
  * Mix this voice into the given buffer.  Determine certain volume and pitch
- * parameters, then call into the Digital Audio Engine.
+ * parameters, then call into the Digital Audio Engine.  Only touches this
+ * voice and the MIDI recorders it reads, so voices can be mixed in parallel.
  */
-DWORD CVoice::Mix(  short *pBuffer, DWORD dwLength,
+DWORD CVoice::Mix(  long *plBuffer, DWORD dwLength,
                     STIME stStart,  STIME stEnd)
 {
     BOOL fInUse = TRUE;
@@ -1371,7 +1452,7 @@ DWORD CVoice::Mix(  short *pBuffer, DWORD dwLength,
             }
         }
 
-        fFullMix = m_DigitalAudio.Mix(&pBuffer[(stStartMix - stStart) <<
+        fFullMix = m_DigitalAudio.Mix(&plBuffer[(stStartMix - stStart) <<
                                                       m_pSynth->m_dwStereo],
                                       (DWORD) (stEndMix - stStartMix),
                                       vrVolume, vrVolumeR, prPitch,
@@ -1381,11 +1462,272 @@ DWORD CVoice::Mix(  short *pBuffer, DWORD dwLength,
     m_fInUse = fInUse && fFullMix;
     if (!m_fInUse) 
     {
-        ClearVoice();
+        // CSynth::Mix() calls ClearVoice() when it retires the voice, since
+        // this may be running on a parallel mix thread.
         m_stStopTime = stEndMix;    // For measurement purposes.
     }
     m_stLastMix = stEndMix;
     return (dwLength);
 }
 
+/*****************************************************************************
+ * CVoiceHeap::CVoiceHeap()
+ *****************************************************************************
+ * Constructor for the steal heap.
+ */
+CVoiceHeap::CVoiceHeap()
+{
+    m_ppVoices = NULL;
+    m_dwCount = 0;
+    m_dwCapacity = 0;
+}
+
+/*****************************************************************************
+ * CVoiceHeap::~CVoiceHeap()
+ *****************************************************************************
+ * Destructor for the steal heap.
+ */
+CVoiceHeap::~CVoiceHeap()
+{
+    if (m_ppVoices)
+    {
+        delete [] m_ppVoices;
+    }
+}
+
+/*****************************************************************************
+ * CVoiceHeap::Reserve()
+ *****************************************************************************
+ * Make room for dwCapacity voices, so Insert() never has to allocate while
+ * notes are being started.
+ */
+HRESULT CVoiceHeap::Reserve(DWORD dwCapacity)
+{
+    if (dwCapacity <= m_dwCapacity)
+    {
+        return S_OK;
+    }
+    CVoice **ppVoices = new(NonPagedPool,'HSmD') CVoice *[dwCapacity]; //  DmSH
+    if (ppVoices == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+    if (m_ppVoices)
+    {
+        RtlCopyMemory(ppVoices, m_ppVoices, m_dwCount * sizeof(CVoice *));
+        delete [] m_ppVoices;
+    }
+    m_ppVoices = ppVoices;
+    m_dwCapacity = dwCapacity;
+    return S_OK;
+}
+
+/*****************************************************************************
+ * CVoiceHeap::StealsBefore()
+ *****************************************************************************
+ * Returns whether pVoice should be stolen before pOther.  The lowest
+ * priority goes first, so the top voice is the only one StealVoice() has
+ * to check.  Within a priority, voices already slated to be returned go
+ * first since they are being quick-stopped anyway, then released notes
+ * before held ones, the quietest release first and the oldest held note
+ * first.  Volume is compared as of the last Insert() or Update(), since
+ * the mix changes it behind the heap's back.
+ */
+BOOL CVoiceHeap::StealsBefore(CVoice *pVoice, CVoice *pOther)
+{
+    if (pVoice->m_dwPriority != pOther->m_dwPriority)
+    {
+        return (pVoice->m_dwPriority < pOther->m_dwPriority);
+    }
+    if (pVoice->m_fTag != pOther->m_fTag)
+    {
+        return pVoice->m_fTag;
+    }
+    if (pVoice->m_fNoteOn != pOther->m_fNoteOn)
+    {
+        return pOther->m_fNoteOn;
+    }
+    if (pVoice->m_fNoteOn)
+    {
+        return (pVoice->m_stStartTime < pOther->m_stStartTime);
+    }
+    return (pVoice->m_vrStealVolume < pOther->m_vrStealVolume);
+}
+
+/*****************************************************************************
+ * CVoiceHeap::GetTopUntagged()
+ *****************************************************************************
+ * Find the best voice to steal that is not already slated to be returned.
+ * An untagged voice goes before everything below it, so only the subtrees
+ * under tagged voices have to be searched, and there are few of those.
+ */
+CVoice *CVoiceHeap::GetTopUntagged(DWORD dwIndex)
+{
+    CVoice *pBest;
+    CVoice *pOther;
+
+    if (dwIndex >= m_dwCount)
+    {
+        return NULL;
+    }
+    if (!m_ppVoices[dwIndex]->m_fTag)
+    {
+        return m_ppVoices[dwIndex];
+    }
+    pBest = GetTopUntagged((dwIndex << 1) + 1);
+    pOther = GetTopUntagged((dwIndex << 1) + 2);
+    if ((pBest == NULL) ||
+        ((pOther != NULL) && StealsBefore(pOther, pBest)))
+    {
+        pBest = pOther;
+    }
+    return pBest;
+}
+
+/*****************************************************************************
+ * CVoiceHeap::Place()
+ *****************************************************************************
+ * Put a voice in a slot and record where it is.
+ */
+void CVoiceHeap::Place(DWORD dwIndex, CVoice *pVoice)
+{
+    m_ppVoices[dwIndex] = pVoice;
+    pVoice->m_dwHeapIndex = dwIndex;
+}
+
+/*****************************************************************************
+ * CVoiceHeap::SiftUp()
+ *****************************************************************************
+ * Move the voice at dwIndex towards the top until its parent goes first.
+ */
+void CVoiceHeap::SiftUp(DWORD dwIndex)
+{
+    CVoice *pVoice = m_ppVoices[dwIndex];
+
+    while (dwIndex > 0)
+    {
+        DWORD dwParent = (dwIndex - 1) >> 1;
+        if (!StealsBefore(pVoice, m_ppVoices[dwParent]))
+        {
+            break;
+        }
+        Place(dwIndex, m_ppVoices[dwParent]);
+        dwIndex = dwParent;
+    }
+    Place(dwIndex, pVoice);
+}
+
+/*****************************************************************************
+ * CVoiceHeap::SiftDown()
+ *****************************************************************************
+ * Move the voice at dwIndex towards the bottom until it goes before both
+ * its children.
+ */
+void CVoiceHeap::SiftDown(DWORD dwIndex)
+{
+    CVoice *pVoice = m_ppVoices[dwIndex];
+
+    for (;;)
+    {
+        DWORD dwChild = (dwIndex << 1) + 1;
+        if (dwChild >= m_dwCount)
+        {
+            break;
+        }
+        if ((dwChild + 1 < m_dwCount) &&
+            StealsBefore(m_ppVoices[dwChild + 1], m_ppVoices[dwChild]))
+        {
+            dwChild++;
+        }
+        if (!StealsBefore(m_ppVoices[dwChild], pVoice))
+        {
+            break;
+        }
+        Place(dwIndex, m_ppVoices[dwChild]);
+        dwIndex = dwChild;
+    }
+    Place(dwIndex, pVoice);
+}
+
+/*****************************************************************************
+ * CVoiceHeap::Insert()
+ *****************************************************************************
+ * Add a voice that has just been queued.  Fails only if more voices are in
+ * use than were reserved for.
+ */
+BOOL CVoiceHeap::Insert(CVoice *pVoice)
+{
+    if (m_dwCount >= m_dwCapacity)
+    {
+        pVoice->m_dwHeapIndex = VOICE_NOT_QUEUED;
+        return FALSE;
+    }
+    pVoice->m_vrStealVolume = pVoice->m_vrVolume;
+    Place(m_dwCount, pVoice);
+    SiftUp(m_dwCount++);
+    return TRUE;
+}
+
+/*****************************************************************************
+ * CVoiceHeap::Remove()
+ *****************************************************************************
+ * Take a voice out of the heap, if it is in it.  The last voice fills the
+ * hole and is moved whichever way it needs to go.
+ */
+void CVoiceHeap::Remove(CVoice *pVoice)
+{
+    DWORD dwIndex = pVoice->m_dwHeapIndex;
 
+    if (dwIndex >= m_dwCount)
+    {
+        return;
+    }
+    pVoice->m_dwHeapIndex = VOICE_NOT_QUEUED;
+    m_dwCount--;
+    if (dwIndex < m_dwCount)
+    {
+        Place(dwIndex, m_ppVoices[m_dwCount]);
+        Update(m_ppVoices[dwIndex]);
+    }
+}
+
+/*****************************************************************************
+ * CVoiceHeap::Update()
+ *****************************************************************************
+ * Restore the heap after a voice's priority, note state or volume changed.
+ * Costs a couple of comparisons when its place is unchanged.
+ */
+void CVoiceHeap::Update(CVoice *pVoice)
+{
+    DWORD dwIndex = pVoice->m_dwHeapIndex;
+
+    if (dwIndex >= m_dwCount)
+    {
+        return;
+    }
+    pVoice->m_vrStealVolume = pVoice->m_vrVolume;
+    if ((dwIndex > 0) && StealsBefore(pVoice, m_ppVoices[(dwIndex - 1) >> 1]))
+    {
+        SiftUp(dwIndex);
+    }
+    else
+    {
+        SiftDown(dwIndex);
+    }
+}
+
+/*****************************************************************************
+ * CVoiceHeap::Clear()
+ *****************************************************************************
+ * Empty the heap.
+ */
+void CVoiceHeap::Clear()
+{
+    DWORD dwIndex;
+
+    for (dwIndex = 0; dwIndex < m_dwCount; dwIndex++)
+    {
+        m_ppVoices[dwIndex]->m_dwHeapIndex = VOICE_NOT_QUEUED;
+    }
+    m_dwCount = 0;
+}